@@ -0,0 +1,473 @@
+//
+//  AEJitterBuffer.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AEJitterBuffer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define kDelayWindow 256                                // Packets over which delay is measured
+
+static const double   kDelayPercentile          = 0.95;
+static const double   kMinimumTargetDelay       = 0.01;  // Seconds
+static const double   kMaximumTargetDelay       = 1.0;   // Seconds
+static const double   kTargetReleaseTime        = 2.0;   // Seconds for the target to fall most of the way to a lower delay
+static const double   kAdjustmentInterval       = 0.5;   // Minimum seconds between depth adjustments
+static const double   kRepeatConcealDuration    = 0.06;  // Seconds over which repeat concealment fades out
+static const uint32_t kHistoryFrames            = 512;   // Audio kept for concealment
+static const uint32_t kFadeFrames               = 64;
+
+typedef struct {
+    volatile int32_t    ready;      // Set by the producer once filled; cleared by the consumer once played
+    int64_t             start;
+    uint32_t            frames;
+    float              *audio;      // Non-interleaved, maxPacketFrames per channel
+} packet_t;
+
+struct AEJitterBuffer {
+    uint32_t            channels;
+    double              sampleRate;
+    uint32_t            maxPacketFrames;
+    uint32_t            packetCapacity;
+    packet_t           *packets;
+    float              *packetAudio;
+    volatile int        concealment;
+
+    // Producer state
+    double              transits[kDelayWindow];         // Recent transit times, in arrival order
+    double              sortedTransits[kDelayWindow];   // The same, in ascending order
+    int                 transitCount;
+    int                 transitIndex;
+    double              lastTransit;
+    double              lastArrival;
+    double              averagePacketFrames;
+    uint32_t            nextPacket;
+
+    // Consumer state
+    bool                playing;
+    bool                hasPlayhead;
+    int64_t             playhead;
+    bool                concealing;
+    uint64_t            concealPosition;
+    uint64_t            gapFrames;
+    uint64_t            underrunFrames;
+    uint64_t            holdFrames;
+    uint64_t            framesSinceAdjustment;
+    int64_t             lowWater;
+    float              *history[AEMixerCoreMaximumChannels];
+    uint32_t            historyFill;
+    float              *fade[AEMixerCoreMaximumChannels];
+
+    // Statistics, written by one side each
+    volatile uint64_t   packetsReceived;
+    volatile uint64_t   packetsLate;
+    volatile uint64_t   packetsLost;
+    volatile uint64_t   packetsDropped;
+    volatile uint64_t   framesConcealed;
+    volatile double     jitter;
+    volatile double     targetDelay;
+    volatile double     currentDelay;
+};
+
+AEJitterBuffer *AEJitterBufferNew(uint32_t channels, double sampleRate, uint32_t maxPacketFrames, uint32_t packetCapacity) {
+    if ( channels == 0 || channels > AEMixerCoreMaximumChannels || maxPacketFrames == 0 || packetCapacity == 0 ) return NULL;
+
+    AEJitterBuffer *buffer = (AEJitterBuffer*)calloc(1, sizeof(AEJitterBuffer));
+    if ( !buffer ) return NULL;
+    buffer->channels = channels;
+    buffer->sampleRate = sampleRate;
+    buffer->maxPacketFrames = maxPacketFrames;
+    buffer->packetCapacity = packetCapacity;
+    buffer->targetDelay = kMinimumTargetDelay;
+
+    buffer->packets = (packet_t*)calloc(packetCapacity, sizeof(packet_t));
+    buffer->packetAudio = (float*)malloc(sizeof(float) * channels * maxPacketFrames * packetCapacity);
+    bool allocated = buffer->packets && buffer->packetAudio;
+    for ( uint32_t i=0; i<channels && allocated; i++ ) {
+        buffer->history[i] = (float*)calloc(kHistoryFrames, sizeof(float));
+        buffer->fade[i] = (float*)calloc(kFadeFrames, sizeof(float));
+        allocated = buffer->history[i] && buffer->fade[i];
+    }
+    if ( !allocated ) {
+        AEJitterBufferFree(buffer);
+        return NULL;
+    }
+
+    for ( uint32_t i=0; i<packetCapacity; i++ ) {
+        buffer->packets[i].audio = buffer->packetAudio + (size_t)i * channels * maxPacketFrames;
+    }
+
+    return buffer;
+}
+
+void AEJitterBufferFree(AEJitterBuffer *buffer) {
+    if ( !buffer ) return;
+    for ( uint32_t i=0; i<buffer->channels; i++ ) {
+        free(buffer->history[i]);
+        free(buffer->fade[i]);
+    }
+    free(buffer->packets);
+    free(buffer->packetAudio);
+    free(buffer);
+}
+
+void AEJitterBufferSetConcealment(AEJitterBuffer *buffer, AEJitterBufferConcealment concealment) {
+    buffer->concealment = concealment;
+}
+
+#pragma mark - Producer
+
+static int searchTransits(const double *sorted, int count, double transit) {
+    // Index of the first entry not less than the transit time
+    int low = 0, high = count;
+    while ( low < high ) {
+        int middle = (low + high) / 2;
+        if ( sorted[middle] < transit ) low = middle + 1; else high = middle;
+    }
+    return low;
+}
+
+static void updateDelayEstimate(AEJitterBuffer *buffer, uint32_t frames, double sampleTime, double arrivalTime) {
+    // Transit time, up to a constant offset between the sender's clock and ours
+    double transit = arrivalTime - sampleTime / buffer->sampleRate;
+
+    if ( buffer->transitCount > 0 ) {
+        // Interarrival jitter, as per RFC 3550
+        double difference = fabs(transit - buffer->lastTransit);
+        buffer->jitter += (difference - buffer->jitter) / 16.0;
+        buffer->averagePacketFrames += ((double)frames - buffer->averagePacketFrames) / 16.0;
+    } else {
+        buffer->averagePacketFrames = frames;
+    }
+    buffer->lastTransit = transit;
+
+    // Keep the window sorted as it slides, so the percentile is a lookup rather than a sort: take out
+    // the transit time falling out of the window, and put the new one in its place
+    int count = buffer->transitCount;
+    if ( count == kDelayWindow ) {
+        int index = searchTransits(buffer->sortedTransits, count, buffer->transits[buffer->transitIndex]);
+        memmove(buffer->sortedTransits + index, buffer->sortedTransits + index + 1, (count - index - 1) * sizeof(double));
+        count--;
+    }
+    int index = searchTransits(buffer->sortedTransits, count, transit);
+    memmove(buffer->sortedTransits + index + 1, buffer->sortedTransits + index, (count - index) * sizeof(double));
+    buffer->sortedTransits[index] = transit;
+    buffer->transitCount = count + 1;
+
+    buffer->transits[buffer->transitIndex] = transit;
+    buffer->transitIndex = (buffer->transitIndex + 1) % kDelayWindow;
+
+    // Delay beyond the quickest recent packet that we want to cover
+    const double *sorted = buffer->sortedTransits;
+    double delay = sorted[(int)((buffer->transitCount - 1) * kDelayPercentile)] - sorted[0];
+
+    // Add a packet's worth, as audio only arrives once a packet is complete
+    double target = delay + buffer->averagePacketFrames / buffer->sampleRate;
+    target = fmax(kMinimumTargetDelay, fmin(kMaximumTargetDelay, target));
+
+    // Rise straight away, but fall slowly, so one quiet spell doesn't leave us exposed
+    double current = buffer->targetDelay;
+    if ( target < current && buffer->transitCount > 1 ) {
+        double elapsed = fmax(0.0, arrivalTime - buffer->lastArrival);
+        target = current - (current - target) * (1.0 - exp(-elapsed / kTargetReleaseTime));
+    }
+    buffer->targetDelay = target;
+    buffer->lastArrival = arrivalTime;
+}
+
+bool AEJitterBufferPut(AEJitterBuffer *buffer, const AEMixerCoreFormat *format, const void * const *audio,
+                       uint32_t frames, double sampleTime, double arrivalTime) {
+    if ( frames == 0 || format->channels != buffer->channels ) return false;
+
+    buffer->packetsReceived++;
+    updateDelayEstimate(buffer, frames, sampleTime, arrivalTime);
+
+    size_t bytesPerSample = format->sampleType == AEMixerCoreSampleInt16 ? 2 : 4;
+    int64_t start = llround(sampleTime);
+
+    for ( uint32_t offset = 0; offset < frames; ) {
+        uint32_t chunkFrames = frames - offset < buffer->maxPacketFrames ? frames - offset : buffer->maxPacketFrames;
+
+        // Find a free packet, starting after the last one we used
+        packet_t *packet = NULL;
+        for ( uint32_t i=0; i<buffer->packetCapacity; i++ ) {
+            packet_t *candidate = &buffer->packets[(buffer->nextPacket + i) % buffer->packetCapacity];
+            if ( !candidate->ready ) {
+                packet = candidate;
+                buffer->nextPacket = (buffer->nextPacket + i + 1) % buffer->packetCapacity;
+                break;
+            }
+        }
+
+        if ( !packet ) {
+            buffer->packetsDropped++;
+            return false;
+        }
+
+        __sync_synchronize();
+
+        const void *source[AEMixerCoreMaximumChannels];
+        float *target[AEMixerCoreMaximumChannels];
+        for ( uint32_t i=0; i<buffer->channels; i++ ) {
+            target[i] = packet->audio + (size_t)i * buffer->maxPacketFrames;
+            if ( format->interleaved ) {
+                if ( i == 0 ) source[0] = (const char*)audio[0] + (size_t)offset * buffer->channels * bytesPerSample;
+            } else {
+                source[i] = (const char*)audio[i] + (size_t)offset * bytesPerSample;
+            }
+        }
+        AEMixerCoreToFloat(format, source, target, chunkFrames);
+
+        packet->start = start + offset;
+        packet->frames = chunkFrames;
+
+        // Hand the packet over to the consumer
+        __sync_synchronize();
+        packet->ready = 1;
+
+        offset += chunkFrames;
+    }
+
+    return true;
+}
+
+#pragma mark - Consumer
+
+static void releasePacket(packet_t *packet) {
+    __sync_synchronize();
+    packet->ready = 0;
+}
+
+static packet_t *packetAtTime(AEJitterBuffer *buffer, int64_t time) {
+    for ( uint32_t i=0; i<buffer->packetCapacity; i++ ) {
+        packet_t *packet = &buffer->packets[i];
+        if ( packet->ready && packet->start <= time && time < packet->start + (int64_t)packet->frames ) {
+            __sync_synchronize();
+            return packet;
+        }
+    }
+    return NULL;
+}
+
+static void findBufferedRange(AEJitterBuffer *buffer, int64_t after, int64_t *outEarliestStart, int64_t *outLatestEnd) {
+    // Find the first packet starting after a time, and the end of the last packet
+    *outEarliestStart = INT64_MAX;
+    *outLatestEnd = INT64_MIN;
+    for ( uint32_t i=0; i<buffer->packetCapacity; i++ ) {
+        packet_t *packet = &buffer->packets[i];
+        if ( !packet->ready ) continue;
+        if ( packet->start > after && packet->start < *outEarliestStart ) *outEarliestStart = packet->start;
+        if ( packet->start + (int64_t)packet->frames > *outLatestEnd ) *outLatestEnd = packet->start + packet->frames;
+    }
+}
+
+static void discardPacketsBefore(AEJitterBuffer *buffer, int64_t time, bool late) {
+    for ( uint32_t i=0; i<buffer->packetCapacity; i++ ) {
+        packet_t *packet = &buffer->packets[i];
+        if ( packet->ready && packet->start + (int64_t)packet->frames <= time ) {
+            if ( late ) buffer->packetsLate++;
+            releasePacket(packet);
+        }
+    }
+}
+
+static void renderConcealment(AEJitterBuffer *buffer, float * const *output, uint32_t offset, uint32_t frames) {
+    // Play the last audio back and forth, so the waveform carries on without a jump, fading out as we go
+    if ( !buffer->concealing ) {
+        buffer->concealing = true;
+        buffer->concealPosition = 0;
+    }
+
+    uint32_t period = buffer->historyFill;
+    uint64_t fadeFrames = buffer->concealment == AEJitterBufferConcealRepeat
+        ? (uint64_t)(kRepeatConcealDuration * buffer->sampleRate) : kFadeFrames;
+
+    for ( uint32_t channel=0; channel<buffer->channels; channel++ ) {
+        const float *history = buffer->history[channel] + kHistoryFrames - period;
+        float *out = output[channel] + offset;
+        for ( uint32_t i=0; i<frames; i++ ) {
+            uint64_t position = buffer->concealPosition + i;
+            if ( period == 0 || position >= fadeFrames ) {
+                out[i] = 0.0f;
+                continue;
+            }
+            uint64_t phase = position % (2 * period);
+            uint32_t index = (uint32_t)(phase < period ? period - 1 - phase : phase - period);
+            out[i] = history[index] * (1.0f - (float)position / (float)fadeFrames);
+        }
+    }
+
+    buffer->concealPosition += frames;
+}
+
+static void updateHistory(AEJitterBuffer *buffer, float * const *output, uint32_t offset, uint32_t frames) {
+    // Keep the most recent audio played, at the end of the history buffers
+    uint32_t keep = frames >= kHistoryFrames ? 0 : kHistoryFrames - frames;
+    uint32_t copy = frames >= kHistoryFrames ? kHistoryFrames : frames;
+    for ( uint32_t channel=0; channel<buffer->channels; channel++ ) {
+        memmove(buffer->history[channel], buffer->history[channel] + kHistoryFrames - keep, keep * sizeof(float));
+        memcpy(buffer->history[channel] + keep, output[channel] + offset + frames - copy, copy * sizeof(float));
+    }
+    buffer->historyFill = buffer->historyFill + frames > kHistoryFrames ? kHistoryFrames : buffer->historyFill + frames;
+}
+
+void AEJitterBufferGet(AEJitterBuffer *buffer, float * const *output, uint32_t frames) {
+    int64_t target = (int64_t)(buffer->targetDelay * buffer->sampleRate);
+    int64_t earliestStart, latestEnd;
+
+    if ( buffer->hasPlayhead ) {
+        discardPacketsBefore(buffer, buffer->playhead, true);
+    }
+
+    if ( !buffer->playing ) {
+        // Wait until we've buffered enough to ride out the jitter
+        findBufferedRange(buffer, INT64_MIN, &earliestStart, &latestEnd);
+        if ( earliestStart == INT64_MAX || latestEnd - earliestStart < target ) {
+            renderConcealment(buffer, output, 0, frames);
+            buffer->currentDelay = earliestStart == INT64_MAX ? 0.0 : (double)(latestEnd - earliestStart) / buffer->sampleRate;
+            return;
+        }
+        buffer->playing = true;
+        buffer->playhead = buffer->hasPlayhead && buffer->playhead > earliestStart ? buffer->playhead : earliestStart;
+        buffer->hasPlayhead = true;
+        buffer->framesSinceAdjustment = 0;
+    }
+
+    // Close up or open out to the target depth, if we've strayed far from it. We look at the low-water
+    // mark since the last adjustment: the least audio left over after a render, which is the margin we had
+    // against late packets, and should be the target less the packet's worth it allows for.
+    findBufferedRange(buffer, INT64_MIN, &earliestStart, &latestEnd);
+    int64_t depth = latestEnd > buffer->playhead ? latestEnd - buffer->playhead : 0;
+    if ( depth - (int64_t)frames < buffer->lowWater || buffer->framesSinceAdjustment == 0 ) {
+        buffer->lowWater = depth - (int64_t)frames;
+    }
+    buffer->framesSinceAdjustment += frames;
+    if ( !buffer->concealing && buffer->framesSinceAdjustment > kAdjustmentInterval * buffer->sampleRate ) {
+        int64_t expected = target - (int64_t)buffer->averagePacketFrames;
+        int64_t margin = (int64_t)(fmax(target, buffer->averagePacketFrames) / 4);
+        if ( buffer->lowWater > expected + margin ) {
+            // Skip ahead: the concealment fades out from where we are, and the new position fades in
+            int64_t skip = buffer->lowWater - expected;
+            discardPacketsBefore(buffer, buffer->playhead + skip, false);
+            buffer->playhead += skip;
+            buffer->concealing = true;
+            buffer->concealPosition = 0;
+        } else if ( buffer->lowWater < expected - margin ) {
+            // Hold the playhead, covering the pause with concealment
+            buffer->holdFrames = expected - buffer->lowWater;
+        }
+        buffer->framesSinceAdjustment = 0;
+    }
+
+    uint32_t position = 0;
+    while ( position < frames ) {
+        uint32_t remaining = frames - position;
+
+        if ( buffer->holdFrames > 0 ) {
+            uint32_t holdFrames = buffer->holdFrames < remaining ? (uint32_t)buffer->holdFrames : remaining;
+            renderConcealment(buffer, output, position, holdFrames);
+            buffer->holdFrames -= holdFrames;
+            buffer->framesConcealed += holdFrames;
+            position += holdFrames;
+            continue;
+        }
+
+        packet_t *packet = packetAtTime(buffer, buffer->playhead);
+        if ( packet ) {
+            uint32_t packetOffset = (uint32_t)(buffer->playhead - packet->start);
+            uint32_t playFrames = packet->frames - packetOffset < remaining ? packet->frames - packetOffset : remaining;
+
+            for ( uint32_t channel=0; channel<buffer->channels; channel++ ) {
+                memcpy(output[channel] + position,
+                       packet->audio + (size_t)channel * buffer->maxPacketFrames + packetOffset,
+                       playFrames * sizeof(float));
+            }
+
+            if ( buffer->concealing ) {
+                // Crossfade from the concealment into the fresh audio
+                uint32_t fadeFrames = playFrames < kFadeFrames ? playFrames : kFadeFrames;
+                renderConcealment(buffer, buffer->fade, 0, fadeFrames);
+                for ( uint32_t channel=0; channel<buffer->channels; channel++ ) {
+                    AEMixerCoreApplyRamp(output[channel] + position, fadeFrames, 0.0f, 1.0f);
+                    AEMixerCoreAddWithRamp(buffer->fade[channel], output[channel] + position, fadeFrames, 1.0f, 0.0f);
+                }
+                buffer->concealing = false;
+
+                if ( buffer->gapFrames > 0 ) {
+                    // The audio we concealed never came
+                    uint64_t lost = (uint64_t)llround((double)buffer->gapFrames / fmax(1.0, buffer->averagePacketFrames));
+                    buffer->packetsLost += lost > 0 ? lost : 1;
+                    buffer->gapFrames = 0;
+                }
+            }
+
+            updateHistory(buffer, output, position, playFrames);
+            buffer->underrunFrames = 0;
+
+            buffer->playhead += playFrames;
+            position += playFrames;
+
+            if ( packetOffset + playFrames == packet->frames ) {
+                releasePacket(packet);
+            }
+        } else {
+            findBufferedRange(buffer, buffer->playhead, &earliestStart, &latestEnd);
+            if ( earliestStart == INT64_MAX ) {
+                // Nothing more has arrived: conceal without moving the playhead, so audio that's just late
+                // still plays, and rebuffer if this goes on too long
+                renderConcealment(buffer, output, position, remaining);
+                buffer->framesConcealed += remaining;
+                buffer->underrunFrames += remaining;
+                if ( (int64_t)buffer->underrunFrames >= target ) {
+                    buffer->playing = false;
+                    buffer->underrunFrames = 0;
+                }
+                break;
+            }
+
+            // Gap before the next packet: this audio is missing, so conceal it and move on
+            uint32_t gapFrames = earliestStart - buffer->playhead < remaining ? (uint32_t)(earliestStart - buffer->playhead) : remaining;
+            renderConcealment(buffer, output, position, gapFrames);
+            buffer->playhead += gapFrames;
+            buffer->gapFrames += gapFrames;
+            buffer->framesConcealed += gapFrames;
+            position += gapFrames;
+        }
+    }
+
+    findBufferedRange(buffer, INT64_MIN, &earliestStart, &latestEnd);
+    buffer->currentDelay = latestEnd > buffer->playhead ? (double)(latestEnd - buffer->playhead) / buffer->sampleRate : 0.0;
+}
+
+void AEJitterBufferGetStatistics(const AEJitterBuffer *buffer, AEJitterBufferStatistics *outStatistics) {
+    outStatistics->packetsReceived = buffer->packetsReceived;
+    outStatistics->packetsLate = buffer->packetsLate;
+    outStatistics->packetsLost = buffer->packetsLost;
+    outStatistics->packetsDropped = buffer->packetsDropped;
+    outStatistics->framesConcealed = buffer->framesConcealed;
+    outStatistics->jitter = buffer->jitter;
+    outStatistics->targetDelay = buffer->targetDelay;
+    outStatistics->currentDelay = buffer->currentDelay;
+}
@@ -0,0 +1,141 @@
+//
+//  AEJitterBuffer.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "AEMixerCore.h"
+
+/*!
+ * @enum AEJitterBufferConcealment
+ *  How to fill gaps left by packets that haven't arrived in time
+ *
+ * @var AEJitterBufferConcealRepeat
+ *  Continue the last audio played, by playing it back and forth, fading out over a few
+ *  tens of milliseconds. Short gaps are barely audible.
+ *
+ * @var AEJitterBufferConcealSilence
+ *  Fade the last audio played out quickly, then play silence
+ */
+typedef enum {
+    AEJitterBufferConcealRepeat,
+    AEJitterBufferConcealSilence
+} AEJitterBufferConcealment;
+
+/*!
+ * Jitter buffer statistics
+ */
+typedef struct {
+    uint64_t packetsReceived;   //!< Packets put into the buffer
+    uint64_t packetsLate;       //!< Packets that arrived after their time to play, and were discarded
+    uint64_t packetsLost;       //!< Estimated packets never received in time, from the gaps concealed
+    uint64_t packetsDropped;    //!< Packets discarded because the buffer was full
+    uint64_t framesConcealed;   //!< Frames of audio made up to fill gaps
+    double   jitter;            //!< Interarrival jitter, in seconds, as defined by RFC 3550
+    double   targetDelay;       //!< The depth the buffer is aiming for, in seconds
+    double   currentDelay;      //!< The audio buffered ahead of the playhead, in seconds
+} AEJitterBufferStatistics;
+
+/*!
+ * Jitter buffer
+ *
+ *  Holds audio packets from a network source, which may arrive in bursts and out of order,
+ *  and plays them out in timestamp order, at a steady rate.
+ *
+ *  The buffer measures how late each packet arrives relative to the earliest recent one,
+ *  and holds back enough audio to cover the 95th percentile of that delay. As network
+ *  conditions change, it closes up or opens out to the new depth, with a short crossfade.
+ *  Packets that arrive after their time to play are discarded, and gaps are concealed
+ *  rather than waited for.
+ *
+ *  Packets are put from one thread and audio got from another, without locks: both sides
+ *  are safe to use on realtime threads.
+ */
+typedef struct AEJitterBuffer AEJitterBuffer;
+
+/*!
+ * Create a jitter buffer
+ *
+ * @param channels         Number of channels
+ * @param sampleRate       Sample rate
+ * @param maxPacketFrames  The largest packet expected; larger packets are split
+ * @param packetCapacity   Number of packets that can be held
+ * @return The jitter buffer, or NULL on allocation failure
+ */
+AEJitterBuffer *AEJitterBufferNew(uint32_t channels, double sampleRate, uint32_t maxPacketFrames, uint32_t packetCapacity);
+
+/*!
+ * Free a jitter buffer
+ */
+void AEJitterBufferFree(AEJitterBuffer *buffer);
+
+/*!
+ * Set how gaps are concealed
+ *
+ *  Takes effect from the next gap. Default is AEJitterBufferConcealRepeat.
+ */
+void AEJitterBufferSetConcealment(AEJitterBuffer *buffer, AEJitterBufferConcealment concealment);
+
+/*!
+ * Put a packet into the buffer
+ *
+ *  Use from the producer thread only.
+ *
+ * @param buffer       The jitter buffer
+ * @param format       The format of the audio
+ * @param audio        The audio: one buffer if the format is interleaved, else one per channel
+ * @param frames       Number of frames
+ * @param sampleTime   The position of the packet's first frame in the source's timeline
+ * @param arrivalTime  When the packet arrived, in seconds, on a clock shared with the consumer
+ * @return false if the buffer was full, and some or all of the packet was dropped
+ */
+bool AEJitterBufferPut(AEJitterBuffer *buffer, const AEMixerCoreFormat *format, const void * const *audio,
+                       uint32_t frames, double sampleTime, double arrivalTime);
+
+/*!
+ * Get audio from the buffer
+ *
+ *  Use from the consumer thread only. Until enough audio is buffered to cover the target
+ *  delay, this plays silence.
+ *
+ * @param buffer  The jitter buffer
+ * @param output  One float buffer per channel
+ * @param frames  Number of frames
+ */
+void AEJitterBufferGet(AEJitterBuffer *buffer, float * const *output, uint32_t frames);
+
+/*!
+ * Get statistics
+ *
+ *  Safe to use from any thread, although values may be slightly out of step with each other.
+ */
+void AEJitterBufferGetStatistics(const AEJitterBuffer *buffer, AEJitterBufferStatistics *outStatistics);
+
+#ifdef __cplusplus
+}
+#endif
@@ -29,6 +29,7 @@ extern "C" {
 
 #import <Foundation/Foundation.h>
 #import <AudioToolbox/AudioToolbox.h>
+#import "AEJitterBuffer.h"
 
 /*!
  * A source identifier, for use with [AEMixerBufferEnqueue](@ref AEMixerBuffer::AEMixerBufferEnqueue).
@@ -91,6 +92,9 @@ typedef UInt32 (*AEMixerBufferSourcePeekCallback) (AEMixerBufferSource  source,
  *
  *  Then, call @link AEMixerBufferDequeue @endlink to consume mixed and synchronised audio
  *  ready for playback, recording, etc.
+ *
+ *  Up to 4096 sources can be mixed at once. Looking up a source costs the same however many
+ *  there are, and dequeuing only visits sources that are currently registered.
  */
 @interface AEMixerBuffer : NSObject
 
@@ -108,14 +112,13 @@ typedef UInt32 (*AEMixerBufferSourcePeekCallback) (AEMixerBufferSource  source,
  *  may use any identifier you like - pointers, numbers, etc (just cast to AEMixerBufferSource).
  *
  *  When you enqueue audio from a new source (that is, the `source` value is one that hasn't been
- *  seen before, this class will automatically reconfigure itself to start mixing the new source.
- *  However, this will happen at some point in the near future, not immediately, so one or two buffers
- *  may be lost. If this is a problem, then call this function first on the main thread, for each source,
- *  with a NULL audio buffer, and a lengthInFrames value of 0.
+ *  seen before), this class takes a ready-prepared source from a pool and starts mixing it from the
+ *  next dequeue, without locking or allocating memory, so no audio is lost. The pool is topped up in
+ *  the background; if many new sources arrive at once faster than that, audio from the surplus is
+ *  dropped until it catches up.
  *
  *  This function can safely be used in a different thread from the dequeue function. It can also be used
- *  in a different thread from other calls to enqueue, given two conditions: No two threads enqueue the 
- *  same source, and no two threads call enqueue for a new source simultaneously.
+ *  in a different thread from other calls to enqueue, as long as no two threads enqueue the same source.
  *
  * @param mixerBuffer    The mixer buffer.
  * @param source         The audio source. This can be anything you like, as long as it is not NULL, and is unique to each source.
@@ -217,6 +220,11 @@ void AEMixerBufferMarkSourceIdle(AEMixerBuffer *mixerBuffer, AEMixerBufferSource
 /*!
  * Set a different AudioStreamBasicDescription for a source
  *
+ *  The format must be native-endian 16 or 32-bit integer (including 8.24 fixed point), or
+ *  32-bit float, linear PCM. Sources at a different sample rate from the client format are
+ *  resampled, with drift compensation (see
+ *  @link setDriftCompensationEnabled:forSource: setDriftCompensationEnabled:forSource: @endlink).
+ *
  *  Important: Do not change this property while using enqueue/dequeue.
  *  You must stop enqueuing or dequeuing audio first.
  */
@@ -224,6 +232,8 @@ void AEMixerBufferMarkSourceIdle(AEMixerBuffer *mixerBuffer, AEMixerBufferSource
 
 /*!
  * Set volume for source
+ *
+ *  Changes ramp smoothly over the next buffer dequeued.
  */
 - (void)setVolume:(float)volume forSource:(AEMixerBufferSource)source;
 
@@ -234,6 +244,8 @@ void AEMixerBufferMarkSourceIdle(AEMixerBuffer *mixerBuffer, AEMixerBufferSource
 
 /*!
  * Set pan for source
+ *
+ *  Changes ramp smoothly over the next buffer dequeued.
  */
 - (void)setPan:(float)pan forSource:(AEMixerBufferSource)source;
 
@@ -242,6 +254,80 @@ void AEMixerBufferMarkSourceIdle(AEMixerBuffer *mixerBuffer, AEMixerBufferSource
  */
 - (float)panForSource:(AEMixerBufferSource)source;
 
+/*!
+ * Enable clock drift compensation for a source
+ *
+ *  Audio from a separate device, such as a USB interface or a network stream, runs on its own
+ *  clock, which drifts from the client's by up to a few hundred parts per million. Normally
+ *  the mixer keeps such sources in sync by skipping audio, which is audible.
+ *
+ *  With drift compensation enabled, the source is instead buffered by
+ *  @link driftCompensationLatency @endlink and played through a resampler, whose rate is
+ *  continuously adjusted to hold that latency steady. The source no longer limits the
+ *  number of frames available, and it's never skipped: if it runs dry, it plays silence
+ *  until it has refilled.
+ *
+ *  The latency is measured from the source's timestamps. Enqueued audio without host
+ *  timestamps is stamped with its arrival time; sources with a peek callback should
+ *  provide timestamps, as counting buffered frames alone gives a far less steady estimate.
+ *
+ *  Sources at a different sample rate from the client format are always compensated.
+ *
+ * @param enabled           Whether to compensate for drift
+ * @param source            The audio source
+ */
+- (void)setDriftCompensationEnabled:(BOOL)enabled forSource:(AEMixerBufferSource)source;
+
+/*!
+ * Get whether clock drift compensation is active for a source
+ */
+- (BOOL)driftCompensationEnabledForSource:(AEMixerBufferSource)source;
+
+/*!
+ * Get the measured clock drift of a source
+ *
+ * @param source            The audio source
+ * @return The drift, in parts per million: positive if the source's clock runs fast
+ *      relative to the client's. Zero if the source isn't drift-compensated.
+ */
+- (double)clockDriftForSource:(AEMixerBufferSource)source;
+
+/*!
+ * Enable jitter buffer mode for a source
+ *
+ *  For sources whose audio arrives over a network, in packets that may be delayed by varying
+ *  amounts, arrive in bursts, come out of order, or not come at all. Instead of mixing the
+ *  source by timestamp and waiting on it when it's empty, the mixer places each packet
+ *  enqueued by its timestamp, and plays the source out at a steady rate, after a delay that
+ *  adapts to cover the 95th percentile of recent packet delays. Packets that arrive too late
+ *  are discarded, and gaps are concealed (see @link jitterConcealment @endlink), so the
+ *  source never holds up the others.
+ *
+ *  Packets are placed by the timestamp's sample time if valid, otherwise by its host time.
+ *  Enable this before audio starts arriving for the source. It's only available for sources
+ *  that enqueue audio, at the client sample rate, and takes the place of drift compensation:
+ *  the buffer closes up or opens out as the delay changes, which also absorbs slow drift.
+ *
+ * @param enabled           Whether to use a jitter buffer
+ * @param source            The audio source
+ */
+- (void)setJitterBufferEnabled:(BOOL)enabled forSource:(AEMixerBufferSource)source;
+
+/*!
+ * Get whether jitter buffer mode is active for a source
+ */
+- (BOOL)jitterBufferEnabledForSource:(AEMixerBufferSource)source;
+
+/*!
+ * Get jitter buffer statistics for a source
+ *
+ *  Packet counts, the measured jitter, and the target and current buffering delay.
+ *
+ * @param source            The audio source
+ * @return The statistics; all zero if the source isn't in jitter buffer mode
+ */
+- (AEJitterBufferStatistics)jitterStatisticsForSource:(AEMixerBufferSource)source;
+
 /*!
  * Force the mixer to unregister a source
  *
@@ -292,6 +378,25 @@ void AEMixerBufferMarkSourceIdle(AEMixerBuffer *mixerBuffer, AEMixerBufferSource
  */
 @property (nonatomic, assign) BOOL assumeInfiniteSources;
 
+/*!
+ * Latency of drift-compensated sources
+ *
+ *  How much audio to buffer for sources with drift compensation enabled, before they
+ *  start playing. Larger values tolerate more irregular delivery. Changes take effect
+ *  when a source next starts, or recovers from running dry.
+ *
+ *  Default is 0.03 seconds.
+ */
+@property (nonatomic, assign) NSTimeInterval driftCompensationLatency;
+
+/*!
+ * How jitter-buffered sources fill gaps left by missing packets
+ *
+ *  Applies to all sources in jitter buffer mode.
+ *  Default is AEJitterBufferConcealRepeat.
+ */
+@property (nonatomic, assign) AEJitterBufferConcealment jitterConcealment;
+
 /*!
  * Debug level
  */
@@ -24,12 +24,11 @@
 //
 
 #import "AEMixerBuffer.h"
+#import "AEMixerCore.h"
 #import "TPCircularBuffer.h"
 #import "TPCircularBuffer+AudioBufferList.h"
-#import "AEFloatConverter.h"
 #import "AEUtilities.h"
 #import <libkern/OSAtomic.h>
-#import <Accelerate/Accelerate.h>
 #import <pthread.h>
 
 #ifdef DEBUG
@@ -38,7 +37,7 @@
 #define dprintf(THIS, n, __FORMAT__, ...)
 #endif
 
-typedef struct {
+typedef struct source_t {
     AEMixerBufferSource                     source;
     AEMixerBufferSourcePeekCallback         peekCallback;
     AEMixerBufferSourceRenderCallback       renderCallback;
@@ -48,286 +47,514 @@ typedef struct {
     BOOL                                    synced;
     UInt32                                  consumedFramesInCurrentTimeSlice;
     AudioStreamBasicDescription             audioDescription;
-    void                                   *floatConverter;
+    AEMixerCoreFormat                       mixFormat;
+    BOOL                                    hasMixFormat;
     float                                   volume;
     float                                   pan;
+    float                                   mixGains[AEMixerCoreMaximumChannels];
+    BOOL                                    hasMixGains;
     BOOL                                    started;
     AudioBufferList                        *skipFadeBuffer;
-    BOOL                                    unregistering;
+    int                                     slot;
+    BOOL                                    driftCompensation;
+    AEMixerCoreResampler                   *resampler;
+    AEMixerCoreDriftTracker                 driftTracker;
+    BOOL                                    primed;
+    BOOL                                    jitterBufferMode;
+    AEJitterBuffer                         *jitterBuffer;
+    double                                  nextJitterSampleTime;
+    struct source_t                        *nextPending;
+    volatile int32_t                        pending;
 } source_t;
 
-typedef void(*AEMixerBufferAction)(AEMixerBuffer *buffer, void *userInfo);
+// Sources live in fixed-size chunks that are never moved or freed while the mixer exists, so a
+// source's record stays valid for any thread that found it, even as sources come and go
+#define kSourceChunkSize 64
+#define kMaxSourceChunks 64
+
+// Index from source ID to source record, for lookups on the enqueue thread. It's open-addressed,
+// and entries are never removed: once a record is unregistered or reused by another source, it no
+// longer matches the entry's ID, and the entry is free for reuse. Any thread can add to it, claiming
+// entries with an atomic compare-and-swap. When it's getting full, the maintenance thread replaces it
+// with a larger one, and retires the old one.
+typedef struct {
+    AEMixerBufferSource volatile    id;
+    source_t * volatile             source;
+} sourceIndexEntry_t;
+
+typedef struct {
+    uint32_t                mask;
+    volatile int32_t        used;
+    sourceIndexEntry_t      entries[];
+} sourceIndex_t;
+
+typedef struct {
+    source_t       *source;
+    uint64_t        endHostTime;
+    UInt32          frameCount;
+    AudioTimeStamp  timestamp;
+} peekEntry_t;
 
+// The sources being mixed, packed densely. The main thread builds a new list whenever sources are
+// removed or reconfigured, and publishes it with an atomic pointer swap. Sources activated since are
+// appended by the consumer thread itself, into the spare capacity.
 typedef struct {
-    AEMixerBufferAction action;
-    void *userInfo;
-} action_t;
+    int             count;
+    int             capacity;
+    peekEntry_t    *peekEntries;    // Scratch space for the consumer thread, one entry per source
+    source_t       *sources[];
+} sourceList_t;
+
+// Memory that readers may still be using, waiting to be freed by the maintenance thread
+typedef struct retired_t {
+    void               *memory;
+    struct retired_t   *next;
+} retired_t;
 
-#define kMaxSources 30
 static const NSTimeInterval kResyncTimestampThreshold       = 0.002;
 static const NSTimeInterval kSourceTimestampIdleThreshold   = 1.0;
-static const UInt32 kConversionBufferLength                 = 16384;
 static const UInt32 kScratchBufferBytesPerChannel           = 16384;
 static const UInt32 kSourceBufferFrames                     = 8192;
-static const int kActionBufferSize                          = 2048;
-static const NSTimeInterval kActionMainThreadPollDuration   = 0.2;
+static const UInt32 kMixBufferFrames                        = 8192;
+static const NSTimeInterval kMaintenanceInterval            = 0.01;
 static const int kMinimumFrameCount                         = 64;
 static const UInt32 kMaxMicrofadeDuration                   = 512;
+static const UInt32 kResamplerInputFrames                   = 4096;
+static const NSTimeInterval kDefaultDriftLatency            = 0.03;
+static const uint32_t kMinSourceIndexSize                   = 256;
+static const int kSourcePoolSize                            = 8;
+static const int kSourceListSpareCapacity                   = 16;
+static const UInt32 kJitterBufferPacketFrames               = 1024;
+static const UInt32 kJitterBufferPackets                    = 128;
+
+@interface AEMixerBufferMaintenanceThread : NSThread
+- (id)initWithMixerBuffer:(AEMixerBuffer*)mixerBuffer;
+@end
 
 @interface AEMixerBuffer () {
     AudioStreamBasicDescription _clientFormat;
-    AudioStreamBasicDescription _mixerOutputFormat;
-    source_t                    _table[kMaxSources];
+    AEMixerCoreFormat           _clientMixFormat;
+    BOOL                        _hasClientMixFormat;
+    source_t                   *_sourceChunks[kMaxSourceChunks];
+    volatile uint64_t           _registeredSources[kMaxSourceChunks];
+    volatile uint64_t           _liveSources[kMaxSourceChunks];
+    volatile uint64_t           _pooledSources[kMaxSourceChunks];
+    uint64_t                    _allocatedSources[kMaxSourceChunks];
+    source_t * volatile         _pendingSources;
+    sourceIndex_t * volatile    _sourceIndex;
+    sourceList_t * volatile     _sourceList;
+    volatile BOOL               _sourceListFull;
+    volatile BOOL               _sourceListStale;
+    volatile int32_t            _epoch;
+    volatile int32_t            _epochReaders[2];
+    int32_t                     _consumerEpoch;
+    retired_t * volatile        _retired;
+    pthread_mutex_t             _epochMutex;
+    pthread_mutex_t             _maintenanceMutex;
+    AEMixerBufferMaintenanceThread *_maintenanceThread;
     AudioTimeStamp              _currentSliceTimestamp;
     UInt32                      _sampleTime;
     UInt32                      _currentSliceFrameCount;
-    AUGraph                     _graph;
-    AUNode                      _mixerNode;
-    AudioUnit                   _mixerUnit;
-    pthread_mutex_t             _graphMutex;
-    AudioConverterRef           _audioConverter;
-    TPCircularBuffer            _audioConverterBuffer;
-    BOOL                        _audioConverterHasBuffer;
     uint8_t                    *_scratchBuffer;
-    BOOL                        _graphReady;
+    uint8_t                    *_sourceScratchBuffer;
+    float                      **_mixBuffers;
+    float                      **_sourceMixBuffers;
     BOOL                        _automaticSingleSourceDequeueing;
-    TPCircularBuffer            _mainThreadActionBuffer;
-    NSTimer                    *_mainThreadActionPollTimer;
     float                      **_microfadeBuffer;
     int                          _configuredChannels;
+    AEJitterBufferConcealment    _jitterConcealment;
 }
 
-static UInt32 _AEMixerBufferPeek(AEMixerBuffer *THIS, AudioTimeStamp *outNextTimestamp, BOOL respectInfiniteSourceFlag);
-static inline source_t *sourceWithID(AEMixerBuffer *THIS, AEMixerBufferSource sourceID, int* index);
-static inline void unregisterSources(AEMixerBuffer *THIS);
+static UInt32 _AEMixerBufferPeek(AEMixerBuffer *THIS, sourceList_t *list, AudioTimeStamp *outNextTimestamp, BOOL respectInfiniteSourceFlag);
+static void dequeueSource(AEMixerBuffer *THIS, sourceList_t *list, source_t *source, AudioBufferList *bufferList, UInt32 *ioLengthInFrames, AudioTimeStamp *outTimestamp);
+static inline source_t *sourceWithID(AEMixerBuffer *THIS, AEMixerBufferSource sourceID);
+static source_t *nextSource(AEMixerBuffer *THIS, const volatile uint64_t *bitmap, int *ioSlot);
+static source_t *takeSourceFromPool(AEMixerBuffer *THIS);
+static void returnSourceToPool(AEMixerBuffer *THIS, source_t *source);
+static BOOL activateSource(AEMixerBuffer *THIS, source_t *source, AEMixerBufferSource sourceID);
+static void releaseSource(AEMixerBuffer *THIS, source_t *source);
+static void setSourceLive(AEMixerBuffer *THIS, source_t *source, BOOL live);
+static void pushPendingSource(AEMixerBuffer *THIS, source_t *source);
+static source_t *takePendingSources(AEMixerBuffer *THIS);
+static void fillSourcePool(AEMixerBuffer *THIS);
+static void drainSourcePool(AEMixerBuffer *THIS);
+static void growSourceIndexIfNeeded(AEMixerBuffer *THIS);
+static inline int32_t enterEpoch(AEMixerBuffer *THIS);
+static inline void leaveEpoch(AEMixerBuffer *THIS, int32_t epoch);
+static void retireMemory(AEMixerBuffer *THIS, void *memory);
+static void waitForReaders(AEMixerBuffer *THIS);
+static void reclaimRetiredMemory(AEMixerBuffer *THIS);
 static void prepareNewSource(AEMixerBuffer *THIS, AEMixerBufferSource sourceID);
 static void prepareSkipFadeBufferForSource(AEMixerBuffer *THIS, source_t* source);
-- (void)refreshMixingGraph;
-
-@property (nonatomic, strong) AEFloatConverter *floatConverter;
-@end
-
-@interface AEMixerBufferPollProxy : NSObject {
-    __weak AEMixerBuffer *_mixerBuffer;
-}
-- (id)initWithMixerBuffer:(AEMixerBuffer*)mixerBuffer;
+static void freeSkipFadeBufferForSource(source_t* source);
+static float **allocateChannelBuffers(int channels, UInt32 frames);
+static void freeChannelBuffers(float **buffers, int channels);
+static void resampleSource(AEMixerBuffer *THIS, source_t *source, const AEMixerCoreFormat *format, const AudioStreamBasicDescription *audioDescription, float * const *output, UInt32 frames);
+static void configurePlayoutForSource(AEMixerBuffer *THIS, source_t *source);
+- (void)publishSourceList;
+- (void)performMaintenance;
 @end
 
 @implementation AEMixerBuffer
 @synthesize sourceIdleThreshold = _sourceIdleThreshold;
 @synthesize assumeInfiniteSources = _assumeInfiniteSources;
-@synthesize floatConverter = _floatConverter;
 @synthesize debugLevel = _debugLevel;
+@synthesize driftCompensationLatency = _driftCompensationLatency;
+@synthesize jitterConcealment = _jitterConcealment;
 
 - (id)initWithClientFormat:(AudioStreamBasicDescription)clientFormat {
     if ( !(self = [super init]) ) return nil;
     
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&_maintenanceMutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    pthread_mutex_init(&_epochMutex, NULL);
+    
     self.clientFormat = clientFormat;
     
     _sourceIdleThreshold = kSourceTimestampIdleThreshold;
-    TPCircularBufferInit(&_mainThreadActionBuffer, kActionBufferSize);
-    _mainThreadActionPollTimer = [NSTimer scheduledTimerWithTimeInterval:kActionMainThreadPollDuration
-                                                                  target:[[AEMixerBufferPollProxy alloc] initWithMixerBuffer:self]
-                                                                selector:@selector(pollActionBuffer) 
-                                                                userInfo:nil
-                                                                 repeats:YES];
-    
-    pthread_mutex_init(&_graphMutex, NULL);
-        
+    _driftCompensationLatency = kDefaultDriftLatency;
+    
+    // Start with an empty source list and index, and some sources ready to go
+    [self publishSourceList];
+    growSourceIndexIfNeeded(self);
+    fillSourcePool(self);
+    
+    _maintenanceThread = [[AEMixerBufferMaintenanceThread alloc] initWithMixerBuffer:self];
+    [_maintenanceThread start];
+    
     return self;
 }
 
 - (void)dealloc {
-    pthread_mutex_destroy(&_graphMutex);
-    
-    [_mainThreadActionPollTimer invalidate];
-    TPCircularBufferCleanup(&_mainThreadActionBuffer);
-    
-    if ( _graph ) {
-        AECheckOSStatus(AUGraphClose(_graph), "AUGraphClose");
-        AECheckOSStatus(DisposeAUGraph(_graph), "AUGraphClose");
-    }
-    
-    if ( _audioConverter ) {
-        AECheckOSStatus(AudioConverterDispose(_audioConverter), "AudioConverterDispose");
-        _audioConverter = NULL;
-        TPCircularBufferCleanup(&_audioConverterBuffer);
+    if ( _maintenanceThread ) {
+        [_maintenanceThread cancel];
+        if ( [NSThread currentThread] != _maintenanceThread ) {
+            while ( [_maintenanceThread isExecuting] ) {
+                [NSThread sleepForTimeInterval:0.001];
+            }
+        }
     }
     
+    free(_sourceList);
     
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( _table[i].source ) {
-            if ( !_table[i].renderCallback ) {
-                TPCircularBufferCleanup(&_table[i].buffer);
-            }
-            if ( _table[i].skipFadeBuffer ) {
-                for ( int j=0; j<_table[i].skipFadeBuffer->mNumberBuffers; j++ ) {
-                    free(_table[i].skipFadeBuffer->mBuffers[j].mData);
-                }
-                free(_table[i].skipFadeBuffer);
-            }
-            if ( _table[i].floatConverter ) {
-                CFBridgingRelease(_table[i].floatConverter);
-            }
+    source_t *source;
+    for ( int slot=0; (source = nextSource(self, _registeredSources, &slot)); slot++ ) {
+        if ( !source->renderCallback ) {
+            TPCircularBufferCleanup(&source->buffer);
         }
+        freeSkipFadeBufferForSource(source);
+        AEMixerCoreResamplerFree(source->resampler);
+        AEJitterBufferFree(source->jitterBuffer);
+    }
+    drainSourcePool(self);
+    for ( int i=0; i<kMaxSourceChunks; i++ ) {
+        free(_sourceChunks[i]);
     }
     
-    free(_scratchBuffer);
-    
-    for ( int i=0; i<_configuredChannels * 2; i++ ) {
-        free(_microfadeBuffer[i]);
+    free(_sourceIndex);
+    while ( _retired ) {
+        retired_t *retired = _retired;
+        _retired = retired->next;
+        free(retired->memory);
+        free(retired);
     }
-    free(_microfadeBuffer);
+    pthread_mutex_destroy(&_maintenanceMutex);
+    pthread_mutex_destroy(&_epochMutex);
     
+    free(_scratchBuffer);
+    free(_sourceScratchBuffer);
+    freeChannelBuffers(_mixBuffers, _configuredChannels);
+    freeChannelBuffers(_sourceMixBuffers, _configuredChannels);
+    freeChannelBuffers(_microfadeBuffer, _configuredChannels * 2);
 }
 
 -(void)setClientFormat:(AudioStreamBasicDescription)clientFormat {
     if ( memcmp(&_clientFormat, &clientFormat, sizeof(AudioStreamBasicDescription)) == 0 ) return;
     
+    pthread_mutex_lock(&_maintenanceMutex);
+    
     _clientFormat = clientFormat;
     
-    [self respondToChannelCountChange];
+    _hasClientMixFormat = AEMixerCoreFormatForAudioDescription(&_clientFormat, &_clientMixFormat);
+    if ( !_hasClientMixFormat ) {
+        NSLog(@"AEMixerBuffer: Unsupported client format; only native-endian 16/32-bit integer and 32-bit float linear PCM can be mixed");
+    }
     
-    self.floatConverter = [[AEFloatConverter alloc] initWithSourceFormat:_clientFormat];
+    [self respondToChannelCountChange];
     
-    for ( int i=0; i<kMaxSources; i++ ) {
-        source_t *source = &_table[i];
-        if ( source->source && !source->audioDescription.mSampleRate ) {
-            if ( source->skipFadeBuffer ) {
-                for ( int j=0; j<source->skipFadeBuffer->mNumberBuffers; j++ ) {
-                    free(source->skipFadeBuffer->mBuffers[j].mData);
-                }
-                free(source->skipFadeBuffer);
-            }
-            
+    source_t *source;
+    for ( int slot=0; (source = nextSource(self, _registeredSources, &slot)); slot++ ) {
+        if ( !source->audioDescription.mSampleRate ) {
+            freeSkipFadeBufferForSource(source);
             prepareSkipFadeBufferForSource(self, source);
             
             if ( !source->renderCallback ) {
                 TPCircularBufferClear(&source->buffer);
             }
         }
+        configurePlayoutForSource(self, source);
     }
     
-    if ( _audioConverter ) {
-        AECheckOSStatus(AudioConverterDispose(_audioConverter), "AudioConverterDispose");
-        _audioConverter = NULL;
-        _audioConverterHasBuffer = NO;
-        TPCircularBufferCleanup(&_audioConverterBuffer);
-    }
-    
-    if ( _mixerUnit ) {
-        // Try to set mixer's output stream format to our client format
-        OSStatus result = AudioUnitSetProperty(_mixerUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Output, 0, &_clientFormat, sizeof(_clientFormat));
-        
-        if ( result == kAudioUnitErr_PropertyNotWritable ) {
-            pthread_mutex_lock(&_graphMutex);
-            // Need to recreate the mixer. Dispose it here, it'll be recreated when we refresh below
-            AECheckOSStatus(AUGraphClose(_graph), "AUGraphClose");
-            AECheckOSStatus(DisposeAUGraph(_graph), "AUGraphClose");
-            _graph = NULL;
-            _graphReady = NO;
-            pthread_mutex_unlock(&_graphMutex);
-            
-        } else if ( result == kAudioUnitErr_FormatNotSupported ) {
-            // The mixer only supports a subset of formats. If it doesn't support this one, then we'll convert manually
-            
-            // Get the existing format, and apply just the sample rate
-            UInt32 size = sizeof(_mixerOutputFormat);
-            AECheckOSStatus(AudioUnitGetProperty(_mixerUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Output, 0, &_mixerOutputFormat, &size),
-                        "AudioUnitGetProperty(kAudioUnitProperty_StreamFormat)");
-            _mixerOutputFormat.mSampleRate = _clientFormat.mSampleRate;
-            
-            AECheckOSStatus(AudioUnitSetProperty(_mixerUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Output, 0, &_mixerOutputFormat, sizeof(_mixerOutputFormat)),
-                        "AudioUnitSetProperty(kAudioUnitProperty_StreamFormat");
-            
-            
-            
-            // Create the audio converter
-            AECheckOSStatus(AudioConverterNew(&_mixerOutputFormat, &_clientFormat, &_audioConverter), "AudioConverterNew");
-            TPCircularBufferInit(&_audioConverterBuffer, kConversionBufferLength);
-        } else {
-            AECheckOSStatus(result, "AudioUnitSetProperty(kAudioUnitProperty_StreamFormat)");
-        }
-    }
+    // Pooled sources are prepared for the client format, so replace them
+    drainSourcePool(self);
+    fillSourcePool(self);
     
-    [self refreshMixingGraph];
+    pthread_mutex_unlock(&_maintenanceMutex);
 }
 
 void AEMixerBufferEnqueue(__unsafe_unretained AEMixerBuffer *THIS, AEMixerBufferSource sourceID, AudioBufferList *audio, UInt32 lengthInFrames, const AudioTimeStamp *timestamp) {
     dprintf(THIS, 1, "Enqueue %u frames at time %0.5lfs for source %p", (unsigned int)lengthInFrames, timestamp ? AESecondsFromHostTicks(timestamp->mHostTime) : 0, sourceID);
-    source_t *source = sourceWithID(THIS, sourceID, NULL);
+    
+    // Stay in the current epoch while we use the source, so it can't be unregistered from under us
+    int32_t epoch = enterEpoch(THIS);
+    
+    source_t *source = sourceWithID(THIS, sourceID);
     if ( !source ) {
-        if ( pthread_main_np() != 0 ) {
-            dprintf(THIS, 3, "Preparing new source %p\n", sourceID);
-            prepareNewSource(THIS, sourceID);
-            source = sourceWithID(THIS, sourceID, NULL);
-        } else {
-            dprintf(THIS, 3, "Enqueueing prepare for new source %p", sourceID);
-            action_t action = {.action = prepareNewSource, .userInfo = sourceID};
-            TPCircularBufferProduceBytes(&THIS->_mainThreadActionBuffer, &action, sizeof(action));
+        // Take a ready-prepared source from the pool: the next dequeue will mix it
+        dprintf(THIS, 3, "Activating new source %p", sourceID);
+        source = takeSourceFromPool(THIS);
+        if ( !source || !activateSource(THIS, source, sourceID) ) {
+            dprintf(THIS, 0, "No source available for %p", sourceID);
+            if ( source ) returnSourceToPool(THIS, source);
+            leaveEpoch(THIS, epoch);
             return;
         }
     }
     
-    if ( !audio ) return;
+    if ( !audio ) {
+        leaveEpoch(THIS, epoch);
+        return;
+    }
     
     assert(!source->renderCallback);
-
+    
+    AEJitterBuffer *jitterBuffer = source->jitterBuffer;
+    if ( jitterBuffer ) {
+        // Packets go into the jitter buffer in timeline order, wherever they fall. Place them by sample time
+        // if we have it, otherwise by host time, otherwise straight after the last packet.
+        double sampleRate = source->audioDescription.mSampleRate ? source->audioDescription.mSampleRate : THIS->_clientFormat.mSampleRate;
+        double sampleTime = timestamp && (timestamp->mFlags & kAudioTimeStampSampleTimeValid) ? timestamp->mSampleTime
+                          : timestamp && (timestamp->mFlags & kAudioTimeStampHostTimeValid) ? AESecondsFromHostTicks(timestamp->mHostTime) * sampleRate
+                          : source->nextJitterSampleTime;
+        source->nextJitterSampleTime = sampleTime + lengthInFrames;
+        
+        const void *data[AEMixerCoreMaximumChannels];
+        for ( int i=0; i<audio->mNumberBuffers && i<AEMixerCoreMaximumChannels; i++ ) {
+            data[i] = audio->mBuffers[i].mData;
+        }
+        const AEMixerCoreFormat *format = source->audioDescription.mSampleRate ? &source->mixFormat : &THIS->_clientMixFormat;
+        if ( !AEJitterBufferPut(jitterBuffer, format, data, lengthInFrames, sampleTime, AESecondsFromHostTicks(AECurrentTimeInHostTicks())) ) {
+            dprintf(THIS, 0, "Out of jitter buffer space");
+        }
+        leaveEpoch(THIS, epoch);
+        return;
+    }
+    
     AudioStreamBasicDescription audioDescription = source->audioDescription.mSampleRate ? source->audioDescription : THIS->_clientFormat;
+    
+    AudioTimeStamp arrivalTimestamp;
+    if ( source->resampler && !(timestamp && (timestamp->mFlags & kAudioTimeStampHostTimeValid)) ) {
+        // Resampled sources measure their drift from timestamps, as counting frames is too coarse. Stamp
+        // untimed audio with the time it arrived, less its duration: the time its first frame would have
+        // been captured, were the source's clock running steadily.
+        memset(&arrivalTimestamp, 0, sizeof(arrivalTimestamp));
+        if ( timestamp ) arrivalTimestamp = *timestamp;
+        arrivalTimestamp.mHostTime = AECurrentTimeInHostTicks() - AEHostTicksFromSeconds((double)lengthInFrames / audioDescription.mSampleRate);
+        arrivalTimestamp.mFlags |= kAudioTimeStampHostTimeValid;
+        timestamp = &arrivalTimestamp;
+    }
+    
     if ( !TPCircularBufferCopyAudioBufferList(&source->buffer, audio, timestamp, lengthInFrames, &audioDescription) ) {
         dprintf(THIS, 0, "Out of buffer space");
     }
+    
+    leaveEpoch(THIS, epoch);
 }
 
 - (void)setRenderCallback:(AEMixerBufferSourceRenderCallback)renderCallback peekCallback:(AEMixerBufferSourcePeekCallback)peekCallback userInfo:(void *)userInfo forSource:(AEMixerBufferSource)sourceID {
-    source_t *source = sourceWithID(self, sourceID, NULL);
+    source_t *source = sourceWithID(self, sourceID);
     
     if ( !source ) {
-        source = sourceWithID(self, NULL, NULL);
+        // Set up a pooled source with the callbacks before it's activated
+        fillSourcePool(self);
+        source = takeSourceFromPool(self);
         if ( !source ) return;
-        memset(source, 0, sizeof(source_t));
-        source->source = sourceID;
-        source->volume = 1.0;
-        source->pan = 0.0;
-        source->lastAudioTimestamp = AECurrentTimeInHostTicks();
-        prepareSkipFadeBufferForSource(self, source);
-        [self refreshMixingGraph];
-    } else {
         TPCircularBufferCleanup(&source->buffer);
+        source->renderCallback = renderCallback;
+        source->peekCallback = peekCallback;
+        source->callbackUserinfo = userInfo;
+        if ( !activateSource(self, source, sourceID) ) {
+            NSLog(@"AEMixerBuffer: Couldn't activate source %p", sourceID);
+            freeSkipFadeBufferForSource(source);
+            releaseSource(self, source);
+        }
+        return;
     }
     
+    // Take the source out of the mix while its buffer is replaced
+    setSourceLive(self, source, NO);
+    [self publishSourceList];
+    TPCircularBufferCleanup(&source->buffer);
+    
     source->renderCallback = renderCallback;
     source->peekCallback = peekCallback;
     source->callbackUserinfo = userInfo;
+    
+    setSourceLive(self, source, YES);
+    [self publishSourceList];
+}
+
+#pragma mark - Source list
+
+static void adoptPendingSources(__unsafe_unretained AEMixerBuffer *THIS, sourceList_t *list) {
+    // Take the sources activated since the list was built, and append those still live, if there's room
+    source_t *next;
+    for ( source_t *pending = takePendingSources(THIS); pending; pending = next ) {
+        next = pending->nextPending;
+        OSMemoryBarrier();
+        pending->pending = 0;
+        
+        if ( !(THIS->_liveSources[pending->slot / kSourceChunkSize] & (1ULL << (pending->slot % kSourceChunkSize))) ) continue;
+        
+        BOOL listed = NO;
+        for ( int i=0; i<list->count && !listed; i++ ) {
+            if ( list->sources[i] == pending ) listed = YES;
+        }
+        if ( listed ) continue;
+        
+        if ( list->count == list->capacity ) {
+            // The maintenance thread will publish a bigger list, with the source in it
+            THIS->_sourceListFull = YES;
+            continue;
+        }
+        
+        list->sources[list->count++] = pending;
+    }
 }
 
-struct fillComplexBufferInputProc_t { AudioBufferList *bufferList; UInt32 frames;  };
-static OSStatus fillComplexBufferInputProc(AudioConverterRef             inAudioConverter,
-                                           UInt32                        *ioNumberDataPackets,
-                                           AudioBufferList               *ioData,
-                                           AudioStreamPacketDescription  **outDataPacketDescription,
-                                           void                          *inUserData) {
-    struct fillComplexBufferInputProc_t *arg = inUserData;
-    for ( int i=0; i<ioData->mNumberBuffers; i++ ) {
-        ioData->mBuffers[i].mData = arg->bufferList->mBuffers[i].mData;
-        ioData->mBuffers[i].mDataByteSize = arg->bufferList->mBuffers[i].mDataByteSize;
+static void pruneSourceList(__unsafe_unretained AEMixerBuffer *THIS, sourceList_t *list) {
+    // Drop sources taken out of the mix from the list in place, as the main thread couldn't build a new one
+    THIS->_sourceListStale = NO;
+    OSMemoryBarrier();
+    int count = 0;
+    for ( int i=0; i<list->count; i++ ) {
+        source_t *source = list->sources[i];
+        if ( THIS->_liveSources[source->slot / kSourceChunkSize] & (1ULL << (source->slot % kSourceChunkSize)) ) {
+            list->sources[count++] = source;
+        }
     }
-    *ioNumberDataPackets = arg->frames;
-    return noErr;
+    list->count = count;
 }
 
-void AEMixerBufferDequeue(__unsafe_unretained AEMixerBuffer *THIS, AudioBufferList *bufferList, UInt32 *ioLengthInFrames, AudioTimeStamp *outTimestamp) {
-    dprintf(THIS, 1, "Dequeue %u frames", (unsigned int)*ioLengthInFrames);
+static inline sourceList_t *acquireSourceList(__unsafe_unretained AEMixerBuffer *THIS) {
+    // While we're in the epoch, the list and the sources in it won't be freed
+    THIS->_consumerEpoch = enterEpoch(THIS);
+    sourceList_t *list = THIS->_sourceList;
+    if ( list && THIS->_sourceListStale ) {
+        pruneSourceList(THIS, list);
+    }
+    if ( list && THIS->_pendingSources ) {
+        adoptPendingSources(THIS, list);
+    }
+    return list;
+}
+
+static inline void releaseSourceList(__unsafe_unretained AEMixerBuffer *THIS) {
+    leaveEpoch(THIS, THIS->_consumerEpoch);
+}
+
+static inline void clearTimeSlice(__unsafe_unretained AEMixerBuffer *THIS, sourceList_t *list) {
+    THIS->_currentSliceFrameCount = 0;
+    memset(&THIS->_currentSliceTimestamp, 0, sizeof(AudioTimeStamp));
+    for ( int i=0; list && i<list->count; i++ ) {
+        list->sources[i]->consumedFramesInCurrentTimeSlice = 0;
+    }
+}
+
+- (void)publishSourceList {
+    pthread_mutex_lock(&_maintenanceMutex);
     
-    unregisterSources(THIS);
+    int count = 0;
+    for ( int i=0; i<kMaxSourceChunks; i++ ) {
+        count += __builtin_popcountll(_liveSources[i]);
+    }
     
-    if ( !THIS->_graphReady ) {
-        *ioLengthInFrames = 0;
+    int capacity = count + kSourceListSpareCapacity;
+    sourceList_t *list = (sourceList_t*)calloc(1, sizeof(sourceList_t) + capacity * (sizeof(source_t*) + sizeof(peekEntry_t)));
+    if ( !list ) {
+        // Have the consumer thread bring its current list up to date instead: it drops the sources no longer
+        // live, and adopts those that are from the pending list, skipping any it already has
+        NSLog(@"AEMixerBuffer: Couldn't allocate source list; updating the current one in place");
+        _sourceListStale = YES;
+        source_t *source;
+        for ( int slot=0; (source = nextSource(self, _liveSources, &slot)); slot++ ) {
+            pushPendingSource(self, source);
+        }
+        pthread_mutex_unlock(&_maintenanceMutex);
+        waitForReaders(self);
         return;
     }
+    list->capacity = capacity;
+    list->peekEntries = (peekEntry_t*)&list->sources[capacity];
+    
+    // Sources activated so far will be in the new list, so the consumer thread needn't adopt them
+    source_t *next;
+    for ( source_t *pending = takePendingSources(self); pending; pending = next ) {
+        next = pending->nextPending;
+        OSMemoryBarrier();
+        pending->pending = 0;
+    }
+    _sourceListFull = NO;
+    
+    uint64_t listed[kMaxSourceChunks];
+    memset(listed, 0, sizeof(listed));
+    source_t *source;
+    for ( int slot=0; (source = nextSource(self, _liveSources, &slot)) && list->count < capacity; slot++ ) {
+        list->sources[list->count++] = source;
+        listed[slot / kSourceChunkSize] |= 1ULL << (slot % kSourceChunkSize);
+    }
+    
+    sourceList_t *oldList = _sourceList;
+    OSAtomicCompareAndSwapPtrBarrier(oldList, list, (void* volatile *)&_sourceList);
+    
+    pthread_mutex_unlock(&_maintenanceMutex);
+    
+    if ( oldList ) {
+        retireMemory(self, oldList);
+        
+        // Wait for the consumer thread to finish with the old list, so that it and any sources
+        // left out of the new one are no longer in use
+        waitForReaders(self);
+        
+        // Sources activated after we looked may have been adopted into the old list, rather than left pending
+        // for the new one. Now that the old list is out of use, hand any live source we missed back to the
+        // consumer thread; it skips those it already has. Hold the lock, so none is released meanwhile.
+        pthread_mutex_lock(&_maintenanceMutex);
+        for ( int chunk=0; chunk<kMaxSourceChunks; chunk++ ) {
+            uint64_t missing = _liveSources[chunk] & ~listed[chunk];
+            while ( missing ) {
+                int index = __builtin_ctzll(missing);
+                missing &= missing - 1;
+                pushPendingSource(self, &_sourceChunks[chunk][index]);
+            }
+        }
+        pthread_mutex_unlock(&_maintenanceMutex);
+    }
+}
+
+#pragma mark - Dequeue
+
+void AEMixerBufferDequeue(__unsafe_unretained AEMixerBuffer *THIS, AudioBufferList *bufferList, UInt32 *ioLengthInFrames, AudioTimeStamp *outTimestamp) {
+    dprintf(THIS, 1, "Dequeue %u frames", (unsigned int)*ioLengthInFrames);
     
-    if ( pthread_mutex_trylock(&THIS->_graphMutex) != 0 ) {
+    sourceList_t *list = acquireSourceList(THIS);
+    
+    if ( !list || list->count == 0 || !THIS->_hasClientMixFormat ) {
         *ioLengthInFrames = 0;
+        releaseSourceList(THIS);
         return;
     }
     
@@ -340,177 +567,169 @@ void AEMixerBufferDequeue(__unsafe_unretained AEMixerBuffer *THIS, AudioBufferLi
         }
     }
     
-    // Reset time slice
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( THIS->_table[i].source ) THIS->_table[i].consumedFramesInCurrentTimeSlice = 0;
-    }
-    
     // Determine how many frames are available globally
-    UInt32 sliceFrameCount = _AEMixerBufferPeek(THIS, &THIS->_currentSliceTimestamp, YES);
+    clearTimeSlice(THIS, list);
+    UInt32 sliceFrameCount = _AEMixerBufferPeek(THIS, list, &THIS->_currentSliceTimestamp, YES);
     THIS->_currentSliceFrameCount = sliceFrameCount;
     
     if ( bufferList ) {
         *ioLengthInFrames = MIN(*ioLengthInFrames, bufferList->mBuffers[0].mDataByteSize / THIS->_clientFormat.mBytesPerFrame);
     }
     
-    *ioLengthInFrames = MIN(*ioLengthInFrames, sliceFrameCount);
+    *ioLengthInFrames = MIN(*ioLengthInFrames, MIN(sliceFrameCount, kMixBufferFrames));
     
     if ( !bufferList ) {
         // Just consume frames
-        for ( int i=0; i<kMaxSources; i++ ) {
-            if ( THIS->_table[i].source ) {
-                AEMixerBufferDequeueSingleSource(THIS, THIS->_table[i].source, NULL, ioLengthInFrames, outTimestamp);
-            }
-        }
-        
-        // Reset time slice info
-        THIS->_currentSliceFrameCount = 0;
-        memset(&THIS->_currentSliceTimestamp, 0, sizeof(AudioTimeStamp));
-        for ( int i=0; i<kMaxSources; i++ ) {
-            if ( THIS->_table[i].source ) THIS->_table[i].consumedFramesInCurrentTimeSlice = 0;
+        for ( int i=0; i<list->count; i++ ) {
+            dequeueSource(THIS, list, list->sources[i], NULL, ioLengthInFrames, outTimestamp);
         }
         
-        pthread_mutex_unlock(&THIS->_graphMutex);
+        clearTimeSlice(THIS, list);
+        releaseSourceList(THIS);
         return;
     }
     
-    int numberOfSources = 0;
-    AEMixerBufferSource firstSource = NULL;
-    source_t *firstSourceEntry = NULL;
-    for ( int i=0; i<kMaxSources && numberOfSources < 2; i++ ) {
-        if ( THIS->_table[i].source ) {
-            if ( !firstSource ) {
-                firstSource = THIS->_table[i].source;
-                firstSourceEntry = &THIS->_table[i];
-            }
-            numberOfSources++;
-        }
-    }
-    
     if ( outTimestamp ) {
         *outTimestamp = THIS->_currentSliceTimestamp;
     }
     
-    if ( numberOfSources == 1 && (!firstSourceEntry->audioDescription.mSampleRate || memcmp(&firstSourceEntry->audioDescription, &THIS->_clientFormat, sizeof(AudioStreamBasicDescription)) == 0) ) {
-        // Just one source, with the same audio format - pull straight from it
-        AEMixerBufferDequeueSingleSource(THIS, firstSource, bufferList, ioLengthInFrames, NULL);
+    UInt32 frames = *ioLengthInFrames;
+    UInt32 outputChannels = THIS->_clientFormat.mChannelsPerFrame;
+    
+    if ( list->count == 1 && !list->sources[0]->resampler && !list->sources[0]->jitterBuffer
+            && (!list->sources[0]->audioDescription.mSampleRate
+                || memcmp(&list->sources[0]->audioDescription, &THIS->_clientFormat, sizeof(AudioStreamBasicDescription)) == 0) ) {
+        // Just one source, with the same audio format - if it's at unity gain, pull straight from it
+        source_t *source = list->sources[0];
+        float gains[AEMixerCoreMaximumChannels];
+        AEMixerCoreGainsForVolumeAndPan(source->volume, source->pan, outputChannels, gains);
+        BOOL unityGain = YES;
+        for ( int i=0; i<outputChannels && unityGain; i++ ) {
+            if ( gains[i] != 1.0f || (source->hasMixGains && source->mixGains[i] != 1.0f) ) unityGain = NO;
+        }
         
-        // Reset time slice info
-        THIS->_currentSliceFrameCount = 0;
-        memset(&THIS->_currentSliceTimestamp, 0, sizeof(AudioTimeStamp));
-        for ( int i=0; i<kMaxSources; i++ ) {
-            if ( THIS->_table[i].source ) THIS->_table[i].consumedFramesInCurrentTimeSlice = 0;
+        if ( unityGain ) {
+            dequeueSource(THIS, list, source, bufferList, ioLengthInFrames, NULL);
+            memcpy(source->mixGains, gains, sizeof(gains));
+            source->hasMixGains = YES;
+            
+            clearTimeSlice(THIS, list);
+            releaseSourceList(THIS);
+            return;
         }
-        pthread_mutex_unlock(&THIS->_graphMutex);
-        return;
     }
     
-    // We'll advance the buffer list pointers as we add audio - save the original buffer list to restore later
-    AEAudioBufferListCopyOnStack(savedBufferList, bufferList, 0);
-    
     THIS->_automaticSingleSourceDequeueing = YES;
-    int framesToGo = MIN(*ioLengthInFrames, bufferList->mBuffers[0].mDataByteSize / THIS->_clientFormat.mBytesPerFrame);
     
-    // Process in small blocks so we don't overwhelm the mixer/converter buffers
-    int blockSize = framesToGo;
-    while ( blockSize > 512 ) blockSize /= 2;
+    // Mix straight into the output if it's in the mixing core's own format, otherwise into our mix buffers
+    BOOL mixIntoOutput = AEMixerCoreFormatIsNativeFloat(&THIS->_clientMixFormat);
+    float *output[AEMixerCoreMaximumChannels];
+    for ( int i=0; i<outputChannels; i++ ) {
+        output[i] = mixIntoOutput ? (float*)bufferList->mBuffers[i].mData : THIS->_mixBuffers[i];
+        memset(output[i], 0, frames * sizeof(float));
+    }
     
-    while ( framesToGo > 0 ) {
+    for ( int i=0; i<list->count; i++ ) {
+        source_t *source = list->sources[i];
+        AudioStreamBasicDescription audioDescription = source->audioDescription.mSampleRate ? source->audioDescription : THIS->_clientFormat;
+        const AEMixerCoreFormat *format = source->audioDescription.mSampleRate ? (source->hasMixFormat ? &source->mixFormat : NULL) : &THIS->_clientMixFormat;
         
-        UInt32 frames = MIN(framesToGo, blockSize);
+        UInt32 sourceFrames = frames;
         
-        for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
-            bufferList->mBuffers[i].mDataByteSize = frames * THIS->_clientFormat.mBytesPerFrame;
+        if ( !format ) {
+            // We can't mix this source; discard its audio to keep it in sync
+            dequeueSource(THIS, list, source, NULL, &sourceFrames, NULL);
+            continue;
         }
         
-        AudioBufferList *intermediateBufferList = bufferList;
-    
-        if ( THIS->_audioConverter ) {
-            // Initialise output buffer (to receive audio in mixer format)
-            intermediateBufferList = TPCircularBufferPrepareEmptyAudioBufferListWithAudioFormat(&THIS->_audioConverterBuffer, &THIS->_mixerOutputFormat, frames, NULL);
-            assert(intermediateBufferList != NULL);
-            
-            for ( int i=0; i<intermediateBufferList->mNumberBuffers; i++ ) {
-                intermediateBufferList->mBuffers[i].mNumberChannels = THIS->_mixerOutputFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved ? 1 : THIS->_mixerOutputFormat.mChannelsPerFrame;
+        if ( source->jitterBuffer ) {
+            // Play out the source's packets in timestamp order, concealing any that are missing
+            AEJitterBufferGet(source->jitterBuffer, THIS->_sourceMixBuffers, frames);
+        } else if ( source->resampler ) {
+            // Resample the source to the output rate, correcting for clock drift
+            resampleSource(THIS, source, format, &audioDescription, THIS->_sourceMixBuffers, frames);
+        } else {
+            // Dequeue the source's audio: directly into our float buffers if it's already in the right format,
+            // otherwise into the source scratch buffer, for conversion
+            BOOL nativeFloat = AEMixerCoreFormatIsNativeFloat(format);
+            AEAudioBufferListCreateOnStack(sourceBufferList, audioDescription);
+            const void *sourceData[AEMixerCoreMaximumChannels];
+            for ( int j=0; j<sourceBufferList->mNumberBuffers; j++ ) {
+                sourceBufferList->mBuffers[j].mNumberChannels = sourceBufferList->mNumberBuffers == 1 ? audioDescription.mChannelsPerFrame : 1;
+                sourceBufferList->mBuffers[j].mDataByteSize = frames * audioDescription.mBytesPerFrame;
+                sourceBufferList->mBuffers[j].mData = nativeFloat
+                    ? (void*)THIS->_sourceMixBuffers[j]
+                    : THIS->_sourceScratchBuffer + j * (kMixBufferFrames * audioDescription.mBytesPerFrame);
+                sourceData[j] = sourceBufferList->mBuffers[j].mData;
             }
-        }
-        
-        // Perform render
-        AudioUnitRenderActionFlags flags = 0;
-        AudioTimeStamp renderTimestamp;
-        memset(&renderTimestamp, 0, sizeof(AudioTimeStamp));
-        renderTimestamp.mSampleTime = THIS->_sampleTime;
-        renderTimestamp.mFlags = kAudioTimeStampSampleTimeValid;
-        OSStatus result = AudioUnitRender(THIS->_mixerUnit, &flags, &renderTimestamp, 0, frames, intermediateBufferList);
-        if ( !AECheckOSStatus(result, "AudioUnitRender") ) {
-            break;
-        }
-        
-        THIS->_currentSliceTimestamp.mSampleTime += frames;
-        THIS->_currentSliceTimestamp.mHostTime += AEHostTicksFromSeconds((double)frames/THIS->_clientFormat.mSampleRate);
-        THIS->_sampleTime += frames;
-        THIS->_currentSliceFrameCount -= frames;
-        
-        if ( THIS->_audioConverter ) {
-            // Convert output into client format
-            OSStatus result = AudioConverterFillComplexBuffer(THIS->_audioConverter, 
-                                                              fillComplexBufferInputProc, 
-                                                              &(struct fillComplexBufferInputProc_t) { .bufferList = intermediateBufferList, .frames = frames }, 
-                                                              &frames, 
-                                                              bufferList, 
-                                                              NULL);
-            if ( !AECheckOSStatus(result, "AudioConverterConvertComplexBuffer") ) {
-                break;
+            
+            dequeueSource(THIS, list, source, sourceBufferList, &sourceFrames, NULL);
+            
+            if ( !nativeFloat ) {
+                AEMixerCoreToFloat(format, sourceData, THIS->_sourceMixBuffers, frames);
             }
         }
         
-        // Advance buffers
+        // Mix, ramping from the gains we used last time to the current ones
+        float gains[AEMixerCoreMaximumChannels];
+        AEMixerCoreGainsForVolumeAndPan(source->volume, source->pan, outputChannels, gains);
+        AEMixerCoreMix((const float * const *)THIS->_sourceMixBuffers, format->channels,
+                       output, outputChannels,
+                       frames,
+                       source->hasMixGains ? source->mixGains : gains,
+                       gains);
+        memcpy(source->mixGains, gains, sizeof(gains));
+        source->hasMixGains = YES;
+    }
+    
+    if ( !mixIntoOutput ) {
+        void *outputData[AEMixerCoreMaximumChannels];
         for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
-            bufferList->mBuffers[i].mData = (uint8_t*)bufferList->mBuffers[i].mData + (frames * THIS->_clientFormat.mBytesPerFrame);
+            outputData[i] = bufferList->mBuffers[i].mData;
         }
-        
-        if ( frames == 0 ) break;
-        
-        framesToGo -= frames;
+        AEMixerCoreFromFloat(&THIS->_clientMixFormat, (const float * const *)output, outputData, frames);
     }
-    THIS->_automaticSingleSourceDequeueing = NO;
-    
-    *ioLengthInFrames -= framesToGo;
     
-    // Reset time slice info
-    THIS->_currentSliceFrameCount = 0;
-    memset(&THIS->_currentSliceTimestamp, 0, sizeof(AudioTimeStamp));
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( THIS->_table[i].source ) THIS->_table[i].consumedFramesInCurrentTimeSlice = 0;
-    }
+    THIS->_automaticSingleSourceDequeueing = NO;
     
-    // Restore buffers
-    memcpy(bufferList, savedBufferList, AEAudioBufferListGetStructSize(bufferList));
+    THIS->_sampleTime += frames;
     
-    pthread_mutex_unlock(&THIS->_graphMutex);
+    clearTimeSlice(THIS, list);
+    releaseSourceList(THIS);
 }
 
-
 void AEMixerBufferDequeueSingleSource(__unsafe_unretained AEMixerBuffer *THIS, AEMixerBufferSource sourceID, AudioBufferList *bufferList, UInt32 *ioLengthInFrames, AudioTimeStamp *outTimestamp) {
-    source_t *source = sourceWithID(THIS, sourceID, NULL);
+    sourceList_t *list = acquireSourceList(THIS);
+    
+    // Leave sources being reconfigured alone: the main thread clears their live bit, then waits for us to release the list
+    source_t *source = sourceWithID(THIS, sourceID);
+    if ( source && !(THIS->_liveSources[source->slot / kSourceChunkSize] & (1ULL << (source->slot % kSourceChunkSize))) ) {
+        source = NULL;
+    }
     
-    dprintf(THIS, 1, "Dequeue %u frames from source %p", (unsigned int)*ioLengthInFrames, sourceID);
+    dequeueSource(THIS, list, source, bufferList, ioLengthInFrames, outTimestamp);
+    releaseSourceList(THIS);
+}
+
+static void dequeueSource(__unsafe_unretained AEMixerBuffer *THIS, sourceList_t *list, source_t *source, AudioBufferList *bufferList, UInt32 *ioLengthInFrames, AudioTimeStamp *outTimestamp) {
+    dprintf(THIS, 1, "Dequeue %u frames from source %p", (unsigned int)*ioLengthInFrames, source ? source->source : NULL);
     
     AudioTimeStamp sliceTimestamp = THIS->_currentSliceTimestamp;
     UInt32 sliceFrameCount = THIS->_currentSliceFrameCount;
     
     if ( sliceTimestamp.mFlags == 0 || sliceFrameCount == 0 ) {
         // Determine how many frames are available globally
-        sliceFrameCount = _AEMixerBufferPeek(THIS, &sliceTimestamp, YES);
+        clearTimeSlice(THIS, list);
+        sliceFrameCount = _AEMixerBufferPeek(THIS, list, &sliceTimestamp, YES);
         THIS->_currentSliceTimestamp = sliceTimestamp;
         THIS->_currentSliceFrameCount = sliceFrameCount;
-        for ( int i=0; i<kMaxSources; i++ ) {
-            if ( THIS->_table[i].source ) THIS->_table[i].consumedFramesInCurrentTimeSlice = 0;
-        }
     }
     
     AudioStreamBasicDescription audioDescription = source && source->audioDescription.mSampleRate ? source->audioDescription : THIS->_clientFormat;
-        
+    const AEMixerCoreFormat *format = source && source->audioDescription.mSampleRate
+        ? (source->hasMixFormat ? &source->mixFormat : NULL)
+        : (THIS->_hasClientMixFormat ? &THIS->_clientMixFormat : NULL);
+    
     if ( outTimestamp ) {
         *outTimestamp = sliceTimestamp;
         if ( source ) {
@@ -522,7 +741,7 @@ void AEMixerBufferDequeueSingleSource(__unsafe_unretained AEMixerBuffer *THIS, A
     }
     
     *ioLengthInFrames = MIN(*ioLengthInFrames, sliceFrameCount - (source ? source->consumedFramesInCurrentTimeSlice : 0));
-
+    
     // If buffer list is provided with NULL mData pointers, use our own scratch buffer
     if ( bufferList && !bufferList->mBuffers[0].mData ) {
         *ioLengthInFrames = MIN(*ioLengthInFrames, kScratchBufferBytesPerChannel / (audioDescription.mBitsPerChannel/8));
@@ -547,7 +766,24 @@ void AEMixerBufferDequeueSingleSource(__unsafe_unretained AEMixerBuffer *THIS, A
     memset(&sourceTimestamp, 0, sizeof(sourceTimestamp));
     UInt32 sourceFrameCount = 0;
     
-    if ( sliceFrameCount > 0 ) {
+    if ( source->resampler || source->jitterBuffer ) {
+        // Drift-compensated and jitter-buffered sources play continuously, rather than synced by timestamp
+        *ioLengthInFrames = MIN(*ioLengthInFrames, kMixBufferFrames);
+        if ( format ) {
+            if ( source->jitterBuffer ) {
+                AEJitterBufferGet(source->jitterBuffer, THIS->_sourceMixBuffers, *ioLengthInFrames);
+            } else {
+                resampleSource(THIS, source, format, &audioDescription, THIS->_sourceMixBuffers, *ioLengthInFrames);
+            }
+            if ( bufferList ) {
+                void *outputData[AEMixerCoreMaximumChannels];
+                for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
+                    outputData[i] = bufferList->mBuffers[i].mData;
+                }
+                AEMixerCoreFromFloat(format, (const float * const *)THIS->_sourceMixBuffers, outputData, *ioLengthInFrames);
+            }
+        }
+    } else if ( sliceFrameCount > 0 ) {
         // Now determine the frame count and timestamp on the current source
         if ( source->peekCallback ) {
             sourceFrameCount = source->peekCallback(source->source, &sourceTimestamp, source->callbackUserinfo);
@@ -568,7 +804,7 @@ void AEMixerBufferDequeueSingleSource(__unsafe_unretained AEMixerBuffer *THIS, A
     if ( sourceFrameCount > 0 ) {
         int totalRequiredSkipFrames = 0;
         int skipFrames = 0;
-
+        
         if ( sourceTimestamp.mFlags & kAudioTimeStampHostTimeValid
              && sliceTimestamp.mFlags & kAudioTimeStampHostTimeValid
              && sourceTimestamp.mHostTime < sliceTimestamp.mHostTime - AEHostTicksFromSeconds((!source->synced ? 0.001 : kResyncTimestampThreshold)) ) {
@@ -591,14 +827,14 @@ void AEMixerBufferDequeueSingleSource(__unsafe_unretained AEMixerBuffer *THIS, A
                 dprintf(THIS, 1, "Mixer buffer %p skipping %d frames of source %p due to %0.4lfs discrepancy (%0.4lf source, %0.4lf stream)\n",
                        THIS,
                        totalRequiredSkipFrames,
-                       source->source, 
+                       source->source,
                        AESecondsFromHostTicks(sliceTimestamp.mHostTime - sourceTimestamp.mHostTime),
                        AESecondsFromHostTicks(sourceTimestamp.mHostTime),
                        AESecondsFromHostTicks(sliceTimestamp.mHostTime));
 #endif
                 source->synced = NO;
             }
-    
+            
             if ( source->skipFadeBuffer->mBuffers[0].mDataByteSize > 0 ) {
                 // We have some frames in the skip buffer, ready to crossfade
                 microfadeFrames = MIN(*ioLengthInFrames, source->skipFadeBuffer->mBuffers[0].mDataByteSize / audioDescription.mBytesPerFrame);
@@ -618,28 +854,22 @@ void AEMixerBufferDequeueSingleSource(__unsafe_unretained AEMixerBuffer *THIS, A
                 }
                 
                 sourceTimestamp.mSampleTime += microfadeFrames;
-                sourceTimestamp.mHostTime += AEHostTicksFromSeconds(((double)microfadeFrames / (double)source->audioDescription.mSampleRate));
+                sourceTimestamp.mHostTime += AEHostTicksFromSeconds(((double)microfadeFrames / audioDescription.mSampleRate));
                 
                 skipFrames -= microfadeFrames;
             }
             
-            // Convert the audio to float
-            if ( !AEFloatConverterToFloat(source->floatConverter ? (__bridge AEFloatConverter*)source->floatConverter : THIS->_floatConverter,
-                                          source->skipFadeBuffer,
-                                          THIS->_microfadeBuffer,
-                                          microfadeFrames) ) {
-                return;
-            }
+            int channels = audioDescription.mChannelsPerFrame;
             
-            // Apply fade out
-            float start = 1.0;
-            float step = -1.0 / (float)microfadeFrames;
-            if ( audioDescription.mChannelsPerFrame == 2 ) {
-                vDSP_vrampmul2(THIS->_microfadeBuffer[0], THIS->_microfadeBuffer[1], 1, &start, &step, THIS->_microfadeBuffer[0], THIS->_microfadeBuffer[1], 1, microfadeFrames);
-            } else {
-                for ( int i=0; i<audioDescription.mChannelsPerFrame; i++ ) {
-                    start = 1.0;
-                    vDSP_vrampmul(THIS->_microfadeBuffer[i], 1, &start, &step, THIS->_microfadeBuffer[i], 1, microfadeFrames);
+            if ( format ) {
+                // Convert the audio to float, and apply fade out
+                const void *skipFadeData[AEMixerCoreMaximumChannels];
+                for ( int i=0; i<source->skipFadeBuffer->mNumberBuffers; i++ ) {
+                    skipFadeData[i] = source->skipFadeBuffer->mBuffers[i].mData;
+                }
+                AEMixerCoreToFloat(format, skipFadeData, THIS->_microfadeBuffer, microfadeFrames);
+                for ( int i=0; i<channels; i++ ) {
+                    AEMixerCoreApplyRamp(THIS->_microfadeBuffer[i], microfadeFrames, 1.0, 0.0);
                 }
             }
             
@@ -654,7 +884,7 @@ void AEMixerBufferDequeueSingleSource(__unsafe_unretained AEMixerBuffer *THIS, A
                 }
                 
                 sourceTimestamp.mSampleTime += discardFrames;
-                sourceTimestamp.mHostTime += AEHostTicksFromSeconds((double)discardFrames / (double)source->audioDescription.mSampleRate);
+                sourceTimestamp.mHostTime += AEHostTicksFromSeconds((double)discardFrames / audioDescription.mSampleRate);
             }
             
             for ( int i=0; i<source->skipFadeBuffer->mNumberBuffers; i++ ) {
@@ -670,43 +900,25 @@ void AEMixerBufferDequeueSingleSource(__unsafe_unretained AEMixerBuffer *THIS, A
                 TPCircularBufferDequeueBufferListFrames(&source->buffer, &freshFrames, bufferList, NULL, &audioDescription);
             }
             sourceTimestamp.mSampleTime += freshFrames;
-            sourceTimestamp.mHostTime += AEHostTicksFromSeconds((double)freshFrames / (double)source->audioDescription.mSampleRate);
+            sourceTimestamp.mHostTime += AEHostTicksFromSeconds((double)freshFrames / audioDescription.mSampleRate);
             
             microfadeFrames = MIN(microfadeFrames, freshFrames);
             
-            if ( bufferList ) {
-                // Convert the audio to float
-                if ( !AEFloatConverterToFloat(source->floatConverter ? (__bridge AEFloatConverter*)source->floatConverter : THIS->_floatConverter,
-                                              bufferList,
-                                              THIS->_microfadeBuffer + audioDescription.mChannelsPerFrame,
-                                              microfadeFrames) ) {
-                    return;
-                }
-                
-                // Apply fade in
-                start = 0.0;
-                step = 1.0 / (float)microfadeFrames;
-                if ( audioDescription.mChannelsPerFrame == 2 ) {
-                    vDSP_vrampmul2(THIS->_microfadeBuffer[2+0], THIS->_microfadeBuffer[2+1], 1, &start, &step, THIS->_microfadeBuffer[2+0], THIS->_microfadeBuffer[2+1], 1, microfadeFrames);
-                } else {
-                    for ( int i=0; i<audioDescription.mChannelsPerFrame; i++ ) {
-                        start = 1.0;
-                        vDSP_vrampmul(THIS->_microfadeBuffer[audioDescription.mChannelsPerFrame + i], 1, &start, &step, THIS->_microfadeBuffer[audioDescription.mChannelsPerFrame + i], 1, microfadeFrames);
-                    }
+            if ( bufferList && format ) {
+                // Convert the audio to float, then fade it in over the faded-out audio
+                const void *freshData[AEMixerCoreMaximumChannels];
+                void *outputData[AEMixerCoreMaximumChannels];
+                for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
+                    freshData[i] = outputData[i] = bufferList->mBuffers[i].mData;
                 }
+                AEMixerCoreToFloat(format, freshData, THIS->_microfadeBuffer + channels, microfadeFrames);
                 
-                // Add buffers together
-                for ( int i=0; i<audioDescription.mChannelsPerFrame; i++ ) {
-                    vDSP_vadd(THIS->_microfadeBuffer[i], 1, THIS->_microfadeBuffer[audioDescription.mChannelsPerFrame + i], 1, THIS->_microfadeBuffer[i], 1, microfadeFrames);
+                for ( int i=0; i<channels; i++ ) {
+                    AEMixerCoreAddWithRamp(THIS->_microfadeBuffer[channels + i], THIS->_microfadeBuffer[i], microfadeFrames, 0.0, 1.0);
                 }
                 
                 // Store in output
-                if ( !AEFloatConverterFromFloat(source->floatConverter ? (__bridge AEFloatConverter*)source->floatConverter : THIS->_floatConverter,
-                                                THIS->_microfadeBuffer,
-                                                bufferList,
-                                                microfadeFrames) ) {
-                    return;
-                }
+                AEMixerCoreFromFloat(format, (const float * const *)THIS->_microfadeBuffer, outputData, microfadeFrames);
             }
             
             if ( skipFrames > 0 && skipFrames == totalRequiredSkipFrames ) {
@@ -735,13 +947,9 @@ void AEMixerBufferDequeueSingleSource(__unsafe_unretained AEMixerBuffer *THIS, A
         source->consumedFramesInCurrentTimeSlice += *ioLengthInFrames;
         
         // Determine the globally consumed frames
-        int sourceCount  = 0;
         UInt32 minConsumedFrameCount = UINT32_MAX;
-        for ( int i=0; i<kMaxSources; i++ ) {
-            if ( THIS->_table[i].source ) {
-                sourceCount++;
-                minConsumedFrameCount = MIN(minConsumedFrameCount, THIS->_table[i].consumedFramesInCurrentTimeSlice);
-            }
+        for ( int i=0; i<list->count; i++ ) {
+            minConsumedFrameCount = MIN(minConsumedFrameCount, list->sources[i]->consumedFramesInCurrentTimeSlice);
         }
         
         if ( minConsumedFrameCount > 0 ) {
@@ -752,42 +960,34 @@ void AEMixerBufferDequeueSingleSource(__unsafe_unretained AEMixerBuffer *THIS, A
             THIS->_currentSliceFrameCount -= minConsumedFrameCount;
             THIS->_currentSliceTimestamp.mSampleTime += minConsumedFrameCount;
             THIS->_currentSliceTimestamp.mHostTime += AEHostTicksFromSeconds((double)minConsumedFrameCount/THIS->_clientFormat.mSampleRate);
-            for ( int i=0; i<kMaxSources; i++ ) {
-                if ( THIS->_table[i].source ) THIS->_table[i].consumedFramesInCurrentTimeSlice = 0;
+            for ( int i=0; i<list->count; i++ ) {
+                list->sources[i]->consumedFramesInCurrentTimeSlice = 0;
             }
         }
     }
 }
 
+#pragma mark - Peek
+
 UInt32 AEMixerBufferPeek(__unsafe_unretained AEMixerBuffer *THIS, AudioTimeStamp *outNextTimestamp) {
-    unregisterSources(THIS);
-    return _AEMixerBufferPeek(THIS, outNextTimestamp, NO);
+    sourceList_t *list = acquireSourceList(THIS);
+    UInt32 frames = _AEMixerBufferPeek(THIS, list, outNextTimestamp, NO);
+    releaseSourceList(THIS);
+    return frames;
 }
 
-static UInt32 _AEMixerBufferPeek(__unsafe_unretained AEMixerBuffer *THIS, AudioTimeStamp *outNextTimestamp, BOOL respectInfiniteSourceFlag) {
+static UInt32 _AEMixerBufferPeek(__unsafe_unretained AEMixerBuffer *THIS, sourceList_t *list, AudioTimeStamp *outNextTimestamp, BOOL respectInfiniteSourceFlag) {
     dprintf(THIS, 3, "Peeking");
     
     // Make sure we have at least one source
-    BOOL hasSources = NO;
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( THIS->_table[i].source ) {
-            hasSources = YES;
-            break;
-        }
-    }
-    
-    if ( !hasSources ) {
+    if ( !list || list->count == 0 ) {
         dprintf(THIS, 3, "No sources");
         if ( outNextTimestamp ) memset(outNextTimestamp, 0, sizeof(AudioTimeStamp));
         return 0;
     }
     
     // Clear time slice info
-    THIS->_currentSliceFrameCount = 0;
-    memset(&THIS->_currentSliceTimestamp, 0, sizeof(AudioTimeStamp));
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( THIS->_table[i].source ) THIS->_table[i].consumedFramesInCurrentTimeSlice = 0;
-    }
+    clearTimeSlice(THIS, list);
     
     // Determine lowest buffer fill count, excluding drained sources that we aren't receiving from (for those, we'll return silence),
     // and address sources that are behind the timeline
@@ -798,71 +998,77 @@ static UInt32 _AEMixerBufferPeek(__unsafe_unretained AEMixerBuffer *THIS, AudioT
     UInt32 minFrameCount = UINT32_MAX;
     BOOL hasActiveSources = NO;
     
-    struct {
-        source_t *source;
-        uint64_t endHostTime;
-        UInt32 frameCount;
-        AudioTimeStamp timestamp; } peekEntries[kMaxSources];
-    memset(&peekEntries, 0, sizeof(peekEntries));
+    peekEntry_t *peekEntries = list->peekEntries;
+    memset(peekEntries, 0, list->count * sizeof(peekEntry_t));
     int peekEntriesCount = 0;
-     
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( THIS->_table[i].source ) {
-            source_t *source = &THIS->_table[i];
-            
-            AudioTimeStamp timestamp;
-            memset(&timestamp, 0, sizeof(timestamp));
-            UInt32 frameCount = 0;
-            
-            AudioStreamBasicDescription audioDescription = source->audioDescription.mSampleRate ? source->audioDescription : THIS->_clientFormat;
-            
-            if ( source->peekCallback ) {
-                frameCount = source->peekCallback(source->source, &timestamp, source->callbackUserinfo);
-                if ( frameCount != AEMixerBufferSourceInactive && respectInfiniteSourceFlag && THIS->_assumeInfiniteSources ) frameCount = UINT32_MAX;
-            } else {
-                frameCount = TPCircularBufferPeek(&source->buffer, &timestamp, &audioDescription);
-            }
-            
-            if ( frameCount == AEMixerBufferSourceInactive ) {
-                dprintf(THIS, 3, "Source %p is inactive", source->source);
-            } else {
-                dprintf(THIS, 3, "Source %p: %u frames @ %0.5lfs", source->source, (unsigned int)frameCount, AESecondsFromHostTicks(timestamp.mHostTime));
-            }
-            
-            if ( (frameCount == 0 && AESecondsFromHostTicks(now - source->lastAudioTimestamp) > THIS->_sourceIdleThreshold)
-                    || frameCount == AEMixerBufferSourceInactive ) {
-                
-                // Not receiving audio - ignore this empty source
-                dprintf(THIS, 3, "Skipping empty and idle source %p", source->source);
-                continue;
-            }
-            
-            if ( frameCount < minFrameCount ) minFrameCount = frameCount;
+    
+    for ( int i=0; i<list->count; i++ ) {
+        source_t *source = list->sources[i];
+        
+        if ( source->jitterBuffer ) {
+            // Jitter-buffered sources always play, concealing gaps rather than holding up the other sources
             source->lastAudioTimestamp = now;
-            
             hasActiveSources = YES;
+            continue;
+        }
+        
+        AudioTimeStamp timestamp;
+        memset(&timestamp, 0, sizeof(timestamp));
+        UInt32 frameCount = 0;
+        
+        AudioStreamBasicDescription audioDescription = source->audioDescription.mSampleRate ? source->audioDescription : THIS->_clientFormat;
+        
+        if ( source->peekCallback ) {
+            frameCount = source->peekCallback(source->source, &timestamp, source->callbackUserinfo);
+            if ( frameCount != AEMixerBufferSourceInactive && respectInfiniteSourceFlag && THIS->_assumeInfiniteSources ) frameCount = UINT32_MAX;
+        } else {
+            frameCount = TPCircularBufferPeek(&source->buffer, &timestamp, &audioDescription);
+        }
+        
+        if ( frameCount == AEMixerBufferSourceInactive ) {
+            dprintf(THIS, 3, "Source %p is inactive", source->source);
+        } else {
+            dprintf(THIS, 3, "Source %p: %u frames @ %0.5lfs", source->source, (unsigned int)frameCount, AESecondsFromHostTicks(timestamp.mHostTime));
+        }
+        
+        if ( (frameCount == 0 && AESecondsFromHostTicks(now - source->lastAudioTimestamp) > THIS->_sourceIdleThreshold)
+                || frameCount == AEMixerBufferSourceInactive ) {
             
-            if ( !(timestamp.mFlags & kAudioTimeStampHostTimeValid) ) {
-                continue;
-            }
-
-            AudioTimeStamp endTimestamp = timestamp;
-            endTimestamp.mHostTime = frameCount == UINT32_MAX ? UINT64_MAX : (UInt64)(endTimestamp.mHostTime + AEHostTicksFromSeconds(((double)frameCount / audioDescription.mSampleRate)));
-            endTimestamp.mSampleTime = frameCount == UINT32_MAX ? UINT32_MAX : (endTimestamp.mSampleTime + frameCount);
-            
-            peekEntries[peekEntriesCount].source = source;
-            peekEntries[peekEntriesCount].endHostTime = endTimestamp.mHostTime;
-            peekEntries[peekEntriesCount].frameCount = frameCount;
-            peekEntries[peekEntriesCount].timestamp = timestamp;
-            peekEntriesCount++;
-            
-            if ( timestamp.mHostTime > latestStartTimestamp.mHostTime ) {
-                latestStartTimestamp = timestamp;
-            }
-            if ( endTimestamp.mHostTime < earliestEndTimestamp.mHostTime ) {
-                earliestEndTimestamp = endTimestamp;
-                earliestEndSource = source;
-            }
+            // Not receiving audio - ignore this empty source
+            dprintf(THIS, 3, "Skipping empty and idle source %p", source->source);
+            continue;
+        }
+        
+        source->lastAudioTimestamp = now;
+        hasActiveSources = YES;
+        
+        if ( source->resampler ) {
+            // Drift-compensated sources play continuously, absorbing timing differences in their buffer
+            continue;
+        }
+        
+        if ( frameCount < minFrameCount ) minFrameCount = frameCount;
+        
+        if ( !(timestamp.mFlags & kAudioTimeStampHostTimeValid) ) {
+            continue;
+        }
+        
+        AudioTimeStamp endTimestamp = timestamp;
+        endTimestamp.mHostTime = frameCount == UINT32_MAX ? UINT64_MAX : (UInt64)(endTimestamp.mHostTime + AEHostTicksFromSeconds(((double)frameCount / audioDescription.mSampleRate)));
+        endTimestamp.mSampleTime = frameCount == UINT32_MAX ? UINT32_MAX : (endTimestamp.mSampleTime + frameCount);
+        
+        peekEntries[peekEntriesCount].source = source;
+        peekEntries[peekEntriesCount].endHostTime = endTimestamp.mHostTime;
+        peekEntries[peekEntriesCount].frameCount = frameCount;
+        peekEntries[peekEntriesCount].timestamp = timestamp;
+        peekEntriesCount++;
+        
+        if ( timestamp.mHostTime > latestStartTimestamp.mHostTime ) {
+            latestStartTimestamp = timestamp;
+        }
+        if ( endTimestamp.mHostTime < earliestEndTimestamp.mHostTime ) {
+            earliestEndTimestamp = endTimestamp;
+            earliestEndSource = source;
         }
     }
     
@@ -913,7 +1119,7 @@ static UInt32 _AEMixerBufferPeek(__unsafe_unretained AEMixerBuffer *THIS, AudioT
                         TPCircularBufferDequeueBufferListFrames(&peekEntries[i].source->buffer, &microfadeFrames, peekEntries[i].source->skipFadeBuffer, NULL, &sourceASBD);
                     }
                     peekEntries[i].timestamp.mSampleTime += microfadeFrames;
-                    peekEntries[i].timestamp.mHostTime += AEHostTicksFromSeconds((double)microfadeFrames / (double)peekEntries[i].source->audioDescription.mSampleRate);
+                    peekEntries[i].timestamp.mHostTime += AEHostTicksFromSeconds((double)microfadeFrames / sourceASBD.mSampleRate);
                 }
                 
                 if ( skipFrames > 0 ) {
@@ -958,22 +1164,28 @@ void AEMixerBufferEndTimeInterval(__unsafe_unretained AEMixerBuffer *THIS) {
     
     dprintf(THIS, 3, "End of time interval marked");
     
+    sourceList_t *list = acquireSourceList(THIS);
+    if ( !list ) {
+        releaseSourceList(THIS);
+        return;
+    }
+    
     // Determine the minimum consumed frames across those sources that have had frames consumed
     UInt32 minConsumedFrameCount = UINT32_MAX;
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( THIS->_table[i].source && THIS->_table[i].consumedFramesInCurrentTimeSlice != 0 ) {
-            minConsumedFrameCount = MIN(minConsumedFrameCount, THIS->_table[i].consumedFramesInCurrentTimeSlice);
+    for ( int i=0; i<list->count; i++ ) {
+        if ( list->sources[i]->consumedFramesInCurrentTimeSlice != 0 ) {
+            minConsumedFrameCount = MIN(minConsumedFrameCount, list->sources[i]->consumedFramesInCurrentTimeSlice);
         }
     }
     
     // Discard audio of sources that haven't had frames consumed
     if ( minConsumedFrameCount > 0 ) {
         THIS->_automaticSingleSourceDequeueing = YES;
-        for ( int i=0; i<kMaxSources; i++ ) {
-            if ( THIS->_table[i].source && THIS->_table[i].consumedFramesInCurrentTimeSlice == 0 ) {
+        for ( int i=0; i<list->count; i++ ) {
+            if ( list->sources[i]->consumedFramesInCurrentTimeSlice == 0 ) {
                 UInt32 frames = minConsumedFrameCount;
-                dprintf(THIS, 3, "Discarding %u frames from source %p", (unsigned int)frames, THIS->_table[i].source);
-                AEMixerBufferDequeueSingleSource(THIS, THIS->_table[i].source, NULL, &frames, NULL);
+                dprintf(THIS, 3, "Discarding %u frames from source %p", (unsigned int)frames, list->sources[i]->source);
+                dequeueSource(THIS, list, list->sources[i], NULL, &frames, NULL);
             }
         }
         THIS->_automaticSingleSourceDequeueing = NO;
@@ -983,15 +1195,12 @@ void AEMixerBufferEndTimeInterval(__unsafe_unretained AEMixerBuffer *THIS) {
     }
     
     // Clear time slice info
-    THIS->_currentSliceFrameCount = 0;
-    memset(&THIS->_currentSliceTimestamp, 0, sizeof(AudioTimeStamp));
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( THIS->_table[i].source ) THIS->_table[i].consumedFramesInCurrentTimeSlice = 0;
-    }
+    clearTimeSlice(THIS, list);
+    releaseSourceList(THIS);
 }
 
 void AEMixerBufferMarkSourceIdle(__unsafe_unretained AEMixerBuffer *THIS, AEMixerBufferSource sourceID) {
-    source_t *source = sourceWithID(THIS, sourceID, NULL);
+    source_t *source = sourceWithID(THIS, sourceID);
     if ( source ) {
         dprintf(THIS, 3, "Marking source %p idle", sourceID);
         source->lastAudioTimestamp = 0;
@@ -999,34 +1208,30 @@ void AEMixerBufferMarkSourceIdle(__unsafe_unretained AEMixerBuffer *THIS, AEMixe
     }
 }
 
+#pragma mark - Source configuration
+
 - (void)setAudioDescription:(AudioStreamBasicDescription)audioDescription forSource:(AEMixerBufferSource)sourceID {
-    int index;
-    source_t *source = sourceWithID(self, sourceID, &index);
+    source_t *source = sourceWithID(self, sourceID);
     
     if ( !source ) {
         prepareNewSource(self, sourceID);
-        source = sourceWithID(self, sourceID, &index);
-    }
-    
-    source->audioDescription = audioDescription;
-    
-    if ( source->floatConverter ) {
-        CFBridgingRelease(source->floatConverter);
-        source->floatConverter = NULL;
+        source = sourceWithID(self, sourceID);
+        if ( !source ) return;
     }
     
-    if ( source->skipFadeBuffer ) {
-        for ( int j=0; j<source->skipFadeBuffer->mNumberBuffers; j++ ) {
-            free(source->skipFadeBuffer->mBuffers[j].mData);
-        }
-        free(source->skipFadeBuffer);
-    }
+    // Take the source out of the mix while it's reconfigured
+    setSourceLive(self, source, NO);
+    [self publishSourceList];
     
-    if ( source->audioDescription.mSampleRate && memcmp(&source->audioDescription, &self->_clientFormat, sizeof(AudioStreamBasicDescription)) != 0 ) {
-        source->floatConverter = (__bridge_retained void*)[[AEFloatConverter alloc] initWithSourceFormat:source->audioDescription];
+    source->audioDescription = audioDescription;
+    source->hasMixFormat = AEMixerCoreFormatForAudioDescription(&source->audioDescription, &source->mixFormat);
+    if ( !source->hasMixFormat ) {
+        NSLog(@"AEMixerBuffer: Unsupported format for source %p; only native-endian 16/32-bit integer and 32-bit float linear PCM can be mixed", sourceID);
     }
     
+    freeSkipFadeBufferForSource(source);
     prepareSkipFadeBufferForSource(self, source);
+    configurePlayoutForSource(self, source);
     
     if ( !source->renderCallback ) {
         TPCircularBufferClear(&source->buffer);
@@ -1037,242 +1242,173 @@ void AEMixerBufferMarkSourceIdle(__unsafe_unretained AEMixerBuffer *THIS, AEMixe
         }
     }
     
-    // Set input stream format
-    AECheckOSStatus(AudioUnitSetProperty(_mixerUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, index, &source->audioDescription, sizeof(source->audioDescription)),
-                "AudioUnitSetProperty(kAudioUnitProperty_StreamFormat)");
-    
     [self respondToChannelCountChange];
+    
+    setSourceLive(self, source, YES);
+    [self publishSourceList];
 }
 
 - (void)setVolume:(float)volume forSource:(AEMixerBufferSource)sourceID {
-    int index;
-    source_t *source = sourceWithID(self, sourceID, &index);
+    source_t *source = sourceWithID(self, sourceID);
     
     if ( !source ) {
         prepareNewSource(self, sourceID);
-        source = sourceWithID(self, sourceID, &index);
+        source = sourceWithID(self, sourceID);
+        if ( !source ) return;
     }
     
+    // Picked up by the next dequeue, which ramps to the new gain
     source->volume = volume;
-    
-    // Set volume
-    AudioUnitParameterValue value = source->volume;
-    AECheckOSStatus(AudioUnitSetParameter(_mixerUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Input, index, value, 0),
-                "AudioUnitSetParameter(kMultiChannelMixerParam_Volume)");
-
 }
 
 - (float)volumeForSource:(AEMixerBufferSource)sourceID {
-    source_t *source = sourceWithID(self, sourceID, NULL);
+    source_t *source = sourceWithID(self, sourceID);
     if ( !source ) return 0.0;
     return source->volume;
 }
 
 - (void)setPan:(float)pan forSource:(AEMixerBufferSource)sourceID {
-    int index;
-    source_t *source = sourceWithID(self, sourceID, &index);
+    source_t *source = sourceWithID(self, sourceID);
     
     if ( !source ) {
         prepareNewSource(self, sourceID);
-        source = sourceWithID(self, sourceID, &index);
+        source = sourceWithID(self, sourceID);
+        if ( !source ) return;
     }
     
+    // Picked up by the next dequeue, which ramps to the new gain
     source->pan = pan;
-    
-    // Set pan
-    AudioUnitParameterValue value = source->pan;
-    AECheckOSStatus(AudioUnitSetParameter(_mixerUnit, kMultiChannelMixerParam_Pan, kAudioUnitScope_Input, index, value, 0),
-                "AudioUnitSetParameter(kMultiChannelMixerParam_Pan)");
 }
 
 - (float)panForSource:(AEMixerBufferSource)sourceID {
-    source_t *source = sourceWithID(self, sourceID, NULL);
+    source_t *source = sourceWithID(self, sourceID);
     if ( !source ) return 0.0;
     return source->pan;
 }
 
-- (void)unregisterSource:(AEMixerBufferSource)sourceID {
-    source_t *source = sourceWithID(self, sourceID, NULL);
-    if ( !source ) return;
-    
-    source->unregistering = YES;
+- (void)setDriftCompensationEnabled:(BOOL)enabled forSource:(AEMixerBufferSource)sourceID {
+    source_t *source = sourceWithID(self, sourceID);
     
-    [self refreshMixingGraph];
-
-    Boolean isInited = false;
-    AUGraphIsInitialized(_graph, &isInited);
-    if ( !isInited ) {
-        source->source = NULL;
-    } else {
-        // Wait for render thread to mark source as unregistered
-        int count=0;
-        while ( source->source != NULL && count++ < 15 ) {
-            [NSThread sleepForTimeInterval:0.001];
-        }
-        source->source = NULL;
+    if ( !source ) {
+        prepareNewSource(self, sourceID);
+        source = sourceWithID(self, sourceID);
+        if ( !source ) return;
     }
     
-    if ( !source->renderCallback ) {
-        TPCircularBufferCleanup(&source->buffer);
-    }
-    if ( source->skipFadeBuffer ) {
-        for ( int j=0; j<source->skipFadeBuffer->mNumberBuffers; j++ ) {
-            free(source->skipFadeBuffer->mBuffers[j].mData);
-        }
-        free(source->skipFadeBuffer);
-    }
+    if ( source->driftCompensation == enabled ) return;
     
-    memset(source, 0, sizeof(source_t));
+    // Take the source out of the mix while its resampler is replaced
+    setSourceLive(self, source, NO);
+    [self publishSourceList];
+    
+    source->driftCompensation = enabled;
+    configurePlayoutForSource(self, source);
+    
+    setSourceLive(self, source, YES);
+    [self publishSourceList];
 }
 
-static OSStatus sourceInputCallback(void *inRefCon, AudioUnitRenderActionFlags *ioActionFlags, const AudioTimeStamp *inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList *ioData) {
-    __unsafe_unretained AEMixerBuffer *THIS = (__bridge AEMixerBuffer*)inRefCon;
+- (BOOL)driftCompensationEnabledForSource:(AEMixerBufferSource)sourceID {
+    source_t *source = sourceWithID(self, sourceID);
+    return source && source->resampler;
+}
+
+- (double)clockDriftForSource:(AEMixerBufferSource)sourceID {
+    source_t *source = sourceWithID(self, sourceID);
+    if ( !source || !source->resampler || !source->primed ) return 0.0;
+    return source->driftTracker.correction * 1.0e6;
+}
+
+- (void)setJitterBufferEnabled:(BOOL)enabled forSource:(AEMixerBufferSource)sourceID {
+    source_t *source = sourceWithID(self, sourceID);
     
-    for ( int i=0; i<ioData->mNumberBuffers; i++ ) {
-        memset(ioData->mBuffers[i].mData, 0, ioData->mBuffers[i].mDataByteSize);
+    if ( !source ) {
+        prepareNewSource(self, sourceID);
+        source = sourceWithID(self, sourceID);
+        if ( !source ) return;
     }
     
-    source_t *source = &THIS->_table[inBusNumber];
+    if ( source->jitterBufferMode == enabled ) return;
     
-    if ( source->source ) {
-        AEMixerBufferDequeueSingleSource(THIS, source->source, ioData, &inNumberFrames, NULL);
-    }
+    // Take the source out of the mix while its jitter buffer is replaced
+    setSourceLive(self, source, NO);
+    [self publishSourceList];
     
-    return noErr;
+    source->jitterBufferMode = enabled;
+    configurePlayoutForSource(self, source);
+    
+    setSourceLive(self, source, YES);
+    [self publishSourceList];
 }
 
-- (void)refreshMixingGraph {
-    if ( !_graph ) {
-        [self createMixingGraph];
-    }
-    
-    // Set bus count
-	UInt32 busCount = 0;
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( _table[i].source ) busCount++;
-    }
-    
-    if ( !AECheckOSStatus(AudioUnitSetProperty(_mixerUnit, kAudioUnitProperty_ElementCount, kAudioUnitScope_Input, 0, &busCount, sizeof(busCount)),
-                      "AudioUnitSetProperty(kAudioUnitProperty_ElementCount)") ) return;
-    
-    // The default volume for the MultiChannelMixer is 0 on OSX and 1 on iOS. ¯\_(ツ)_/¯
-    AudioUnitParameterValue defaultOutputVolume = 1.0;
-    if ( !AECheckOSStatus(AudioUnitSetParameter(_mixerUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Output, 0, defaultOutputVolume, 0),
-                      "AudioUnitSetParameter(kMultiChannelMixerParam_Volume)") ) return;
+- (BOOL)jitterBufferEnabledForSource:(AEMixerBufferSource)sourceID {
+    source_t *source = sourceWithID(self, sourceID);
+    return source && source->jitterBuffer;
+}
+
+- (AEJitterBufferStatistics)jitterStatisticsForSource:(AEMixerBufferSource)sourceID {
+    AEJitterBufferStatistics statistics;
+    memset(&statistics, 0, sizeof(statistics));
+    source_t *source = sourceWithID(self, sourceID);
+    if ( source && source->jitterBuffer ) {
+        AEJitterBufferGetStatistics(source->jitterBuffer, &statistics);
+    }
+    return statistics;
+}
+
+- (void)setJitterConcealment:(AEJitterBufferConcealment)jitterConcealment {
+    _jitterConcealment = jitterConcealment;
     
-    // Configure each bus
-    for ( int busNumber=0; busNumber<busCount; busNumber++ ) {
-        source_t *source = &_table[busNumber];
-        
-        // Set input stream format
-        AECheckOSStatus(AudioUnitSetProperty(_mixerUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, busNumber, source->audioDescription.mSampleRate ? &source->audioDescription : &_clientFormat, sizeof(AudioStreamBasicDescription)),
-                    "AudioUnitSetProperty(kAudioUnitProperty_StreamFormat)");
-        
-        // Set volume
-        AudioUnitParameterValue value = source->volume;
-        AECheckOSStatus(AudioUnitSetParameter(_mixerUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Input, busNumber, value, 0),
-                    "AudioUnitSetParameter(kMultiChannelMixerParam_Volume)");
-        
-        // Set pan
-        value = source->pan;
-        AECheckOSStatus(AudioUnitSetParameter(_mixerUnit, kMultiChannelMixerParam_Pan, kAudioUnitScope_Input, busNumber, value, 0),
-                    "AudioUnitSetParameter(kMultiChannelMixerParam_Pan)");
-        
-        // Set the render callback
-        AURenderCallbackStruct rcbs;
-        rcbs.inputProc = &sourceInputCallback;
-        rcbs.inputProcRefCon = (__bridge void *)self;
-        OSStatus result = AUGraphSetNodeInputCallback(_graph, _mixerNode, busNumber, &rcbs);
-        if ( result != kAUGraphErr_InvalidConnection /* Ignore this error */ )
-            AECheckOSStatus(result, "AUGraphSetNodeInputCallback");
-    }
-    
-    Boolean isInited = false;
-    AUGraphIsInitialized(_graph, &isInited);
-    if ( !isInited ) {
-        AECheckOSStatus(AUGraphInitialize(_graph), "AUGraphInitialize");
-        
-        OSMemoryBarrier();
-        _graphReady = YES;
-    } else {
-        for ( int retries=3; retries > 0; retries-- ) {
-            if ( AECheckOSStatus(AUGraphUpdate(_graph, NULL), "AUGraphUpdate") ) {
-                break;
-            }
-            [NSThread sleepForTimeInterval:0.01];
+    source_t *source;
+    for ( int slot=0; (source = nextSource(self, _registeredSources, &slot)); slot++ ) {
+        if ( source->jitterBuffer ) {
+            AEJitterBufferSetConcealment(source->jitterBuffer, jitterConcealment);
         }
     }
 }
 
-- (void)createMixingGraph {
-    // Create a new AUGraph
-	OSStatus result = NewAUGraph(&_graph);
-    if ( !AECheckOSStatus(result, "NewAUGraph") ) return;
-    
-    // Multichannel mixer unit
-    AudioComponentDescription mixer_desc = {
-        .componentType = kAudioUnitType_Mixer,
-        .componentSubType = kAudioUnitSubType_MultiChannelMixer,
-        .componentManufacturer = kAudioUnitManufacturer_Apple,
-        .componentFlags = 0,
-        .componentFlagsMask = 0
-    };
-    
-    // Add mixer node to graph
-    result = AUGraphAddNode(_graph, &mixer_desc, &_mixerNode );
-    if ( !AECheckOSStatus(result, "AUGraphAddNode mixer") ) return;
-    
-    // Open the graph - AudioUnits are open but not initialized (no resource allocation occurs here)
-	result = AUGraphOpen(_graph);
-	if ( !AECheckOSStatus(result, "AUGraphOpen") ) return;
-    
-    // Get reference to the audio unit
-    result = AUGraphNodeInfo(_graph, _mixerNode, NULL, &_mixerUnit);
-    if ( !AECheckOSStatus(result, "AUGraphNodeInfo") ) return;
+- (void)unregisterSource:(AEMixerBufferSource)sourceID {
+    source_t *source = sourceWithID(self, sourceID);
+    if ( !source ) return;
     
-    // Set the audio unit to handle up to 4096 frames per slice to keep rendering during screen lock
-    UInt32 maxFPS = 4096;
-    AECheckOSStatus(AudioUnitSetProperty(_mixerUnit, kAudioUnitProperty_MaximumFramesPerSlice, kAudioUnitScope_Global, 0, &maxFPS, sizeof(maxFPS)),
-                "AudioUnitSetProperty(kAudioUnitProperty_MaximumFramesPerSlice)");
+    // Publish a list without the source; once that returns, the consumer thread is done with it
+    setSourceLive(self, source, NO);
+    [self publishSourceList];
     
-    // Try to set mixer's output stream format to our client format
-    result = AudioUnitSetProperty(_mixerUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Output, 0, &_clientFormat, sizeof(_clientFormat));
+    // Stop lookups finding it, then wait for any enqueue that already had
+    source->source = NULL;
+    OSMemoryBarrier();
+    waitForReaders(self);
     
-    if ( result == kAudioUnitErr_FormatNotSupported ) {
-        // The mixer only supports a subset of formats. If it doesn't support this one, then we'll convert manually
-        
-        // Get the existing format, and apply just the sample rate
-        UInt32 size = sizeof(_mixerOutputFormat);
-        AECheckOSStatus(AudioUnitGetProperty(_mixerUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Output, 0, &_mixerOutputFormat, &size),
-                    "AudioUnitGetProperty(kAudioUnitProperty_StreamFormat)");
-        _mixerOutputFormat.mSampleRate = _clientFormat.mSampleRate;
-        
-        AECheckOSStatus(AudioUnitSetProperty(_mixerUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Output, 0, &_mixerOutputFormat, sizeof(_mixerOutputFormat)), 
-                    "AudioUnitSetProperty(kAudioUnitProperty_StreamFormat");
-
-        // Create the audio converter
-        AECheckOSStatus(AudioConverterNew(&_mixerOutputFormat, &_clientFormat, &_audioConverter), "AudioConverterNew");
-        TPCircularBufferInit(&_audioConverterBuffer, kConversionBufferLength);
-    } else {
-        AECheckOSStatus(result, "AudioUnitSetProperty(kAudioUnitProperty_StreamFormat)");
+    if ( !source->renderCallback ) {
+        TPCircularBufferCleanup(&source->buffer);
     }
+    freeSkipFadeBufferForSource(source);
+    AEMixerCoreResamplerFree(source->resampler);
+    AEJitterBufferFree(source->jitterBuffer);
+    
+    releaseSource(self, source);
 }
 
-- (void)pollActionBuffer {
-    while ( 1 ) {
-        uint32_t availableBytes;
-        action_t *action = TPCircularBufferTail(&_mainThreadActionBuffer, &availableBytes);
-        if ( !action ) break;
-        action->action(self, action->userInfo);
-        TPCircularBufferConsume(&_mainThreadActionBuffer, sizeof(action_t));
-    }
+#pragma mark - Helpers
+
+- (void)performMaintenance {
+    // Keep sources ready for activation, and room in the index for them, pick up any sources the consumer
+    // thread had no room for, and free retired memory
+    fillSourcePool(self);
+    growSourceIndexIfNeeded(self);
+    if ( _sourceListFull ) {
+        [self publishSourceList];
+    }
+    reclaimRetiredMemory(self);
 }
 
 - (void)respondToChannelCountChange {
     int maxChannelCount = _clientFormat.mChannelsPerFrame;
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( _table[i].source && _table[i].audioDescription.mSampleRate ) {
-            maxChannelCount = MAX(maxChannelCount, _table[i].audioDescription.mChannelsPerFrame);
+    source_t *source;
+    for ( int slot=0; (source = nextSource(self, _registeredSources, &slot)); slot++ ) {
+        if ( source->audioDescription.mSampleRate ) {
+            maxChannelCount = MAX(maxChannelCount, source->audioDescription.mChannelsPerFrame);
         }
     }
     
@@ -1284,27 +1420,29 @@ static OSStatus sourceInputCallback(void *inRefCon, AudioUnitRenderActionFlags *
         _scratchBuffer = (uint8_t*)malloc(kScratchBufferBytesPerChannel * maxChannelCount);
         assert(_scratchBuffer);
         
-        if ( _microfadeBuffer ) {
-            for ( int i=0; i<_configuredChannels * 2; i++ ) {
-                free(_microfadeBuffer[i]);
-            }
-            free(_microfadeBuffer);
+        if ( _sourceScratchBuffer ) {
+            free(_sourceScratchBuffer);
         }
         
-        _microfadeBuffer = (float**)malloc(sizeof(float*) * maxChannelCount * 2);
-        for ( int i=0; i<maxChannelCount * 2; i++ ) {
-            _microfadeBuffer[i] = (float*)malloc(sizeof(float) * kMaxMicrofadeDuration);
-            assert(_microfadeBuffer[i]);
-        }
+        _sourceScratchBuffer = (uint8_t*)malloc(kMixBufferFrames * sizeof(float) * maxChannelCount);
+        assert(_sourceScratchBuffer);
+        
+        freeChannelBuffers(_mixBuffers, _configuredChannels);
+        freeChannelBuffers(_sourceMixBuffers, _configuredChannels);
+        freeChannelBuffers(_microfadeBuffer, _configuredChannels * 2);
         
-        for ( int i=0; i<kMaxSources; i++ ) {
-            if ( _table[i].source && !_table[i].renderCallback && !_table[i].audioDescription.mSampleRate ) {
+        _mixBuffers = allocateChannelBuffers(maxChannelCount, kMixBufferFrames);
+        _sourceMixBuffers = allocateChannelBuffers(maxChannelCount, kMixBufferFrames);
+        _microfadeBuffer = allocateChannelBuffers(maxChannelCount * 2, kMaxMicrofadeDuration);
+        
+        for ( int slot=0; (source = nextSource(self, _registeredSources, &slot)); slot++ ) {
+            if ( !source->renderCallback && !source->audioDescription.mSampleRate ) {
                 int bufferSize = kSourceBufferFrames * (_clientFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved ? _clientFormat.mBytesPerFrame * _clientFormat.mChannelsPerFrame : _clientFormat.mBytesPerFrame);
-                if ( _table[i].buffer.length != bufferSize ) {
-                    TPCircularBufferCleanup(&_table[i].buffer);
-                    TPCircularBufferInit(&_table[i].buffer, bufferSize);
+                if ( source->buffer.length != bufferSize ) {
+                    TPCircularBufferCleanup(&source->buffer);
+                    TPCircularBufferInit(&source->buffer, bufferSize);
                 } else {
-                    TPCircularBufferClear(&_table[i].buffer);
+                    TPCircularBufferClear(&source->buffer);
                 }
             }
         }
@@ -1313,42 +1451,358 @@ static OSStatus sourceInputCallback(void *inRefCon, AudioUnitRenderActionFlags *
     }
 }
 
-static inline source_t *sourceWithID(__unsafe_unretained AEMixerBuffer *THIS, AEMixerBufferSource sourceID, int *index) {
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( THIS->_table[i].source == sourceID ) {
-            if ( index ) *index = i;
-            return &THIS->_table[i];
+#pragma mark - Source table
+
+static inline uint32_t hashSourceID(AEMixerBufferSource sourceID) {
+    uint64_t key = (uintptr_t)sourceID;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+static inline source_t *sourceWithID(__unsafe_unretained AEMixerBuffer *THIS, AEMixerBufferSource sourceID) {
+    if ( !sourceID ) return NULL;
+    
+    // The index may be replaced at any time, so stay in the epoch while we use it
+    int32_t epoch = enterEpoch(THIS);
+    sourceIndex_t *index = THIS->_sourceIndex;
+    source_t *result = NULL;
+    if ( index ) {
+        uint32_t i = hashSourceID(sourceID) & index->mask;
+        for ( uint32_t probes = 0; probes <= index->mask && index->entries[i].source; probes++, i = (i+1) & index->mask ) {
+            if ( index->entries[i].id == sourceID ) {
+                // The record may since have been unregistered, or reused by another source
+                source_t *source = index->entries[i].source;
+                if ( source->source == sourceID ) {
+                    result = source;
+                    break;
+                }
+            }
+        }
+    }
+    leaveEpoch(THIS, epoch);
+    return result;
+}
+
+static source_t *nextSource(__unsafe_unretained AEMixerBuffer *THIS, const volatile uint64_t *bitmap, int *ioSlot) {
+    // Find the first source at or after the given slot with its bit set
+    for ( int chunk = *ioSlot / kSourceChunkSize; chunk < kMaxSourceChunks; chunk++ ) {
+        uint64_t bits = bitmap[chunk];
+        if ( chunk == *ioSlot / kSourceChunkSize ) {
+            bits &= ~0ULL << (*ioSlot % kSourceChunkSize);
+        }
+        if ( bits ) {
+            *ioSlot = chunk * kSourceChunkSize + __builtin_ctzll(bits);
+            return &THIS->_sourceChunks[chunk][*ioSlot % kSourceChunkSize];
         }
     }
     return NULL;
 }
 
-static inline void unregisterSources(__unsafe_unretained AEMixerBuffer *THIS) {
-    for ( int i=0; i<kMaxSources; i++ ) {
-        if ( THIS->_table[i].unregistering ) {
-            THIS->_table[i].source = NULL;
+static inline void setSourceBit(volatile uint64_t *bitmap, int slot, BOOL set) {
+    // Bitmaps are shared with enqueue threads activating sources, so update them atomically
+    volatile uint64_t *word = &bitmap[slot / kSourceChunkSize];
+    uint64_t bit = 1ULL << (slot % kSourceChunkSize);
+    uint64_t value;
+    do {
+        value = *word;
+    } while ( !OSAtomicCompareAndSwap64Barrier((int64_t)value, (int64_t)(set ? value | bit : value & ~bit), (volatile int64_t*)word) );
+}
+
+static BOOL insertIntoSourceIndex(sourceIndex_t *index, source_t *source) {
+    // Use the source's existing entry if it has one, or the first entry that's free for reuse on its probe
+    // sequence, otherwise a fresh one at the end, if the index isn't too full. Other threads may be adding
+    // sources at the same time, so fresh entries are claimed by swapping in their record, and reused ones
+    // by swapping in their ID; readers check the record matches, so they skip an entry until it's complete.
+    if ( !index ) return NO;
+    AEMixerBufferSource sourceID = source->source;
+    uint32_t i = hashSourceID(sourceID) & index->mask;
+    for ( uint32_t probes = 0; probes <= index->mask; ) {
+        sourceIndexEntry_t *entry = &index->entries[i];
+        source_t *entrySource = entry->source;
+        AEMixerBufferSource entryID = entry->id;
+        
+        if ( !entrySource ) {
+            if ( (index->used + 1) * 4 > (int32_t)(index->mask + 1) * 3 ) return NO;
+            if ( OSAtomicCompareAndSwapPtrBarrier(NULL, source, (void* volatile *)&entry->source) ) {
+                OSAtomicIncrement32Barrier(&index->used);
+                entry->id = sourceID;
+                return YES;
+            }
+            continue;
+        }
+        
+        if ( entryID && (entryID == sourceID || entrySource->source != entryID) ) {
+            if ( OSAtomicCompareAndSwapPtrBarrier(entryID, sourceID, (void* volatile *)&entry->id) ) {
+                entry->source = source;
+                OSMemoryBarrier();
+                return YES;
+            }
+            continue;
         }
+        
+        i = (i+1) & index->mask;
+        probes++;
     }
+    return NO;
 }
 
-static void prepareNewSource(__unsafe_unretained AEMixerBuffer *THIS, AEMixerBufferSource sourceID) {
-    if ( sourceWithID(THIS, sourceID, NULL) ) return;
+static void growSourceIndexIfNeeded(__unsafe_unretained AEMixerBuffer *THIS) {
+    pthread_mutex_lock(&THIS->_maintenanceMutex);
     
-    source_t *source = sourceWithID(THIS, NULL, NULL);
-    if ( !source ) return;
+    sourceIndex_t *oldIndex = THIS->_sourceIndex;
+    if ( oldIndex && oldIndex->used * 2 <= (int32_t)(oldIndex->mask + 1) ) {
+        pthread_mutex_unlock(&THIS->_maintenanceMutex);
+        return;
+    }
     
-    memset(source, 0, sizeof(source_t));
-    source->volume = 1.0;
-    source->pan = 0.0;
-    source->lastAudioTimestamp = AECurrentTimeInHostTicks();
-    prepareSkipFadeBufferForSource(THIS, source);
+    // Build a new index with just the registered sources, leaving plenty of room for new ones, and swap it in
+    int count = 0;
+    for ( int i=0; i<kMaxSourceChunks; i++ ) {
+        count += __builtin_popcountll(THIS->_registeredSources[i]);
+    }
+    uint32_t size = kMinSourceIndexSize;
+    while ( size < count * 4 ) size *= 2;
     
-    int bufferSize = kSourceBufferFrames * (THIS->_clientFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved ? THIS->_clientFormat.mBytesPerFrame * THIS->_clientFormat.mChannelsPerFrame : THIS->_clientFormat.mBytesPerFrame);
-    TPCircularBufferInit(&source->buffer, bufferSize);
+    sourceIndex_t *index = (sourceIndex_t*)calloc(1, sizeof(sourceIndex_t) + size * sizeof(sourceIndexEntry_t));
+    if ( !index ) {
+        // Carry on with the old index; activations fail once it's full, and we'll try again next time
+        NSLog(@"AEMixerBuffer: Couldn't allocate source index");
+        pthread_mutex_unlock(&THIS->_maintenanceMutex);
+        return;
+    }
+    index->mask = size - 1;
+    source_t *source;
+    for ( int slot=0; (source = nextSource(THIS, THIS->_registeredSources, &slot)); slot++ ) {
+        if ( source->source ) {
+            insertIntoSourceIndex(index, source);
+        }
+    }
     
+    OSAtomicCompareAndSwapPtrBarrier(oldIndex, index, (void* volatile *)&THIS->_sourceIndex);
+    
+    if ( oldIndex ) {
+        retireMemory(THIS, oldIndex);
+        
+        // Sources activated while we were building may only have made it into the old index. Once
+        // nothing's still adding to that, add any that are missing.
+        waitForReaders(THIS);
+        for ( int slot=0; (source = nextSource(THIS, THIS->_registeredSources, &slot)); slot++ ) {
+            if ( source->source && sourceWithID(THIS, source->source) != source ) {
+                insertIntoSourceIndex(index, source);
+            }
+        }
+    }
+    
+    pthread_mutex_unlock(&THIS->_maintenanceMutex);
+}
+
+static void fillSourcePool(__unsafe_unretained AEMixerBuffer *THIS) {
+    // Prepare sources ahead of time, with their buffers allocated, so any thread can activate one
+    pthread_mutex_lock(&THIS->_maintenanceMutex);
+    
+    int pooled = 0;
+    for ( int i=0; i<kMaxSourceChunks; i++ ) {
+        pooled += __builtin_popcountll(THIS->_pooledSources[i]);
+    }
+    
+    for ( int chunk=0; chunk<kMaxSourceChunks && pooled < kSourcePoolSize; chunk++ ) {
+        while ( ~THIS->_allocatedSources[chunk] && pooled < kSourcePoolSize ) {
+            int index = __builtin_ctzll(~THIS->_allocatedSources[chunk]);
+            if ( !THIS->_sourceChunks[chunk] ) {
+                THIS->_sourceChunks[chunk] = (source_t*)calloc(kSourceChunkSize, sizeof(source_t));
+                assert(THIS->_sourceChunks[chunk]);
+            }
+            
+            source_t *source = &THIS->_sourceChunks[chunk][index];
+            memset(source, 0, sizeof(source_t));
+            source->slot = chunk * kSourceChunkSize + index;
+            source->volume = 1.0;
+            source->pan = 0.0;
+            prepareSkipFadeBufferForSource(THIS, source);
+            int bufferSize = kSourceBufferFrames * (THIS->_clientFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved ? THIS->_clientFormat.mBytesPerFrame * THIS->_clientFormat.mChannelsPerFrame : THIS->_clientFormat.mBytesPerFrame);
+            TPCircularBufferInit(&source->buffer, bufferSize);
+            
+            THIS->_allocatedSources[chunk] |= 1ULL << index;
+            OSMemoryBarrier();
+            setSourceBit(THIS->_pooledSources, source->slot, YES);
+            pooled++;
+        }
+    }
+    
+    pthread_mutex_unlock(&THIS->_maintenanceMutex);
+}
+
+static void drainSourcePool(__unsafe_unretained AEMixerBuffer *THIS) {
+    pthread_mutex_lock(&THIS->_maintenanceMutex);
+    source_t *source;
+    while ( (source = takeSourceFromPool(THIS)) ) {
+        TPCircularBufferCleanup(&source->buffer);
+        freeSkipFadeBufferForSource(source);
+        THIS->_allocatedSources[source->slot / kSourceChunkSize] &= ~(1ULL << (source->slot % kSourceChunkSize));
+    }
+    pthread_mutex_unlock(&THIS->_maintenanceMutex);
+}
+
+static source_t *takeSourceFromPool(__unsafe_unretained AEMixerBuffer *THIS) {
+    for ( int chunk=0; chunk<kMaxSourceChunks; chunk++ ) {
+        uint64_t bits;
+        while ( (bits = THIS->_pooledSources[chunk]) ) {
+            uint64_t bit = bits & -bits;
+            if ( OSAtomicCompareAndSwap64Barrier((int64_t)bits, (int64_t)(bits & ~bit), (volatile int64_t*)&THIS->_pooledSources[chunk]) ) {
+                return &THIS->_sourceChunks[chunk][__builtin_ctzll(bit)];
+            }
+        }
+    }
+    return NULL;
+}
+
+static void returnSourceToPool(__unsafe_unretained AEMixerBuffer *THIS, source_t *source) {
+    setSourceBit(THIS->_pooledSources, source->slot, YES);
+}
+
+static BOOL activateSource(__unsafe_unretained AEMixerBuffer *THIS, source_t *source, AEMixerBufferSource sourceID) {
+    // Register the prepared record and make it visible to lookups, then hand it to the consumer thread,
+    // which adds it to the mix on its next dequeue
+    source->lastAudioTimestamp = AECurrentTimeInHostTicks();
+    setSourceBit(THIS->_registeredSources, source->slot, YES);
     OSMemoryBarrier();
     source->source = sourceID;
-    [THIS refreshMixingGraph];
+    
+    int32_t epoch = enterEpoch(THIS);
+    BOOL indexed = insertIntoSourceIndex(THIS->_sourceIndex, source);
+    leaveEpoch(THIS, epoch);
+    
+    if ( !indexed ) {
+        // The index is full; the maintenance thread will replace it shortly
+        source->source = NULL;
+        setSourceBit(THIS->_registeredSources, source->slot, NO);
+        return NO;
+    }
+    
+    setSourceLive(THIS, source, YES);
+    pushPendingSource(THIS, source);
+    
+    return YES;
+}
+
+static void pushPendingSource(__unsafe_unretained AEMixerBuffer *THIS, source_t *source) {
+    // Hand a source to the consumer thread, to add to its list. A source that's already waiting stays put.
+    if ( !OSAtomicCompareAndSwap32Barrier(0, 1, &source->pending) ) return;
+    source_t *pending;
+    do {
+        pending = THIS->_pendingSources;
+        source->nextPending = pending;
+    } while ( !OSAtomicCompareAndSwapPtrBarrier(pending, source, (void* volatile *)&THIS->_pendingSources) );
+}
+
+static source_t *takePendingSources(__unsafe_unretained AEMixerBuffer *THIS) {
+    // Take the whole list of waiting sources. Clear each one's pending flag once done with its link.
+    source_t *pending;
+    do {
+        pending = THIS->_pendingSources;
+    } while ( pending && !OSAtomicCompareAndSwapPtrBarrier(pending, NULL, (void* volatile *)&THIS->_pendingSources) );
+    return pending;
+}
+
+static void releaseSource(__unsafe_unretained AEMixerBuffer *THIS, source_t *source) {
+    // The record, and its index entry, stay put; clearing the ID is enough to stop lookups finding it
+    pthread_mutex_lock(&THIS->_maintenanceMutex);
+    int slot = source->slot;
+    memset(source, 0, sizeof(source_t));
+    setSourceBit(THIS->_registeredSources, slot, NO);
+    setSourceBit(THIS->_liveSources, slot, NO);
+    THIS->_allocatedSources[slot / kSourceChunkSize] &= ~(1ULL << (slot % kSourceChunkSize));
+    pthread_mutex_unlock(&THIS->_maintenanceMutex);
+}
+
+static void setSourceLive(__unsafe_unretained AEMixerBuffer *THIS, source_t *source, BOOL live) {
+    setSourceBit(THIS->_liveSources, source->slot, live);
+}
+
+static void prepareNewSource(__unsafe_unretained AEMixerBuffer *THIS, AEMixerBufferSource sourceID) {
+    if ( sourceWithID(THIS, sourceID) ) return;
+    
+    fillSourcePool(THIS);
+    source_t *source = takeSourceFromPool(THIS);
+    if ( !source ) {
+        NSLog(@"AEMixerBuffer: Can't add source %p; already mixing %d sources", sourceID, kMaxSourceChunks * kSourceChunkSize);
+        return;
+    }
+    
+    if ( !activateSource(THIS, source, sourceID) ) {
+        growSourceIndexIfNeeded(THIS);
+        if ( !activateSource(THIS, source, sourceID) ) {
+            NSLog(@"AEMixerBuffer: Couldn't activate source %p", sourceID);
+            returnSourceToPool(THIS, source);
+        }
+    }
+}
+
+#pragma mark - Reclamation
+
+// Threads reading shared structures - the consumer thread with its source list, and any thread looking up
+// a source - count themselves into the current epoch for the duration. Memory replaced by a writer is
+// retired, then freed once the epoch has moved on and the readers in the old one have left. Readers never
+// wait, and only writers, off the realtime threads, block.
+
+static inline int32_t enterEpoch(__unsafe_unretained AEMixerBuffer *THIS) {
+    while ( 1 ) {
+        int32_t epoch = THIS->_epoch;
+        OSAtomicIncrement32Barrier(&THIS->_epochReaders[epoch & 1]);
+        if ( THIS->_epoch == epoch ) return epoch;
+        
+        // The epoch moved on meanwhile; try again in the new one
+        OSAtomicDecrement32Barrier(&THIS->_epochReaders[epoch & 1]);
+    }
+}
+
+static inline void leaveEpoch(__unsafe_unretained AEMixerBuffer *THIS, int32_t epoch) {
+    OSAtomicDecrement32Barrier(&THIS->_epochReaders[epoch & 1]);
+}
+
+static void retireMemory(__unsafe_unretained AEMixerBuffer *THIS, void *memory) {
+    retired_t *retired = (retired_t*)malloc(sizeof(retired_t));
+    if ( !retired ) {
+        // No room to queue it, so wait for readers to move on here instead
+        waitForReaders(THIS);
+        free(memory);
+        return;
+    }
+    retired->memory = memory;
+    do {
+        retired->next = THIS->_retired;
+    } while ( !OSAtomicCompareAndSwapPtrBarrier(retired->next, retired, (void* volatile *)&THIS->_retired) );
+}
+
+static void waitForReaders(__unsafe_unretained AEMixerBuffer *THIS) {
+    // Move to a new epoch, then wait for readers in the old one to leave: after this, nothing retired
+    // beforehand is still in use. Never call this from within an epoch.
+    pthread_mutex_lock(&THIS->_epochMutex);
+    int32_t epoch = THIS->_epoch;
+    OSAtomicIncrement32Barrier(&THIS->_epoch);
+    while ( THIS->_epochReaders[epoch & 1] > 0 ) {
+        usleep(500);
+    }
+    pthread_mutex_unlock(&THIS->_epochMutex);
+}
+
+static void reclaimRetiredMemory(__unsafe_unretained AEMixerBuffer *THIS) {
+    retired_t *retired;
+    do {
+        retired = THIS->_retired;
+    } while ( retired && !OSAtomicCompareAndSwapPtrBarrier(retired, NULL, (void* volatile *)&THIS->_retired) );
+    if ( !retired ) return;
+    
+    waitForReaders(THIS);
+    
+    while ( retired ) {
+        retired_t *next = retired->next;
+        free(retired->memory);
+        free(retired);
+        retired = next;
+    }
 }
 
 static void prepareSkipFadeBufferForSource(__unsafe_unretained AEMixerBuffer *THIS, source_t* source) {
@@ -1362,16 +1816,210 @@ static void prepareSkipFadeBufferForSource(__unsafe_unretained AEMixerBuffer *TH
     }
 }
 
+static void freeSkipFadeBufferForSource(source_t* source) {
+    if ( !source->skipFadeBuffer ) return;
+    for ( int j=0; j<source->skipFadeBuffer->mNumberBuffers; j++ ) {
+        free(source->skipFadeBuffer->mBuffers[j].mData);
+    }
+    free(source->skipFadeBuffer);
+    source->skipFadeBuffer = NULL;
+}
+
+static void resampleSource(__unsafe_unretained AEMixerBuffer *THIS, source_t *source, const AEMixerCoreFormat *format, const AudioStreamBasicDescription *audioDescription, float * const *output, UInt32 frames) {
+    double clientRate = THIS->_clientFormat.mSampleRate;
+    double sourceRate = audioDescription->mSampleRate;
+    
+    AudioTimeStamp timestamp;
+    memset(&timestamp, 0, sizeof(timestamp));
+    UInt32 available;
+    if ( source->peekCallback ) {
+        available = source->peekCallback(source->source, &timestamp, source->callbackUserinfo);
+        if ( available == AEMixerBufferSourceInactive ) available = 0;
+    } else {
+        available = TPCircularBufferPeek(&source->buffer, &timestamp, audioDescription);
+    }
+    
+    // Sources that generate audio on demand have no clock of their own to drift
+    BOOL unbounded = available == UINT32_MAX;
+    
+    if ( !source->primed ) {
+        // Wait until the source has buffered enough to ride out timing variations
+        if ( !unbounded && available < (UInt32)(THIS->_driftCompensationLatency * sourceRate) ) {
+            for ( int i=0; i<format->channels; i++ ) {
+                memset(output[i], 0, frames * sizeof(float));
+            }
+            return;
+        }
+        AEMixerCoreResamplerReset(source->resampler);
+    }
+    
+    double ratio = sourceRate / clientRate;
+    
+    if ( !unbounded ) {
+        // Measure how far the playhead lags the source: the time since the next frame to play was
+        // captured, if the source timestamps its audio, as that doesn't jump as new audio arrives.
+        // Otherwise, the number of frames buffered.
+        uint64_t now = AECurrentTimeInHostTicks();
+        double fill = AEMixerCoreResamplerBufferedFrames(source->resampler)
+                        + (available > 0 && (timestamp.mFlags & kAudioTimeStampHostTimeValid) && timestamp.mHostTime < now
+                            ? AESecondsFromHostTicks(now - timestamp.mHostTime) * sourceRate
+                            : available);
+        
+        if ( !source->primed ) {
+            // Hold whatever latency we start with
+            AEMixerCoreDriftTrackerReset(&source->driftTracker, fill);
+        }
+        
+        ratio *= 1.0 + AEMixerCoreDriftTrackerUpdate(&source->driftTracker, fill, sourceRate, (double)frames / clientRate);
+    }
+    
+    source->primed = YES;
+    
+    BOOL nativeFloat = AEMixerCoreFormatIsNativeFloat(format);
+    UInt32 maxChunkFrames = MAX(1, (UInt32)((kResamplerInputFrames - 2*AESampleInterpolationReach - 2) / ratio));
+    
+    for ( UInt32 offset = 0; offset < frames; ) {
+        UInt32 chunkFrames = MIN(frames - offset, maxChunkFrames);
+        
+        UInt32 neededFrames = AEMixerCoreResamplerInputFramesNeeded(source->resampler, chunkFrames, ratio);
+        if ( neededFrames > 0 ) {
+            float *input[AEMixerCoreMaximumChannels];
+            AEMixerCoreResamplerGetInputBuffers(source->resampler, input);
+            
+            // Pull the source's audio: straight into the resampler if it's already in the right format,
+            // otherwise into the source scratch buffer, for conversion
+            UInt32 receivedFrames = unbounded ? neededFrames : MIN(neededFrames, available);
+            if ( receivedFrames > 0 ) {
+                AEAudioBufferListCreateOnStack(sourceBufferList, (*audioDescription));
+                const void *sourceData[AEMixerCoreMaximumChannels];
+                for ( int j=0; j<sourceBufferList->mNumberBuffers; j++ ) {
+                    sourceBufferList->mBuffers[j].mNumberChannels = sourceBufferList->mNumberBuffers == 1 ? audioDescription->mChannelsPerFrame : 1;
+                    sourceBufferList->mBuffers[j].mDataByteSize = receivedFrames * audioDescription->mBytesPerFrame;
+                    sourceBufferList->mBuffers[j].mData = nativeFloat
+                        ? (void*)input[j]
+                        : THIS->_sourceScratchBuffer + j * (kMixBufferFrames * audioDescription->mBytesPerFrame);
+                    sourceData[j] = sourceBufferList->mBuffers[j].mData;
+                }
+                
+                if ( source->renderCallback ) {
+                    source->renderCallback(source->source, receivedFrames, sourceBufferList, &timestamp, source->callbackUserinfo);
+                } else {
+                    TPCircularBufferDequeueBufferListFrames(&source->buffer, &receivedFrames, sourceBufferList, NULL, audioDescription);
+                }
+                
+                if ( !nativeFloat ) {
+                    AEMixerCoreToFloat(format, sourceData, input, receivedFrames);
+                }
+                
+                timestamp.mSampleTime += receivedFrames;
+                timestamp.mHostTime += AEHostTicksFromSeconds((double)receivedFrames / sourceRate);
+                if ( !unbounded ) available -= receivedFrames;
+            }
+            
+            if ( receivedFrames < neededFrames ) {
+                // The source ran dry: play out what we have, then wait for it to refill
+                dprintf(THIS, 1, "Source %p underrun; %u frames short", source->source, (unsigned int)(neededFrames - receivedFrames));
+                for ( int i=0; i<format->channels; i++ ) {
+                    memset(input[i] + receivedFrames, 0, (neededFrames - receivedFrames) * sizeof(float));
+                }
+                source->primed = NO;
+            }
+            
+            AEMixerCoreResamplerCommitInput(source->resampler, neededFrames);
+        }
+        
+        float *chunkOutput[AEMixerCoreMaximumChannels];
+        for ( int i=0; i<format->channels; i++ ) {
+            chunkOutput[i] = output[i] + offset;
+        }
+        AEMixerCoreResamplerRender(source->resampler, chunkOutput, chunkFrames, ratio);
+        
+        offset += chunkFrames;
+    }
+}
+
+static void configurePlayoutForSource(__unsafe_unretained AEMixerBuffer *THIS, source_t *source) {
+    AEMixerCoreResamplerFree(source->resampler);
+    source->resampler = NULL;
+    source->primed = NO;
+    AEJitterBuffer *jitterBuffer = source->jitterBuffer;
+    source->jitterBuffer = NULL;
+    OSMemoryBarrier();
+    AEJitterBufferFree(jitterBuffer);
+    
+    AudioStreamBasicDescription audioDescription = source->audioDescription.mSampleRate ? source->audioDescription : THIS->_clientFormat;
+    const AEMixerCoreFormat *format = source->audioDescription.mSampleRate
+        ? (source->hasMixFormat ? &source->mixFormat : NULL)
+        : (THIS->_hasClientMixFormat ? &THIS->_clientMixFormat : NULL);
+    
+    if ( !format || !audioDescription.mSampleRate || !THIS->_clientFormat.mSampleRate ) return;
+    
+    if ( source->jitterBufferMode ) {
+        if ( source->renderCallback ) {
+            NSLog(@"AEMixerBuffer: Jitter buffer mode is only available for sources that enqueue audio, not source %p", source->source);
+        } else if ( audioDescription.mSampleRate != THIS->_clientFormat.mSampleRate ) {
+            NSLog(@"AEMixerBuffer: Jitter buffer mode needs source %p to be at the client sample rate", source->source);
+        } else {
+            jitterBuffer = AEJitterBufferNew(format->channels, audioDescription.mSampleRate, kJitterBufferPacketFrames, kJitterBufferPackets);
+            if ( !jitterBuffer ) {
+                NSLog(@"AEMixerBuffer: Couldn't create jitter buffer for source %p", source->source);
+            } else {
+                AEJitterBufferSetConcealment(jitterBuffer, THIS->_jitterConcealment);
+                OSMemoryBarrier();
+                source->jitterBuffer = jitterBuffer;
+                return;
+            }
+        }
+    }
+    
+    // Sources at another rate are always resampled; the rest only if asked
+    if ( !source->driftCompensation && audioDescription.mSampleRate == THIS->_clientFormat.mSampleRate ) return;
+    
+    source->resampler = AEMixerCoreResamplerNew(format->channels, kResamplerInputFrames,
+                                                audioDescription.mSampleRate / THIS->_clientFormat.mSampleRate * (1.0 + AEMixerCoreDriftMaximumCorrection));
+    if ( !source->resampler ) {
+        NSLog(@"AEMixerBuffer: Couldn't create resampler for source %p", source->source);
+    }
+}
+
+static float **allocateChannelBuffers(int channels, UInt32 frames) {
+    float **buffers = (float**)malloc(sizeof(float*) * channels);
+    assert(buffers);
+    for ( int i=0; i<channels; i++ ) {
+        buffers[i] = (float*)malloc(sizeof(float) * frames);
+        assert(buffers[i]);
+    }
+    return buffers;
+}
+
+static void freeChannelBuffers(float **buffers, int channels) {
+    if ( !buffers ) return;
+    for ( int i=0; i<channels; i++ ) {
+        free(buffers[i]);
+    }
+    free(buffers);
+}
+
 @end
 
 
-@implementation AEMixerBufferPollProxy
+@implementation AEMixerBufferMaintenanceThread {
+    __weak AEMixerBuffer *_mixerBuffer;
+}
 - (id)initWithMixerBuffer:(AEMixerBuffer*)mixerBuffer {
     if ( !(self = [super init]) ) return nil;
     _mixerBuffer = mixerBuffer;
     return self;
 }
-- (void)pollActionBuffer {
-    [_mixerBuffer pollActionBuffer];
+- (void)main {
+    @autoreleasepool {
+        pthread_setname_np("com.theamazingaudioengine.AEMixerBufferMaintenanceThread");
+        while ( !self.isCancelled ) {
+            @autoreleasepool {
+                [_mixerBuffer performMaintenance];
+                usleep(kMaintenanceInterval*1.0e6);
+            }
+        }
+    }
 }
 @end
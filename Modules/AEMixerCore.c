@@ -0,0 +1,406 @@
+//
+//  AEMixerCore.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AEMixerCore.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+// The loops below are written plainly, with restrict pointers and no branches in their bodies,
+// so that the compiler vectorizes them for whichever SIMD unit the target has
+
+static inline float intScale(const AEMixerCoreFormat *format) {
+    return format->sampleType == AEMixerCoreSampleInt16 ? 32768.0f : (float)((uint64_t)1 << format->fractionBits);
+}
+
+#ifdef __APPLE__
+bool AEMixerCoreFormatForAudioDescription(const AudioStreamBasicDescription *audioDescription, AEMixerCoreFormat *outFormat) {
+    if ( audioDescription->mFormatID != kAudioFormatLinearPCM
+            || (audioDescription->mFormatFlags & kAudioFormatFlagIsBigEndian)
+            || audioDescription->mChannelsPerFrame == 0
+            || audioDescription->mChannelsPerFrame > AEMixerCoreMaximumChannels ) {
+        return false;
+    }
+
+    bool nonInterleaved = audioDescription->mFormatFlags & kAudioFormatFlagIsNonInterleaved;
+    uint32_t bytesPerSample = nonInterleaved ? audioDescription->mBytesPerFrame : audioDescription->mBytesPerFrame / audioDescription->mChannelsPerFrame;
+
+    outFormat->channels = audioDescription->mChannelsPerFrame;
+    outFormat->interleaved = !nonInterleaved;
+    outFormat->fractionBits = 0;
+
+    if ( audioDescription->mFormatFlags & kAudioFormatFlagIsFloat ) {
+        if ( audioDescription->mBitsPerChannel != 32 || bytesPerSample != 4 ) return false;
+        outFormat->sampleType = AEMixerCoreSampleFloat32;
+    } else if ( audioDescription->mFormatFlags & kAudioFormatFlagIsSignedInteger ) {
+        if ( audioDescription->mBitsPerChannel == 16 && bytesPerSample == 2 ) {
+            outFormat->sampleType = AEMixerCoreSampleInt16;
+        } else if ( bytesPerSample == 4 && audioDescription->mBitsPerChannel <= 32 ) {
+            // Plain integers use all but the sign bit as fraction; fixed-point formats like 8.24 say how many bits they use
+            outFormat->sampleType = AEMixerCoreSampleInt32;
+            uint32_t fractionBits = (audioDescription->mFormatFlags & kLinearPCMFormatFlagsSampleFractionMask) >> kLinearPCMFormatFlagsSampleFractionShift;
+            outFormat->fractionBits = fractionBits ? fractionBits
+                : (audioDescription->mFormatFlags & kAudioFormatFlagIsAlignedHigh) ? 31 : audioDescription->mBitsPerChannel - 1;
+        } else {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    return true;
+}
+#endif
+
+void AEMixerCoreToFloat(const AEMixerCoreFormat *format, const void * const *source, float * const *target, uint32_t frames) {
+    const uint32_t channels = format->channels;
+    const uint32_t stride = format->interleaved ? channels : 1;
+
+    for ( uint32_t channel=0; channel<channels; channel++ ) {
+        float * restrict out = target[channel];
+        size_t offset = format->interleaved ? channel : 0;
+        const void *in = source[format->interleaved ? 0 : channel];
+
+        switch ( format->sampleType ) {
+            case AEMixerCoreSampleFloat32: {
+                const float * restrict s = (const float*)in + offset;
+                if ( stride == 1 ) {
+                    memcpy(out, s, frames * sizeof(float));
+                } else {
+                    for ( uint32_t i=0; i<frames; i++ ) out[i] = s[(size_t)i * stride];
+                }
+                break;
+            }
+            case AEMixerCoreSampleInt16: {
+                const int16_t * restrict s = (const int16_t*)in + offset;
+                const float scale = 1.0f / intScale(format);
+                for ( uint32_t i=0; i<frames; i++ ) out[i] = (float)s[(size_t)i * stride] * scale;
+                break;
+            }
+            case AEMixerCoreSampleInt32: {
+                const int32_t * restrict s = (const int32_t*)in + offset;
+                const float scale = 1.0f / intScale(format);
+                for ( uint32_t i=0; i<frames; i++ ) out[i] = (float)s[(size_t)i * stride] * scale;
+                break;
+            }
+        }
+    }
+}
+
+void AEMixerCoreFromFloat(const AEMixerCoreFormat *format, const float * const *source, void * const *target, uint32_t frames) {
+    const uint32_t channels = format->channels;
+    const uint32_t stride = format->interleaved ? channels : 1;
+
+    for ( uint32_t channel=0; channel<channels; channel++ ) {
+        const float * restrict in = source[channel];
+        size_t offset = format->interleaved ? channel : 0;
+        void *out = target[format->interleaved ? 0 : channel];
+
+        switch ( format->sampleType ) {
+            case AEMixerCoreSampleFloat32: {
+                float * restrict t = (float*)out + offset;
+                if ( stride == 1 ) {
+                    memcpy(t, in, frames * sizeof(float));
+                } else {
+                    for ( uint32_t i=0; i<frames; i++ ) t[(size_t)i * stride] = in[i];
+                }
+                break;
+            }
+            case AEMixerCoreSampleInt16: {
+                int16_t * restrict t = (int16_t*)out + offset;
+                const float scale = intScale(format);
+                for ( uint32_t i=0; i<frames; i++ ) {
+                    float value = in[i] * scale;
+                    value = value > 32767.0f ? 32767.0f : value < -32768.0f ? -32768.0f : value;
+                    t[(size_t)i * stride] = (int16_t)lrintf(value);
+                }
+                break;
+            }
+            case AEMixerCoreSampleInt32: {
+                int32_t * restrict t = (int32_t*)out + offset;
+                const float scale = intScale(format);
+                // 2147483520 is the largest float below 2^31, so the conversion can't overflow
+                for ( uint32_t i=0; i<frames; i++ ) {
+                    float value = in[i] * scale;
+                    value = value > 2147483520.0f ? 2147483520.0f : value < -2147483648.0f ? -2147483648.0f : value;
+                    t[(size_t)i * stride] = (int32_t)lrintf(value);
+                }
+                break;
+            }
+        }
+    }
+}
+
+void AEMixerCoreGainsForVolumeAndPan(float volume, float pan, uint32_t outputChannels, float *gains) {
+    for ( uint32_t i=0; i<outputChannels; i++ ) gains[i] = volume;
+    if ( outputChannels == 2 ) {
+        pan = pan < -1.0f ? -1.0f : pan > 1.0f ? 1.0f : pan;
+        gains[0] *= pan > 0.0f ? 1.0f - pan : 1.0f;
+        gains[1] *= pan < 0.0f ? 1.0f + pan : 1.0f;
+    }
+}
+
+void AEMixerCoreApplyRamp(float * restrict buffer, uint32_t frames, float startGain, float endGain) {
+    if ( frames == 0 ) return;
+    if ( startGain == endGain ) {
+        if ( startGain == 1.0f ) return;
+        for ( uint32_t i=0; i<frames; i++ ) buffer[i] *= startGain;
+        return;
+    }
+    const float step = (endGain - startGain) / (float)frames;
+    for ( uint32_t i=0; i<frames; i++ ) buffer[i] *= startGain + (float)i * step;
+}
+
+void AEMixerCoreAddWithRamp(const float * restrict source, float * restrict target, uint32_t frames, float startGain, float endGain) {
+    if ( frames == 0 ) return;
+    if ( startGain == endGain ) {
+        if ( startGain == 0.0f ) return;
+        if ( startGain == 1.0f ) {
+            for ( uint32_t i=0; i<frames; i++ ) target[i] += source[i];
+        } else {
+            for ( uint32_t i=0; i<frames; i++ ) target[i] += source[i] * startGain;
+        }
+        return;
+    }
+    const float step = (endGain - startGain) / (float)frames;
+    for ( uint32_t i=0; i<frames; i++ ) target[i] += source[i] * (startGain + (float)i * step);
+}
+
+void AEMixerCoreMix(const float * const *source, uint32_t sourceChannels,
+                    float * const *output, uint32_t outputChannels,
+                    uint32_t frames, const float *startGains, const float *endGains) {
+    if ( sourceChannels == 1 ) {
+        // Mono source: play on every output channel
+        for ( uint32_t channel=0; channel<outputChannels; channel++ ) {
+            AEMixerCoreAddWithRamp(source[0], output[channel], frames, startGains[channel], endGains[channel]);
+        }
+    } else if ( outputChannels == 1 ) {
+        // Mono output: average the source channels
+        const float scale = 1.0f / (float)sourceChannels;
+        for ( uint32_t channel=0; channel<sourceChannels; channel++ ) {
+            AEMixerCoreAddWithRamp(source[channel], output[0], frames, startGains[0] * scale, endGains[0] * scale);
+        }
+    } else {
+        // Channel to channel
+        uint32_t channels = sourceChannels < outputChannels ? sourceChannels : outputChannels;
+        for ( uint32_t channel=0; channel<channels; channel++ ) {
+            AEMixerCoreAddWithRamp(source[channel], output[channel], frames, startGains[channel], endGains[channel]);
+        }
+    }
+}
+
+#pragma mark - Drift compensation
+
+// Loop natural frequency 0.08 rad/s (about 0.013 Hz), damping 0.707, on a fill error measured in seconds
+static const double kDriftProportionalGain   = 0.113;
+static const double kDriftIntegralGain       = 0.0064;
+static const double kDriftFilterTimeConstant = 0.6;     // Seconds, per low-pass stage
+
+void AEMixerCoreDriftTrackerReset(AEMixerCoreDriftTracker *tracker, double targetFill) {
+    memset(tracker, 0, sizeof(AEMixerCoreDriftTracker));
+    tracker->target = targetFill;
+}
+
+double AEMixerCoreDriftTrackerUpdate(AEMixerCoreDriftTracker *tracker, double fill, double sampleRate, double elapsed) {
+    if ( !tracker->initialized ) {
+        tracker->filtered[0] = tracker->filtered[1] = fill;
+        tracker->initialized = true;
+    }
+
+    double coefficient = 1.0 - exp(-elapsed / kDriftFilterTimeConstant);
+    tracker->filtered[0] += coefficient * (fill - tracker->filtered[0]);
+    tracker->filtered[1] += coefficient * (tracker->filtered[0] - tracker->filtered[1]);
+
+    double error = (tracker->filtered[1] - tracker->target) / sampleRate;
+
+    tracker->integral += kDriftIntegralGain * error * elapsed;
+    tracker->integral = fmax(-AEMixerCoreDriftMaximumCorrection, fmin(AEMixerCoreDriftMaximumCorrection, tracker->integral));
+
+    tracker->correction = fmax(-AEMixerCoreDriftMaximumCorrection, fmin(AEMixerCoreDriftMaximumCorrection, kDriftProportionalGain * error + tracker->integral));
+    return tracker->correction;
+}
+
+#pragma mark - Resampling
+
+#define kMaximumRatio       8.0     // Largest ratio the kernel widens for
+#define kMaximumReach       ((int)(AESampleInterpolationReach * kMaximumRatio))
+#define kKernelResolution   256     // Kernel table points per frame
+
+// One side of the Blackman-windowed sinc used by AESampleInterpolationWindowedSinc, at its
+// natural cutoff, plus a point past the end for interpolation. Downsampling stretches this
+// over more input frames, to move the cutoff down to the output's Nyquist frequency.
+static float __kernelTable[AESampleInterpolationReach * kKernelResolution + 2];
+static pthread_once_t __kernelTableOnce = PTHREAD_ONCE_INIT;
+
+static void buildKernelTable(void) {
+    const int length = AESampleInterpolationReach * kKernelResolution;
+    for ( int i=0; i<=length; i++ ) {
+        double x = (double)i / kKernelResolution;
+        double sinc = x == 0.0 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+        double window = 0.42 + 0.5 * cos(M_PI * x / AESampleInterpolationReach) + 0.08 * cos(2.0 * M_PI * x / AESampleInterpolationReach);
+        __kernelTable[i] = (float)(sinc * window);
+    }
+    __kernelTable[length] = __kernelTable[length + 1] = 0.0f;
+}
+
+static inline float kernel(float x) {
+    // x is in table points, and non-negative
+    if ( x >= AESampleInterpolationReach * kKernelResolution ) return 0.0f;
+    int i = (int)x;
+    float fraction = x - (float)i;
+    return __kernelTable[i] + fraction * (__kernelTable[i+1] - __kernelTable[i]);
+}
+
+struct AEMixerCoreResampler {
+    uint32_t          channels;
+    uint32_t          reach;        // Frames of history and lookahead kept around the playhead
+    uint32_t          capacity;     // Frames per channel buffer
+    uint32_t          buffered;     // Frames held, including history
+    AESamplePosition  position;     // Position of the next output frame, from the start of the buffers
+    float            *buffers[AEMixerCoreMaximumChannels];
+};
+
+AEMixerCoreResampler *AEMixerCoreResamplerNew(uint32_t channels, uint32_t inputCapacity, double maximumRatio) {
+    if ( channels == 0 || channels > AEMixerCoreMaximumChannels ) return NULL;
+
+    AESampleInterpolationPrepare();
+    pthread_once(&__kernelTableOnce, buildKernelTable);
+
+    AEMixerCoreResampler *resampler = (AEMixerCoreResampler*)calloc(1, sizeof(AEMixerCoreResampler));
+    if ( !resampler ) return NULL;
+    resampler->channels = channels;
+    resampler->reach = (uint32_t)ceil(AESampleInterpolationReach * fmin(kMaximumRatio, fmax(1.0, maximumRatio)));
+    resampler->capacity = inputCapacity + 2 * resampler->reach + 2;
+    for ( uint32_t i=0; i<channels; i++ ) {
+        resampler->buffers[i] = (float*)malloc(sizeof(float) * resampler->capacity);
+        if ( !resampler->buffers[i] ) {
+            AEMixerCoreResamplerFree(resampler);
+            return NULL;
+        }
+    }
+    AEMixerCoreResamplerReset(resampler);
+    return resampler;
+}
+
+void AEMixerCoreResamplerFree(AEMixerCoreResampler *resampler) {
+    if ( !resampler ) return;
+    for ( uint32_t i=0; i<resampler->channels; i++ ) {
+        free(resampler->buffers[i]);
+    }
+    free(resampler);
+}
+
+void AEMixerCoreResamplerReset(AEMixerCoreResampler *resampler) {
+    // Start with a window of silence behind the playhead
+    for ( uint32_t i=0; i<resampler->channels; i++ ) {
+        memset(resampler->buffers[i], 0, sizeof(float) * resampler->reach);
+    }
+    resampler->buffered = resampler->reach;
+    resampler->position = (AESamplePosition)resampler->reach << 32;
+}
+
+double AEMixerCoreResamplerBufferedFrames(const AEMixerCoreResampler *resampler) {
+    return (double)resampler->buffered - AESamplePositionToFrames(resampler->position);
+}
+
+uint32_t AEMixerCoreResamplerInputFramesNeeded(const AEMixerCoreResampler *resampler, uint32_t outputFrames, double ratio) {
+    if ( outputFrames == 0 ) return 0;
+    AESamplePosition last = resampler->position + (AESamplePosition)(outputFrames - 1) * AESamplePositionFromFrames(ratio);
+    uint64_t needed = (last >> 32) + resampler->reach + 1;
+    if ( needed <= resampler->buffered ) return 0;
+    needed -= resampler->buffered;
+    return needed > resampler->capacity - resampler->buffered ? resampler->capacity - resampler->buffered : (uint32_t)needed;
+}
+
+void AEMixerCoreResamplerGetInputBuffers(AEMixerCoreResampler *resampler, float **buffers) {
+    for ( uint32_t i=0; i<resampler->channels; i++ ) {
+        buffers[i] = resampler->buffers[i] + resampler->buffered;
+    }
+}
+
+void AEMixerCoreResamplerCommitInput(AEMixerCoreResampler *resampler, uint32_t frames) {
+    resampler->buffered += frames;
+    if ( resampler->buffered > resampler->capacity ) resampler->buffered = resampler->capacity;
+}
+
+static AESamplePosition renderDownsampled(AEMixerCoreResampler *resampler, float * const *output, uint32_t frames, double ratio) {
+    // Stretch the kernel by the ratio, so its cutoff falls at the output's Nyquist frequency, as
+    // far as the reach allows. The weights are normalized, so the gain stays at unity at DC.
+    const int reach = (int)resampler->reach;
+    const float scale = (float)(kKernelResolution * fmax(1.0 / ratio, (double)AESampleInterpolationReach / reach));
+    const AESamplePosition increment = AESamplePositionFromFrames(ratio);
+    AESamplePosition position = resampler->position;
+
+    float weights[2 * kMaximumReach];
+    for ( uint32_t frame=0; frame<frames; frame++, position += increment ) {
+        uint32_t index = (uint32_t)(position >> 32);
+        float fraction = (float)(uint32_t)position * (1.0f / 4294967296.0f);
+
+        // Tap n reads the frame at (index - reach + 1 + n)
+        float sum = 0.0f;
+        for ( int tap=0; tap<2*reach; tap++ ) {
+            weights[tap] = kernel(fabsf((float)(tap - reach + 1) - fraction) * scale);
+            sum += weights[tap];
+        }
+        const float normalize = 1.0f / sum;
+
+        for ( uint32_t i=0; i<resampler->channels; i++ ) {
+            const float * restrict s = resampler->buffers[i] + index - reach + 1;
+            float value = 0.0f;
+            for ( int tap=0; tap<2*reach; tap++ ) value += s[tap] * weights[tap];
+            output[i][frame] = value * normalize;
+        }
+    }
+    return position;
+}
+
+void AEMixerCoreResamplerRender(AEMixerCoreResampler *resampler, float * const *output, uint32_t frames, double ratio) {
+    AESamplePosition position = resampler->position;
+    if ( ratio > 1.0 ) {
+        position = renderDownsampled(resampler, output, frames, ratio);
+    } else {
+        AESamplePosition increment = AESamplePositionFromFrames(ratio);
+        for ( uint32_t i=0; i<resampler->channels; i++ ) {
+            position = AESampleInterpolationRender(AESampleInterpolationWindowedSinc,
+                                                   resampler->buffers[i], 1, resampler->buffered, false,
+                                                   resampler->position, increment,
+                                                   output[i], 1, frames);
+        }
+    }
+    resampler->position = position;
+
+    // Drop input that's fallen out of the window behind the playhead
+    uint32_t index = (uint32_t)(position >> 32);
+    if ( index > resampler->reach ) {
+        uint32_t drop = index - resampler->reach;
+        if ( drop > resampler->buffered ) drop = resampler->buffered;
+        for ( uint32_t i=0; i<resampler->channels; i++ ) {
+            memmove(resampler->buffers[i], resampler->buffers[i] + drop, sizeof(float) * (resampler->buffered - drop));
+        }
+        resampler->buffered -= drop;
+        resampler->position -= (AESamplePosition)drop << 32;
+    }
+}
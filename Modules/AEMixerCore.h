@@ -0,0 +1,321 @@
+//
+//  AEMixerCore.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "AESampleInterpolation.h"
+#ifdef __APPLE__
+#include <CoreAudio/CoreAudioTypes.h>
+#endif
+
+/*!
+ * Maximum number of channels the mixing core handles per source or output
+ */
+#define AEMixerCoreMaximumChannels 16
+
+/*!
+ * @enum AEMixerCoreSampleType
+ *  Sample types understood by the mixing core
+ *
+ * @var AEMixerCoreSampleFloat32
+ *  32-bit native-endian floating point
+ *
+ * @var AEMixerCoreSampleInt16
+ *  16-bit native-endian signed integer
+ *
+ * @var AEMixerCoreSampleInt32
+ *  32-bit native-endian signed integer, with the number of fractional bits given by the
+ *  format's fractionBits: 31 for plain 32-bit integer audio, 24 for 8.24 fixed point
+ */
+typedef enum {
+    AEMixerCoreSampleFloat32,
+    AEMixerCoreSampleInt16,
+    AEMixerCoreSampleInt32
+} AEMixerCoreSampleType;
+
+/*!
+ * A linear PCM audio format, as seen by the mixing core
+ */
+typedef struct {
+    AEMixerCoreSampleType sampleType;   //!< The sample type
+    uint32_t              channels;     //!< Number of channels, up to AEMixerCoreMaximumChannels
+    bool                  interleaved;  //!< Whether channels share one buffer, or have one each
+    uint32_t              fractionBits; //!< Fractional bits of AEMixerCoreSampleInt32 samples
+} AEMixerCoreFormat;
+
+/*!
+ * Whether a format is non-interleaved 32-bit float: the mixing core's own format
+ *
+ *  Audio in this format can be mixed straight from, or into, its buffers.
+ */
+static inline bool AEMixerCoreFormatIsNativeFloat(const AEMixerCoreFormat *format) {
+    return format->sampleType == AEMixerCoreSampleFloat32 && (!format->interleaved || format->channels == 1);
+}
+
+#ifdef __APPLE__
+/*!
+ * Get the mixing core format for a Core Audio stream description
+ *
+ * @param audioDescription  The stream description
+ * @param outFormat         On output, the equivalent mixing core format
+ * @return true if the description is native-endian linear PCM the mixing core handles
+ */
+bool AEMixerCoreFormatForAudioDescription(const AudioStreamBasicDescription *audioDescription, AEMixerCoreFormat *outFormat);
+#endif
+
+/*!
+ * Convert audio to non-interleaved float
+ *
+ * @param format    The format of the source audio
+ * @param source    The source buffers: one if the format is interleaved, else one per channel
+ * @param target    One float buffer per channel
+ * @param frames    Number of frames to convert
+ */
+void AEMixerCoreToFloat(const AEMixerCoreFormat *format, const void * const *source, float * const *target, uint32_t frames);
+
+/*!
+ * Convert audio from non-interleaved float
+ *
+ *  Integer output is clipped to the format's range.
+ *
+ * @param format    The format of the target audio
+ * @param source    One float buffer per channel
+ * @param target    The target buffers: one if the format is interleaved, else one per channel
+ * @param frames    Number of frames to convert
+ */
+void AEMixerCoreFromFloat(const AEMixerCoreFormat *format, const float * const *source, void * const *target, uint32_t frames);
+
+/*!
+ * Calculate per-output-channel gains for a volume and pan
+ *
+ *  For stereo output, pan attenuates the opposite side (a balance control), so a
+ *  centred source plays at full volume on both sides. Other outputs ignore pan.
+ *
+ * @param volume         Volume, 0.0 - 1.0 (or higher, to boost)
+ * @param pan            Pan, -1.0 (left) to 1.0 (right)
+ * @param outputChannels Number of output channels
+ * @param gains          On output, one gain per output channel
+ */
+void AEMixerCoreGainsForVolumeAndPan(float volume, float pan, uint32_t outputChannels, float *gains);
+
+/*!
+ * Multiply a buffer by a linear gain ramp, in place
+ *
+ *  Frame n is multiplied by startGain + n * (endGain - startGain) / frames.
+ *
+ * @param buffer     The buffer
+ * @param frames     Number of frames
+ * @param startGain  Gain at the first frame
+ * @param endGain    Gain following the last frame
+ */
+void AEMixerCoreApplyRamp(float *buffer, uint32_t frames, float startGain, float endGain);
+
+/*!
+ * Add a buffer to another, through a linear gain ramp
+ *
+ *  The ramp is as for @link AEMixerCoreApplyRamp @endlink. A flat ramp takes a faster path.
+ *
+ * @param source     The buffer to add
+ * @param target     The buffer to add to
+ * @param frames     Number of frames
+ * @param startGain  Gain at the first frame
+ * @param endGain    Gain following the last frame
+ */
+void AEMixerCoreAddWithRamp(const float *source, float *target, uint32_t frames, float startGain, float endGain);
+
+/*!
+ * Mix a multi-channel source into a multi-channel output
+ *
+ *  Mono sources play on every output channel, and mono outputs take the average of all
+ *  source channels. Otherwise, each source channel plays on the output channel of the same
+ *  index, and source channels beyond the output's channel count are dropped.
+ *
+ *  Gains ramp linearly from startGains to endGains over the buffer, which removes zipper
+ *  noise when volume or pan change between buffers.
+ *
+ * @param source          One float buffer per source channel
+ * @param sourceChannels  Number of source channels
+ * @param output          One float buffer per output channel, to add to
+ * @param outputChannels  Number of output channels
+ * @param frames          Number of frames
+ * @param startGains      Gain per output channel at the first frame
+ * @param endGains        Gain per output channel following the last frame
+ */
+void AEMixerCoreMix(const float * const *source, uint32_t sourceChannels,
+                    float * const *output, uint32_t outputChannels,
+                    uint32_t frames, const float *startGains, const float *endGains);
+
+#pragma mark - Drift compensation
+
+/*!
+ * Clock drift tracker
+ *
+ *  Estimates the drift between a source's clock and the mixer's, from how the source's
+ *  buffer fill level moves over time, and produces a rate correction that holds the fill
+ *  level at a target.
+ *
+ *  This is a proportional-integral loop, with a natural frequency of about 0.013 Hz, fed
+ *  through a second-order low-pass filter that removes measurement jitter. The integral
+ *  term converges on the true drift, so a constant drift leaves no steady-state error.
+ *
+ *  Measure the fill level from timestamps, as the time between now and the capture time
+ *  of the next frame to play, in frames. A count of buffered frames can't tell where one
+ *  clock's block boundaries fall between the other's, so it jumps by a block as they slide
+ *  past each other, and the loop swings the correction by hundreds of parts per million
+ *  chasing the jumps. For audio without timestamps, stamp each block with its arrival time
+ *  less its duration: the correction then holds to within a part per million or so.
+ *
+ *  Treat this structure as opaque, apart from the correction member.
+ */
+typedef struct {
+    double target;          //!< Target fill level, in frames
+    double filtered[2];     //!< Fill level, through two cascaded one-pole low-pass filters
+    double integral;        //!< Integral term of the loop
+    double correction;      //!< Rate correction: 0.0001 means the source runs 100 ppm fast, and should be consumed faster to match
+    bool   initialized;
+} AEMixerCoreDriftTracker;
+
+/*!
+ * The largest rate correction a drift tracker applies: 5000 ppm
+ */
+#define AEMixerCoreDriftMaximumCorrection 0.005
+
+/*!
+ * Reset a drift tracker
+ *
+ * @param tracker     The tracker
+ * @param targetFill  The fill level to hold, in frames
+ */
+void AEMixerCoreDriftTrackerReset(AEMixerCoreDriftTracker *tracker, double targetFill);
+
+/*!
+ * Update a drift tracker
+ *
+ *  Call this once per buffer, before consuming audio from the source.
+ *
+ * @param tracker     The tracker
+ * @param fill        The source's current fill level, in frames
+ * @param sampleRate  The source's sample rate
+ * @param elapsed     Time since the last update, in seconds
+ * @return The rate correction to apply for the coming buffer
+ */
+double AEMixerCoreDriftTrackerUpdate(AEMixerCoreDriftTracker *tracker, double fill, double sampleRate, double elapsed);
+
+/*!
+ * Streaming resampler
+ *
+ *  Converts a stream of audio between rates, with a ratio that can change on every
+ *  render, using windowed-sinc interpolation. It holds a window of input audio, keeping
+ *  frames of history and lookahead around the playhead, so the stream is continuous across
+ *  renders.
+ *
+ *  When downsampling, the sinc kernel is stretched by the ratio, so that its cutoff falls
+ *  at the output's Nyquist frequency and content above it is filtered out rather than
+ *  aliased. This widens the window by the same factor, up to a ratio of 8; beyond that,
+ *  some aliasing remains.
+ *
+ *  To render, ask for the number of input frames needed with
+ *  @link AEMixerCoreResamplerInputFramesNeeded @endlink, write that many frames into the
+ *  buffers from @link AEMixerCoreResamplerGetInputBuffers @endlink, commit them with
+ *  @link AEMixerCoreResamplerCommitInput @endlink, then call
+ *  @link AEMixerCoreResamplerRender @endlink.
+ */
+typedef struct AEMixerCoreResampler AEMixerCoreResampler;
+
+/*!
+ * Create a resampler
+ *
+ *  Prepares the interpolation tables, so call this outside the realtime thread.
+ *
+ * @param channels       Number of channels
+ * @param inputCapacity  The most input frames that will be needed for one render
+ * @param maximumRatio   The largest ratio that will be rendered at, which sets the width
+ *                       of the window needed to filter out aliasing when downsampling
+ * @return The resampler, or NULL on allocation failure
+ */
+AEMixerCoreResampler *AEMixerCoreResamplerNew(uint32_t channels, uint32_t inputCapacity, double maximumRatio);
+
+/*!
+ * Free a resampler
+ */
+void AEMixerCoreResamplerFree(AEMixerCoreResampler *resampler);
+
+/*!
+ * Reset a resampler, discarding buffered audio
+ *
+ *  The next render starts on silence, fading into the first input frames.
+ */
+void AEMixerCoreResamplerReset(AEMixerCoreResampler *resampler);
+
+/*!
+ * Get the number of input frames buffered ahead of the playhead
+ *
+ *  Add this to a source's own fill level to measure its total latency.
+ */
+double AEMixerCoreResamplerBufferedFrames(const AEMixerCoreResampler *resampler);
+
+/*!
+ * Get the number of input frames to commit before rendering
+ *
+ * @param resampler     The resampler
+ * @param outputFrames  Number of frames to render, no more than the input capacity
+ *                      allows at this ratio
+ * @param ratio         Input frames consumed per output frame
+ * @return Number of input frames to commit
+ */
+uint32_t AEMixerCoreResamplerInputFramesNeeded(const AEMixerCoreResampler *resampler, uint32_t outputFrames, double ratio);
+
+/*!
+ * Get the buffers to write input audio to
+ *
+ * @param resampler  The resampler
+ * @param buffers    On output, one float buffer per channel, with room for the number of
+ *                   frames given by @link AEMixerCoreResamplerInputFramesNeeded @endlink
+ */
+void AEMixerCoreResamplerGetInputBuffers(AEMixerCoreResampler *resampler, float **buffers);
+
+/*!
+ * Commit input audio written to the input buffers
+ */
+void AEMixerCoreResamplerCommitInput(AEMixerCoreResampler *resampler, uint32_t frames);
+
+/*!
+ * Render resampled audio
+ *
+ * @param resampler  The resampler
+ * @param output     One float buffer per channel
+ * @param frames     Number of frames to render
+ * @param ratio      Input frames consumed per output frame: the same value passed to
+ *                   @link AEMixerCoreResamplerInputFramesNeeded @endlink
+ */
+void AEMixerCoreResamplerRender(AEMixerCoreResampler *resampler, float * const *output, uint32_t frames, double ratio);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,353 @@
+//
+//  AEPlaythroughBuffer.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include "AEPlaythroughBuffer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static const double kWindowDuration         = 0.25;   // Seconds over which the low-water mark of the phase is taken
+static const double kMinimumMargin          = 0.0005; // Seconds kept in hand even with no measured jitter
+static const double kJitterMultiple         = 3.0;    // Multiple of the measured timing jitter within which input may swap order with output
+static const double kTimingTolerance        = 0.0001; // Seconds of timing variation too small to matter
+static const double kSlipReleaseTime        = 10.0;   // Seconds for the margin kept against input slipping past output to decay
+static const double kUnderrunPadding        = 0.001;  // Seconds added to the margin after an underrun, beyond the shortfall
+static const double kUnderrunReleaseTime    = 10.0;   // Seconds for the margin added after underruns to decay most of the way
+static const double kTrimTime               = 2.0;    // Seconds over which to trim away excess latency, rate permitting
+static const double kIntegralTime           = 8.0;    // Integral time of the drift-following loop
+static const double kMaximumCorrection      = 0.002;  // Largest rate adjustment
+static const double kMaximumDrift           = 0.001;  // Largest clock drift followed
+static const double kCorrectionSmoothing    = 0.05;   // Seconds over which rate adjustments are eased in
+static const double kMaximumExcess          = 0.1;    // Seconds of excess latency beyond which we jump ahead instead of trimming
+
+struct AEPlaythroughBuffer {
+    uint32_t            channels;
+    double              sampleRate;
+    uint32_t            maxFrames;
+    uint32_t            capacity;           // Ring size in frames; a power of two
+    float              *ring[AEMixerCoreMaximumChannels];
+    volatile uint64_t   writeCount;         // Frames written; advanced by the input thread only
+    volatile uint64_t   readCount;          // Frames consumed; advanced by the output thread only
+    volatile double     lastWriteTime;
+    volatile double     averageWriteFrames;
+
+    // Output state
+    AEMixerCoreResampler *resampler;
+    bool                primed;
+    double              appliedCorrection;
+    double              targetCorrection;
+    double              integral;
+    double              safety;             // Margin added after underruns, in frames
+    double              slipMargin;         // Margin kept in case input arrives after the output it would have fed, in frames
+    bool                hasTimePhase;
+    double              lastTimePhase;
+    double              timeJitter;
+    double              windowTimePhaseMinimum;
+    uint32_t            windowFrames;
+    int64_t             windowMinimum;
+    int64_t             lowWaters[3];
+    int                 lowWaterCount;
+
+    // Statistics, written by one side each
+    volatile uint64_t   underruns;
+    volatile uint64_t   overruns;
+    volatile double     addedLatency;
+    volatile double     margin;
+    volatile double     jitter;
+    volatile double     correction;
+};
+
+AEPlaythroughBuffer *AEPlaythroughBufferNew(uint32_t channels, double sampleRate, uint32_t maxFrames) {
+    if ( channels == 0 || channels > AEMixerCoreMaximumChannels || maxFrames == 0 || sampleRate <= 0 ) return NULL;
+
+    AEPlaythroughBuffer *buffer = (AEPlaythroughBuffer*)calloc(1, sizeof(AEPlaythroughBuffer));
+    if ( !buffer ) return NULL;
+    buffer->channels = channels;
+    buffer->sampleRate = sampleRate;
+    buffer->maxFrames = maxFrames;
+
+    // Room for several periods, and for the most excess we'll trim rather than jump
+    uint32_t required = maxFrames * 4 + (uint32_t)(kMaximumExcess * sampleRate);
+    buffer->capacity = 1;
+    while ( buffer->capacity < required ) buffer->capacity <<= 1;
+
+    bool allocated = true;
+    for ( uint32_t i=0; i<channels && allocated; i++ ) {
+        buffer->ring[i] = (float*)calloc(buffer->capacity, sizeof(float));
+        allocated = buffer->ring[i] != NULL;
+    }
+    if ( allocated ) {
+        buffer->resampler = AEMixerCoreResamplerNew(channels, (uint32_t)ceil(maxFrames * (1.0 + kMaximumCorrection)) + 2*AESampleInterpolationReach + 2,
+                                                    1.0 + kMaximumCorrection);
+        allocated = buffer->resampler != NULL;
+    }
+    if ( !allocated ) {
+        AEPlaythroughBufferFree(buffer);
+        return NULL;
+    }
+
+    buffer->margin = kMinimumMargin * sampleRate;
+
+    return buffer;
+}
+
+void AEPlaythroughBufferFree(AEPlaythroughBuffer *buffer) {
+    if ( !buffer ) return;
+    for ( uint32_t i=0; i<buffer->channels; i++ ) {
+        free(buffer->ring[i]);
+    }
+    AEMixerCoreResamplerFree(buffer->resampler);
+    free(buffer);
+}
+
+#pragma mark - Input
+
+bool AEPlaythroughBufferWrite(AEPlaythroughBuffer *buffer, const AEMixerCoreFormat *format, const void * const *audio, uint32_t frames, double time) {
+    if ( frames == 0 || format->channels != buffer->channels ) return false;
+
+    buffer->lastWriteTime = time;
+    buffer->averageWriteFrames = buffer->averageWriteFrames
+        ? buffer->averageWriteFrames + (frames - buffer->averageWriteFrames) / 16.0
+        : frames;
+
+    uint64_t writeCount = buffer->writeCount;
+    if ( writeCount - buffer->readCount + frames > buffer->capacity ) {
+        buffer->overruns++;
+        return false;
+    }
+
+    // Convert into the ring, in up to two parts either side of the wrap
+    size_t bytesPerSample = format->sampleType == AEMixerCoreSampleInt16 ? 2 : 4;
+    size_t stride = format->interleaved ? bytesPerSample * format->channels : bytesPerSample;
+    uint32_t mask = buffer->capacity - 1;
+    for ( uint32_t offset = 0; offset < frames; ) {
+        uint32_t position = (uint32_t)((writeCount + offset) & mask);
+        uint32_t chunkFrames = frames - offset;
+        if ( chunkFrames > buffer->capacity - position ) chunkFrames = buffer->capacity - position;
+
+        const void *source[AEMixerCoreMaximumChannels];
+        float *target[AEMixerCoreMaximumChannels];
+        for ( uint32_t i=0; i<(format->interleaved ? 1 : format->channels); i++ ) {
+            source[i] = (const char*)audio[i] + offset * stride;
+        }
+        for ( uint32_t i=0; i<buffer->channels; i++ ) {
+            target[i] = buffer->ring[i] + position;
+        }
+        AEMixerCoreToFloat(format, source, target, chunkFrames);
+
+        offset += chunkFrames;
+    }
+
+    // Hand the audio over to the output thread
+    __sync_synchronize();
+    buffer->writeCount = writeCount + frames;
+
+    return true;
+}
+
+#pragma mark - Output
+
+static void consume(AEPlaythroughBuffer *buffer, float * const *target, uint32_t frames) {
+    uint32_t mask = buffer->capacity - 1;
+    uint64_t readCount = buffer->readCount;
+    for ( uint32_t offset = 0; offset < frames; ) {
+        uint32_t position = (uint32_t)((readCount + offset) & mask);
+        uint32_t chunkFrames = frames - offset;
+        if ( chunkFrames > buffer->capacity - position ) chunkFrames = buffer->capacity - position;
+        for ( uint32_t i=0; i<buffer->channels; i++ ) {
+            if ( target ) memcpy(target[i] + offset, buffer->ring[i] + position, chunkFrames * sizeof(float));
+        }
+        offset += chunkFrames;
+    }
+
+    // Give the space back to the input thread
+    __sync_synchronize();
+    buffer->readCount = readCount + frames;
+}
+
+static double targetMargin(const AEPlaythroughBuffer *buffer) {
+    double margin = kMinimumMargin * buffer->sampleRate + buffer->slipMargin + buffer->safety;
+    double limit = buffer->capacity / 2.0;
+    return margin > limit ? limit : margin;
+}
+
+static void endWindow(AEPlaythroughBuffer *buffer) {
+    // The lowest phase seen over the window is how close input came to running dry. Take the median over
+    // the last few windows, so that an occasional slip, which the margin is there to absorb, doesn't
+    // throw the rate around.
+    buffer->lowWaters[buffer->lowWaterCount++ % 3] = buffer->windowMinimum;
+    int64_t a = buffer->lowWaters[0], b = buffer->lowWaters[1], c = buffer->lowWaters[2];
+    int64_t lowWater = buffer->lowWaterCount < 3 ? buffer->windowMinimum
+                     : a > b ? (b > c ? b : a > c ? c : a) : (a > c ? a : b > c ? c : b);
+
+    // Varying callback timing doesn't change what's buffered at each render, unless input comes close
+    // enough before output that it might next arrive after it instead. Then a render may find a whole
+    // input's worth missing, so keep that much in hand.
+    buffer->slipMargin *= exp(-kWindowDuration / kSlipReleaseTime);
+    if ( buffer->windowTimePhaseMinimum < kJitterMultiple * buffer->timeJitter - kTimingTolerance
+            && buffer->slipMargin < buffer->averageWriteFrames ) {
+        buffer->slipMargin = buffer->averageWriteFrames;
+    }
+
+    buffer->safety *= exp(-kWindowDuration / kUnderrunReleaseTime);
+
+    double target = targetMargin(buffer);
+    buffer->margin = target;
+    double error = (double)lowWater - target;
+
+    if ( error > kMaximumExcess * buffer->sampleRate ) {
+        // Too far behind to trim in good time, after a stall perhaps: start again closer in
+        buffer->primed = false;
+        return;
+    }
+
+    // Proportional-integral control: the proportional term trims the excess over a couple of seconds, and
+    // the integral term settles on any drift between the input and output clocks
+    double proportional = error / (buffer->sampleRate * kTrimTime);
+    double correction = proportional + buffer->integral;
+    if ( fabs(correction) < kMaximumCorrection || correction * proportional < 0 ) {
+        // Only integrate while the correction isn't limited, so the integral doesn't wind up
+        buffer->integral += proportional * kWindowDuration / kIntegralTime;
+        buffer->integral = fmax(-kMaximumDrift, fmin(kMaximumDrift, buffer->integral));
+    }
+    buffer->targetCorrection = fmax(-kMaximumCorrection, fmin(kMaximumCorrection, proportional + buffer->integral));
+}
+
+static void measureTimePhase(AEPlaythroughBuffer *buffer, double time) {
+    // How long before this render's cycle the latest input's cycle was, and how much that varies
+    if ( buffer->writeCount == 0 ) return;
+    double phase = time - buffer->lastWriteTime;
+    if ( buffer->hasTimePhase ) {
+        buffer->timeJitter += (fabs(phase - buffer->lastTimePhase) - buffer->timeJitter) / 16.0;
+        buffer->jitter = buffer->timeJitter * buffer->sampleRate;
+    }
+    buffer->lastTimePhase = phase;
+    buffer->hasTimePhase = true;
+    if ( phase < buffer->windowTimePhaseMinimum ) {
+        buffer->windowTimePhaseMinimum = phase;
+    }
+}
+
+static void render(AEPlaythroughBuffer *buffer, float * const *output, uint32_t frames) {
+    uint32_t available = (uint32_t)(buffer->writeCount - buffer->readCount);
+    __sync_synchronize();
+
+    if ( !buffer->primed ) {
+        // Wait until there's enough for this render and the margin, then start from just that far behind
+        // the input; anything older is dropped unheard
+        AEMixerCoreResamplerReset(buffer->resampler);
+        buffer->appliedCorrection = buffer->targetCorrection = buffer->integral;
+        uint32_t needed = AEMixerCoreResamplerInputFramesNeeded(buffer->resampler, frames, 1.0 + buffer->appliedCorrection);
+        uint32_t wanted = needed + (uint32_t)ceil(targetMargin(buffer));
+        if ( available < wanted ) {
+            for ( uint32_t i=0; i<buffer->channels; i++ ) {
+                memset(output[i], 0, frames * sizeof(float));
+            }
+            return;
+        }
+        consume(buffer, NULL, available - wanted);
+        available = wanted;
+        buffer->primed = true;
+        buffer->windowFrames = 0;
+        buffer->lowWaterCount = 0;
+        buffer->windowTimePhaseMinimum = INFINITY;
+    }
+
+    // Ease into the latest rate adjustment
+    double smoothing = fmin(1.0, frames / (buffer->sampleRate * kCorrectionSmoothing));
+    buffer->appliedCorrection += (buffer->targetCorrection - buffer->appliedCorrection) * smoothing;
+    buffer->correction = buffer->appliedCorrection;
+    double ratio = 1.0 + buffer->appliedCorrection;
+
+    // Measure the phase: how much input we have beyond what this render needs
+    uint32_t needed = AEMixerCoreResamplerInputFramesNeeded(buffer->resampler, frames, ratio);
+    int64_t phase = (int64_t)available - needed;
+    if ( buffer->windowFrames == 0 || phase < buffer->windowMinimum ) {
+        buffer->windowMinimum = phase;
+    }
+
+    double latency = available + AEMixerCoreResamplerBufferedFrames(buffer->resampler) - frames * ratio;
+    buffer->addedLatency += (latency - buffer->addedLatency) * fmin(1.0, frames / (buffer->sampleRate * kWindowDuration));
+
+    if ( needed > 0 ) {
+        float *input[AEMixerCoreMaximumChannels];
+        AEMixerCoreResamplerGetInputBuffers(buffer->resampler, input);
+        uint32_t received = needed < available ? needed : available;
+        consume(buffer, input, received);
+
+        if ( received < needed ) {
+            // Input ran dry: play out what we have, then start again with a wider margin
+            for ( uint32_t i=0; i<buffer->channels; i++ ) {
+                memset(input[i] + received, 0, (needed - received) * sizeof(float));
+            }
+            buffer->underruns++;
+            buffer->safety += (needed - received) + kUnderrunPadding * buffer->sampleRate;
+            buffer->primed = false;
+        }
+
+        AEMixerCoreResamplerCommitInput(buffer->resampler, needed);
+    }
+
+    AEMixerCoreResamplerRender(buffer->resampler, output, frames, ratio);
+
+    if ( buffer->primed ) {
+        buffer->windowFrames += frames;
+        if ( buffer->windowFrames >= kWindowDuration * buffer->sampleRate ) {
+            endWindow(buffer);
+            buffer->windowFrames = 0;
+            buffer->windowTimePhaseMinimum = INFINITY;
+        }
+    }
+}
+
+void AEPlaythroughBufferRead(AEPlaythroughBuffer *buffer, float * const *output, uint32_t frames, double time) {
+    if ( buffer->primed ) {
+        measureTimePhase(buffer, time);
+    }
+    for ( uint32_t offset = 0; offset < frames; ) {
+        uint32_t chunkFrames = frames - offset;
+        if ( chunkFrames > buffer->maxFrames ) chunkFrames = buffer->maxFrames;
+        float *chunkOutput[AEMixerCoreMaximumChannels];
+        for ( uint32_t i=0; i<buffer->channels; i++ ) {
+            chunkOutput[i] = output[i] + offset;
+        }
+        render(buffer, chunkOutput, chunkFrames);
+        offset += chunkFrames;
+    }
+}
+
+double AEPlaythroughBufferGetAddedLatency(const AEPlaythroughBuffer *buffer) {
+    return buffer->addedLatency;
+}
+
+void AEPlaythroughBufferGetStatistics(const AEPlaythroughBuffer *buffer, AEPlaythroughBufferStatistics *outStatistics) {
+    outStatistics->addedLatency = buffer->addedLatency;
+    outStatistics->margin = buffer->margin;
+    outStatistics->jitter = buffer->jitter;
+    outStatistics->correction = buffer->correction;
+    outStatistics->underruns = buffer->underruns;
+    outStatistics->overruns = buffer->overruns;
+}
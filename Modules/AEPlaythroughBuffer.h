@@ -0,0 +1,127 @@
+//
+//  AEPlaythroughBuffer.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "AEMixerCore.h"
+
+/*!
+ * Playthrough buffer statistics
+ */
+typedef struct {
+    double   addedLatency;      //!< Frames the buffer adds between input and output, averaged over recent renders
+    double   margin;            //!< Input the buffer aims to have in hand at the lowest point, beyond what each render needs, in frames
+    double   jitter;            //!< Measured variation in the timing of input relative to output, in frames
+    double   correction;        //!< Current rate adjustment: 0.001 plays 0.1% fast, to trim latency
+    uint64_t underruns;         //!< Renders that found too little input buffered
+    uint64_t overruns;          //!< Inputs dropped because the buffer was full
+} AEPlaythroughBufferStatistics;
+
+/*!
+ * Adaptive-latency playthrough buffer
+ *
+ *  Carries audio from an input callback to an output callback, adding as little latency as
+ *  it safely can.
+ *
+ *  At each render, the buffer measures the phase of input relative to output: how far the
+ *  audio received so far runs ahead of what the render needs, and how long before the
+ *  render's I/O cycle the latest input's cycle was. It aims to keep the lowest recent value of
+ *  the former a little above zero, by a margin that covers the variation it has measured, and
+ *  which widens after an underrun.
+ *  When input and output run on one cycle, that's all it keeps. When they run independently,
+ *  and input arrives close enough before output that it might arrive after it instead, the
+ *  margin includes one input period too. Rather than skipping audio to close up,
+ *  or repeating it to open out, it plays slightly fast or slow, through a windowed-sinc
+ *  resampler, by up to 0.2%. This also absorbs any drift between input and output clocks.
+ *
+ *  Audio is written from one thread and read from another, without locks: both sides are
+ *  safe to use on realtime threads.
+ */
+typedef struct AEPlaythroughBuffer AEPlaythroughBuffer;
+
+/*!
+ * Create a playthrough buffer
+ *
+ * @param channels        Number of channels
+ * @param sampleRate      Sample rate
+ * @param maxFrames       The most frames expected in one write or read
+ * @return The playthrough buffer, or NULL on allocation failure
+ */
+AEPlaythroughBuffer *AEPlaythroughBufferNew(uint32_t channels, double sampleRate, uint32_t maxFrames);
+
+/*!
+ * Free a playthrough buffer
+ */
+void AEPlaythroughBufferFree(AEPlaythroughBuffer *buffer);
+
+/*!
+ * Write input audio
+ *
+ *  Use from the input thread only.
+ *
+ * @param buffer   The playthrough buffer
+ * @param format   The format of the audio
+ * @param audio    The audio: one buffer if the format is interleaved, else one per channel
+ * @param frames   Number of frames
+ * @param time     The time of the input's I/O cycle, in seconds, on a clock shared with the output:
+ *                 from the callback's timestamp, rather than the time it ran, where there is one
+ * @return false if the buffer was full, and the audio was dropped
+ */
+bool AEPlaythroughBufferWrite(AEPlaythroughBuffer *buffer, const AEMixerCoreFormat *format, const void * const *audio, uint32_t frames, double time);
+
+/*!
+ * Read audio for output
+ *
+ *  Use from the output thread only. Until enough input has arrived, this plays silence.
+ *
+ * @param buffer   The playthrough buffer
+ * @param output   One float buffer per channel
+ * @param frames   Number of frames
+ * @param time     The time of the output's I/O cycle, in seconds, on a clock shared with the input
+ */
+void AEPlaythroughBufferRead(AEPlaythroughBuffer *buffer, float * const *output, uint32_t frames, double time);
+
+/*!
+ * Get the latency the buffer currently adds, in frames
+ *
+ *  Safe to use from any thread.
+ */
+double AEPlaythroughBufferGetAddedLatency(const AEPlaythroughBuffer *buffer);
+
+/*!
+ * Get statistics
+ *
+ *  Safe to use from any thread, although values may be slightly out of step with each other.
+ */
+void AEPlaythroughBufferGetStatistics(const AEPlaythroughBuffer *buffer, AEPlaythroughBufferStatistics *outStatistics);
+
+#ifdef __cplusplus
+}
+#endif
@@ -29,9 +29,15 @@ extern "C" {
 
 #import <Foundation/Foundation.h>
 #import "TheAmazingAudioEngine.h"
+#import "AEPlaythroughBuffer.h"
 
 /*!
  * Playthrough channel, used for live monitoring of input
+ *
+ *  When input and output share an audio unit, as they do on iOS with both enabled, input
+ *  for each render cycle arrives before output renders. The channel then plays that input
+ *  directly, in the same cycle, adding no latency. Otherwise, it buffers input between
+ *  cycles, as described under @link adaptiveLatency @endlink.
  */
 @interface AEPlaythroughChannel : NSObject <AEAudioPlayable, AEAudioReceiver>
 
@@ -46,8 +52,51 @@ extern "C" {
 @property (nonatomic, assign) float pan;
 @property (nonatomic, assign) BOOL channelIsMuted;
 @property (nonatomic, readonly) AudioStreamBasicDescription audioDescription;
+
+/*!
+ * Adaptive latency
+ *
+ *  By default, the channel plays whatever input it has buffered, and skips ahead whenever
+ *  more than a couple of frames beyond what's needed build up. Latency varies, and skips
+ *  can be heard.
+ *
+ *  With adaptive latency, the channel measures the phase of input relative to output
+ *  instead, and keeps just enough buffered to ride out the variation it sees: a fraction
+ *  of a millisecond when input and output run on one cycle, or one input period plus
+ *  timing jitter when they don't. It closes up to, or opens out to, that level gradually,
+ *  by playing up to 0.2% fast or slow, rather than by skipping.
+ *
+ *  Supports 16 and 32-bit integer and 32-bit float input. Default is NO.
+ */
+@property (nonatomic, assign) BOOL adaptiveLatency;
+
+/*!
+ * The latency the channel currently adds between input and output, in frames
+ *
+ *  This is the audio buffered within the channel, averaged over recent renders when
+ *  using adaptive latency, or zero when playing input directly in the same render cycle.
+ *  It doesn't include the hardware input and output latency.
+ */
+@property (nonatomic, readonly) double addedLatency;
+
+/*!
+ * Adaptive latency statistics
+ *
+ *  Only meaningful while adaptive latency is enabled.
+ */
+@property (nonatomic, readonly) AEPlaythroughBufferStatistics adaptiveLatencyStatistics;
 @end
 
+/*!
+ * Get the latency the channel currently adds between input and output, in frames
+ *
+ *  Safe to use on the realtime thread.
+ *
+ * @param channel The channel
+ * @return The added latency, in frames
+ */
+double AEPlaythroughChannelGetAddedLatency(__unsafe_unretained AEPlaythroughChannel *channel);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
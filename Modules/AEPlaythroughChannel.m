@@ -31,13 +31,35 @@
 
 static const int kAudioBufferLength = 16384;
 static const int kSkipThreshold = 2;
+static const UInt32 kAdaptiveMaxFrames = 4096;
 static const int kAudiobusReceiverPortConnectedToSelfChanged;
+static const int kInputAudioDescriptionChanged;
+static const int kAutomaticLatencyManagementChanged;
+
+typedef struct {
+    AEPlaythroughBuffer *buffer;
+    AEMixerCoreFormat format;
+    double sampleRate;
+    BOOL latencyCompensated;
+    float *scratch[AEMixerCoreMaximumChannels];
+} adaptive_t;
+
+static void renderAdaptive(__unsafe_unretained AEPlaythroughChannel *THIS, adaptive_t *adaptive, __unsafe_unretained AEAudioController *audioController, const AudioTimeStamp *time, UInt32 frames, AudioBufferList *audio);
+static void renderDirect(__unsafe_unretained AEPlaythroughChannel *THIS, __unsafe_unretained AEAudioController *audioController, AudioBufferList *input, UInt32 inputFrames, UInt32 frames, AudioBufferList *audio);
+static double cycleTime(adaptive_t *adaptive, __unsafe_unretained AEAudioController *audioController, const AudioTimeStamp *time, BOOL input);
+static void freeAdaptive(adaptive_t *adaptive);
 
 @interface AEPlaythroughChannel () {
     TPCircularBuffer _buffer;
     BOOL _audiobusConnectedToSelf;
+    adaptive_t *_adaptive;
+    volatile double _addedLatency;
+    AudioBufferList *_directAudio;
+    UInt32 _directFrames;
+    AudioTimeStamp _directTimestamp;
 }
 @property (nonatomic, weak) AEAudioController *audioController;
+- (void)configureAdaptiveLatency;
 @end
 
 @implementation AEPlaythroughChannel
@@ -58,8 +80,8 @@ static const int kAudiobusReceiverPortConnectedToSelfChanged;
 }
 
 - (void)dealloc {
-    TPCircularBufferCleanup(&_buffer);
     self.audioController = nil;
+    TPCircularBufferCleanup(&_buffer);
 }
 
 - (void)setupWithAudioController:(AEAudioController *)audioController {
@@ -73,14 +95,43 @@ static const int kAudiobusReceiverPortConnectedToSelfChanged;
 -(void)setAudioController:(AEAudioController *)audioController {
     if ( _audioController ) {
         [_audioController removeObserver:self forKeyPath:@"audiobusReceiverPort.connectedToSelf"];
+        [_audioController removeObserver:self forKeyPath:@"inputAudioDescription"];
+        [_audioController removeObserver:self forKeyPath:@"automaticLatencyManagement"];
     }
     
     _audioController = audioController;
 
     if ( _audioController ) {
         [_audioController addObserver:self forKeyPath:@"audiobusReceiverPort.connectedToSelf" options:0 context:(void*)&kAudiobusReceiverPortConnectedToSelfChanged];
+        [_audioController addObserver:self forKeyPath:@"inputAudioDescription" options:0 context:(void*)&kInputAudioDescriptionChanged];
+        [_audioController addObserver:self forKeyPath:@"automaticLatencyManagement" options:0 context:(void*)&kAutomaticLatencyManagementChanged];
         [self updateAudiobusConnectedToSelf];
     }
+    
+    [self configureAdaptiveLatency];
+}
+
+-(void)setAdaptiveLatency:(BOOL)adaptiveLatency {
+    if ( _adaptiveLatency == adaptiveLatency ) return;
+    _adaptiveLatency = adaptiveLatency;
+    [self configureAdaptiveLatency];
+}
+
+-(double)addedLatency {
+    return _addedLatency;
+}
+
+double AEPlaythroughChannelGetAddedLatency(__unsafe_unretained AEPlaythroughChannel *THIS) {
+    return THIS->_addedLatency;
+}
+
+-(AEPlaythroughBufferStatistics)adaptiveLatencyStatistics {
+    AEPlaythroughBufferStatistics statistics;
+    memset(&statistics, 0, sizeof(statistics));
+    if ( _adaptive ) {
+        AEPlaythroughBufferGetStatistics(_adaptive->buffer, &statistics);
+    }
+    return statistics;
 }
 
 static void inputCallback(__unsafe_unretained AEPlaythroughChannel *THIS,
@@ -91,6 +142,26 @@ static void inputCallback(__unsafe_unretained AEPlaythroughChannel *THIS,
                           AudioBufferList          *audio) {
 
     if ( THIS->_audiobusConnectedToSelf ) return;
+    
+    if ( AEAudioControllerInputPrecedesOutput(audioController, NULL) ) {
+        // Output renders later this same cycle, so play this audio from there, without buffering it
+        THIS->_directAudio = audio;
+        THIS->_directFrames = frames;
+        THIS->_directTimestamp = *time;
+        return;
+    }
+    
+    adaptive_t *adaptive = THIS->_adaptive;
+    if ( adaptive ) {
+        if ( audio->mNumberBuffers != (adaptive->format.interleaved ? 1 : adaptive->format.channels) ) return;
+        const void *data[AEMixerCoreMaximumChannels];
+        for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+            data[i] = audio->mBuffers[i].mData;
+        }
+        AEPlaythroughBufferWrite(adaptive->buffer, &adaptive->format, data, frames, cycleTime(adaptive, audioController, time, YES));
+        return;
+    }
+    
     TPCircularBufferCopyAudioBufferList(&THIS->_buffer, audio, time, kTPCircularBufferCopyAll, NULL);
 }
 
@@ -103,6 +174,19 @@ static OSStatus renderCallback(__unsafe_unretained AEPlaythroughChannel *THIS,
                                const AudioTimeStamp     *time,
                                UInt32                    frames,
                                AudioBufferList          *audio) {
+    AudioBufferList *directAudio = THIS->_directAudio;
+    THIS->_directAudio = NULL;
+    if ( directAudio && AEAudioControllerInputPrecedesOutput(audioController, &THIS->_directTimestamp) ) {
+        renderDirect(THIS, audioController, directAudio, THIS->_directFrames, frames, audio);
+        return noErr;
+    }
+    
+    adaptive_t *adaptive = THIS->_adaptive;
+    if ( adaptive ) {
+        renderAdaptive(THIS, adaptive, audioController, time, frames, audio);
+        return noErr;
+    }
+    
     while ( 1 ) {
         // Discard any buffers with an incompatible format, in the event of a format change
         AudioBufferList *nextBuffer = TPCircularBufferNextBufferList(&THIS->_buffer, NULL);
@@ -112,6 +196,7 @@ static OSStatus renderCallback(__unsafe_unretained AEPlaythroughChannel *THIS,
     }
     
     UInt32 fillCount = TPCircularBufferPeek(&THIS->_buffer, NULL, AEAudioControllerAudioDescription(audioController));
+    THIS->_addedLatency = fillCount > frames+kSkipThreshold || fillCount < frames ? 0 : fillCount - frames;
     if ( fillCount > frames+kSkipThreshold ) {
         UInt32 skip = fillCount - frames;
         TPCircularBufferDequeueBufferListFrames(&THIS->_buffer,
@@ -130,6 +215,84 @@ static OSStatus renderCallback(__unsafe_unretained AEPlaythroughChannel *THIS,
     return noErr;
 }
 
+static void renderDirect(__unsafe_unretained AEPlaythroughChannel *THIS,
+                         __unsafe_unretained AEAudioController *audioController,
+                         AudioBufferList          *input,
+                         UInt32                    inputFrames,
+                         UInt32                    frames,
+                         AudioBufferList          *audio) {
+    // Anything queued before we started playing input directly is stale now
+    TPCircularBufferClear(&THIS->_buffer);
+    THIS->_addedLatency = 0;
+    
+    if ( input->mNumberBuffers != audio->mNumberBuffers ) {
+        for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+            memset(audio->mBuffers[i].mData, 0, audio->mBuffers[i].mDataByteSize);
+        }
+        return;
+    }
+    
+    UInt32 bytesPerFrame = AEAudioControllerInputAudioDescription(audioController)->mBytesPerFrame;
+    for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+        UInt32 bytes = MIN(MIN(inputFrames, frames) * bytesPerFrame, input->mBuffers[i].mDataByteSize);
+        memcpy(audio->mBuffers[i].mData, input->mBuffers[i].mData, bytes);
+        if ( bytes < audio->mBuffers[i].mDataByteSize ) {
+            memset((char*)audio->mBuffers[i].mData + bytes, 0, audio->mBuffers[i].mDataByteSize - bytes);
+        }
+    }
+}
+
+static void renderAdaptive(__unsafe_unretained AEPlaythroughChannel *THIS,
+                           adaptive_t               *adaptive,
+                           __unsafe_unretained AEAudioController *audioController,
+                           const AudioTimeStamp     *time,
+                           UInt32                    frames,
+                           AudioBufferList          *audio) {
+    if ( audio->mNumberBuffers != (adaptive->format.interleaved ? 1 : adaptive->format.channels) ) return;
+    
+    double startTime = cycleTime(adaptive, audioController, time, NO);
+    BOOL nativeFloat = AEMixerCoreFormatIsNativeFloat(&adaptive->format);
+    UInt32 bytesPerFrame = AEAudioControllerInputAudioDescription(audioController)->mBytesPerFrame;
+    
+    for ( UInt32 offset = 0; offset < frames; ) {
+        UInt32 chunkFrames = MIN(frames - offset, kAdaptiveMaxFrames);
+        
+        // Render straight into the output if it's float, otherwise via the scratch buffers
+        float *output[AEMixerCoreMaximumChannels];
+        void *target[AEMixerCoreMaximumChannels];
+        for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+            target[i] = (char*)audio->mBuffers[i].mData + offset * bytesPerFrame;
+        }
+        for ( int i=0; i<adaptive->format.channels; i++ ) {
+            output[i] = nativeFloat ? (float*)target[i] : adaptive->scratch[i];
+        }
+        
+        AEPlaythroughBufferRead(adaptive->buffer, output, chunkFrames, startTime + offset / adaptive->sampleRate);
+        
+        if ( !nativeFloat ) {
+            AEMixerCoreFromFloat(&adaptive->format, (const float * const *)output, target, chunkFrames);
+        }
+        
+        offset += chunkFrames;
+    }
+    
+    THIS->_addedLatency = AEPlaythroughBufferGetAddedLatency(adaptive->buffer);
+}
+
+static double cycleTime(adaptive_t *adaptive, __unsafe_unretained AEAudioController *audioController, const AudioTimeStamp *time, BOOL input) {
+    // The time of the I/O cycle a callback belongs to, from its timestamp. The controller moves timestamps
+    // by the hardware latencies, when managing latency, so take them back to when the cycle happened, to
+    // compare input with output.
+    if ( !(time->mFlags & kAudioTimeStampHostTimeValid) ) {
+        return AESecondsFromHostTicks(AECurrentTimeInHostTicks());
+    }
+    double seconds = AESecondsFromHostTicks(time->mHostTime);
+    if ( adaptive->latencyCompensated ) {
+        seconds += input ? AEAudioControllerInputLatency(audioController) : -AEAudioControllerOutputLatency(audioController);
+    }
+    return seconds;
+}
+
 -(AEAudioRenderCallback)renderCallback {
     return renderCallback;
 }
@@ -141,6 +304,8 @@ static OSStatus renderCallback(__unsafe_unretained AEPlaythroughChannel *THIS,
 -(void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context {
     if ( context == &kAudiobusReceiverPortConnectedToSelfChanged ) {
         [self updateAudiobusConnectedToSelf];
+    } else if ( context == &kInputAudioDescriptionChanged || context == &kAutomaticLatencyManagementChanged ) {
+        [self configureAdaptiveLatency];
     } else {
         [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
     }
@@ -156,6 +321,58 @@ static OSStatus renderCallback(__unsafe_unretained AEPlaythroughChannel *THIS,
     }
 }
 
+-(void)configureAdaptiveLatency {
+    // Prepare a playthrough buffer for the current input format, then swap it in
+    adaptive_t *adaptive = NULL;
+    if ( _adaptiveLatency && _audioController ) {
+        AudioStreamBasicDescription audioDescription = _audioController.inputAudioDescription;
+        AEMixerCoreFormat format;
+        if ( !AEMixerCoreFormatForAudioDescription(&audioDescription, &format) ) {
+            NSLog(@"AEPlaythroughChannel: Unsupported input format for adaptive latency; using standard playthrough");
+        } else {
+            adaptive = (adaptive_t*)calloc(1, sizeof(adaptive_t));
+            adaptive->format = format;
+            adaptive->sampleRate = audioDescription.mSampleRate;
+#if TARGET_OS_IPHONE
+            adaptive->latencyCompensated = _audioController.automaticLatencyManagement;
+#endif
+            adaptive->buffer = AEPlaythroughBufferNew(format.channels, audioDescription.mSampleRate, kAdaptiveMaxFrames);
+            BOOL allocated = adaptive->buffer != NULL;
+            for ( int i=0; i<format.channels && allocated; i++ ) {
+                adaptive->scratch[i] = (float*)malloc(kAdaptiveMaxFrames * sizeof(float));
+                allocated = adaptive->scratch[i] != NULL;
+            }
+            if ( !allocated ) {
+                NSLog(@"AEPlaythroughChannel: Couldn't allocate adaptive latency buffers");
+                freeAdaptive(adaptive);
+                adaptive = NULL;
+            }
+        }
+    }
+    
+    if ( !adaptive && !_adaptive ) return;
+    
+    adaptive_t *oldAdaptive = _adaptive;
+    if ( _audioController ) {
+        [_audioController performSynchronousMessageExchangeWithBlock:^{
+            self->_adaptive = adaptive;
+        }];
+    } else {
+        _adaptive = adaptive;
+    }
+    freeAdaptive(oldAdaptive);
+    _addedLatency = 0;
+}
+
+static void freeAdaptive(adaptive_t *adaptive) {
+    if ( !adaptive ) return;
+    AEPlaythroughBufferFree(adaptive->buffer);
+    for ( int i=0; i<AEMixerCoreMaximumChannels; i++ ) {
+        free(adaptive->scratch[i]);
+    }
+    free(adaptive);
+}
+
 @end
 
 
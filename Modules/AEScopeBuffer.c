@@ -0,0 +1,280 @@
+//
+//  AEScopeBuffer.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include "AEScopeBuffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define kFreshFlag 4    // Set on the exchange slot when it holds a snapshot the reader hasn't seen
+#define kIndexMask 3
+
+struct AEScopeBuffer {
+    uint32_t            channels;
+    uint32_t            columns;
+    uint32_t            framesPerColumn;
+    uint32_t            publishInterval;
+
+    // Writer state
+    float              *columnMinimum[AEScopeBufferMaximumChannels];   // Column rings
+    float              *columnMaximum[AEScopeBufferMaximumChannels];
+    uint32_t            columnHead;         // Next column to write
+    uint32_t            columnsFilled;
+    float               runningMinimum[AEScopeBufferMaximumChannels];
+    float               runningMaximum[AEScopeBufferMaximumChannels];
+    uint32_t            columnFrames;       // Frames summarised in the column in progress
+    uint64_t            frameCount;         // Frames up to the end of the last finished column
+    uint32_t            framesSincePublish;
+    bool                columnsSincePublish;
+    int                 writerSlot;
+
+    // Triple buffer
+    AEScopeSnapshot     snapshots[3];
+    float              *snapshotStorage;
+    volatile int32_t    exchangeSlot;       // Slot index plus kFreshFlag
+    int                 readerSlot;
+    bool                published;
+
+    // History
+    float              *history;
+    uint32_t            historyCapacity;    // A power of two
+    uint32_t            historyChunk;       // Largest run written before the count is advanced
+    volatile uint64_t   historyCount;       // Frames written; advanced by the writer only
+    volatile bool       historyEnabled;
+};
+
+AEScopeBuffer *AEScopeBufferNew(uint32_t channels, uint32_t columns, uint32_t framesPerColumn, uint32_t publishInterval, uint32_t historyFrames) {
+    if ( channels == 0 || channels > AEScopeBufferMaximumChannels || columns == 0 || framesPerColumn == 0 ) return NULL;
+
+    AEScopeBuffer *buffer = (AEScopeBuffer*)calloc(1, sizeof(AEScopeBuffer));
+    if ( !buffer ) return NULL;
+    buffer->channels = channels;
+    buffer->columns = columns;
+    buffer->framesPerColumn = framesPerColumn;
+    buffer->publishInterval = publishInterval;
+
+    bool allocated = true;
+    for ( uint32_t i=0; i<channels && allocated; i++ ) {
+        buffer->columnMinimum[i] = (float*)calloc(columns, sizeof(float));
+        buffer->columnMaximum[i] = (float*)calloc(columns, sizeof(float));
+        allocated = buffer->columnMinimum[i] && buffer->columnMaximum[i];
+    }
+    if ( allocated ) {
+        buffer->snapshotStorage = (float*)calloc((size_t)3 * 2 * channels * columns, sizeof(float));
+        allocated = buffer->snapshotStorage != NULL;
+    }
+    if ( allocated && historyFrames > 0 ) {
+        // Twice what was asked for, so a reader taking the full length has room to work as the writer carries on
+        buffer->historyCapacity = 1;
+        while ( buffer->historyCapacity < historyFrames * 2 ) buffer->historyCapacity <<= 1;
+        buffer->historyChunk = buffer->historyCapacity / 4;
+        buffer->history = (float*)calloc(buffer->historyCapacity, sizeof(float));
+        allocated = buffer->history != NULL;
+        buffer->historyEnabled = true;
+    }
+    if ( !allocated ) {
+        AEScopeBufferFree(buffer);
+        return NULL;
+    }
+
+    float *storage = buffer->snapshotStorage;
+    for ( int slot=0; slot<3; slot++ ) {
+        buffer->snapshots[slot].channels = channels;
+        buffer->snapshots[slot].framesPerColumn = framesPerColumn;
+        for ( uint32_t i=0; i<channels; i++ ) {
+            buffer->snapshots[slot].minimum[i] = storage; storage += columns;
+            buffer->snapshots[slot].maximum[i] = storage; storage += columns;
+        }
+    }
+    buffer->writerSlot = 0;
+    buffer->exchangeSlot = 1;
+    buffer->readerSlot = 2;
+
+    return buffer;
+}
+
+void AEScopeBufferFree(AEScopeBuffer *buffer) {
+    if ( !buffer ) return;
+    for ( uint32_t i=0; i<buffer->channels; i++ ) {
+        free(buffer->columnMinimum[i]);
+        free(buffer->columnMaximum[i]);
+    }
+    free(buffer->snapshotStorage);
+    free(buffer->history);
+    free(buffer);
+}
+
+void AEScopeBufferSetHistoryEnabled(AEScopeBuffer *buffer, bool enabled) {
+    buffer->historyEnabled = enabled && buffer->history;
+}
+
+static void publish(AEScopeBuffer *buffer) {
+    // Copy the column rings into the writer's slot, oldest first
+    AEScopeSnapshot *snapshot = &buffer->snapshots[buffer->writerSlot];
+    uint32_t count = buffer->columnsFilled;
+    uint32_t start = (buffer->columnHead + buffer->columns - count) % buffer->columns;
+    uint32_t firstRun = count < buffer->columns - start ? count : buffer->columns - start;
+    for ( uint32_t i=0; i<buffer->channels; i++ ) {
+        memcpy((float*)snapshot->minimum[i], buffer->columnMinimum[i] + start, firstRun * sizeof(float));
+        memcpy((float*)snapshot->minimum[i] + firstRun, buffer->columnMinimum[i], (count - firstRun) * sizeof(float));
+        memcpy((float*)snapshot->maximum[i], buffer->columnMaximum[i] + start, firstRun * sizeof(float));
+        memcpy((float*)snapshot->maximum[i] + firstRun, buffer->columnMaximum[i], (count - firstRun) * sizeof(float));
+    }
+    snapshot->columns = count;
+    snapshot->frameCount = buffer->frameCount;
+
+    // Swap it into the exchange slot (full barrier, so the contents are visible first)
+    int32_t old;
+    do {
+        old = buffer->exchangeSlot;
+    } while ( !__sync_bool_compare_and_swap(&buffer->exchangeSlot, old, buffer->writerSlot | kFreshFlag) );
+    buffer->writerSlot = old & kIndexMask;
+
+    buffer->framesSincePublish = 0;
+    buffer->columnsSincePublish = false;
+}
+
+static void writeHistory(AEScopeBuffer *buffer, const float * const *audio, uint32_t channels, uint32_t frames) {
+    const uint32_t mask = buffer->historyCapacity - 1;
+    const float scale = 1.0f / buffer->channels;
+    uint32_t offset = 0;
+    while ( offset < frames ) {
+        uint32_t position = (uint32_t)(buffer->historyCount & mask);
+        uint32_t count = frames - offset;
+        if ( count > buffer->historyChunk ) count = buffer->historyChunk;
+        if ( count > buffer->historyCapacity - position ) count = buffer->historyCapacity - position;
+
+        float * restrict target = buffer->history + position;
+        if ( channels == 0 ) {
+            memset(target, 0, count * sizeof(float));
+        }
+        for ( uint32_t i=0; i<channels; i++ ) {
+            const float * restrict source = audio[i] + offset;
+            if ( i == 0 ) {
+                for ( uint32_t j=0; j<count; j++ ) target[j] = source[j] * scale;
+            } else {
+                for ( uint32_t j=0; j<count; j++ ) target[j] += source[j] * scale;
+            }
+        }
+
+        // Make the audio visible before the count that covers it
+        __sync_synchronize();
+        buffer->historyCount += count;
+        offset += count;
+    }
+}
+
+void AEScopeBufferWrite(AEScopeBuffer *buffer, const float * const *audio, uint32_t channels, uint32_t frames) {
+    if ( channels > buffer->channels ) channels = buffer->channels;
+
+    uint32_t offset = 0;
+    while ( offset < frames ) {
+        uint32_t count = buffer->framesPerColumn - buffer->columnFrames;
+        if ( count > frames - offset ) count = frames - offset;
+
+        // Fold this run into the column in progress
+        bool starting = buffer->columnFrames == 0;
+        for ( uint32_t i=0; i<buffer->channels; i++ ) {
+            float lowest, highest;
+            if ( i < channels ) {
+                const float * restrict source = audio[i] + offset;
+                lowest = starting ? source[0] : buffer->runningMinimum[i];
+                highest = starting ? source[0] : buffer->runningMaximum[i];
+                for ( uint32_t j=0; j<count; j++ ) {
+                    float value = source[j];
+                    lowest = value < lowest ? value : lowest;
+                    highest = value > highest ? value : highest;
+                }
+            } else {
+                lowest = starting || buffer->runningMinimum[i] > 0.0f ? 0.0f : buffer->runningMinimum[i];
+                highest = starting || buffer->runningMaximum[i] < 0.0f ? 0.0f : buffer->runningMaximum[i];
+            }
+            buffer->runningMinimum[i] = lowest;
+            buffer->runningMaximum[i] = highest;
+        }
+        buffer->columnFrames += count;
+        buffer->framesSincePublish += count;
+        offset += count;
+
+        if ( buffer->columnFrames == buffer->framesPerColumn ) {
+            // Column complete: add it to the rings
+            for ( uint32_t i=0; i<buffer->channels; i++ ) {
+                buffer->columnMinimum[i][buffer->columnHead] = buffer->runningMinimum[i];
+                buffer->columnMaximum[i][buffer->columnHead] = buffer->runningMaximum[i];
+            }
+            buffer->columnHead = buffer->columnHead + 1 == buffer->columns ? 0 : buffer->columnHead + 1;
+            if ( buffer->columnsFilled < buffer->columns ) buffer->columnsFilled++;
+            buffer->columnFrames = 0;
+            buffer->frameCount += buffer->framesPerColumn;
+            buffer->columnsSincePublish = true;
+        }
+    }
+
+    if ( buffer->historyEnabled ) {
+        writeHistory(buffer, audio, channels, frames);
+    }
+
+    if ( buffer->columnsSincePublish && buffer->framesSincePublish >= buffer->publishInterval ) {
+        publish(buffer);
+    }
+}
+
+bool AEScopeBufferGetSnapshot(AEScopeBuffer *buffer, const AEScopeSnapshot **outSnapshot) {
+    bool fresh = false;
+    if ( buffer->exchangeSlot & kFreshFlag ) {
+        // Take the newest snapshot, leaving ours for the writer
+        int32_t old;
+        do {
+            old = buffer->exchangeSlot;
+        } while ( !__sync_bool_compare_and_swap(&buffer->exchangeSlot, old, buffer->readerSlot) );
+        buffer->readerSlot = old & kIndexMask;
+        buffer->published = true;
+        fresh = true;
+    }
+    if ( outSnapshot ) *outSnapshot = buffer->published ? &buffer->snapshots[buffer->readerSlot] : NULL;
+    return fresh;
+}
+
+bool AEScopeBufferReadHistory(AEScopeBuffer *buffer, float *output, uint32_t frames, uint64_t *outFrameCount) {
+    if ( !buffer->history || frames > buffer->historyCapacity / 2 ) return false;
+
+    uint64_t end = buffer->historyCount;
+    __sync_synchronize();
+    if ( end < frames ) return false;
+
+    const uint32_t mask = buffer->historyCapacity - 1;
+    uint32_t start = (uint32_t)((end - frames) & mask);
+    uint32_t firstRun = frames < buffer->historyCapacity - start ? frames : buffer->historyCapacity - start;
+    memcpy(output, buffer->history + start, firstRun * sizeof(float));
+    memcpy(output + firstRun, buffer->history, (frames - firstRun) * sizeof(float));
+
+    // Check the writer hasn't reached what we copied: it may be part way through a chunk past the count
+    __sync_synchronize();
+    uint64_t now = buffer->historyCount;
+    if ( now + buffer->historyChunk > end - frames + buffer->historyCapacity ) return false;
+
+    if ( outFrameCount ) *outFrameCount = end;
+    return true;
+}
@@ -0,0 +1,134 @@
+//
+//  AEScopeBuffer.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * Maximum number of channels a scope buffer handles
+ */
+#define AEScopeBufferMaximumChannels 16
+
+/*!
+ * A scope snapshot
+ *
+ *  The minimum and maximum sample values within each column, for each channel, oldest first.
+ */
+typedef struct {
+    uint32_t     channels;                                  //!< Number of channels
+    uint32_t     columns;                                   //!< Number of columns
+    uint32_t     framesPerColumn;                           //!< Frames of audio summarised by each column
+    uint64_t     frameCount;                                //!< Frames received in all, up to the end of the newest column
+    const float *minimum[AEScopeBufferMaximumChannels];     //!< Lowest value in each column, for each channel
+    const float *maximum[AEScopeBufferMaximumChannels];     //!< Highest value in each column, for each channel
+} AEScopeSnapshot;
+
+/*!
+ * Scope buffer
+ *
+ *  Summarises audio for display. As audio arrives on the render thread, the buffer
+ *  decimates it to the lowest and highest values within each column of the display, at a
+ *  cost of a couple of comparisons per sample, and at intervals publishes the most recent
+ *  columns as a snapshot. Snapshots are triple-buffered, so the reader always has a
+ *  complete one to draw, and neither side waits for the other.
+ *
+ *  Optionally, the buffer also keeps a history of recent audio, mixed to mono, for analysis
+ *  such as a spectrum on another thread.
+ */
+typedef struct AEScopeBuffer AEScopeBuffer;
+
+/*!
+ * Create a scope buffer
+ *
+ * @param channels          Number of channels
+ * @param columns           Number of columns to keep, such as the width of the display in pixels
+ * @param framesPerColumn   Frames of audio to summarise in each column
+ * @param publishInterval   Frames between snapshots; 0 publishes on every write
+ * @param historyFrames     Frames of mono history to keep for analysis, or 0 for none
+ *                          (history starts out enabled; see @link AEScopeBufferSetHistoryEnabled @endlink)
+ * @return The buffer, or NULL on allocation failure
+ */
+AEScopeBuffer *AEScopeBufferNew(uint32_t channels, uint32_t columns, uint32_t framesPerColumn, uint32_t publishInterval, uint32_t historyFrames);
+
+/*!
+ * Free a scope buffer
+ */
+void AEScopeBufferFree(AEScopeBuffer *buffer);
+
+/*!
+ * Enable or disable history
+ *
+ *  While disabled, writes skip the history, so it costs nothing while there's no
+ *  analysis to use it. Has no effect on a buffer created without history.
+ *
+ * @param buffer    The scope buffer
+ * @param enabled   Whether to keep history
+ */
+void AEScopeBufferSetHistoryEnabled(AEScopeBuffer *buffer, bool enabled);
+
+/*!
+ * Write audio
+ *
+ *  Use from one thread, usually the render thread.
+ *
+ * @param buffer    The scope buffer
+ * @param audio     One float buffer per channel
+ * @param channels  Number of channels given; extra channels are ignored, missing ones are silent
+ * @param frames    Number of frames
+ */
+void AEScopeBufferWrite(AEScopeBuffer *buffer, const float * const *audio, uint32_t channels, uint32_t frames);
+
+/*!
+ * Get the latest snapshot
+ *
+ *  Use from one thread, such as the main thread. The snapshot stays valid until the next call.
+ *
+ * @param buffer       The scope buffer
+ * @param outSnapshot  On output, the snapshot, or NULL if none has been published yet
+ * @return true if the snapshot is new since the last call
+ */
+bool AEScopeBufferGetSnapshot(AEScopeBuffer *buffer, const AEScopeSnapshot **outSnapshot);
+
+/*!
+ * Read recent history
+ *
+ *  Use from one thread. Fails if the writer overwrote the audio while it was being read,
+ *  in which case just try again later.
+ *
+ * @param buffer    The scope buffer
+ * @param output    Buffer to receive the most recent frames, oldest first, mixed to mono
+ * @param frames    Number of frames; no more than half the history length
+ * @param outFrameCount On output, if not NULL, frames received in all, up to the end of the output
+ * @return true on success; false if there wasn't enough history, or it was overwritten
+ */
+bool AEScopeBufferReadHistory(AEScopeBuffer *buffer, float *output, uint32_t frames, uint64_t *outFrameCount);
+
+#ifdef __cplusplus
+}
+#endif
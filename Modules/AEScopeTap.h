@@ -0,0 +1,119 @@
+//
+//  AEScopeTap.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#import <Foundation/Foundation.h>
+#import "TheAmazingAudioEngine.h"
+#import "AEScopeBuffer.h"
+
+/*!
+ * Scope tap, for oscilloscope and analyser displays
+ *
+ *  Add the tap as a receiver, as you would any other. On the render thread, it reduces
+ *  the audio to the lowest and highest values within each column of the display, which
+ *  costs little more than reading the audio once, and publishes the most recent columns
+ *  about 60 times a second. Draw from the latest snapshot, on the main thread, using
+ *  @link AEScopeTapGetSnapshot @endlink; neither side ever waits for the other.
+ *
+ *  Optionally, the tap also provides a spectrum of the audio, mixed to mono. This is
+ *  computed on a background thread shared between all taps, about 30 times a second,
+ *  and only while enabled.
+ */
+@interface AEScopeTap : NSObject <AEAudioReceiver>
+
+/*!
+ * Initialise
+ *
+ * @param audioDescription  The format of the audio the tap will receive; up to 16 channels
+ * @param columns           Number of columns to keep, such as the width of the display in pixels
+ * @param framesPerColumn   Frames of audio summarised in each column
+ */
+- (instancetype)initWithAudioDescription:(AudioStreamBasicDescription)audioDescription
+                                 columns:(UInt32)columns
+                         framesPerColumn:(UInt32)framesPerColumn;
+
+/*!
+ * Get the latest snapshot
+ *
+ *  Use from one thread only, usually the main thread.
+ *
+ * @return The snapshot, valid until the next time it's requested, or NULL if there's none yet
+ */
+- (const AEScopeSnapshot*)snapshot;
+
+@property (nonatomic, readonly) AudioStreamBasicDescription audioDescription;
+@property (nonatomic, readonly) UInt32 columns;
+@property (nonatomic, readonly) UInt32 framesPerColumn;
+
+/*!
+ * Whether to compute a spectrum
+ *
+ *  Default is NO.
+ */
+@property (nonatomic, assign) BOOL spectrumEnabled;
+
+/*!
+ * Spectrum size, in frames
+ *
+ *  A power of two, from 256 to 8192; the spectrum has half this many bins, each
+ *  sampleRate / spectrumSize Hz wide. Default is 1024.
+ *
+ *  Set this on the thread you read the spectrum from.
+ */
+@property (nonatomic, assign) UInt32 spectrumSize;
+
+@end
+
+/*!
+ * Get the latest snapshot
+ *
+ *  Use from one thread only, usually the main thread.
+ *
+ * @param tap           The tap
+ * @param outSnapshot   On output, the snapshot, valid until the next call, or NULL if there's none yet
+ * @return YES if the snapshot is new since the last call
+ */
+BOOL AEScopeTapGetSnapshot(__unsafe_unretained AEScopeTap *tap, const AEScopeSnapshot **outSnapshot);
+
+/*!
+ * Get the latest spectrum
+ *
+ *  Use from the thread you set the spectrum size from, usually the main thread. The
+ *  spectrum holds the power in each bin, in decibels, where a full-scale sine wave
+ *  reads 0dB.
+ *
+ * @param tap           The tap
+ * @param outSpectrum   On output, the spectrum, valid until the next call, or NULL if there's none yet
+ * @param outBins       On output, the number of bins
+ * @return YES if the spectrum is new since the last call
+ */
+BOOL AEScopeTapGetSpectrum(__unsafe_unretained AEScopeTap *tap, const float **outSpectrum, UInt32 *outBins);
+
+#ifdef __cplusplus
+}
+#endif
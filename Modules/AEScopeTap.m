@@ -0,0 +1,370 @@
+//
+//  AEScopeTap.m
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#import "AEScopeTap.h"
+#import <Accelerate/Accelerate.h>
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
+
+static const UInt32 kConversionFrames               = 1024;
+static const double kPublishRate                    = 60.0;
+static const UInt32 kDefaultSpectrumSize            = 1024;
+static const UInt32 kMinimumSpectrumSize            = 256;
+static const UInt32 kMaximumSpectrumSize            = 8192;
+static const NSTimeInterval kAnalysisInterval       = 1.0/30.0;
+static const float kSpectrumFloor                   = 1.0e-12; // -120dB
+
+#define kFreshFlag 4
+#define kIndexMask 3
+
+typedef struct {
+    UInt32              size;
+    vDSP_Length         log2Size;
+    FFTSetup            setup;
+    float              *window;
+    float              *samples;
+    DSPSplitComplex     split;
+    uint64_t            lastFrameCount;
+
+    // Triple buffer, between the analysis thread and the reader
+    float              *spectra[3];
+    int                 writerSlot;
+    volatile int32_t    exchangeSlot;
+    int                 readerSlot;
+    BOOL                published;
+} spectrum_t;
+
+@interface AEScopeTapAnalysisThread : NSThread
++ (AEScopeTapAnalysisThread*)sharedThread;
+- (void)addTap:(AEScopeTap*)tap;
+- (void)removeTap:(AEScopeTap*)tap;
+@end
+
+@interface AEScopeTap () {
+    AEScopeBuffer      *_buffer;
+    float             **_floatBuffers;
+    spectrum_t         *_spectrum;
+    pthread_mutex_t     _spectrumMutex; // Held by the analysis thread while it uses the spectrum
+}
+@property (nonatomic, strong) AEFloatConverter *floatConverter;
+@end
+
+static spectrum_t *spectrumNew(UInt32 size);
+static void spectrumFree(spectrum_t *spectrum);
+static void analyse(__unsafe_unretained AEScopeTap *THIS);
+
+@implementation AEScopeTap
+
+- (instancetype)initWithAudioDescription:(AudioStreamBasicDescription)audioDescription
+                                 columns:(UInt32)columns
+                         framesPerColumn:(UInt32)framesPerColumn {
+
+    if ( !(self = [super init]) ) return nil;
+
+    pthread_mutex_init(&_spectrumMutex, NULL);
+
+    if ( audioDescription.mChannelsPerFrame > AEScopeBufferMaximumChannels ) {
+        NSLog(@"AEScopeTap: %d channels given, but only up to %d are supported",
+              (int)audioDescription.mChannelsPerFrame, AEScopeBufferMaximumChannels);
+        return nil;
+    }
+
+    _audioDescription = audioDescription;
+    _columns = columns;
+    _framesPerColumn = framesPerColumn;
+    _spectrumSize = kDefaultSpectrumSize;
+
+    _buffer = AEScopeBufferNew(audioDescription.mChannelsPerFrame, columns, framesPerColumn,
+                               (uint32_t)(audioDescription.mSampleRate / kPublishRate), kMaximumSpectrumSize);
+    if ( !_buffer ) return nil;
+    AEScopeBufferSetHistoryEnabled(_buffer, false);
+
+    self.floatConverter = [[AEFloatConverter alloc] initWithSourceFormat:audioDescription];
+    _floatBuffers = (float**)malloc(sizeof(float*) * audioDescription.mChannelsPerFrame);
+    for ( int i=0; i<audioDescription.mChannelsPerFrame; i++ ) {
+        _floatBuffers[i] = (float*)malloc(sizeof(float) * kConversionFrames);
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    if ( _spectrumEnabled ) {
+        [[AEScopeTapAnalysisThread sharedThread] removeTap:self];
+    }
+    if ( _floatBuffers ) {
+        for ( int i=0; i<_audioDescription.mChannelsPerFrame; i++ ) {
+            free(_floatBuffers[i]);
+        }
+        free(_floatBuffers);
+    }
+    if ( _spectrum ) {
+        spectrumFree(_spectrum);
+    }
+    if ( _buffer ) {
+        AEScopeBufferFree(_buffer);
+    }
+    pthread_mutex_destroy(&_spectrumMutex);
+}
+
+- (const AEScopeSnapshot *)snapshot {
+    const AEScopeSnapshot *snapshot;
+    AEScopeTapGetSnapshot(self, &snapshot);
+    return snapshot;
+}
+
+-(void)setSpectrumEnabled:(BOOL)spectrumEnabled {
+    if ( _spectrumEnabled == spectrumEnabled ) return;
+    _spectrumEnabled = spectrumEnabled;
+
+    if ( spectrumEnabled ) {
+        if ( !_spectrum ) {
+            spectrum_t *spectrum = spectrumNew(_spectrumSize);
+            if ( !spectrum ) {
+                _spectrumEnabled = NO;
+                return;
+            }
+            pthread_mutex_lock(&_spectrumMutex);
+            _spectrum = spectrum;
+            pthread_mutex_unlock(&_spectrumMutex);
+        }
+        AEScopeBufferSetHistoryEnabled(_buffer, true);
+        [[AEScopeTapAnalysisThread sharedThread] addTap:self];
+    } else {
+        [[AEScopeTapAnalysisThread sharedThread] removeTap:self];
+        AEScopeBufferSetHistoryEnabled(_buffer, false);
+    }
+}
+
+-(void)setSpectrumSize:(UInt32)spectrumSize {
+    UInt32 size = kMinimumSpectrumSize;
+    while ( size < spectrumSize && size < kMaximumSpectrumSize ) size <<= 1;
+    if ( size == _spectrumSize ) return;
+    _spectrumSize = size;
+
+    if ( !_spectrum ) return;
+
+    spectrum_t *spectrum = spectrumNew(size);
+    if ( !spectrum ) return;
+
+    pthread_mutex_lock(&_spectrumMutex);
+    spectrum_t *oldSpectrum = _spectrum;
+    _spectrum = spectrum;
+    pthread_mutex_unlock(&_spectrumMutex);
+
+    spectrumFree(oldSpectrum);
+}
+
+BOOL AEScopeTapGetSnapshot(__unsafe_unretained AEScopeTap *THIS, const AEScopeSnapshot **outSnapshot) {
+    return AEScopeBufferGetSnapshot(THIS->_buffer, outSnapshot);
+}
+
+BOOL AEScopeTapGetSpectrum(__unsafe_unretained AEScopeTap *THIS, const float **outSpectrum, UInt32 *outBins) {
+    spectrum_t *spectrum = THIS->_spectrum;
+    if ( !spectrum ) {
+        if ( outSpectrum ) *outSpectrum = NULL;
+        if ( outBins ) *outBins = 0;
+        return NO;
+    }
+
+    BOOL fresh = NO;
+    if ( spectrum->exchangeSlot & kFreshFlag ) {
+        // Take the newest spectrum, leaving ours for the analysis thread
+        int32_t old;
+        do {
+            old = spectrum->exchangeSlot;
+        } while ( !OSAtomicCompareAndSwap32Barrier(old, spectrum->readerSlot, &spectrum->exchangeSlot) );
+        spectrum->readerSlot = old & kIndexMask;
+        spectrum->published = YES;
+        fresh = YES;
+    }
+
+    if ( outSpectrum ) *outSpectrum = spectrum->published ? spectrum->spectra[spectrum->readerSlot] : NULL;
+    if ( outBins ) *outBins = spectrum->size / 2;
+    return fresh;
+}
+
+#pragma mark - Analysis
+
+static spectrum_t *spectrumNew(UInt32 size) {
+    spectrum_t *spectrum = (spectrum_t*)calloc(1, sizeof(spectrum_t));
+    if ( !spectrum ) return NULL;
+    spectrum->size = size;
+    spectrum->log2Size = (vDSP_Length)log2(size);
+    spectrum->setup = vDSP_create_fftsetup(spectrum->log2Size, kFFTRadix2);
+    spectrum->window = (float*)malloc(sizeof(float) * size);
+    spectrum->samples = (float*)malloc(sizeof(float) * size);
+    spectrum->split.realp = (float*)malloc(sizeof(float) * size/2);
+    spectrum->split.imagp = (float*)malloc(sizeof(float) * size/2);
+    BOOL allocated = spectrum->setup && spectrum->window && spectrum->samples && spectrum->split.realp && spectrum->split.imagp;
+    for ( int i=0; i<3; i++ ) {
+        spectrum->spectra[i] = (float*)calloc(size/2, sizeof(float));
+        allocated = allocated && spectrum->spectra[i];
+    }
+    if ( !allocated ) {
+        spectrumFree(spectrum);
+        return NULL;
+    }
+
+    vDSP_hann_window(spectrum->window, size, vDSP_HANN_DENORM);
+    spectrum->writerSlot = 0;
+    spectrum->exchangeSlot = 1;
+    spectrum->readerSlot = 2;
+    return spectrum;
+}
+
+static void spectrumFree(spectrum_t *spectrum) {
+    if ( spectrum->setup ) vDSP_destroy_fftsetup(spectrum->setup);
+    free(spectrum->window);
+    free(spectrum->samples);
+    free(spectrum->split.realp);
+    free(spectrum->split.imagp);
+    for ( int i=0; i<3; i++ ) {
+        free(spectrum->spectra[i]);
+    }
+    free(spectrum);
+}
+
+static void analyse(__unsafe_unretained AEScopeTap *THIS) {
+    pthread_mutex_lock(&THIS->_spectrumMutex);
+    spectrum_t *spectrum = THIS->_spectrum;
+    if ( !spectrum ) {
+        pthread_mutex_unlock(&THIS->_spectrumMutex);
+        return;
+    }
+
+    // Take the most recent audio, unless it's what we analysed last time
+    uint64_t frameCount;
+    if ( !AEScopeBufferReadHistory(THIS->_buffer, spectrum->samples, spectrum->size, &frameCount)
+            || frameCount == spectrum->lastFrameCount ) {
+        pthread_mutex_unlock(&THIS->_spectrumMutex);
+        return;
+    }
+    spectrum->lastFrameCount = frameCount;
+
+    UInt32 bins = spectrum->size / 2;
+    vDSP_vmul(spectrum->samples, 1, spectrum->window, 1, spectrum->samples, 1, spectrum->size);
+    vDSP_ctoz((DSPComplex*)spectrum->samples, 2, &spectrum->split, 1, bins);
+    vDSP_fft_zrip(spectrum->setup, &spectrum->split, 1, spectrum->log2Size, kFFTDirection_Forward);
+    spectrum->split.imagp[0] = 0.0; // Drop the Nyquist term, packed in with DC
+
+    // Power per bin, scaled so a full-scale sine reads 1 (the window halves it, the FFT doubles it), in dB
+    float *output = spectrum->spectra[spectrum->writerSlot];
+    vDSP_zvmags(&spectrum->split, 1, output, 1, bins);
+    float scale = 4.0f / ((float)spectrum->size * (float)spectrum->size);
+    vDSP_vsmul(output, 1, &scale, output, 1, bins);
+    vDSP_vthr(output, 1, &kSpectrumFloor, output, 1, bins);
+    float reference = 1.0f;
+    vDSP_vdbcon(output, 1, &reference, output, 1, bins, 0);
+
+    // Publish
+    int32_t old;
+    do {
+        old = spectrum->exchangeSlot;
+    } while ( !OSAtomicCompareAndSwap32Barrier(old, spectrum->writerSlot | kFreshFlag, &spectrum->exchangeSlot) );
+    spectrum->writerSlot = old & kIndexMask;
+
+    pthread_mutex_unlock(&THIS->_spectrumMutex);
+}
+
+#pragma mark - Callback
+
+static void audioCallback(__unsafe_unretained AEScopeTap *THIS,
+                          __unsafe_unretained AEAudioController *audioController,
+                          void *source,
+                          const AudioTimeStamp *time,
+                          UInt32 frames,
+                          AudioBufferList *audio) {
+
+    // Convert in pieces, summarising each
+    UInt32 offset = 0;
+    while ( offset < frames ) {
+        UInt32 count = MIN(frames - offset, kConversionFrames);
+        AEAudioBufferListCopyOnStack(piece, audio, offset * THIS->_audioDescription.mBytesPerFrame);
+        AEFloatConverterToFloat(THIS->_floatConverter, piece, THIS->_floatBuffers, count);
+        AEScopeBufferWrite(THIS->_buffer, (const float * const *)THIS->_floatBuffers, THIS->_audioDescription.mChannelsPerFrame, count);
+        offset += count;
+    }
+}
+
+-(AEAudioReceiverCallback)receiverCallback {
+    return audioCallback;
+}
+
+@end
+
+@implementation AEScopeTapAnalysisThread {
+    NSHashTable *_taps;
+}
+
++ (AEScopeTapAnalysisThread*)sharedThread {
+    static AEScopeTapAnalysisThread *__sharedThread = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        __sharedThread = [[AEScopeTapAnalysisThread alloc] init];
+        [__sharedThread start];
+    });
+    return __sharedThread;
+}
+
+- (instancetype)init {
+    if ( !(self = [super init]) ) return nil;
+    _taps = [NSHashTable weakObjectsHashTable];
+    self.threadPriority = 0.3;
+    return self;
+}
+
+- (void)addTap:(AEScopeTap *)tap {
+    @synchronized ( _taps ) {
+        [_taps addObject:tap];
+    }
+}
+
+- (void)removeTap:(AEScopeTap *)tap {
+    @synchronized ( _taps ) {
+        [_taps removeObject:tap];
+    }
+}
+
+- (void)main {
+    @autoreleasepool {
+        pthread_setname_np("com.theamazingaudioengine.AEScopeTapAnalysisThread");
+        while ( !self.isCancelled ) {
+            @autoreleasepool {
+                NSArray *taps;
+                @synchronized ( _taps ) {
+                    taps = _taps.allObjects;
+                }
+                for ( AEScopeTap *tap in taps ) {
+                    analyse(tap);
+                }
+                taps = nil;
+                usleep(kAnalysisInterval*1.0e6);
+            }
+        }
+    }
+}
+
+@end
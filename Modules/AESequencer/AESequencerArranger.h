@@ -0,0 +1,140 @@
+//
+//  AESequencerArranger.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#import <Foundation/Foundation.h>
+#import "AEAudioController.h"
+#import "AESequencerChannelSequence.h"
+#import "AESequencerClock.h"
+
+/*!
+ * Song arranger
+ *
+ *  Arranges patterns into a song, and keeps time for the AESequencerChannel tracks that play
+ *  it. Each pattern holds one bar, with a sequence for each track; the chain lists the pattern
+ *  to play in each bar.
+ *
+ *  The arranger works out each render's timeline once, for all of its tracks: add it as a
+ *  timing receiver with AEAudioController's @link AEAudioController::addTimingReceiver: addTimingReceiver: @endlink,
+ *  then create tracks with AESequencerChannel's
+ *  sequencerChannelWithAudioFileAt:audioController:arranger:track:.
+ *
+ *  Whenever the patterns or the chain change, they're compiled into a new song, which takes
+ *  over at the next bar. The song that was playing is freed once the render thread has moved
+ *  on, so changes can be made at any time while playing.
+ */
+@interface AESequencerArranger : NSObject <AEAudioTimingReceiver>
+
+/*!
+ * Initialise
+ *
+ * @param audioController The audio controller
+ * @param beatsPerMeasure Number of beats in each bar
+ * @param bpm Tempo
+ */
+- (instancetype)initWithAudioController:(AEAudioController*)audioController
+            numberOfFullBeatsPerMeasure:(NSUInteger)beatsPerMeasure
+                                  atBPM:(double)bpm;
+
+/*!
+ * Compile the patterns and chain again
+ *
+ *  Call this after changing any of the patterns' sequences, to hear the changes. Setting
+ *  the patterns, chain or loopsChain does this automatically.
+ */
+- (void)commit;
+
+/*!
+ * Move to a bar of the chain at the next bar boundary
+ *
+ * @param chainEntry Index within the chain
+ */
+- (void)queueChainEntry:(NSUInteger)chainEntry;
+
+/*!
+ * The patterns
+ *
+ *  An array of patterns, each an array with an AESequencerChannelSequence for each track, or
+ *  NSNull for a silent track. Tracks beyond the end of a pattern's array are silent.
+ */
+@property (nonatomic, copy) NSArray *patterns;
+
+/*!
+ * The chain
+ *
+ *  An array of NSNumber pattern indices, one for each bar of the song.
+ */
+@property (nonatomic, copy) NSArray *chain;
+
+/*!
+ * Whether to return to the start of the chain after the last bar, rather than stopping
+ *
+ *  Default is YES.
+ */
+@property (nonatomic, assign) BOOL loopsChain;
+
+/*!
+ * Whether the song is playing
+ *
+ *  Starting plays from the first bar of the chain, or the bar queued with
+ *  @link queueChainEntry: @endlink.
+ */
+@property (nonatomic, assign) BOOL playing;
+
+/*!
+ * Tempo
+ *
+ *  Changes take effect at the next render, at the same position within the bar.
+ */
+@property (nonatomic, assign) double bpm;
+
+/*!
+ * The bar of the chain playing
+ */
+@property (nonatomic, readonly) NSUInteger currentChainEntry;
+
+/*!
+ * The position within the current bar, from 0 to 1
+ */
+@property (nonatomic, readonly) float barPosition;
+
+@end
+
+/*!
+ * Get the arranger's clock
+ *
+ *  For tracks, to find what to play in each render.
+ *
+ * @param arranger The arranger
+ * @return The clock
+ */
+AESequencerClock *AESequencerArrangerGetClock(__unsafe_unretained AESequencerArranger *arranger);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,203 @@
+//
+//  AESequencerArranger.m
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#import "AESequencerArranger.h"
+#import "AESequencerEngine.h"
+
+@interface AESequencerArranger () {
+    AESequencerClock *_clock;
+    NSUInteger _beatsPerMeasure;
+    double _bpm;
+}
+@property (nonatomic, weak) AEAudioController *audioController;
+@end
+
+@implementation AESequencerArranger
+
+- (instancetype)initWithAudioController:(AEAudioController*)audioController
+            numberOfFullBeatsPerMeasure:(NSUInteger)beatsPerMeasure
+                                  atBPM:(double)bpm {
+    if ( beatsPerMeasure == 0 || bpm <= 0 ) {
+        NSLog(@"AESequencerArranger: Need at least one beat per measure, and a BPM above 0");
+        return nil;
+    }
+    
+    if ( !(self = [super init]) ) return nil;
+    
+    self.audioController = audioController;
+    _beatsPerMeasure = beatsPerMeasure;
+    _bpm = bpm;
+    _loopsChain = YES;
+    
+    _clock = AESequencerClockNew([self barLengthInFrames]);
+    if ( !_clock ) return nil;
+    
+    return self;
+}
+
+-(void)dealloc {
+    AESequencerClockFree(_clock);
+}
+
+AESequencerClock *AESequencerArrangerGetClock(__unsafe_unretained AESequencerArranger *THIS) {
+    return THIS->_clock;
+}
+
+#pragma mark - Arrangement
+
+-(void)setPatterns:(NSArray *)patterns {
+    _patterns = [patterns copy];
+    [self commit];
+}
+
+-(void)setChain:(NSArray *)chain {
+    _chain = [chain copy];
+    [self commit];
+}
+
+-(void)setLoopsChain:(BOOL)loopsChain {
+    _loopsChain = loopsChain;
+    [self commit];
+}
+
+-(void)commit {
+    NSUInteger patternCount = _patterns.count;
+    NSUInteger trackCount = 0;
+    for ( NSArray *pattern in _patterns ) {
+        trackCount = MAX(trackCount, pattern.count);
+    }
+    
+    // Gather each track of each pattern; the song takes its own sorted copy
+    NSUInteger listCount = patternCount * trackCount;
+    const AESequencerEngineBeat **beats = (const AESequencerEngineBeat **)calloc(MAX(listCount, 1), sizeof(AESequencerEngineBeat*));
+    uint32_t *beatCounts = (uint32_t*)calloc(MAX(listCount, 1), sizeof(uint32_t));
+    for ( NSUInteger patternIndex = 0; patternIndex < patternCount; patternIndex++ ) {
+        NSArray *pattern = _patterns[patternIndex];
+        for ( NSUInteger track = 0; track < pattern.count; track++ ) {
+            AESequencerChannelSequence *sequence = pattern[track];
+            if ( ![sequence isKindOfClass:[AESequencerChannelSequence class]] || sequence.count == 0 ) continue;
+            
+            NSUInteger count = sequence.count;
+            BEAT *sequenceBeats = sequence.sequenceCRepresentation;
+            AESequencerEngineBeat *trackBeats = (AESequencerEngineBeat*)malloc(sizeof(AESequencerEngineBeat) * count);
+            for ( NSUInteger i = 0; i < count; i++ ) {
+                trackBeats[i] = (AESequencerEngineBeat) { .onset = sequenceBeats[i].onset, .velocity = sequenceBeats[i].velocity };
+            }
+            beats[patternIndex * trackCount + track] = trackBeats;
+            beatCounts[patternIndex * trackCount + track] = (uint32_t)count;
+        }
+    }
+    
+    NSUInteger chainLength = _chain.count;
+    uint32_t *chain = (uint32_t*)malloc(sizeof(uint32_t) * MAX(chainLength, 1));
+    for ( NSUInteger i = 0; i < chainLength; i++ ) {
+        chain[i] = [_chain[i] unsignedIntValue];
+    }
+    
+    AESequencerSong *song = AESequencerSongNew((uint32_t)trackCount, (uint32_t)patternCount, beats, beatCounts, chain, (uint32_t)chainLength, _loopsChain);
+    
+    for ( NSUInteger i = 0; i < listCount; i++ ) {
+        free((void*)beats[i]);
+    }
+    free(beats);
+    free(beatCounts);
+    free(chain);
+    
+    if ( !song ) {
+        NSLog(@"AESequencerArranger: Couldn't compile song: check the chain only refers to existing patterns");
+        return;
+    }
+    
+    AESequencerClockSetSong(_clock, song);
+}
+
+-(void)queueChainEntry:(NSUInteger)chainEntry {
+    AESequencerClockQueueChainEntry(_clock, (uint32_t)chainEntry);
+}
+
+#pragma mark - Playback
+
+-(void)setPlaying:(BOOL)playing {
+    AESequencerClockSetPlaying(_clock, playing);
+}
+
+-(BOOL)playing {
+    return AESequencerClockIsPlaying(_clock);
+}
+
+-(void)setBpm:(double)bpm {
+    if ( bpm <= 0 ) {
+        NSLog(@"AESequencerArranger: BPM must be above 0");
+        return;
+    }
+    _bpm = bpm;
+    AESequencerClockSetBarLength(_clock, [self barLengthInFrames]);
+}
+
+-(double)bpm {
+    return _bpm;
+}
+
+-(NSUInteger)currentChainEntry {
+    uint32_t chainEntry;
+    AESequencerClockGetPosition(_clock, &chainEntry, NULL);
+    return chainEntry;
+}
+
+-(float)barPosition {
+    float barPosition;
+    AESequencerClockGetPosition(_clock, NULL, &barPosition);
+    return barPosition;
+}
+
+-(double)barLengthInFrames {
+    return _beatsPerMeasure * (60.0 / _bpm) * _audioController.audioDescription.mSampleRate;
+}
+
+#pragma mark - Timing
+
+static void freeRetiredSongs(void *userInfo, int length) {
+    AESequencerClockFreeRetiredSongs(*(AESequencerSong**)userInfo);
+}
+
+static void timingReceiver(__unsafe_unretained AESequencerArranger *THIS,
+                           __unsafe_unretained AEAudioController *audioController,
+                           const AudioTimeStamp *time,
+                           UInt32 frames,
+                           AEAudioTimingContext context) {
+    if ( context != AEAudioTimingContextOutput ) return;
+    
+    // Work out the timeline for this render, for all tracks
+    AESequencerSong *retiredSongs = AESequencerClockAdvance(THIS->_clock, frames);
+    if ( retiredSongs ) {
+        AEAudioControllerSendAsynchronousMessageToMainThread(audioController, freeRetiredSongs, &retiredSongs, sizeof(retiredSongs));
+    }
+}
+
+-(AEAudioTimingCallback)timingReceiverCallback {
+    return timingReceiver;
+}
+
+@end
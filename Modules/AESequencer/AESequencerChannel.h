@@ -9,7 +9,18 @@
 #import "AEAudioController.h"
 #import "AESequencerBeat.h"
 #import "AESequencerChannelSequence.h"
+#import "AESequencerArranger.h"
 
+/*!
+ * Sequencer channel
+ *
+ *  Plays a sample at each beat of a looping sequence. Timing is counted in frames, so
+ *  beats start on the exact frame they're due; BPM changes take effect at the next
+ *  render without losing the current position within the sequence.
+ *
+ *  Alternatively, the channel can play one track of an AESequencerArranger song, with the
+ *  arranger keeping time and controlling playback.
+ */
 @interface AESequencerChannel : NSObject <AEAudioPlayable>
 
 + (instancetype)sequencerChannelWithAudioFileAt:(NSURL *)url
@@ -18,6 +29,23 @@
                     numberOfFullBeatsPerMeasure:(NSUInteger)beatsPerMeasure
                                           atBPM:(double)bpm;
 
+/*!
+ * Create a channel that plays one track of an arranger's song
+ *
+ *  The arranger's patterns and chain say what the channel plays, and the arranger's tempo
+ *  and playback state apply: the channel's own sequence, bpm and sequenceIsPlaying are
+ *  unused. The arranger must be added as a timing receiver.
+ *
+ * @param url The sample to play
+ * @param audioController The audio controller
+ * @param arranger The arranger
+ * @param track The track within the arranger's patterns to play
+ */
++ (instancetype)sequencerChannelWithAudioFileAt:(NSURL *)url
+                                audioController:(AEAudioController*)audioController
+                                       arranger:(AESequencerArranger*)arranger
+                                          track:(NSUInteger)track;
+
 @property (nonatomic) AESequencerChannelSequence *sequence;
 @property (nonatomic, readwrite) float volume;
 @property (nonatomic, readwrite) float pan;                 
@@ -6,33 +6,27 @@
 //
 
 #import "AESequencerChannel.h"
-#import "AEAudioFileLoaderOperation.h"
-
-#import <mach/mach_time.h>
-
-@interface AESequencerChannel()
-@property float playheadPosition;
-@end
+#import "AEAudioSampleCache.h"
+#import "AESequencerEngine.h"
+#import "AESequencerClock.h"
 
 @implementation AESequencerChannel {
     AEAudioController *_audioController;
+    AEAudioBufferManager *_audioSampleBuffer;
     AudioBufferList *_audioSampleBufferList;
-    UInt32 _sampleLengthInFrames;
-    mach_timebase_info_data_t _timebaseInfo;
-    UInt64 _nanoSecondsPerSequence;
-    UInt64 _nanoSecondsPerFrame;
-    UInt64 _sampleFrameIndex; // Keeps track of the next frame to read on the sample.
-    int _currentBeatIndex; // Keeps track of the current beat playing.
-    UInt64 _sequenceStartTimeNanoSeconds;
-    bool _sampleIsPlaying; // Keeps track if a sample is playing or not.
-    BEAT *_sequenceCRepresentation;
+    const float **_sampleData;
+    AESequencerEngine *_engine;
+    AESequencerEngineBeat *_beats;
     unsigned long _numBeats;
     AESequencerChannelSequence *_sequence;
-    bool _sequenceIsPlaying;
+    volatile bool _sequenceIsPlaying;
+    volatile bool _resetPending; // Set when stopped, so the next play starts from the top
     double _bpm;
     NSUInteger _beatsPerMeasure;
-    float _playheadPosition;
-    unsigned int _numSampleBuffers;
+    AESequencerArranger *_arranger;
+    AESequencerClock *_clock; // Set when following an arranger
+    uint32_t _track;
+    uint64_t _lastRenderCount;
 }
 
 @synthesize pan = _pan, volume = _volume, muted = _muted, soloed = _soloed;
@@ -61,50 +55,95 @@
     }
 
     AESequencerChannel *channel = [[self alloc] init];
-    channel->_audioController = audioController;
-    channel->_pan = 0.0f;
-    channel->_volume = 1.0f;
-    channel->_soloed = 0;
-    channel->_muted = false;
-
-    // Load audio file:
-    AEAudioFileLoaderOperation *operation = [[AEAudioFileLoaderOperation alloc] initWithFileURL:url targetAudioDescription:audioController.audioDescription];
-    [operation start];
-    if ( operation.error ) {
-        NSLog(@"%s Cannot load audio file: error: %@", __PRETTY_FUNCTION__, operation.error);
+    if (![channel loadAudioFileAt:url audioController:audioController]) {
         return nil;
     }
-    channel->_audioSampleBufferList = operation.bufferList;
-    channel->_sampleLengthInFrames = operation.lengthInFrames;
-    channel->_numSampleBuffers = (unsigned int)operation.bufferList->mNumberBuffers;
-    //NSLog(@"Number of buffers in sample: %d", (unsigned int)operation.bufferList->mNumberBuffers);
+
+    channel->_beatsPerMeasure = beatsPerMeasure;
+    channel->_bpm = bpm;
+    AESequencerEngineSetSequenceLength(channel->_engine, [channel sequenceLengthInFrames]);
 
     //Load sequence:
     channel.sequence = sequence;
-    channel->_numBeats = sequence.count;
-    channel->_sequenceCRepresentation = sequence.sequenceCRepresentation;
 
+    //Sequence playback control variables:
+    channel->_sequenceIsPlaying = false;
+    channel->_resetPending = true;
 
-    // Init consistent variables:
-    channel->_sampleFrameIndex = 0;
-    channel->_currentBeatIndex = -1;
-    channel->_sequenceStartTimeNanoSeconds = 0;
-    channel->_sampleIsPlaying = false;
+    return channel;
+}
 
-    // Timing calculations:
-    // Populates _timebaseInfo with data necessary to convert
-    // machine clock ticks to nano seconds later on:
-    mach_timebase_info(&channel->_timebaseInfo);
-    channel->_beatsPerMeasure = beatsPerMeasure;
-    channel->_bpm = bpm;
-    [channel updateBpm];
++ (instancetype)sequencerChannelWithAudioFileAt:(NSURL *)url
+                                audioController:(AEAudioController*)audioController
+                                       arranger:(AESequencerArranger*)arranger
+                                          track:(NSUInteger)track {
 
-    //Sequence playback control variables:
-    channel->_sequenceIsPlaying = false;
+    //Sanity checks
+    if (!url) {
+        NSLog(@"%s Cannot initialize Sequencer Channel if NSURL of audio file is nil.", __PRETTY_FUNCTION__);
+        return nil;
+    }
+    if (!arranger) {
+        NSLog(@"%s Cannot initialize Sequencer Channel with a nil arranger", __PRETTY_FUNCTION__);
+        return nil;
+    }
+
+    AESequencerChannel *channel = [[self alloc] init];
+    if (![channel loadAudioFileAt:url audioController:audioController]) {
+        return nil;
+    }
+
+    // The arranger keeps time, and says what to play:
+    channel->_arranger = arranger;
+    channel->_clock = AESequencerArrangerGetClock(arranger);
+    channel->_track = (uint32_t)track;
+    channel->_lastRenderCount = AESequencerClockGetRenderCount(channel->_clock);
 
     return channel;
 }
 
+- (BOOL)loadAudioFileAt:(NSURL *)url audioController:(AEAudioController*)audioController {
+    _audioController = audioController;
+    _pan = 0.0f;
+    _volume = 1.0f;
+    _soloed = 0;
+    _muted = false;
+
+    // Load audio file, sharing the decoded audio with other channels using the same sample:
+    NSError *error = nil;
+    UInt32 lengthInFrames = 0;
+    AEAudioBufferManager *buffer = [[AEAudioSampleCache sharedCache] audioBufferForFileAtURL:url
+                                                                            audioDescription:audioController.audioDescription
+                                                                              lengthInFrames:&lengthInFrames
+                                                                                       error:&error];
+    if ( !buffer ) {
+        NSLog(@"%s Cannot load audio file: error: %@", __PRETTY_FUNCTION__, error);
+        return NO;
+    }
+    _audioSampleBuffer = buffer;
+    _audioSampleBufferList = AEAudioBufferManagerGetBuffer(buffer);
+
+    // Create the engine, which plays the sample straight from the shared buffer:
+    UInt32 numSampleBuffers = _audioSampleBufferList->mNumberBuffers;
+    _sampleData = (const float **)malloc(sizeof(float*) * numSampleBuffers);
+    for (int i = 0; i < numSampleBuffers; i++) {
+        _sampleData[i] = (const float *)_audioSampleBufferList->mBuffers[i].mData;
+    }
+    _engine = AESequencerEngineNew(_sampleData, numSampleBuffers, lengthInFrames, 1);
+    if (!_engine) {
+        NSLog(@"%s Cannot create sequencer engine", __PRETTY_FUNCTION__);
+        return NO;
+    }
+
+    return YES;
+}
+
+- (void)dealloc {
+    AESequencerEngineFree(_engine);
+    free(_sampleData);
+    free(_beats);
+}
+
 #pragma mark -
 #pragma mark Sequence access
 
@@ -118,32 +157,49 @@
     return _sequence;
 }
 
--(void)updateCSequence {
+static int compareBeats(const void *a, const void *b) {
+    float onsetA = ((const AESequencerEngineBeat *)a)->onset;
+    float onsetB = ((const AESequencerEngineBeat *)b)->onset;
+    return onsetA < onsetB ? -1 : onsetA > onsetB ? 1 : 0;
+}
 
-    // If the sequence's lenght change, update the beat index.
-    if(_sequence.count > _numBeats) {
-        _currentBeatIndex++;
+-(void)updateCSequence {
+    if (!_engine) return;
+
+    // Take a sorted copy of the beats for the engine
+    unsigned long numBeats = _sequence.count;
+    BEAT *sequenceBeats = _sequence.sequenceCRepresentation;
+    AESequencerEngineBeat *beats = numBeats ? (AESequencerEngineBeat *)malloc(sizeof(AESequencerEngineBeat) * numBeats) : NULL;
+    for (unsigned long i = 0; i < numBeats; i++) {
+        beats[i].onset = sequenceBeats[i].onset;
+        beats[i].velocity = sequenceBeats[i].velocity;
     }
-    else if(_sequence.count < _numBeats) {
-        if(_currentBeatIndex > 0) {
-            _currentBeatIndex--;
-        }
+    qsort(beats, numBeats, sizeof(AESequencerEngineBeat), compareBeats);
+
+    if (numBeats == _numBeats && (numBeats == 0 || memcmp(beats, _beats, sizeof(AESequencerEngineBeat) * numBeats) == 0)) {
+        // Nothing's changed
+        free(beats);
+        return;
     }
 
-    _sequenceCRepresentation = [_sequence sequenceCRepresentation];
-    _numBeats = _sequence.count;
+    // Swap the new beats in on the render thread, then free the old ones
+    AESequencerEngineBeat *oldBeats = _beats;
+    _beats = beats;
+    _numBeats = numBeats;
+    AESequencerEngine *engine = _engine;
+    [_audioController performSynchronousMessageExchangeWithBlock:^{
+        AESequencerEngineSetBeats(engine, beats, (uint32_t)numBeats);
+    }];
+    free(oldBeats);
 }
 
 #pragma mark -
 #pragma mark Playback control
 
 - (void)setSequenceIsPlaying:(bool)sequenceIsPlaying {
-    // Reset all timing values when stopped.
+    // Start from the top again, the next time we play.
     if(!sequenceIsPlaying) {
-        _currentBeatIndex = -1;
-        _sequenceStartTimeNanoSeconds = 0;
-        _sampleFrameIndex = 0;
-        _sampleIsPlaying = false;
+        _resetPending = true;
     }
     _sequenceIsPlaying = sequenceIsPlaying;
 }
@@ -155,30 +211,40 @@
 #pragma mark BPM control
 
 - (void)setBpm:(double)bpm {
+    if (bpm <= 0) {
+        NSLog(@"%s BPM must be > 0", __PRETTY_FUNCTION__);
+        return;
+    }
     _bpm = bpm;
-    [self updateBpm];
+    AESequencerEngineSetSequenceLength(_engine, [self sequenceLengthInFrames]);
 }
 
 - (double)bpm {
     return _bpm;
 }
 
-- (void)updateBpm {
-    double nanoSecondsPerBeat = 1000000000.0f * 60.0f / _bpm;
-    _nanoSecondsPerSequence = _beatsPerMeasure * nanoSecondsPerBeat;
-    _nanoSecondsPerFrame = 1000000000.0f / _audioController.audioDescription.mSampleRate;
+- (double)sequenceLengthInFrames {
+    double secondsPerBeat = 60.0 / _bpm;
+    return _beatsPerMeasure * secondsPerBeat * _audioController.audioDescription.mSampleRate;
 }
 
 #pragma mark -
 #pragma mark Playhead
 
 - (float)playheadPosition {
-    return _playheadPosition;
+    if (_clock) {
+        float barPosition;
+        AESequencerClockGetPosition(_clock, NULL, &barPosition);
+        return barPosition;
+    }
+    return AESequencerEngineGetPlayheadPosition(_engine);
 }
 
 #pragma mark -
 #pragma mark Render callback
 
+static void renderArrangement(AESequencerChannel *THIS, float * const *buffers, UInt32 numberOfBuffers, UInt32 frames, bool audible);
+
 static OSStatus renderCallback(__unsafe_unretained AESequencerChannel *THIS,
                                __unsafe_unretained AEAudioController *audioController,
                                const AudioTimeStamp *inTimeStamp,
@@ -186,85 +252,61 @@ static OSStatus renderCallback(__unsafe_unretained AESequencerChannel *THIS,
                                AudioBufferList *audio) {
 
     // Skip if channel is not playing or stopped.
-    if (!THIS->_sequenceIsPlaying) return noErr;
-    
-    // Keep track of when a sequence iteration starts and ends.
-    UInt64 k = THIS->_timebaseInfo.numer / THIS->_timebaseInfo.denom;
-    UInt64 currentTimeNanoSeconds = inTimeStamp->mHostTime * k;
-    if(THIS->_sequenceStartTimeNanoSeconds == 0) {
-        THIS->_sequenceStartTimeNanoSeconds = currentTimeNanoSeconds;
+    if (!THIS->_clock && !THIS->_sequenceIsPlaying) return noErr;
+
+    if (THIS->_resetPending) {
+        THIS->_resetPending = false;
+        AESequencerEngineReset(THIS->_engine);
     }
-    
-    // Evaluate time passed in this sequence iteration.
-    // If a sequence iteration has ended, values are shifted so that a new iteration begins.
-    UInt64 elapsedTimeSinceSequenceStartNanoSeconds = currentTimeNanoSeconds - THIS->_sequenceStartTimeNanoSeconds;
-
-    if(elapsedTimeSinceSequenceStartNanoSeconds > THIS->_nanoSecondsPerSequence) { // reset?
-        elapsedTimeSinceSequenceStartNanoSeconds = elapsedTimeSinceSequenceStartNanoSeconds % THIS->_nanoSecondsPerSequence;
-        THIS->_sequenceStartTimeNanoSeconds = currentTimeNanoSeconds - elapsedTimeSinceSequenceStartNanoSeconds;
-        THIS->_currentBeatIndex = -1;
+
+    bool audible = true;
+    if(THIS->_soloed == -1) audible = false; // don't write if some other channel is soloed
+    if(THIS->_muted && THIS->_soloed != 1) audible = false; // don't write if this channel is muted and is not soloed
+
+    // The engine works out where each beat falls within this buffer, and renders the sample
+    // in whole segments between them. If the sample is mono and audio is stereo, the engine
+    // writes the same thing on both channels.
+    float *buffers[audio->mNumberBuffers];
+    for (int i = 0; i < audio->mNumberBuffers; i++) {
+        buffers[i] = (float *)audio->mBuffers[i].mData;
     }
 
-    THIS->_playheadPosition = (float)elapsedTimeSinceSequenceStartNanoSeconds / (float)THIS->_nanoSecondsPerSequence;
-
-    
-    // Quickly evaluate if there will be no audio in this renderCallback() and hence writting to buffers can be skipped entirely.
-
-    // Sweep the audio buffer frames and fill with sample frames when appropriate.
-    UInt64 frameTimeNanoSeconds = 0;
-    int buff = 0;
-    for(int i = 0; i < frames; i++) {
-        
-        // Check if the coming beat is suposed to have started by now.
-        int nextBeatIndex = THIS->_currentBeatIndex + 1 < THIS->_numBeats ? THIS->_currentBeatIndex + 1 : -1;
-        if(nextBeatIndex >= 0) {
-            BEAT beat = THIS->_sequenceCRepresentation[nextBeatIndex];
-            double beatTimeNanoSeconds = THIS->_nanoSecondsPerSequence * beat.onset;
-            double delta = elapsedTimeSinceSequenceStartNanoSeconds + frameTimeNanoSeconds - beatTimeNanoSeconds;
-            if(delta >= 0) {
-                THIS->_sampleFrameIndex = 0;
-                THIS->_sampleIsPlaying = true;
-                THIS->_currentBeatIndex = nextBeatIndex;
-            }
-        }
-        
-        // Make some noise?
-        if(THIS->_sampleIsPlaying) {
-            
-            // Writes the same samples on left and right channels.
-            if(THIS->_currentBeatIndex >= 0) {
-                
-                bool write = true;
-                if(THIS->_soloed == -1) write = false; // don't write if some other channel is soloed
-                if(THIS->_muted && THIS->_soloed != 1) write = false; // don't write if this channel is muted and is not soloed
-                
-                if(write) {
-                    for(int j = 0; j < audio->mNumberBuffers; j++) {
-                        if (THIS->_currentBeatIndex >= THIS->_numBeats) break;
-                        // Makes sure that the audio will not request buffers that the sample doesn't have.
-                        // i.e. if the sample is mono and audio is stereo, writes the same thing on both channels.
-                        buff = j < THIS->_numSampleBuffers ? j : buff;
-
-                        BEAT beat = THIS->_sequenceCRepresentation[THIS->_currentBeatIndex];
-                        ((float *)audio->mBuffers[j].mData)[i] = beat.velocity * ((float *)THIS->_audioSampleBufferList->mBuffers[j].mData)[THIS->_sampleFrameIndex];
-                    }
-                }
-            }
-            
-            // Advance sample frame.
-            THIS->_sampleFrameIndex++;
-            if(THIS->_sampleFrameIndex > THIS->_sampleLengthInFrames) {
-                THIS->_sampleIsPlaying = false;
-            }
-        }
-        
-        // Advance time.
-        frameTimeNanoSeconds += THIS->_nanoSecondsPerFrame;
+    if (THIS->_clock) {
+        renderArrangement(THIS, buffers, audio->mNumberBuffers, frames, audible);
+    } else {
+        AESequencerEngineRender(THIS->_engine, buffers, audio->mNumberBuffers, frames, audible);
     }
 
     return noErr;
 }
 
+static void renderArrangement(__unsafe_unretained AESequencerChannel *THIS,
+                              float * const *buffers,
+                              UInt32 numberOfBuffers,
+                              UInt32 frames,
+                              bool audible) {
+
+    // Play this track's part of the timeline the arranger worked out for this render, just once
+    uint64_t renderCount = AESequencerClockGetRenderCount(THIS->_clock);
+    if (renderCount == THIS->_lastRenderCount) return;
+    THIS->_lastRenderCount = renderCount;
+
+    AESequencerClockSpanCursor cursor;
+    AESequencerClockBeginSpans(THIS->_clock, &cursor);
+    AESequencerClockSpan span;
+    while (AESequencerClockNextSpan(THIS->_clock, &cursor, &span)) {
+        if (span.offset >= frames) break;
+        if (span.restart) {
+            AESequencerEngineReset(THIS->_engine);
+        }
+
+        uint32_t beatCount = 0;
+        const AESequencerEngineBeat *beats = span.song ? AESequencerSongGetBeats(span.song, span.pattern, THIS->_track, &beatCount) : NULL;
+        AESequencerEngineRenderSpan(THIS->_engine, buffers, numberOfBuffers, span.offset, MIN(span.frames, frames - span.offset),
+                                    span.position, span.barFrames, beats, beatCount, audible);
+    }
+}
+
 -(AEAudioRenderCallback)renderCallback {
     return &renderCallback;
 }
@@ -13,6 +13,10 @@
     BEAT* _sequenceCRepresentation;
 }
 
+- (void)dealloc {
+    free(_sequenceCRepresentation);
+}
+
 - (void)addBeat:(AESequencerBeat *)beat {
 
     if (!beat) return;
@@ -76,6 +80,8 @@
 - (void)updateSequenceCRepresentation {
     NSUInteger numberOfBeats = sequence.count;
 
+    // Channels and arrangers copy the beats on the main thread, so the old array can go
+    free(_sequenceCRepresentation);
     _sequenceCRepresentation = (BEAT *)malloc(sizeof(BEAT) * numberOfBeats);
 
     for(int i=0; i < numberOfBeats; i++) {
@@ -0,0 +1,382 @@
+//
+//  AESequencerClock.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AESequencerClock.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static const double kMinimumBarFrames = 64.0;
+static const int32_t kNoQueuedChainEntry = -1;
+
+struct AESequencerSong {
+    uint32_t            tracks;
+    uint32_t            patterns;
+    AESequencerEngineBeat *beats;           // Every track of every pattern, one after the other
+    uint32_t           *beatOffsets;        // Where each track of each pattern starts within beats, plus the end
+    uint32_t           *chain;
+    uint32_t            chainLength;
+    bool                loop;
+    AESequencerSong    *nextRetired;
+};
+
+typedef struct {
+    uint32_t            frames;             // Length of the render; 0 if the clock is stopped
+    double              barFrames;
+    double              position;           // Position within the bar at the start of the render
+    uint32_t            chainEntry;         // Bar of the chain at the start of the render
+    AESequencerSong    *song;               // Song playing at the start of the render
+    bool                restart;
+    uint32_t            nextChainEntry;     // Bar of the chain after the first bar boundary
+    AESequencerSong    *nextSong;           // Song playing after the first bar boundary
+    bool                stopsAtFirstBar;    // Whether playback ends at the first bar boundary
+} render_t;
+
+struct AESequencerClock {
+    double              barFrames;
+    volatile double     pendingBarFrames;
+    volatile bool       playing;
+    volatile bool       restartPending;
+    AESequencerSong * volatile pendingSong;
+    volatile int32_t    queuedChainEntry;
+
+    // Render thread state
+    AESequencerSong    *song;
+    AESequencerSong    *retired;            // Replaced during the last render; freeable from the next
+    double              position;           // Frames into the current bar
+    uint32_t            chainEntry;
+    render_t            render;             // The timeline of the current render
+
+    // Published for other threads
+    volatile uint64_t   renderCount;
+    volatile uint32_t   publishedChainEntry;
+    volatile float      publishedBarPosition;
+};
+
+static int compareBeats(const void *a, const void *b);
+static bool nextSpan(const render_t *render, AESequencerClockSpanCursor *cursor, AESequencerClockSpan *outSpan);
+static void advanceBar(AESequencerClock *clock);
+static void adoptPendingSong(AESequencerClock *clock);
+
+#pragma mark - Songs
+
+AESequencerSong *AESequencerSongNew(uint32_t tracks, uint32_t patterns, const AESequencerEngineBeat * const *beats, const uint32_t *beatCounts,
+                                    const uint32_t *chain, uint32_t chainLength, bool loop) {
+    for ( uint32_t i=0; i<chainLength; i++ ) {
+        if ( chain[i] >= patterns ) return NULL;
+    }
+
+    AESequencerSong *song = (AESequencerSong*)calloc(1, sizeof(AESequencerSong));
+    if ( !song ) return NULL;
+    song->tracks = tracks;
+    song->patterns = patterns;
+    song->chainLength = chainLength;
+    song->loop = loop;
+
+    uint32_t lists = tracks * patterns;
+    uint32_t totalBeats = 0;
+    for ( uint32_t i=0; i<lists; i++ ) {
+        totalBeats += beats[i] ? beatCounts[i] : 0;
+    }
+
+    song->beatOffsets = (uint32_t*)malloc(sizeof(uint32_t) * (lists + 1));
+    song->beats = (AESequencerEngineBeat*)malloc(sizeof(AESequencerEngineBeat) * (totalBeats ? totalBeats : 1));
+    song->chain = (uint32_t*)malloc(sizeof(uint32_t) * (chainLength ? chainLength : 1));
+    if ( !song->beatOffsets || !song->beats || !song->chain ) {
+        AESequencerSongFree(song);
+        return NULL;
+    }
+
+    uint32_t offset = 0;
+    for ( uint32_t i=0; i<lists; i++ ) {
+        song->beatOffsets[i] = offset;
+        uint32_t count = beats[i] ? beatCounts[i] : 0;
+        if ( count ) {
+            memcpy(song->beats + offset, beats[i], sizeof(AESequencerEngineBeat) * count);
+            qsort(song->beats + offset, count, sizeof(AESequencerEngineBeat), compareBeats);
+        }
+        offset += count;
+    }
+    song->beatOffsets[lists] = offset;
+
+    if ( chainLength ) {
+        memcpy(song->chain, chain, sizeof(uint32_t) * chainLength);
+    }
+
+    return song;
+}
+
+void AESequencerSongFree(AESequencerSong *song) {
+    if ( !song ) return;
+    free(song->beats);
+    free(song->beatOffsets);
+    free(song->chain);
+    free(song);
+}
+
+const AESequencerEngineBeat *AESequencerSongGetBeats(const AESequencerSong *song, uint32_t pattern, uint32_t track, uint32_t *outCount) {
+    if ( pattern >= song->patterns || track >= song->tracks ) {
+        *outCount = 0;
+        return NULL;
+    }
+    uint32_t list = pattern * song->tracks + track;
+    *outCount = song->beatOffsets[list+1] - song->beatOffsets[list];
+    return *outCount ? song->beats + song->beatOffsets[list] : NULL;
+}
+
+#pragma mark - Clock
+
+AESequencerClock *AESequencerClockNew(double barFrames) {
+    AESequencerClock *clock = (AESequencerClock*)calloc(1, sizeof(AESequencerClock));
+    if ( !clock ) return NULL;
+    clock->barFrames = clock->pendingBarFrames = fmax(barFrames, kMinimumBarFrames);
+    clock->queuedChainEntry = kNoQueuedChainEntry;
+    return clock;
+}
+
+void AESequencerClockFree(AESequencerClock *clock) {
+    if ( !clock ) return;
+    AESequencerSongFree(clock->song);
+    AESequencerSongFree(clock->pendingSong);
+    AESequencerClockFreeRetiredSongs(clock->retired);
+    free(clock);
+}
+
+void AESequencerClockSetSong(AESequencerClock *clock, AESequencerSong *song) {
+    __sync_synchronize();
+    AESequencerSong *replaced = __sync_lock_test_and_set(&clock->pendingSong, song);
+
+    // The render thread never saw a song that was still pending, so it can go straight away
+    AESequencerSongFree(replaced);
+}
+
+void AESequencerClockQueueChainEntry(AESequencerClock *clock, uint32_t chainEntry) {
+    clock->queuedChainEntry = (int32_t)chainEntry;
+}
+
+void AESequencerClockSetBarLength(AESequencerClock *clock, double barFrames) {
+    clock->pendingBarFrames = fmax(barFrames, kMinimumBarFrames);
+}
+
+void AESequencerClockSetPlaying(AESequencerClock *clock, bool playing) {
+    if ( playing && !clock->playing ) {
+        clock->restartPending = true;
+        __sync_synchronize();
+    }
+    clock->playing = playing;
+}
+
+bool AESequencerClockIsPlaying(const AESequencerClock *clock) {
+    return clock->playing;
+}
+
+uint64_t AESequencerClockGetRenderCount(const AESequencerClock *clock) {
+    return clock->renderCount;
+}
+
+void AESequencerClockGetPosition(const AESequencerClock *clock, uint32_t *outChainEntry, float *outBarPosition) {
+    if ( outChainEntry ) *outChainEntry = clock->publishedChainEntry;
+    if ( outBarPosition ) *outBarPosition = clock->publishedBarPosition;
+}
+
+void AESequencerClockBeginSpans(const AESequencerClock *clock, AESequencerClockSpanCursor *cursor) {
+    cursor->offset = 0;
+    cursor->position = clock->render.position;
+    cursor->chainEntry = clock->render.chainEntry;
+    cursor->bars = 0;
+    cursor->stopped = false;
+}
+
+bool AESequencerClockNextSpan(const AESequencerClock *clock, AESequencerClockSpanCursor *cursor, AESequencerClockSpan *outSpan) {
+    return nextSpan(&clock->render, cursor, outSpan);
+}
+
+void AESequencerClockFreeRetiredSongs(AESequencerSong *songs) {
+    while ( songs ) {
+        AESequencerSong *next = songs->nextRetired;
+        AESequencerSongFree(songs);
+        songs = next;
+    }
+}
+
+#pragma mark - Rendering
+
+AESequencerSong *AESequencerClockAdvance(AESequencerClock *clock, uint32_t frames) {
+    clock->renderCount++;
+    clock->render.frames = 0;
+
+    // The last render has finished with anything it replaced
+    AESequencerSong *freeable = clock->retired;
+    clock->retired = NULL;
+
+    double barFrames = clock->pendingBarFrames;
+    if ( barFrames != clock->barFrames ) {
+        // Keep our place within the bar at the new length
+        clock->position *= barFrames / clock->barFrames;
+        clock->barFrames = barFrames;
+    }
+
+    if ( !clock->playing ) return freeable;
+
+    bool restart = false;
+    if ( clock->restartPending ) {
+        clock->restartPending = false;
+        clock->position = 0;
+        clock->chainEntry = 0;
+        restart = true;
+    }
+
+    if ( restart || !clock->song ) {
+        // Nothing's playing a song yet, so there's no bar to wait for
+        adoptPendingSong(clock);
+        if ( restart ) {
+            int32_t queued = __sync_lock_test_and_set(&clock->queuedChainEntry, kNoQueuedChainEntry);
+            if ( queued != kNoQueuedChainEntry && clock->song && (uint32_t)queued < clock->song->chainLength ) {
+                clock->chainEntry = (uint32_t)queued;
+            }
+        }
+    }
+
+    render_t *render = &clock->render;
+    *render = (render_t) {
+        .frames = frames,
+        .barFrames = barFrames,
+        .position = clock->position,
+        .chainEntry = clock->chainEntry,
+        .song = clock->song,
+        .restart = restart,
+        .nextChainEntry = clock->chainEntry,
+        .nextSong = clock->song
+    };
+
+    if ( ceil(barFrames - clock->position) <= frames ) {
+        // The render reaches the end of the bar. New songs and queued bars take over there; any further
+        // bars within the render just follow on along the chain.
+        advanceBar(clock);
+        render->nextChainEntry = clock->chainEntry;
+        render->nextSong = clock->song;
+        render->stopsAtFirstBar = !clock->playing;
+    }
+
+    // Walk through the render, a span at a time, to where the timeline ends up
+    AESequencerClockSpanCursor cursor;
+    AESequencerClockBeginSpans(clock, &cursor);
+    AESequencerClockSpan span;
+    while ( nextSpan(render, &cursor, &span) );
+    clock->position = cursor.position;
+    clock->chainEntry = cursor.chainEntry;
+    if ( cursor.stopped ) {
+        clock->playing = false;
+    }
+
+    clock->publishedChainEntry = clock->chainEntry;
+    clock->publishedBarPosition = (float)(clock->position / barFrames);
+
+    return freeable;
+}
+
+static bool nextSpan(const render_t *render, AESequencerClockSpanCursor *cursor, AESequencerClockSpan *outSpan) {
+    if ( cursor->offset >= render->frames || cursor->stopped ) return false;
+
+    // Span to the end of the render, or of the bar
+    uint32_t spanFrames = render->frames - cursor->offset;
+    double framesToBarEnd = ceil(render->barFrames - cursor->position);
+    if ( framesToBarEnd < spanFrames ) {
+        spanFrames = (uint32_t)framesToBarEnd;
+    }
+
+    const AESequencerSong *song = cursor->bars == 0 ? render->song : render->nextSong;
+    if ( song && !song->chainLength ) song = NULL;
+    *outSpan = (AESequencerClockSpan) {
+        .offset = cursor->offset,
+        .frames = spanFrames,
+        .position = cursor->position,
+        .barFrames = render->barFrames,
+        .song = song,
+        .chainEntry = cursor->chainEntry,
+        .pattern = song ? song->chain[cursor->chainEntry] : 0,
+        .restart = render->restart && cursor->offset == 0
+    };
+
+    cursor->position += spanFrames;
+    cursor->offset += spanFrames;
+    if ( cursor->position >= render->barFrames ) {
+        cursor->position -= render->barFrames;
+        if ( cursor->bars++ == 0 ) {
+            cursor->chainEntry = render->nextChainEntry;
+            cursor->stopped = render->stopsAtFirstBar;
+        } else if ( ++cursor->chainEntry >= (render->nextSong ? render->nextSong->chainLength : 0) ) {
+            cursor->stopped = render->nextSong && !render->nextSong->loop;
+            cursor->chainEntry = 0;
+        }
+    }
+
+    return true;
+}
+
+static void advanceBar(AESequencerClock *clock) {
+    uint32_t chainEntry = clock->chainEntry + 1;
+
+    AESequencerSong *previousSong = clock->song;
+    adoptPendingSong(clock);
+    bool newSong = clock->song != previousSong;
+
+    int32_t queued = __sync_lock_test_and_set(&clock->queuedChainEntry, kNoQueuedChainEntry);
+    if ( queued != kNoQueuedChainEntry ) {
+        chainEntry = (uint32_t)queued;
+    }
+
+    uint32_t chainLength = clock->song ? clock->song->chainLength : 0;
+    if ( chainEntry >= chainLength ) {
+        if ( clock->song && !clock->song->loop && !newSong && queued == kNoQueuedChainEntry ) {
+            // That was the last bar
+            clock->playing = false;
+        }
+        chainEntry = 0;
+    }
+
+    clock->chainEntry = chainEntry;
+}
+
+static void adoptPendingSong(AESequencerClock *clock) {
+    if ( !clock->pendingSong ) return;
+    AESequencerSong *song = __sync_lock_test_and_set(&clock->pendingSong, NULL);
+    if ( !song ) return;
+
+    if ( clock->song ) {
+        // Tracks may yet play the old song's spans in this render, so hold on to it until the next
+        clock->song->nextRetired = clock->retired;
+        clock->retired = clock->song;
+    }
+    clock->song = song;
+}
+
+#pragma mark - Helpers
+
+static int compareBeats(const void *a, const void *b) {
+    float onsetA = ((const AESequencerEngineBeat *)a)->onset;
+    float onsetB = ((const AESequencerEngineBeat *)b)->onset;
+    return onsetA < onsetB ? -1 : onsetA > onsetB ? 1 : 0;
+}
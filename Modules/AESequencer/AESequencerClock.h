@@ -0,0 +1,239 @@
+//
+//  AESequencerClock.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "AESequencerEngine.h"
+
+/*!
+ * A compiled song
+ *
+ *  An immutable arrangement of patterns. A pattern holds one bar of beats for each track, and the
+ *  chain lists the pattern to play in each bar, in order.
+ */
+typedef struct AESequencerSong AESequencerSong;
+
+/*!
+ * Compile a song
+ *
+ *  The beats are copied and sorted, so the arguments needn't outlive the call.
+ *
+ * @param tracks       Number of tracks
+ * @param patterns     Number of patterns
+ * @param beats        Beats for each track of each pattern, at [pattern * tracks + track]; NULL entries are silent
+ * @param beatCounts   Number of beats for each track of each pattern, indexed as beats
+ * @param chain        Pattern index for each bar of the song
+ * @param chainLength  Number of bars
+ * @param loop         Whether to return to the first bar after the last, rather than stopping
+ * @return The song, or NULL on allocation failure or if the chain refers to a missing pattern
+ */
+AESequencerSong *AESequencerSongNew(uint32_t tracks, uint32_t patterns, const AESequencerEngineBeat * const *beats, const uint32_t *beatCounts,
+                                    const uint32_t *chain, uint32_t chainLength, bool loop);
+
+/*!
+ * Free a song
+ */
+void AESequencerSongFree(AESequencerSong *song);
+
+/*!
+ * Get the beats for one track of one pattern
+ *
+ * @param song     The song
+ * @param pattern  Pattern index
+ * @param track    Track index
+ * @param outCount On output, the number of beats
+ * @return The beats, sorted by onset, or NULL if there are none
+ */
+const AESequencerEngineBeat *AESequencerSongGetBeats(const AESequencerSong *song, uint32_t pattern, uint32_t track, uint32_t *outCount);
+
+/*!
+ * A span of the timeline within one render
+ *
+ *  Each render's timeline is broken into spans at bar boundaries, so that within a span, one
+ *  pattern plays at a steady position.
+ */
+typedef struct {
+    uint32_t offset;                //!< Frame within the render at which the span starts
+    uint32_t frames;                //!< Length of the span, in frames
+    double position;                //!< Position within the bar at the start of the span, in frames
+    double barFrames;               //!< Length of the bar, in frames
+    const AESequencerSong *song;    //!< The song playing
+    uint32_t chainEntry;            //!< Bar of the song's chain playing
+    uint32_t pattern;               //!< Pattern playing
+    bool restart;                   //!< Whether playback started afresh here, so anything still sounding should stop
+} AESequencerClockSpan;
+
+/*!
+ * Sequencer clock
+ *
+ *  Keeps the timeline for any number of tracks: it's advanced once per render, and each track
+ *  then plays its part of the spans worked out for that render, rather than keeping time itself.
+ *
+ *  New songs take over at the start of the next bar, continuing from the following bar of the
+ *  chain, or from its start if the new chain is shorter. They're passed in through an atomic
+ *  pointer, and the song they replace is handed back from a later advance, once nothing can
+ *  still be playing it, to be freed away from the render thread.
+ *
+ *  Bar length changes take effect at the start of the next render, at the same position
+ *  within the bar.
+ */
+typedef struct AESequencerClock AESequencerClock;
+
+/*!
+ * Create a clock
+ *
+ *  The clock starts stopped.
+ *
+ * @param barFrames Length of one bar, in frames
+ * @return The clock, or NULL on allocation failure
+ */
+AESequencerClock *AESequencerClockNew(double barFrames);
+
+/*!
+ * Free a clock, along with any songs it holds
+ */
+void AESequencerClockFree(AESequencerClock *clock);
+
+/*!
+ * Set the song
+ *
+ *  Use from one thread other than the render thread. The clock takes ownership of the song. It
+ *  takes over at the next bar, or at the next render if there's no song playing.
+ *
+ * @param clock The clock
+ * @param song  The song
+ */
+void AESequencerClockSetSong(AESequencerClock *clock, AESequencerSong *song);
+
+/*!
+ * Move to a bar of the chain at the next bar boundary
+ *
+ *  Safe to use from any thread.
+ *
+ * @param clock       The clock
+ * @param chainEntry  The bar of the chain to play next
+ */
+void AESequencerClockQueueChainEntry(AESequencerClock *clock, uint32_t chainEntry);
+
+/*!
+ * Set the length of a bar
+ *
+ *  Safe to use from any thread. Takes effect at the start of the next render.
+ */
+void AESequencerClockSetBarLength(AESequencerClock *clock, double barFrames);
+
+/*!
+ * Start or stop the clock
+ *
+ *  Safe to use from any thread. Starting plays from the first bar of the chain.
+ */
+void AESequencerClockSetPlaying(AESequencerClock *clock, bool playing);
+
+/*!
+ * Determine whether the clock is playing
+ *
+ *  Safe to use from any thread. The clock stops by itself at the end of a song that doesn't loop.
+ */
+bool AESequencerClockIsPlaying(const AESequencerClock *clock);
+
+/*!
+ * Advance the clock by one render
+ *
+ *  Use from the render thread, once per render, before any tracks render.
+ *
+ * @param clock   The clock
+ * @param frames  Number of frames in the render
+ * @return Songs retired before this render, no longer in use, for freeing on another thread with
+ *      @link AESequencerClockFreeRetiredSongs @endlink; or NULL
+ */
+AESequencerSong *AESequencerClockAdvance(AESequencerClock *clock, uint32_t frames);
+
+/*!
+ * Free songs returned by @link AESequencerClockAdvance @endlink
+ */
+void AESequencerClockFreeRetiredSongs(AESequencerSong *songs);
+
+/*!
+ * Position while walking through the spans of a render
+ *
+ *  Treat this structure as opaque.
+ */
+typedef struct {
+    uint32_t offset;
+    double   position;
+    uint32_t chainEntry;
+    uint32_t bars;
+    bool     stopped;
+} AESequencerClockSpanCursor;
+
+/*!
+ * Start walking through the spans of the current render
+ *
+ *  Use from the render thread, after @link AESequencerClockAdvance @endlink. Spans are worked
+ *  out as they're walked through, rather than stored, so a render can hold any number of them.
+ *
+ * @param clock   The clock
+ * @param cursor  The cursor to start, for @link AESequencerClockNextSpan @endlink
+ */
+void AESequencerClockBeginSpans(const AESequencerClock *clock, AESequencerClockSpanCursor *cursor);
+
+/*!
+ * Get the next span of the current render
+ *
+ *  Use from the render thread. There are no spans while the clock is stopped.
+ *
+ * @param clock    The clock
+ * @param cursor   A cursor started with @link AESequencerClockBeginSpans @endlink
+ * @param outSpan  On output, the span
+ * @return false once there are no more spans, else true
+ */
+bool AESequencerClockNextSpan(const AESequencerClock *clock, AESequencerClockSpanCursor *cursor, AESequencerClockSpan *outSpan);
+
+/*!
+ * Get the number of renders the clock has advanced through
+ *
+ *  Tracks can compare this against the count at their last render, to avoid playing the same
+ *  spans twice if the clock isn't being advanced.
+ */
+uint64_t AESequencerClockGetRenderCount(const AESequencerClock *clock);
+
+/*!
+ * Get the current position
+ *
+ *  Safe to use from any thread.
+ *
+ * @param clock          The clock
+ * @param outChainEntry  On output, if not NULL, the bar of the chain playing
+ * @param outBarPosition On output, if not NULL, the position within the bar, from 0 to 1
+ */
+void AESequencerClockGetPosition(const AESequencerClock *clock, uint32_t *outChainEntry, float *outBarPosition);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,195 @@
+//
+//  AESequencerEngine.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AESequencerEngine.h"
+#include <stdlib.h>
+#include <math.h>
+
+struct AESequencerEngine {
+    const float * const *sample;
+    uint32_t            sampleChannels;
+    uint32_t            sampleFrames;
+    const AESequencerEngineBeat *beats;
+    uint32_t            beatCount;
+    double              sequenceFrames;
+    volatile double     pendingSequenceFrames;
+    double              position;           // Frames since the start of this pass through the sequence
+    bool                voiceActive;
+    uint32_t            voicePosition;      // Next frame of the sample to play
+    float               voiceGain;
+    volatile float      playheadPosition;
+};
+
+static uint32_t firstBeatAfter(const AESequencerEngineBeat *beats, uint32_t count, double sequenceFrames, double frame);
+static double onsetFrame(const AESequencerEngineBeat *beat, double sequenceFrames);
+static void renderVoice(AESequencerEngine *engine, float * const *output, uint32_t channels, uint32_t offset, uint32_t frames, bool audible);
+
+AESequencerEngine *AESequencerEngineNew(const float * const *sample, uint32_t sampleChannels, uint32_t sampleFrames, double sequenceFrames) {
+    if ( sampleChannels == 0 ) return NULL;
+
+    AESequencerEngine *engine = (AESequencerEngine*)calloc(1, sizeof(AESequencerEngine));
+    if ( !engine ) return NULL;
+
+    engine->sample = sample;
+    engine->sampleChannels = sampleChannels;
+    engine->sampleFrames = sampleFrames;
+    engine->sequenceFrames = engine->pendingSequenceFrames = fmax(sequenceFrames, 1.0);
+
+    return engine;
+}
+
+void AESequencerEngineFree(AESequencerEngine *engine) {
+    free(engine);
+}
+
+void AESequencerEngineSetBeats(AESequencerEngine *engine, const AESequencerEngineBeat *beats, uint32_t count) {
+    engine->beats = beats;
+    engine->beatCount = count;
+}
+
+void AESequencerEngineSetSequenceLength(AESequencerEngine *engine, double sequenceFrames) {
+    engine->pendingSequenceFrames = fmax(sequenceFrames, 1.0);
+}
+
+void AESequencerEngineReset(AESequencerEngine *engine) {
+    engine->position = 0;
+    engine->voiceActive = false;
+    engine->playheadPosition = 0;
+}
+
+float AESequencerEngineGetPlayheadPosition(const AESequencerEngine *engine) {
+    return engine->playheadPosition;
+}
+
+#pragma mark - Rendering
+
+void AESequencerEngineRender(AESequencerEngine *engine, float * const *output, uint32_t channels, uint32_t frames, bool audible) {
+    double sequenceFrames = engine->pendingSequenceFrames;
+    if ( sequenceFrames != engine->sequenceFrames ) {
+        // Keep our place within the sequence at the new length; the beat order is unchanged
+        engine->position *= sequenceFrames / engine->sequenceFrames;
+        engine->sequenceFrames = sequenceFrames;
+    }
+
+    engine->playheadPosition = (float)(engine->position / sequenceFrames);
+
+    uint32_t offset = 0;
+    while ( offset < frames ) {
+        // Render up to the end of the buffer, or the end of the sequence
+        uint32_t spanFrames = frames - offset;
+        double framesToEnd = ceil(sequenceFrames - engine->position);
+        if ( framesToEnd < spanFrames ) {
+            spanFrames = (uint32_t)framesToEnd;
+        }
+
+        AESequencerEngineRenderSpan(engine, output, channels, offset, spanFrames, engine->position, sequenceFrames,
+                                    engine->beats, engine->beatCount, audible);
+
+        engine->position += spanFrames;
+        offset += spanFrames;
+        if ( engine->position >= sequenceFrames ) {
+            engine->position -= sequenceFrames;
+        }
+    }
+}
+
+void AESequencerEngineRenderSpan(AESequencerEngine *engine, float * const *output, uint32_t channels, uint32_t offset, uint32_t frames,
+                                 double position, double sequenceFrames, const AESequencerEngineBeat *beats, uint32_t count, bool audible) {
+
+    // Beats sound on the first frame at or after their onset, so those due in this span have onsets
+    // within a frame before the span starts, up to a frame before it ends
+    uint32_t nextBeat = firstBeatAfter(beats, count, sequenceFrames, position - 1.0);
+
+    uint32_t end = offset + frames;
+    while ( offset < end ) {
+        uint32_t segmentEnd = end;
+        bool beatDue = false;
+        if ( nextBeat < count ) {
+            double framesToBeat = ceil(onsetFrame(&beats[nextBeat], sequenceFrames) - position);
+            if ( framesToBeat < 0 ) framesToBeat = 0;
+            if ( framesToBeat < end - offset ) {
+                segmentEnd = offset + (uint32_t)framesToBeat;
+                beatDue = true;
+            }
+        }
+
+        if ( engine->voiceActive && segmentEnd > offset ) {
+            renderVoice(engine, output, channels, offset, segmentEnd - offset, audible);
+        }
+
+        position += segmentEnd - offset;
+        offset = segmentEnd;
+
+        if ( beatDue ) {
+            const AESequencerEngineBeat *beat = &beats[nextBeat++];
+            engine->voiceActive = engine->sampleFrames > 0;
+            engine->voicePosition = 0;
+            engine->voiceGain = beat->velocity;
+        }
+    }
+}
+
+static void renderVoice(AESequencerEngine *engine, float * const *output, uint32_t channels, uint32_t offset, uint32_t frames, bool audible) {
+    uint32_t remaining = engine->sampleFrames - engine->voicePosition;
+    if ( frames > remaining ) frames = remaining;
+
+    if ( audible ) {
+        float gain = engine->voiceGain;
+        for ( uint32_t channel=0; channel<channels; channel++ ) {
+            uint32_t sampleChannel = channel < engine->sampleChannels ? channel : engine->sampleChannels-1;
+            const float * restrict source = engine->sample[sampleChannel] + engine->voicePosition;
+            float * restrict target = output[channel] + offset;
+            for ( uint32_t i=0; i<frames; i++ ) {
+                target[i] = source[i] * gain;
+            }
+        }
+    }
+
+    engine->voicePosition += frames;
+    if ( engine->voicePosition >= engine->sampleFrames ) {
+        engine->voiceActive = false;
+    }
+}
+
+#pragma mark - Helpers
+
+static double onsetFrame(const AESequencerEngineBeat *beat, double sequenceFrames) {
+    // Beats at the very end of the sequence sound on its last frame
+    double frame = beat->onset * sequenceFrames;
+    return frame < sequenceFrames - 1.0 ? frame : sequenceFrames - 1.0;
+}
+
+static uint32_t firstBeatAfter(const AESequencerEngineBeat *beats, uint32_t count, double sequenceFrames, double frame) {
+    uint32_t lower = 0, upper = count;
+    while ( lower < upper ) {
+        uint32_t middle = (lower + upper) / 2;
+        if ( onsetFrame(&beats[middle], sequenceFrames) <= frame ) {
+            lower = middle + 1;
+        } else {
+            upper = middle;
+        }
+    }
+    return lower;
+}
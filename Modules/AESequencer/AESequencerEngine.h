@@ -0,0 +1,154 @@
+//
+//  AESequencerEngine.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * A beat, as seen by the sequencer engine
+ */
+typedef struct {
+    float onset;        //!< Position within the sequence, from 0 at the start to 1 at the end
+    float velocity;     //!< Gain applied to the sample, from 0 to 1
+} AESequencerEngineBeat;
+
+/*!
+ * Sample-accurate sequencer engine
+ *
+ *  Plays a one-shot sample at each beat of a looping sequence. The engine counts time in
+ *  frames, not host time: each render finds the beats that fall within the buffer, then
+ *  renders the sample in whole segments between them, so each beat starts on the exact
+ *  frame it's due, whatever the timing of the render callbacks.
+ *
+ *  Each beat restarts the sample from the beginning, cutting off the previous beat.
+ *
+ *  Sequence length changes take effect at the start of the next render, at the same position
+ *  within the sequence, so changing tempo doesn't skip or repeat beats.
+ */
+typedef struct AESequencerEngine AESequencerEngine;
+
+/*!
+ * Create a sequencer engine
+ *
+ *  The sample audio isn't copied, and must remain valid for the life of the engine.
+ *
+ * @param sample          Sample audio: one non-interleaved float buffer per channel
+ * @param sampleChannels  Number of channels in the sample
+ * @param sampleFrames    Length of the sample, in frames
+ * @param sequenceFrames  Length of the sequence, in frames
+ * @return The engine, or NULL on allocation failure
+ */
+AESequencerEngine *AESequencerEngineNew(const float * const *sample, uint32_t sampleChannels, uint32_t sampleFrames, double sequenceFrames);
+
+/*!
+ * Free a sequencer engine
+ */
+void AESequencerEngineFree(AESequencerEngine *engine);
+
+/*!
+ * Set the beats to play
+ *
+ *  Use from the render thread, or before rendering begins. The beats aren't copied, and must
+ *  remain valid until replaced. Playback carries on from the current position, with the first
+ *  of the new beats still to come.
+ *
+ * @param engine  The engine
+ * @param beats   Beats, sorted by onset
+ * @param count   Number of beats
+ */
+void AESequencerEngineSetBeats(AESequencerEngine *engine, const AESequencerEngineBeat *beats, uint32_t count);
+
+/*!
+ * Set the length of the sequence
+ *
+ *  Safe to use from any thread. Takes effect at the start of the next render.
+ *
+ * @param engine          The engine
+ * @param sequenceFrames  Length of the sequence, in frames
+ */
+void AESequencerEngineSetSequenceLength(AESequencerEngine *engine, double sequenceFrames);
+
+/*!
+ * Return to the start of the sequence, and silence the sample
+ *
+ *  Use from the render thread, or before rendering begins.
+ */
+void AESequencerEngineReset(AESequencerEngine *engine);
+
+/*!
+ * Render
+ *
+ *  The output should hold silence on entry: the engine only writes those frames where the
+ *  sample sounds. If the output has more channels than the sample, the last sample channel
+ *  is repeated.
+ *
+ * @param engine    The engine
+ * @param output    One float buffer per channel
+ * @param channels  Number of output channels
+ * @param frames    Number of frames
+ * @param audible   Whether to write audio; if false, the sequence advances silently
+ */
+void AESequencerEngineRender(AESequencerEngine *engine, float * const *output, uint32_t channels, uint32_t frames, bool audible);
+
+/*!
+ * Render a span of an externally-timed sequence
+ *
+ *  For use when a shared clock, such as AESequencerClock, keeps the time: the engine's own
+ *  position, sequence length and beats are ignored. Plays the given beats that fall within the
+ *  span, and carries on the sample from earlier spans. Spans from one render to the next should
+ *  follow on from each other, for beats on their boundaries to sound exactly once.
+ *
+ *  The output should hold silence on entry, as for @link AESequencerEngineRender @endlink.
+ *
+ * @param engine          The engine
+ * @param output          One float buffer per channel
+ * @param channels        Number of output channels
+ * @param offset          Frame within the output at which the span starts
+ * @param frames          Length of the span, in frames
+ * @param position        Position within the sequence at the start of the span, in frames
+ * @param sequenceFrames  Length of the sequence, in frames
+ * @param beats           Beats, sorted by onset
+ * @param count           Number of beats
+ * @param audible         Whether to write audio; if false, the sample advances silently
+ */
+void AESequencerEngineRenderSpan(AESequencerEngine *engine, float * const *output, uint32_t channels, uint32_t offset, uint32_t frames,
+                                 double position, double sequenceFrames, const AESequencerEngineBeat *beats, uint32_t count, bool audible);
+
+/*!
+ * Get the playhead position
+ *
+ *  Safe to use from any thread.
+ *
+ * @return Position within the sequence at the start of the last render, from 0 to 1
+ */
+float AESequencerEngineGetPlayheadPosition(const AESequencerEngine *engine);
+
+#ifdef __cplusplus
+}
+#endif
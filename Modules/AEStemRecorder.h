@@ -0,0 +1,217 @@
+//
+//  AEStemRecorder.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#import <Foundation/Foundation.h>
+#import "TheAmazingAudioEngine.h"
+
+extern NSString * const AEStemRecorderDidEncounterErrorNotification;
+extern NSString * const AEStemRecorderErrorKey;
+
+/*!
+ * Maximum number of stems a stem recorder can record
+ */
+#define AEStemRecorderMaximumStems 64
+
+/*!
+ * Stem recorder
+ *
+ *  This class records the output of several channels and channel groups at once,
+ *  each to its own stem. All stems start on the same sample and share one timeline,
+ *  so they line up when imported into another application.
+ *
+ *  Each render, the audio of every stem is gathered into a single record in one
+ *  lock-free ring buffer, and one background thread writes all stems to disk. Stems
+ *  can be written to separate files, or as groups of channels in a single multichannel
+ *  file. Stems which produce no audio in a render cycle, such as stopped channels,
+ *  are recorded as silence.
+ *
+ *  To use, create an instance, add the stems you wish to record, then begin recording.
+ *  Stems can't be added or removed while recording.
+ */
+@interface AEStemRecorder : NSObject <AEAudioReceiver, AEAudioTimingReceiver>
+
+/*!
+ * Initialise
+ *
+ * @param audioController The Audio Controller
+ */
+- (id)initWithAudioController:(AEAudioController*)audioController;
+
+/*!
+ * Add a stem that records a channel's output
+ *
+ * @param channel The channel
+ * @return The index of the new stem, or NSNotFound if there are already
+ *         AEStemRecorderMaximumStems stems, or recording is in progress
+ */
+- (NSUInteger)addStemForChannel:(id<AEAudioPlayable>)channel;
+
+/*!
+ * Add a stem that records a channel group's mixed output
+ *
+ * @param group The channel group
+ * @return The index of the new stem, or NSNotFound if there are already
+ *         AEStemRecorderMaximumStems stems, or recording is in progress
+ */
+- (NSUInteger)addStemForChannelGroup:(AEChannelGroupRef)group;
+
+/*!
+ * Remove all stems
+ *
+ *  Has no effect while recording.
+ */
+- (void)removeAllStems;
+
+/*!
+ * Prepare to record each stem to its own file
+ *
+ *  Start recording with @link AEStemRecorderStartRecording @endlink, or use
+ *  @link beginRecordingToFilesAtPaths:fileType:bitDepth:error: @endlink to start immediately.
+ *
+ * @param paths    The file paths, one per stem, in the order the stems were added
+ * @param fileType The kind of file to create
+ * @param bits     The bit depth, for uncompressed formats
+ * @param error    The error, if not NULL and if an error occurs
+ * @return YES on success, NO on failure
+ */
+- (BOOL)prepareRecordingToFilesAtPaths:(NSArray*)paths fileType:(AudioFileTypeID)fileType bitDepth:(UInt32)bits error:(NSError**)error;
+
+/*!
+ * Prepare and begin recording each stem to its own file
+ *
+ * @param paths    The file paths, one per stem, in the order the stems were added
+ * @param fileType The kind of file to create
+ * @param bits     The bit depth, for uncompressed formats
+ * @param error    The error, if not NULL and if an error occurs
+ * @return YES on success, NO on failure
+ */
+- (BOOL)beginRecordingToFilesAtPaths:(NSArray*)paths fileType:(AudioFileTypeID)fileType bitDepth:(UInt32)bits error:(NSError**)error;
+
+/*!
+ * Prepare to record all stems to one multichannel file
+ *
+ *  Each stem occupies as many consecutive channels of the file as the audio controller's
+ *  audio format has, in the order the stems were added. This requires a non-interleaved
+ *  audio format.
+ *
+ * @param path     The file path
+ * @param fileType The kind of file to create; one which supports many channels, such as kAudioFileCAFType
+ * @param bits     The bit depth, for uncompressed formats
+ * @param error    The error, if not NULL and if an error occurs
+ * @return YES on success, NO on failure
+ */
+- (BOOL)prepareRecordingToMultichannelFileAtPath:(NSString*)path fileType:(AudioFileTypeID)fileType bitDepth:(UInt32)bits error:(NSError**)error;
+
+/*!
+ * Prepare and begin recording all stems to one multichannel file
+ *
+ * @param path     The file path
+ * @param fileType The kind of file to create; one which supports many channels, such as kAudioFileCAFType
+ * @param bits     The bit depth, for uncompressed formats
+ * @param error    The error, if not NULL and if an error occurs
+ * @return YES on success, NO on failure
+ */
+- (BOOL)beginRecordingToMultichannelFileAtPath:(NSString*)path fileType:(AudioFileTypeID)fileType bitDepth:(UInt32)bits error:(NSError**)error;
+
+/*!
+ * Start recording
+ *
+ *  Recording of all stems begins with the next render cycle.
+ *
+ *  This is thread-safe and can be used from the audio thread.
+ *
+ * @param recorder The recorder
+ */
+void AEStemRecorderStartRecording(__unsafe_unretained AEStemRecorder* recorder);
+
+/*!
+ * Stop recording
+ *
+ *  Stops recording further audio, without closing the files. Call
+ *  @link AEStemRecorderStartRecording @endlink to continue recording.
+ *
+ *  This is thread-safe and can be used from the audio thread.
+ *
+ * @param recorder The recorder
+ */
+void AEStemRecorderStopRecording(__unsafe_unretained AEStemRecorder* recorder);
+
+/*!
+ * Finish recording and close the files
+ */
+- (void)finishRecording;
+
+/*!
+ * Number of stems
+ */
+@property (nonatomic, readonly) NSUInteger stemCount;
+
+/*!
+ * Duration of audio that can be buffered awaiting the writer thread, in seconds
+ *
+ *  Takes effect from the next time recording is prepared. Default is 4 seconds.
+ */
+@property (nonatomic, assign) NSTimeInterval bufferDuration;
+
+/*!
+ * Current recorded time in seconds
+ */
+@property (nonatomic, readonly) double currentTime;
+
+/*!
+ * The timestamp of the first recorded frame, shared by all stems
+ *
+ *  Valid once recording has started.
+ */
+@property (nonatomic, readonly) AudioTimeStamp startTime;
+
+/*!
+ * Current state of the recorder
+ */
+@property (nonatomic, readonly) BOOL recording;
+
+/*!
+ * Number of render cycles dropped because the buffer was full
+ */
+@property (nonatomic, readonly) NSUInteger overflowCount;
+
+/*!
+ * The first error that occurred while writing to disk, if any
+ *
+ *  When a write fails, this is set and AEStemRecorderDidEncounterErrorNotification is posted,
+ *  with the error under AEStemRecorderErrorKey, on the main thread. Recording carries on,
+ *  but audio may be missing from the files. Cleared when recording is next prepared.
+ */
+@property (nonatomic, strong, readonly) NSError *error;
+
+@end
+
+#ifdef __cplusplus
+}
+#endif
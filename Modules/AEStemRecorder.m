@@ -0,0 +1,464 @@
+//
+//  AEStemRecorder.m
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#import "AEStemRecorder.h"
+#import "AEAudioFileWriter.h"
+#import "TPCircularBuffer.h"
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
+
+NSString * const AEStemRecorderDidEncounterErrorNotification = @"AEStemRecorderDidEncounterErrorNotification";
+NSString * const AEStemRecorderErrorKey = @"error";
+
+static const NSTimeInterval kDefaultBufferDuration = 4.0;
+static const NSTimeInterval kWriterPollInterval    = 0.02;
+static const UInt32 kMinimumFramesPerCycle         = 64;
+static const size_t kRecordAlignment               = 8;
+
+/*!
+ * One render cycle of audio for all stems
+ *
+ *  Followed by the audio of each stem in turn: for each stem, each of its buffers. The
+ *  length is padded to kRecordAlignment, so the next record's header is aligned too.
+ */
+typedef struct {
+    AudioTimeStamp  time;
+    UInt32          frames;
+    int32_t         length;
+} stem_record_t;
+
+@interface AEStemRecorderWriterThread : NSThread
+- (id)initWithRecorder:(AEStemRecorder*)recorder;
+@end
+
+@interface AEStemRecorder () {
+    AudioStreamBasicDescription   _audioDescription;
+    int                           _buffersPerStem;
+    void                         *_stemSources[AEStemRecorderMaximumStems];
+    int                           _stemCount;
+    NSMutableArray               *_stems;
+
+    TPCircularBuffer              _buffer;
+    BOOL                          _prepared;
+    NSArray                      *_writers;
+    __unsafe_unretained AEAudioFileWriter *_writerPointers[AEStemRecorderMaximumStems];
+    BOOL                          _multichannel;
+    AudioBufferList              *_writeBufferList;
+    AEStemRecorderWriterThread   *_writerThread;
+
+    stem_record_t                *_pendingRecord;
+    uint64_t                      _pendingStems;
+    BOOL                          _started;
+    volatile int32_t              _overflowCount;
+    OSStatus                      _writeStatus;
+}
+@property (nonatomic, weak) AEAudioController *audioController;
+@property (nonatomic, strong, readwrite) NSError *error;
+@end
+
+@implementation AEStemRecorder
+@synthesize currentTime = _currentTime, recording = _recording, startTime = _startTime;
+
+- (id)initWithAudioController:(AEAudioController*)audioController {
+    if ( !(self = [super init]) ) return nil;
+    self.audioController = audioController;
+    _audioDescription = audioController.audioDescription;
+    _buffersPerStem = (_audioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? _audioDescription.mChannelsPerFrame : 1;
+    _stems = [NSMutableArray array];
+    _bufferDuration = kDefaultBufferDuration;
+    return self;
+}
+
+-(void)dealloc {
+    if ( _prepared ) {
+        [self finishRecording];
+    }
+}
+
+#pragma mark - Stems
+
+- (NSUInteger)addStemForChannel:(id<AEAudioPlayable>)channel {
+    if ( _prepared || _stemCount == AEStemRecorderMaximumStems ) return NSNotFound;
+    [_stems addObject:channel];
+    _stemSources[_stemCount] = (__bridge void*)channel;
+    return _stemCount++;
+}
+
+- (NSUInteger)addStemForChannelGroup:(AEChannelGroupRef)group {
+    if ( _prepared || _stemCount == AEStemRecorderMaximumStems ) return NSNotFound;
+    [_stems addObject:[NSValue valueWithPointer:group]];
+    _stemSources[_stemCount] = group;
+    return _stemCount++;
+}
+
+- (void)removeAllStems {
+    if ( _prepared ) return;
+    [_stems removeAllObjects];
+    memset(_stemSources, 0, sizeof(_stemSources));
+    _stemCount = 0;
+}
+
+-(NSUInteger)stemCount {
+    return _stemCount;
+}
+
+-(NSUInteger)overflowCount {
+    return _overflowCount;
+}
+
+#pragma mark - Recording
+
+- (BOOL)beginRecordingToFilesAtPaths:(NSArray*)paths fileType:(AudioFileTypeID)fileType bitDepth:(UInt32)bits error:(NSError**)error {
+    BOOL result = [self prepareRecordingToFilesAtPaths:paths fileType:fileType bitDepth:bits error:error];
+    if ( result ) _recording = YES;
+    return result;
+}
+
+- (BOOL)beginRecordingToMultichannelFileAtPath:(NSString*)path fileType:(AudioFileTypeID)fileType bitDepth:(UInt32)bits error:(NSError**)error {
+    BOOL result = [self prepareRecordingToMultichannelFileAtPath:path fileType:fileType bitDepth:bits error:error];
+    if ( result ) _recording = YES;
+    return result;
+}
+
+- (BOOL)prepareRecordingToFilesAtPaths:(NSArray*)paths fileType:(AudioFileTypeID)fileType bitDepth:(UInt32)bits error:(NSError**)error {
+    if ( _prepared || _stemCount == 0 || paths.count != _stemCount ) {
+        if ( error ) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL
+                                              userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"A file path is needed for each stem", @"")}];
+        return NO;
+    }
+
+    NSMutableArray *writers = [NSMutableArray array];
+    for ( NSString *path in paths ) {
+        AEAudioFileWriter *writer = [[AEAudioFileWriter alloc] initWithAudioDescription:_audioDescription];
+        writer.bufferDuration = 0; // We do our own buffering
+        if ( ![writer beginWritingToFileAtPath:path fileType:fileType bitDepth:bits error:error] ) {
+            for ( AEAudioFileWriter *writer in writers ) {
+                [writer finishWriting];
+            }
+            return NO;
+        }
+        [writers addObject:writer];
+    }
+
+    return [self prepareWithWriters:writers multichannel:NO error:error];
+}
+
+- (BOOL)prepareRecordingToMultichannelFileAtPath:(NSString*)path fileType:(AudioFileTypeID)fileType bitDepth:(UInt32)bits error:(NSError**)error {
+    if ( _prepared || _stemCount == 0 ) {
+        if ( error ) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL
+                                              userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"No stems to record", @"")}];
+        return NO;
+    }
+
+    if ( !(_audioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ) {
+        if ( error ) *error = [NSError errorWithDomain:AEAudioFileWriterErrorDomain code:kAEAudioFileWriterFormatError
+                                              userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"Multichannel stem files require a non-interleaved audio format", @"")}];
+        return NO;
+    }
+
+    // Each stem provides its own set of channels of the file
+    AudioStreamBasicDescription fileClientFormat = _audioDescription;
+    fileClientFormat.mChannelsPerFrame = _audioDescription.mChannelsPerFrame * _stemCount;
+
+    AEAudioFileWriter *writer = [[AEAudioFileWriter alloc] initWithAudioDescription:fileClientFormat];
+    writer.bufferDuration = 0;
+    if ( ![writer beginWritingToFileAtPath:path fileType:fileType bitDepth:bits error:error] ) {
+        return NO;
+    }
+
+    return [self prepareWithWriters:@[writer] multichannel:YES error:error];
+}
+
+- (BOOL)prepareWithWriters:(NSArray*)writers multichannel:(BOOL)multichannel error:(NSError**)error {
+    // Size the ring buffer for the audio of every stem, plus a header per render cycle
+    UInt32 bytesPerCycleFrame = _audioDescription.mBytesPerFrame * _buffersPerStem * _stemCount;
+    UInt32 bufferFrames = _bufferDuration * _audioDescription.mSampleRate;
+    size_t bufferBytes = (size_t)bufferFrames * bytesPerCycleFrame
+                            + (bufferFrames / kMinimumFramesPerCycle + 1) * (sizeof(stem_record_t) + kRecordAlignment);
+
+    if ( !TPCircularBufferInit(&_buffer, (int32_t)bufferBytes) ) {
+        for ( AEAudioFileWriter *writer in writers ) {
+            [writer finishWriting];
+        }
+        if ( error ) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM
+                                              userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"Not enough memory to buffer the recording", @"")}];
+        return NO;
+    }
+
+    int numberOfBuffers = _buffersPerStem * _stemCount;
+    _writeBufferList = malloc(sizeof(AudioBufferList) + (numberOfBuffers-1) * sizeof(AudioBuffer));
+
+    _writers = writers;
+    for ( int i=0; i<writers.count; i++ ) {
+        _writerPointers[i] = writers[i];
+    }
+    _multichannel = multichannel;
+    _pendingRecord = NULL;
+    _started = NO;
+    _currentTime = 0.0;
+    _overflowCount = 0;
+    _writeStatus = noErr;
+    self.error = nil;
+    _prepared = YES;
+
+    _writerThread = [[AEStemRecorderWriterThread alloc] initWithRecorder:self];
+    [_writerThread start];
+
+    // Tap each stem, and the start of each render cycle
+    AEAudioController *audioController = _audioController;
+    [audioController addTimingReceiver:self completionBlock:nil];
+    for ( id stem in _stems ) {
+        if ( [stem isKindOfClass:[NSValue class]] ) {
+            [audioController addOutputReceiver:self forChannelGroup:[stem pointerValue] completionBlock:nil];
+        } else {
+            [audioController addOutputReceiver:self forChannel:stem completionBlock:nil];
+        }
+    }
+
+    return YES;
+}
+
+void AEStemRecorderStartRecording(__unsafe_unretained AEStemRecorder* THIS) {
+    if ( THIS->_prepared ) {
+        THIS->_recording = YES;
+    }
+}
+
+void AEStemRecorderStopRecording(__unsafe_unretained AEStemRecorder* THIS) {
+    THIS->_recording = NO;
+}
+
+- (void)finishRecording {
+    if ( !_prepared ) return;
+
+    // Stop recording, and queue the audio of the current render cycle
+    AEAudioController *audioController = _audioController;
+    if ( !audioController || ![audioController performSynchronousMessageExchangeWithBlock:^{
+        _recording = NO;
+        commitPendingRecord(self);
+    }] ) {
+        _recording = NO;
+        commitPendingRecord(self);
+    }
+
+    [audioController removeTimingReceiver:self completionBlock:nil];
+    for ( id stem in _stems ) {
+        if ( [stem isKindOfClass:[NSValue class]] ) {
+            [audioController removeOutputReceiver:self fromChannelGroup:[stem pointerValue] completionBlock:nil];
+        } else {
+            [audioController removeOutputReceiver:self fromChannel:stem completionBlock:nil];
+        }
+    }
+
+    [_writerThread cancel];
+    while ( [_writerThread isExecuting] ) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    _writerThread = nil;
+
+    // Write out whatever remains, and close the files
+    writePendingRecords(self);
+    for ( AEAudioFileWriter *writer in _writers ) {
+        [writer finishWriting];
+    }
+    _writers = nil;
+    memset(_writerPointers, 0, sizeof(_writerPointers));
+
+    _prepared = NO;
+    TPCircularBufferCleanup(&_buffer);
+    free(_writeBufferList);
+    _writeBufferList = NULL;
+}
+
+#pragma mark - Realtime
+
+static void commitPendingRecord(__unsafe_unretained AEStemRecorder *THIS) {
+    stem_record_t *record = THIS->_pendingRecord;
+    if ( !record ) return;
+    THIS->_pendingRecord = NULL;
+
+    // Silence any stems that didn't render this cycle
+    size_t bytesPerStem = (size_t)record->frames * THIS->_audioDescription.mBytesPerFrame * THIS->_buffersPerStem;
+    for ( int i=0; i<THIS->_stemCount; i++ ) {
+        if ( !(THIS->_pendingStems & (1ULL << i)) ) {
+            memset((char*)(record+1) + i*bytesPerStem, 0, bytesPerStem);
+        }
+    }
+
+    TPCircularBufferProduce(&THIS->_buffer, record->length);
+    THIS->_currentTime += (double)record->frames / THIS->_audioDescription.mSampleRate;
+}
+
+static void timingCallback(__unsafe_unretained AEStemRecorder *THIS,
+                           __unsafe_unretained AEAudioController *audioController,
+                           const AudioTimeStamp *time,
+                           UInt32 frames,
+                           AEAudioTimingContext context) {
+    if ( context != AEAudioTimingContextOutput ) return;
+
+    // The previous render cycle is complete
+    commitPendingRecord(THIS);
+
+    if ( !THIS->_recording ) return;
+
+    // Reserve space for this cycle's audio, to be filled in by each stem's receiver callback
+    size_t audioBytes = (size_t)frames * THIS->_audioDescription.mBytesPerFrame * THIS->_buffersPerStem * THIS->_stemCount;
+    int32_t length = (int32_t)((sizeof(stem_record_t) + audioBytes + kRecordAlignment-1) & ~(kRecordAlignment-1));
+    int32_t availableBytes;
+    stem_record_t *record = TPCircularBufferHead(&THIS->_buffer, &availableBytes);
+    if ( !record || availableBytes < length ) {
+        // Writer thread isn't keeping up: drop this cycle
+        OSAtomicIncrement32(&THIS->_overflowCount);
+        return;
+    }
+
+    record->time = *time;
+    record->frames = frames;
+    record->length = length;
+    THIS->_pendingStems = 0;
+    THIS->_pendingRecord = record;
+
+    if ( !THIS->_started ) {
+        THIS->_startTime = *time;
+        THIS->_started = YES;
+    }
+}
+
+-(AEAudioTimingCallback)timingReceiverCallback {
+    return timingCallback;
+}
+
+static void receiverCallback(__unsafe_unretained AEStemRecorder *THIS,
+                             __unsafe_unretained AEAudioController *audioController,
+                             void                     *source,
+                             const AudioTimeStamp     *time,
+                             UInt32                    frames,
+                             AudioBufferList          *audio) {
+    stem_record_t *record = THIS->_pendingRecord;
+    if ( !record || frames != record->frames ) return;
+
+    for ( int i=0; i<THIS->_stemCount; i++ ) {
+        if ( THIS->_stemSources[i] != source ) continue;
+
+        size_t bytesPerBuffer = (size_t)frames * THIS->_audioDescription.mBytesPerFrame;
+        char *stemAudio = (char*)(record+1) + i * bytesPerBuffer * THIS->_buffersPerStem;
+        for ( int j=0; j<THIS->_buffersPerStem; j++ ) {
+            if ( j < audio->mNumberBuffers ) {
+                memcpy(stemAudio + j*bytesPerBuffer, audio->mBuffers[j].mData, bytesPerBuffer);
+            } else {
+                memset(stemAudio + j*bytesPerBuffer, 0, bytesPerBuffer);
+            }
+        }
+        THIS->_pendingStems |= (1ULL << i);
+        break;
+    }
+}
+
+-(AEAudioReceiverCallback)receiverCallback {
+    return receiverCallback;
+}
+
+#pragma mark - Writing
+
+static void reportWriteError(__unsafe_unretained AEStemRecorder *THIS, OSStatus status) {
+    int fourCC = CFSwapInt32HostToBig(status);
+    NSError *error = [NSError errorWithDomain:NSOSStatusErrorDomain code:status
+                                     userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:NSLocalizedString(@"Couldn't write the stems (error %d/%4.4s)", @""), status, (char*)&fourCC]}];
+    __weak AEStemRecorder *weakSelf = THIS;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        AEStemRecorder *recorder = weakSelf;
+        if ( !recorder ) return;
+        recorder.error = error;
+        [[NSNotificationCenter defaultCenter] postNotificationName:AEStemRecorderDidEncounterErrorNotification
+                                                            object:recorder
+                                                          userInfo:@{AEStemRecorderErrorKey: error}];
+    });
+}
+
+static void writePendingRecords(__unsafe_unretained AEStemRecorder *THIS) {
+    int32_t availableBytes;
+    stem_record_t *record;
+    while ( (record = TPCircularBufferTail(&THIS->_buffer, &availableBytes)) ) {
+        size_t bytesPerBuffer = (size_t)record->frames * THIS->_audioDescription.mBytesPerFrame;
+        int numberOfBuffers = THIS->_buffersPerStem * THIS->_stemCount;
+        char *audio = (char*)(record+1);
+
+        THIS->_writeBufferList->mNumberBuffers = numberOfBuffers;
+        for ( int i=0; i<numberOfBuffers; i++ ) {
+            THIS->_writeBufferList->mBuffers[i].mNumberChannels = THIS->_buffersPerStem > 1 ? 1 : THIS->_audioDescription.mChannelsPerFrame;
+            THIS->_writeBufferList->mBuffers[i].mData = audio + i*bytesPerBuffer;
+            THIS->_writeBufferList->mBuffers[i].mDataByteSize = (UInt32)bytesPerBuffer;
+        }
+
+        OSStatus status = noErr;
+        if ( THIS->_multichannel ) {
+            // All stems at once, as consecutive channels of the one file
+            status = AEAudioFileWriterAddAudioSynchronously(THIS->_writerPointers[0], THIS->_writeBufferList, record->frames);
+        } else {
+            // Each stem to its own file
+            char stemBufferListBytes[sizeof(AudioBufferList) + (THIS->_buffersPerStem-1)*sizeof(AudioBuffer)];
+            AudioBufferList *stemBufferList = (AudioBufferList*)stemBufferListBytes;
+            stemBufferList->mNumberBuffers = THIS->_buffersPerStem;
+            for ( int i=0; i<THIS->_stemCount && status == noErr; i++ ) {
+                memcpy(stemBufferList->mBuffers, &THIS->_writeBufferList->mBuffers[i*THIS->_buffersPerStem], THIS->_buffersPerStem*sizeof(AudioBuffer));
+                status = AEAudioFileWriterAddAudioSynchronously(THIS->_writerPointers[i], stemBufferList, record->frames);
+            }
+        }
+
+        if ( status != noErr && THIS->_writeStatus == noErr ) {
+            AECheckOSStatus(status, "AEAudioFileWriterAddAudioSynchronously");
+            THIS->_writeStatus = status;
+            reportWriteError(THIS, status);
+        }
+
+        TPCircularBufferConsume(&THIS->_buffer, record->length);
+    }
+}
+
+@end
+
+@implementation AEStemRecorderWriterThread {
+    __unsafe_unretained AEStemRecorder *_recorder;
+}
+
+- (id)initWithRecorder:(AEStemRecorder *)recorder {
+    if ( !(self = [super init]) ) return nil;
+    _recorder = recorder;
+    self.qualityOfService = NSQualityOfServiceUtility;
+    return self;
+}
+
+- (void)main {
+    @autoreleasepool {
+        pthread_setname_np("com.theamazingaudioengine.AEStemRecorderWriterThread");
+        while ( !self.isCancelled ) {
+            // The recorder stops this thread before it goes away
+            writePendingRecords(_recorder);
+            usleep(kWriterPollInterval*1.0e6);
+        }
+    }
+}
+
+@end
@@ -0,0 +1,168 @@
+//
+//  AEAudioFileLoaderBenchmark.m
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Cold-start benchmark for AEAudioFileLoaderOperation: loads a library of 500 AAC files
+//  one at a time, on an operation queue, and with the batch API, which shares one pool of
+//  workers between all of the files' segments. macOS only.
+//
+//  For cold-cache figures, run as root: the disk cache is purged before each pass.
+//  Otherwise the figures are for a warm cache.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+#import "AEAudioFileLoaderOperation.h"
+#import "AEUtilities.h"
+#include "TestSupport.h"
+#include <unistd.h>
+
+static const int kFileCount = 500;
+static const double kSampleRate = 44100.0;
+static const int kLongFileInterval = 25;          // Every 25th file is long
+static const double kShortFileDuration = 4.0;
+static const double kLongFileDuration = 90.0;
+
+static AudioStreamBasicDescription targetAudioDescription(void) {
+    return AEAudioStreamBasicDescriptionNonInterleavedFloatStereo;
+}
+
+static void writeFile(NSURL *url, double duration, int seed) {
+    AudioStreamBasicDescription fileDescription = {
+        .mFormatID = kAudioFormatMPEG4AAC,
+        .mSampleRate = kSampleRate,
+        .mChannelsPerFrame = 2,
+    };
+    ExtAudioFileRef file;
+    OSStatus status = ExtAudioFileCreateWithURL((__bridge CFURLRef)url, kAudioFileM4AType, &fileDescription, NULL,
+                                                kAudioFileFlags_EraseFile, &file);
+    TEST_ASSERT_MESSAGE(status == noErr, "ExtAudioFileCreateWithURL: %d", (int)status);
+    AudioStreamBasicDescription clientDescription = targetAudioDescription();
+    status = ExtAudioFileSetProperty(file, kExtAudioFileProperty_ClientDataFormat, sizeof(clientDescription), &clientDescription);
+    TEST_ASSERT(status == noErr);
+    
+    const UInt32 blockFrames = 4096;
+    AudioBufferList *bufferList = AEAudioBufferListCreate(clientDescription, blockFrames);
+    double phase = 0, increment = (220.0 + 10.0 * (seed % 40)) / kSampleRate;
+    for ( UInt64 frame = 0, length = duration * kSampleRate; frame < length; frame += blockFrames ) {
+        UInt32 frames = (UInt32)MIN(blockFrames, length - frame);
+        for ( UInt32 i=0; i<frames; i++ ) {
+            float value = 0.5 * sin(2.0 * M_PI * phase);
+            ((float*)bufferList->mBuffers[0].mData)[i] = value;
+            ((float*)bufferList->mBuffers[1].mData)[i] = -value;
+            phase = fmod(phase + increment, 1.0);
+        }
+        AEAudioBufferListSetLength(bufferList, clientDescription, frames);
+        status = ExtAudioFileWrite(file, frames, bufferList);
+        TEST_ASSERT_MESSAGE(status == noErr, "ExtAudioFileWrite: %d", (int)status);
+    }
+    AEAudioBufferListFree(bufferList);
+    ExtAudioFileDispose(file);
+}
+
+static NSArray *prepareFiles(void) {
+    NSURL *directory = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"AEAudioFileLoaderBenchmark"]];
+    [[NSFileManager defaultManager] createDirectoryAtURL:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    
+    NSMutableArray *urls = [NSMutableArray arrayWithCapacity:kFileCount];
+    for ( int i=0; i<kFileCount; i++ ) {
+        NSURL *url = [directory URLByAppendingPathComponent:[NSString stringWithFormat:@"%03d.m4a", i]];
+        if ( ![[NSFileManager defaultManager] fileExistsAtPath:url.path] ) {
+            writeFile(url, i % kLongFileInterval == 0 ? kLongFileDuration : kShortFileDuration, i);
+        }
+        [urls addObject:url];
+    }
+    return urls;
+}
+
+static BOOL purgeDiskCache(void) {
+    return geteuid() == 0 && system("/usr/sbin/purge") == 0;
+}
+
+static UInt64 checkLoaded(NSArray *operations) {
+    UInt64 totalFrames = 0;
+    for ( AEAudioFileLoaderOperation *operation in operations ) {
+        TEST_ASSERT_MESSAGE(!operation.error && operation.bufferList, "%s", operation.error.localizedDescription.UTF8String);
+        totalFrames += operation.lengthInFrames;
+        AEAudioBufferListFree(operation.bufferList);
+    }
+    return totalFrames;
+}
+
+static NSArray *loadSerially(NSArray *urls) {
+    NSMutableArray *operations = [NSMutableArray arrayWithCapacity:urls.count];
+    for ( NSURL *url in urls ) {
+        AEAudioFileLoaderOperation *operation = [[AEAudioFileLoaderOperation alloc] initWithFileURL:url targetAudioDescription:targetAudioDescription()];
+        [operation start];
+        [operations addObject:operation];
+    }
+    return operations;
+}
+
+static NSArray *loadOnQueue(NSArray *urls) {
+    NSOperationQueue *queue = [[NSOperationQueue alloc] init];
+    queue.maxConcurrentOperationCount = [[NSProcessInfo processInfo] activeProcessorCount];
+    NSMutableArray *operations = [NSMutableArray arrayWithCapacity:urls.count];
+    for ( NSURL *url in urls ) {
+        [operations addObject:[[AEAudioFileLoaderOperation alloc] initWithFileURL:url targetAudioDescription:targetAudioDescription()]];
+    }
+    [queue addOperations:operations waitUntilFinished:YES];
+    return operations;
+}
+
+static NSArray *loadBatch(NSArray *urls) {
+    __block NSArray *result = nil;
+    [AEAudioFileLoaderOperation beginLoadingFilesAtURLs:urls targetAudioDescription:targetAudioDescription() completionBlock:^(NSArray *operations) {
+        result = operations;
+        CFRunLoopStop(CFRunLoopGetMain());
+    }];
+    while ( !result ) CFRunLoopRun();
+    return result;
+}
+
+static void benchmark(const char *name, NSArray *urls, NSArray *(*load)(NSArray *urls)) {
+    BOOL cold = purgeDiskCache();
+    double start = TestCurrentTime();
+    NSArray *operations;
+    @autoreleasepool {
+        operations = load(urls);
+    }
+    double elapsed = TestCurrentTime() - start;
+    UInt64 totalFrames = checkLoaded(operations);
+    printf("  %-34s %7.2f s (%s cache, %.0fx real time)\n", name, elapsed, cold ? "cold" : "warm",
+           (totalFrames / kSampleRate) / elapsed);
+}
+
+int main(int argc, char *argv[]) {
+    @autoreleasepool {
+        NSArray *urls = prepareFiles();
+        printf("%d files, %d cores\n", kFileCount, (int)[[NSProcessInfo processInfo] activeProcessorCount]);
+        if ( geteuid() != 0 ) printf("Not running as root: can't purge the disk cache, so timings are warm\n");
+        
+        benchmark("One at a time", urls, loadSerially);
+        benchmark("Operation queue, whole files", urls, loadOnQueue);
+        benchmark("Batch API, shared segment pool", urls, loadBatch);
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,231 @@
+//
+//  AEAudioFileWriterBufferTests.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Tests AEAudioFileWriterBuffer: ordering across the ring's wrap point, overflow accounting,
+//  and, against a deliberately throttled and stalling disk, that adding audio on the
+//  producer thread never waits for the disk.
+//
+
+#include "AEAudioFileWriterBuffer.h"
+#include "TestSupport.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+static const double   kSampleRate      = 48000.0;
+static const uint32_t kChannels        = 2;
+static const uint32_t kBlockFrames     = 256;
+static const uint32_t kChunkFrames     = 4096;
+static const double   kSpeed           = 2.0;        // Times real time to produce audio at
+static const double   kDiskBytesPerSecond = 4.0e6;
+static const double   kStallInterval   = 0.5;        // Seconds of writing between disk stalls
+static const double   kStallDuration   = 0.25;
+static const useconds_t kWriterPollInterval = 10000;
+
+// Frames are a 32-bit frame index in the left buffer, and its complement in the right
+typedef struct {
+    uint32_t    expected;
+    uint64_t    framesWritten;
+    uint64_t    gapFrames;
+    uint32_t    writes;
+    int         fd;
+    bool        throttle;
+    double      bytesAllowedAt;
+    double      nextStall;
+} disk_t;
+
+static int diskWrite(void *context, void * const *buffers, uint32_t frames) {
+    disk_t *disk = (disk_t*)context;
+    const uint32_t *left = (const uint32_t*)buffers[0];
+    const uint32_t *right = (const uint32_t*)buffers[1];
+    for ( uint32_t i=0; i<frames; i++ ) {
+        TEST_ASSERT(right[i] == ~left[i]);
+        TEST_ASSERT_MESSAGE(left[i] >= disk->expected, "frame %u arrived after %u", left[i], disk->expected - 1);
+        disk->gapFrames += left[i] - disk->expected;
+        disk->expected = left[i] + 1;
+    }
+    disk->framesWritten += frames;
+    disk->writes++;
+
+    if ( disk->fd >= 0 ) {
+        for ( uint32_t i=0; i<kChannels; i++ ) {
+            TEST_ASSERT(write(disk->fd, buffers[i], frames * sizeof(uint32_t)) == (ssize_t)(frames * sizeof(uint32_t)));
+        }
+    }
+
+    if ( disk->throttle ) {
+        // Limit throughput, and stall every so often, as a busy disk would
+        double now = TestCurrentTime();
+        if ( disk->bytesAllowedAt < now ) disk->bytesAllowedAt = now;
+        disk->bytesAllowedAt += (frames * kChannels * sizeof(uint32_t)) / kDiskBytesPerSecond;
+        if ( disk->nextStall == 0 ) disk->nextStall = now + kStallInterval;
+        if ( now >= disk->nextStall ) {
+            disk->bytesAllowedAt += kStallDuration;
+            disk->nextStall = now + kStallDuration + kStallInterval;
+        }
+        usleep((useconds_t)((disk->bytesAllowedAt - now) * 1.0e6));
+    }
+    return 0;
+}
+
+static void makeBlock(uint32_t *left, uint32_t *right, uint32_t start, uint32_t frames) {
+    for ( uint32_t i=0; i<frames; i++ ) {
+        left[i] = start + i;
+        right[i] = ~(start + i);
+    }
+}
+
+static void testOrdering(void) {
+    disk_t disk = { .fd = -1 };
+    // A capacity that's not a multiple of the block size, so blocks straddle the wrap point
+    AEAudioFileWriterBuffer *buffer = AEAudioFileWriterBufferNew(kChannels, sizeof(uint32_t), 1000, 300, diskWrite, &disk);
+    TEST_ASSERT(buffer != NULL);
+
+    uint32_t left[kBlockFrames], right[kBlockFrames];
+    const void *buffers[2] = { left, right };
+    uint32_t frame = 0;
+    for ( int block=0; block<100; block++ ) {
+        uint32_t frames = 1 + (block * 37) % kBlockFrames;
+        makeBlock(left, right, frame, frames);
+        TEST_ASSERT(AEAudioFileWriterBufferAdd(buffer, buffers, frames) == 0);
+        frame += frames;
+        AEAudioFileWriterBufferDrain(buffer, false);
+        TEST_ASSERT(frame - disk.framesWritten < 300);
+    }
+    AEAudioFileWriterBufferDrain(buffer, true);
+
+    TEST_ASSERT(disk.framesWritten == frame);
+    TEST_ASSERT(disk.gapFrames == 0);
+    TEST_ASSERT(AEAudioFileWriterBufferGetOverflowCount(buffer) == 0);
+    TEST_ASSERT(AEAudioFileWriterBufferGetHighWaterMark(buffer) < 300 + kBlockFrames);
+    AEAudioFileWriterBufferFree(buffer);
+}
+
+static void testOverflow(void) {
+    disk_t disk = { .fd = -1 };
+    AEAudioFileWriterBuffer *buffer = AEAudioFileWriterBufferNew(kChannels, sizeof(uint32_t), 600, 256, diskWrite, &disk);
+    TEST_ASSERT(buffer != NULL);
+
+    uint32_t left[kBlockFrames], right[kBlockFrames];
+    const void *buffers[2] = { left, right };
+    makeBlock(left, right, 0, 256);
+    TEST_ASSERT(AEAudioFileWriterBufferAdd(buffer, buffers, 256) == 0);
+    makeBlock(left, right, 256, 256);
+    TEST_ASSERT(AEAudioFileWriterBufferAdd(buffer, buffers, 256) == 0);
+    makeBlock(left, right, 512, 256);
+    TEST_ASSERT(AEAudioFileWriterBufferAdd(buffer, buffers, 256) == ENOBUFS);
+    TEST_ASSERT(AEAudioFileWriterBufferGetOverflowCount(buffer) == 1);
+    TEST_ASSERT(AEAudioFileWriterBufferGetOverflowFrameCount(buffer) == 256);
+    TEST_ASSERT(AEAudioFileWriterBufferGetHighWaterMark(buffer) == 512);
+
+    // Once drained, there's room again, and the dropped audio shows up as a gap
+    AEAudioFileWriterBufferDrain(buffer, false);
+    makeBlock(left, right, 768, 256);
+    TEST_ASSERT(AEAudioFileWriterBufferAdd(buffer, buffers, 256) == 0);
+    AEAudioFileWriterBufferDrain(buffer, true);
+    TEST_ASSERT(disk.framesWritten == 768);
+    TEST_ASSERT(disk.gapFrames == 256);
+    AEAudioFileWriterBufferFree(buffer);
+}
+
+typedef struct {
+    AEAudioFileWriterBuffer *buffer;
+    volatile bool            stop;
+} writer_thread_t;
+
+static void *writerThread(void *context) {
+    writer_thread_t *thread = (writer_thread_t*)context;
+    while ( !thread->stop ) {
+        AEAudioFileWriterBufferDrain(thread->buffer, false);
+        usleep(kWriterPollInterval);
+    }
+    return NULL;
+}
+
+static void testThrottledDisk(double headroom, bool expectOverflow) {
+    char path[] = "/tmp/AEAudioFileWriterBufferTests-XXXXXX";
+    disk_t disk = { .fd = mkstemp(path), .throttle = true };
+    TEST_ASSERT(disk.fd >= 0);
+    unlink(path);
+
+    uint32_t capacity = (uint32_t)(headroom * kSampleRate);
+    AEAudioFileWriterBuffer *buffer = AEAudioFileWriterBufferNew(kChannels, sizeof(uint32_t), capacity, kChunkFrames, diskWrite, &disk);
+    TEST_ASSERT(buffer != NULL);
+
+    writer_thread_t thread = { .buffer = buffer };
+    pthread_t threadId;
+    pthread_create(&threadId, NULL, writerThread, &thread);
+
+    // Produce three seconds of audio, timing each add
+    uint32_t left[kBlockFrames], right[kBlockFrames];
+    const void *buffers[2] = { left, right };
+    const uint32_t totalFrames = (uint32_t)(3.0 * kSampleRate) / kBlockFrames * kBlockFrames;
+    const double blockInterval = kBlockFrames / kSampleRate / kSpeed;
+    double start = TestCurrentTime();
+    double longestAdd = 0;
+    for ( uint32_t frame=0, block=0; frame<totalFrames; frame+=kBlockFrames, block++ ) {
+        makeBlock(left, right, frame, kBlockFrames);
+        double before = TestCurrentTime();
+        AEAudioFileWriterBufferAdd(buffer, buffers, kBlockFrames);
+        double duration = TestCurrentTime() - before;
+        if ( duration > longestAdd ) longestAdd = duration;
+
+        double next = start + (block+1) * blockInterval;
+        double now = TestCurrentTime();
+        if ( next > now ) usleep((useconds_t)((next - now) * 1.0e6));
+    }
+
+    thread.stop = true;
+    pthread_join(threadId, NULL);
+    AEAudioFileWriterBufferDrain(buffer, true);
+    close(disk.fd);
+
+    uint64_t overflowFrames = AEAudioFileWriterBufferGetOverflowFrameCount(buffer);
+    printf("  %.2fs headroom: longest add %.3f ms, %u writes, %llu frames dropped, high water mark %.0f%%\n",
+           headroom, longestAdd * 1000.0, disk.writes, (unsigned long long)overflowFrames,
+           100.0 * AEAudioFileWriterBufferGetHighWaterMark(buffer) / capacity);
+
+    // Adding audio must never have waited on the disk, which stalls for kStallDuration at a time
+    TEST_ASSERT_MESSAGE(longestAdd < kStallDuration / 10.0, "an add took %.1f ms", longestAdd * 1000.0);
+
+    TEST_ASSERT(disk.framesWritten + overflowFrames == totalFrames);
+    TEST_ASSERT(disk.gapFrames <= overflowFrames);
+    if ( expectOverflow ) {
+        TEST_ASSERT(AEAudioFileWriterBufferGetOverflowCount(buffer) > 0);
+    } else {
+        TEST_ASSERT(overflowFrames == 0);
+    }
+
+    AEAudioFileWriterBufferFree(buffer);
+}
+
+int main(int argc, char *argv[]) {
+    TEST_RUN(testOrdering());
+    TEST_RUN(testOverflow());
+    TEST_RUN(testThrottledDisk(1.0, false));
+    TEST_RUN(testThrottledDisk(0.1, true));
+    return TEST_RESULT();
+}
@@ -0,0 +1,129 @@
+//
+//  AEAudioSampleCacheTests.m
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Tests AEAudioSampleCache: a sample converted to another rate decodes to fewer frames than
+//  the loader allocates for, and must come back from the disk cache, at its decoded length,
+//  without being decoded and written again. macOS only.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+#import "AEAudioSampleCache.h"
+#import "AEAudioBufferManager.h"
+#import "AEUtilities.h"
+#include "TestSupport.h"
+#include <sys/stat.h>
+
+static const double kFileSampleRate   = 44100.0;
+static const double kTargetSampleRate = 48000.0;
+static const UInt32 kFileFrames       = 44101;     // Not a whole number of frames at the target rate
+
+static AudioStreamBasicDescription targetAudioDescription(void) {
+    AudioStreamBasicDescription audioDescription = AEAudioStreamBasicDescriptionNonInterleavedFloatStereo;
+    audioDescription.mSampleRate = kTargetSampleRate;
+    return audioDescription;
+}
+
+static void writeFile(NSURL *url) {
+    AudioStreamBasicDescription fileDescription = AEAudioStreamBasicDescriptionInterleaved16BitStereo;
+    fileDescription.mSampleRate = kFileSampleRate;
+    ExtAudioFileRef file;
+    OSStatus status = ExtAudioFileCreateWithURL((__bridge CFURLRef)url, kAudioFileCAFType, &fileDescription, NULL,
+                                                kAudioFileFlags_EraseFile, &file);
+    TEST_ASSERT_MESSAGE(status == noErr, "ExtAudioFileCreateWithURL: %d", (int)status);
+
+    SInt16 *samples = malloc(kFileFrames * 2 * sizeof(SInt16));
+    for ( UInt32 i=0; i<kFileFrames; i++ ) {
+        samples[i*2] = samples[i*2+1] = (SInt16)(8000.0 * sin(2.0 * M_PI * 440.0 * i / kFileSampleRate));
+    }
+    AudioBufferList bufferList = { 1, { { 2, kFileFrames * 2 * sizeof(SInt16), samples } } };
+    status = ExtAudioFileWrite(file, kFileFrames, &bufferList);
+    TEST_ASSERT_MESSAGE(status == noErr, "ExtAudioFileWrite: %d", (int)status);
+    ExtAudioFileDispose(file);
+    free(samples);
+}
+
+static NSURL *diskCacheFile(NSURL *directory) {
+    for ( NSURL *url in [[NSFileManager defaultManager] contentsOfDirectoryAtURL:directory includingPropertiesForKeys:nil options:0 error:NULL] ) {
+        if ( [url.pathExtension isEqualToString:@"pcm"] ) return url;
+    }
+    return nil;
+}
+
+static void testResampledRoundTrip(void) {
+    NSURL *directory = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"AEAudioSampleCacheTests"]];
+    [[NSFileManager defaultManager] removeItemAtURL:directory error:NULL];
+    [[NSFileManager defaultManager] createDirectoryAtURL:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    NSURL *url = [directory URLByAppendingPathComponent:@"sample.caf"];
+    writeFile(url);
+
+    AEAudioSampleCache *cache = [[AEAudioSampleCache alloc] init];
+    cache.diskCacheURL = [directory URLByAppendingPathComponent:@"Cache"];
+    AudioStreamBasicDescription audioDescription = targetAudioDescription();
+
+    // Decode, saving to the disk cache
+    UInt32 decodedLength = 0;
+    NSError *error = nil;
+    AEAudioBufferManager *decoded = [cache audioBufferForFileAtURL:url audioDescription:audioDescription lengthInFrames:&decodedLength error:&error];
+    TEST_ASSERT_MESSAGE(decoded != nil, "%s", error.localizedDescription.UTF8String);
+    const AudioBufferList *decodedBuffer = AEAudioBufferManagerGetBuffer(decoded);
+    TEST_ASSERT(decodedLength > 0 && decodedLength <= ceil(kFileFrames * kTargetSampleRate / kFileSampleRate));
+    TEST_ASSERT_MESSAGE(AEAudioBufferListGetLength(decodedBuffer, audioDescription, NULL) == decodedLength,
+                        "buffer holds %u frames, but %u were decoded",
+                        (unsigned int)AEAudioBufferListGetLength(decodedBuffer, audioDescription, NULL), (unsigned int)decodedLength);
+
+    NSURL *cacheFile = diskCacheFile(cache.diskCacheURL);
+    TEST_ASSERT(cacheFile != nil);
+    struct stat saved;
+    TEST_ASSERT(stat(cacheFile.fileSystemRepresentation, &saved) == 0);
+
+    // Load again, from disk this time
+    [cache removeAllObjects];
+    UInt32 loadedLength = 0;
+    AEAudioBufferManager *loaded = [cache audioBufferForFileAtURL:url audioDescription:audioDescription lengthInFrames:&loadedLength error:&error];
+    TEST_ASSERT_MESSAGE(loaded != nil, "%s", error.localizedDescription.UTF8String);
+    TEST_ASSERT(loaded != decoded);
+    TEST_ASSERT(loadedLength == decodedLength);
+    const AudioBufferList *loadedBuffer = AEAudioBufferManagerGetBuffer(loaded);
+    TEST_ASSERT(loadedBuffer->mNumberBuffers == decodedBuffer->mNumberBuffers);
+    for ( int i=0; i<loadedBuffer->mNumberBuffers; i++ ) {
+        TEST_ASSERT(loadedBuffer->mBuffers[i].mDataByteSize == decodedBuffer->mBuffers[i].mDataByteSize);
+        TEST_ASSERT(memcmp(loadedBuffer->mBuffers[i].mData, decodedBuffer->mBuffers[i].mData, decodedBuffer->mBuffers[i].mDataByteSize) == 0);
+    }
+
+    // A cache hit leaves the file alone; a miss would have decoded again, and replaced it
+    struct stat reloaded;
+    TEST_ASSERT(stat(cacheFile.fileSystemRepresentation, &reloaded) == 0);
+    TEST_ASSERT_MESSAGE(reloaded.st_ino == saved.st_ino, "the disk cache file was rewritten");
+
+    [[NSFileManager defaultManager] removeItemAtURL:directory error:NULL];
+}
+
+int main(int argc, char *argv[]) {
+    @autoreleasepool {
+        TEST_RUN(testResampledRoundTrip());
+    }
+    return TEST_RESULT();
+}
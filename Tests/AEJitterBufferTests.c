@@ -0,0 +1,308 @@
+//
+//  AEJitterBufferTests.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Tests AEJitterBuffer against a simulated network: a local stand-in that sends packets at a
+//  steady rate and delivers them late, out of order or not at all, while a simulated audio
+//  thread plays the buffer out in real time. Also checks the delay estimate, which keeps its
+//  window of transit times sorted as it slides, against a straightforward sort.
+//
+
+#include "AEJitterBuffer.h"
+#include "TestSupport.h"
+#include <math.h>
+
+static const double   kSampleRate       = 48000.0;
+static const uint32_t kPacketFrames     = 240;      // 5 ms
+static const uint32_t kRenderFrames     = 256;
+static const uint32_t kMaxPacketFrames  = 1024;
+static const uint32_t kPacketCapacity   = 128;
+static const double   kBaseLatency      = 0.03;
+static const uint32_t kRampLength       = 4096;     // Audio is a ramp, so the order it plays in can be checked
+static const double   kSettleTime       = 2.0;      // Seconds for the depth to settle, before checking the audio
+static const AEMixerCoreFormat kFormat  = { AEMixerCoreSampleFloat32, 1, false, 0 };
+
+typedef struct {
+    double  sampleTime;
+    double  arrival;
+} packet_t;
+
+typedef struct {
+    uint32_t    packetsSent;
+    uint32_t    packetsLost;
+    uint32_t    framesPlayed;
+    uint32_t    discontinuities;
+    int         lastRampIndex;
+    double      maximumTargetDelay;
+} result_t;
+
+// Network conditions, as a function of time: the delay beyond the base latency for a packet
+typedef double (*delay_function_t)(double time, uint32_t packet);
+
+static uint32_t randomState = 1;
+static double randomFraction(void) {
+    randomState = randomState * 1664525 + 1013904223;
+    return (double)(randomState >> 8) / (double)(1 << 24);
+}
+
+static int compareArrivals(const void *a, const void *b) {
+    double x = ((const packet_t*)a)->arrival, y = ((const packet_t*)b)->arrival;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static void simulate(AEJitterBuffer *buffer, double duration, delay_function_t delay, double lossRate,
+                     void (*observe)(AEJitterBuffer *buffer, double time), result_t *result) {
+    memset(result, 0, sizeof(result_t));
+    result->lastRampIndex = -1;
+
+    // Send every packet up front, then deliver them in the order they arrive
+    uint32_t count = (uint32_t)(duration * kSampleRate / kPacketFrames);
+    packet_t *packets = (packet_t*)malloc(sizeof(packet_t) * count);
+    uint32_t sent = 0;
+    for ( uint32_t i=0; i<count; i++ ) {
+        double sendTime = (double)i * kPacketFrames / kSampleRate;
+        if ( randomFraction() < lossRate ) {
+            result->packetsLost++;
+            continue;
+        }
+        packets[sent].sampleTime = (double)i * kPacketFrames;
+        packets[sent].arrival = sendTime + kBaseLatency + delay(sendTime, i);
+        sent++;
+    }
+    result->packetsSent = count;
+    qsort(packets, sent, sizeof(packet_t), compareArrivals);
+
+    float audio[kPacketFrames];
+    float output[kRenderFrames];
+    float *outputs[1] = { output };
+    uint32_t next = 0;
+    for ( double now = 0.0; now < duration + 1.0; now += kRenderFrames / kSampleRate ) {
+        for ( ; next < sent && packets[next].arrival <= now; next++ ) {
+            for ( uint32_t i=0; i<kPacketFrames; i++ ) {
+                audio[i] = (float)(((uint32_t)packets[next].sampleTime + i) % kRampLength) / kRampLength;
+            }
+            const void *data[1] = { audio };
+            AEJitterBufferPut(buffer, &kFormat, data, kPacketFrames, packets[next].sampleTime, packets[next].arrival);
+        }
+
+        AEJitterBufferGet(buffer, outputs, kRenderFrames);
+
+        if ( now >= kSettleTime && now < duration ) {
+            for ( uint32_t i=0; i<kRenderFrames; i++ ) {
+                // Count the frames that don't follow on from the one before
+                int index = (int)lrintf(output[i] * kRampLength);
+                if ( result->lastRampIndex >= 0 ) {
+                    result->framesPlayed++;
+                    if ( index != (result->lastRampIndex + 1) % (int)kRampLength ) result->discontinuities++;
+                    result->lastRampIndex = index;
+                } else if ( index != 0 ) {
+                    result->lastRampIndex = index;
+                }
+            }
+        }
+
+        AEJitterBufferStatistics statistics;
+        AEJitterBufferGetStatistics(buffer, &statistics);
+        result->maximumTargetDelay = fmax(result->maximumTargetDelay, statistics.targetDelay);
+        if ( observe ) observe(buffer, now);
+    }
+
+    free(packets);
+}
+
+static void printStatistics(AEJitterBuffer *buffer, const result_t *result) {
+    AEJitterBufferStatistics statistics;
+    AEJitterBufferGetStatistics(buffer, &statistics);
+    printf("  %u sent, %u lost in transit; received %llu, late %llu, lost %llu, dropped %llu; %llu frames concealed, %u discontinuities\n"
+           "  jitter %.1f ms, target delay %.1f ms (at most %.1f ms), current delay %.1f ms\n",
+           result->packetsSent, result->packetsLost,
+           (unsigned long long)statistics.packetsReceived, (unsigned long long)statistics.packetsLate,
+           (unsigned long long)statistics.packetsLost, (unsigned long long)statistics.packetsDropped,
+           (unsigned long long)statistics.framesConcealed, result->discontinuities,
+           statistics.jitter * 1000.0, statistics.targetDelay * 1000.0, result->maximumTargetDelay * 1000.0,
+           statistics.currentDelay * 1000.0);
+}
+
+static double noDelay(double time, uint32_t packet) {
+    return 0.0;
+}
+
+static double swappedPairs(double time, uint32_t packet) {
+    // Every other packet overtakes the one sent before it
+    return packet % 2 == 0 ? 0.008 : 0.0;
+}
+
+static double exponentialDelay(double time, uint32_t packet) {
+    // Mostly small delays, with a long tail, as on a busy network
+    return -0.008 * log(1.0 - randomFraction());
+}
+
+static double steppedDelay(double time, uint32_t packet) {
+    // Calm, then rough, then calm again
+    double spread = time >= 20.0 && time < 40.0 ? 0.04 : 0.002;
+    return spread * randomFraction();
+}
+
+static void testInOrder(void) {
+    AEJitterBuffer *buffer = AEJitterBufferNew(1, kSampleRate, kMaxPacketFrames, kPacketCapacity);
+    TEST_ASSERT(buffer);
+    result_t result;
+    simulate(buffer, 10.0, noDelay, 0.0, NULL, &result);
+    printStatistics(buffer, &result);
+
+    AEJitterBufferStatistics statistics;
+    AEJitterBufferGetStatistics(buffer, &statistics);
+    TEST_ASSERT(statistics.packetsReceived == result.packetsSent);
+    TEST_ASSERT(statistics.packetsLate == 0 && statistics.packetsLost == 0 && statistics.packetsDropped == 0);
+    TEST_ASSERT(statistics.jitter < 1.0e-9);
+    TEST_ASSERT(result.framesPlayed > 7.0 * kSampleRate);
+    TEST_ASSERT(result.discontinuities == 0);
+    AEJitterBufferFree(buffer);
+}
+
+static void testReordering(void) {
+    AEJitterBuffer *buffer = AEJitterBufferNew(1, kSampleRate, kMaxPacketFrames, kPacketCapacity);
+    TEST_ASSERT(buffer);
+    result_t result;
+    simulate(buffer, 10.0, swappedPairs, 0.0, NULL, &result);
+    printStatistics(buffer, &result);
+
+    // Packets play in timestamp order, whatever order they arrive in, once the depth has opened out to
+    // cover the reordering: only the first few can be missed
+    AEJitterBufferStatistics statistics;
+    AEJitterBufferGetStatistics(buffer, &statistics);
+    TEST_ASSERT(statistics.packetsLate == 0 && statistics.packetsLost < 4);
+    TEST_ASSERT(statistics.jitter > 0.001);
+    TEST_ASSERT(statistics.targetDelay > 0.008);
+    TEST_ASSERT(result.discontinuities == 0);
+    AEJitterBufferFree(buffer);
+}
+
+static void testJitterAndLoss(void) {
+    AEJitterBuffer *buffer = AEJitterBufferNew(1, kSampleRate, kMaxPacketFrames, kPacketCapacity);
+    TEST_ASSERT(buffer);
+    result_t result;
+    simulate(buffer, 60.0, exponentialDelay, 0.02, NULL, &result);
+    printStatistics(buffer, &result);
+
+    AEJitterBufferStatistics statistics;
+    AEJitterBufferGetStatistics(buffer, &statistics);
+
+    // The depth covers the 95th percentile of delay (24 ms for this distribution) plus a packet, so
+    // only a few percent of packets should be late
+    TEST_ASSERT_MESSAGE(statistics.targetDelay > 0.015 && statistics.targetDelay < 0.05, "target delay %.1f ms", statistics.targetDelay * 1000.0);
+    TEST_ASSERT_MESSAGE(statistics.packetsLate < result.packetsSent / 20, "%llu packets late", (unsigned long long)statistics.packetsLate);
+
+    // Losses are estimated from the gaps concealed, which also include late packets
+    uint64_t missing = result.packetsLost + statistics.packetsLate;
+    TEST_ASSERT_MESSAGE(statistics.packetsLost > missing / 2 && statistics.packetsLost < missing * 2,
+                        "%llu packets estimated lost, of %llu missing", (unsigned long long)statistics.packetsLost, (unsigned long long)missing);
+    TEST_ASSERT(statistics.packetsDropped == 0);
+    TEST_ASSERT(statistics.framesConcealed > 0);
+    AEJitterBufferFree(buffer);
+}
+
+static double targetDelayAt[3];
+
+static void observeTargetDelay(AEJitterBuffer *buffer, double time) {
+    // Sample the target delay a second after each change in conditions, and well after the last
+    AEJitterBufferStatistics statistics;
+    AEJitterBufferGetStatistics(buffer, &statistics);
+    int sample = time < 19.0 ? 0 : time < 21.0 ? -1 : time < 41.0 ? 1 : time < 55.0 ? -1 : 2;
+    if ( sample >= 0 ) targetDelayAt[sample] = statistics.targetDelay;
+}
+
+static void testAdaptation(void) {
+    AEJitterBuffer *buffer = AEJitterBufferNew(1, kSampleRate, kMaxPacketFrames, kPacketCapacity);
+    TEST_ASSERT(buffer);
+    result_t result;
+    simulate(buffer, 60.0, steppedDelay, 0.0, observeTargetDelay, &result);
+    printStatistics(buffer, &result);
+    printf("  target delay: calm %.1f ms, rough %.1f ms, calm again %.1f ms\n",
+           targetDelayAt[0] * 1000.0, targetDelayAt[1] * 1000.0, targetDelayAt[2] * 1000.0);
+
+    // Opens out for rough conditions, and closes up again once they've passed
+    TEST_ASSERT(targetDelayAt[0] < 0.015);
+    TEST_ASSERT(targetDelayAt[1] > 0.035);
+    TEST_ASSERT(targetDelayAt[2] < 0.015);
+    AEJitterBufferFree(buffer);
+}
+
+static void testDelayEstimate(void) {
+    // Random transit times, quantized so many are equal, through several windows' worth of packets
+    const int window = 256;
+    const int count = 4000;
+    AEJitterBuffer *buffer = AEJitterBufferNew(1, kSampleRate, kPacketFrames, 4);
+    TEST_ASSERT(buffer);
+
+    double *transits = (double*)malloc(sizeof(double) * count);
+    double sorted[256];
+    float audio[kPacketFrames];
+    memset(audio, 0, sizeof(audio));
+    const void *data[1] = { audio };
+    double previous = 0.0;
+
+    for ( int i=0; i<count; i++ ) {
+        double sampleTime = (double)i * kPacketFrames;
+        double spread = (i / 1000) % 2 == 0 ? 0.1 : 0.01;
+        transits[i] = floor(randomFraction() * spread * 1000.0) / 1000.0;
+        AEJitterBufferPut(buffer, &kFormat, data, kPacketFrames, sampleTime, sampleTime / kSampleRate + transits[i]);
+
+        int n = i + 1 < window ? i + 1 : window;
+        memcpy(sorted, transits + i + 1 - n, sizeof(double) * n);
+        qsort(sorted, n, sizeof(double), compareDoubles);
+        double delay = sorted[(int)((n - 1) * 0.95)] - sorted[0];
+        double expected = fmax(0.01, fmin(1.0, delay + (double)kPacketFrames / kSampleRate));
+
+        AEJitterBufferStatistics statistics;
+        AEJitterBufferGetStatistics(buffer, &statistics);
+        if ( i == 0 || expected >= previous ) {
+            // Rises straight to the new percentile
+            TEST_ASSERT_MESSAGE(fabs(statistics.targetDelay - expected) < 1.0e-9,
+                                "packet %d: target delay %.6f, expected %.6f", i, statistics.targetDelay, expected);
+        } else {
+            // Falls towards it
+            TEST_ASSERT_MESSAGE(statistics.targetDelay >= expected - 1.0e-9 && statistics.targetDelay <= previous + 1.0e-9,
+                                "packet %d: target delay %.6f, expected between %.6f and %.6f", i, statistics.targetDelay, expected, previous);
+        }
+        previous = statistics.targetDelay;
+    }
+
+    free(transits);
+    AEJitterBufferFree(buffer);
+}
+
+int main(int argc, char *argv[]) {
+    TEST_RUN(testDelayEstimate());
+    TEST_RUN(testInOrder());
+    TEST_RUN(testReordering());
+    TEST_RUN(testJitterAndLoss());
+    TEST_RUN(testAdaptation());
+    return TEST_RESULT();
+}
@@ -0,0 +1,105 @@
+//
+//  AEMixerBufferBenchmark.m
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Benchmark for AEMixerBuffer: the cost of enqueuing a block of audio for every source, and
+//  of mixing it back out, from 2 to 256 sources. macOS only.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+#import "AEMixerBuffer.h"
+#import "AEUtilities.h"
+#include "TestSupport.h"
+
+static const double kSampleRate = 44100.0;
+static const UInt32 kBlockFrames = 512;
+static const int kWarmupCycles = 100;
+static const int kCycles = 2000;
+
+static void benchmark(int sourceCount) {
+    AudioStreamBasicDescription format = AEAudioStreamBasicDescriptionNonInterleavedFloatStereo;
+    format.mSampleRate = kSampleRate;
+    
+    AEMixerBuffer *mixer = [[AEMixerBuffer alloc] initWithClientFormat:format];
+    for ( int i=0; i<sourceCount; i++ ) {
+        [mixer setVolume:1.0 / sourceCount forSource:(AEMixerBufferSource)(intptr_t)(i + 1)];
+    }
+    
+    AudioBufferList *input = AEAudioBufferListCreate(format, kBlockFrames);
+    for ( int i=0; i<input->mNumberBuffers; i++ ) {
+        float *samples = (float*)input->mBuffers[i].mData;
+        for ( UInt32 frame=0; frame<kBlockFrames; frame++ ) samples[frame] = 0.5f * sinf(2.0f * M_PI * 440.0f * frame / kSampleRate);
+    }
+    AudioBufferList *output = AEAudioBufferListCreate(format, kBlockFrames);
+    
+    AudioTimeStamp timestamp = {
+        .mFlags = kAudioTimeStampHostTimeValid | kAudioTimeStampSampleTimeValid,
+        .mHostTime = AECurrentTimeInHostTicks(),
+    };
+    
+    double enqueueTime = 0.0, dequeueTime = 0.0;
+    for ( int cycle=0; cycle<kWarmupCycles + kCycles; cycle++ ) {
+        double start = TestCurrentTime();
+        for ( int i=0; i<sourceCount; i++ ) {
+            AEMixerBufferEnqueue(mixer, (AEMixerBufferSource)(intptr_t)(i + 1), input, kBlockFrames, &timestamp);
+        }
+        double enqueued = TestCurrentTime();
+        
+        UInt32 frames = kBlockFrames;
+        AEAudioBufferListSetLength(output, format, kBlockFrames);
+        AEMixerBufferDequeue(mixer, output, &frames, NULL);
+        double dequeued = TestCurrentTime();
+        TEST_ASSERT_MESSAGE(frames == kBlockFrames, "dequeued %u frames", (unsigned int)frames);
+        
+        if ( cycle >= kWarmupCycles ) {
+            enqueueTime += enqueued - start;
+            dequeueTime += dequeued - enqueued;
+        }
+        
+        timestamp.mHostTime += AEHostTicksFromSeconds(kBlockFrames / kSampleRate);
+        timestamp.mSampleTime += kBlockFrames;
+    }
+    
+    double enqueue = enqueueTime / kCycles;
+    double dequeue = dequeueTime / kCycles;
+    printf("  %3d sources: enqueue %7.1f us (%.2f us per source), dequeue %7.1f us (%.2f us per source), %5.2f%% of real time\n",
+           sourceCount, enqueue * 1.0e6, enqueue * 1.0e6 / sourceCount, dequeue * 1.0e6, dequeue * 1.0e6 / sourceCount,
+           100.0 * (enqueue + dequeue) / (kBlockFrames / kSampleRate));
+    
+    AEAudioBufferListFree(input);
+    AEAudioBufferListFree(output);
+}
+
+int main(int argc, char *argv[]) {
+    @autoreleasepool {
+        printf("%u-frame blocks of stereo float at %.0f Hz\n", (unsigned int)kBlockFrames, kSampleRate);
+        for ( int sourceCount=2; sourceCount<=256; sourceCount *= 2 ) {
+            @autoreleasepool {
+                benchmark(sourceCount);
+            }
+        }
+    }
+    return TEST_RESULT();
+}
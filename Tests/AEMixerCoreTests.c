@@ -0,0 +1,191 @@
+//
+//  AEMixerCoreTests.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Tests AEMixerCore's drift tracker and resampler: that a source whose clock runs 200 ppm
+//  fast or slow, delivering 512-frame blocks to a mixer rendering 256 frames at a time, is
+//  tracked to a steady correction, and that downsampling filters out content above the
+//  output's Nyquist frequency instead of aliasing it.
+//
+
+#include "AEMixerCore.h"
+#include "TestSupport.h"
+#include <math.h>
+
+static const double   kSampleRate       = 48000.0;
+static const uint32_t kSourceBlockFrames = 512;
+static const uint32_t kMixerBlockFrames = 256;
+static const double   kLatency          = 0.03;     // Seconds buffered before playback starts
+static const double   kDuration         = 600.0;    // Seconds of audio to simulate
+static const double   kSettleTime       = 300.0;    // Seconds allowed to converge
+#define kMaxBlocks 64
+
+// A source's buffer, as the mixer buffer holds it: blocks stamped with their capture time
+typedef struct {
+    double      stamp[kMaxBlocks];
+    uint32_t    offset[kMaxBlocks];
+    uint32_t    head;
+    uint32_t    count;
+    uint32_t    available;
+} source_t;
+
+static uint32_t randomState = 1;
+static double randomFraction(void) {
+    randomState = randomState * 1664525 + 1013904223;
+    return (double)(randomState >> 8) / (double)(1 << 24);
+}
+
+static void testDriftConvergence(double ppm, double arrivalJitter, double tolerance) {
+    AEMixerCoreResampler *resampler = AEMixerCoreResamplerNew(1, 2 * kMixerBlockFrames, 1.0 + AEMixerCoreDriftMaximumCorrection);
+    TEST_ASSERT(resampler);
+
+    source_t source;
+    memset(&source, 0, sizeof(source));
+    AEMixerCoreDriftTracker tracker;
+    bool primed = false;
+
+    const double sourceBlockDuration = kSourceBlockFrames / (kSampleRate * (1.0 + ppm * 1.0e-6));
+    const double mixerBlockDuration = kMixerBlockFrames / kSampleRate;
+    double nextBlockDue = sourceBlockDuration;
+    double nextArrival = nextBlockDue + arrivalJitter * randomFraction();
+
+    double minimum = INFINITY, maximum = -INFINITY, total = 0.0;
+    uint32_t samples = 0, underruns = 0;
+    float output[kMixerBlockFrames];
+    float *outputs[1] = { output };
+
+    for ( double now = 0.0; now < kDuration; now += mixerBlockDuration ) {
+        // Blocks arrive up to the jitter late, and are stamped on arrival, less their duration
+        while ( nextArrival <= now ) {
+            TEST_ASSERT(source.count < kMaxBlocks);
+            uint32_t slot = (source.head + source.count++) % kMaxBlocks;
+            source.stamp[slot] = nextArrival - kSourceBlockFrames / kSampleRate;
+            source.offset[slot] = 0;
+            source.available += kSourceBlockFrames;
+            nextBlockDue += sourceBlockDuration;
+            nextArrival = nextBlockDue + arrivalJitter * randomFraction();
+        }
+
+        if ( !primed && source.available < kLatency * kSampleRate ) continue;
+
+        double fill = AEMixerCoreResamplerBufferedFrames(resampler)
+            + (source.available > 0
+                ? (now - (source.stamp[source.head] + source.offset[source.head] / kSampleRate)) * kSampleRate
+                : 0.0);
+        if ( !primed ) {
+            AEMixerCoreDriftTrackerReset(&tracker, fill);
+            primed = true;
+        }
+        double correction = AEMixerCoreDriftTrackerUpdate(&tracker, fill, kSampleRate, mixerBlockDuration);
+        double ratio = 1.0 + correction;
+
+        uint32_t needed = AEMixerCoreResamplerInputFramesNeeded(resampler, kMixerBlockFrames, ratio);
+        float *input[1];
+        AEMixerCoreResamplerGetInputBuffers(resampler, input);
+        for ( uint32_t i=0; i<needed; i++ ) {
+            if ( source.available == 0 ) {
+                underruns++;
+                break;
+            }
+            input[0][i] = 0.0f;
+            source.available--;
+            if ( ++source.offset[source.head] == kSourceBlockFrames ) {
+                source.head = (source.head + 1) % kMaxBlocks;
+                source.count--;
+            }
+        }
+        AEMixerCoreResamplerCommitInput(resampler, needed);
+        AEMixerCoreResamplerRender(resampler, outputs, kMixerBlockFrames, ratio);
+
+        if ( now >= kSettleTime ) {
+            double value = correction * 1.0e6;
+            minimum = fmin(minimum, value);
+            maximum = fmax(maximum, value);
+            total += value;
+            samples++;
+        }
+    }
+
+    double mean = total / samples;
+    printf("  %+.0f ppm, %.1f ms jitter: correction %.2f to %.2f ppm, mean %.2f ppm, %u underruns\n",
+           ppm, arrivalJitter * 1000.0, minimum, maximum, mean, underruns);
+    TEST_ASSERT(underruns == 0);
+    TEST_ASSERT_MESSAGE(fabs(mean - ppm) < 1.0, "mean correction %.2f ppm", mean);
+    TEST_ASSERT_MESSAGE(minimum > ppm - tolerance && maximum < ppm + tolerance,
+                        "correction swings from %.2f to %.2f ppm", minimum, maximum);
+
+    AEMixerCoreResamplerFree(resampler);
+}
+
+static double renderTone(double ratio, double frequency) {
+    // Resample a tone, and return the output's RMS level relative to the tone's
+    const uint32_t outputFrames = 8192;
+    const uint32_t settleFrames = 1024;
+    AEMixerCoreResampler *resampler = AEMixerCoreResamplerNew(1, kMixerBlockFrames * 8, ratio);
+    TEST_ASSERT(resampler);
+
+    float output[kMixerBlockFrames];
+    float *outputs[1] = { output };
+    double inputPhase = 0.0, sum = 0.0;
+    for ( uint32_t frame=0; frame<outputFrames; frame += kMixerBlockFrames ) {
+        uint32_t needed = AEMixerCoreResamplerInputFramesNeeded(resampler, kMixerBlockFrames, ratio);
+        float *input[1];
+        AEMixerCoreResamplerGetInputBuffers(resampler, input);
+        for ( uint32_t i=0; i<needed; i++ ) {
+            input[0][i] = (float)sin(inputPhase);
+            inputPhase += 2.0 * M_PI * frequency / (kSampleRate * ratio);
+        }
+        AEMixerCoreResamplerCommitInput(resampler, needed);
+        AEMixerCoreResamplerRender(resampler, outputs, kMixerBlockFrames, ratio);
+        if ( frame >= settleFrames ) {
+            for ( uint32_t i=0; i<kMixerBlockFrames; i++ ) sum += (double)output[i] * output[i];
+        }
+    }
+
+    AEMixerCoreResamplerFree(resampler);
+    return sqrt(sum / (outputFrames - settleFrames)) * sqrt(2.0);
+}
+
+static void testDownsampling(void) {
+    // From 96 kHz to 48 kHz: a 4 kHz tone passes, and a 40 kHz tone, which would alias to 8 kHz,
+    // is filtered out
+    double passed = renderTone(2.0, 4000.0);
+    double aliased = renderTone(2.0, 40000.0);
+    printf("  4 kHz: %.2f dB, 40 kHz: %.1f dB\n", 20.0 * log10(passed), 20.0 * log10(aliased));
+    TEST_ASSERT_MESSAGE(fabs(passed - 1.0) < 0.01, "4 kHz tone at %.4f", passed);
+    TEST_ASSERT_MESSAGE(aliased < 0.001, "40 kHz tone aliased at %.1f dB", 20.0 * log10(aliased));
+
+    // Upsampling is unaffected
+    double upsampled = renderTone(0.5, 4000.0);
+    TEST_ASSERT_MESSAGE(fabs(upsampled - 1.0) < 0.01, "upsampled 4 kHz tone at %.4f", upsampled);
+}
+
+int main(int argc, char *argv[]) {
+    TEST_RUN(testDriftConvergence(200.0, 0.0, 2.0));
+    TEST_RUN(testDriftConvergence(-200.0, 0.0, 2.0));
+    TEST_RUN(testDriftConvergence(200.0, 0.002, 30.0));
+    TEST_RUN(testDriftConvergence(-200.0, 0.002, 30.0));
+    TEST_RUN(testDownsampling());
+    return TEST_RESULT();
+}
@@ -0,0 +1,163 @@
+//
+//  AEPCMFileBenchmark.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Read and write throughput of AEPCMFile, for each file type and sample format, against
+//  ExtAudioFile on macOS. Both are given interleaved 32-bit float audio, as the engine's
+//  file classes use them.
+//
+
+#include "AEPCMFile.h"
+#include "TestSupport.h"
+#include <unistd.h>
+#include <math.h>
+#ifdef __APPLE__
+#include <AudioToolbox/AudioToolbox.h>
+#endif
+
+#define kChannels    2
+#define kBlockFrames 4096
+
+static const double   kSampleRate  = 48000.0;
+static const double   kDuration    = 120.0;
+
+typedef struct {
+    const char     *name;
+    AEPCMFileType   type;
+    uint32_t        bits;
+    bool            isFloat;
+    const char     *extension;
+} format_t;
+
+static float block[kBlockFrames * kChannels];
+
+static void fillBlock(void) {
+    for ( uint32_t i=0; i<kBlockFrames; i++ ) {
+        block[i*kChannels] = 0.5f * sinf(i * 0.01f);
+        block[i*kChannels+1] = -block[i*kChannels];
+    }
+}
+
+static void report(const char *backend, const char *operation, const format_t *format, double seconds) {
+    double bytes = kDuration * kSampleRate * kChannels * (format->bits / 8);
+    printf("  %-12s %-6s %-22s %8.1f MB/s %8.0fx real time\n", backend, operation, format->name,
+           bytes / seconds / 1.0e6, kDuration / seconds);
+}
+
+static void benchmarkAEPCMFile(const char *path, const format_t *format) {
+    AEPCMFileFormat fileFormat = { .sampleRate = kSampleRate, .channels = kChannels, .bitsPerSample = format->bits, .isFloat = format->isFloat };
+    uint64_t totalFrames = (uint64_t)(kDuration * kSampleRate);
+
+    double start = TestCurrentTime();
+    AEPCMFile *file = AEPCMFileCreate(path, format->type, &fileFormat, totalFrames, NULL);
+    TEST_ASSERT(file != NULL);
+    const float *buffers[1] = { block };
+    for ( uint64_t frame=0; frame<totalFrames; frame+=kBlockFrames ) {
+        TEST_ASSERT(AEPCMFileWriteFloat(file, buffers, 1, kBlockFrames) == 0);
+    }
+    TEST_ASSERT(AEPCMFileClose(file) == 0);
+    report("AEPCMFile", "write", format, TestCurrentTime() - start);
+
+    start = TestCurrentTime();
+    file = AEPCMFileOpen(path, NULL);
+    TEST_ASSERT(file != NULL);
+    float *readBuffers[1] = { block };
+    uint32_t frames;
+    do {
+        TEST_ASSERT(AEPCMFileReadFloat(file, readBuffers, 1, kBlockFrames, &frames) == 0);
+    } while ( frames > 0 );
+    AEPCMFileClose(file);
+    report("AEPCMFile", "read", format, TestCurrentTime() - start);
+}
+
+#ifdef __APPLE__
+static void benchmarkExtAudioFile(const char *path, const format_t *format) {
+    AudioStreamBasicDescription clientFormat = {
+        .mSampleRate = kSampleRate, .mFormatID = kAudioFormatLinearPCM,
+        .mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked,
+        .mBytesPerPacket = kChannels * sizeof(float), .mFramesPerPacket = 1, .mBytesPerFrame = kChannels * sizeof(float),
+        .mChannelsPerFrame = kChannels, .mBitsPerChannel = 32
+    };
+    AudioStreamBasicDescription fileFormat = clientFormat;
+    fileFormat.mFormatFlags = (format->isFloat ? kAudioFormatFlagIsFloat : kAudioFormatFlagIsSignedInteger) | kAudioFormatFlagIsPacked
+                                | (format->type == AEPCMFileTypeAIFF ? kAudioFormatFlagIsBigEndian : 0);
+    fileFormat.mBitsPerChannel = format->bits;
+    fileFormat.mBytesPerFrame = fileFormat.mBytesPerPacket = kChannels * (format->bits / 8);
+    AudioFileTypeID fileType = format->type == AEPCMFileTypeWAV ? kAudioFileWAVEType
+                             : format->type == AEPCMFileTypeAIFF ? (format->isFloat ? kAudioFileAIFCType : kAudioFileAIFFType)
+                             : kAudioFileCAFType;
+    CFURLRef url = CFURLCreateFromFileSystemRepresentation(NULL, (const UInt8*)path, strlen(path), false);
+    uint64_t totalFrames = (uint64_t)(kDuration * kSampleRate);
+    AudioBufferList bufferList = { 1, { { kChannels, kBlockFrames * kChannels * sizeof(float), block } } };
+
+    double start = TestCurrentTime();
+    ExtAudioFileRef file;
+    TEST_ASSERT(ExtAudioFileCreateWithURL(url, fileType, &fileFormat, NULL, kAudioFileFlags_EraseFile, &file) == noErr);
+    TEST_ASSERT(ExtAudioFileSetProperty(file, kExtAudioFileProperty_ClientDataFormat, sizeof(clientFormat), &clientFormat) == noErr);
+    for ( uint64_t frame=0; frame<totalFrames; frame+=kBlockFrames ) {
+        TEST_ASSERT(ExtAudioFileWrite(file, kBlockFrames, &bufferList) == noErr);
+    }
+    ExtAudioFileDispose(file);
+    report("ExtAudioFile", "write", format, TestCurrentTime() - start);
+
+    start = TestCurrentTime();
+    TEST_ASSERT(ExtAudioFileOpenURL(url, &file) == noErr);
+    TEST_ASSERT(ExtAudioFileSetProperty(file, kExtAudioFileProperty_ClientDataFormat, sizeof(clientFormat), &clientFormat) == noErr);
+    UInt32 frames;
+    do {
+        frames = kBlockFrames;
+        bufferList.mBuffers[0].mDataByteSize = kBlockFrames * kChannels * sizeof(float);
+        TEST_ASSERT(ExtAudioFileRead(file, &frames, &bufferList) == noErr);
+    } while ( frames > 0 );
+    ExtAudioFileDispose(file);
+    report("ExtAudioFile", "read", format, TestCurrentTime() - start);
+
+    CFRelease(url);
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    static const format_t formats[] = {
+        { "WAV 16-bit",         AEPCMFileTypeWAV,  16, false, "wav" },
+        { "WAV 24-bit",         AEPCMFileTypeWAV,  24, false, "wav" },
+        { "WAV 32-bit float",   AEPCMFileTypeWAV,  32, true,  "wav" },
+        { "AIFF 16-bit",        AEPCMFileTypeAIFF, 16, false, "aiff" },
+        { "AIFF 24-bit",        AEPCMFileTypeAIFF, 24, false, "aiff" },
+        { "CAF 32-bit float",   AEPCMFileTypeCAF,  32, true,  "caf" },
+    };
+
+    fillBlock();
+    printf("%.0f s of %u-channel audio at %.0f Hz, written then read back (warm cache)\n", kDuration, kChannels, kSampleRate);
+    for ( size_t i=0; i<sizeof(formats)/sizeof(formats[0]); i++ ) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/AEPCMFileBenchmark-XXXXXX.%s", formats[i].extension);
+        close(mkstemps(path, (int)strlen(formats[i].extension) + 1));
+        benchmarkAEPCMFile(path, &formats[i]);
+#ifdef __APPLE__
+        benchmarkExtAudioFile(path, &formats[i]);
+#endif
+        unlink(path);
+    }
+    return TEST_RESULT();
+}
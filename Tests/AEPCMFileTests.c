@@ -0,0 +1,212 @@
+//
+//  AEPCMFileTests.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Tests AEPCMFile's WAV headers (plain and WAVE_FORMAT_EXTENSIBLE fmt chunks, and the fact
+//  chunk of floating-point files) and round trips through each file type.
+//
+
+#include "AEPCMFile.h"
+#include "TestSupport.h"
+#include <unistd.h>
+#include <math.h>
+#include <sys/wait.h>
+
+static const uint32_t kFrames = 10000;
+
+typedef struct {
+    uint16_t    formatTag;
+    uint16_t    subFormatTag;
+    uint32_t    formatChunkSize;
+    uint16_t    validBits;
+    bool        haveFact;
+    uint32_t    factFrames;
+    uint32_t    dataOffset;
+    uint32_t    dataSize;
+} wav_header_t;
+
+static uint16_t le16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t le32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static wav_header_t readWAVHeader(const char *path) {
+    uint8_t bytes[256];
+    FILE *file = fopen(path, "rb");
+    TEST_ASSERT(file != NULL);
+    size_t length = fread(bytes, 1, sizeof(bytes), file);
+    fclose(file);
+    TEST_ASSERT(length >= 44 && memcmp(bytes, "RIFF", 4) == 0 && memcmp(bytes+8, "WAVE", 4) == 0);
+
+    wav_header_t header;
+    memset(&header, 0, sizeof(header));
+    for ( size_t offset = 12; offset + 8 <= length; ) {
+        uint32_t size = le32(bytes+offset+4);
+        const uint8_t *body = bytes+offset+8;
+        if ( memcmp(bytes+offset, "fmt ", 4) == 0 ) {
+            header.formatChunkSize = size;
+            header.formatTag = le16(body);
+            if ( size >= 40 ) {
+                TEST_ASSERT(le16(body+16) == 22);
+                header.validBits = le16(body+18);
+                header.subFormatTag = le16(body+24);
+                static const uint8_t guidTail[14] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+                TEST_ASSERT(memcmp(body+26, guidTail, sizeof(guidTail)) == 0);
+            }
+        } else if ( memcmp(bytes+offset, "fact", 4) == 0 ) {
+            TEST_ASSERT(size == 4);
+            header.haveFact = true;
+            header.factFrames = le32(body);
+        } else if ( memcmp(bytes+offset, "data", 4) == 0 ) {
+            header.dataOffset = (uint32_t)offset + 8;
+            header.dataSize = size;
+            break;
+        }
+        offset += 8 + size + (size & 1);
+    }
+    TEST_ASSERT(header.dataOffset != 0);
+    return header;
+}
+
+static float sampleValue(uint32_t frame, uint32_t channel) {
+    return (float)sin(frame * 0.01 * (channel + 1)) * 0.5f;
+}
+
+static void writeFile(const char *path, AEPCMFileType type, AEPCMFileFormat format, uint32_t frames) {
+    AEPCMFile *file = AEPCMFileCreate(path, type, &format, frames, NULL);
+    TEST_ASSERT(file != NULL);
+    float buffer[256 * 8];
+    const float *buffers[1] = { buffer };
+    for ( uint32_t frame=0; frame<frames; frame+=256 ) {
+        uint32_t count = frames - frame < 256 ? frames - frame : 256;
+        for ( uint32_t i=0; i<count; i++ ) {
+            for ( uint32_t channel=0; channel<format.channels; channel++ ) {
+                buffer[i*format.channels + channel] = sampleValue(frame + i, channel);
+            }
+        }
+        TEST_ASSERT(AEPCMFileWriteFloat(file, buffers, 1, count) == 0);
+    }
+    TEST_ASSERT(AEPCMFileClose(file) == 0);
+}
+
+static void checkContents(const char *path, AEPCMFileFormat format, uint32_t frames) {
+    int error = 0;
+    AEPCMFile *file = AEPCMFileOpen(path, &error);
+    TEST_ASSERT_MESSAGE(file != NULL, "error %d", error);
+    AEPCMFileFormat readFormat = AEPCMFileGetFormat(file);
+    TEST_ASSERT(readFormat.channels == format.channels && readFormat.bitsPerSample == format.bitsPerSample
+                && readFormat.isFloat == format.isFloat && readFormat.sampleRate == format.sampleRate);
+    TEST_ASSERT(AEPCMFileGetLength(file) == frames);
+
+    // Integer samples are quantised, and converted through single-precision floating point
+    float tolerance = format.isFloat ? 1.0e-7f : fmaxf(2.0f / (float)(1ULL << (format.bitsPerSample - 1)), 1.0e-6f);
+    float buffer[256 * 8];
+    float *buffers[1] = { buffer };
+    for ( uint32_t frame=0; frame<frames; ) {
+        uint32_t count = 0;
+        TEST_ASSERT(AEPCMFileReadFloat(file, buffers, 1, 256, &count) == 0 && count > 0);
+        for ( uint32_t i=0; i<count; i++ ) {
+            for ( uint32_t channel=0; channel<format.channels; channel++ ) {
+                TEST_ASSERT(fabsf(buffer[i*format.channels + channel] - sampleValue(frame + i, channel)) <= tolerance);
+            }
+        }
+        frame += count;
+    }
+    AEPCMFileClose(file);
+}
+
+static void testWAVHeader(const char *path, uint32_t channels, uint32_t bits, bool isFloat, bool expectExtensible) {
+    AEPCMFileFormat format = { .sampleRate = 48000, .channels = channels, .bitsPerSample = bits, .isFloat = isFloat };
+    writeFile(path, AEPCMFileTypeWAV, format, kFrames);
+
+    wav_header_t header = readWAVHeader(path);
+    uint16_t tag = isFloat ? 0x0003 : 0x0001;
+    if ( expectExtensible ) {
+        TEST_ASSERT(header.formatTag == 0xFFFE && header.formatChunkSize == 40);
+        TEST_ASSERT(header.subFormatTag == tag && header.validBits == bits);
+    } else {
+        TEST_ASSERT(header.formatTag == tag && header.formatChunkSize == 16);
+    }
+    TEST_ASSERT(header.haveFact == isFloat);
+    if ( isFloat ) TEST_ASSERT(header.factFrames == kFrames);
+    TEST_ASSERT(header.dataSize == kFrames * channels * (bits/8));
+
+    checkContents(path, format, kFrames);
+}
+
+static void testRoundTrip(const char *path, AEPCMFileType type, uint32_t bits, bool isFloat) {
+    AEPCMFileFormat format = { .sampleRate = 44100, .channels = 2, .bitsPerSample = bits, .isFloat = isFloat };
+    writeFile(path, type, format, kFrames);
+    checkContents(path, format, kFrames);
+}
+
+static void testRecoveredFloatWAV(const char *path) {
+    AEPCMFileFormat format = { .sampleRate = 48000, .channels = 2, .bitsPerSample = 32, .isFloat = true };
+
+    // Write and commit in a child process that then dies without closing the file
+    pid_t child = fork();
+    if ( child == 0 ) {
+        AEPCMFile *file = AEPCMFileCreate(path, AEPCMFileTypeWAV, &format, 0, NULL);
+        if ( !file ) _exit(1);
+        float buffer[2 * 1000];
+        const float *buffers[1] = { buffer };
+        for ( uint32_t i=0; i<1000; i++ ) {
+            buffer[i*2] = sampleValue(i, 0);
+            buffer[i*2+1] = sampleValue(i, 1);
+        }
+        if ( AEPCMFileWriteFloat(file, buffers, 1, 1000) != 0 || AEPCMFileCommit(file, false) != 0 ) _exit(1);
+        if ( AEPCMFileWriteFloat(file, buffers, 1, 1000) != 0 || AEPCMFileCommit(file, false) != 0 ) _exit(1);
+        _exit(0);
+    }
+    int status;
+    TEST_ASSERT(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    TEST_ASSERT(AEPCMFileNeedsRecovery(path));
+    uint64_t frames = 0;
+    TEST_ASSERT(AEPCMFileRecover(path, &frames) == 0);
+    TEST_ASSERT(frames == 2000);
+
+    wav_header_t header = readWAVHeader(path);
+    TEST_ASSERT(header.formatTag == 0xFFFE && header.haveFact && header.factFrames == 2000);
+    TEST_ASSERT(header.dataSize == 2000 * 8);
+}
+
+int main(int argc, char *argv[]) {
+    char path[] = "/tmp/AEPCMFileTests-XXXXXX";
+    close(mkstemp(path));
+
+    TEST_RUN(testWAVHeader(path, 2, 16, false, false));
+    TEST_RUN(testWAVHeader(path, 1, 16, false, false));
+    TEST_RUN(testWAVHeader(path, 6, 16, false, true));
+    TEST_RUN(testWAVHeader(path, 2, 24, false, true));
+    TEST_RUN(testWAVHeader(path, 2, 32, false, true));
+    TEST_RUN(testWAVHeader(path, 2, 32, true, true));
+    TEST_RUN(testWAVHeader(path, 2, 64, true, true));
+    TEST_RUN(testRoundTrip(path, AEPCMFileTypeAIFF, 24, false));
+    TEST_RUN(testRoundTrip(path, AEPCMFileTypeAIFF, 32, true));
+    TEST_RUN(testRoundTrip(path, AEPCMFileTypeCAF, 16, false));
+    TEST_RUN(testRoundTrip(path, AEPCMFileTypeCAF, 32, true));
+    TEST_RUN(testRecoveredFloatWAV(path));
+
+    unlink(path);
+    return TEST_RESULT();
+}
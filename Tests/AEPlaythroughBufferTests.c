@@ -0,0 +1,189 @@
+//
+//  AEPlaythroughBufferTests.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Tests AEPlaythroughBuffer against a simulated duplex driver: an input device and an output
+//  device, each with its own clock and period, whose callbacks are stamped with the time of
+//  their I/O cycle but run a little after it, by a varying scheduling delay, so that input
+//  and output sometimes run in a different order from their cycles. Input is a sine wave,
+//  which must play out without gaps once the buffer has settled, with the rate correction
+//  following any drift between the two clocks.
+//
+
+#include "AEPlaythroughBuffer.h"
+#include "TestSupport.h"
+#include <math.h>
+
+static const double   kSampleRate       = 48000.0;
+static const uint32_t kMaxFrames        = 4096;
+static const double   kToneFrequency    = 440.0;
+static const double   kToneAmplitude    = 0.5;
+static const double   kSettleTime       = 40.0;     // Seconds for the latency and drift loops to settle
+static const double   kDuration         = 240.0;
+static const AEMixerCoreFormat kFormat  = { AEMixerCoreSampleFloat32, 1, false, 0 };
+
+typedef struct {
+    double      rate;       // Sample rate, as measured on the shared clock
+    uint32_t    period;     // Frames per cycle
+    double      start;      // Time of the first cycle
+    double      delay;      // Longest the callback runs after its cycle, in seconds
+    double      order;      // Seconds added to every run time, to run after the other device
+    uint64_t    cycles;
+    double      runTime;    // When the next callback runs
+} device_t;
+
+typedef struct {
+    uint64_t    underruns;
+    uint32_t    discontinuities;
+    double      maximumLatency;
+    double      correction;     // Average rate correction
+} result_t;
+
+static uint32_t randomState = 1;
+static double randomFraction(void) {
+    randomState = randomState * 1664525 + 1013904223;
+    return (double)(randomState >> 8) / (double)(1 << 24);
+}
+
+static double cycleTime(const device_t *device) {
+    return device->start + device->cycles * device->period / device->rate;
+}
+
+static void scheduleNext(device_t *device) {
+    // Callbacks for one device run in order, whatever their delays
+    double runTime = cycleTime(device) + randomFraction() * device->delay + device->order;
+    device->runTime = runTime > device->runTime ? runTime : device->runTime;
+}
+
+static void simulate(device_t *input, device_t *output, result_t *result) {
+    memset(result, 0, sizeof(result_t));
+    AEPlaythroughBuffer *buffer = AEPlaythroughBufferNew(1, kSampleRate, kMaxFrames);
+    TEST_ASSERT(buffer != NULL);
+
+    float audio[kMaxFrames];
+    float *outputs[1] = { audio };
+    uint64_t inputFrames = 0;
+    float lastSample = 0;
+    bool hasLastSample = false;
+    uint64_t settledUnderruns = 0;
+    uint32_t settledRenders = 0;
+    const double maximumStep = 2.0 * M_PI * kToneFrequency / kSampleRate * kToneAmplitude * 1.5;
+
+    input->runTime = output->runTime = 0;
+    scheduleNext(input);
+    scheduleNext(output);
+    while ( cycleTime(output) < kDuration ) {
+        if ( input->runTime <= output->runTime ) {
+            for ( uint32_t i=0; i<input->period; i++ ) {
+                audio[i] = kToneAmplitude * sin(2.0 * M_PI * kToneFrequency * (inputFrames + i) / kSampleRate);
+            }
+            const void *data[1] = { audio };
+            AEPlaythroughBufferWrite(buffer, &kFormat, data, input->period, cycleTime(input));
+            inputFrames += input->period;
+            input->cycles++;
+            scheduleNext(input);
+            continue;
+        }
+
+        double time = cycleTime(output);
+        AEPlaythroughBufferRead(buffer, outputs, output->period, time);
+        output->cycles++;
+        scheduleNext(output);
+
+        AEPlaythroughBufferStatistics statistics;
+        AEPlaythroughBufferGetStatistics(buffer, &statistics);
+        if ( time < kSettleTime ) {
+            settledUnderruns = statistics.underruns;
+            continue;
+        }
+
+        for ( uint32_t i=0; i<output->period; i++ ) {
+            if ( hasLastSample && fabsf(audio[i] - lastSample) > maximumStep ) {
+                result->discontinuities++;
+            }
+            lastSample = audio[i];
+            hasLastSample = true;
+        }
+        if ( statistics.addedLatency > result->maximumLatency ) {
+            result->maximumLatency = statistics.addedLatency;
+        }
+        result->correction += (statistics.correction - result->correction) / ++settledRenders;
+        result->underruns = statistics.underruns - settledUnderruns;
+    }
+
+    AEPlaythroughBufferFree(buffer);
+}
+
+static void testSameCycle(void) {
+    // One device: input and output share a cycle, and input always runs first
+    device_t input = { .rate = kSampleRate, .period = 256, .delay = 0.001 };
+    device_t output = { .rate = kSampleRate, .period = 256, .delay = 0.001, .order = 0.001 };
+    result_t result;
+    simulate(&input, &output, &result);
+    printf("  %llu underruns, %u discontinuities, latency up to %.0f frames, correction %.0f ppm\n",
+           (unsigned long long)result.underruns, result.discontinuities, result.maximumLatency, result.correction * 1.0e6);
+
+    TEST_ASSERT(result.underruns == 0);
+    TEST_ASSERT(result.discontinuities == 0);
+    TEST_ASSERT_MESSAGE(result.maximumLatency < 128, "latency up to %.0f frames", result.maximumLatency);
+    TEST_ASSERT(fabs(result.correction) < 20.0e-6);
+}
+
+static void testSwappingCallbacks(void) {
+    // Input and output share a cycle, but run on their own threads, in either order
+    device_t input = { .rate = kSampleRate, .period = 256, .delay = 0.002 };
+    device_t output = { .rate = kSampleRate, .period = 256, .delay = 0.002 };
+    result_t result;
+    simulate(&input, &output, &result);
+    printf("  %llu underruns, %u discontinuities, latency up to %.0f frames, correction %.0f ppm\n",
+           (unsigned long long)result.underruns, result.discontinuities, result.maximumLatency, result.correction * 1.0e6);
+
+    TEST_ASSERT(result.underruns == 0);
+    TEST_ASSERT(result.discontinuities == 0);
+    TEST_ASSERT_MESSAGE(result.maximumLatency < 2 * 256 + 128, "latency up to %.0f frames", result.maximumLatency);
+}
+
+static void testSeparateDevices(double drift) {
+    // Separate devices, with their own clocks and periods
+    device_t input = { .rate = kSampleRate * (1.0 + drift), .period = 512, .start = 0.0013, .delay = 0.002 };
+    device_t output = { .rate = kSampleRate, .period = 256, .delay = 0.002 };
+    result_t result;
+    simulate(&input, &output, &result);
+    printf("  %+.0f ppm: %llu underruns, %u discontinuities, latency up to %.0f frames, correction %.0f ppm\n",
+           drift * 1.0e6, (unsigned long long)result.underruns, result.discontinuities, result.maximumLatency, result.correction * 1.0e6);
+
+    TEST_ASSERT(result.underruns == 0);
+    TEST_ASSERT(result.discontinuities == 0);
+    TEST_ASSERT_MESSAGE(result.maximumLatency < 2 * 512, "latency up to %.0f frames", result.maximumLatency);
+    TEST_ASSERT_MESSAGE(fabs(result.correction - drift) < 50.0e-6, "correction %.0f ppm", result.correction * 1.0e6);
+}
+
+int main(int argc, char *argv[]) {
+    TEST_RUN(testSameCycle());
+    TEST_RUN(testSwappingCallbacks());
+    TEST_RUN(testSeparateDevices(0.0));
+    TEST_RUN(testSeparateDevices(200.0e-6));
+    TEST_RUN(testSeparateDevices(-200.0e-6));
+    return TEST_RESULT();
+}
@@ -0,0 +1,310 @@
+//
+//  AEScopeBufferTests.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Tests AEScopeBuffer: the lowest and highest values in each column, across writes that
+//  straddle column boundaries; silence for channels a write leaves out; snapshots handed over
+//  whole, and in order, to a reader on another thread; and history, across the ring's wrap
+//  point, with reads the writer overtakes rejected rather than returned torn.
+//
+
+#include "AEScopeBuffer.h"
+#include "TestSupport.h"
+#include <pthread.h>
+#include <sched.h>
+
+static const uint32_t kColumns         = 8;
+static const uint32_t kFramesPerColumn = 10;
+static const uint32_t kHistoryFrames   = 256;
+static const uint32_t kRampPeriod      = 1 << 20;   // Ramp values stay exact in a float
+
+static float signal(uint32_t channel, uint64_t frame) {
+    return (float)((int)((frame * 37 + channel * 11) % 101) - 50) / 50.0f;
+}
+
+static void checkColumns(const AEScopeSnapshot *snapshot, uint32_t channels) {
+    uint64_t firstColumn = snapshot->frameCount / kFramesPerColumn - snapshot->columns;
+    for ( uint32_t i=0; i<channels; i++ ) {
+        for ( uint32_t column=0; column<snapshot->columns; column++ ) {
+            uint64_t start = (firstColumn + column) * kFramesPerColumn;
+            float lowest = signal(i, start), highest = lowest;
+            for ( uint64_t frame=start; frame<start + kFramesPerColumn; frame++ ) {
+                float value = signal(i, frame);
+                if ( value < lowest ) lowest = value;
+                if ( value > highest ) highest = value;
+            }
+            TEST_ASSERT_MESSAGE(snapshot->minimum[i][column] == lowest && snapshot->maximum[i][column] == highest,
+                                "channel %u, column %llu: %g to %g, expected %g to %g", i, (unsigned long long)(firstColumn + column),
+                                snapshot->minimum[i][column], snapshot->maximum[i][column], lowest, highest);
+        }
+    }
+}
+
+static void testColumns(void) {
+    AEScopeBuffer *buffer = AEScopeBufferNew(2, kColumns, kFramesPerColumn, 0, 0);
+    TEST_ASSERT(buffer != NULL);
+
+    const AEScopeSnapshot *snapshot;
+    TEST_ASSERT(!AEScopeBufferGetSnapshot(buffer, &snapshot));
+    TEST_ASSERT(snapshot == NULL);
+
+    // Blocks of 7 frames, so columns begin and end part way through writes
+    float left[7], right[7];
+    const float *audio[2] = { left, right };
+    uint64_t frame = 0;
+    for ( int block=0; block<40; block++ ) {
+        for ( int i=0; i<7; i++ ) {
+            left[i] = signal(0, frame + i);
+            right[i] = signal(1, frame + i);
+        }
+        AEScopeBufferWrite(buffer, audio, 2, 7);
+        frame += 7;
+
+        uint64_t completeColumns = frame / kFramesPerColumn;
+        bool fresh = AEScopeBufferGetSnapshot(buffer, &snapshot);
+        if ( completeColumns == 0 ) {
+            TEST_ASSERT(!fresh && snapshot == NULL);
+            continue;
+        }
+        TEST_ASSERT(snapshot != NULL);
+        TEST_ASSERT(snapshot->frameCount == completeColumns * kFramesPerColumn);
+        TEST_ASSERT(snapshot->columns == (completeColumns < kColumns ? completeColumns : kColumns));
+        checkColumns(snapshot, 2);
+    }
+
+    // Nothing new until another column is done
+    TEST_ASSERT(!AEScopeBufferGetSnapshot(buffer, &snapshot));
+    TEST_ASSERT(snapshot != NULL);
+
+    AEScopeBufferFree(buffer);
+}
+
+static void testMissingChannels(void) {
+    AEScopeBuffer *buffer = AEScopeBufferNew(3, kColumns, kFramesPerColumn, 0, kHistoryFrames);
+    TEST_ASSERT(buffer != NULL);
+
+    // Half a column with all three channels, then the rest with only the first
+    float values[3][5] = { { 0.5f, 0.5f, 0.5f, 0.5f, 0.5f }, { 0.25f, 0.25f, 0.25f, 0.25f, 0.25f }, { -0.25f, -0.25f, -0.25f, -0.25f, -0.25f } };
+    const float *audio[3] = { values[0], values[1], values[2] };
+    AEScopeBufferWrite(buffer, audio, 3, 5);
+    AEScopeBufferWrite(buffer, audio, 1, 5);
+
+    // Then a whole column with only the first
+    AEScopeBufferWrite(buffer, audio, 1, 5);
+    AEScopeBufferWrite(buffer, audio, 1, 5);
+
+    const AEScopeSnapshot *snapshot;
+    TEST_ASSERT(AEScopeBufferGetSnapshot(buffer, &snapshot));
+    TEST_ASSERT(snapshot->columns == 2);
+    TEST_ASSERT(snapshot->minimum[0][0] == 0.5f && snapshot->maximum[0][0] == 0.5f);
+    TEST_ASSERT(snapshot->minimum[1][0] == 0.0f && snapshot->maximum[1][0] == 0.25f);
+    TEST_ASSERT(snapshot->minimum[2][0] == -0.25f && snapshot->maximum[2][0] == 0.0f);
+    for ( uint32_t i=1; i<3; i++ ) {
+        TEST_ASSERT(snapshot->minimum[i][1] == 0.0f && snapshot->maximum[i][1] == 0.0f);
+    }
+
+    // History mixes to mono across all of the buffer's channels, with the missing ones silent
+    float history[20];
+    uint64_t frameCount;
+    TEST_ASSERT(AEScopeBufferReadHistory(buffer, history, 20, &frameCount));
+    TEST_ASSERT(frameCount == 20);
+    const float scale = 1.0f / 3.0f;
+    for ( int i=0; i<20; i++ ) {
+        float expected = i < 5 ? 0.5f * scale + 0.25f * scale + -0.25f * scale : 0.5f * scale;
+        TEST_ASSERT_MESSAGE(history[i] == expected, "frame %d: %g, expected %g", i, history[i], expected);
+    }
+
+    // And with no channels at all, everything is silent
+    AEScopeBufferWrite(buffer, audio, 0, 10);
+    TEST_ASSERT(AEScopeBufferGetSnapshot(buffer, &snapshot));
+    for ( uint32_t i=0; i<3; i++ ) {
+        TEST_ASSERT(snapshot->minimum[i][2] == 0.0f && snapshot->maximum[i][2] == 0.0f);
+    }
+    TEST_ASSERT(AEScopeBufferReadHistory(buffer, history, 10, &frameCount));
+    TEST_ASSERT(frameCount == 30);
+    for ( int i=0; i<10; i++ ) TEST_ASSERT(history[i] == 0.0f);
+
+    AEScopeBufferFree(buffer);
+}
+
+static void testHistory(void) {
+    AEScopeBuffer *buffer = AEScopeBufferNew(2, kColumns, kFramesPerColumn, 0, kHistoryFrames);
+    TEST_ASSERT(buffer != NULL);
+
+    float output[kHistoryFrames * 2];
+    TEST_ASSERT(!AEScopeBufferReadHistory(buffer, output, 1, NULL));
+
+    // A ramp on both channels, so the mono mix is the frame index, in blocks that wrap the ring unevenly
+    float block[100];
+    const float *audio[2] = { block, block };
+    uint64_t frame = 0;
+    for ( int i=0; i<30; i++ ) {
+        for ( int j=0; j<100; j++ ) block[j] = (float)(frame + j);
+        AEScopeBufferWrite(buffer, audio, 2, 100);
+        frame += 100;
+
+        uint32_t frames = frame < kHistoryFrames ? (uint32_t)frame : kHistoryFrames;
+        if ( frame < kHistoryFrames ) {
+            // Not enough yet for more than has been written
+            TEST_ASSERT(!AEScopeBufferReadHistory(buffer, output, frames + 1, NULL));
+        }
+        uint64_t frameCount;
+        TEST_ASSERT(AEScopeBufferReadHistory(buffer, output, frames, &frameCount));
+        TEST_ASSERT(frameCount == frame);
+        for ( uint32_t j=0; j<frames; j++ ) {
+            TEST_ASSERT_MESSAGE(output[j] == (float)(frame - frames + j), "read %g at %u, expected %llu", output[j], j,
+                                (unsigned long long)(frame - frames + j));
+        }
+    }
+
+    // Reads are limited to half the ring, to leave the writer room
+    uint32_t capacity = 1;
+    while ( capacity < kHistoryFrames * 2 ) capacity <<= 1;
+    TEST_ASSERT(AEScopeBufferReadHistory(buffer, output, capacity / 2, NULL));
+    TEST_ASSERT(!AEScopeBufferReadHistory(buffer, output, capacity / 2 + 1, NULL));
+
+    // While disabled, history stands still
+    AEScopeBufferSetHistoryEnabled(buffer, false);
+    AEScopeBufferWrite(buffer, audio, 2, 100);
+    uint64_t frameCount;
+    TEST_ASSERT(AEScopeBufferReadHistory(buffer, output, 10, &frameCount));
+    TEST_ASSERT(frameCount == frame);
+
+    AEScopeBufferFree(buffer);
+}
+
+typedef struct {
+    AEScopeBuffer   *buffer;
+    uint64_t         frames;
+    uint32_t         blockFrames;
+    bool             yield;          // Give the reader a turn after each block, even on one core
+    volatile bool    finished;
+} writer_thread_t;
+
+static void *writerThread(void *context) {
+    writer_thread_t *thread = (writer_thread_t*)context;
+    float left[512], right[512];
+    const float *audio[2] = { left, right };
+    for ( uint64_t frame=0; frame<thread->frames; frame+=thread->blockFrames ) {
+        for ( uint32_t i=0; i<thread->blockFrames; i++ ) {
+            // Each column holds its own index on the left, negated on the right; the mono mix is zero,
+            // so history carries a ramp on the left alone
+            uint64_t column = (frame + i) / kFramesPerColumn;
+            left[i] = (float)(column % kRampPeriod);
+            right[i] = -left[i];
+        }
+        AEScopeBufferWrite(thread->buffer, audio, 2, thread->blockFrames);
+        if ( thread->yield ) sched_yield();
+    }
+    __sync_synchronize();
+    thread->finished = true;
+    return NULL;
+}
+
+static void testConcurrentSnapshots(void) {
+    AEScopeBuffer *buffer = AEScopeBufferNew(2, kColumns, kFramesPerColumn, 64, 0);
+    TEST_ASSERT(buffer != NULL);
+
+    writer_thread_t thread = { .buffer = buffer, .frames = (uint64_t)kRampPeriod * kFramesPerColumn / 16, .blockFrames = 128, .yield = true };
+    pthread_t threadId;
+    pthread_create(&threadId, NULL, writerThread, &thread);
+
+    uint64_t lastFrameCount = 0;
+    uint32_t snapshots = 0;
+    while ( !thread.finished ) {
+        const AEScopeSnapshot *snapshot;
+        if ( !AEScopeBufferGetSnapshot(buffer, &snapshot) ) {
+            sched_yield();
+            continue;
+        }
+        snapshots++;
+
+        // Newer than the last, and whole: consecutive columns from one moment
+        TEST_ASSERT_MESSAGE(snapshot->frameCount > lastFrameCount, "snapshot at %llu after %llu",
+                            (unsigned long long)snapshot->frameCount, (unsigned long long)lastFrameCount);
+        lastFrameCount = snapshot->frameCount;
+        uint64_t firstColumn = snapshot->frameCount / kFramesPerColumn - snapshot->columns;
+        for ( uint32_t column=0; column<snapshot->columns; column++ ) {
+            float expected = (float)((firstColumn + column) % kRampPeriod);
+            TEST_ASSERT_MESSAGE(snapshot->minimum[0][column] == expected && snapshot->maximum[0][column] == expected
+                                    && snapshot->minimum[1][column] == -expected && snapshot->maximum[1][column] == -expected,
+                                "torn snapshot: column %u holds %g, expected %g", column, snapshot->minimum[0][column], expected);
+        }
+    }
+    pthread_join(threadId, NULL);
+
+    // The last snapshot published is still there to take
+    const AEScopeSnapshot *snapshot;
+    if ( AEScopeBufferGetSnapshot(buffer, &snapshot) ) snapshots++;
+    TEST_ASSERT(snapshot->frameCount == thread.frames / kFramesPerColumn * kFramesPerColumn);
+    printf("  %u snapshots taken\n", snapshots);
+    TEST_ASSERT(snapshots > 0);
+
+    AEScopeBufferFree(buffer);
+}
+
+static void testConcurrentHistory(void) {
+    AEScopeBuffer *buffer = AEScopeBufferNew(1, kColumns, kFramesPerColumn, 0, kHistoryFrames);
+    TEST_ASSERT(buffer != NULL);
+
+    writer_thread_t thread = { .buffer = buffer, .frames = (uint64_t)kRampPeriod * 8, .blockFrames = 512 };
+
+    // With one channel, history is the writer's left channel, which steps once per column
+    pthread_t threadId;
+    pthread_create(&threadId, NULL, writerThread, &thread);
+
+    float output[kHistoryFrames];
+    uint32_t reads = 0, rejected = 0;
+    while ( !thread.finished ) {
+        uint64_t frameCount;
+        if ( !AEScopeBufferReadHistory(buffer, output, kHistoryFrames, &frameCount) ) {
+            rejected++;
+            continue;
+        }
+        reads++;
+
+        // A read the writer overtook would hold frames from a later pass around the ring
+        uint64_t start = frameCount - kHistoryFrames;
+        for ( uint32_t i=0; i<kHistoryFrames; i++ ) {
+            float expected = (float)(((start + i) / kFramesPerColumn) % kRampPeriod);
+            TEST_ASSERT_MESSAGE(output[i] == expected, "torn history: frame %llu holds %g, expected %g",
+                                (unsigned long long)(start + i), output[i], expected);
+        }
+    }
+    pthread_join(threadId, NULL);
+
+    printf("  %u reads, %u rejected as overwritten or too early\n", reads, rejected);
+    TEST_ASSERT(reads > 0);
+
+    AEScopeBufferFree(buffer);
+}
+
+int main(int argc, char *argv[]) {
+    TEST_RUN(testColumns());
+    TEST_RUN(testMissingChannels());
+    TEST_RUN(testHistory());
+    TEST_RUN(testConcurrentSnapshots());
+    TEST_RUN(testConcurrentHistory());
+    return TEST_RESULT();
+}
@@ -0,0 +1,113 @@
+//
+//  AESequencerClockTests.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Tests AESequencerClock: that renders far longer than a bar, at the shortest bar length, are
+//  covered by spans without gaps, and the timeline carries on from where they end; and that the
+//  clock stops partway through a long render at the end of a song that doesn't loop.
+//
+
+#include "AESequencerClock.h"
+#include "TestSupport.h"
+
+static const double   kBarFrames  = 64.0;
+static const uint32_t kLongRender = 20000;     // Over 300 bars
+
+static AESequencerClock *newClock(const uint32_t *chain, uint32_t chainLength, bool loop) {
+    const AESequencerEngineBeat *beats[4] = { NULL };
+    const uint32_t beatCounts[4] = { 0 };
+    AESequencerSong *song = AESequencerSongNew(1, 4, beats, beatCounts, chain, chainLength, loop);
+    TEST_ASSERT(song != NULL);
+    AESequencerClock *clock = AESequencerClockNew(kBarFrames);
+    TEST_ASSERT(clock != NULL);
+    AESequencerClockSetSong(clock, song);
+    AESequencerClockSetPlaying(clock, true);
+    return clock;
+}
+
+// Walk through the render's spans, checking they follow on from one another; returns the frames covered
+static uint32_t checkSpans(AESequencerClock *clock, const uint32_t *chain, uint32_t chainLength, uint64_t *bar) {
+    AESequencerClockSpanCursor cursor;
+    AESequencerClockBeginSpans(clock, &cursor);
+    AESequencerClockSpan span;
+    uint32_t offset = 0;
+    while ( AESequencerClockNextSpan(clock, &cursor, &span) ) {
+        TEST_ASSERT_MESSAGE(span.offset == offset, "span at %u, expected %u", span.offset, offset);
+        TEST_ASSERT(span.frames > 0 && span.position + span.frames <= kBarFrames);
+        TEST_ASSERT(span.song != NULL);
+        TEST_ASSERT_MESSAGE(span.chainEntry == *bar % chainLength, "bar %llu played chain entry %u",
+                            (unsigned long long)*bar, span.chainEntry);
+        TEST_ASSERT(span.pattern == chain[span.chainEntry]);
+        offset += span.frames;
+        if ( span.position + span.frames == kBarFrames ) (*bar)++;
+    }
+    return offset;
+}
+
+static void testLongRenders(void) {
+    const uint32_t chain[] = { 2, 0, 3 };
+    AESequencerClock *clock = newClock(chain, 3, true);
+
+    uint64_t bar = 0;
+    for ( int render=0; render<4; render++ ) {
+        AESequencerClockFreeRetiredSongs(AESequencerClockAdvance(clock, kLongRender));
+        TEST_ASSERT(checkSpans(clock, chain, 3, &bar) == kLongRender);
+    }
+
+    // The timeline kept up with every frame rendered
+    uint64_t frames = 4 * (uint64_t)kLongRender;
+    TEST_ASSERT(bar == frames / (uint64_t)kBarFrames);
+    uint32_t chainEntry;
+    float barPosition;
+    AESequencerClockGetPosition(clock, &chainEntry, &barPosition);
+    TEST_ASSERT(chainEntry == bar % 3);
+    TEST_ASSERT(barPosition == (float)((frames % (uint64_t)kBarFrames) / kBarFrames));
+
+    AESequencerClockFree(clock);
+}
+
+static void testStopDuringLongRender(void) {
+    const uint32_t chain[] = { 1, 2 };
+    AESequencerClock *clock = newClock(chain, 2, false);
+
+    // Start partway through a bar, so the song ends a few bars into the next render
+    AESequencerClockAdvance(clock, 100);
+    uint64_t bar = 0;
+    TEST_ASSERT(checkSpans(clock, chain, 2, &bar) == 100);
+    AESequencerClockAdvance(clock, kLongRender);
+    TEST_ASSERT(checkSpans(clock, chain, 2, &bar) == 2 * (uint32_t)kBarFrames - 100);
+    TEST_ASSERT(bar == 2);
+    TEST_ASSERT(!AESequencerClockIsPlaying(clock));
+
+    AESequencerClockAdvance(clock, kLongRender);
+    TEST_ASSERT(checkSpans(clock, chain, 2, &bar) == 0);
+
+    AESequencerClockFree(clock);
+}
+
+int main(int argc, char *argv[]) {
+    TEST_RUN(testLongRenders());
+    TEST_RUN(testStopDuringLongRender());
+    return TEST_RESULT();
+}
@@ -0,0 +1,214 @@
+//
+//  AESequencerEngineBenchmark.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Render cost of AESequencerEngine for 64 channels of 16-step sequences, against the per-frame
+//  loop AESequencerChannel used before it: nanosecond beat times computed in double for every
+//  frame, and one sample copied at a time. The loop is ported to C here as it was, host time
+//  and all, with the render timestamps the controller would have passed it.
+//
+
+#include "AESequencerEngine.h"
+#include "TestSupport.h"
+#include <math.h>
+
+#define kSequenceChannels   64
+#define kSteps              16
+#define kOutputChannels     2
+#define kBlockFrames        512
+
+static const double   kSampleRate       = 44100.0;
+static const double   kBPM              = 120.0;
+static const double   kSampleDuration   = 0.1;
+static const double   kDuration         = 240.0;
+
+static float *sample[kOutputChannels];
+static uint32_t sampleFrames;
+static AESequencerEngineBeat beats[kSequenceChannels][kSteps];
+static float outputBuffers[kOutputChannels][kBlockFrames];
+static float *output[kOutputChannels] = { outputBuffers[0], outputBuffers[1] };
+
+#pragma mark - Per-frame loop
+
+typedef struct {
+    const AESequencerEngineBeat *beats;
+    int         numBeats;
+    int         currentBeatIndex;
+    uint64_t    sequenceStartTimeNanoSeconds;
+    uint64_t    nanoSecondsPerSequence;
+    uint64_t    nanoSecondsPerFrame;
+    uint32_t    sampleFrameIndex;
+    bool        sampleIsPlaying;
+    float       playheadPosition;
+} per_frame_channel_t;
+
+static void perFrameRender(per_frame_channel_t *THIS, uint64_t hostTimeNanoSeconds, uint32_t frames) {
+    uint64_t currentTimeNanoSeconds = hostTimeNanoSeconds;
+    if ( THIS->sequenceStartTimeNanoSeconds == 0 ) {
+        THIS->sequenceStartTimeNanoSeconds = currentTimeNanoSeconds;
+    }
+
+    uint64_t elapsedTimeSinceSequenceStartNanoSeconds = currentTimeNanoSeconds - THIS->sequenceStartTimeNanoSeconds;
+    if ( elapsedTimeSinceSequenceStartNanoSeconds > THIS->nanoSecondsPerSequence ) {
+        elapsedTimeSinceSequenceStartNanoSeconds = elapsedTimeSinceSequenceStartNanoSeconds % THIS->nanoSecondsPerSequence;
+        THIS->sequenceStartTimeNanoSeconds = currentTimeNanoSeconds - elapsedTimeSinceSequenceStartNanoSeconds;
+        THIS->currentBeatIndex = -1;
+    }
+
+    THIS->playheadPosition = (float)elapsedTimeSinceSequenceStartNanoSeconds / (float)THIS->nanoSecondsPerSequence;
+
+    uint64_t frameTimeNanoSeconds = 0;
+    for ( uint32_t i=0; i<frames; i++ ) {
+        int nextBeatIndex = THIS->currentBeatIndex + 1 < THIS->numBeats ? THIS->currentBeatIndex + 1 : -1;
+        if ( nextBeatIndex >= 0 ) {
+            double beatTimeNanoSeconds = THIS->nanoSecondsPerSequence * THIS->beats[nextBeatIndex].onset;
+            double delta = elapsedTimeSinceSequenceStartNanoSeconds + frameTimeNanoSeconds - beatTimeNanoSeconds;
+            if ( delta >= 0 ) {
+                THIS->sampleFrameIndex = 0;
+                THIS->sampleIsPlaying = true;
+                THIS->currentBeatIndex = nextBeatIndex;
+            }
+        }
+
+        if ( THIS->sampleIsPlaying ) {
+            if ( THIS->currentBeatIndex >= 0 ) {
+                for ( int j=0; j<kOutputChannels; j++ ) {
+                    // The original read one frame past the end of the sample; stop at the end instead
+                    if ( THIS->sampleFrameIndex < sampleFrames ) {
+                        output[j][i] = THIS->beats[THIS->currentBeatIndex].velocity * sample[j][THIS->sampleFrameIndex];
+                    }
+                }
+            }
+            THIS->sampleFrameIndex++;
+            if ( THIS->sampleFrameIndex > sampleFrames ) {
+                THIS->sampleIsPlaying = false;
+            }
+        }
+
+        frameTimeNanoSeconds += THIS->nanoSecondsPerFrame;
+    }
+}
+
+static double benchmarkPerFrame(void) {
+    static per_frame_channel_t channels[kSequenceChannels];
+    double sequenceSeconds = 4 * 60.0 / kBPM;
+    for ( int i=0; i<kSequenceChannels; i++ ) {
+        channels[i] = (per_frame_channel_t) {
+            .beats = beats[i],
+            .numBeats = kSteps,
+            .currentBeatIndex = -1,
+            .nanoSecondsPerSequence = (uint64_t)(sequenceSeconds * 1.0e9),
+            .nanoSecondsPerFrame = (uint64_t)(1.0e9 / kSampleRate),
+        };
+    }
+
+    uint64_t blocks = (uint64_t)(kDuration * kSampleRate / kBlockFrames);
+    double start = TestCurrentTime();
+    for ( uint64_t block=0; block<blocks; block++ ) {
+        // The host time starts well clear of zero, which the loop takes to mean "not started"
+        uint64_t hostTime = (uint64_t)(1.0e9 + block * kBlockFrames * 1.0e9 / kSampleRate);
+        for ( int i=0; i<kSequenceChannels; i++ ) {
+            perFrameRender(&channels[i], hostTime, kBlockFrames);
+        }
+    }
+    return TestCurrentTime() - start;
+}
+
+#pragma mark - Engine
+
+static double benchmarkEngine(bool spans) {
+    AESequencerEngine *engines[kSequenceChannels];
+    double sequenceFrames = 4 * 60.0 / kBPM * kSampleRate;
+    for ( int i=0; i<kSequenceChannels; i++ ) {
+        engines[i] = AESequencerEngineNew((const float * const *)sample, kOutputChannels, sampleFrames, sequenceFrames);
+        TEST_ASSERT(engines[i] != NULL);
+        AESequencerEngineSetBeats(engines[i], beats[i], kSteps);
+    }
+
+    uint64_t blocks = (uint64_t)(kDuration * kSampleRate / kBlockFrames);
+    double position = 0;
+    float peak = 0;
+    double start = TestCurrentTime();
+    for ( uint64_t block=0; block<blocks; block++ ) {
+        for ( int i=0; i<kSequenceChannels; i++ ) {
+            if ( spans ) {
+                // As the arranger drives it, from a shared clock: one span per render, unless it crosses the loop point
+                uint32_t first = (uint32_t)fmin(kBlockFrames, ceil(sequenceFrames - position));
+                AESequencerEngineRenderSpan(engines[i], output, kOutputChannels, 0, first, position, sequenceFrames, beats[i], kSteps, true);
+                if ( first < kBlockFrames ) {
+                    AESequencerEngineRenderSpan(engines[i], output, kOutputChannels, first, kBlockFrames - first,
+                                                position + first - sequenceFrames, sequenceFrames, beats[i], kSteps, true);
+                }
+            } else {
+                AESequencerEngineRender(engines[i], output, kOutputChannels, kBlockFrames, true);
+            }
+        }
+        position = fmod(position + kBlockFrames, sequenceFrames);
+        for ( uint32_t i=0; i<kBlockFrames; i++ ) {
+            if ( outputBuffers[0][i] > peak ) peak = outputBuffers[0][i];
+        }
+    }
+    double seconds = TestCurrentTime() - start;
+
+    TEST_ASSERT(peak > 0);
+    for ( int i=0; i<kSequenceChannels; i++ ) {
+        AESequencerEngineFree(engines[i]);
+    }
+    return seconds;
+}
+
+static void report(const char *name, double seconds, double baseline) {
+    printf("  %-32s %6.3f s  %5.2f%% of real time", name, seconds, 100.0 * seconds / kDuration);
+    if ( baseline > 0 ) printf("  %4.1fx", baseline / seconds);
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    sampleFrames = (uint32_t)(kSampleDuration * kSampleRate);
+    for ( int channel=0; channel<kOutputChannels; channel++ ) {
+        sample[channel] = (float*)malloc(sampleFrames * sizeof(float));
+        for ( uint32_t i=0; i<sampleFrames; i++ ) {
+            sample[channel][i] = sinf(i * 0.05f) * expf(-(float)i / sampleFrames * 4.0f);
+        }
+    }
+
+    // Every channel plays all sixteen steps, at varying velocities
+    for ( int i=0; i<kSequenceChannels; i++ ) {
+        for ( int step=0; step<kSteps; step++ ) {
+            beats[i][step] = (AESequencerEngineBeat) { .onset = (float)step / kSteps, .velocity = 0.25f + 0.75f * ((i + step) % 4) / 3.0f };
+        }
+    }
+
+    printf("%d channels x %d steps, %d-channel output, %d-frame buffers, %.0f s of audio at %.0f BPM\n",
+           kSequenceChannels, kSteps, kOutputChannels, kBlockFrames, kDuration, kBPM);
+    double baseline = benchmarkPerFrame();
+    report("Per-frame loop", baseline, 0);
+    report("AESequencerEngineRender", benchmarkEngine(false), baseline);
+    report("AESequencerEngineRenderSpan", benchmarkEngine(true), baseline);
+
+    for ( int channel=0; channel<kOutputChannels; channel++ ) {
+        free(sample[channel]);
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,174 @@
+//
+//  AEStemRecorderBenchmark.m
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Benchmark for AEStemRecorder: records 64 stereo stems at 96 kHz, in real time, to separate
+//  files and to one multichannel file, and reports the writer thread's CPU time against the
+//  duration of audio recorded. The render side is driven directly through the recorder's
+//  callbacks, with a stand-in for the audio controller. macOS only.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+#import "AEStemRecorder.h"
+#import "AEUtilities.h"
+#include "TestSupport.h"
+#include <mach/mach.h>
+#include <unistd.h>
+
+static const double kSampleRate = 96000.0;
+static const int    kStemCount = AEStemRecorderMaximumStems;
+static const UInt32 kBlockFrames = 512;
+static const double kDuration = 10.0;
+static const UInt32 kBitDepth = 24;
+static const char * kWriterThreadName = "com.theamazingaudioengine.AEStemRecorderWriterThread";
+
+// Just enough of an audio controller for the recorder to set itself up and tear itself down
+@interface AEStemRecorderBenchmarkController : NSObject
+@property (nonatomic, assign) AudioStreamBasicDescription audioDescription;
+@end
+
+@implementation AEStemRecorderBenchmarkController
+- (void)addTimingReceiver:(id)receiver completionBlock:(void(^)(void))block {}
+- (void)removeTimingReceiver:(id)receiver completionBlock:(void(^)(void))block {}
+- (void)addOutputReceiver:(id)receiver forChannel:(id)channel completionBlock:(void(^)(void))block {}
+- (void)removeOutputReceiver:(id)receiver fromChannel:(id)channel completionBlock:(void(^)(void))block {}
+- (BOOL)performSynchronousMessageExchangeWithBlock:(void (^)(void))block {
+    block();
+    return YES;
+}
+@end
+
+static double writerThreadCPUTime(void) {
+    thread_act_array_t threads;
+    mach_msg_type_number_t threadCount;
+    if ( task_threads(mach_task_self(), &threads, &threadCount) != KERN_SUCCESS ) return -1.0;
+
+    double seconds = -1.0;
+    for ( mach_msg_type_number_t i=0; i<threadCount; i++ ) {
+        thread_extended_info_data_t info;
+        mach_msg_type_number_t infoCount = THREAD_EXTENDED_INFO_COUNT;
+        if ( thread_info(threads[i], THREAD_EXTENDED_INFO, (thread_info_t)&info, &infoCount) == KERN_SUCCESS
+                && strcmp(info.pth_name, kWriterThreadName) == 0 ) {
+            seconds = (info.pth_user_time + info.pth_system_time) * 1.0e-9;
+        }
+        mach_port_deallocate(mach_task_self(), threads[i]);
+    }
+    vm_deallocate(mach_task_self(), (vm_address_t)threads, threadCount * sizeof(thread_act_t));
+    return seconds;
+}
+
+static void benchmark(const char *name, BOOL multichannel) {
+    AudioStreamBasicDescription format = AEAudioStreamBasicDescriptionNonInterleavedFloatStereo;
+    format.mSampleRate = kSampleRate;
+    AEStemRecorderBenchmarkController *controller = [[AEStemRecorderBenchmarkController alloc] init];
+    controller.audioDescription = format;
+
+    AEStemRecorder *recorder = [[AEStemRecorder alloc] initWithAudioController:(AEAudioController*)controller];
+    NSMutableArray *channels = [NSMutableArray array];
+    for ( int i=0; i<kStemCount; i++ ) {
+        id channel = [[NSObject alloc] init];
+        [channels addObject:channel];
+        TEST_ASSERT([recorder addStemForChannel:(id<AEAudioPlayable>)channel] == i);
+    }
+
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"AEStemRecorderBenchmark"];
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+
+    NSError *error = nil;
+    BOOL began;
+    if ( multichannel ) {
+        began = [recorder beginRecordingToMultichannelFileAtPath:[directory stringByAppendingPathComponent:@"Stems.caf"]
+                                                        fileType:kAudioFileCAFType bitDepth:kBitDepth error:&error];
+    } else {
+        NSMutableArray *paths = [NSMutableArray array];
+        for ( int i=0; i<kStemCount; i++ ) {
+            [paths addObject:[directory stringByAppendingPathComponent:[NSString stringWithFormat:@"Stem %02d.caf", i]]];
+        }
+        began = [recorder beginRecordingToFilesAtPaths:paths fileType:kAudioFileCAFType bitDepth:kBitDepth error:&error];
+    }
+    TEST_ASSERT_MESSAGE(began, "%s", error.localizedDescription.UTF8String);
+
+    AudioBufferList *audio = AEAudioBufferListCreate(format, kBlockFrames);
+    for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+        float *samples = (float*)audio->mBuffers[i].mData;
+        for ( UInt32 frame=0; frame<kBlockFrames; frame++ ) samples[frame] = 0.5f * sinf(2.0f * M_PI * 440.0f * frame / kSampleRate);
+    }
+
+    AEAudioTimingCallback timingCallback = recorder.timingReceiverCallback;
+    AEAudioReceiverCallback receiverCallback = recorder.receiverCallback;
+    AudioTimeStamp timestamp = {
+        .mFlags = kAudioTimeStampHostTimeValid | kAudioTimeStampSampleTimeValid,
+        .mHostTime = AECurrentTimeInHostTicks(),
+    };
+
+    // Render in real time, as the audio thread would
+    const int cycles = (int)(kDuration * kSampleRate / kBlockFrames);
+    const double cycleDuration = kBlockFrames / kSampleRate;
+    double start = TestCurrentTime();
+    double renderTime = 0.0, longestCycle = 0.0;
+    for ( int cycle=0; cycle<cycles; cycle++ ) {
+        double before = TestCurrentTime();
+        timingCallback(recorder, (AEAudioController*)controller, &timestamp, kBlockFrames, AEAudioTimingContextOutput);
+        for ( int i=0; i<kStemCount; i++ ) {
+            receiverCallback(recorder, (AEAudioController*)controller, (__bridge void*)channels[i], &timestamp, kBlockFrames, audio);
+        }
+        double duration = TestCurrentTime() - before;
+        renderTime += duration;
+        if ( duration > longestCycle ) longestCycle = duration;
+
+        timestamp.mSampleTime += kBlockFrames;
+        timestamp.mHostTime += AEHostTicksFromSeconds(cycleDuration);
+        double next = start + (cycle+1) * cycleDuration;
+        double now = TestCurrentTime();
+        if ( next > now ) usleep((useconds_t)((next - now) * 1.0e6));
+    }
+
+    // Give the writer one more poll to catch up, then see how hard it worked
+    [NSThread sleepForTimeInterval:0.05];
+    double writerTime = writerThreadCPUTime();
+    TEST_ASSERT_MESSAGE(writerTime >= 0.0, "couldn't find the writer thread");
+    [recorder finishRecording];
+    TEST_ASSERT_MESSAGE(recorder.error == nil, "%s", recorder.error.localizedDescription.UTF8String);
+
+    double recorded = cycles * cycleDuration;
+    double megabytes = recorded * kSampleRate * kStemCount * format.mChannelsPerFrame * (kBitDepth / 8) / 1.0e6;
+    printf("  %-20s writer %5.2f s CPU for %.0f s of audio (%5.1f%% of one core, %.0f MB/s); "
+           "render %.1f us per cycle, longest %.1f us; %u cycles dropped\n",
+           name, writerTime, recorded, 100.0 * writerTime / recorded, megabytes / recorded,
+           1.0e6 * renderTime / cycles, 1.0e6 * longestCycle, (unsigned int)recorder.overflowCount);
+
+    AEAudioBufferListFree(audio);
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+}
+
+int main(int argc, char *argv[]) {
+    @autoreleasepool {
+        printf("%d stereo stems, %.0f kHz, %u-bit, %u-frame cycles\n", kStemCount, kSampleRate / 1000.0, kBitDepth, kBlockFrames);
+        benchmark("Separate files", NO);
+        benchmark("Multichannel file", YES);
+    }
+    return TEST_RESULT();
+}
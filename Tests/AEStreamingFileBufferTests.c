@@ -0,0 +1,288 @@
+//
+//  AEStreamingFileBufferTests.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Tests AEStreamingFileBuffer against WAV files read with AEPCMFile: continuous playback,
+//  glitch-free looping, seeking, end of stream, and underrun accounting.
+//
+
+#include "AEStreamingFileBuffer.h"
+#include "AEPCMFile.h"
+#include "TestSupport.h"
+#include <pthread.h>
+#include <unistd.h>
+
+static const double   kSampleRate   = 44100.0;
+static const uint32_t kChannels     = 2;
+static const uint32_t kFileFrames   = 200000;
+static const uint32_t kRenderFrames = 256;
+
+typedef struct {
+    AEPCMFile  *file;
+    int         seeks;
+    int         reads;
+    useconds_t  readDelay;
+} file_source_t;
+
+static int sourceSeek(void *context, int64_t frame) {
+    file_source_t *source = (file_source_t*)context;
+    source->seeks++;
+    return AEPCMFileSeek(source->file, (uint64_t)frame);
+}
+
+static int sourceRead(void *context, void * const *buffers, uint32_t frames, uint32_t *outFrames) {
+    file_source_t *source = (file_source_t*)context;
+    source->reads++;
+    if ( source->readDelay ) usleep(source->readDelay);
+    return AEPCMFileReadFloat(source->file, (float * const *)buffers, kChannels, frames, outFrames);
+}
+
+// Each sample encodes its frame index exactly; the right channel is negated
+static float sampleForFrame(int64_t frame) {
+    return (float)(frame & 0xFFFFF) / 1048576.0f;
+}
+
+static void writeTestFile(const char *path) {
+    AEPCMFileFormat format = { .sampleRate = kSampleRate, .channels = kChannels, .bitsPerSample = 32, .isFloat = true };
+    AEPCMFile *file = AEPCMFileCreate(path, AEPCMFileTypeWAV, &format, kFileFrames, NULL);
+    TEST_ASSERT(file != NULL);
+    float left[4096], right[4096];
+    const float *buffers[2] = { left, right };
+    for ( uint32_t frame=0; frame<kFileFrames; frame+=4096 ) {
+        uint32_t count = kFileFrames - frame < 4096 ? kFileFrames - frame : 4096;
+        for ( uint32_t i=0; i<count; i++ ) {
+            left[i] = sampleForFrame(frame + i);
+            right[i] = -left[i];
+        }
+        TEST_ASSERT(AEPCMFileWriteFloat(file, buffers, kChannels, count) == 0);
+    }
+    TEST_ASSERT(AEPCMFileClose(file) == 0);
+}
+
+static AEStreamingFileBuffer *openBuffer(const char *path, file_source_t *source, uint32_t bufferFrames) {
+    memset(source, 0, sizeof(*source));
+    source->file = AEPCMFileOpen(path, NULL);
+    TEST_ASSERT(source->file != NULL);
+    AEStreamingFileSource streamSource = { .seek = sourceSeek, .read = sourceRead, .context = source };
+    AEStreamingFileBuffer *buffer = AEStreamingFileBufferNew(streamSource, (int64_t)AEPCMFileGetLength(source->file),
+                                                             kChannels, sizeof(float), bufferFrames, bufferFrames / 2);
+    TEST_ASSERT(buffer != NULL);
+    return buffer;
+}
+
+static void closeBuffer(AEStreamingFileBuffer *buffer, file_source_t *source) {
+    AEStreamingFileBufferFree(buffer);
+    AEPCMFileClose(source->file);
+}
+
+// Render a cycle, checking the audio continues from the expected frame; returns frames rendered
+static uint32_t renderAndCheck(AEStreamingFileBuffer *buffer, int64_t *expected, int64_t regionStart, int64_t regionEnd, bool *outFinished) {
+    float left[kRenderFrames], right[kRenderFrames];
+    void *buffers[2] = { left, right };
+    uint32_t frames = AEStreamingFileBufferRead(buffer, buffers, kRenderFrames, outFinished);
+    for ( uint32_t i=0; i<frames; i++ ) {
+        if ( *expected >= regionEnd ) *expected = regionStart;
+        TEST_ASSERT_MESSAGE(left[i] == sampleForFrame(*expected) && right[i] == -sampleForFrame(*expected),
+                            "expected frame %lld, got sample %f", (long long)*expected, left[i]);
+        (*expected)++;
+    }
+    return frames;
+}
+
+static void testContinuousPlayback(const char *path) {
+    file_source_t source;
+    AEStreamingFileBuffer *buffer = openBuffer(path, &source, 16384);
+
+    // Nothing is decoded before the I/O thread first runs
+    TEST_ASSERT(source.reads == 0);
+
+    int64_t expected = 0;
+    bool finished = false;
+    while ( !finished ) {
+        AEStreamingFileBufferService(buffer);
+        renderAndCheck(buffer, &expected, 0, kFileFrames, &finished);
+    }
+    TEST_ASSERT(expected == kFileFrames);
+    TEST_ASSERT(AEStreamingFileBufferGetPlayhead(buffer) == kFileFrames);
+    TEST_ASSERT(AEStreamingFileBufferGetUnderrunCount(buffer) == 0);
+
+    closeBuffer(buffer, &source);
+}
+
+static void testLooping(const char *path) {
+    file_source_t source;
+    AEStreamingFileBuffer *buffer = openBuffer(path, &source, 16384);
+
+    // An odd-sized region, so the loop point falls mid-chunk and mid-render
+    const int64_t regionStart = 1001, regionEnd = 1001 + 30011;
+    AEStreamingFileBufferSetRegion(buffer, regionStart, regionEnd, true);
+
+    int64_t expected = regionStart;
+    bool finished = false;
+    for ( int i=0; i<(int)((regionEnd - regionStart) * 5 / kRenderFrames); i++ ) {
+        AEStreamingFileBufferService(buffer);
+        TEST_ASSERT(renderAndCheck(buffer, &expected, regionStart, regionEnd, &finished) == kRenderFrames);
+        TEST_ASSERT(!finished);
+    }
+    TEST_ASSERT(AEStreamingFileBufferGetUnderrunCount(buffer) == 0);
+
+    // The loop head comes from memory: after the first pass, the source is only ever
+    // sought to where the loop head ends
+    TEST_ASSERT_MESSAGE(source.seeks <= 6, "%d seeks", source.seeks);
+
+    closeBuffer(buffer, &source);
+}
+
+static void testSeek(const char *path) {
+    file_source_t source;
+    AEStreamingFileBuffer *buffer = openBuffer(path, &source, 16384);
+
+    int64_t expected = 0;
+    bool finished;
+    AEStreamingFileBufferService(buffer);
+    renderAndCheck(buffer, &expected, 0, kFileFrames, &finished);
+
+    // Audio buffered before the seek is dropped, and playback resumes from the new position
+    AEStreamingFileBufferSeek(buffer, 123457);
+    TEST_ASSERT(AEStreamingFileBufferGetPlayhead(buffer) == 123457);
+    AEStreamingFileBufferService(buffer);
+    expected = 123457;
+    TEST_ASSERT(renderAndCheck(buffer, &expected, 0, kFileFrames, &finished) == kRenderFrames);
+    TEST_ASSERT(AEStreamingFileBufferGetPlayhead(buffer) == 123457 + kRenderFrames);
+
+    // Play out to the end
+    while ( !finished ) {
+        AEStreamingFileBufferService(buffer);
+        renderAndCheck(buffer, &expected, 0, kFileFrames, &finished);
+    }
+    TEST_ASSERT(expected == kFileFrames);
+
+    // A region that ends early, without looping
+    AEStreamingFileBufferSetRegion(buffer, 5000, 6000, false);
+    expected = 5000;
+    finished = false;
+    while ( !finished ) {
+        AEStreamingFileBufferService(buffer);
+        renderAndCheck(buffer, &expected, 5000, 6000, &finished);
+    }
+    TEST_ASSERT(expected == 6000);
+    TEST_ASSERT(AEStreamingFileBufferGetUnderrunCount(buffer) == 0);
+
+    closeBuffer(buffer, &source);
+}
+
+static void testUnderruns(const char *path) {
+    file_source_t source;
+    AEStreamingFileBuffer *buffer = openBuffer(path, &source, 8192);
+
+    // Rendering before the I/O thread has run counts as an underrun
+    int64_t expected = 0;
+    bool finished;
+    TEST_ASSERT(renderAndCheck(buffer, &expected, 0, kFileFrames, &finished) == 0);
+    TEST_ASSERT(AEStreamingFileBufferGetUnderrunCount(buffer) == 1);
+    TEST_ASSERT(AEStreamingFileBufferGetUnderrunFrameCount(buffer) == kRenderFrames);
+
+    // Drain what one service buffers, then run dry part way through a cycle
+    AEStreamingFileBufferService(buffer);
+    uint32_t total = 0, frames;
+    while ( (frames = renderAndCheck(buffer, &expected, 0, kFileFrames, &finished)) == kRenderFrames ) {
+        total += frames;
+    }
+    total += frames;
+    TEST_ASSERT(!finished);
+    TEST_ASSERT(AEStreamingFileBufferGetUnderrunCount(buffer) == 2);
+    TEST_ASSERT(AEStreamingFileBufferGetUnderrunFrameCount(buffer) == kRenderFrames + (kRenderFrames - frames));
+
+    // Playback carries on seamlessly once the I/O thread catches up
+    AEStreamingFileBufferService(buffer);
+    TEST_ASSERT(renderAndCheck(buffer, &expected, 0, kFileFrames, &finished) == kRenderFrames);
+    TEST_ASSERT(expected == total + kRenderFrames);
+
+    closeBuffer(buffer, &source);
+}
+
+typedef struct {
+    AEStreamingFileBuffer *buffer;
+    volatile bool          done;
+} io_thread_t;
+
+static void *ioThread(void *userInfo) {
+    io_thread_t *thread = (io_thread_t*)userInfo;
+    while ( !thread->done ) {
+        AEStreamingFileBufferService(thread->buffer);
+        usleep(1000);
+    }
+    return NULL;
+}
+
+static void testThreaded(const char *path, useconds_t readDelay, bool expectUnderruns) {
+    file_source_t source;
+    AEStreamingFileBuffer *buffer = openBuffer(path, &source, 32768);
+    source.readDelay = readDelay;
+    AEStreamingFileBufferSetRegion(buffer, 0, kFileFrames, true);
+
+    io_thread_t thread = { .buffer = buffer };
+    pthread_t threadId;
+    pthread_create(&threadId, NULL, ioThread, &thread);
+
+    // Let the I/O thread prime the buffer, then render at four times real time while seeking now and then
+    usleep(20000);
+    int64_t expected = 0;
+    bool finished;
+    for ( int cycle=0; cycle<4000; cycle++ ) {
+        if ( cycle % 1000 == 999 ) {
+            AEStreamingFileBufferSeek(buffer, 50000);
+            expected = 50000;
+            usleep(20000);
+        }
+        renderAndCheck(buffer, &expected, 0, kFileFrames, &finished);
+        usleep((useconds_t)(kRenderFrames / kSampleRate / 4.0 * 1.0e6));
+    }
+
+    thread.done = true;
+    pthread_join(threadId, NULL);
+
+    uint64_t underruns = AEStreamingFileBufferGetUnderrunCount(buffer);
+    printf("  read delay %uus: %llu underruns, %llu frames\n", (unsigned)readDelay, (unsigned long long)underruns,
+           (unsigned long long)AEStreamingFileBufferGetUnderrunFrameCount(buffer));
+    TEST_ASSERT(expectUnderruns ? underruns > 0 : underruns == 0);
+
+    closeBuffer(buffer, &source);
+}
+
+int main(int argc, char *argv[]) {
+    char path[] = "/tmp/AEStreamingFileBufferTests-XXXXXX.wav";
+    close(mkstemps(path, 4));
+    writeTestFile(path);
+
+    TEST_RUN(testContinuousPlayback(path));
+    TEST_RUN(testLooping(path));
+    TEST_RUN(testSeek(path));
+    TEST_RUN(testUnderruns(path));
+    TEST_RUN(testThreaded(path, 0, false));
+    TEST_RUN(testThreaded(path, 30000, true));   // A disk slower than playback
+
+    unlink(path);
+    return TEST_RESULT();
+}
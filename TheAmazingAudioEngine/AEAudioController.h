@@ -515,6 +515,85 @@ typedef enum {
         AEAudioControllerOptionEnableOutput | AEAudioControllerOptionAllowMixingWithOtherApps,
 } AEAudioControllerOptions;
 
+/*!
+ * Number of buckets in the render load histogram
+ *
+ *  See @link AEAudioControllerRenderStatistics @endlink.
+ */
+#define AEAudioControllerRenderLoadHistogramBucketCount 50
+
+/*!
+ * Render performance statistics
+ *
+ *  Render load is the time taken to render one cycle, as a fraction of the buffer
+ *  duration: a load of 1.0 or more means the render deadline was missed.
+ *
+ *  Loads are accumulated into a histogram with logarithmically-spaced buckets, four per
+ *  octave, covering loads from 2^-12 to 2^0 and beyond. Bucket 0 holds all loads below
+ *  2^-12, and the last bucket holds all loads of 2^0 and above. Use
+ *  @link AEAudioControllerRenderLoadForHistogramBucket @endlink to find the lower bound
+ *  of a bucket.
+ *
+ *  See @link AEAudioController::renderStatistics renderStatistics @endlink.
+ */
+typedef struct {
+    UInt64 cycles;          //!< Number of render cycles measured
+    UInt64 overloads;       //!< Number of cycles which exceeded the buffer duration
+    UInt64 discontinuities; //!< Number of gaps in the output timeline (dropped buffers, or an engine restart)
+    double duration;        //!< Span of time covered by these statistics, in seconds
+    float meanLoad;         //!< Mean render load
+    float maxLoad;          //!< Maximum render load
+    float p99Load;          //!< 99th percentile render load (upper bound of the containing bucket)
+    float p999Load;         //!< 99.9th percentile render load (upper bound of the containing bucket)
+    UInt64 histogram[AEAudioControllerRenderLoadHistogramBucketCount]; //!< Number of cycles per load bucket
+} AEAudioControllerRenderStatistics;
+
+/*!
+ * Get the lower bound of a render load histogram bucket
+ *
+ * @param bucket The bucket index
+ * @return The lowest render load that falls into that bucket
+ */
+float AEAudioControllerRenderLoadForHistogramBucket(int bucket);
+
+/*!
+ * Maximum number of nodes that can be profiled
+ *
+ *  See @link AEAudioController::nodeProfilingEnabled nodeProfilingEnabled @endlink.
+ */
+#define AEAudioControllerMaximumProfiledNodes 512
+
+/*!
+ * Profiled node types
+ */
+typedef enum {
+    AEAudioControllerProfiledNodeTypeChannel,       //!< An AEAudioPlayable's render callback
+    AEAudioControllerProfiledNodeTypeChannelGroup,  //!< A channel group's mixer, excluding its channels
+    AEAudioControllerProfiledNodeTypeFilter,        //!< An AEAudioFilter on a channel or channel group
+    AEAudioControllerProfiledNodeTypeReceiver,      //!< An AEAudioReceiver on a channel or channel group
+    AEAudioControllerProfiledNodeTypeInputFilter,   //!< An AEAudioFilter on the audio input
+    AEAudioControllerProfiledNodeTypeInputReceiver, //!< An AEAudioReceiver on the audio input
+} AEAudioControllerProfiledNodeType;
+
+/*!
+ * Profile of one node in the render graph
+ *
+ *  Times are exclusive: a filter's time does not include the upstream render it pulls, and a
+ *  channel group's time does not include its channels.
+ *
+ *  See @link AEAudioController::getNodeProfiles:count: getNodeProfiles:count: @endlink.
+ */
+typedef struct {
+    const void *node;                   //!< The node: the channel, filter or receiver object, or the AEChannelGroupRef
+    __unsafe_unretained Class nodeClass;//!< The node's class, or Nil for channel groups
+    AEAudioControllerProfiledNodeType type; //!< The node type
+    UInt64 invocations;                 //!< Number of times the node was called
+    NSTimeInterval totalTime;           //!< Total time spent in the node, in seconds
+    NSTimeInterval maxTime;             //!< Longest single invocation, in seconds
+    float share;                        //!< Fraction of all profiled time spent in this node
+    float load;                         //!< Fraction of real time spent in this node
+} AEAudioControllerNodeProfile;
+
 /*!
  * Main controller class
  *
@@ -1359,6 +1438,79 @@ void AEAudioControllerSendAsynchronousMessageToMainThread(__unsafe_unretained AE
  */
 - (void)inputAveragePowerLevels:(Float32*)averagePowers peakHoldLevels:(Float32*)peakLevels channelCount:(UInt32)count;
 
+///@}
+#pragma mark - Render performance
+/** @name Render performance */
+///@{
+
+/*!
+ * Render statistics for the most recently completed window
+ *
+ *  The audio controller continuously measures the time taken by each render cycle, at the
+ *  cost of two timestamp reads per cycle. Statistics are accumulated over consecutive windows
+ *  of @link renderStatisticsWindowDuration @endlink seconds; this returns the most recently
+ *  completed window. It may be called from any thread, and does not disturb the render thread.
+ *
+ *  When output is enabled, a cycle is one render of the output unit, which includes input
+ *  processing when input and output share an audio unit. When output is disabled, a cycle
+ *  is one input cycle.
+ */
+@property (nonatomic, readonly) AEAudioControllerRenderStatistics renderStatistics;
+
+/*!
+ * Render statistics accumulated since the audio controller was created, or since the last
+ * call to @link resetRenderStatistics @endlink
+ *
+ *  May be called from any thread.
+ */
+@property (nonatomic, readonly) AEAudioControllerRenderStatistics cumulativeRenderStatistics;
+
+/*!
+ * Reset the cumulative render statistics
+ *
+ *  The statistics are cleared at the start of the next render cycle.
+ */
+- (void)resetRenderStatistics;
+
+/*!
+ * Duration of the window over which rolling render statistics are gathered, in seconds
+ *
+ *  Default is 10 seconds.
+ */
+@property (nonatomic, assign) NSTimeInterval renderStatisticsWindowDuration;
+
+/*!
+ * Whether to profile the time spent in each channel, channel group, filter and receiver
+ *
+ *  When enabled, each callback invocation is timestamped on the way in and out, and the
+ *  time accumulated into a preallocated slot for that node. Use
+ *  @link getNodeProfiles:count: @endlink to obtain a ranked breakdown. When disabled, the
+ *  cost is a single flag test per callback.
+ *
+ *  Enabling profiling resets the accumulated profiles. Default is NO.
+ */
+@property (nonatomic, assign) BOOL nodeProfilingEnabled;
+
+/*!
+ * Get the accumulated node profiles, most expensive first
+ *
+ *  May be called from any thread. Nodes are identified by address only, and may since
+ *  have been removed from the audio controller; do not message the node pointer unless
+ *  you know it is still alive.
+ *
+ * @param profiles Array to fill with profiles
+ * @param count Capacity of the array; up to @link AEAudioControllerMaximumProfiledNodes @endlink
+ * @return Number of profiles written
+ */
+- (NSUInteger)getNodeProfiles:(AEAudioControllerNodeProfile*)profiles count:(NSUInteger)count;
+
+/*!
+ * Clear the accumulated node profiles
+ *
+ *  The profiles are cleared at the start of the next render cycle.
+ */
+- (void)resetNodeProfiles;
+
 ///@}
 #pragma mark - Utilities
 /** @name Utilities */
@@ -1374,6 +1526,24 @@ AudioStreamBasicDescription *AEAudioControllerAudioDescription(__unsafe_unretain
  */
 AudioStreamBasicDescription *AEAudioControllerInputAudioDescription(__unsafe_unretained AEAudioController *audioController);
 
+/*!
+ * Determine whether this render cycle's input was received before output rendered
+ *
+ *  When input and output share one audio unit, the controller services input at the start
+ *  of each render cycle, so receivers have this cycle's audio before any channel renders.
+ *  The audio buffers passed to receivers remain valid until the output render finishes,
+ *  so a channel may play them directly, without buffering them for the next cycle.
+ *
+ *  Returns NO when input is serviced separately, such as when output is disabled, or on
+ *  OS X, where input arrives on its own thread. Use from the realtime thread only.
+ *
+ * @param audioController The audio controller
+ * @param inputTimestamp If not NULL, a timestamp given to a receiver; returns NO unless it
+ *                       belongs to this render cycle's input
+ * @return YES if the current render cycle's input has already been delivered to receivers
+ */
+BOOL AEAudioControllerInputPrecedesOutput(__unsafe_unretained AEAudioController *audioController, const AudioTimeStamp *inputTimestamp);
+
 /*!
  * Convert a time span in seconds into a number of frames at the current sample rate
  */
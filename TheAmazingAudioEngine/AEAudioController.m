@@ -39,6 +39,8 @@
 #import "AEFloatConverter.h"
 #import "AEBlockChannel.h"
 #import <pthread.h>
+#import <objc/runtime.h>
+#import "AETraceRecorder.h"
 
 // Uncomment the following or define the following symbol as part of your build process to enable per-second performance reports
 // #define TAAE_REPORT_RENDER_TIME
@@ -51,6 +53,12 @@ static const int kScratchBufferFrames                  = kMaxFramesPerSlice;
 static const int kInputAudioBufferFrames               = kMaxFramesPerSlice;
 static const int kLevelMonitorScratchBufferSize        = kMaxFramesPerSlice;
 static const int kMaximumMonitoringChannels            = 16;
+static const int kRenderStatisticsWindowCount          = 3;
+static const NSTimeInterval kDefaultRenderStatisticsWindowDuration = 10.0;
+static const int kRenderLoadHistogramMinExponent       = -12;
+static const int kRenderLoadHistogramBucketsPerOctave  = 4;
+static const int kProfiledNodesPerContext              = AEAudioControllerMaximumProfiledNodes / 2;
+static const int kMaximumProfilerDepth                 = 32;
 #if TARGET_OS_IPHONE
 static const NSTimeInterval kMaxBufferDurationWithVPIO = 0.01;
 static const float kBoostForBuiltInMicInMeasurementMode= 4.0;
@@ -156,6 +164,72 @@ typedef struct __audio_level_monitor_t {
     BOOL                reset;
 } audio_level_monitor_t;
 
+/*!
+ * Render statistics, for one window of time
+ */
+typedef struct __render_statistics_window_t {
+    UInt64              cycles;
+    UInt64              overloads;
+    UInt64              discontinuities;
+    double              loadAccumulator;
+    float               maxLoad;
+    uint64_t            startTime;
+    uint64_t            endTime;
+    UInt64              histogram[AEAudioControllerRenderLoadHistogramBucketCount];
+} render_statistics_window_t;
+
+/*!
+ * Render statistics
+ *
+ *  Written only by the render thread. Windows rotate when full; readers use the
+ *  generation count (odd while rotating) to detect a rotation during a read. The
+ *  cumulative window changes every cycle, so it has its own generation count, odd
+ *  while it's being updated.
+ */
+typedef struct __render_statistics_t {
+    render_statistics_window_t cumulative;
+    volatile int32_t    cumulativeGeneration;
+    render_statistics_window_t windows[kRenderStatisticsWindowCount];
+    volatile int32_t    currentWindow;
+    volatile int32_t    generation;
+    uint64_t            windowDuration;
+    Float64             nextSampleTime;
+    BOOL                discontinuity;
+    BOOL                reset;
+} render_statistics_t;
+
+/*!
+ * Node profile slot
+ */
+typedef struct __node_profile_t {
+    const void * volatile node;
+    __unsafe_unretained Class nodeClass;
+    AEAudioControllerProfiledNodeType type;
+    UInt64              invocations;
+    uint64_t            totalTime;
+    uint64_t            maxTime;
+} node_profile_t;
+
+/*!
+ * Node profiler, for one rendering thread
+ *
+ *  Slots are claimed and updated only by the rendering thread, using open addressing
+ *  on the node address. The stack tracks time spent in nested nodes, so that each node
+ *  is charged exclusive time only.
+ */
+typedef struct __node_profiler_t {
+    node_profile_t      nodes[kProfiledNodesPerContext];
+    int                 depth;
+    uint64_t            childTime[kMaximumProfilerDepth];
+    volatile int32_t    generation;
+    BOOL                reset;
+} node_profiler_t;
+
+enum {
+    kNodeProfilerContextOutput,
+    kNodeProfilerContextInput
+};
+
 /*!
  * Source types
  */
@@ -242,6 +316,8 @@ typedef struct _channel_group_t {
 #endif
     UInt32              _lastAvailableInputFrames;
     AudioTimeStamp      _lastInputBusTimeStamp;
+    BOOL                _inputPrecedesOutput;
+    AudioTimeStamp      _inputPrecedesOutputTimeStamp;
     AudioTimeStamp      _lastInputOrOutputBusTimeStamp;
 
     audio_level_monitor_t _inputLevelMonitorData;
@@ -252,11 +328,15 @@ typedef struct _channel_group_t {
 
     BOOL                _useHardwareSampleRate;
 
+    uint64_t            _renderStartTime[2];
+    uint64_t            _renderDuration[2];
+    render_statistics_t _renderStatistics;
+    node_profiler_t     _nodeProfilers[2];
+    BOOL                _nodeProfilingEnabled;
+    uint64_t            _nodeProfilingStartTime;
 #ifdef DEBUG
     uint64_t            _firstRenderTime;
     uint64_t            _lastReportTime;
-    uint64_t            _renderStartTime[2];
-    uint64_t            _renderDuration[2];
 #endif
 }
 
@@ -322,7 +402,10 @@ static OSStatus channelAudioProducer(void *userInfo, AudioBufferList *audio, UIn
                 // Run this filter
                 channel_producer_arg_t filterArg = *arg;
                 filterArg.nextFilterIndex = filterIndex+1;
-                return ((AEAudioFilterCallback)callback->callback)((__bridge id)callback->userInfo, (__bridge AEAudioController *)channel->audioController, &channelAudioProducer, (void*)&filterArg, &arg->timeStamp, *frames, audio);
+                uint64_t profileStartTime = nodeProfilerBegin(channel->audioController, kNodeProfilerContextOutput);
+                status = ((AEAudioFilterCallback)callback->callback)((__bridge id)callback->userInfo, (__bridge AEAudioController *)channel->audioController, &channelAudioProducer, (void*)&filterArg, &arg->timeStamp, *frames, audio);
+                if ( profileStartTime ) nodeProfilerEnd(channel->audioController, kNodeProfilerContextOutput, profileStartTime, callback->userInfo, AEAudioControllerProfiledNodeTypeFilter);
+                return status;
             }
             filterIndex++;
         }
@@ -336,14 +419,20 @@ static OSStatus channelAudioProducer(void *userInfo, AudioBufferList *audio, UIn
         AEAudioRenderCallback callback = (AEAudioRenderCallback) channel->ptr;
         __unsafe_unretained id<AEAudioPlayable> channelObj = (__bridge id<AEAudioPlayable>) channel->object;
         
+        uint64_t profileStartTime = nodeProfilerBegin(channel->audioController, kNodeProfilerContextOutput);
         status = callback(channelObj, (__bridge AEAudioController*)channel->audioController, &channel->timeStamp, *frames, audio);
+        if ( profileStartTime ) nodeProfilerEnd(channel->audioController, kNodeProfilerContextOutput, profileStartTime, channel->object, AEAudioControllerProfiledNodeTypeChannel);
         channel->timeStamp.mSampleTime += *frames;
         
     } else if ( channel->type == kChannelTypeGroup ) {
         AEChannelGroupRef group = (AEChannelGroupRef)channel->ptr;
         
         // Tell mixer/mixer's converter unit to render into audio
+        AETraceBegin("Channel group render");
+        uint64_t profileStartTime = nodeProfilerBegin(channel->audioController, kNodeProfilerContextOutput);
         status = AudioUnitRender(group->converterUnit ? group->converterUnit : group->mixerAudioUnit, arg->ioActionFlags, &arg->originalTimeStamp, 0, *frames, audio);
+        if ( profileStartTime ) nodeProfilerEnd(channel->audioController, kNodeProfilerContextOutput, profileStartTime, group, AEAudioControllerProfiledNodeTypeChannelGroup);
+        AETraceEnd("Channel group render");
         if ( !AECheckOSStatus(status, "AudioUnitRender") ) return status;
         
         if ( group->level_monitor_data.monitoringEnabled ) {
@@ -369,6 +458,8 @@ static OSStatus renderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioAct
         return noErr;
     }
     
+    AETraceBegin("renderCallback");
+    
     AudioTimeStamp timestamp = *inTimeStamp;
 #if TARGET_OS_IPHONE
     if ( THIS->_automaticLatencyManagement ) {
@@ -435,6 +526,8 @@ static OSStatus renderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioAct
         for ( int i=0; i<ioData->mNumberBuffers; i++ ) memset(ioData->mBuffers[i].mData, 0, ioData->mBuffers[i].mDataByteSize);
     }
     
+    AETraceEnd("renderCallback");
+    
     return result;
 }
 
@@ -458,7 +551,10 @@ static OSStatus inputAudioProducer(void *userInfo, AudioBufferList *audio, UInt3
                 // Run this filter
                 input_producer_arg_t filterArg = *arg;
                 filterArg.nextFilterIndex = filterIndex+1;
-                return ((AEAudioFilterCallback)callback->callback)((__bridge id)callback->userInfo, THIS, &inputAudioProducer, (void*)&filterArg, &arg->inTimeStamp, *frames, audio);
+                uint64_t profileStartTime = nodeProfilerBegin(arg->THIS, kNodeProfilerContextInput);
+                OSStatus status = ((AEAudioFilterCallback)callback->callback)((__bridge id)callback->userInfo, THIS, &inputAudioProducer, (void*)&filterArg, &arg->inTimeStamp, *frames, audio);
+                if ( profileStartTime ) nodeProfilerEnd(arg->THIS, kNodeProfilerContextInput, profileStartTime, callback->userInfo, AEAudioControllerProfiledNodeTypeInputFilter);
+                return status;
             }
             filterIndex++;
         }
@@ -546,6 +642,7 @@ static OSStatus topRenderNotifyCallback(void *inRefCon, AudioUnitRenderActionFla
         AEMessageQueueProcessMessagesOnRealtimeThread(THIS->_messageQueue);
         
         // Service input
+        THIS->_inputPrecedesOutput = NO;
 #if TARGET_OS_IPHONE
         if ( THIS->_inputEnabled ) {
             serviceAudioInput(THIS, inTimeStamp, &THIS->_lastInputBusTimeStamp, THIS->_lastAvailableInputFrames);
@@ -586,11 +683,18 @@ static void serviceAudioInput(__unsafe_unretained AEAudioController * THIS, cons
         return;
     }
     
-#ifdef DEBUG
-    if ( !THIS->_firstRenderTime ) THIS->_firstRenderTime = AECurrentTimeInHostTicks();
     THIS->_renderStartTime[1] = AECurrentTimeInHostTicks();
+#ifdef DEBUG
+    if ( !THIS->_firstRenderTime ) THIS->_firstRenderTime = THIS->_renderStartTime[1];
 #endif
     
+    AETraceBegin("serviceAudioInput");
+    
+    if ( !THIS->_outputEnabled ) {
+        // Input drives the render cycle, so watch its timeline for gaps
+        checkRenderTimeline(&THIS->_renderStatistics, inputBusTimeStamp, inNumberFrames);
+    }
+    
     AudioTimeStamp timestamp;
     
     BOOL useAudiobusReceiverPort = THIS->_audiobusReceiverPort && THIS->_usingAudiobusInput;
@@ -676,6 +780,10 @@ static void serviceAudioInput(__unsafe_unretained AEAudioController * THIS, cons
     }
     
     if ( result == noErr ) {
+        // Input serviced ahead of the output render stays valid until that render has finished
+        THIS->_inputPrecedesOutput = outputBusTimeStamp != NULL;
+        THIS->_inputPrecedesOutputTimeStamp = timestamp;
+        
         input_table_t *table = THIS->_inputTable;
         for ( int tableIndex = 0; tableIndex < table->count; tableIndex++ ) {
             input_entry_t *entry = &table->entries[tableIndex];
@@ -701,7 +809,9 @@ static void serviceAudioInput(__unsafe_unretained AEAudioController * THIS, cons
                 callback_t *callback = &entry->callbacks.callbacks[i];
                 if ( !(callback->flags & kReceiverFlag) ) continue;
                 
+                uint64_t profileStartTime = nodeProfilerBegin((__bridge void*)THIS, kNodeProfilerContextInput);
                 ((AEAudioReceiverCallback)callback->callback)((__bridge id)callback->userInfo, THIS, AEAudioSourceInput, &timestamp, inNumberFrames, audioBufferList);
+                if ( profileStartTime ) nodeProfilerEnd((__bridge void*)THIS, kNodeProfilerContextInput, profileStartTime, callback->userInfo, AEAudioControllerProfiledNodeTypeInputReceiver);
             }
         }
         
@@ -716,29 +826,40 @@ static void serviceAudioInput(__unsafe_unretained AEAudioController * THIS, cons
         AEMessageQueueProcessMessagesOnRealtimeThread(THIS->_messageQueue);
     }
     
-#ifdef DEBUG
+    AETraceEnd("serviceAudioInput");
+    
     uint64_t renderEndTime = AECurrentTimeInHostTicks();
     THIS->_renderDuration[1] = renderEndTime - THIS->_renderStartTime[1];
-#endif
+    
+    if ( !THIS->_outputEnabled ) {
+        recordRenderCycle(&THIS->_renderStatistics, THIS->_renderStartTime[1], renderEndTime, THIS->_currentBufferDuration);
+    }
 }
 
-#ifdef DEBUG
-
-// Performance monitoring in debug mode
+// Performance monitoring
 static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderActionFlags *ioActionFlags, const AudioTimeStamp *inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList *ioData) {
     
     __unsafe_unretained AEAudioController * THIS = (__bridge AEAudioController*)inRefCon;
     
     if ( inBusNumber == 0 && *ioActionFlags & kAudioUnitRenderAction_PreRender ) {
         // Remember the time we started rendering
-        if ( !THIS->_firstRenderTime ) THIS->_firstRenderTime = AECurrentTimeInHostTicks();
         THIS->_renderStartTime[0] = AECurrentTimeInHostTicks();
+#ifdef DEBUG
+        if ( !THIS->_firstRenderTime ) THIS->_firstRenderTime = THIS->_renderStartTime[0];
+#endif
+        checkRenderTimeline(&THIS->_renderStatistics, inTimeStamp, inNumberFrames);
+        AETraceBegin("Render cycle");
         
     } else if ( inBusNumber == 0 && *ioActionFlags & kAudioUnitRenderAction_PostRender ) {
         // Calculate total render duration
+        AETraceEnd("Render cycle");
         uint64_t renderEndTime = AECurrentTimeInHostTicks();
         THIS->_renderDuration[0] = renderEndTime - THIS->_renderStartTime[MIN(1, inBusNumber)];
         
+        recordRenderCycle(&THIS->_renderStatistics, THIS->_renderStartTime[0], renderEndTime, THIS->_currentBufferDuration);
+        
+#ifdef DEBUG
+
         if ( THIS->_renderDuration[0] && (!THIS->_inputEnabled || THIS->_renderDuration[1]) ) {
             // Got render duration for all buses
             uint64_t duration = THIS->_renderDuration[0] + THIS->_renderDuration[1];
@@ -771,13 +892,12 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
             }
 #endif
         }
+#endif
     }
     
     return noErr;
 }
 
-#endif
-
 #pragma mark - Setup and start/stop
 
 + (AudioStreamBasicDescription)interleaved16BitStereoAudioDescription {
@@ -868,6 +988,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     _inputTable = (input_table_t *)calloc(sizeof(input_table_t), 1);
     _inputTable->count = 1;
     _inputTable->entries = (input_entry_t*)calloc(sizeof(input_entry_t), 1);
+    self.renderStatisticsWindowDuration = kDefaultRenderStatisticsWindowDuration;
     
 #if TARGET_OS_IPHONE
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationDidBecomeActive:) name:UIApplicationDidBecomeActiveNotification object:nil];
@@ -1074,6 +1195,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     [_messageQueue startPolling];
     
     __audioThread = NULL;
+    _renderStatistics.nextSampleTime = 0;
     
     @synchronized ( self ) {
         status = AUGraphStart(_audioGraph);
@@ -1947,6 +2069,115 @@ void AEAudioControllerSendAsynchronousMessageToMainThread(__unsafe_unretained AE
     _inputLevelMonitorData.reset = YES;
 }
 
+#pragma mark - Render performance
+
+-(AEAudioControllerRenderStatistics)renderStatistics {
+    render_statistics_window_t window;
+    int32_t generation;
+    do {
+        generation = _renderStatistics.generation;
+        OSMemoryBarrier();
+        int index = (_renderStatistics.currentWindow + kRenderStatisticsWindowCount - 1) % kRenderStatisticsWindowCount;
+        memcpy(&window, &_renderStatistics.windows[index], sizeof(window));
+        OSMemoryBarrier();
+    } while ( (generation & 1) || generation != _renderStatistics.generation );
+    
+    return renderStatisticsFromWindow(&window);
+}
+
+-(AEAudioControllerRenderStatistics)cumulativeRenderStatistics {
+    render_statistics_window_t window;
+    int32_t generation;
+    do {
+        generation = _renderStatistics.cumulativeGeneration;
+        OSMemoryBarrier();
+        memcpy(&window, &_renderStatistics.cumulative, sizeof(window));
+        OSMemoryBarrier();
+    } while ( (generation & 1) || generation != _renderStatistics.cumulativeGeneration );
+    
+    return renderStatisticsFromWindow(&window);
+}
+
+- (void)resetRenderStatistics {
+    _renderStatistics.reset = YES;
+}
+
+-(void)setRenderStatisticsWindowDuration:(NSTimeInterval)renderStatisticsWindowDuration {
+    _renderStatisticsWindowDuration = renderStatisticsWindowDuration;
+    _renderStatistics.windowDuration = AEHostTicksFromSeconds(renderStatisticsWindowDuration);
+}
+
+-(void)setNodeProfilingEnabled:(BOOL)nodeProfilingEnabled {
+    if ( nodeProfilingEnabled && !_nodeProfilingEnabled ) {
+        [self resetNodeProfiles];
+    }
+    OSMemoryBarrier();
+    _nodeProfilingEnabled = nodeProfilingEnabled;
+}
+
+- (NSUInteger)getNodeProfiles:(AEAudioControllerNodeProfile*)profiles count:(NSUInteger)count {
+    NSUInteger capacity = MIN(count, AEAudioControllerMaximumProfiledNodes);
+    AEAudioControllerNodeProfile *all = malloc(sizeof(AEAudioControllerNodeProfile) * AEAudioControllerMaximumProfiledNodes);
+    NSUInteger found = 0;
+    NSTimeInterval totalTime = 0;
+    
+    for ( int context=0; context<2; context++ ) {
+        node_profiler_t *profiler = &_nodeProfilers[context];
+        NSUInteger contextStart = found;
+        int32_t generation;
+        do {
+            found = contextStart;
+            generation = profiler->generation;
+            OSMemoryBarrier();
+            for ( int i=0; i<kProfiledNodesPerContext; i++ ) {
+                node_profile_t *slot = &profiler->nodes[i];
+                if ( !slot->node ) continue;
+                OSMemoryBarrier();
+                all[found++] = (AEAudioControllerNodeProfile) {
+                    .node = slot->node,
+                    .nodeClass = slot->nodeClass,
+                    .type = slot->type,
+                    .invocations = slot->invocations,
+                    .totalTime = AESecondsFromHostTicks(slot->totalTime),
+                    .maxTime = AESecondsFromHostTicks(slot->maxTime)
+                };
+            }
+            OSMemoryBarrier();
+        } while ( (generation & 1) || generation != profiler->generation );
+    }
+    
+    for ( NSUInteger i=0; i<found; i++ ) {
+        totalTime += all[i].totalTime;
+    }
+    
+    NSTimeInterval elapsed = _nodeProfilingStartTime ? AESecondsFromHostTicks(AECurrentTimeInHostTicks() - _nodeProfilingStartTime) : 0;
+    for ( NSUInteger i=0; i<found; i++ ) {
+        all[i].share = totalTime > 0 ? all[i].totalTime / totalTime : 0;
+        all[i].load = elapsed > 0 ? all[i].totalTime / elapsed : 0;
+    }
+    
+    qsort(all, found, sizeof(AEAudioControllerNodeProfile), compareNodeProfiles);
+    
+    NSUInteger written = MIN(found, capacity);
+    memcpy(profiles, all, sizeof(AEAudioControllerNodeProfile) * written);
+    free(all);
+    return written;
+}
+
+- (void)resetNodeProfiles {
+    _nodeProfilingStartTime = AECurrentTimeInHostTicks();
+    _nodeProfilers[kNodeProfilerContextOutput].reset = YES;
+    _nodeProfilers[kNodeProfilerContextInput].reset = YES;
+}
+
+float AEAudioControllerRenderLoadForHistogramBucket(int bucket) {
+    if ( bucket <= 0 ) return 0.0;
+    if ( bucket >= AEAudioControllerRenderLoadHistogramBucketCount-1 ) return 1.0;
+    int exponent = kRenderLoadHistogramMinExponent + (bucket-1) / kRenderLoadHistogramBucketsPerOctave;
+    int subBucket = (bucket-1) % kRenderLoadHistogramBucketsPerOctave;
+    return ldexpf(1.0 + (float)subBucket / kRenderLoadHistogramBucketsPerOctave, exponent);
+}
+
 #pragma mark - Utilities
 
 AudioStreamBasicDescription *AEAudioControllerAudioDescription(__unsafe_unretained AEAudioController *THIS) {
@@ -1957,6 +2188,13 @@ AudioStreamBasicDescription *AEAudioControllerInputAudioDescription(__unsafe_unr
     return &THIS->_inputTable->entries[0].audioDescription;
 }
 
+BOOL AEAudioControllerInputPrecedesOutput(__unsafe_unretained AEAudioController *THIS, const AudioTimeStamp *inputTimestamp) {
+    if ( !THIS->_inputPrecedesOutput ) return NO;
+    return !inputTimestamp
+        || (inputTimestamp->mHostTime == THIS->_inputPrecedesOutputTimeStamp.mHostTime
+                && inputTimestamp->mSampleTime == THIS->_inputPrecedesOutputTimeStamp.mSampleTime);
+}
+
 long AEConvertSecondsToFrames(__unsafe_unretained AEAudioController *THIS, NSTimeInterval seconds) {
     return round(seconds * THIS->_audioDescription.mSampleRate);
 }
@@ -2701,10 +2939,8 @@ static void audioUnitStreamFormatChanged(void *inRefCon, AudioUnit inUnit, Audio
     result = AUGraphNodeInfo(_audioGraph, _ioNode, NULL, &_ioAudioUnit);
     if ( !AECheckOSStatus(result, "AUGraphNodeInfo") ) return NO;
 
-#ifdef DEBUG
     // Add a render notify to the top audio unit, for the purposes of performance profiling
     AECheckOSStatus(AudioUnitAddRenderNotify(_ioAudioUnit, &ioUnitRenderNotifyCallback, (__bridge void*)self), "AudioUnitAddRenderNotify");
-#endif
     
 #if !TARGET_OS_IPHONE
     if ( _inputEnabled ) {
@@ -4193,13 +4429,162 @@ static void handleCallbacksForChannel(AEChannelRef channel, const AudioTimeStamp
     for ( int i=0; i<channel->callbacks.count; i++ ) {
         callback_t *callback = &channel->callbacks.callbacks[i];
         if ( callback->flags & kReceiverFlag ) {
+            uint64_t profileStartTime = nodeProfilerBegin(channel->audioController, kNodeProfilerContextOutput);
             ((AEAudioReceiverCallback)callback->callback)((__bridge id)callback->userInfo, (__bridge AEAudioController*)channel->audioController, channel->ptr, inTimeStamp, inNumberFrames, ioData);
+            if ( profileStartTime ) nodeProfilerEnd(channel->audioController, kNodeProfilerContextOutput, profileStartTime, callback->userInfo, AEAudioControllerProfiledNodeTypeReceiver);
         }
     }
 }
 
 #pragma mark - Assorted helpers
 
+static inline int renderLoadHistogramBucket(float load) {
+    if ( load < ldexpf(1.0, kRenderLoadHistogramMinExponent) ) return 0;
+    if ( load >= 1.0 ) return AEAudioControllerRenderLoadHistogramBucketCount-1;
+    
+    // Take the octave from the float exponent, and linear sub-buckets from the top mantissa bits
+    union { float f; uint32_t i; } value = { .f = load };
+    int exponent = (int)((value.i >> 23) & 0xFF) - 127;
+    int subBucket = (value.i >> 21) & (kRenderLoadHistogramBucketsPerOctave-1);
+    return 1 + (exponent - kRenderLoadHistogramMinExponent) * kRenderLoadHistogramBucketsPerOctave + subBucket;
+}
+
+static inline void accumulateRenderCycle(render_statistics_window_t *window, uint64_t startTime, uint64_t endTime, float load, int bucket, BOOL discontinuity) {
+    if ( !window->startTime ) window->startTime = startTime;
+    window->endTime = endTime;
+    window->cycles++;
+    window->loadAccumulator += load;
+    window->histogram[bucket]++;
+    if ( load > window->maxLoad ) window->maxLoad = load;
+    if ( load >= 1.0 ) window->overloads++;
+    if ( discontinuity ) window->discontinuities++;
+}
+
+static void checkRenderTimeline(render_statistics_t *statistics, const AudioTimeStamp *timestamp, UInt32 frames) {
+    if ( !(timestamp->mFlags & kAudioTimeStampSampleTimeValid) ) return;
+    if ( statistics->nextSampleTime && fabs(timestamp->mSampleTime - statistics->nextSampleTime) >= 1.0 ) {
+        statistics->discontinuity = YES;
+    }
+    statistics->nextSampleTime = timestamp->mSampleTime + frames;
+}
+
+static void recordRenderCycle(render_statistics_t *statistics, uint64_t startTime, uint64_t endTime, NSTimeInterval bufferDuration) {
+    render_statistics_window_t *window = &statistics->windows[statistics->currentWindow];
+    if ( window->startTime && endTime - window->startTime >= statistics->windowDuration ) {
+        // Rotate to the next window, leaving this one readable as the most recently completed
+        int32_t nextWindow = (statistics->currentWindow + 1) % kRenderStatisticsWindowCount;
+        OSAtomicIncrement32Barrier(&statistics->generation);
+        memset(&statistics->windows[nextWindow], 0, sizeof(render_statistics_window_t));
+        statistics->currentWindow = nextWindow;
+        OSAtomicIncrement32Barrier(&statistics->generation);
+        window = &statistics->windows[nextWindow];
+    }
+    
+    float load = bufferDuration > 0 ? AESecondsFromHostTicks(endTime - startTime) / bufferDuration : 0;
+    int bucket = renderLoadHistogramBucket(load);
+    BOOL discontinuity = statistics->discontinuity;
+    statistics->discontinuity = NO;
+    
+    accumulateRenderCycle(window, startTime, endTime, load, bucket, discontinuity);
+    
+    OSAtomicIncrement32Barrier(&statistics->cumulativeGeneration);
+    if ( statistics->reset ) {
+        statistics->reset = NO;
+        memset(&statistics->cumulative, 0, sizeof(statistics->cumulative));
+    }
+    accumulateRenderCycle(&statistics->cumulative, startTime, endTime, load, bucket, discontinuity);
+    OSAtomicIncrement32Barrier(&statistics->cumulativeGeneration);
+}
+
+static uint64_t nodeProfilerBegin(void *audioController, int context) {
+    __unsafe_unretained AEAudioController *THIS = (__bridge AEAudioController*)audioController;
+    if ( !THIS->_nodeProfilingEnabled ) return 0;
+    
+    node_profiler_t *profiler = &THIS->_nodeProfilers[context];
+    if ( profiler->depth == 0 && profiler->reset ) {
+        profiler->reset = NO;
+        OSAtomicIncrement32Barrier(&profiler->generation);
+        memset(profiler->nodes, 0, sizeof(profiler->nodes));
+        OSAtomicIncrement32Barrier(&profiler->generation);
+    }
+    
+    if ( profiler->depth >= kMaximumProfilerDepth ) return 0;
+    profiler->childTime[profiler->depth++] = 0;
+    return AECurrentTimeInHostTicks();
+}
+
+static void nodeProfilerEnd(void *audioController, int context, uint64_t startTime, const void *node, AEAudioControllerProfiledNodeType type) {
+    __unsafe_unretained AEAudioController *THIS = (__bridge AEAudioController*)audioController;
+    node_profiler_t *profiler = &THIS->_nodeProfilers[context];
+    
+    uint64_t elapsed = AECurrentTimeInHostTicks() - startTime;
+    profiler->depth--;
+    uint64_t exclusive = elapsed - MIN(elapsed, profiler->childTime[profiler->depth]);
+    if ( profiler->depth > 0 ) {
+        profiler->childTime[profiler->depth-1] += elapsed;
+    }
+    
+    // Find or claim this node's slot
+    int index = (int)(((uintptr_t)node >> 4) ^ type) & (kProfiledNodesPerContext-1);
+    node_profile_t *slot = NULL;
+    for ( int probe=0; probe<kProfiledNodesPerContext; probe++ ) {
+        node_profile_t *candidate = &profiler->nodes[(index + probe) & (kProfiledNodesPerContext-1)];
+        if ( candidate->node == node && candidate->type == type ) {
+            slot = candidate;
+            break;
+        }
+        if ( !candidate->node ) {
+            candidate->type = type;
+            candidate->nodeClass = type == AEAudioControllerProfiledNodeTypeChannelGroup ? Nil : object_getClass((__bridge id)node);
+            OSMemoryBarrier();
+            candidate->node = node;
+            slot = candidate;
+            break;
+        }
+    }
+    if ( !slot ) return;
+    
+    slot->invocations++;
+    slot->totalTime += exclusive;
+    if ( exclusive > slot->maxTime ) slot->maxTime = exclusive;
+}
+
+static int compareNodeProfiles(const void *a, const void *b) {
+    NSTimeInterval timeA = ((const AEAudioControllerNodeProfile*)a)->totalTime;
+    NSTimeInterval timeB = ((const AEAudioControllerNodeProfile*)b)->totalTime;
+    return timeA > timeB ? -1 : timeA < timeB ? 1 : 0;
+}
+
+static float renderLoadPercentile(const render_statistics_window_t *window, double percentile) {
+    if ( !window->cycles ) return 0.0;
+    UInt64 threshold = (UInt64)ceil(window->cycles * percentile);
+    UInt64 count = 0;
+    for ( int i=0; i<AEAudioControllerRenderLoadHistogramBucketCount; i++ ) {
+        count += window->histogram[i];
+        if ( count >= threshold ) {
+            return i+1 < AEAudioControllerRenderLoadHistogramBucketCount
+                ? MIN(AEAudioControllerRenderLoadForHistogramBucket(i+1), window->maxLoad)
+                : window->maxLoad;
+        }
+    }
+    return window->maxLoad;
+}
+
+static AEAudioControllerRenderStatistics renderStatisticsFromWindow(const render_statistics_window_t *window) {
+    AEAudioControllerRenderStatistics statistics = {
+        .cycles = window->cycles,
+        .overloads = window->overloads,
+        .discontinuities = window->discontinuities,
+        .duration = window->startTime ? AESecondsFromHostTicks(window->endTime - window->startTime) : 0,
+        .meanLoad = window->cycles ? window->loadAccumulator / window->cycles : 0,
+        .maxLoad = window->maxLoad,
+        .p99Load = renderLoadPercentile(window, 0.99),
+        .p999Load = renderLoadPercentile(window, 0.999),
+    };
+    memcpy(statistics.histogram, window->histogram, sizeof(statistics.histogram));
+    return statistics;
+}
+
 static void performLevelMonitoring(audio_level_monitor_t* monitor, AudioBufferList *buffer, UInt32 numberFrames) {
     if ( !monitor->floatConverter || !monitor->scratchBuffer ) return;
     
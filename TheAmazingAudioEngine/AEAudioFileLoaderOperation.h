@@ -29,6 +29,7 @@ extern "C" {
 
 #import <Foundation/Foundation.h>
 #import <AudioToolbox/AudioToolbox.h>
+#import "AEPCMFile.h"
 
 @class AEAudioFileLoaderOperation;
 
@@ -84,6 +85,25 @@ extern "C" {
  */
 - (id)initWithFileURL:(NSURL*)url targetAudioDescription:(AudioStreamBasicDescription)audioDescription;
 
+/*!
+ * Load a batch of files
+ *
+ *  Loads each file with an operation on a shared loading queue, with
+ *  @link decodeInParallel @endlink enabled. Segments of all files are decoded
+ *  on one shared pool of worker threads, so that many files load as quickly as
+ *  the available cores allow, whether they're short or long.
+ *
+ * @param urls              Array of NSURLs of the files to load
+ * @param audioDescription  The target audio description
+ * @param completionBlock   Block to call on the main thread once all files have loaded, with the
+ *                          operations in the same order as the URLs. Check each operation's
+ *                          @link error @endlink, then take its @link bufferList @endlink.
+ * @return The operations, which may be cancelled
+ */
++ (NSArray*)beginLoadingFilesAtURLs:(NSArray*)urls
+             targetAudioDescription:(AudioStreamBasicDescription)audioDescription
+                    completionBlock:(void(^)(NSArray *operations))completionBlock;
+
 /*!
  * A block to use to receive audio
  *
@@ -94,6 +114,47 @@ extern "C" {
 
 @property (nonatomic, copy) void (^completedBlock)(void);
 
+/*!
+ * Whether to decode long files in concurrent segments
+ *
+ *  If set, files long enough to benefit are split into segments which are decoded
+ *  at the same time on several cores, then stitched together sample-accurately. Each
+ *  segment after the first starts decoding a little early, and discards the excess,
+ *  so that the codec and sample rate converter are warmed up by the time the segment
+ *  proper begins.
+ *
+ *  Has no effect if @link audioReceiverBlock @endlink is set. Default is NO.
+ */
+@property (nonatomic, assign) BOOL decodeInParallel;
+
+/*!
+ * Whether to memory-map the file instead of decoding it, when possible
+ *
+ *  If set, and the file contains uncompressed PCM audio with the same sample format,
+ *  sample rate and channel count as the target audio description, the file's audio data
+ *  is mapped into memory rather than read. No decoding takes place, the page cache
+ *  takes care of residency and eviction, and the memory is shared with other processes
+ *  mapping the same file. The file is otherwise loaded normally.
+ *
+ *  When the file was mapped, @link mappedData @endlink holds the mapping, and
+ *  @link bufferList @endlink points into it. As audio files store interleaved audio,
+ *  if the target format is non-interleaved the buffer list will hold a single interleaved
+ *  buffer; see @link bufferListAudioDescription @endlink.
+ *
+ *  Has no effect if @link audioReceiverBlock @endlink is set. Default is NO.
+ */
+@property (nonatomic, assign) BOOL memoryMapIfPossible;
+
+/*!
+ * The file I/O backend to load with
+ *
+ *  With AEAudioFileBackendPCMFile, linear PCM WAV, RF64, AIFF and CAF files are read with
+ *  the portable @link AEPCMFile @endlink reader, when the target audio description is 32-bit
+ *  float with the file's sample rate and channel count. Other files are loaded with
+ *  ExtAudioFile. Default is AEAudioFileBackendExtAudioFile.
+ */
+@property (nonatomic, assign) AEAudioFileBackend backend;
+
 
 /*!
  * The loaded audio, once operation has completed, unless @link audioReceiverBlock @endlink is set.
@@ -105,9 +166,31 @@ extern "C" {
 
 /*!
  * The length of the audio file
+ *
+ *  This is the number of frames actually decoded, which may differ slightly from the
+ *  length reported by @link infoForFileAtURL:audioDescription:lengthInFrames:error: @endlink
+ *  when converting sample rate. If the file ends early, partway through, the load fails
+ *  with an error rather than leaving a gap of silence.
  */
 @property (nonatomic, readonly) UInt32 lengthInFrames;
 
+/*!
+ * The memory-mapped audio file, if @link memoryMapIfPossible @endlink was set and the file was mapped
+ *
+ *  The mapping lasts as long as this object. When this is set, the mData pointers of
+ *  @link bufferList @endlink point into the read-only mapping, and you are responsible
+ *  for freeing only the buffer list itself.
+ */
+@property (nonatomic, strong, readonly) NSData *mappedData;
+
+/*!
+ * The audio format of @link bufferList @endlink
+ *
+ *  This is the target audio description, unless the file was memory-mapped and the target
+ *  format is non-interleaved, in which case it's the interleaved equivalent.
+ */
+@property (nonatomic, readonly) AudioStreamBasicDescription bufferListAudioDescription;
+
 /*!
  * The error, if one occurred
  */
@@ -25,9 +25,23 @@
 
 #import "AEAudioFileLoaderOperation.h"
 #import "AEUtilities.h"
+#import "AETraceRecorder.h"
+#import "AEPCMFile.h"
+#import <libkern/OSAtomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 
 static const int kIncrementalLoadBufferSize = 4096;
 static const int kMaxAudioFileReadSize = 16384;
+static const NSTimeInterval kMappedPrefetchDuration = 2.0;
+static const NSTimeInterval kMinimumSegmentDuration = 5.0;
+static const NSTimeInterval kSegmentPrerollDuration = 0.1;
+
+static OSStatus setClientFormat(ExtAudioFileRef audioFile, const AudioStreamBasicDescription *fileAudioDescription, const AudioStreamBasicDescription *targetAudioDescription);
+static UInt64 segmentLength(const AudioStreamBasicDescription *fileAudioDescription, const AudioStreamBasicDescription *targetAudioDescription, UInt64 lengthInFrames);
+static BOOL fitsInBufferList(UInt64 lengthInFrames, const AudioStreamBasicDescription *audioDescription);
+static NSError *fileTooLongError(void);
 
 @interface AEAudioFileLoaderOperation ()
 @property (nonatomic, strong) NSURL *url;
@@ -35,6 +49,8 @@ static const int kMaxAudioFileReadSize = 16384;
 @property (nonatomic, readwrite) AudioBufferList *bufferList;
 @property (nonatomic, readwrite) UInt32 lengthInFrames;
 @property (nonatomic, strong, readwrite) NSError *error;
+@property (nonatomic, strong, readwrite) NSData *mappedData;
+@property (nonatomic, readwrite) AudioStreamBasicDescription bufferListAudioDescription;
 @end
 
 @implementation AEAudioFileLoaderOperation
@@ -101,7 +117,232 @@ static const int kMaxAudioFileReadSize = 16384;
 }
 
 
++ (NSArray*)beginLoadingFilesAtURLs:(NSArray*)urls
+             targetAudioDescription:(AudioStreamBasicDescription)audioDescription
+                    completionBlock:(void(^)(NSArray *operations))completionBlock {
+    static NSOperationQueue *__loadingQueue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        __loadingQueue = [[NSOperationQueue alloc] init];
+        __loadingQueue.name = @"com.theamazingaudioengine.AEAudioFileLoaderOperation";
+        __loadingQueue.maxConcurrentOperationCount = [[NSProcessInfo processInfo] activeProcessorCount];
+    });
+    
+    NSMutableArray *operations = [NSMutableArray arrayWithCapacity:urls.count];
+    for ( NSURL *url in urls ) {
+        AEAudioFileLoaderOperation *operation = [[AEAudioFileLoaderOperation alloc] initWithFileURL:url targetAudioDescription:audioDescription];
+        operation.decodeInParallel = YES;
+        [operations addObject:operation];
+    }
+    
+    NSBlockOperation *completionOperation = [NSBlockOperation blockOperationWithBlock:^{
+        if ( completionBlock ) {
+            dispatch_async(dispatch_get_main_queue(), ^{ completionBlock(operations); });
+        }
+    }];
+    for ( NSOperation *operation in operations ) {
+        [completionOperation addDependency:operation];
+    }
+    
+    [__loadingQueue addOperations:operations waitUntilFinished:NO];
+    [__loadingQueue addOperation:completionOperation];
+    
+    return operations;
+}
+
 -(void)main {
+    AETraceBegin("AEAudioFileLoaderOperation");
+    _bufferListAudioDescription = _targetAudioDescription;
+    if ( (!_memoryMapIfPossible || _audioReceiverBlock || ![self loadMappedAudio])
+            && (_backend != AEAudioFileBackendPCMFile || ![self loadPCMFileAudio]) ) {
+        [self loadAudio];
+    }
+    AETraceEnd("AEAudioFileLoaderOperation");
+}
+
+static BOOL canMapFileFormat(const AudioStreamBasicDescription *fileFormat, const AudioStreamBasicDescription *targetFormat) {
+    if ( fileFormat->mFormatID != kAudioFormatLinearPCM || targetFormat->mFormatID != kAudioFormatLinearPCM ) return NO;
+    if ( fileFormat->mSampleRate != targetFormat->mSampleRate
+            || fileFormat->mChannelsPerFrame != targetFormat->mChannelsPerFrame
+            || fileFormat->mBitsPerChannel != targetFormat->mBitsPerChannel ) return NO;
+    
+    // Sample representation and byte order must match
+    UInt32 significantFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsBigEndian | kAudioFormatFlagIsSignedInteger;
+    if ( (fileFormat->mFormatFlags & significantFlags) != (targetFormat->mFormatFlags & significantFlags) ) return NO;
+    
+    // Samples must be packed in both
+    UInt32 bytesPerSample = targetFormat->mBitsPerChannel / 8;
+    UInt32 targetBytesPerFrame = (targetFormat->mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? bytesPerSample : bytesPerSample * targetFormat->mChannelsPerFrame;
+    return targetFormat->mBitsPerChannel % 8 == 0
+        && targetFormat->mBytesPerFrame == targetBytesPerFrame
+        && fileFormat->mBytesPerFrame == bytesPerSample * fileFormat->mChannelsPerFrame;
+}
+
+-(BOOL)loadMappedAudio {
+    AudioFileID audioFile;
+    BOOL holdingSecurityResource = [self.url startAccessingSecurityScopedResource];
+    
+    OSStatus status = AudioFileOpenURL((__bridge CFURLRef)_url, kAudioFileReadPermission, 0, &audioFile);
+    if ( status != noErr ) {
+        if ( holdingSecurityResource ) [self.url stopAccessingSecurityScopedResource];
+        return NO;
+    }
+    
+    AudioStreamBasicDescription fileAudioDescription;
+    SInt64 dataOffset;
+    UInt64 dataByteCount;
+    UInt32 size = sizeof(fileAudioDescription);
+    status = AudioFileGetProperty(audioFile, kAudioFilePropertyDataFormat, &size, &fileAudioDescription);
+    if ( status == noErr ) {
+        size = sizeof(dataOffset);
+        status = AudioFileGetProperty(audioFile, kAudioFilePropertyDataOffset, &size, &dataOffset);
+    }
+    if ( status == noErr ) {
+        size = sizeof(dataByteCount);
+        status = AudioFileGetProperty(audioFile, kAudioFilePropertyAudioDataByteCount, &size, &dataByteCount);
+    }
+    AudioFileClose(audioFile);
+    
+    if ( status != noErr || !canMapFileFormat(&fileAudioDescription, &_targetAudioDescription) ) {
+        if ( holdingSecurityResource ) [self.url stopAccessingSecurityScopedResource];
+        return NO;
+    }
+    
+    if ( !fitsInBufferList(dataByteCount / fileAudioDescription.mBytesPerFrame, &fileAudioDescription) ) {
+        // Too much audio for one buffer list, however it's loaded
+        if ( holdingSecurityResource ) [self.url stopAccessingSecurityScopedResource];
+        self.error = fileTooLongError();
+        if ( _completedBlock ) _completedBlock();
+        return YES;
+    }
+    
+    // Map the audio data, from the page containing its start
+    int fd = open([_url fileSystemRepresentation], O_RDONLY);
+    if ( holdingSecurityResource ) [self.url stopAccessingSecurityScopedResource];
+    if ( fd < 0 ) return NO;
+    
+    struct stat fileInfo;
+    if ( fstat(fd, &fileInfo) != 0 || dataOffset + dataByteCount > (UInt64)fileInfo.st_size ) {
+        close(fd);
+        return NO;
+    }
+    
+    off_t mapOffset = dataOffset & ~((off_t)getpagesize()-1);
+    size_t mapLength = (size_t)(dataOffset + dataByteCount - mapOffset);
+    void *mapping = mmap(NULL, mapLength, PROT_READ, MAP_SHARED, fd, mapOffset);
+    close(fd);
+    if ( mapping == MAP_FAILED ) return NO;
+    
+    // Audio will mostly be read in order; start reading in the beginning now
+    size_t prefetchLength = MIN(mapLength, (size_t)(kMappedPrefetchDuration * fileAudioDescription.mSampleRate * fileAudioDescription.mBytesPerFrame));
+    madvise(mapping, mapLength, MADV_SEQUENTIAL);
+    madvise(mapping, prefetchLength, MADV_WILLNEED);
+    
+    AudioBufferList *bufferList = (AudioBufferList*)malloc(sizeof(AudioBufferList));
+    bufferList->mNumberBuffers = 1;
+    bufferList->mBuffers[0].mNumberChannels = fileAudioDescription.mChannelsPerFrame;
+    bufferList->mBuffers[0].mData = (char*)mapping + (dataOffset - mapOffset);
+    bufferList->mBuffers[0].mDataByteSize = (UInt32)dataByteCount; // Checked to fit, above
+    
+    AudioStreamBasicDescription bufferListAudioDescription = _targetAudioDescription;
+    bufferListAudioDescription.mFormatFlags &= ~kAudioFormatFlagIsNonInterleaved;
+    bufferListAudioDescription.mBytesPerFrame = bufferListAudioDescription.mBytesPerPacket = fileAudioDescription.mBytesPerFrame;
+    
+    self.mappedData = [[NSData alloc] initWithBytesNoCopy:mapping length:mapLength deallocator:^(void *bytes, NSUInteger length) {
+        munmap(bytes, length);
+    }];
+    self.bufferListAudioDescription = bufferListAudioDescription;
+    _bufferList = bufferList;
+    _lengthInFrames = (UInt32)(dataByteCount / fileAudioDescription.mBytesPerFrame);
+    
+    if ( _completedBlock ) {
+        _completedBlock();
+    }
+    
+    return YES;
+}
+
+-(BOOL)loadPCMFileAudio {
+    // The PCM file reader provides float samples, without sample rate or channel conversion
+    if ( _targetAudioDescription.mFormatID != kAudioFormatLinearPCM
+            || !(_targetAudioDescription.mFormatFlags & kAudioFormatFlagIsFloat)
+            || _targetAudioDescription.mBitsPerChannel != 32 ) return NO;
+    
+    BOOL holdingSecurityResource = [self.url startAccessingSecurityScopedResource];
+    AEPCMFile *file = AEPCMFileOpen([_url fileSystemRepresentation], NULL);
+    if ( holdingSecurityResource ) [self.url stopAccessingSecurityScopedResource];
+    if ( !file ) return NO;
+    
+    AEPCMFileFormat format = AEPCMFileGetFormat(file);
+    if ( format.sampleRate != _targetAudioDescription.mSampleRate || format.channels != _targetAudioDescription.mChannelsPerFrame ) {
+        AEPCMFileClose(file);
+        return NO;
+    }
+    
+    UInt64 fileLengthInFrames = AEPCMFileGetLength(file);
+    if ( !_audioReceiverBlock && !fitsInBufferList(fileLengthInFrames, &_targetAudioDescription) ) {
+        AEPCMFileClose(file);
+        self.error = fileTooLongError();
+        if ( _completedBlock ) _completedBlock();
+        return YES;
+    }
+    
+    int bufferCount = (_targetAudioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? _targetAudioDescription.mChannelsPerFrame : 1;
+    AudioBufferList *bufferList = AEAudioBufferListCreate(_targetAudioDescription, _audioReceiverBlock ? kIncrementalLoadBufferSize : (UInt32)fileLengthInFrames);
+    if ( !bufferList ) {
+        AEPCMFileClose(file);
+        self.error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM
+                                     userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"Not enough memory to open file", @"")}];
+        if ( _completedBlock ) _completedBlock();
+        return YES;
+    }
+    
+    float *buffers[bufferCount];
+    UInt64 readFrames = 0;
+    int result = 0;
+    while ( readFrames < fileLengthInFrames && ![self isCancelled] ) {
+        UInt32 frames = (UInt32)MIN(kIncrementalLoadBufferSize, fileLengthInFrames - readFrames);
+        for ( int i=0; i<bufferCount; i++ ) {
+            buffers[i] = (float*)bufferList->mBuffers[i].mData + (_audioReceiverBlock ? 0 : readFrames * (bufferCount == 1 ? format.channels : 1));
+        }
+        
+        AETraceBegin("AEPCMFileReadFloat");
+        result = AEPCMFileReadFloat(file, buffers, bufferCount, frames, &frames);
+        AETraceEnd("AEPCMFileReadFloat");
+        if ( result != 0 || frames == 0 ) break;
+        
+        if ( _audioReceiverBlock ) {
+            for ( int i=0; i<bufferCount; i++ ) {
+                bufferList->mBuffers[i].mDataByteSize = frames * _targetAudioDescription.mBytesPerFrame;
+            }
+            _audioReceiverBlock(bufferList, frames);
+        }
+        
+        readFrames += frames;
+    }
+    
+    AEPCMFileClose(file);
+    
+    if ( result != 0 ) {
+        self.error = [NSError errorWithDomain:NSPOSIXErrorDomain code:result
+                                     userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:NSLocalizedString(@"Couldn't read the audio file (%s)", @""), strerror(result)]}];
+    }
+    
+    if ( result != 0 || _audioReceiverBlock || [self isCancelled] ) {
+        AEAudioBufferListFree(bufferList);
+    } else {
+        _bufferList = bufferList;
+        _lengthInFrames = (UInt32)readFrames;
+    }
+    
+    if ( _completedBlock ) {
+        _completedBlock();
+    }
+    
+    return YES;
+}
+
+-(void)loadAudio {
     ExtAudioFileRef audioFile;
     OSStatus status;
     
@@ -129,8 +370,8 @@ static const int kMaxAudioFileReadSize = 16384;
     }
     
     // Apply client format
-    status = ExtAudioFileSetProperty(audioFile, kExtAudioFileProperty_ClientDataFormat, sizeof(_targetAudioDescription), &_targetAudioDescription);
-    if ( !AECheckOSStatus(status, "ExtAudioFileSetProperty(kExtAudioFileProperty_ClientDataFormat)") ) {
+    status = setClientFormat(audioFile, &fileAudioDescription, &_targetAudioDescription);
+    if ( status != noErr ) {
         ExtAudioFileDispose(audioFile);
         int fourCC = CFSwapInt32HostToBig(status);
         self.error = [NSError errorWithDomain:NSOSStatusErrorDomain code:status 
@@ -139,23 +380,6 @@ static const int kMaxAudioFileReadSize = 16384;
         return;
     }
     
-    if ( _targetAudioDescription.mChannelsPerFrame > fileAudioDescription.mChannelsPerFrame ) {
-        // More channels in target format than file format - set up a map to duplicate channel
-        SInt32 channelMap[_targetAudioDescription.mChannelsPerFrame];
-        AudioConverterRef converter;
-        AECheckOSStatus(ExtAudioFileGetProperty(audioFile, kExtAudioFileProperty_AudioConverter, &size, &converter),
-                    "ExtAudioFileGetProperty(kExtAudioFileProperty_AudioConverter)");
-        for ( int outChannel=0, inChannel=0; outChannel < _targetAudioDescription.mChannelsPerFrame; outChannel++ ) {
-            channelMap[outChannel] = inChannel;
-            if ( inChannel+1 < fileAudioDescription.mChannelsPerFrame ) inChannel++;
-        }
-        AECheckOSStatus(AudioConverterSetProperty(converter, kAudioConverterChannelMap, sizeof(SInt32)*_targetAudioDescription.mChannelsPerFrame, channelMap),
-                    "AudioConverterSetProperty(kAudioConverterChannelMap)");
-        CFArrayRef config = NULL;
-        AECheckOSStatus(ExtAudioFileSetProperty(audioFile, kExtAudioFileProperty_ConverterConfig, sizeof(CFArrayRef), &config),
-                    "ExtAudioFileSetProperty(kExtAudioFileProperty_ConverterConfig)");
-    }
-    
     // Determine length in frames (in original file's sample rate)
     UInt64 fileLengthInFrames;
     size = sizeof(fileLengthInFrames);
@@ -171,6 +395,13 @@ static const int kMaxAudioFileReadSize = 16384;
     // Calculate the true length in frames, given the original and target sample rates
     fileLengthInFrames = ceil(fileLengthInFrames * (_targetAudioDescription.mSampleRate / fileAudioDescription.mSampleRate));
     
+    if ( !_audioReceiverBlock && !fitsInBufferList(fileLengthInFrames, &_targetAudioDescription) ) {
+        ExtAudioFileDispose(audioFile);
+        self.error = fileTooLongError();
+        if ( holdingSecurityResource ) [self.url stopAccessingSecurityScopedResource];
+        return;
+    }
+    
     // Prepare buffers
     int bufferCount = (_targetAudioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? _targetAudioDescription.mChannelsPerFrame : 1;
     int channelsPerBuffer = (_targetAudioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? 1 : _targetAudioDescription.mChannelsPerFrame;
@@ -183,6 +414,34 @@ static const int kMaxAudioFileReadSize = 16384;
         return;
     }
     
+    UInt64 segmentFrames = _decodeInParallel && !_audioReceiverBlock
+        ? segmentLength(&fileAudioDescription, &_targetAudioDescription, fileLengthInFrames) : 0;
+    if ( segmentFrames > 0 ) {
+        // Decode the file in concurrent segments, then we're done with it
+        ExtAudioFileDispose(audioFile);
+        UInt64 decodedLength = 0;
+        status = [self decodeSegmentsOfLength:segmentFrames intoBufferList:bufferList lengthInFrames:fileLengthInFrames
+                         fileAudioDescription:&fileAudioDescription decodedLength:&decodedLength];
+        if ( holdingSecurityResource ) [self.url stopAccessingSecurityScopedResource];
+        
+        if ( status != noErr || [self isCancelled] ) {
+            AEAudioBufferListFree(bufferList);
+            if ( status != noErr ) {
+                int fourCC = CFSwapInt32HostToBig(status);
+                self.error = [NSError errorWithDomain:NSOSStatusErrorDomain code:status
+                                             userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:NSLocalizedString(@"Couldn't read the audio file (error %d/%4.4s)", @""), status, (char*)&fourCC]}];
+            }
+        } else {
+            _bufferList = bufferList;
+            _lengthInFrames = (UInt32)decodedLength;
+        }
+        
+        if ( _completedBlock ) {
+            _completedBlock();
+        }
+        return;
+    }
+    
     AudioBufferList *scratchBufferList = AEAudioBufferListCreate(_targetAudioDescription, 0);
     
     // Perform read in multiple small chunks (otherwise ExtAudioFileRead crashes when performing sample rate conversion)
@@ -204,7 +463,9 @@ static const int kMaxAudioFileReadSize = 16384;
         
         // Perform read
         UInt32 numberOfPackets = (UInt32)(scratchBufferList->mBuffers[0].mDataByteSize / _targetAudioDescription.mBytesPerFrame);
+        AETraceBegin("ExtAudioFileRead");
         status = ExtAudioFileRead(audioFile, &numberOfPackets, scratchBufferList);
+        AETraceEnd("ExtAudioFileRead");
         
         if ( status != noErr ) {
             ExtAudioFileDispose(audioFile);
@@ -248,8 +509,9 @@ static const int kMaxAudioFileReadSize = 16384;
             bufferList = NULL;
         }
     } else {
+        // The estimated length may be a little out, particularly when converting sample rate
         _bufferList = bufferList;
-        _lengthInFrames = (UInt32)fileLengthInFrames;
+        _lengthInFrames = (UInt32)readFrames;
     }
 
     if ( _completedBlock ) {
@@ -257,4 +519,181 @@ static const int kMaxAudioFileReadSize = 16384;
     }
 }
 
+static BOOL fitsInBufferList(UInt64 lengthInFrames, const AudioStreamBasicDescription *audioDescription) {
+    // Buffer byte counts and the reported length are both 32-bit
+    return lengthInFrames <= UINT32_MAX && lengthInFrames * audioDescription->mBytesPerFrame <= UINT32_MAX;
+}
+
+static NSError *fileTooLongError(void) {
+    return [NSError errorWithDomain:NSPOSIXErrorDomain code:EFBIG
+                           userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"The audio file is too long to load into memory", @"")}];
+}
+
+#pragma mark - Segmented decoding
+
+static OSStatus setClientFormat(ExtAudioFileRef audioFile, const AudioStreamBasicDescription *fileAudioDescription, const AudioStreamBasicDescription *targetAudioDescription) {
+    OSStatus status = ExtAudioFileSetProperty(audioFile, kExtAudioFileProperty_ClientDataFormat, sizeof(AudioStreamBasicDescription), targetAudioDescription);
+    if ( !AECheckOSStatus(status, "ExtAudioFileSetProperty(kExtAudioFileProperty_ClientDataFormat)") ) {
+        return status;
+    }
+    
+    if ( targetAudioDescription->mChannelsPerFrame > fileAudioDescription->mChannelsPerFrame ) {
+        // More channels in target format than file format - set up a map to duplicate channel
+        SInt32 channelMap[targetAudioDescription->mChannelsPerFrame];
+        AudioConverterRef converter;
+        UInt32 size = sizeof(converter);
+        AECheckOSStatus(ExtAudioFileGetProperty(audioFile, kExtAudioFileProperty_AudioConverter, &size, &converter),
+                    "ExtAudioFileGetProperty(kExtAudioFileProperty_AudioConverter)");
+        for ( int outChannel=0, inChannel=0; outChannel < targetAudioDescription->mChannelsPerFrame; outChannel++ ) {
+            channelMap[outChannel] = inChannel;
+            if ( inChannel+1 < fileAudioDescription->mChannelsPerFrame ) inChannel++;
+        }
+        AECheckOSStatus(AudioConverterSetProperty(converter, kAudioConverterChannelMap, sizeof(SInt32)*targetAudioDescription->mChannelsPerFrame, channelMap),
+                    "AudioConverterSetProperty(kAudioConverterChannelMap)");
+        CFArrayRef config = NULL;
+        AECheckOSStatus(ExtAudioFileSetProperty(audioFile, kExtAudioFileProperty_ConverterConfig, sizeof(CFArrayRef), &config),
+                    "ExtAudioFileSetProperty(kExtAudioFileProperty_ConverterConfig)");
+    }
+    
+    return noErr;
+}
+
+static UInt64 greatestCommonDivisor(UInt64 a, UInt64 b) {
+    while ( b ) { UInt64 t = a % b; a = b; b = t; }
+    return a;
+}
+
+static UInt64 segmentAlignment(const AudioStreamBasicDescription *fileAudioDescription, const AudioStreamBasicDescription *targetAudioDescription) {
+    // Segments must start on a frame that corresponds to a whole frame in the file, so that
+    // we can seek to it exactly; only possible with whole-number sample rates
+    if ( fileAudioDescription->mSampleRate != floor(fileAudioDescription->mSampleRate)
+            || targetAudioDescription->mSampleRate != floor(targetAudioDescription->mSampleRate) ) return 0;
+    UInt64 fileRate = (UInt64)fileAudioDescription->mSampleRate;
+    UInt64 targetRate = (UInt64)targetAudioDescription->mSampleRate;
+    return targetRate / greatestCommonDivisor(fileRate, targetRate);
+}
+
+static UInt64 segmentLength(const AudioStreamBasicDescription *fileAudioDescription, const AudioStreamBasicDescription *targetAudioDescription, UInt64 lengthInFrames) {
+    UInt64 alignment = segmentAlignment(fileAudioDescription, targetAudioDescription);
+    if ( alignment == 0 ) return 0;
+    
+    // Aim for a couple of segments per core, but don't make segments so short that the
+    // preroll and per-segment setup dominate
+    UInt64 minimumLength = kMinimumSegmentDuration * targetAudioDescription->mSampleRate;
+    UInt64 length = MAX(minimumLength, lengthInFrames / (2 * [[NSProcessInfo processInfo] activeProcessorCount]));
+    length = ((length + alignment - 1) / alignment) * alignment;
+    
+    return lengthInFrames >= 2 * length ? length : 0;
+}
+
+static OSStatus decodeSegment(NSURL *url,
+                              const AudioStreamBasicDescription *fileAudioDescription,
+                              const AudioStreamBasicDescription *targetAudioDescription,
+                              AudioBufferList *bufferList,
+                              UInt64 startFrame,
+                              UInt64 endFrame,
+                              UInt64 *outEndFrame,
+                              BOOL (^isCancelled)(void)) {
+    *outEndFrame = startFrame;
+    
+    ExtAudioFileRef audioFile;
+    OSStatus status = ExtAudioFileOpenURL((__bridge CFURLRef)url, &audioFile);
+    if ( !AECheckOSStatus(status, "ExtAudioFileOpenURL") ) return status;
+    
+    status = setClientFormat(audioFile, fileAudioDescription, targetAudioDescription);
+    if ( status != noErr ) {
+        ExtAudioFileDispose(audioFile);
+        return status;
+    }
+    
+    // Start early, so the decoder and converter have settled by the time we reach the segment
+    UInt64 alignment = segmentAlignment(fileAudioDescription, targetAudioDescription);
+    UInt64 prerollFrames = ceil((kSegmentPrerollDuration * targetAudioDescription->mSampleRate) / alignment) * alignment;
+    prerollFrames = MIN(prerollFrames, startFrame);
+    
+    if ( startFrame > 0 ) {
+        SInt64 fileFrame = (SInt64)((startFrame - prerollFrames) / alignment)
+                                * (SInt64)(fileAudioDescription->mSampleRate / (targetAudioDescription->mSampleRate / alignment));
+        status = ExtAudioFileSeek(audioFile, fileFrame);
+        if ( !AECheckOSStatus(status, "ExtAudioFileSeek") ) {
+            ExtAudioFileDispose(audioFile);
+            return status;
+        }
+    }
+    
+    UInt32 chunkFrames = kMaxAudioFileReadSize / targetAudioDescription->mBytesPerFrame;
+    AudioBufferList *prerollBufferList = prerollFrames > 0 ? AEAudioBufferListCreate(*targetAudioDescription, chunkFrames) : NULL;
+    AudioBufferList *scratchBufferList = AEAudioBufferListCreate(*targetAudioDescription, 0);
+    
+    UInt64 position = startFrame - prerollFrames;
+    while ( position < endFrame && !isCancelled() ) {
+        UInt32 frames = (UInt32)MIN(chunkFrames, (position < startFrame ? startFrame : endFrame) - position);
+        for ( int i=0; i<scratchBufferList->mNumberBuffers; i++ ) {
+            scratchBufferList->mBuffers[i].mNumberChannels = bufferList->mBuffers[i].mNumberChannels;
+            scratchBufferList->mBuffers[i].mData = position < startFrame
+                ? prerollBufferList->mBuffers[i].mData
+                : (char*)bufferList->mBuffers[i].mData + position*targetAudioDescription->mBytesPerFrame;
+            scratchBufferList->mBuffers[i].mDataByteSize = frames * targetAudioDescription->mBytesPerFrame;
+        }
+        
+        AETraceBegin("ExtAudioFileRead");
+        status = ExtAudioFileRead(audioFile, &frames, scratchBufferList);
+        AETraceEnd("ExtAudioFileRead");
+        
+        if ( status != noErr || frames == 0 ) break;
+        position += frames;
+    }
+    
+    *outEndFrame = MAX(position, startFrame);
+    
+    if ( prerollBufferList ) AEAudioBufferListFree(prerollBufferList);
+    free(scratchBufferList);
+    ExtAudioFileDispose(audioFile);
+    
+    return status;
+}
+
+-(OSStatus)decodeSegmentsOfLength:(UInt64)segmentFrames
+                   intoBufferList:(AudioBufferList*)bufferList
+                   lengthInFrames:(UInt64)lengthInFrames
+             fileAudioDescription:(const AudioStreamBasicDescription*)fileAudioDescription
+                    decodedLength:(UInt64*)outDecodedLength {
+    
+    AudioStreamBasicDescription targetAudioDescription = _targetAudioDescription;
+    AudioStreamBasicDescription fileDescription = *fileAudioDescription;
+    NSURL *url = _url;
+    __weak AEAudioFileLoaderOperation *weakSelf = self;
+    BOOL (^isCancelled)(void) = ^BOOL{ return weakSelf.isCancelled; };
+    
+    size_t segmentCount = (size_t)((lengthInFrames + segmentFrames - 1) / segmentFrames);
+    __block volatile int32_t firstError = noErr;
+    __block UInt64 decodedLength = lengthInFrames;
+    
+    // Segments of all operations share GCD's pool of worker threads
+    dispatch_apply(segmentCount, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t segment) {
+        if ( firstError != noErr || isCancelled() ) return;
+        AETraceBegin("Decode segment");
+        UInt64 endFrame = MIN((segment+1) * segmentFrames, lengthInFrames);
+        UInt64 decodedEndFrame;
+        OSStatus status = decodeSegment(url, &fileDescription, &targetAudioDescription, bufferList,
+                                        segment * segmentFrames, endFrame, &decodedEndFrame, isCancelled);
+        AETraceEnd("Decode segment");
+        if ( status == noErr && decodedEndFrame < endFrame && !isCancelled() ) {
+            if ( segment == segmentCount-1 ) {
+                // The estimated length may be a little out at the end of the file: trim to what was decoded
+                decodedLength = decodedEndFrame;
+            } else {
+                // A segment that ends early would leave a gap of silence in the middle of the audio
+                status = kAudioFileEndOfFileError;
+            }
+        }
+        if ( status != noErr ) {
+            OSAtomicCompareAndSwap32Barrier(noErr, status, &firstError);
+        }
+    });
+    
+    *outDecodedLength = decodedLength;
+    return firstError;
+}
+
 @end
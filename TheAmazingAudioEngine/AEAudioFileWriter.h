@@ -29,6 +29,7 @@ extern "C" {
 
 #import <Foundation/Foundation.h>
 #import <AudioToolbox/AudioToolbox.h>
+#import "AEPCMFile.h"
 
 extern NSString * const AEAudioFileWriterErrorDomain;
 
@@ -43,10 +44,42 @@ enum {
  *
  *  Provides an easy-to-use interface to the ExtAudioFile API, allowing
  *  asynchronous, Core Audio thread-safe writing of arbitrary audio formats.
+ *
+ *  Audio added with @link AEAudioFileWriterAddAudio @endlink is copied into a
+ *  preallocated lock-free ring buffer, which a dedicated low-priority writer thread
+ *  drains to disk in large chunks. The ring holds @link bufferDuration @endlink seconds
+ *  of audio, which is how long the disk may stall before audio is lost. If the ring
+ *  fills up, audio is dropped and counted in @link overflowCount @endlink and
+ *  @link overflowFrameCount @endlink. The ring is the portable @link AEAudioFileWriterBuffer @endlink.
  */
 @interface AEAudioFileWriter : NSObject
 + (BOOL)AACEncodingAvailable;
 
+/*!
+ * Determine whether a file was left unfinished by a crash-safe recording
+ *
+ *  See @link journaled @endlink.
+ *
+ * @param path The path to the file
+ * @return YES if the file has a recovery journal, and should be repaired with
+ *      @link recoverFileAtPath:lengthInFrames:error: @endlink
+ */
++ (BOOL)fileNeedsRecoveryAtPath:(NSString*)path;
+
+/*!
+ * Repair a file left unfinished by a crash-safe recording
+ *
+ *  Rewrites the file's header to include all the audio that reached the disk, using the
+ *  file's recovery journal, then removes the journal. Files without a journal are repaired
+ *  from their header, for WAV, AIFF and CAF files whose audio data runs to the end of the file.
+ *
+ * @param path The path to the file
+ * @param lengthInFrames On output, if not NULL, the length of the recovered audio
+ * @param error On output, if not NULL, the error if one occurred
+ * @return YES on success; NO on error
+ */
++ (BOOL)recoverFileAtPath:(NSString*)path lengthInFrames:(UInt64*)lengthInFrames error:(NSError**)error;
+
 /*!
  * Initialise, with a given audio description to use
  *
@@ -75,17 +108,94 @@ enum {
 /*!
  * Complete writing operation
  *
- *  Finishes write, closes the file and cleans up internal resources.
+ *  Finishes write, closes the file and cleans up internal resources. Once this
+ *  returns, @link AEAudioFileWriterAddAudio @endlink returns kAudioFileNotOpenError.
  */
 - (void)finishWriting;
 
+/*!
+ * Duration of audio that can be buffered awaiting the writer thread, in seconds
+ *
+ *  Takes effect from the next call to
+ *  @link beginWritingToFileAtPath:fileType:error: beginWritingToFileAtPath @endlink.
+ *  Default is 4 seconds.
+ *
+ *  Set to zero to write only with @link AEAudioFileWriterAddAudioSynchronously @endlink,
+ *  from your own thread, without the ring buffer or writer thread.
+ */
+@property (nonatomic, assign) NSTimeInterval bufferDuration;
+
+/*!
+ * The file I/O backend to write with
+ *
+ *  With AEAudioFileBackendPCMFile, WAV, AIFF and CAF files are written with the portable
+ *  @link AEPCMFile @endlink writer, when the audio description is 32-bit float and the
+ *  file has the same number of channels. WAV files which grow beyond 4 GB become RF64.
+ *  Other files are written with ExtAudioFile.
+ *
+ *  Takes effect from the next call to
+ *  @link beginWritingToFileAtPath:fileType:error: beginWritingToFileAtPath @endlink.
+ *  Default is AEAudioFileBackendExtAudioFile.
+ */
+@property (nonatomic, assign) AEAudioFileBackend backend;
+
+/*!
+ * Whether to keep the file recoverable should the app die while writing
+ *
+ *  When enabled, the file is written with the @link AEPCMFile @endlink backend, and every
+ *  @link syncInterval @endlink seconds, the writer thread writes out all audio received,
+ *  rewrites the file header with the current length, updates a recovery journal beside
+ *  the file, and waits for all three to reach the disk. If the app dies, the file can be
+ *  repaired with @link recoverFileAtPath:lengthInFrames:error: @endlink, losing at most
+ *  the last sync interval's audio. The journal is removed when writing finishes.
+ *
+ *  Disk synchronization never happens on the audio thread. When @link bufferDuration @endlink
+ *  is zero, it happens within @link AEAudioFileWriterAddAudioSynchronously @endlink.
+ *
+ *  Requires a WAV, AIFF or CAF file type, and a 32-bit float audio description.
+ *  Takes effect from the next call to
+ *  @link beginWritingToFileAtPath:fileType:error: beginWritingToFileAtPath @endlink.
+ *  Default is NO.
+ */
+@property (nonatomic, assign) BOOL journaled;
+
+/*!
+ * Interval between commits to disk, in seconds, when @link journaled @endlink
+ *
+ *  Default is 2 seconds.
+ */
+@property (nonatomic, assign) NSTimeInterval syncInterval;
+
+/*!
+ * Number of times audio was dropped because the buffer was full
+ */
+@property (nonatomic, readonly) NSUInteger overflowCount;
+
+/*!
+ * Number of frames of audio dropped because the buffer was full
+ */
+@property (nonatomic, readonly) UInt64 overflowFrameCount;
+
+/*!
+ * The highest buffer usage seen since writing began, as a proportion of its capacity
+ *
+ *  Values approaching 1.0 indicate that the disk is struggling to keep up, and
+ *  @link bufferDuration @endlink may need increasing.
+ */
+@property (nonatomic, readonly) double bufferHighWaterMark;
+
 /*!
  * Add audio to be written
  *
  *  This C function, safe to be used in a Core Audio realtime thread context, is used to
  *  feed audio to this class to be written to the file.
  *
- *  It runs asynchronously, and will never block.
+ *  It runs asynchronously, and will never block: it copies the audio into the
+ *  writer's ring buffer, without allocating memory, locking or making system calls.
+ *  If the buffer is full, the audio is dropped, and counted in @link AEAudioFileWriter::overflowCount overflowCount @endlink.
+ *
+ *  It's safe to call this while another thread calls @link finishWriting @endlink: that method
+ *  waits for any call in progress to return before it releases the buffer.
  *
  * @param writer A pointer to the writer object
  * @param bufferList An AudioBufferList containing the audio in the format you provided upon initialization
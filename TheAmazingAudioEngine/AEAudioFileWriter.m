@@ -25,13 +25,45 @@
 
 #import "AEAudioFileWriter.h"
 #import "TheAmazingAudioEngine.h"
+#import "AEAudioFileWriterBuffer.h"
+#import "AEPCMFile.h"
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
 
 NSString * const AEAudioFileWriterErrorDomain = @"com.theamazingaudioengine.AEAudioFileWriterErrorDomain";
 
+static const NSTimeInterval kDefaultBufferDuration = 4.0;
+static const NSTimeInterval kWriterPollInterval    = 0.05;
+static const UInt32 kWriteChunkFrames              = 32768;
+static const NSTimeInterval kDefaultSyncInterval   = 2.0;
+
+static void serviceBuffer(__unsafe_unretained AEAudioFileWriter *THIS);
+static void drainBuffer(__unsafe_unretained AEAudioFileWriter *THIS, BOOL all);
+static int writeChunk(void *context, void * const *buffers, uint32_t frames);
+static OSStatus writeAudio(__unsafe_unretained AEAudioFileWriter *THIS, AudioBufferList *bufferList, UInt32 frames);
+static void closeFile(__unsafe_unretained AEAudioFileWriter *THIS);
+static void commitIfDue(__unsafe_unretained AEAudioFileWriter *THIS);
+static BOOL pcmFileTypeForAudioFileType(AudioFileTypeID fileType, AEPCMFileType *pcmFileType);
+static BOOL canWritePCMFileFromAudioDescription(const AudioStreamBasicDescription *audioDescription, UInt32 channels, UInt32 bits);
+
+@interface AEAudioFileWriterThread : NSThread
+- (id)initWithWriter:(AEAudioFileWriter*)writer;
+@end
+
 @interface AEAudioFileWriter () {
-    BOOL                        _writing;
+    volatile int32_t            _writing;
+    volatile int32_t            _activeAddCount;
     ExtAudioFileRef             _audioFile;
+    AEPCMFile                  *_pcmFile;
     AudioStreamBasicDescription _audioDescription;
+    AEAudioFileWriterBuffer    *_buffer;
+    pthread_mutex_t             _fileMutex;
+    AEAudioFileWriterThread    *_writerThread;
+    NSUInteger                  _overflowCount;
+    UInt64                      _overflowFrameCount;
+    double                      _bufferHighWaterMark;
+    volatile OSStatus           _writeStatus;
+    double                      _lastCommitTime;
 }
 
 @property (nonatomic, strong, readwrite) NSString *path;
@@ -81,9 +113,29 @@ NSString * const AEAudioFileWriterErrorDomain = @"com.theamazingaudioengine.AEAu
 #endif
 }
 
++ (BOOL)fileNeedsRecoveryAtPath:(NSString*)path {
+    return AEPCMFileNeedsRecovery([path fileSystemRepresentation]);
+}
+
++ (BOOL)recoverFileAtPath:(NSString*)path lengthInFrames:(UInt64*)lengthInFrames error:(NSError**)error {
+    uint64_t frames = 0;
+    int result = AEPCMFileRecover([path fileSystemRepresentation], &frames);
+    if ( result != 0 ) {
+        if ( error ) *error = [NSError errorWithDomain:NSPOSIXErrorDomain
+                                                  code:result
+                                              userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:NSLocalizedString(@"Couldn't recover the file (%s)", @""), strerror(result)]}];
+        return NO;
+    }
+    if ( lengthInFrames ) *lengthInFrames = frames;
+    return YES;
+}
+
 - (id)initWithAudioDescription:(AudioStreamBasicDescription)audioDescription {
     if ( !(self = [super init]) ) return nil;
     _audioDescription = audioDescription;
+    _bufferDuration = kDefaultBufferDuration;
+    _syncInterval = kDefaultSyncInterval;
+    pthread_mutex_init(&_fileMutex, NULL);
     return self;
 }
 
@@ -91,6 +143,7 @@ NSString * const AEAudioFileWriterErrorDomain = @"com.theamazingaudioengine.AEAu
     if ( _writing ) {
         [self finishWriting];
     }
+    pthread_mutex_destroy(&_fileMutex);
 }
 
 - (BOOL)beginWritingToFileAtPath:(NSString*)path fileType:(AudioFileTypeID)fileType error:(NSError**)error {
@@ -110,7 +163,44 @@ NSString * const AEAudioFileWriterErrorDomain = @"com.theamazingaudioengine.AEAu
         channels = _audioDescription.mChannelsPerFrame;
     }
 
-    if ( fileType == kAudioFileM4AType ) {
+    AEPCMFileType pcmFileType;
+    BOOL canUsePCMFile = pcmFileTypeForAudioFileType(fileType, &pcmFileType) && canWritePCMFileFromAudioDescription(&_audioDescription, channels, bits);
+    
+    if ( _journaled && !canUsePCMFile ) {
+        if ( error ) *error = [NSError errorWithDomain:AEAudioFileWriterErrorDomain
+                                                  code:kAEAudioFileWriterFormatError
+                                              userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"Crash-safe recording requires a WAV, AIFF or CAF file, and 32-bit float audio", @"")}];
+        return NO;
+    }
+    
+    if ( (_backend == AEAudioFileBackendPCMFile || _journaled) && canUsePCMFile ) {
+        
+        // Write with the portable PCM file writer
+        AEPCMFileFormat format = { .sampleRate = _audioDescription.mSampleRate, .channels = channels, .bitsPerSample = bits, .isFloat = false };
+        int result;
+        _pcmFile = AEPCMFileCreate([path fileSystemRepresentation], pcmFileType, &format, 0, &result);
+        if ( !_pcmFile ) {
+            if ( error ) *error = [NSError errorWithDomain:NSPOSIXErrorDomain
+                                                      code:result
+                                                  userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:NSLocalizedString(@"Couldn't open the output file (%s)", @""), strerror(result)]}];
+            return NO;
+        }
+        
+        if ( _journaled ) {
+            // Commit the empty file now, so it's recoverable from the start
+            result = AEPCMFileCommit(_pcmFile, true);
+            if ( result != 0 ) {
+                AEPCMFileClose(_pcmFile);
+                _pcmFile = NULL;
+                if ( error ) *error = [NSError errorWithDomain:NSPOSIXErrorDomain
+                                                          code:result
+                                                      userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:NSLocalizedString(@"Couldn't create the recovery journal (%s)", @""), strerror(result)]}];
+                return NO;
+            }
+            _lastCommitTime = AECurrentTimeInSeconds();
+        }
+        
+    } else if ( fileType == kAudioFileM4AType ) {
         if ( ![AEAudioFileWriter AACEncodingAvailable] ) {
             if ( error ) *error = [NSError errorWithDomain:AEAudioFileWriterErrorDomain 
                                                       code:kAEAudioFileWriterFormatError 
@@ -194,7 +284,7 @@ NSString * const AEAudioFileWriterErrorDomain = @"com.theamazingaudioengine.AEAu
     }
     
     // Set up the converter
-    status = ExtAudioFileSetProperty(_audioFile, kExtAudioFileProperty_ClientDataFormat, sizeof(AudioStreamBasicDescription), &_audioDescription);
+    status = _pcmFile ? noErr : ExtAudioFileSetProperty(_audioFile, kExtAudioFileProperty_ClientDataFormat, sizeof(AudioStreamBasicDescription), &_audioDescription);
     if ( !AECheckOSStatus(status, "ExtAudioFileSetProperty(kExtAudioFileProperty_ClientDataFormat") ) {
         int fourCC = CFSwapInt32HostToBig(status);
         if ( error ) *error = [NSError errorWithDomain:NSOSStatusErrorDomain 
@@ -204,26 +294,239 @@ NSString * const AEAudioFileWriterErrorDomain = @"com.theamazingaudioengine.AEAu
         return NO;
     }
     
+    _overflowCount = 0;
+    _overflowFrameCount = 0;
+    _bufferHighWaterMark = 0;
+    _writeStatus = noErr;
+    
+    if ( _bufferDuration <= 0 ) {
+        // Synchronous writing only
+        self.path = path;
+        OSAtomicCompareAndSwap32Barrier(NO, YES, &_writing);
+        return YES;
+    }
+    
+    // Prepare the ring buffer
+    UInt32 bufferFrames = MAX(kWriteChunkFrames, (UInt32)(_bufferDuration * _audioDescription.mSampleRate));
+    int numberOfBuffers = (_audioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? _audioDescription.mChannelsPerFrame : 1;
+    _buffer = AEAudioFileWriterBufferNew(numberOfBuffers, _audioDescription.mBytesPerFrame, bufferFrames, kWriteChunkFrames,
+                                         writeChunk, (__bridge void*)self);
+    if ( !_buffer ) {
+        closeFile(self);
+        if ( error ) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM
+                                              userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"Not enough memory to buffer the recording", @"")}];
+        return NO;
+    }
+    
     self.path = path;
-    _writing = YES;
+    OSAtomicCompareAndSwap32Barrier(NO, YES, &_writing);
+    
+    _writerThread = [[AEAudioFileWriterThread alloc] initWithWriter:self];
+    [_writerThread start];
     
     return YES;
 }
 
 - (void)finishWriting {
-    if ( !_writing ) return;
+    if ( !OSAtomicCompareAndSwap32Barrier(YES, NO, &_writing) ) return;
+    
+    // Wait for the audio thread to leave AEAudioFileWriterAddAudio: once it has, it will see that
+    // we're no longer writing, and won't touch the buffer again
+    while ( _activeAddCount > 0 ) {
+        usleep(1000);
+    }
+    
+    [_writerThread cancel];
+    while ( [_writerThread isExecuting] ) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    _writerThread = nil;
+    
+    // Write out whatever remains
+    pthread_mutex_lock(&_fileMutex);
+    drainBuffer(self, YES);
+    pthread_mutex_unlock(&_fileMutex);
+    
+    closeFile(self);
+    
+    if ( _buffer ) {
+        _overflowCount = (NSUInteger)AEAudioFileWriterBufferGetOverflowCount(_buffer);
+        _overflowFrameCount = AEAudioFileWriterBufferGetOverflowFrameCount(_buffer);
+        _bufferHighWaterMark = [self bufferHighWaterMark];
+        AEAudioFileWriterBufferFree(_buffer);
+        _buffer = NULL;
+    }
+}
+
+-(NSUInteger)overflowCount {
+    return _buffer ? (NSUInteger)AEAudioFileWriterBufferGetOverflowCount(_buffer) : _overflowCount;
+}
+
+-(UInt64)overflowFrameCount {
+    return _buffer ? AEAudioFileWriterBufferGetOverflowFrameCount(_buffer) : _overflowFrameCount;
+}
+
+-(double)bufferHighWaterMark {
+    return _buffer
+        ? (double)AEAudioFileWriterBufferGetHighWaterMark(_buffer) / (double)AEAudioFileWriterBufferGetCapacity(_buffer)
+        : _bufferHighWaterMark;
+}
+
+static BOOL pcmFileTypeForAudioFileType(AudioFileTypeID fileType, AEPCMFileType *pcmFileType) {
+    switch ( fileType ) {
+        case kAudioFileWAVEType: *pcmFileType = AEPCMFileTypeWAV; return YES;
+        case kAudioFileAIFFType: *pcmFileType = AEPCMFileTypeAIFF; return YES;
+        case kAudioFileCAFType:  *pcmFileType = AEPCMFileTypeCAF; return YES;
+        default: return NO;
+    }
+}
+
+static BOOL canWritePCMFileFromAudioDescription(const AudioStreamBasicDescription *audioDescription, UInt32 channels, UInt32 bits) {
+    // The PCM file writer takes packed float samples, without channel conversion
+    return audioDescription->mFormatID == kAudioFormatLinearPCM
+        && (audioDescription->mFormatFlags & kAudioFormatFlagIsFloat)
+        && audioDescription->mBitsPerChannel == 32
+        && audioDescription->mChannelsPerFrame == channels
+        && (bits == 16 || bits == 24 || bits == 32);
+}
+
+static void closeFile(__unsafe_unretained AEAudioFileWriter *THIS) {
+    if ( THIS->_pcmFile ) {
+        int result = AEPCMFileClose(THIS->_pcmFile);
+        if ( result != 0 ) {
+            NSLog(@"AEAudioFileWriter: Couldn't finalize the output file (%s)", strerror(result));
+        }
+        THIS->_pcmFile = NULL;
+    } else {
+        AECheckOSStatus(ExtAudioFileDispose(THIS->_audioFile), "AudioFileClose");
+    }
+}
 
-    _writing = NO;
+static OSStatus writeAudio(__unsafe_unretained AEAudioFileWriter *THIS, AudioBufferList *bufferList, UInt32 frames) {
+    if ( !THIS->_pcmFile ) {
+        return ExtAudioFileWrite(THIS->_audioFile, frames, bufferList);
+    }
     
-    AECheckOSStatus(ExtAudioFileDispose(_audioFile), "AudioFileClose");
+    const float *buffers[bufferList->mNumberBuffers];
+    for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
+        buffers[i] = bufferList->mBuffers[i].mData;
+    }
+    int result = AEPCMFileWriteFloat(THIS->_pcmFile, buffers, bufferList->mNumberBuffers, frames);
+    return result == 0 ? noErr : result == EINVAL ? kAudio_ParamError : kAudioFileUnspecifiedError;
+}
+
+static int writeChunk(void *context, void * const *buffers, uint32_t frames) {
+    __unsafe_unretained AEAudioFileWriter *THIS = (__bridge AEAudioFileWriter*)context;
+    AEAudioBufferListCreateOnStack(bufferList, THIS->_audioDescription);
+    int channelsPerBuffer = (THIS->_audioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? 1 : THIS->_audioDescription.mChannelsPerFrame;
+    for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
+        bufferList->mBuffers[i].mData = buffers[i];
+        bufferList->mBuffers[i].mNumberChannels = channelsPerBuffer;
+        bufferList->mBuffers[i].mDataByteSize = frames * THIS->_audioDescription.mBytesPerFrame;
+    }
+    
+    AETraceBegin("ExtAudioFileWrite");
+    OSStatus status = writeAudio(THIS, bufferList, frames);
+    AETraceEnd("ExtAudioFileWrite");
+    if ( !AECheckOSStatus(status, "ExtAudioFileWrite") ) {
+        THIS->_writeStatus = status;
+    }
+    return (int)status;
+}
+
+static void drainBuffer(__unsafe_unretained AEAudioFileWriter *THIS, BOOL all) {
+    if ( !THIS->_buffer ) return;
+    AEAudioFileWriterBufferDrain(THIS->_buffer, all);
+}
+
+static void commitIfDue(__unsafe_unretained AEAudioFileWriter *THIS) {
+    if ( !THIS->_journaled || !THIS->_pcmFile ) return;
+    
+    double now = AECurrentTimeInSeconds();
+    if ( now - THIS->_lastCommitTime < THIS->_syncInterval ) return;
+    THIS->_lastCommitTime = now;
+    
+    // Commit everything received so far, and wait for it to reach the disk
+    drainBuffer(THIS, YES);
+    AETraceBegin("AEPCMFileCommit");
+    int result = AEPCMFileCommit(THIS->_pcmFile, true);
+    AETraceEnd("AEPCMFileCommit");
+    if ( result != 0 ) {
+        NSLog(@"AEAudioFileWriter: Couldn't commit the output file (%s)", strerror(result));
+        THIS->_writeStatus = kAudioFileUnspecifiedError;
+    }
+}
+
+static void serviceBuffer(__unsafe_unretained AEAudioFileWriter *THIS) {
+    pthread_mutex_lock(&THIS->_fileMutex);
+    drainBuffer(THIS, NO);
+    commitIfDue(THIS);
+    pthread_mutex_unlock(&THIS->_fileMutex);
 }
 
 OSStatus AEAudioFileWriterAddAudio(__unsafe_unretained AEAudioFileWriter* THIS, AudioBufferList *bufferList, UInt32 lengthInFrames) {
-    return ExtAudioFileWriteAsync(THIS->_audioFile, lengthInFrames, bufferList);
+    // Announce ourselves before looking at the state, so finishWriting can wait for us to leave
+    OSAtomicIncrement32Barrier(&THIS->_activeAddCount);
+    
+    OSStatus status;
+    if ( !THIS->_writing ) {
+        status = kAudioFileNotOpenError;
+    } else if ( !THIS->_buffer ) {
+        status = kAudioFileOperationNotSupportedError;
+    } else {
+        AETraceBegin("AEAudioFileWriterAddAudio");
+        const void *buffers[bufferList->mNumberBuffers];
+        for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
+            buffers[i] = bufferList->mBuffers[i].mData;
+        }
+        // If the writer thread isn't keeping up, the audio is dropped and counted as an overflow
+        AEAudioFileWriterBufferAdd(THIS->_buffer, buffers, lengthInFrames);
+        status = THIS->_writeStatus;
+        AETraceEnd("AEAudioFileWriterAddAudio");
+    }
+    
+    OSAtomicDecrement32Barrier(&THIS->_activeAddCount);
+    return status;
 }
 
 OSStatus AEAudioFileWriterAddAudioSynchronously(__unsafe_unretained AEAudioFileWriter* THIS, AudioBufferList *bufferList, UInt32 lengthInFrames) {
-    return ExtAudioFileWrite(THIS->_audioFile, lengthInFrames, bufferList);
+    if ( !THIS->_writing ) return kAudioFileNotOpenError;
+    
+    AETraceBegin("AEAudioFileWriterAddAudioSynchronously");
+    
+    // Write out anything queued asynchronously first, to keep audio in order
+    pthread_mutex_lock(&THIS->_fileMutex);
+    drainBuffer(THIS, YES);
+    OSStatus status = writeAudio(THIS, bufferList, lengthInFrames);
+    commitIfDue(THIS);
+    pthread_mutex_unlock(&THIS->_fileMutex);
+    
+    AETraceEnd("AEAudioFileWriterAddAudioSynchronously");
+    return status;
+}
+
+@end
+
+@implementation AEAudioFileWriterThread {
+    __unsafe_unretained AEAudioFileWriter *_writer;
+}
+
+- (id)initWithWriter:(AEAudioFileWriter *)writer {
+    if ( !(self = [super init]) ) return nil;
+    _writer = writer;
+    self.qualityOfService = NSQualityOfServiceUtility;
+    return self;
+}
+
+- (void)main {
+    @autoreleasepool {
+        pthread_setname_np("com.theamazingaudioengine.AEAudioFileWriterThread");
+        while ( !self.isCancelled ) {
+            // The writer stops this thread before it goes away
+            serviceBuffer(_writer);
+            usleep(kWriterPollInterval*1.0e6);
+        }
+    }
 }
 
 @end
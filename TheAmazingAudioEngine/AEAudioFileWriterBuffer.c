@@ -0,0 +1,175 @@
+//
+//  AEAudioFileWriterBuffer.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AEAudioFileWriterBuffer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+struct AEAudioFileWriterBuffer {
+    uint32_t            bufferCount;
+    uint32_t            bytesPerFrame;
+    uint32_t            capacityFrames;
+    uint32_t            chunkFrames;
+    AEAudioFileWriterBufferSink sink;
+    void               *context;
+
+    // Ring, per buffer, capacityFrames frames. The head is advanced by the producer, the
+    // tail by the consumer; both count frames from the start, and never wrap
+    char               *ring;
+    volatile int64_t    head;
+    volatile int64_t    tail;
+
+    // Consumer state
+    char               *chunk;              // Per buffer, chunkFrames frames
+    void              **pointers;
+    volatile int        sinkError;
+
+    // Producer statistics
+    volatile uint64_t   overflowCount;
+    volatile uint64_t   overflowFrameCount;
+    volatile uint32_t   highWaterMark;
+};
+
+AEAudioFileWriterBuffer *AEAudioFileWriterBufferNew(uint32_t bufferCount, uint32_t bytesPerFrame, uint32_t capacityFrames,
+                                                    uint32_t chunkFrames, AEAudioFileWriterBufferSink sink, void *context) {
+    if ( bufferCount == 0 || bytesPerFrame == 0 || capacityFrames == 0 || chunkFrames == 0 || !sink ) return NULL;
+
+    AEAudioFileWriterBuffer *buffer = (AEAudioFileWriterBuffer*)calloc(1, sizeof(AEAudioFileWriterBuffer));
+    if ( !buffer ) return NULL;
+    buffer->bufferCount = bufferCount;
+    buffer->bytesPerFrame = bytesPerFrame;
+    buffer->capacityFrames = capacityFrames;
+    buffer->chunkFrames = chunkFrames;
+    buffer->sink = sink;
+    buffer->context = context;
+
+    buffer->ring = (char*)malloc((size_t)bufferCount * capacityFrames * bytesPerFrame);
+    buffer->chunk = (char*)malloc((size_t)bufferCount * chunkFrames * bytesPerFrame);
+    buffer->pointers = (void**)calloc(bufferCount, sizeof(void*));
+    if ( !buffer->ring || !buffer->chunk || !buffer->pointers ) {
+        AEAudioFileWriterBufferFree(buffer);
+        return NULL;
+    }
+
+    return buffer;
+}
+
+void AEAudioFileWriterBufferFree(AEAudioFileWriterBuffer *buffer) {
+    if ( !buffer ) return;
+    free(buffer->ring);
+    free(buffer->chunk);
+    free(buffer->pointers);
+    free(buffer);
+}
+
+int AEAudioFileWriterBufferAdd(AEAudioFileWriterBuffer *buffer, const void * const *buffers, uint32_t frames) {
+    int64_t head = buffer->head;
+    int64_t fill = head - buffer->tail;
+    if ( frames > buffer->capacityFrames - fill ) {
+        // Writer isn't keeping up: drop this audio
+        __sync_add_and_fetch(&buffer->overflowCount, 1);
+        __sync_add_and_fetch(&buffer->overflowFrameCount, frames);
+        return ENOBUFS;
+    }
+
+    // Make sure we've seen the consumer finish with the space before reusing it
+    __sync_synchronize();
+
+    uint32_t offset = (uint32_t)(head % buffer->capacityFrames);
+    uint32_t firstFrames = frames < buffer->capacityFrames - offset ? frames : buffer->capacityFrames - offset;
+    size_t ringBytes = (size_t)buffer->capacityFrames * buffer->bytesPerFrame;
+    for ( uint32_t i=0; i<buffer->bufferCount; i++ ) {
+        char *ring = buffer->ring + i * ringBytes;
+        memcpy(ring + (size_t)offset * buffer->bytesPerFrame, buffers[i], (size_t)firstFrames * buffer->bytesPerFrame);
+        memcpy(ring, (const char*)buffers[i] + (size_t)firstFrames * buffer->bytesPerFrame,
+               (size_t)(frames - firstFrames) * buffer->bytesPerFrame);
+    }
+
+    // Publish the audio
+    __sync_synchronize();
+    buffer->head = head + frames;
+
+    if ( fill + frames > buffer->highWaterMark ) {
+        buffer->highWaterMark = (uint32_t)(fill + frames);
+    }
+
+    return 0;
+}
+
+void AEAudioFileWriterBufferDrain(AEAudioFileWriterBuffer *buffer, bool all) {
+    size_t ringBytes = (size_t)buffer->capacityFrames * buffer->bytesPerFrame;
+    size_t chunkBytes = (size_t)buffer->chunkFrames * buffer->bytesPerFrame;
+
+    // Pass audio on in large chunks, to keep the number of writes (and the disk) happy
+    while ( 1 ) {
+        int64_t tail = buffer->tail;
+        int64_t fill = buffer->head - tail;
+        if ( fill == 0 || (!all && fill < buffer->chunkFrames) ) break;
+
+        // Make sure we see the audio the producer published
+        __sync_synchronize();
+
+        uint32_t frames = fill < buffer->chunkFrames ? (uint32_t)fill : buffer->chunkFrames;
+        uint32_t offset = (uint32_t)(tail % buffer->capacityFrames);
+        uint32_t firstFrames = frames < buffer->capacityFrames - offset ? frames : buffer->capacityFrames - offset;
+        for ( uint32_t i=0; i<buffer->bufferCount; i++ ) {
+            char *ring = buffer->ring + i * ringBytes;
+            char *chunk = buffer->chunk + i * chunkBytes;
+            memcpy(chunk, ring + (size_t)offset * buffer->bytesPerFrame, (size_t)firstFrames * buffer->bytesPerFrame);
+            memcpy(chunk + (size_t)firstFrames * buffer->bytesPerFrame, ring, (size_t)(frames - firstFrames) * buffer->bytesPerFrame);
+            buffer->pointers[i] = chunk;
+        }
+
+        // Free up the space before the (possibly slow) write, so the producer can keep going
+        __sync_synchronize();
+        buffer->tail = tail + frames;
+
+        int result = buffer->sink(buffer->context, buffer->pointers, frames);
+        if ( result != 0 ) {
+            buffer->sinkError = result;
+        }
+    }
+}
+
+int AEAudioFileWriterBufferGetSinkError(AEAudioFileWriterBuffer *buffer) {
+    return buffer->sinkError;
+}
+
+uint64_t AEAudioFileWriterBufferGetOverflowCount(AEAudioFileWriterBuffer *buffer) {
+    return buffer->overflowCount;
+}
+
+uint64_t AEAudioFileWriterBufferGetOverflowFrameCount(AEAudioFileWriterBuffer *buffer) {
+    return buffer->overflowFrameCount;
+}
+
+uint32_t AEAudioFileWriterBufferGetHighWaterMark(AEAudioFileWriterBuffer *buffer) {
+    return buffer->highWaterMark;
+}
+
+uint32_t AEAudioFileWriterBufferGetCapacity(AEAudioFileWriterBuffer *buffer) {
+    return buffer->capacityFrames;
+}
@@ -0,0 +1,130 @@
+//
+//  AEAudioFileWriterBuffer.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * Destination of audio drained from a file writer buffer
+ *
+ *  Called on the writer thread only.
+ *
+ * @param context   The context
+ * @param buffers   Audio, one buffer per buffer of the stream's format
+ * @param frames    Number of frames
+ * @return 0 on success, or an error code
+ */
+typedef int (*AEAudioFileWriterBufferSink)(void *context, void * const *buffers, uint32_t frames);
+
+/*!
+ * File writer buffer
+ *
+ *  The portable core of @link AEAudioFileWriter @endlink: a preallocated, lock-free ring
+ *  filled on the audio thread, and drained to a sink in large chunks on a writer thread.
+ *
+ *  Adding audio never allocates, locks or makes a system call, however long the sink takes.
+ *  When the ring is full, the audio is dropped and counted as an overflow instead.
+ *
+ *  There's one producer, which calls @link AEAudioFileWriterBufferAdd @endlink, and one
+ *  consumer, which calls @link AEAudioFileWriterBufferDrain @endlink. Audio is handled as
+ *  opaque frames of bytes, in one or more buffers (one per channel for non-interleaved audio).
+ */
+typedef struct AEAudioFileWriterBuffer AEAudioFileWriterBuffer;
+
+/*!
+ * Create a file writer buffer
+ *
+ * @param bufferCount       Number of buffers of audio per frame (the channel count, for non-interleaved audio)
+ * @param bytesPerFrame     Bytes per frame, in each buffer
+ * @param capacityFrames    Frames of audio the ring can hold
+ * @param chunkFrames       Frames to pass to the sink at a time
+ * @param sink              The destination of the audio
+ * @param context           Context for the sink
+ * @return The buffer, or NULL on allocation failure
+ */
+AEAudioFileWriterBuffer *AEAudioFileWriterBufferNew(uint32_t bufferCount, uint32_t bytesPerFrame, uint32_t capacityFrames,
+                                                    uint32_t chunkFrames, AEAudioFileWriterBufferSink sink, void *context);
+
+/*!
+ * Free a file writer buffer
+ *
+ *  Make sure neither the producer nor the consumer is using it.
+ */
+void AEAudioFileWriterBufferFree(AEAudioFileWriterBuffer *buffer);
+
+/*!
+ * Add audio
+ *
+ *  Use on the producer (audio) thread.
+ *
+ * @param buffer    The buffer
+ * @param buffers   Audio, one buffer per buffer of the stream's format
+ * @param frames    Number of frames
+ * @return 0 on success, or ENOBUFS if the ring was full and the audio was dropped
+ */
+int AEAudioFileWriterBufferAdd(AEAudioFileWriterBuffer *buffer, const void * const *buffers, uint32_t frames);
+
+/*!
+ * Pass buffered audio to the sink
+ *
+ *  Use on the consumer (writer) thread.
+ *
+ * @param buffer    The buffer
+ * @param all       Whether to drain everything; otherwise, only whole chunks are drained
+ */
+void AEAudioFileWriterBufferDrain(AEAudioFileWriterBuffer *buffer, bool all);
+
+/*!
+ * Get the most recent error returned by the sink, or 0 if there was none
+ */
+int AEAudioFileWriterBufferGetSinkError(AEAudioFileWriterBuffer *buffer);
+
+/*!
+ * Get the number of times audio was dropped because the ring was full
+ */
+uint64_t AEAudioFileWriterBufferGetOverflowCount(AEAudioFileWriterBuffer *buffer);
+
+/*!
+ * Get the number of frames dropped because the ring was full
+ */
+uint64_t AEAudioFileWriterBufferGetOverflowFrameCount(AEAudioFileWriterBuffer *buffer);
+
+/*!
+ * Get the most frames ever held in the ring at once
+ */
+uint32_t AEAudioFileWriterBufferGetHighWaterMark(AEAudioFileWriterBuffer *buffer);
+
+/*!
+ * Get the number of frames the ring can hold
+ */
+uint32_t AEAudioFileWriterBufferGetCapacity(AEAudioFileWriterBuffer *buffer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,127 @@
+//
+//  AEAudioSampleCache.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+#import "AEAudioBufferManager.h"
+
+/*!
+ * Decoded sample cache
+ *
+ *  This class keeps decoded audio files in memory, so that a sample used by many players
+ *  is decoded and stored only once. Entries are identified by the file's identity on disk
+ *  (its device and inode), its modification date, and the target audio format, so a file
+ *  which is edited or replaced is decoded afresh.
+ *
+ *  Decoded audio is returned as an AEAudioBufferManager, shared by all users of the
+ *  sample. Treat its audio as read-only. Memory is freed once the cache and all
+ *  users have released the buffer.
+ *
+ *  The cache holds on to recently-used samples up to its @link memoryBudget @endlink,
+ *  evicting the least recently used beyond that. Samples still in use by players stay
+ *  in memory when evicted, but are no longer counted by the cache.
+ *
+ *  If @link diskCacheURL @endlink is set, decoded audio is also saved to disk, so that
+ *  later loads, including in later launches, read the converted audio instead of
+ *  decoding it again.
+ *
+ *  AEMemoryBufferPlayer and AESequencerChannel load their audio through the shared cache.
+ */
+@interface AEAudioSampleCache : NSObject
+
+/*!
+ * The shared cache
+ */
++ (AEAudioSampleCache*)sharedCache;
+
+/*!
+ * Get decoded audio for a file, loading it if necessary
+ *
+ *  If another thread is already loading the same sample, this waits for it to finish
+ *  rather than decoding the file a second time. Don't call this on the audio thread.
+ *
+ * @param url               URL to the file
+ * @param audioDescription  The target audio format
+ * @param lengthInFrames    On output, if not NULL, the length of the audio in frames
+ * @param error             On output, if not NULL, the error if one occurred
+ * @return The decoded audio, or nil on error
+ */
+- (AEAudioBufferManager*)audioBufferForFileAtURL:(NSURL*)url
+                                audioDescription:(AudioStreamBasicDescription)audioDescription
+                                  lengthInFrames:(UInt32*)lengthInFrames
+                                           error:(NSError**)error;
+
+/*!
+ * Get decoded audio for a file asynchronously
+ *
+ * @param url               URL to the file
+ * @param audioDescription  The target audio format
+ * @param completionBlock   Block to call on the main thread with the decoded audio and its
+ *                          length in frames, or the error if one occurred
+ */
+- (void)beginLoadingAudioFileAtURL:(NSURL*)url
+                  audioDescription:(AudioStreamBasicDescription)audioDescription
+                   completionBlock:(void(^)(AEAudioBufferManager *buffer, UInt32 lengthInFrames, NSError *error))completionBlock;
+
+/*!
+ * Remove all samples from memory
+ *
+ *  Samples still in use stay in memory until released. The disk cache is untouched.
+ */
+- (void)removeAllObjects;
+
+/*!
+ * Remove all samples from the disk cache
+ */
+- (void)removeAllObjectsFromDisk;
+
+/*!
+ * Memory budget, in bytes
+ *
+ *  Default is 64 MB.
+ */
+@property (nonatomic, assign) NSUInteger memoryBudget;
+
+/*!
+ * Bytes of decoded audio currently held by the cache
+ */
+@property (nonatomic, readonly) NSUInteger memoryUsage;
+
+/*!
+ * Directory in which to keep decoded audio on disk, or nil to disable the disk cache
+ *
+ *  The directory is created if necessary. Default is nil.
+ */
+@property (nonatomic, strong) NSURL *diskCacheURL;
+
+@end
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,338 @@
+//
+//  AEAudioSampleCache.m
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#import "AEAudioSampleCache.h"
+#import "AEAudioFileLoaderOperation.h"
+#import "AEUtilities.h"
+#include <sys/stat.h>
+
+static const NSUInteger kDefaultMemoryBudget = 64 * 1024 * 1024;
+static const UInt32 kDiskCacheMagic          = 'AESC';
+static const UInt32 kDiskCacheVersion        = 1;
+
+/*!
+ * Cache key: identifies a file's contents, converted to a particular format
+ */
+typedef struct {
+    dev_t                       device;
+    ino_t                       inode;
+    struct timespec             modificationTime;
+    off_t                       size;
+    AudioStreamBasicDescription audioDescription;
+} sample_key_t;
+
+/*!
+ * Disk cache file header, followed by each buffer's audio in turn
+ */
+typedef struct {
+    UInt32 magic;
+    UInt32 version;
+    UInt32 lengthInFrames;
+    UInt32 numberOfBuffers;
+    UInt32 bytesPerBuffer;
+} disk_cache_header_t;
+
+@interface AEAudioSampleCacheEntry : NSObject
+@property (nonatomic, strong) AEAudioBufferManager *buffer;
+@property (nonatomic, assign) UInt32 lengthInFrames;
+@property (nonatomic, assign) NSUInteger cost;
+@end
+
+@implementation AEAudioSampleCacheEntry
+@end
+
+@interface AEAudioSampleCache () {
+    NSCondition          *_condition;
+    NSMutableDictionary  *_entries;
+    NSMutableOrderedSet  *_recentlyUsedKeys;
+    NSMutableSet         *_loadingKeys;
+    NSUInteger            _memoryUsage;
+}
+@end
+
+@implementation AEAudioSampleCache
+
++ (AEAudioSampleCache *)sharedCache {
+    static AEAudioSampleCache *__sharedCache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        __sharedCache = [[AEAudioSampleCache alloc] init];
+    });
+    return __sharedCache;
+}
+
+- (instancetype)init {
+    if ( !(self = [super init]) ) return nil;
+    _condition = [[NSCondition alloc] init];
+    _entries = [NSMutableDictionary dictionary];
+    _recentlyUsedKeys = [NSMutableOrderedSet orderedSet];
+    _loadingKeys = [NSMutableSet set];
+    _memoryBudget = kDefaultMemoryBudget;
+    return self;
+}
+
+- (AEAudioBufferManager *)audioBufferForFileAtURL:(NSURL *)url
+                                 audioDescription:(AudioStreamBasicDescription)audioDescription
+                                   lengthInFrames:(UInt32 *)lengthInFrames
+                                            error:(NSError **)error {
+
+    NSData *key = [self keyForFileAtURL:url audioDescription:audioDescription error:error];
+    if ( !key ) return nil;
+
+    [_condition lock];
+
+    // Wait for anyone else loading this sample
+    while ( [_loadingKeys containsObject:key] ) {
+        [_condition wait];
+    }
+
+    AEAudioSampleCacheEntry *entry = _entries[key];
+    if ( entry ) {
+        [_recentlyUsedKeys removeObject:key];
+        [_recentlyUsedKeys addObject:key];
+        [_condition unlock];
+        if ( lengthInFrames ) *lengthInFrames = entry.lengthInFrames;
+        return entry.buffer;
+    }
+
+    [_loadingKeys addObject:key];
+    [_condition unlock];
+
+    // Load from the disk cache, or decode
+    NSURL *diskCacheFileURL = [self diskCacheFileURLForKey:key];
+    entry = diskCacheFileURL ? [self loadEntryFromDiskCacheFileAtURL:diskCacheFileURL audioDescription:audioDescription] : nil;
+    NSError *loadError = nil;
+
+    if ( !entry ) {
+        AEAudioFileLoaderOperation *operation = [[AEAudioFileLoaderOperation alloc] initWithFileURL:url targetAudioDescription:audioDescription];
+        operation.decodeInParallel = YES;
+        [operation start];
+
+        if ( operation.error ) {
+            loadError = operation.error;
+        } else {
+            // The loader allocates for the estimated length, which may be more than was decoded
+            AEAudioBufferListSetLength(operation.bufferList, audioDescription, operation.lengthInFrames);
+
+            entry = [[AEAudioSampleCacheEntry alloc] init];
+            entry.buffer = [[AEAudioBufferManager alloc] initWithBufferList:operation.bufferList];
+            entry.lengthInFrames = operation.lengthInFrames;
+            entry.cost = (NSUInteger)operation.lengthInFrames * audioDescription.mBytesPerFrame * operation.bufferList->mNumberBuffers;
+
+            if ( diskCacheFileURL ) {
+                [self saveEntry:entry audioDescription:audioDescription toDiskCacheFileAtURL:diskCacheFileURL];
+            }
+        }
+    }
+
+    [_condition lock];
+    if ( entry ) {
+        _entries[key] = entry;
+        [_recentlyUsedKeys addObject:key];
+        _memoryUsage += entry.cost;
+        [self evictToBudget];
+    }
+    [_loadingKeys removeObject:key];
+    [_condition broadcast];
+    [_condition unlock];
+
+    if ( !entry ) {
+        if ( error ) *error = loadError;
+        return nil;
+    }
+
+    if ( lengthInFrames ) *lengthInFrames = entry.lengthInFrames;
+    return entry.buffer;
+}
+
+- (void)beginLoadingAudioFileAtURL:(NSURL *)url
+                  audioDescription:(AudioStreamBasicDescription)audioDescription
+                   completionBlock:(void (^)(AEAudioBufferManager *, UInt32, NSError *))completionBlock {
+    completionBlock = [completionBlock copy];
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        UInt32 lengthInFrames = 0;
+        NSError *error = nil;
+        AEAudioBufferManager *buffer = [self audioBufferForFileAtURL:url audioDescription:audioDescription lengthInFrames:&lengthInFrames error:&error];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completionBlock(buffer, lengthInFrames, error);
+        });
+    });
+}
+
+- (void)removeAllObjects {
+    [_condition lock];
+    [_entries removeAllObjects];
+    [_recentlyUsedKeys removeAllObjects];
+    _memoryUsage = 0;
+    [_condition unlock];
+}
+
+- (void)removeAllObjectsFromDisk {
+    if ( !_diskCacheURL ) return;
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    for ( NSURL *url in [fileManager contentsOfDirectoryAtURL:_diskCacheURL includingPropertiesForKeys:nil options:0 error:NULL] ) {
+        if ( [url.pathExtension isEqualToString:@"pcm"] ) {
+            [fileManager removeItemAtURL:url error:NULL];
+        }
+    }
+}
+
+-(void)setMemoryBudget:(NSUInteger)memoryBudget {
+    [_condition lock];
+    _memoryBudget = memoryBudget;
+    [self evictToBudget];
+    [_condition unlock];
+}
+
+-(NSUInteger)memoryUsage {
+    [_condition lock];
+    NSUInteger usage = _memoryUsage;
+    [_condition unlock];
+    return usage;
+}
+
+-(void)setDiskCacheURL:(NSURL *)diskCacheURL {
+    if ( diskCacheURL ) {
+        [[NSFileManager defaultManager] createDirectoryAtURL:diskCacheURL withIntermediateDirectories:YES attributes:nil error:NULL];
+    }
+    _diskCacheURL = diskCacheURL;
+}
+
+#pragma mark - Helpers
+
+- (NSData*)keyForFileAtURL:(NSURL*)url audioDescription:(AudioStreamBasicDescription)audioDescription error:(NSError**)error {
+    BOOL holdingSecurityResource = [url startAccessingSecurityScopedResource];
+    struct stat fileInfo;
+    int result = stat([url fileSystemRepresentation], &fileInfo);
+    int errorCode = errno;
+    if ( holdingSecurityResource ) [url stopAccessingSecurityScopedResource];
+
+    if ( result != 0 ) {
+        if ( error ) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errorCode
+                                              userInfo:@{ NSLocalizedDescriptionKey: NSLocalizedString(@"Couldn't open the audio file", @"") }];
+        return nil;
+    }
+
+    sample_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.device = fileInfo.st_dev;
+    key.inode = fileInfo.st_ino;
+    key.modificationTime = fileInfo.st_mtimespec;
+    key.size = fileInfo.st_size;
+    key.audioDescription = audioDescription;
+    return [NSData dataWithBytes:&key length:sizeof(key)];
+}
+
+- (void)evictToBudget {
+    while ( _memoryUsage > _memoryBudget && _recentlyUsedKeys.count > 0 ) {
+        NSData *key = _recentlyUsedKeys.firstObject;
+        AEAudioSampleCacheEntry *entry = _entries[key];
+        _memoryUsage -= entry.cost;
+        [_entries removeObjectForKey:key];
+        [_recentlyUsedKeys removeObjectAtIndex:0];
+    }
+}
+
+- (NSURL*)diskCacheFileURLForKey:(NSData*)keyData {
+    NSURL *diskCacheURL = _diskCacheURL;
+    if ( !diskCacheURL ) return nil;
+
+    const sample_key_t *key = keyData.bytes;
+    const AudioStreamBasicDescription *format = &key->audioDescription;
+    NSString *name = [NSString stringWithFormat:@"%llx-%llx-%lx.%lx-%llx-%g-%x-%x-%u-%u.pcm",
+                      (unsigned long long)key->device, (unsigned long long)key->inode,
+                      (long)key->modificationTime.tv_sec, (long)key->modificationTime.tv_nsec, (unsigned long long)key->size,
+                      format->mSampleRate, (unsigned int)format->mFormatID, (unsigned int)format->mFormatFlags,
+                      (unsigned int)format->mBitsPerChannel, (unsigned int)format->mChannelsPerFrame];
+    return [diskCacheURL URLByAppendingPathComponent:name];
+}
+
+- (AEAudioSampleCacheEntry*)loadEntryFromDiskCacheFileAtURL:(NSURL*)url audioDescription:(AudioStreamBasicDescription)audioDescription {
+    FILE *file = fopen([url fileSystemRepresentation], "r");
+    if ( !file ) return nil;
+
+    disk_cache_header_t header;
+    if ( fread(&header, sizeof(header), 1, file) != 1
+            || header.magic != kDiskCacheMagic
+            || header.version != kDiskCacheVersion
+            || header.bytesPerBuffer != header.lengthInFrames * audioDescription.mBytesPerFrame ) {
+        fclose(file);
+        return nil;
+    }
+
+    AudioBufferList *bufferList = AEAudioBufferListCreate(audioDescription, header.lengthInFrames);
+    if ( !bufferList || bufferList->mNumberBuffers != header.numberOfBuffers ) {
+        if ( bufferList ) AEAudioBufferListFree(bufferList);
+        fclose(file);
+        return nil;
+    }
+
+    for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
+        if ( fread(bufferList->mBuffers[i].mData, 1, header.bytesPerBuffer, file) != header.bytesPerBuffer ) {
+            AEAudioBufferListFree(bufferList);
+            fclose(file);
+            return nil;
+        }
+    }
+    fclose(file);
+
+    AEAudioSampleCacheEntry *entry = [[AEAudioSampleCacheEntry alloc] init];
+    entry.buffer = [[AEAudioBufferManager alloc] initWithBufferList:bufferList];
+    entry.lengthInFrames = header.lengthInFrames;
+    entry.cost = (NSUInteger)header.bytesPerBuffer * header.numberOfBuffers;
+    return entry;
+}
+
+- (void)saveEntry:(AEAudioSampleCacheEntry*)entry audioDescription:(AudioStreamBasicDescription)audioDescription toDiskCacheFileAtURL:(NSURL*)url {
+    AudioBufferList *bufferList = AEAudioBufferManagerGetBuffer(entry.buffer);
+
+    // Write to a temporary file, then move into place, so a partial file is never read
+    NSString *temporaryPath = [[url path] stringByAppendingString:@".tmp"];
+    FILE *file = fopen([temporaryPath fileSystemRepresentation], "w");
+    if ( !file ) return;
+
+    disk_cache_header_t header = {
+        .magic = kDiskCacheMagic,
+        .version = kDiskCacheVersion,
+        .lengthInFrames = entry.lengthInFrames,
+        .numberOfBuffers = bufferList->mNumberBuffers,
+        .bytesPerBuffer = entry.lengthInFrames * audioDescription.mBytesPerFrame
+    };
+
+    BOOL success = fwrite(&header, sizeof(header), 1, file) == 1;
+    for ( int i=0; success && i<bufferList->mNumberBuffers; i++ ) {
+        success = fwrite(bufferList->mBuffers[i].mData, 1, header.bytesPerBuffer, file) == header.bytesPerBuffer;
+    }
+
+    if ( fclose(file) != 0 ) success = NO;
+
+    if ( success ) {
+        rename([temporaryPath fileSystemRepresentation], [url fileSystemRepresentation]);
+    } else {
+        unlink([temporaryPath fileSystemRepresentation]);
+    }
+}
+
+@end
@@ -18,6 +18,8 @@ extern "C" {
  */
 extern NSString const * AEBlockSchedulerKeyBlock;
 extern NSString const * AEBlockSchedulerKeyTimestampInHostTicks;
+extern NSString const * AEBlockSchedulerKeyTimestampInSampleTime;
+extern NSString const * AEBlockSchedulerKeyBeat;
 extern NSString const * AEBlockSchedulerKeyResponseBlock;
 extern NSString const * AEBlockSchedulerKeyIdentifier;
 extern NSString const * AEBlockSchedulerKeyTimingContext;
@@ -40,6 +42,17 @@ typedef void (^AEBlockSchedulerBlock)(const AudioTimeStamp *intervalStartTime, U
  */
 typedef void (^AEBlockSchedulerResponseBlock)(void);
 
+/*!
+ * Tempo map event
+ *
+ *  Describes a tempo that takes effect at a given beat, for use with
+ *  @link AEBlockScheduler::setTempoMap:count:originSampleTime: setTempoMap:count:originSampleTime: @endlink.
+ */
+typedef struct {
+    double beat;    //!< The beat at which the tempo takes effect
+    double tempo;   //!< The tempo, in beats per minute
+} AEBlockSchedulerTempoEvent;
+
 /*!
  * Block scheduler
  *
@@ -50,6 +63,11 @@ typedef void (^AEBlockSchedulerResponseBlock)(void);
  *  receiver using AEAudioController's @link AEAudioController::addTimingReceiver: addTimingReceiver: @endlink.
  *
  *  Then begin scheduling blocks using @link scheduleBlock:atTime:timingContext:identifier: @endlink.
+ *
+ *  Blocks may also be scheduled on the sample timeline of the render thread, using
+ *  @link scheduleBlock:atSampleTime:timingContext:identifier: @endlink, or in musical time
+ *  using @link scheduleBlock:atBeat:timingContext:identifier: @endlink. These schedules fire
+ *  on an exact frame, unaffected by host clock jitter or latency compensation.
  */
 @interface AEBlockScheduler : NSObject <AEAudioTimingReceiver>
 
@@ -143,6 +161,115 @@ typedef void (^AEBlockSchedulerResponseBlock)(void);
  */
 - (void)scheduleBlock:(AEBlockSchedulerBlock)block atTime:(uint64_t)time timingContext:(AEAudioTimingContext)context identifier:(id<NSCopying>)identifier mainThreadResponseBlock:(AEBlockSchedulerResponseBlock)response;
 
+/*!
+ * Schedule a block for execution at a sample time
+ *
+ *  The sample time is that of the timestamps passed to the render thread for the given
+ *  timing context (the `mSampleTime` field of the AudioTimeStamp). Use
+ *  @link currentSampleTimeForTimingContext: @endlink to obtain the most recent sample time.
+ *
+ *  The block will be performed during the time interval containing the given sample time,
+ *  and the offset passed to the block will be the exact frame within the interval. If the
+ *  sample time has already passed, the block will be performed in the next interval with
+ *  an offset of 0.
+ *
+ *  VERY IMPORTANT NOTE: This block will be invoked on the Core Audio thread. You must never
+ *  call any Objective-C methods, allocate or free memory, or hold locks within this block,
+ *  or you will cause audio glitches to occur.
+ *
+ * @param block Block to perform
+ * @param sampleTime Sample time at which block will be performed
+ * @param context Timing context
+ * @param identifier An identifier used to refer to the schedule later, if necessary (may not be nil)
+ */
+- (void)scheduleBlock:(AEBlockSchedulerBlock)block atSampleTime:(Float64)sampleTime timingContext:(AEAudioTimingContext)context identifier:(id<NSCopying>)identifier;
+
+/*!
+ * Schedule a block for execution at a sample time, with a response block to be performed on the main thread
+ *
+ *  See @link scheduleBlock:atSampleTime:timingContext:identifier: @endlink for discussion.
+ *
+ * @param block Block to perform
+ * @param sampleTime Sample time at which block will be performed
+ * @param context Timing context
+ * @param identifier An identifier used to refer to the schedule later, if necessary (may not be nil)
+ * @param response A block to be performed on the main thread after the main block has been performed
+ */
+- (void)scheduleBlock:(AEBlockSchedulerBlock)block atSampleTime:(Float64)sampleTime timingContext:(AEAudioTimingContext)context identifier:(id<NSCopying>)identifier mainThreadResponseBlock:(AEBlockSchedulerResponseBlock)response;
+
+/*!
+ * Schedule a block for execution at a beat
+ *
+ *  The beat is converted to a sample time using the current tempo map (see
+ *  @link setTempoMap:count:originSampleTime: @endlink) when the block is scheduled, and
+ *  again whenever the tempo map changes, so the render thread only ever compares sample times.
+ *
+ *  See @link scheduleBlock:atSampleTime:timingContext:identifier: @endlink for discussion.
+ *
+ * @param block Block to perform
+ * @param beat Beat at which block will be performed
+ * @param context Timing context
+ * @param identifier An identifier used to refer to the schedule later, if necessary (may not be nil)
+ */
+- (void)scheduleBlock:(AEBlockSchedulerBlock)block atBeat:(double)beat timingContext:(AEAudioTimingContext)context identifier:(id<NSCopying>)identifier;
+
+/*!
+ * Schedule a block for execution at a beat, with a response block to be performed on the main thread
+ *
+ *  See @link scheduleBlock:atBeat:timingContext:identifier: @endlink for discussion.
+ *
+ * @param block Block to perform
+ * @param beat Beat at which block will be performed
+ * @param context Timing context
+ * @param identifier An identifier used to refer to the schedule later, if necessary (may not be nil)
+ * @param response A block to be performed on the main thread after the main block has been performed
+ */
+- (void)scheduleBlock:(AEBlockSchedulerBlock)block atBeat:(double)beat timingContext:(AEAudioTimingContext)context identifier:(id<NSCopying>)identifier mainThreadResponseBlock:(AEBlockSchedulerResponseBlock)response;
+
+/*!
+ * Set the tempo map used for musical time
+ *
+ *  The tempo map is a list of tempo events, in increasing beat order. The first event
+ *  should be at beat 0; if it isn't, its tempo is used from beat 0. Beat 0 corresponds to
+ *  the given origin sample time.
+ *
+ *  Any pending schedules created with @link scheduleBlock:atBeat:timingContext:identifier: @endlink
+ *  will be moved to the sample times corresponding to their beats under the new map.
+ *
+ *  Default is a constant 120 beats per minute, with beat 0 at sample time 0.
+ *
+ * @param events Tempo events (will be copied)
+ * @param count Number of tempo events (must be at least 1)
+ * @param originSampleTime The sample time corresponding to beat 0
+ */
+- (void)setTempoMap:(const AEBlockSchedulerTempoEvent*)events count:(int)count originSampleTime:(Float64)originSampleTime;
+
+/*!
+ * Convert a beat to a sample time, using the current tempo map
+ *
+ * @param beat The beat
+ * @return The corresponding sample time
+ */
+- (Float64)sampleTimeForBeat:(double)beat;
+
+/*!
+ * Convert a sample time to a beat, using the current tempo map
+ *
+ * @param sampleTime The sample time
+ * @return The corresponding beat
+ */
+- (double)beatForSampleTime:(Float64)sampleTime;
+
+/*!
+ * Get the most recent sample time seen for a timing context
+ *
+ *  This is the sample time at the start of the most recently rendered time interval.
+ *
+ * @param context Timing context
+ * @return The sample time, or 0 if no interval has been rendered yet
+ */
+- (Float64)currentSampleTimeForTimingContext:(AEAudioTimingContext)context;
+
 /*!
  * Obtain a list of schedules awaiting execution
  *
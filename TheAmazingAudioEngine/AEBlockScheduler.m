@@ -14,17 +14,29 @@ static double __hostTicksToSeconds = 0.0;
 static double __secondsToHostTicks = 0.0;
 
 const int kMaximumSchedules = 100;
+static const double kDefaultTempo = 120.0;
 
 NSString const * AEBlockSchedulerKeyBlock = @"block";
 NSString const * AEBlockSchedulerKeyTimestampInHostTicks = @"time";
+NSString const * AEBlockSchedulerKeyTimestampInSampleTime = @"sampleTime";
+NSString const * AEBlockSchedulerKeyBeat = @"beat";
 NSString const * AEBlockSchedulerKeyResponseBlock = @"response";
 NSString const * AEBlockSchedulerKeyIdentifier = @"identifier";
 NSString const * AEBlockSchedulerKeyTimingContext = @"context";
 
+typedef enum {
+    kScheduleTimeBaseHostTicks,
+    kScheduleTimeBaseSampleTime,
+    kScheduleTimeBaseBeats
+} ScheduleTimeBase;
+
 struct _schedule_t {
     void *block;
     void *responseBlock;
     uint64_t time;
+    Float64 sampleTime;
+    double beat;
+    ScheduleTimeBase timeBase;
     AEAudioTimingContext context;
     void *identifier;
 };
@@ -33,6 +45,10 @@ struct _schedule_t {
     struct _schedule_t _schedule[kMaximumSchedules];
     int _head;
     int _tail;
+    Float64 _currentSampleTime[2];
+    AEBlockSchedulerTempoEvent *_tempoMap;
+    int _tempoMapCount;
+    Float64 _tempoMapOriginSampleTime;
 }
 @property (nonatomic, strong) NSMutableArray *scheduledIdentifiers;
 @property (nonatomic, weak) AEAudioController *audioController;
@@ -79,6 +95,10 @@ struct _schedule_t {
     self.audioController = audioController;
     self.scheduledIdentifiers = [NSMutableArray array];
     
+    _tempoMap = malloc(sizeof(AEBlockSchedulerTempoEvent));
+    _tempoMap[0] = (AEBlockSchedulerTempoEvent) { .beat = 0, .tempo = kDefaultTempo };
+    _tempoMapCount = 1;
+    
     return self;
 }
 
@@ -92,6 +112,7 @@ struct _schedule_t {
             CFBridgingRelease(_schedule[i].identifier);
         }
     }
+    free(_tempoMap);
     self.audioController = nil;
 }
 
@@ -100,6 +121,29 @@ struct _schedule_t {
 }
 
 -(void)scheduleBlock:(AEBlockSchedulerBlock)block atTime:(uint64_t)time timingContext:(AEAudioTimingContext)context identifier:(id<NSCopying>)identifier mainThreadResponseBlock:(AEBlockSchedulerResponseBlock)response {
+    [self addSchedule:(struct _schedule_t) { .time = time, .timeBase = kScheduleTimeBaseHostTicks, .context = context }
+            withBlock:block identifier:identifier mainThreadResponseBlock:response];
+}
+
+-(void)scheduleBlock:(AEBlockSchedulerBlock)block atSampleTime:(Float64)sampleTime timingContext:(AEAudioTimingContext)context identifier:(id<NSCopying>)identifier {
+    [self scheduleBlock:block atSampleTime:sampleTime timingContext:context identifier:identifier mainThreadResponseBlock:nil];
+}
+
+-(void)scheduleBlock:(AEBlockSchedulerBlock)block atSampleTime:(Float64)sampleTime timingContext:(AEAudioTimingContext)context identifier:(id<NSCopying>)identifier mainThreadResponseBlock:(AEBlockSchedulerResponseBlock)response {
+    [self addSchedule:(struct _schedule_t) { .sampleTime = sampleTime, .timeBase = kScheduleTimeBaseSampleTime, .context = context }
+            withBlock:block identifier:identifier mainThreadResponseBlock:response];
+}
+
+-(void)scheduleBlock:(AEBlockSchedulerBlock)block atBeat:(double)beat timingContext:(AEAudioTimingContext)context identifier:(id<NSCopying>)identifier {
+    [self scheduleBlock:block atBeat:beat timingContext:context identifier:identifier mainThreadResponseBlock:nil];
+}
+
+-(void)scheduleBlock:(AEBlockSchedulerBlock)block atBeat:(double)beat timingContext:(AEAudioTimingContext)context identifier:(id<NSCopying>)identifier mainThreadResponseBlock:(AEBlockSchedulerResponseBlock)response {
+    [self addSchedule:(struct _schedule_t) { .beat = beat, .sampleTime = [self sampleTimeForBeat:beat], .timeBase = kScheduleTimeBaseBeats, .context = context }
+            withBlock:block identifier:identifier mainThreadResponseBlock:response];
+}
+
+- (void)addSchedule:(struct _schedule_t)values withBlock:(AEBlockSchedulerBlock)block identifier:(id<NSCopying>)identifier mainThreadResponseBlock:(AEBlockSchedulerResponseBlock)response {
     NSAssert(identifier != nil && block != nil, @"Identifier and block must not be nil");
     
     if ( (_head+1)%kMaximumSchedules == _tail ) {
@@ -109,11 +153,10 @@ struct _schedule_t {
     
     struct _schedule_t *schedule = &_schedule[_head];
     
+    *schedule = values;
     schedule->identifier = (__bridge_retained void*)[(NSObject*)identifier copy];
     schedule->block = (__bridge_retained void*)[block copy];
     schedule->responseBlock = response ? (__bridge_retained void*)[response copy] : NULL;
-    schedule->time = time;
-    schedule->context = context;
     
     OSMemoryBarrier();
     
@@ -121,6 +164,72 @@ struct _schedule_t {
     [_scheduledIdentifiers addObject:identifier];
 }
 
+- (void)setTempoMap:(const AEBlockSchedulerTempoEvent *)events count:(int)count originSampleTime:(Float64)originSampleTime {
+    NSAssert(events != NULL && count > 0, @"Tempo map must contain at least one event");
+    
+    AEBlockSchedulerTempoEvent *tempoMap = malloc(sizeof(AEBlockSchedulerTempoEvent) * count);
+    memcpy(tempoMap, events, sizeof(AEBlockSchedulerTempoEvent) * count);
+    free(_tempoMap);
+    _tempoMap = tempoMap;
+    _tempoMapCount = count;
+    _tempoMapOriginSampleTime = originSampleTime;
+    
+    // Resolve pending beat schedules against the new map, so the render thread still only compares sample times
+    Float64 sampleTimes[kMaximumSchedules];
+    BOOL hasBeatSchedules = NO;
+    for ( int i=_tail; i != _head; i=(i+1)%kMaximumSchedules ) {
+        if ( _schedule[i].block && _schedule[i].timeBase == kScheduleTimeBaseBeats ) {
+            sampleTimes[i] = [self sampleTimeForBeat:_schedule[i].beat];
+            hasBeatSchedules = YES;
+        }
+    }
+    
+    if ( !hasBeatSchedules ) return;
+    
+    Float64 *sampleTimes_array = sampleTimes;
+    [_audioController performSynchronousMessageExchangeWithBlock:^{
+        for ( int i=_tail; i != _head; i=(i+1)%kMaximumSchedules ) {
+            if ( _schedule[i].block && _schedule[i].timeBase == kScheduleTimeBaseBeats ) {
+                _schedule[i].sampleTime = sampleTimes_array[i];
+            }
+        }
+    }];
+}
+
+- (Float64)sampleTimeForBeat:(double)beat {
+    double framesPerSecond = _audioController.audioDescription.mSampleRate;
+    double seconds = 0;
+    for ( int i=0; i<_tempoMapCount; i++ ) {
+        double segmentStart = i == 0 ? 0 : _tempoMap[i].beat;
+        double segmentEnd = i+1 < _tempoMapCount ? _tempoMap[i+1].beat : INFINITY;
+        if ( beat <= segmentStart && i > 0 ) break;
+        seconds += (MIN(beat, segmentEnd) - segmentStart) * (60.0 / _tempoMap[i].tempo);
+    }
+    return _tempoMapOriginSampleTime + round(seconds * framesPerSecond);
+}
+
+- (double)beatForSampleTime:(Float64)sampleTime {
+    double framesPerSecond = _audioController.audioDescription.mSampleRate;
+    double seconds = (sampleTime - _tempoMapOriginSampleTime) / framesPerSecond;
+    double beat = 0;
+    for ( int i=0; i<_tempoMapCount; i++ ) {
+        double segmentStart = i == 0 ? 0 : _tempoMap[i].beat;
+        double segmentEnd = i+1 < _tempoMapCount ? _tempoMap[i+1].beat : INFINITY;
+        double secondsPerBeat = 60.0 / _tempoMap[i].tempo;
+        double segmentSeconds = (segmentEnd - segmentStart) * secondsPerBeat;
+        if ( seconds < segmentSeconds || i+1 == _tempoMapCount ) {
+            beat = segmentStart + seconds / secondsPerBeat;
+            break;
+        }
+        seconds -= segmentSeconds;
+    }
+    return beat;
+}
+
+- (Float64)currentSampleTimeForTimingContext:(AEAudioTimingContext)context {
+    return _currentSampleTime[context];
+}
+
 -(NSArray *)schedules {
 	return [NSArray arrayWithArray:_scheduledIdentifiers];
 }
@@ -174,6 +283,8 @@ struct _schedule_t {
             AEBlockSchedulerKeyIdentifier: (__bridge id)schedule->identifier,
             AEBlockSchedulerKeyResponseBlock: schedule->responseBlock ? (__bridge id)schedule->responseBlock : [NSNull null],
             AEBlockSchedulerKeyTimestampInHostTicks: @((long long)schedule->time),
+            AEBlockSchedulerKeyTimestampInSampleTime: @(schedule->sampleTime),
+            AEBlockSchedulerKeyBeat: schedule->timeBase == kScheduleTimeBaseBeats ? @(schedule->beat) : [NSNull null],
             AEBlockSchedulerKeyTimingContext: @((int)schedule->context)};
 }
 
@@ -206,21 +317,39 @@ static void timingReceiver(__unsafe_unretained AEBlockScheduler *THIS,
                            const AudioTimeStamp     *time,
                            UInt32 const              frames,
                            AEAudioTimingContext      context) {
+    // Perform all time conversion once for this interval; per-schedule work is then just comparisons
+    double framesPerHostTick = AEAudioControllerAudioDescription(audioController)->mSampleRate * __hostTicksToSeconds;
     uint64_t endTime = time->mHostTime + AEConvertFramesToSeconds(audioController, frames)*__secondsToHostTicks;
+    BOOL sampleTimeValid = time->mFlags & kAudioTimeStampSampleTimeValid;
+    Float64 startSampleTime = time->mSampleTime;
+    Float64 endSampleTime = startSampleTime + frames;
+    
+    if ( sampleTimeValid ) {
+        THIS->_currentSampleTime[context] = startSampleTime;
+    }
     
     for ( int i=THIS->_tail; i != THIS->_head; i=(i+1)%kMaximumSchedules ) {
-        if ( THIS->_schedule[i].block && THIS->_schedule[i].context == context && THIS->_schedule[i].time && endTime >= THIS->_schedule[i].time ) {
-            UInt32 offset = THIS->_schedule[i].time > time->mHostTime ? (UInt32)AEConvertSecondsToFrames(audioController, (THIS->_schedule[i].time - time->mHostTime)*__hostTicksToSeconds) : 0;
-            ((__bridge AEBlockSchedulerBlock)THIS->_schedule[i].block)(time, offset);
-            AEAudioControllerSendAsynchronousMessageToMainThread(audioController,
-                                                                 timingReceiverFinishSchedule,
-                                                                 &(struct _timingReceiverFinishSchedule_t) { .schedule = THIS->_schedule[i], .THIS = (__bridge void *)THIS },
-                                                                 sizeof(struct _timingReceiverFinishSchedule_t));
-            memset(&THIS->_schedule[i], 0, sizeof(struct _schedule_t));
-            if ( i == THIS->_tail ) {
-                while ( !THIS->_schedule[THIS->_tail].block && THIS->_tail != THIS->_head ) {
-                    THIS->_tail = (THIS->_tail + 1) % kMaximumSchedules;
-                }
+        struct _schedule_t *schedule = &THIS->_schedule[i];
+        if ( !schedule->block || schedule->context != context ) continue;
+        
+        UInt32 offset;
+        if ( schedule->timeBase == kScheduleTimeBaseHostTicks ) {
+            if ( !schedule->time || endTime < schedule->time ) continue;
+            offset = schedule->time > time->mHostTime ? (UInt32)round((schedule->time - time->mHostTime) * framesPerHostTick) : 0;
+        } else {
+            if ( !sampleTimeValid || endSampleTime <= schedule->sampleTime ) continue;
+            offset = schedule->sampleTime > startSampleTime ? (UInt32)(schedule->sampleTime - startSampleTime) : 0;
+        }
+        
+        ((__bridge AEBlockSchedulerBlock)schedule->block)(time, offset);
+        AEAudioControllerSendAsynchronousMessageToMainThread(audioController,
+                                                             timingReceiverFinishSchedule,
+                                                             &(struct _timingReceiverFinishSchedule_t) { .schedule = *schedule, .THIS = (__bridge void *)THIS },
+                                                             sizeof(struct _timingReceiverFinishSchedule_t));
+        memset(schedule, 0, sizeof(struct _schedule_t));
+        if ( i == THIS->_tail ) {
+            while ( !THIS->_schedule[THIS->_tail].block && THIS->_tail != THIS->_head ) {
+                THIS->_tail = (THIS->_tail + 1) % kMaximumSchedules;
             }
         }
     }
@@ -29,6 +29,8 @@ extern "C" {
     
 #import <Foundation/Foundation.h>
 #import "AEAudioController.h"
+#import "AEAudioBufferManager.h"
+#import "AESampleInterpolation.h"
 
 /*!
  * Memory buffer player
@@ -36,6 +38,16 @@ extern "C" {
  *  This class allows you to play a buffer containing audio, either as one-off samples, or looped.
  *  It can load any audio file format supported by iOS.
  *
+ *  Uncompressed files already in the client format can instead be memory-mapped, for
+ *  immediate playback with no decoding step, and with memory managed by the page cache
+ *  (see @link beginLoadingAudioFileAtURL:audioDescription:memoryMapped:completionBlock: @endlink).
+ *
+ *  Audio in 32-bit floating-point formats can be played at any @link rate @endlink, with
+ *  the playhead kept to a fraction of a frame and the audio interpolated between frames
+ *  (see @link interpolation @endlink), and can start at a sub-sample accurate time with
+ *  @link playAtSampleTime: @endlink. At the original rate and on whole frames, audio is
+ *  copied directly.
+ *
  *  To use, create an instance, then add it to the audio controller.
  */
 @interface AEMemoryBufferPlayer : NSObject <AEAudioPlayable>
@@ -46,6 +58,9 @@ extern "C" {
  *  This method will asynchronously load the given audio file into memory,
  *  and create an AEMemoryBufferPlayer instance when it is finished.
  *
+ *  The audio is loaded through the @link AEAudioSampleCache::sharedCache shared sample cache @endlink,
+ *  so players of the same file share one copy of the decoded audio.
+ *
  * @param url               URL to the file to load into memory
  * @param audioDescription  The target audio description to use (usually the same as AEAudioController's)
  * @param completionBlock   Block to call when the load operation has finished
@@ -54,6 +69,28 @@ extern "C" {
                   audioDescription:(AudioStreamBasicDescription)audioDescription
                    completionBlock:(void(^)(AEMemoryBufferPlayer *, NSError *))completionBlock;
 
+/*!
+ * Initialise with audio loaded from a file, optionally memory-mapping it
+ *
+ *  If memoryMapped is YES and the file contains uncompressed PCM audio in the same
+ *  sample format, sample rate and channel count as the given audio description, the file
+ *  is memory-mapped instead of being decoded: the player reads straight from the mapping,
+ *  and pages in audio ahead of the playhead as it plays. Files in other formats are
+ *  loaded into memory as usual.
+ *
+ *  As audio files store interleaved audio, mapped audio is deinterleaved as it is played
+ *  if the audio description is non-interleaved.
+ *
+ * @param url               URL to the file to load
+ * @param audioDescription  The target audio description to use (usually the same as AEAudioController's)
+ * @param memoryMapped      Whether to memory-map the file, if its format allows
+ * @param completionBlock   Block to call when the load operation has finished
+ */
++ (void)beginLoadingAudioFileAtURL:(NSURL*)url
+                  audioDescription:(AudioStreamBasicDescription)audioDescription
+                      memoryMapped:(BOOL)memoryMapped
+                   completionBlock:(void(^)(AEMemoryBufferPlayer *, NSError *))completionBlock;
+
 /*!
  * Initialise with a memory buffer
  *
@@ -65,6 +102,36 @@ extern "C" {
               audioDescription:(AudioStreamBasicDescription)audioDescription
                   freeWhenDone:(BOOL)freeWhenDone;
 
+/*!
+ * Initialise with a shared buffer
+ *
+ *  The player holds on to the buffer, and plays it without copying. The audio
+ *  is not modified, so the buffer can be shared between several players, such as
+ *  those loaded from an @link AEAudioSampleCache @endlink.
+ *
+ * @param buffer            Audio buffer
+ * @param audioDescription  The description of the audio provided
+ */
+- (instancetype)initWithSharedBuffer:(AEAudioBufferManager *)buffer
+                    audioDescription:(AudioStreamBasicDescription)audioDescription;
+
+/*!
+ * Initialise with memory-mapped audio
+ *
+ *  The buffer list is freed when this class is deallocated, but the audio it points to
+ *  belongs to the mapping, which is retained for the life of the player.
+ *
+ * @param buffer                  Audio buffer, pointing into the mapped data
+ * @param mappedData              The mapping containing the audio
+ * @param bufferAudioDescription  The description of the audio in the buffer. This may be the
+ *                                interleaved equivalent of a non-interleaved audio description.
+ * @param audioDescription        The client audio format
+ */
+- (instancetype)initWithBuffer:(AudioBufferList *)buffer
+                    mappedData:(NSData *)mappedData
+        bufferAudioDescription:(AudioStreamBasicDescription)bufferAudioDescription
+              audioDescription:(AudioStreamBasicDescription)audioDescription;
+
 /*!
  * Schedule playback for a particular time
  *
@@ -79,11 +146,40 @@ extern "C" {
  */
 - (void)playAtTime:(uint64_t)time;
 
+/*!
+ * Schedule playback for a particular sample time
+ *
+ *  Like @link playAtTime: @endlink, but with the time given on the audio controller's
+ *  sample timeline: the mSampleTime of the AudioTimeStamp passed to render callbacks.
+ *  Players started at the same sample time start on the same frame, regardless of
+ *  host clock rounding.
+ *
+ *  The time may be fractional: for floating-point audio, the first frame is then
+ *  interpolated so that the audio starts exactly at the given time.
+ *
+ * @param sampleTime The sample time at which to begin playback
+ */
+- (void)playAtSampleTime:(Float64)sampleTime;
+
 @property (nonatomic, readonly) AudioBufferList * buffer;   //!< The audio buffer
 @property (nonatomic, readonly) NSTimeInterval duration;    //!< Length of audio, in seconds
 @property (nonatomic, assign) NSTimeInterval currentTime;   //!< Current playback position, in seconds
 @property (nonatomic, readonly) AudioStreamBasicDescription audioDescription; //!< The client audio format
+@property (nonatomic, readonly) BOOL memoryMapped;          //!< Whether the audio is played from a memory-mapped file
 @property (nonatomic, readwrite) BOOL loop;                 //!< Whether to loop this track
+
+/*!
+ * Playback rate
+ *
+ *  2.0 plays an octave higher, 0.5 an octave lower. Requires a 32-bit float audio format; default 1.0.
+ *
+ *  Playback only runs forwards, so the rate must be positive: zero, negative and non-finite
+ *  rates are ignored, leaving the rate unchanged (to pause, set @link channelIsPlaying @endlink to NO instead).
+ *  Rates are limited to the range 1/1024 to 64.
+ */
+@property (nonatomic, assign) double rate;
+
+@property (nonatomic, assign) AESampleInterpolation interpolation; //!< Interpolation used when playing between frames; default AESampleInterpolationCubicHermite
 @property (nonatomic, readwrite) float volume;              //!< Track volume
 @property (nonatomic, readwrite) float pan;                 //!< Track pan
 @property (nonatomic, readwrite) BOOL channelIsPlaying;     //!< Whether the track is playing
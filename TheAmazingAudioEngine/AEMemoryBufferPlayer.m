@@ -25,33 +25,80 @@
 
 #import "AEMemoryBufferPlayer.h"
 #import "AEAudioFileLoaderOperation.h"
+#import "AEAudioSampleCache.h"
 #import "AEUtilities.h"
+#import "AESampleInterpolation.h"
 #import <libkern/OSAtomic.h>
+#include <sys/mman.h>
+
+static const UInt32 kMappedPrefetchWindowFrames = 65536;
+static const double kMinimumRate = 1.0/1024.0;
+static const double kMaximumRate = 64.0;
 
 @interface AEMemoryBufferPlayer () {
     AudioBufferList              *_audio;
     BOOL                          _freeWhenDone;
+    NSData                       *_mappedData;
+    AEAudioBufferManager         *_sharedBuffer;
+    AudioStreamBasicDescription   _bufferAudioDescription;
+    BOOL                          _deinterleave;
+    BOOL                          _canInterpolate;
+    int32_t                       _prefetchWindow;
     UInt32                        _lengthInFrames;
-    volatile int32_t              _playhead;
+    volatile int64_t              _playhead;
+    volatile AESamplePosition     _increment;
     uint64_t                      _startTime;
+    Float64                       _startSampleTime;
+    volatile BOOL                 _hasStartSampleTime;
 }
 @property (nonatomic, strong) NSURL *url;
 @end
 
 @implementation AEMemoryBufferPlayer
-@dynamic duration, currentTime;
+@dynamic duration, currentTime, rate;
+
++ (void)beginLoadingAudioFileAtURL:(NSURL *)url
+                  audioDescription:(AudioStreamBasicDescription)audioDescription
+                   completionBlock:(void (^)(AEMemoryBufferPlayer *, NSError *))completionBlock {
+    [self beginLoadingAudioFileAtURL:url audioDescription:audioDescription memoryMapped:NO completionBlock:completionBlock];
+}
 
 + (void)beginLoadingAudioFileAtURL:(NSURL *)url
                   audioDescription:(AudioStreamBasicDescription)audioDescription
+                      memoryMapped:(BOOL)memoryMapped
                    completionBlock:(void (^)(AEMemoryBufferPlayer *, NSError *))completionBlock {
     
     completionBlock = [completionBlock copy];
+    
+    if ( !memoryMapped ) {
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0), ^{
+            NSError *error = nil;
+            AEAudioBufferManager *buffer = [[AEAudioSampleCache sharedCache] audioBufferForFileAtURL:url
+                                                                                    audioDescription:audioDescription
+                                                                                      lengthInFrames:NULL
+                                                                                               error:&error];
+            if ( !buffer ) {
+                completionBlock(nil, error);
+            } else {
+                completionBlock([[AEMemoryBufferPlayer alloc] initWithSharedBuffer:buffer audioDescription:audioDescription], nil);
+            }
+        });
+        return;
+    }
+    
     dispatch_async(dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0), ^{
         AEAudioFileLoaderOperation *operation = [[AEAudioFileLoaderOperation alloc] initWithFileURL:url targetAudioDescription:audioDescription];
+        operation.memoryMapIfPossible = memoryMapped;
         [operation start];
         
         if ( operation.error ) {
             completionBlock(nil, operation.error);
+        } else if ( operation.mappedData ) {
+            AEMemoryBufferPlayer * player = [[AEMemoryBufferPlayer alloc] initWithBuffer:operation.bufferList
+                                                                              mappedData:operation.mappedData
+                                                                  bufferAudioDescription:operation.bufferListAudioDescription
+                                                                        audioDescription:audioDescription];
+            completionBlock(player, nil);
         } else {
             AEMemoryBufferPlayer * player = [[AEMemoryBufferPlayer alloc] initWithBuffer:operation.bufferList audioDescription:audioDescription freeWhenDone:YES];
             completionBlock(player, nil);
@@ -64,14 +111,48 @@
     _audio = buffer;
     _freeWhenDone = freeWhenDone;
     _audioDescription = audioDescription;
+    _bufferAudioDescription = audioDescription;
     _lengthInFrames = buffer->mBuffers[0].mDataByteSize / audioDescription.mBytesPerFrame;
+    [self setupPlayback];
+    return self;
+}
+
+- (instancetype)initWithSharedBuffer:(AEAudioBufferManager *)buffer audioDescription:(AudioStreamBasicDescription)audioDescription {
+    if ( !(self = [self initWithBuffer:AEAudioBufferManagerGetBuffer(buffer) audioDescription:audioDescription freeWhenDone:NO]) ) return nil;
+    _sharedBuffer = buffer;
+    return self;
+}
+
+- (instancetype)initWithBuffer:(AudioBufferList *)buffer
+                    mappedData:(NSData *)mappedData
+        bufferAudioDescription:(AudioStreamBasicDescription)bufferAudioDescription
+              audioDescription:(AudioStreamBasicDescription)audioDescription {
+    if ( !(self = [super init]) ) return nil;
+    _audio = buffer;
+    _mappedData = mappedData;
+    _audioDescription = audioDescription;
+    _bufferAudioDescription = bufferAudioDescription;
+    _deinterleave = (audioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved) && audioDescription.mChannelsPerFrame > 1
+                        && !(bufferAudioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved);
+    _lengthInFrames = buffer->mBuffers[0].mDataByteSize / bufferAudioDescription.mBytesPerFrame;
+    [self setupPlayback];
+    return self;
+}
+
+- (void)setupPlayback {
     _volume = 1.0;
     _channelIsPlaying = YES;
-    return self;
+    _increment = AESamplePositionOneFrame;
+    _interpolation = AESampleInterpolationCubicHermite;
+    _canInterpolate = (_audioDescription.mFormatFlags & kAudioFormatFlagIsFloat) && _audioDescription.mBitsPerChannel == 32;
+    AESampleInterpolationPrepare();
 }
 
 - (void)dealloc {
-    if ( _audio && _freeWhenDone ) {
+    if ( _audio && _mappedData ) {
+        // Audio belongs to the mapping
+        free(_audio);
+    } else if ( _audio && _freeWhenDone ) {
         for ( int i=0; i<_audio->mNumberBuffers; i++ ) {
             free(_audio->mBuffers[i].mData);
         }
@@ -79,28 +160,101 @@
     }
 }
 
+-(BOOL)memoryMapped {
+    return _mappedData != nil;
+}
+
 - (void)playAtTime:(uint64_t)time {
+    _hasStartSampleTime = NO;
     _startTime = time;
     if ( !self.channelIsPlaying ) {
         self.channelIsPlaying = YES;
     }
 }
 
+- (void)playAtSampleTime:(Float64)sampleTime {
+    _startTime = 0;
+    _startSampleTime = sampleTime;
+    OSMemoryBarrier();
+    _hasStartSampleTime = YES;
+    if ( !self.channelIsPlaying ) {
+        self.channelIsPlaying = YES;
+    }
+}
+
+-(double)rate {
+    return AESamplePositionToFrames(_increment);
+}
+
+-(void)setRate:(double)rate {
+    if ( !_canInterpolate ) return;
+    if ( !(rate > 0.0) || isinf(rate) ) {
+        // The playhead only moves forwards: pause with channelIsPlaying instead
+        NSLog(@"AEMemoryBufferPlayer: Ignoring invalid rate %f; the rate must be positive", rate);
+        return;
+    }
+    _increment = AESamplePositionFromFrames(MIN(kMaximumRate, MAX(kMinimumRate, rate)));
+}
+
 -(NSTimeInterval)duration {
     return (double)_lengthInFrames / (double)_audioDescription.mSampleRate;
 }
 
 -(NSTimeInterval)currentTime {
-    if ( _lengthInFrames == 0 ) {
-        return 0.0;
-    } else {
-        return ((double)_playhead / (double)_lengthInFrames) * self.duration;
-    }
+    return AESamplePositionToFrames(_playhead) / _audioDescription.mSampleRate;
 }
 
 -(void)setCurrentTime:(NSTimeInterval)currentTime {
     if (_lengthInFrames == 0) return;
-    _playhead = (int32_t)((currentTime / self.duration) * _lengthInFrames) % _lengthInFrames;
+    double frames = fmod(MAX(0.0, currentTime) * _audioDescription.mSampleRate, _lengthInFrames);
+    if ( !_canInterpolate ) frames = floor(frames);
+    _playhead = AESamplePositionFromFrames(frames);
+    if ( _mappedData ) {
+        prefetchMappedAudio(self, (int32_t)(_playhead >> 32));
+    }
+}
+
+static void prefetchMappedAudio(__unsafe_unretained AEMemoryBufferPlayer *THIS, int32_t frame) {
+    // Ask the VM system to page in the next couple of windows of audio from the playhead
+    size_t pageSize = getpagesize();
+    uintptr_t start = (uintptr_t)THIS->_audio->mBuffers[0].mData + (size_t)frame * THIS->_bufferAudioDescription.mBytesPerFrame;
+    uintptr_t end = (uintptr_t)THIS->_audio->mBuffers[0].mData + MIN((size_t)frame + 2*kMappedPrefetchWindowFrames, (size_t)THIS->_lengthInFrames) * THIS->_bufferAudioDescription.mBytesPerFrame;
+    start &= ~(pageSize-1);
+    if ( end <= start ) return;
+    madvise((void*)start, end - start, MADV_WILLNEED);
+}
+
+struct prefetchMappedAudio_arg { __unsafe_unretained AEMemoryBufferPlayer * THIS; int32_t frame; };
+static void prefetchMappedAudioHandler(void *userInfo, int length) {
+    struct prefetchMappedAudio_arg * arg = (struct prefetchMappedAudio_arg*)userInfo;
+    prefetchMappedAudio(arg->THIS, arg->frame);
+}
+
+static void copyDeinterleaved(__unsafe_unretained AEMemoryBufferPlayer *THIS, char **audioPtrs, int numberOfBuffers, int32_t playhead, int frames) {
+    // Mapped audio is interleaved: pick out each channel with a strided copy
+    int bytesPerSample = THIS->_audioDescription.mBytesPerFrame;
+    int sourceStride = THIS->_bufferAudioDescription.mBytesPerFrame;
+    const char *source = (const char*)THIS->_audio->mBuffers[0].mData + (size_t)playhead * sourceStride;
+    
+    for ( int i=0; i<numberOfBuffers; i++ ) {
+        const char *sourcePtr = source + i * bytesPerSample;
+        if ( bytesPerSample == sizeof(float) ) {
+            float *target = (float*)audioPtrs[i];
+            for ( int frame=0; frame<frames; frame++, sourcePtr += sourceStride ) {
+                target[frame] = *(const float*)sourcePtr;
+            }
+        } else if ( bytesPerSample == sizeof(SInt16) ) {
+            SInt16 *target = (SInt16*)audioPtrs[i];
+            for ( int frame=0; frame<frames; frame++, sourcePtr += sourceStride ) {
+                target[frame] = *(const SInt16*)sourcePtr;
+            }
+        } else {
+            char *target = audioPtrs[i];
+            for ( int frame=0; frame<frames; frame++, sourcePtr += sourceStride, target += bytesPerSample ) {
+                memcpy(target, sourcePtr, bytesPerSample);
+            }
+        }
+    }
 }
 
 static void notifyLoopRestart(void *userInfo, int length) {
@@ -124,20 +278,54 @@ static void notifyPlaybackStopped(void *userInfo, int length) {
     THIS->_playhead = 0;
 }
 
+static void renderInterpolated(__unsafe_unretained AEMemoryBufferPlayer *THIS, char **audioPtrs, int numberOfBuffers, AESamplePosition position, AESamplePosition increment, int frames) {
+    // Source and output may each be interleaved or not, such as for mapped audio
+    UInt32 channels = THIS->_audioDescription.mChannelsPerFrame;
+    BOOL sourceInterleaved = !(THIS->_bufferAudioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved);
+    BOOL targetInterleaved = numberOfBuffers != channels;
+    
+    for ( int i=0; i<channels; i++ ) {
+        const float *source = sourceInterleaved ? (const float*)THIS->_audio->mBuffers[0].mData + i : (const float*)THIS->_audio->mBuffers[i].mData;
+        float *target = targetInterleaved ? (float*)audioPtrs[0] + i : (float*)audioPtrs[i];
+        AESampleInterpolationRender(THIS->_interpolation,
+                                    source, sourceInterleaved ? channels : 1, THIS->_lengthInFrames, THIS->_loop,
+                                    position, increment,
+                                    target, targetInterleaved ? channels : 1, frames);
+    }
+}
+
 static OSStatus renderCallback(__unsafe_unretained AEMemoryBufferPlayer *THIS, __unsafe_unretained AEAudioController *audioController, const AudioTimeStamp *time, UInt32 frames, AudioBufferList *audio) {
-    int32_t playhead = THIS->_playhead;
-    int32_t originalPlayhead = playhead;
+    int64_t originalPlayhead = THIS->_playhead;
+    AESamplePosition position = originalPlayhead;
+    AESamplePosition increment = THIS->_increment;
     
-    if ( !THIS->_channelIsPlaying ) return noErr;
+    if ( !THIS->_channelIsPlaying || THIS->_lengthInFrames == 0 ) return noErr;
     
-    uint64_t hostTimeAtBufferEnd = time->mHostTime + AEHostTicksFromSeconds((double)frames / THIS->_audioDescription.mSampleRate);
-    if ( THIS->_startTime && THIS->_startTime > hostTimeAtBufferEnd ) {
+    // Find where playback starts within this buffer, in fractional frames
+    double startOffset = 0.0;
+    if ( THIS->_hasStartSampleTime ) {
+        if ( time->mFlags & kAudioTimeStampSampleTimeValid ) {
+            startOffset = THIS->_startSampleTime - time->mSampleTime;
+        }
+    } else if ( THIS->_startTime && THIS->_startTime > time->mHostTime ) {
+        startOffset = AESecondsFromHostTicks(THIS->_startTime - time->mHostTime) * THIS->_audioDescription.mSampleRate;
+    }
+    
+    if ( startOffset >= frames ) {
         // Start time not yet reached: emit silence
         return noErr;
     }
     
-    uint32_t silentFrames = THIS->_startTime && THIS->_startTime > time->mHostTime
-    ? AESecondsFromHostTicks(THIS->_startTime - time->mHostTime) * THIS->_audioDescription.mSampleRate : 0;
+    uint32_t silentFrames = 0;
+    if ( startOffset > 0.0 ) {
+        silentFrames = (uint32_t)ceil(startOffset);
+        if ( THIS->_canInterpolate ) {
+            // The start time falls between two frames: begin the first frame part-way in, so the
+            // audio starts at exactly the given time
+            position += (AESamplePosition)((silentFrames - startOffset) * (double)increment);
+        }
+    }
+    
     AEAudioBufferListCopyOnStack(scratchAudioBufferList, audio, silentFrames * THIS->_audioDescription.mBytesPerFrame);
     
     if ( silentFrames > 0 ) {
@@ -152,10 +340,13 @@ static OSStatus renderCallback(__unsafe_unretained AEMemoryBufferPlayer *THIS, _
     }
     
     THIS->_startTime = 0;
+    THIS->_hasStartSampleTime = NO;
     
-    if ( !THIS->_loop && playhead == THIS->_lengthInFrames ) {
+    AESamplePosition end = (AESamplePosition)THIS->_lengthInFrames << 32;
+    
+    if ( !THIS->_loop && position >= end ) {
         // Notify main thread that playback has finished
-        AEAudioControllerSendAsynchronousMessageToMainThread(audioController, notifyPlaybackStopped, &THIS, sizeof(AEMemoryBufferPlayer*));
+        AEAudioControllerSendAsynchronousMessageToMainThread(audioController, notifyPlaybackStopped, &(struct notifyPlaybackStopped_arg) { .THIS = THIS, .audioController = audioController }, sizeof(struct notifyPlaybackStopped_arg));
         THIS->_channelIsPlaying = NO;
         return noErr;
     }
@@ -169,27 +360,48 @@ static OSStatus renderCallback(__unsafe_unretained AEMemoryBufferPlayer *THIS, _
     int bytesPerFrame = THIS->_audioDescription.mBytesPerFrame;
     int remainingFrames = frames;
     
-    // Copy audio in contiguous chunks, wrapping around if we're looping
+    // Audio is copied directly when playing whole frames at the original rate, else interpolated
+    BOOL interpolate = THIS->_canInterpolate && (increment != AESamplePositionOneFrame || (uint32_t)position != 0);
+    
+    // Render audio in contiguous chunks, wrapping around if we're looping
     while ( remainingFrames > 0 ) {
-        // The number of frames left before the end of the audio
-        int framesToCopy = MIN(remainingFrames, THIS->_lengthInFrames - playhead);
-
-        // Fill each buffer with the audio
-        for ( int i=0; i<audio->mNumberBuffers; i++ ) {
-            memcpy(audioPtrs[i], ((char*)THIS->_audio->mBuffers[i].mData) + playhead * bytesPerFrame, framesToCopy * bytesPerFrame);
+        int framesToCopy = 0;
+        
+        if ( position < end ) {
+            if ( interpolate ) {
+                // The number of frames before the playhead passes the end of the audio
+                framesToCopy = (int)MIN((AESamplePosition)remainingFrames, (end - position + increment - 1) / increment);
+                renderInterpolated(THIS, audioPtrs, audio->mNumberBuffers, position, increment, framesToCopy);
+                position += framesToCopy * increment;
+            } else {
+                int32_t playhead = (int32_t)(position >> 32);
+                
+                // The number of frames left before the end of the audio
+                framesToCopy = MIN(remainingFrames, THIS->_lengthInFrames - playhead);
+                
+                if ( THIS->_deinterleave ) {
+                    copyDeinterleaved(THIS, audioPtrs, audio->mNumberBuffers, playhead, framesToCopy);
+                } else {
+                    // Fill each buffer with the audio
+                    for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+                        memcpy(audioPtrs[i], ((char*)THIS->_audio->mBuffers[i].mData) + playhead * bytesPerFrame, framesToCopy * bytesPerFrame);
+                    }
+                }
+                position += (AESamplePosition)framesToCopy << 32;
+            }
             
             // Advance the output buffers
-            audioPtrs[i] += framesToCopy * bytesPerFrame;
+            for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+                audioPtrs[i] += framesToCopy * bytesPerFrame;
+            }
+            remainingFrames -= framesToCopy;
         }
         
-        // Advance playhead
-        remainingFrames -= framesToCopy;
-        playhead += framesToCopy;
-        
-        if ( playhead >= THIS->_lengthInFrames ) {
+        if ( position >= end ) {
             // Reached the end of the audio - either loop, or stop
             if ( THIS->_loop ) {
-                playhead = 0;
+                // Keep the fraction of a frame we overshot by
+                position = (position - end) % end;
                 if ( THIS->_startLoopBlock ) {
                     // Notify main thread that the loop playback has restarted
                     AEAudioControllerSendAsynchronousMessageToMainThread(audioController, notifyLoopRestart, &THIS, sizeof(AEMemoryBufferPlayer*));
@@ -203,7 +415,16 @@ static OSStatus renderCallback(__unsafe_unretained AEMemoryBufferPlayer *THIS, _
         }
     }
     
-    OSAtomicCompareAndSwap32(originalPlayhead, playhead, &THIS->_playhead);
+    OSAtomicCompareAndSwap64(originalPlayhead, (int64_t)position, &THIS->_playhead);
+    
+    int32_t playhead = (int32_t)(position >> 32);
+    if ( THIS->_mappedData && playhead / kMappedPrefetchWindowFrames != THIS->_prefetchWindow ) {
+        // Entered a new window: have the main thread page in the audio ahead, so we don't fault on it here
+        THIS->_prefetchWindow = playhead / kMappedPrefetchWindowFrames;
+        AEAudioControllerSendAsynchronousMessageToMainThread(audioController, prefetchMappedAudioHandler,
+                                                             &(struct prefetchMappedAudio_arg) { .THIS = THIS, .frame = playhead },
+                                                             sizeof(struct prefetchMappedAudio_arg));
+    }
     
     return noErr;
 }
@@ -28,6 +28,7 @@
 #import "AEMessageQueue.h"
 #import "TPCircularBuffer.h"
 #import "AEUtilities.h"
+#import "AETraceRecorder.h"
 #import <pthread.h>
 
 /*!
@@ -149,7 +150,9 @@ void AEMessageQueueProcessMessagesOnRealtimeThread(__unsafe_unretained AEMessage
         TPCircularBufferConsume(&THIS->_realtimeThreadMessageBuffer, sizeof(message_t));
         
         if ( message.block ) {
+            AETraceBegin("Message");
             ((__bridge void(^)(void))message.block)();
+            AETraceEnd("Message");
         }
         
         // Write reply to main thread buffer, checking again for available space (above block call may have caused additional writes)
@@ -227,7 +230,9 @@ void AEMessageQueueProcessMessagesOnRealtimeThread(__unsafe_unretained AEMessage
         }
         
         if ( message->responseBlock ) {
+            AETraceBegin("Message response");
             ((__bridge void(^)(void))message->responseBlock)();
+            AETraceEnd("Message response");
             CFBridgingRelease(message->responseBlock);
             
             _pendingResponses--;
@@ -235,8 +240,10 @@ void AEMessageQueueProcessMessagesOnRealtimeThread(__unsafe_unretained AEMessage
                 _pollThread.pollInterval = kIdleMessagingPollDuration;
             }
         } else if ( message->handler ) {
+            AETraceBegin("Main thread message");
             message->handler(message->userInfoLength > 0 ? message+1 : NULL,
                              message->userInfoLength);
+            AETraceEnd("Main thread message");
         }
         
         if ( message->block ) {
@@ -364,6 +371,7 @@ static BOOL AEMessageQueueHasPendingMainThreadMessages(__unsafe_unretained AEMes
         while ( !self.isCancelled ) {
             @autoreleasepool {
                 if ( _messageQueue.autoProcessTimeout > 0 && AESecondsFromHostTicks(AECurrentTimeInHostTicks() - _messageQueue.lastProcessTime) > _messageQueue.autoProcessTimeout ) {
+                    AETraceInstant("Auto-process messages");
                     AEMessageQueueProcessMessagesOnRealtimeThread(_messageQueue);
                 }
                 if ( AEMessageQueueHasPendingMainThreadMessages(_messageQueue) ) {
@@ -0,0 +1,994 @@
+//
+//  AEPCMFile.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "AEPCMFile.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const size_t   kIOBufferBytes          = 1024 * 1024;
+static const uint64_t kPreallocationBytes     = 16 * 1024 * 1024;
+static const uint64_t kMaximumRIFFSize        = 0xFFFFFFFFULL;
+static const uint32_t kAIFCVersion1           = 0xA2805140;
+static const uint32_t kJournalVersion         = 1;
+static const char    *kJournalSuffix          = ".journal";
+
+enum {
+    kWAVEFormatPCM        = 0x0001,
+    kWAVEFormatFloat      = 0x0003,
+    kWAVEFormatExtensible = 0xFFFE
+};
+
+enum {
+    kCAFFormatFlagIsFloat        = 1,
+    kCAFFormatFlagIsLittleEndian = 2
+};
+
+enum {
+    kJournalRecordSize = 64
+};
+
+enum {
+    kWAVFormatChunkSize           = 16,
+    kWAVExtensibleFormatChunkSize = 40,
+    kWAVFactChunkSize             = 4
+};
+
+static const uint32_t kSpeakerFrontCenter = 0x4;
+static const uint8_t  kWAVSubFormatGUIDTail[14] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+
+struct AEPCMFile {
+    int             fd;
+    bool            writing;
+    AEPCMFileType   type;
+    AEPCMFileFormat format;
+    bool            bigEndian;
+    uint32_t        bytesPerSample;
+    uint32_t        bytesPerFrame;
+    uint64_t        dataOffset;
+    uint64_t        lengthInFrames;
+    uint64_t        position;
+    uint8_t        *ioBuffer;
+    uint32_t        ioBufferFrames;
+    float          *scratch;
+    size_t          pendingBytes;
+    uint64_t        preallocatedBytes;
+    char           *path;
+    char           *journalPath;
+    int             journalFd;
+    uint64_t        journalSequence;
+};
+
+#pragma mark - Byte order
+
+static inline uint16_t readLE16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static inline uint32_t readLE32(const uint8_t *p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+static inline uint64_t readLE64(const uint8_t *p) { return (uint64_t)readLE32(p) | ((uint64_t)readLE32(p+4) << 32); }
+static inline uint16_t readBE16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+static inline uint32_t readBE32(const uint8_t *p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3]; }
+static inline uint64_t readBE64(const uint8_t *p) { return ((uint64_t)readBE32(p) << 32) | (uint64_t)readBE32(p+4); }
+
+static inline void writeLE16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static inline void writeLE32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+static inline void writeLE64(uint8_t *p, uint64_t v) { writeLE32(p, (uint32_t)v); writeLE32(p+4, (uint32_t)(v >> 32)); }
+static inline void writeBE16(uint8_t *p, uint16_t v) { p[0] = v >> 8; p[1] = v; }
+static inline void writeBE32(uint8_t *p, uint32_t v) { p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v; }
+static inline void writeBE64(uint8_t *p, uint64_t v) { writeBE32(p, (uint32_t)(v >> 32)); writeBE32(p+4, (uint32_t)v); }
+
+static inline bool hostIsBigEndian(void) {
+    const uint16_t test = 1;
+    return *(const uint8_t*)&test == 0;
+}
+
+static double readExtended80(const uint8_t *p) {
+    // IEEE 754 80-bit extended, as used for AIFF sample rates
+    int exponent = ((p[0] & 0x7F) << 8) | p[1];
+    uint64_t mantissa = readBE64(p+2);
+    if ( exponent == 0 && mantissa == 0 ) return 0.0;
+    double value = ldexp((double)mantissa, exponent - 16383 - 63);
+    return (p[0] & 0x80) ? -value : value;
+}
+
+static void writeExtended80(uint8_t *p, double value) {
+    memset(p, 0, 10);
+    if ( value <= 0.0 ) return;
+    int exponent;
+    double fraction = frexp(value, &exponent); // value = fraction * 2^exponent, 0.5 <= fraction < 1
+    uint64_t mantissa = (uint64_t)ldexp(fraction, 64);
+    writeBE16(p, (uint16_t)(exponent - 1 + 16383));
+    writeBE64(p+2, mantissa);
+}
+
+#pragma mark - Sample conversion
+
+// These loops are kept simple so that the compiler can vectorize them
+
+static void decodeSamples(const AEPCMFile *file, const uint8_t * restrict source, float * restrict target, size_t count) {
+    bool swap = file->bigEndian != hostIsBigEndian();
+    switch ( file->format.isFloat ? -(int)file->bytesPerSample : (int)file->bytesPerSample ) {
+        case 2: {
+            const uint16_t * restrict samples = (const uint16_t*)source;
+            if ( swap ) {
+                for ( size_t i=0; i<count; i++ ) target[i] = (float)(int16_t)__builtin_bswap16(samples[i]) * (1.0f/32768.0f);
+            } else {
+                for ( size_t i=0; i<count; i++ ) target[i] = (float)(int16_t)samples[i] * (1.0f/32768.0f);
+            }
+            break;
+        }
+        case 3: {
+            // Assemble into the top of a 32-bit word, then shift down to sign-extend
+            if ( file->bigEndian ) {
+                for ( size_t i=0; i<count; i++, source += 3 ) {
+                    int32_t value = (int32_t)(((uint32_t)source[0] << 24) | ((uint32_t)source[1] << 16) | ((uint32_t)source[2] << 8)) >> 8;
+                    target[i] = (float)value * (1.0f/8388608.0f);
+                }
+            } else {
+                for ( size_t i=0; i<count; i++, source += 3 ) {
+                    int32_t value = (int32_t)(((uint32_t)source[2] << 24) | ((uint32_t)source[1] << 16) | ((uint32_t)source[0] << 8)) >> 8;
+                    target[i] = (float)value * (1.0f/8388608.0f);
+                }
+            }
+            break;
+        }
+        case 4: {
+            const uint32_t * restrict samples = (const uint32_t*)source;
+            if ( swap ) {
+                for ( size_t i=0; i<count; i++ ) target[i] = (float)((double)(int32_t)__builtin_bswap32(samples[i]) * (1.0/2147483648.0));
+            } else {
+                for ( size_t i=0; i<count; i++ ) target[i] = (float)((double)(int32_t)samples[i] * (1.0/2147483648.0));
+            }
+            break;
+        }
+        case -4: {
+            const uint32_t * restrict samples = (const uint32_t*)source;
+            uint32_t * restrict output = (uint32_t*)target;
+            if ( swap ) {
+                for ( size_t i=0; i<count; i++ ) output[i] = __builtin_bswap32(samples[i]);
+            } else {
+                memcpy(target, source, count * sizeof(float));
+            }
+            break;
+        }
+        case -8: {
+            const uint64_t * restrict samples = (const uint64_t*)source;
+            for ( size_t i=0; i<count; i++ ) {
+                uint64_t bits = swap ? __builtin_bswap64(samples[i]) : samples[i];
+                double value;
+                memcpy(&value, &bits, sizeof(value));
+                target[i] = (float)value;
+            }
+            break;
+        }
+    }
+}
+
+static void encodeSamples(const AEPCMFile *file, const float * restrict source, uint8_t * restrict target, size_t count) {
+    bool swap = file->bigEndian != hostIsBigEndian();
+    switch ( file->format.isFloat ? -(int)file->bytesPerSample : (int)file->bytesPerSample ) {
+        case 2: {
+            uint16_t * restrict samples = (uint16_t*)target;
+            for ( size_t i=0; i<count; i++ ) {
+                float value = source[i] < -1.0f ? -1.0f : source[i] > 1.0f ? 1.0f : source[i];
+                uint16_t sample = (uint16_t)(int16_t)(value * 32767.0f);
+                samples[i] = swap ? __builtin_bswap16(sample) : sample;
+            }
+            break;
+        }
+        case 3: {
+            for ( size_t i=0; i<count; i++, target += 3 ) {
+                float value = source[i] < -1.0f ? -1.0f : source[i] > 1.0f ? 1.0f : source[i];
+                int32_t sample = (int32_t)(value * 8388607.0f);
+                if ( file->bigEndian ) {
+                    target[0] = (uint8_t)(sample >> 16); target[1] = (uint8_t)(sample >> 8); target[2] = (uint8_t)sample;
+                } else {
+                    target[0] = (uint8_t)sample; target[1] = (uint8_t)(sample >> 8); target[2] = (uint8_t)(sample >> 16);
+                }
+            }
+            break;
+        }
+        case 4: {
+            uint32_t * restrict samples = (uint32_t*)target;
+            for ( size_t i=0; i<count; i++ ) {
+                float value = source[i] < -1.0f ? -1.0f : source[i] > 1.0f ? 1.0f : source[i];
+                uint32_t sample = (uint32_t)(int32_t)((double)value * 2147483647.0);
+                samples[i] = swap ? __builtin_bswap32(sample) : sample;
+            }
+            break;
+        }
+        case -4: {
+            const uint32_t * restrict input = (const uint32_t*)source;
+            uint32_t * restrict samples = (uint32_t*)target;
+            if ( swap ) {
+                for ( size_t i=0; i<count; i++ ) samples[i] = __builtin_bswap32(input[i]);
+            } else {
+                memcpy(target, source, count * sizeof(float));
+            }
+            break;
+        }
+        case -8: {
+            uint64_t * restrict samples = (uint64_t*)target;
+            for ( size_t i=0; i<count; i++ ) {
+                double value = source[i];
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                samples[i] = swap ? __builtin_bswap64(bits) : bits;
+            }
+            break;
+        }
+    }
+}
+
+#pragma mark - File access
+
+static int readFully(int fd, void *buffer, size_t length, uint64_t offset, size_t *outLength) {
+    size_t total = 0;
+    while ( total < length ) {
+        ssize_t result = pread(fd, (uint8_t*)buffer + total, length - total, (off_t)(offset + total));
+        if ( result < 0 ) {
+            if ( errno == EINTR ) continue;
+            return errno;
+        }
+        if ( result == 0 ) break;
+        total += result;
+    }
+    if ( outLength ) *outLength = total;
+    else if ( total < length ) return EIO;
+    return 0;
+}
+
+static int writeFully(int fd, const void *buffer, size_t length, uint64_t offset) {
+    size_t total = 0;
+    while ( total < length ) {
+        ssize_t result = pwrite(fd, (const uint8_t*)buffer + total, length - total, (off_t)(offset + total));
+        if ( result < 0 ) {
+            if ( errno == EINTR ) continue;
+            return errno;
+        }
+        total += result;
+    }
+    return 0;
+}
+
+static void preallocate(AEPCMFile *file, uint64_t length) {
+    // Reserve disk space ahead of the data without changing the file length, so the file
+    // stays contiguous and writes don't have to allocate blocks. This is only a hint.
+#if defined(__linux__)
+    fallocate(file->fd, FALLOC_FL_KEEP_SIZE, (off_t)file->preallocatedBytes, (off_t)(length - file->preallocatedBytes));
+#elif defined(F_PREALLOCATE)
+    fstore_t store = { F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)(length - file->preallocatedBytes), 0 };
+    fcntl(file->fd, F_PREALLOCATE, &store);
+#endif
+    file->preallocatedBytes = length;
+}
+
+static int synchronize(int fd) {
+#if defined(__APPLE__)
+    // fdatasync isn't declared by the Darwin headers
+    return fsync(fd) == 0 ? 0 : errno;
+#else
+    return fdatasync(fd) == 0 ? 0 : errno;
+#endif
+}
+
+static void adviseSequentialRead(AEPCMFile *file) {
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(file->fd, (off_t)file->dataOffset, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(F_RDAHEAD)
+    fcntl(file->fd, F_RDAHEAD, 1);
+#endif
+}
+
+static AEPCMFile * allocateFile(int fd, const AEPCMFileFormat *format, bool bigEndian) {
+    AEPCMFile *file = calloc(1, sizeof(AEPCMFile));
+    if ( !file ) return NULL;
+    file->fd = fd;
+    file->journalFd = -1;
+    file->format = *format;
+    file->bigEndian = bigEndian;
+    file->bytesPerSample = format->bitsPerSample / 8;
+    file->bytesPerFrame = file->bytesPerSample * format->channels;
+    file->ioBufferFrames = (uint32_t)(kIOBufferBytes / file->bytesPerFrame);
+    if ( file->ioBufferFrames == 0 ) file->ioBufferFrames = 1;
+    file->ioBuffer = malloc((size_t)file->ioBufferFrames * file->bytesPerFrame);
+    file->scratch = malloc((size_t)file->ioBufferFrames * format->channels * sizeof(float));
+    if ( !file->ioBuffer || !file->scratch ) {
+        free(file->ioBuffer);
+        free(file->scratch);
+        free(file);
+        return NULL;
+    }
+    return file;
+}
+
+static bool wavNeedsExtensibleFormat(const AEPCMFileFormat *format) {
+    // Required for anything other than 8 or 16-bit integer audio, in mono or stereo
+    return format->isFloat || format->bitsPerSample > 16 || format->channels > 2;
+}
+
+static uint64_t wavHeaderLength(const AEPCMFileFormat *format) {
+    // RIFF header, JUNK/ds64, fmt, fact for floating point, and the data chunk header
+    return 12 + (8 + 28)
+        + 8 + (wavNeedsExtensibleFormat(format) ? kWAVExtensibleFormatChunkSize : kWAVFormatChunkSize)
+        + (format->isFloat ? 8 + kWAVFactChunkSize : 0)
+        + 8;
+}
+
+static bool formatIsSupported(const AEPCMFileFormat *format) {
+    if ( format->channels == 0 || format->sampleRate <= 0.0 ) return false;
+    if ( format->isFloat ) return format->bitsPerSample == 32 || format->bitsPerSample == 64;
+    return format->bitsPerSample == 16 || format->bitsPerSample == 24 || format->bitsPerSample == 32;
+}
+
+#pragma mark - Reading
+
+static int parseWAV(int fd, uint64_t fileSize, AEPCMFileFormat *format, bool *bigEndian, uint64_t *dataOffset, uint64_t *dataBytes) {
+    uint8_t header[12];
+    int result = readFully(fd, header, sizeof(header), 0, NULL);
+    if ( result ) return result;
+    bool rf64 = memcmp(header, "RF64", 4) == 0;
+
+    uint64_t dataSize64 = 0;
+    bool haveFormat = false, haveData = false;
+    uint64_t offset = 12;
+    while ( offset + 8 <= fileSize && !(haveFormat && haveData) ) {
+        uint8_t chunk[8];
+        if ( (result = readFully(fd, chunk, sizeof(chunk), offset, NULL)) ) return result;
+        uint64_t size = readLE32(chunk+4);
+
+        if ( memcmp(chunk, "ds64", 4) == 0 ) {
+            uint8_t ds64[16];
+            if ( (result = readFully(fd, ds64, sizeof(ds64), offset+8, NULL)) ) return result;
+            dataSize64 = readLE64(ds64+8);
+        } else if ( memcmp(chunk, "fmt ", 4) == 0 ) {
+            uint8_t fmt[26];
+            memset(fmt, 0, sizeof(fmt));
+            if ( size < 16 ) return ENOTSUP;
+            if ( (result = readFully(fd, fmt, size < sizeof(fmt) ? (size_t)size : sizeof(fmt), offset+8, NULL)) ) return result;
+            uint16_t tag = readLE16(fmt);
+            if ( tag == kWAVEFormatExtensible && size >= 26 ) {
+                tag = readLE16(fmt+24); // First two bytes of the sub-format GUID
+            }
+            if ( tag != kWAVEFormatPCM && tag != kWAVEFormatFloat ) return ENOTSUP;
+            format->channels = readLE16(fmt+2);
+            format->sampleRate = readLE32(fmt+4);
+            format->bitsPerSample = readLE16(fmt+14);
+            format->isFloat = tag == kWAVEFormatFloat;
+            haveFormat = true;
+        } else if ( memcmp(chunk, "data", 4) == 0 ) {
+            *dataOffset = offset + 8;
+            *dataBytes = rf64 && size == 0xFFFFFFFF ? dataSize64 : size;
+            if ( *dataOffset + *dataBytes > fileSize ) *dataBytes = fileSize - *dataOffset;
+            haveData = true;
+            if ( rf64 && size == 0xFFFFFFFF ) size = *dataBytes;
+        }
+
+        offset += 8 + size + (size & 1);
+    }
+
+    *bigEndian = false;
+    return haveFormat && haveData ? 0 : ENOTSUP;
+}
+
+static int parseAIFF(int fd, uint64_t fileSize, AEPCMFileFormat *format, bool *bigEndian, uint64_t *dataOffset, uint64_t *dataBytes) {
+    uint8_t header[12];
+    int result = readFully(fd, header, sizeof(header), 0, NULL);
+    if ( result ) return result;
+    bool aifc = memcmp(header+8, "AIFC", 4) == 0;
+
+    *bigEndian = true;
+    bool haveFormat = false, haveData = false;
+    uint64_t offset = 12;
+    while ( offset + 8 <= fileSize && !(haveFormat && haveData) ) {
+        uint8_t chunk[8];
+        if ( (result = readFully(fd, chunk, sizeof(chunk), offset, NULL)) ) return result;
+        uint64_t size = readBE32(chunk+4);
+
+        if ( memcmp(chunk, "COMM", 4) == 0 ) {
+            uint8_t comm[22];
+            if ( size < 18 ) return ENOTSUP;
+            if ( (result = readFully(fd, comm, aifc ? 22 : 18, offset+8, NULL)) ) return result;
+            format->channels = readBE16(comm);
+            format->bitsPerSample = readBE16(comm+6);
+            format->sampleRate = readExtended80(comm+8);
+            format->isFloat = false;
+            if ( aifc ) {
+                if ( memcmp(comm+18, "sowt", 4) == 0 ) {
+                    *bigEndian = false;
+                } else if ( memcmp(comm+18, "fl32", 4) == 0 || memcmp(comm+18, "FL32", 4) == 0 ) {
+                    format->isFloat = true;
+                    format->bitsPerSample = 32;
+                } else if ( memcmp(comm+18, "fl64", 4) == 0 || memcmp(comm+18, "FL64", 4) == 0 ) {
+                    format->isFloat = true;
+                    format->bitsPerSample = 64;
+                } else if ( memcmp(comm+18, "NONE", 4) != 0 && memcmp(comm+18, "twos", 4) != 0 ) {
+                    return ENOTSUP;
+                }
+            }
+            haveFormat = true;
+        } else if ( memcmp(chunk, "SSND", 4) == 0 ) {
+            uint8_t ssnd[8];
+            if ( (result = readFully(fd, ssnd, sizeof(ssnd), offset+8, NULL)) ) return result;
+            uint32_t dataStart = readBE32(ssnd);
+            *dataOffset = offset + 16 + dataStart;
+            *dataBytes = size >= 8 + dataStart ? size - 8 - dataStart : 0;
+            if ( *dataOffset + *dataBytes > fileSize ) *dataBytes = fileSize - *dataOffset;
+            haveData = true;
+        }
+
+        offset += 8 + size + (size & 1);
+    }
+
+    return haveFormat && haveData ? 0 : ENOTSUP;
+}
+
+static int parseCAF(int fd, uint64_t fileSize, AEPCMFileFormat *format, bool *bigEndian, uint64_t *dataOffset, uint64_t *dataBytes) {
+    int result;
+    bool haveFormat = false, haveData = false;
+    uint64_t offset = 8;
+    while ( offset + 12 <= fileSize && !(haveFormat && haveData) ) {
+        uint8_t chunk[12];
+        if ( (result = readFully(fd, chunk, sizeof(chunk), offset, NULL)) ) return result;
+        int64_t size = (int64_t)readBE64(chunk+4);
+
+        if ( memcmp(chunk, "desc", 4) == 0 ) {
+            uint8_t desc[32];
+            if ( (result = readFully(fd, desc, sizeof(desc), offset+12, NULL)) ) return result;
+            uint64_t sampleRateBits = readBE64(desc);
+            memcpy(&format->sampleRate, &sampleRateBits, sizeof(double));
+            uint32_t flags = readBE32(desc+12);
+            if ( memcmp(desc+8, "lpcm", 4) != 0 || readBE32(desc+20) != 1 ) return ENOTSUP;
+            format->channels = readBE32(desc+24);
+            format->bitsPerSample = readBE32(desc+28);
+            format->isFloat = (flags & kCAFFormatFlagIsFloat) != 0;
+            *bigEndian = !(flags & kCAFFormatFlagIsLittleEndian);
+            if ( readBE32(desc+16) != format->channels * (format->bitsPerSample/8) ) return ENOTSUP; // Must be packed
+            haveFormat = true;
+        } else if ( memcmp(chunk, "data", 4) == 0 ) {
+            // Data follows a 4-byte edit count; a size of -1 means the data runs to the end of the file
+            *dataOffset = offset + 12 + 4;
+            *dataBytes = size < 0 ? fileSize - *dataOffset : (uint64_t)size - 4;
+            if ( *dataOffset + *dataBytes > fileSize ) *dataBytes = fileSize - *dataOffset;
+            haveData = true;
+            if ( size < 0 ) break;
+        }
+
+        offset += 12 + (uint64_t)size;
+    }
+
+    return haveFormat && haveData ? 0 : ENOTSUP;
+}
+
+static int parseFile(int fd, uint64_t fileSize, AEPCMFileType *type, AEPCMFileFormat *format, bool *bigEndian, uint64_t *dataOffset, uint64_t *dataBytes) {
+    uint8_t header[12];
+    int result = readFully(fd, header, sizeof(header), 0, NULL);
+    if ( result ) return result == EIO ? ENOTSUP : result;
+
+    memset(format, 0, sizeof(AEPCMFileFormat));
+    *bigEndian = false;
+    *dataOffset = *dataBytes = 0;
+
+    if ( (memcmp(header, "RIFF", 4) == 0 || memcmp(header, "RF64", 4) == 0) && memcmp(header+8, "WAVE", 4) == 0 ) {
+        *type = AEPCMFileTypeWAV;
+        result = parseWAV(fd, fileSize, format, bigEndian, dataOffset, dataBytes);
+    } else if ( memcmp(header, "FORM", 4) == 0 && (memcmp(header+8, "AIFF", 4) == 0 || memcmp(header+8, "AIFC", 4) == 0) ) {
+        *type = AEPCMFileTypeAIFF;
+        result = parseAIFF(fd, fileSize, format, bigEndian, dataOffset, dataBytes);
+    } else if ( memcmp(header, "caff", 4) == 0 ) {
+        *type = AEPCMFileTypeCAF;
+        result = parseCAF(fd, fileSize, format, bigEndian, dataOffset, dataBytes);
+    } else {
+        result = ENOTSUP;
+    }
+
+    if ( result == 0 && !formatIsSupported(format) ) result = ENOTSUP;
+    return result;
+}
+
+AEPCMFile * AEPCMFileOpen(const char *path, int *outError) {
+    int fd = open(path, O_RDONLY);
+    if ( fd < 0 ) {
+        if ( outError ) *outError = errno;
+        return NULL;
+    }
+
+    struct stat fileInfo;
+    AEPCMFileType type;
+    AEPCMFileFormat format;
+    bool bigEndian;
+    uint64_t dataOffset, dataBytes;
+    int result = fstat(fd, &fileInfo) == 0 ? parseFile(fd, fileInfo.st_size, &type, &format, &bigEndian, &dataOffset, &dataBytes) : errno;
+
+    AEPCMFile *file = result == 0 ? allocateFile(fd, &format, bigEndian) : NULL;
+    if ( !file ) {
+        close(fd);
+        if ( outError ) *outError = result ? result : ENOMEM;
+        return NULL;
+    }
+
+    file->type = type;
+    file->dataOffset = dataOffset;
+    file->lengthInFrames = dataBytes / file->bytesPerFrame;
+    adviseSequentialRead(file);
+
+    if ( outError ) *outError = 0;
+    return file;
+}
+
+int AEPCMFileSeek(AEPCMFile *file, uint64_t frame) {
+    if ( file->writing ) return EINVAL;
+    file->position = frame < file->lengthInFrames ? frame : file->lengthInFrames;
+    return 0;
+}
+
+int AEPCMFileReadFloat(AEPCMFile *file, float * const *buffers, uint32_t bufferCount, uint32_t frames, uint32_t *outFrames) {
+    if ( file->writing || (bufferCount != 1 && bufferCount != file->format.channels) ) return EINVAL;
+
+    uint32_t channels = file->format.channels;
+    bool interleaved = bufferCount == 1;
+    uint32_t framesRead = 0;
+
+    while ( framesRead < frames && file->position < file->lengthInFrames ) {
+        uint64_t remaining = file->lengthInFrames - file->position;
+        uint32_t chunkFrames = frames - framesRead;
+        if ( chunkFrames > file->ioBufferFrames ) chunkFrames = file->ioBufferFrames;
+        if ( chunkFrames > remaining ) chunkFrames = (uint32_t)remaining;
+
+        size_t bytesRead;
+        int result = readFully(file->fd, file->ioBuffer, (size_t)chunkFrames * file->bytesPerFrame,
+                               file->dataOffset + file->position * file->bytesPerFrame, &bytesRead);
+        if ( result ) {
+            if ( outFrames ) *outFrames = framesRead;
+            return result;
+        }
+        chunkFrames = (uint32_t)(bytesRead / file->bytesPerFrame);
+        if ( chunkFrames == 0 ) break;
+
+        if ( interleaved ) {
+            decodeSamples(file, file->ioBuffer, buffers[0] + (size_t)framesRead * channels, (size_t)chunkFrames * channels);
+        } else {
+            decodeSamples(file, file->ioBuffer, file->scratch, (size_t)chunkFrames * channels);
+            for ( uint32_t channel=0; channel<channels; channel++ ) {
+                const float * restrict source = file->scratch + channel;
+                float * restrict target = buffers[channel] + framesRead;
+                for ( uint32_t i=0; i<chunkFrames; i++ ) {
+                    target[i] = source[(size_t)i * channels];
+                }
+            }
+        }
+
+        framesRead += chunkFrames;
+        file->position += chunkFrames;
+    }
+
+    if ( outFrames ) *outFrames = framesRead;
+    return 0;
+}
+
+#pragma mark - Writing
+
+static int writeHeader(AEPCMFile *file, bool final) {
+    uint64_t dataBytes = file->lengthInFrames * file->bytesPerFrame;
+    uint8_t header[128];
+    memset(header, 0, sizeof(header));
+
+    switch ( file->type ) {
+        case AEPCMFileTypeWAV: {
+            // The JUNK chunk reserves space for a ds64 chunk, should the file outgrow 32-bit sizes
+            uint64_t riffSize = file->dataOffset - 8 + dataBytes + (dataBytes & 1);
+            bool rf64 = riffSize > kMaximumRIFFSize;
+            memcpy(header, rf64 ? "RF64" : "RIFF", 4);
+            writeLE32(header+4, rf64 ? 0xFFFFFFFF : (uint32_t)riffSize);
+            memcpy(header+8, "WAVE", 4);
+            memcpy(header+12, rf64 ? "ds64" : "JUNK", 4);
+            writeLE32(header+16, 28);
+            if ( rf64 ) {
+                writeLE64(header+20, riffSize);
+                writeLE64(header+28, dataBytes);
+                writeLE64(header+36, file->lengthInFrames);
+            }
+            // Files begun by earlier versions, when recovered, keep their plain fmt chunk and no fact chunk
+            bool legacy = file->dataOffset != wavHeaderLength(&file->format);
+            bool extensible = !legacy && wavNeedsExtensibleFormat(&file->format);
+            uint16_t tag = file->format.isFloat ? kWAVEFormatFloat : kWAVEFormatPCM;
+            uint8_t *p = header+48;
+            memcpy(p, "fmt ", 4); writeLE32(p+4, extensible ? kWAVExtensibleFormatChunkSize : kWAVFormatChunkSize);
+            writeLE16(p+8, extensible ? kWAVEFormatExtensible : tag);
+            writeLE16(p+10, (uint16_t)file->format.channels);
+            writeLE32(p+12, (uint32_t)file->format.sampleRate);
+            writeLE32(p+16, (uint32_t)(file->format.sampleRate * file->bytesPerFrame));
+            writeLE16(p+20, (uint16_t)file->bytesPerFrame);
+            writeLE16(p+22, (uint16_t)file->format.bitsPerSample);
+            if ( extensible ) {
+                // Extension size, valid bits, speaker positions of the first channels, and the sub-format GUID
+                writeLE16(p+24, 22);
+                writeLE16(p+26, (uint16_t)file->format.bitsPerSample);
+                writeLE32(p+28, file->format.channels == 1 ? kSpeakerFrontCenter
+                                : file->format.channels <= 18 ? (1U << file->format.channels) - 1 : 0);
+                writeLE16(p+32, tag);
+                memcpy(p+34, kWAVSubFormatGUIDTail, sizeof(kWAVSubFormatGUIDTail));
+                p += 8 + kWAVExtensibleFormatChunkSize;
+            } else {
+                p += 8 + kWAVFormatChunkSize;
+            }
+            if ( file->format.isFloat && !legacy ) {
+                // Non-PCM formats need a fact chunk, with the length in frames
+                memcpy(p, "fact", 4); writeLE32(p+4, kWAVFactChunkSize);
+                writeLE32(p+8, rf64 || file->lengthInFrames > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)file->lengthInFrames);
+                p += 8 + kWAVFactChunkSize;
+            }
+            memcpy(p, "data", 4); writeLE32(p+4, rf64 ? 0xFFFFFFFF : (uint32_t)dataBytes);
+            break;
+        }
+        case AEPCMFileTypeAIFF: {
+            // Integer audio is written as AIFF, floating point as AIFC
+            bool aifc = file->format.isFloat;
+            uint64_t formSize = file->dataOffset - 8 + dataBytes + (dataBytes & 1);
+            if ( formSize > kMaximumRIFFSize ) return EFBIG;
+            uint8_t *p = header;
+            memcpy(p, "FORM", 4); writeBE32(p+4, (uint32_t)formSize); memcpy(p+8, aifc ? "AIFC" : "AIFF", 4); p += 12;
+            if ( aifc ) {
+                memcpy(p, "FVER", 4); writeBE32(p+4, 4); writeBE32(p+8, kAIFCVersion1); p += 12;
+            }
+            memcpy(p, "COMM", 4); writeBE32(p+4, aifc ? 24 : 18);
+            writeBE16(p+8, (uint16_t)file->format.channels);
+            writeBE32(p+10, (uint32_t)file->lengthInFrames);
+            writeBE16(p+14, (uint16_t)file->format.bitsPerSample);
+            writeExtended80(p+16, file->format.sampleRate);
+            if ( aifc ) {
+                memcpy(p+26, file->format.bitsPerSample == 64 ? "fl64" : "fl32", 4);
+                // Followed by an empty, padded compression name
+                p += 8 + 24;
+            } else {
+                p += 8 + 18;
+            }
+            memcpy(p, "SSND", 4); writeBE32(p+4, (uint32_t)(dataBytes + 8));
+            break;
+        }
+        case AEPCMFileTypeCAF: {
+            memcpy(header, "caff", 4);
+            writeBE16(header+4, 1);
+            memcpy(header+8, "desc", 4);
+            writeBE64(header+12, 32);
+            uint64_t sampleRateBits;
+            memcpy(&sampleRateBits, &file->format.sampleRate, sizeof(double));
+            writeBE64(header+20, sampleRateBits);
+            memcpy(header+28, "lpcm", 4);
+            writeBE32(header+32, (file->format.isFloat ? kCAFFormatFlagIsFloat : 0) | (file->bigEndian ? 0 : kCAFFormatFlagIsLittleEndian));
+            writeBE32(header+36, file->bytesPerFrame);
+            writeBE32(header+40, 1);
+            writeBE32(header+44, file->format.channels);
+            writeBE32(header+48, file->format.bitsPerSample);
+            memcpy(header+52, "data", 4);
+            // Size is unknown (-1) until the file is finished, which keeps a truncated file readable
+            writeBE64(header+56, final ? dataBytes + 4 : UINT64_MAX);
+            break;
+        }
+    }
+
+    return writeFully(file->fd, header, (size_t)file->dataOffset, 0);
+}
+
+AEPCMFile * AEPCMFileCreate(const char *path, AEPCMFileType type, const AEPCMFileFormat *format, uint64_t expectedFrames, int *outError) {
+    if ( !formatIsSupported(format) ) {
+        if ( outError ) *outError = ENOTSUP;
+        return NULL;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ( fd < 0 ) {
+        if ( outError ) *outError = errno;
+        return NULL;
+    }
+
+    // WAV is little-endian, AIFF big-endian; CAF is written in the host's byte order
+    bool bigEndian = type == AEPCMFileTypeAIFF || (type == AEPCMFileTypeCAF && hostIsBigEndian());
+    AEPCMFile *file = allocateFile(fd, format, bigEndian);
+    if ( file ) file->path = strdup(path);
+    if ( !file || !file->path ) {
+        if ( file ) AEPCMFileClose(file);
+        else close(fd);
+        unlink(path);
+        if ( outError ) *outError = ENOMEM;
+        return NULL;
+    }
+
+    file->writing = true;
+    file->type = type;
+    switch ( type ) {
+        case AEPCMFileTypeWAV:  file->dataOffset = wavHeaderLength(format); break;
+        case AEPCMFileTypeAIFF: file->dataOffset = format->isFloat ? 12 + 12 + 32 + 16 : 12 + 26 + 16; break;
+        case AEPCMFileTypeCAF:  file->dataOffset = 8 + 44 + 12 + 4; break;
+    }
+
+    int result = writeHeader(file, false);
+    if ( result ) {
+        AEPCMFileClose(file);
+        unlink(path);
+        if ( outError ) *outError = result;
+        return NULL;
+    }
+
+    file->preallocatedBytes = file->dataOffset;
+    preallocate(file, file->dataOffset + (expectedFrames ? expectedFrames * file->bytesPerFrame : kPreallocationBytes));
+
+    if ( outError ) *outError = 0;
+    return file;
+}
+
+static int flushPendingAudio(AEPCMFile *file) {
+    if ( file->pendingBytes == 0 ) return 0;
+
+    uint64_t offset = file->dataOffset + file->lengthInFrames * file->bytesPerFrame;
+    if ( offset + file->pendingBytes > file->preallocatedBytes ) {
+        preallocate(file, offset + file->pendingBytes + kPreallocationBytes);
+    }
+
+    int result = writeFully(file->fd, file->ioBuffer, file->pendingBytes, offset);
+    if ( result ) return result;
+
+    file->lengthInFrames += file->pendingBytes / file->bytesPerFrame;
+    file->pendingBytes = 0;
+    return 0;
+}
+
+int AEPCMFileWriteFloat(AEPCMFile *file, const float * const *buffers, uint32_t bufferCount, uint32_t frames) {
+    if ( !file->writing || (bufferCount != 1 && bufferCount != file->format.channels) ) return EINVAL;
+
+    uint32_t channels = file->format.channels;
+    bool interleaved = bufferCount == 1;
+    uint32_t framesWritten = 0;
+
+    while ( framesWritten < frames ) {
+        uint32_t pendingFrames = (uint32_t)(file->pendingBytes / file->bytesPerFrame);
+        uint32_t chunkFrames = frames - framesWritten;
+        if ( chunkFrames > file->ioBufferFrames - pendingFrames ) chunkFrames = file->ioBufferFrames - pendingFrames;
+
+        const float *source;
+        if ( interleaved ) {
+            source = buffers[0] + (size_t)framesWritten * channels;
+        } else {
+            for ( uint32_t channel=0; channel<channels; channel++ ) {
+                const float * restrict input = buffers[channel] + framesWritten;
+                float * restrict target = file->scratch + channel;
+                for ( uint32_t i=0; i<chunkFrames; i++ ) {
+                    target[(size_t)i * channels] = input[i];
+                }
+            }
+            source = file->scratch;
+        }
+
+        encodeSamples(file, source, file->ioBuffer + file->pendingBytes, (size_t)chunkFrames * channels);
+        file->pendingBytes += (size_t)chunkFrames * file->bytesPerFrame;
+        framesWritten += chunkFrames;
+
+        if ( file->pendingBytes == (size_t)file->ioBufferFrames * file->bytesPerFrame ) {
+            int result = flushPendingAudio(file);
+            if ( result ) return result;
+        }
+    }
+
+    return 0;
+}
+
+#pragma mark - Journal
+
+// The journal is a sidecar file holding two alternating records, each describing the file's format,
+// where its audio begins, and how much of it has been committed. A record torn by a crash fails its
+// checksum, and the other record is used.
+
+static uint32_t checksum(const uint8_t *bytes, size_t length) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for ( size_t i=0; i<length; i++ ) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static char * journalPathForPath(const char *path) {
+    size_t length = strlen(path) + strlen(kJournalSuffix) + 1;
+    char *journalPath = malloc(length);
+    if ( journalPath ) snprintf(journalPath, length, "%s%s", path, kJournalSuffix);
+    return journalPath;
+}
+
+static int writeJournal(AEPCMFile *file, bool sync) {
+    if ( file->journalFd < 0 ) {
+        if ( !file->journalPath && !(file->journalPath = journalPathForPath(file->path)) ) return ENOMEM;
+        file->journalFd = open(file->journalPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if ( file->journalFd < 0 ) return errno;
+    }
+
+    uint8_t record[kJournalRecordSize];
+    memset(record, 0, sizeof(record));
+    file->journalSequence++;
+    memcpy(record, "AEPJ", 4);
+    writeLE32(record+4, kJournalVersion);
+    writeLE64(record+8, file->journalSequence);
+    writeLE32(record+16, file->type);
+    writeLE32(record+20, file->format.channels);
+    writeLE32(record+24, file->format.bitsPerSample);
+    record[28] = file->format.isFloat;
+    record[29] = file->bigEndian;
+    uint64_t sampleRateBits;
+    memcpy(&sampleRateBits, &file->format.sampleRate, sizeof(double));
+    writeLE64(record+32, sampleRateBits);
+    writeLE64(record+40, file->dataOffset);
+    writeLE64(record+48, file->lengthInFrames);
+    writeLE32(record+60, checksum(record, 60));
+
+    int result = writeFully(file->journalFd, record, sizeof(record), (file->journalSequence & 1) * kJournalRecordSize);
+    if ( result == 0 && sync ) result = synchronize(file->journalFd);
+    return result;
+}
+
+static bool readJournal(const char *journalPath, AEPCMFileType *type, AEPCMFileFormat *format, bool *bigEndian, uint64_t *dataOffset) {
+    int fd = open(journalPath, O_RDONLY);
+    if ( fd < 0 ) return false;
+    uint8_t records[kJournalRecordSize * 2];
+    size_t length;
+    int result = readFully(fd, records, sizeof(records), 0, &length);
+    close(fd);
+    if ( result ) return false;
+
+    const uint8_t *latest = NULL;
+    for ( size_t offset = 0; offset + kJournalRecordSize <= length; offset += kJournalRecordSize ) {
+        const uint8_t *record = records + offset;
+        if ( memcmp(record, "AEPJ", 4) != 0 || readLE32(record+4) != kJournalVersion || readLE32(record+60) != checksum(record, 60) ) continue;
+        if ( !latest || readLE64(record+8) > readLE64(latest+8) ) latest = record;
+    }
+    if ( !latest || readLE32(latest+16) > AEPCMFileTypeCAF ) return false;
+
+    *type = (AEPCMFileType)readLE32(latest+16);
+    memset(format, 0, sizeof(AEPCMFileFormat));
+    format->channels = readLE32(latest+20);
+    format->bitsPerSample = readLE32(latest+24);
+    format->isFloat = latest[28];
+    *bigEndian = latest[29];
+    uint64_t sampleRateBits = readLE64(latest+32);
+    memcpy(&format->sampleRate, &sampleRateBits, sizeof(double));
+    *dataOffset = readLE64(latest+40);
+    return formatIsSupported(format);
+}
+
+int AEPCMFileCommit(AEPCMFile *file, bool sync) {
+    if ( !file->writing ) return EINVAL;
+
+    int result = flushPendingAudio(file);
+
+    // Audio reaches the disk before the header or journal that describe it
+    if ( result == 0 && sync ) result = synchronize(file->fd);
+
+    // The header fits in the file's first disk sector, so it's rewritten in a single write
+    if ( result == 0 ) result = writeHeader(file, false);
+    if ( result == 0 ) result = writeJournal(file, sync);
+    return result;
+}
+
+bool AEPCMFileNeedsRecovery(const char *path) {
+    char *journalPath = journalPathForPath(path);
+    if ( !journalPath ) return false;
+    bool exists = access(journalPath, F_OK) == 0;
+    free(journalPath);
+    return exists;
+}
+
+int AEPCMFileRecover(const char *path, uint64_t *outFrames) {
+    int fd = open(path, O_RDWR);
+    if ( fd < 0 ) return errno;
+
+    char *journalPath = journalPathForPath(path);
+    struct stat fileInfo;
+    if ( !journalPath || fstat(fd, &fileInfo) != 0 ) {
+        int result = journalPath ? errno : ENOMEM;
+        free(journalPath);
+        close(fd);
+        return result;
+    }
+
+    // The journal describes the file even if its header was never written, or was torn;
+    // without one, fall back to the header
+    AEPCMFileType type;
+    AEPCMFileFormat format;
+    bool bigEndian;
+    uint64_t dataOffset, dataBytes;
+    int result = 0;
+    if ( !readJournal(journalPath, &type, &format, &bigEndian, &dataOffset) ) {
+        result = parseFile(fd, fileInfo.st_size, &type, &format, &bigEndian, &dataOffset, &dataBytes);
+    }
+
+    AEPCMFile *file = result == 0 ? allocateFile(fd, &format, bigEndian) : NULL;
+    if ( !file ) {
+        free(journalPath);
+        close(fd);
+        return result ? result : ENOMEM;
+    }
+
+    // Keep every whole frame on disk, including any written after the last commit
+    file->writing = true;
+    file->type = type;
+    file->dataOffset = dataOffset;
+    file->lengthInFrames = (uint64_t)fileInfo.st_size > dataOffset ? ((uint64_t)fileInfo.st_size - dataOffset) / file->bytesPerFrame : 0;
+    file->journalPath = journalPath;
+    if ( ftruncate(fd, (off_t)(dataOffset + file->lengthInFrames * file->bytesPerFrame)) != 0 ) {
+        result = errno;
+    }
+
+    if ( outFrames ) *outFrames = file->lengthInFrames;
+    int closeResult = AEPCMFileClose(file);
+    return result ? result : closeResult;
+}
+
+int AEPCMFileClose(AEPCMFile *file) {
+    if ( !file ) return 0;
+
+    int result = 0;
+    if ( file->writing ) {
+        result = flushPendingAudio(file);
+        uint64_t dataBytes = file->lengthInFrames * file->bytesPerFrame;
+        if ( result == 0 && (dataBytes & 1) && file->type != AEPCMFileTypeCAF ) {
+            // Chunks are padded to an even length
+            uint8_t pad = 0;
+            result = writeFully(file->fd, &pad, 1, file->dataOffset + dataBytes);
+        }
+        if ( result == 0 ) {
+            result = writeHeader(file, true);
+        }
+        if ( file->journalPath ) {
+            // The journal is only discarded once the finished file is safely on disk
+            if ( result == 0 ) result = synchronize(file->fd);
+            if ( file->journalFd >= 0 ) close(file->journalFd);
+            if ( result == 0 ) unlink(file->journalPath);
+        }
+    }
+
+    close(file->fd);
+    free(file->ioBuffer);
+    free(file->scratch);
+    free(file->path);
+    free(file->journalPath);
+    free(file);
+    return result;
+}
+
+AEPCMFileFormat AEPCMFileGetFormat(AEPCMFile *file) {
+    return file->format;
+}
+
+AEPCMFileType AEPCMFileGetType(AEPCMFile *file) {
+    return file->type;
+}
+
+uint64_t AEPCMFileGetLength(AEPCMFile *file) {
+    return file->lengthInFrames + (file->writing ? file->pendingBytes / file->bytesPerFrame : 0);
+}
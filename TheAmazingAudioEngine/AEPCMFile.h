@@ -0,0 +1,212 @@
+//
+//  AEPCMFile.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * @enum AEAudioFileBackend
+ *  File I/O implementation used by the audio file classes
+ *
+ * @var AEAudioFileBackendExtAudioFile
+ *  Core Audio's ExtAudioFile, supporting all formats and sample rate conversion
+ *
+ * @var AEAudioFileBackendPCMFile
+ *  The portable @link AEPCMFile @endlink reader/writer, for linear PCM WAV, RF64, AIFF and CAF
+ *  files with 32-bit float client audio. Where a file or format isn't supported, the
+ *  ExtAudioFile backend is used instead.
+ */
+typedef enum {
+    AEAudioFileBackendExtAudioFile,
+    AEAudioFileBackendPCMFile
+} AEAudioFileBackend;
+
+/*!
+ * @enum AEPCMFileType
+ *  PCM file container types
+ *
+ * @var AEPCMFileTypeWAV
+ *  RIFF WAVE. Files which grow beyond 4 GB are written as RF64.
+ */
+typedef enum {
+    AEPCMFileTypeWAV,
+    AEPCMFileTypeAIFF,
+    AEPCMFileTypeCAF
+} AEPCMFileType;
+
+/*!
+ * Sample format of a PCM file
+ */
+typedef struct {
+    double   sampleRate;
+    uint32_t channels;
+    uint32_t bitsPerSample;   //!< 16, 24 or 32 for integer samples; 32 or 64 for floating point
+    bool     isFloat;
+} AEPCMFileFormat;
+
+/*!
+ * PCM file
+ *
+ *  A streaming reader and writer of uncompressed audio files, written in portable C
+ *  so that it builds wherever a POSIX file API is available, including Linux.
+ *
+ *  Audio is read and written as 32-bit float samples, with byte-order and sample format
+ *  conversion performed in large blocks. Files are accessed sequentially through a large
+ *  buffer, with read-ahead hints, and writes preallocate disk space ahead of the data.
+ *
+ *  Functions that can fail return 0 on success, or an errno code on failure.
+ */
+typedef struct AEPCMFile AEPCMFile;
+
+/*!
+ * Open a file for reading
+ *
+ * @param path      Path to the file
+ * @param outError  On output, if not NULL, 0 or an errno code: ENOTSUP for a file which is not linear PCM WAV, RF64, AIFF or CAF
+ * @return The file, or NULL on error
+ */
+AEPCMFile * AEPCMFileOpen(const char *path, int *outError);
+
+/*!
+ * Create a file for writing
+ *
+ * @param path            Path to the file to create; an existing file is replaced
+ * @param type            The container type
+ * @param format          The sample format of the file
+ * @param expectedFrames  Expected length in frames, used to preallocate disk space, or 0 if unknown
+ * @param outError        On output, if not NULL, 0 or an errno code
+ * @return The file, or NULL on error
+ */
+AEPCMFile * AEPCMFileCreate(const char *path, AEPCMFileType type, const AEPCMFileFormat *format, uint64_t expectedFrames, int *outError);
+
+/*!
+ * Close a file, finalizing its header if it was being written, and free it
+ *
+ * @param file The file
+ * @return 0 on success, or an errno code if the header couldn't be written
+ */
+int AEPCMFileClose(AEPCMFile *file);
+
+/*!
+ * Get the file's sample format
+ */
+AEPCMFileFormat AEPCMFileGetFormat(AEPCMFile *file);
+
+/*!
+ * Get the file's container type
+ */
+AEPCMFileType AEPCMFileGetType(AEPCMFile *file);
+
+/*!
+ * Get the length of the file, in frames
+ *
+ *  For files being written, this is the number of frames written so far.
+ */
+uint64_t AEPCMFileGetLength(AEPCMFile *file);
+
+/*!
+ * Move the read position
+ *
+ * @param file  The file, opened for reading
+ * @param frame The frame to read from next
+ * @return 0 on success, or an errno code
+ */
+int AEPCMFileSeek(AEPCMFile *file, uint64_t frame);
+
+/*!
+ * Read audio as 32-bit float samples
+ *
+ * @param file         The file, opened for reading
+ * @param buffers      Destination buffers: either one per channel, or a single buffer for interleaved audio
+ * @param bufferCount  The number of buffers: the file's channel count, or 1 for interleaved audio
+ * @param frames       The number of frames to read
+ * @param outFrames    On output, the number of frames read; fewer than requested at the end of the file
+ * @return 0 on success, or an errno code
+ */
+int AEPCMFileReadFloat(AEPCMFile *file, float * const *buffers, uint32_t bufferCount, uint32_t frames, uint32_t *outFrames);
+
+/*!
+ * Write audio from 32-bit float samples
+ *
+ *  Samples outside the range -1 to 1 are clipped when writing integer formats.
+ *
+ * @param file         The file, created for writing
+ * @param buffers      Source buffers: either one per channel, or a single buffer of interleaved audio
+ * @param bufferCount  The number of buffers: the file's channel count, or 1 for interleaved audio
+ * @param frames       The number of frames to write
+ * @return 0 on success, or an errno code
+ */
+int AEPCMFileWriteFloat(AEPCMFile *file, const float * const *buffers, uint32_t bufferCount, uint32_t frames);
+
+/*!
+ * Commit the audio written so far
+ *
+ *  Writes out buffered audio and rewrites the header with the current length, so that
+ *  the file is complete up to this point should the process die before it's closed.
+ *  The first commit also creates a journal beside the file, at the file's path with
+ *  ".journal" appended, which records the file's format and layout independently of
+ *  its header. The journal is updated with each commit, and removed once the file is
+ *  closed. Use @link AEPCMFileRecover @endlink to repair a file left with a journal.
+ *
+ *  This blocks on disk I/O, so should not be used on the realtime audio thread.
+ *
+ * @param file  The file, created for writing
+ * @param sync  Whether to wait until the audio, header and journal have reached the disk,
+ *              with fdatasync, rather than just the operating system's cache
+ * @return 0 on success, or an errno code
+ */
+int AEPCMFileCommit(AEPCMFile *file, bool sync);
+
+/*!
+ * Determine whether a file was left unfinished
+ *
+ * @param path Path to the file
+ * @return Whether a journal remains for the file, in which case it can be repaired with
+ *      @link AEPCMFileRecover @endlink
+ */
+bool AEPCMFileNeedsRecovery(const char *path);
+
+/*!
+ * Repair a file that was being written when the process died
+ *
+ *  Uses the file's journal, if it has one, or otherwise its header, to find the audio
+ *  data. All whole frames of audio on disk are kept, including any written after the
+ *  last commit, a trailing partial frame is discarded, and the header is rewritten to
+ *  match. Without a journal, the audio data is taken to run to the end of the file, as
+ *  it does for files being written by this writer. Once repaired, the journal is removed.
+ *
+ * @param path       Path to the file
+ * @param outFrames  On output, if not NULL, the length of the repaired file in frames
+ * @return 0 on success, or an errno code
+ */
+int AEPCMFileRecover(const char *path, uint64_t *outFrames);
+
+#ifdef __cplusplus
+}
+#endif
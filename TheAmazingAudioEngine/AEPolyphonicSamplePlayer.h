@@ -0,0 +1,169 @@
+//
+//  AEPolyphonicSamplePlayer.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#import <Foundation/Foundation.h>
+#import "AEAudioController.h"
+#import "AEAudioBufferManager.h"
+#import "AESampleInterpolation.h"
+
+/*!
+ * Maximum number of samples a polyphonic sample player can hold
+ */
+#define AEPolyphonicSamplePlayerMaximumSamples 256
+
+/*!
+ * @enum AEPolyphonicSamplePlayerStealingPolicy
+ *  What to do when a sample is triggered while all voices are busy
+ *
+ * @var AEPolyphonicSamplePlayerStealOldest
+ *  Take over the voice that was triggered longest ago
+ *
+ * @var AEPolyphonicSamplePlayerStealQuietest
+ *  Take over the voice with the lowest gain, preferring the oldest of equally quiet voices
+ *
+ * @var AEPolyphonicSamplePlayerStealNone
+ *  Ignore the new trigger, and count it in @link AEPolyphonicSamplePlayer::droppedTriggerCount droppedTriggerCount @endlink
+ */
+typedef enum {
+    AEPolyphonicSamplePlayerStealOldest,
+    AEPolyphonicSamplePlayerStealQuietest,
+    AEPolyphonicSamplePlayerStealNone
+} AEPolyphonicSamplePlayerStealingPolicy;
+
+/*!
+ * Polyphonic sample player
+ *
+ *  A single channel that plays any number of one-shot samples at once, from a fixed
+ *  pool of voices. This is far cheaper than adding an AEMemoryBufferPlayer to the audio
+ *  controller for each trigger, which costs a round trip to the audio thread and a
+ *  reconfiguration of the audio graph every time.
+ *
+ *  Samples are shared buffers, such as those from the
+ *  @link AEAudioSampleCache::sharedCache shared sample cache @endlink, and are never copied.
+ *  Triggers are posted with @link AEPolyphonicSamplePlayerTrigger @endlink to a lock-free
+ *  queue, and start on the exact frame given by their timestamp. Each voice can play at its
+ *  own rate, with interpolation, gain and pan.
+ *
+ *  Rendering never allocates memory or takes locks, and costs a constant amount per active
+ *  voice. When all voices are in use, a voice is stolen according to the
+ *  @link stealingPolicy @endlink; stolen voices fade out over a few milliseconds, rather
+ *  than clicking.
+ *
+ *  The audio controller's audio format must be 32-bit floating point, and samples must be
+ *  at its sample rate. Samples may be mono, which plays on every output channel, or have
+ *  as many channels as the audio controller.
+ *
+ *  To use, create an instance, add samples, and add the player to the audio controller.
+ */
+@interface AEPolyphonicSamplePlayer : NSObject <AEAudioPlayable>
+
+/*!
+ * Initialise
+ *
+ * @param audioController The audio controller
+ * @param voiceCount      The number of samples that can play at once
+ * @return The player, or nil if the audio controller's format isn't 32-bit floating point
+ */
+- (instancetype)initWithAudioController:(AEAudioController*)audioController voiceCount:(NSUInteger)voiceCount;
+
+/*!
+ * Add a sample
+ *
+ *  The sample becomes available to @link AEPolyphonicSamplePlayerTrigger @endlink straight away.
+ *
+ * @param buffer The sample's audio, in the audio controller's audio format
+ * @return The index of the sample, for use with @link AEPolyphonicSamplePlayerTrigger @endlink, or
+ *      NSNotFound if the player already holds AEPolyphonicSamplePlayerMaximumSamples samples
+ */
+- (NSUInteger)addSample:(AEAudioBufferManager*)buffer;
+
+/*!
+ * Remove all samples
+ *
+ *  Stops all voices, and releases the samples.
+ */
+- (void)removeAllSamples;
+
+/*!
+ * Stop all voices
+ *
+ *  Also discards any triggers yet to start.
+ */
+- (void)stopAllVoices;
+
+/*!
+ * Trigger a sample
+ *
+ *  Posts a trigger to the player's queue. The sample starts at the given time, to a
+ *  fraction of a frame, or at the start of the next render if time is NULL or has already
+ *  passed. Triggers can be posted ahead of time, up to the length of the queue.
+ *
+ *  This function is thread-safe and lock-free, and can be used on the audio thread, such
+ *  as from a sequencer or MIDI callback. It may be used from one thread at a time.
+ *
+ * @param player      The player
+ * @param sampleIndex The index of the sample, as returned by @link addSample: @endlink
+ * @param time        The time to start at: its sample time, on the audio controller's sample
+ *                    timeline, is used if valid, else its host time. NULL to start immediately.
+ * @param gain        Voice gain, 0.0 - 1.0 (or higher, to boost)
+ * @param pan         Voice pan, -1.0 (left) to 1.0 (right), for stereo output
+ * @param rate        Playback rate: 1.0 for the original pitch, 2.0 an octave higher
+ * @return YES if the trigger was queued, or NO if the queue was full
+ */
+BOOL AEPolyphonicSamplePlayerTrigger(__unsafe_unretained AEPolyphonicSamplePlayer *player,
+                                     UInt32 sampleIndex,
+                                     const AudioTimeStamp *time,
+                                     float gain,
+                                     float pan,
+                                     double rate);
+
+/*!
+ * Get the number of voices playing
+ *
+ *  This is thread-safe, and can be used on the audio thread.
+ *
+ * @param player The player
+ * @return The number of voices playing, not including stolen voices fading out
+ */
+UInt32 AEPolyphonicSamplePlayerGetActiveVoiceCount(__unsafe_unretained AEPolyphonicSamplePlayer *player);
+
+@property (nonatomic, readonly) NSUInteger voiceCount;      //!< The number of samples that can play at once
+@property (nonatomic, readonly) NSUInteger sampleCount;     //!< The number of samples added
+@property (nonatomic, assign) AEPolyphonicSamplePlayerStealingPolicy stealingPolicy; //!< What to do when all voices are busy; default AEPolyphonicSamplePlayerStealOldest
+@property (nonatomic, assign) AESampleInterpolation interpolation; //!< Interpolation for voices playing at other rates; default AESampleInterpolationCubicHermite
+@property (nonatomic, readonly) NSUInteger droppedTriggerCount; //!< Number of triggers ignored, because the queue was full, the sample didn't exist, or no voice was free
+@property (nonatomic, readwrite) float volume;              //!< Channel volume
+@property (nonatomic, readwrite) float pan;                  //!< Channel pan
+@property (nonatomic, readwrite) BOOL channelIsPlaying;     //!< Whether the channel is playing
+@property (nonatomic, readwrite) BOOL channelIsMuted;       //!< Whether the channel is muted
+@end
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,448 @@
+//
+//  AEPolyphonicSamplePlayer.m
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#import "AEPolyphonicSamplePlayer.h"
+#import "AEUtilities.h"
+#import "TPCircularBuffer.h"
+#import <libkern/OSAtomic.h>
+#import <Accelerate/Accelerate.h>
+
+#define kMaxPendingTriggers 256  // Triggers held by the audio thread, awaiting their start time
+
+static const UInt32 kTriggerQueueLength  = 1024;  // Triggers that can be posted ahead of the audio thread
+static const UInt32 kFadeSlotCount       = 16;    // Stolen voices that can fade out at once
+static const UInt32 kStealFadeFrames     = 128;
+static const UInt32 kScratchFrames       = 1024;
+
+typedef struct {
+    AudioBufferList *audio;
+    UInt32           channels;
+    BOOL             interleaved;
+    UInt32           lengthInFrames;
+} sample_t;
+
+typedef struct {
+    UInt32           sample;
+    float            gain;
+    float            pan;
+    AESamplePosition increment;
+    AudioTimeStamp   time;
+} trigger_t;
+
+typedef struct {
+    BOOL             fading;        // Stolen, and fading out; doesn't count towards the voice count
+    UInt32           sample;
+    AESamplePosition position;
+    AESamplePosition increment;
+    float            gain;
+    float            pan;
+    UInt32           delay;         // Frames into the current buffer before the voice starts
+    BOOL             startedThisBuffer; // Started during the current buffer, and not yet rendered
+    UInt32           fadeStart;     // Frame of the current buffer at which the fade begins
+    UInt32           fadeRemaining;
+    UInt64           serial;        // Trigger order, for stealing
+} voice_t;
+
+static void resetVoices(__unsafe_unretained AEPolyphonicSamplePlayer *THIS);
+
+@interface AEPolyphonicSamplePlayer () {
+    AudioStreamBasicDescription _audioDescription;
+    sample_t                    _samples[AEPolyphonicSamplePlayerMaximumSamples];
+    volatile int32_t            _sampleCount;
+    NSMutableArray             *_sampleBuffers;
+    TPCircularBuffer            _triggerQueue;
+    trigger_t                   _pending[kMaxPendingTriggers];
+    UInt32                      _pendingCount;
+    voice_t                    *_voices;
+    UInt32                      _slotCount;
+    UInt32                     *_activeSlots;
+    UInt32                      _activeSlotCount;
+    UInt32                     *_freeSlots;
+    UInt32                      _freeSlotCount;
+    volatile int32_t            _activeVoiceCount;
+    UInt32                      _fadingVoiceCount;
+    UInt64                      _serial;
+    float                      *_scratch;
+    volatile int32_t            _droppedTriggerCount;
+}
+@property (nonatomic, weak) AEAudioController *audioController;
+@end
+
+@implementation AEPolyphonicSamplePlayer
+
+- (instancetype)initWithAudioController:(AEAudioController *)audioController voiceCount:(NSUInteger)voiceCount {
+    AudioStreamBasicDescription audioDescription = audioController.audioDescription;
+    if ( !(audioDescription.mFormatFlags & kAudioFormatFlagIsFloat) || audioDescription.mBitsPerChannel != 32 ) {
+        NSLog(@"AEPolyphonicSamplePlayer: Audio format must be 32-bit floating point");
+        return nil;
+    }
+
+    if ( !(self = [super init]) ) return nil;
+
+    self.audioController = audioController;
+    _audioDescription = audioDescription;
+    _voiceCount = MAX(1, voiceCount);
+    _slotCount = (UInt32)_voiceCount + kFadeSlotCount;
+    _voices = calloc(_slotCount, sizeof(voice_t));
+    _activeSlots = calloc(_slotCount, sizeof(UInt32));
+    _freeSlots = calloc(_slotCount, sizeof(UInt32));
+    _scratch = calloc(kScratchFrames * _audioDescription.mChannelsPerFrame, sizeof(float));
+    if ( !_voices || !_activeSlots || !_freeSlots || !_scratch || !TPCircularBufferInit(&_triggerQueue, kTriggerQueueLength * sizeof(trigger_t)) ) {
+        free(_voices);
+        free(_activeSlots);
+        free(_freeSlots);
+        free(_scratch);
+        return nil;
+    }
+    resetVoices(self);
+
+    _sampleBuffers = [NSMutableArray array];
+    _stealingPolicy = AEPolyphonicSamplePlayerStealOldest;
+    _interpolation = AESampleInterpolationCubicHermite;
+    _volume = 1.0;
+    _channelIsPlaying = YES;
+    AESampleInterpolationPrepare();
+
+    return self;
+}
+
+- (void)dealloc {
+    free(_voices);
+    free(_activeSlots);
+    free(_freeSlots);
+    free(_scratch);
+    TPCircularBufferCleanup(&_triggerQueue);
+}
+
+- (NSUInteger)addSample:(AEAudioBufferManager *)buffer {
+    if ( _sampleCount >= AEPolyphonicSamplePlayerMaximumSamples ) return NSNotFound;
+
+    AudioBufferList *audio = AEAudioBufferManagerGetBuffer(buffer);
+    sample_t *sample = &_samples[_sampleCount];
+    sample->audio = audio;
+    sample->interleaved = audio->mNumberBuffers == 1 && audio->mBuffers[0].mNumberChannels > 1;
+    sample->channels = sample->interleaved ? audio->mBuffers[0].mNumberChannels : audio->mNumberBuffers;
+    sample->lengthInFrames = audio->mBuffers[0].mDataByteSize / (sizeof(float) * (sample->interleaved ? sample->channels : 1));
+    [_sampleBuffers addObject:buffer];
+
+    // Publish the sample to the audio thread once it's complete
+    OSMemoryBarrier();
+    OSAtomicIncrement32(&_sampleCount);
+
+    return _sampleCount - 1;
+}
+
+- (void)removeAllSamples {
+    [_audioController performSynchronousMessageExchangeWithBlock:^{
+        resetVoices(self);
+        self->_sampleCount = 0;
+    }];
+    [_sampleBuffers removeAllObjects];
+}
+
+- (void)stopAllVoices {
+    [_audioController performSynchronousMessageExchangeWithBlock:^{
+        resetVoices(self);
+    }];
+}
+
+-(NSUInteger)sampleCount {
+    return _sampleCount;
+}
+
+-(NSUInteger)droppedTriggerCount {
+    return _droppedTriggerCount;
+}
+
+static void resetVoices(__unsafe_unretained AEPolyphonicSamplePlayer *THIS) {
+    THIS->_activeSlotCount = 0;
+    THIS->_freeSlotCount = THIS->_slotCount;
+    for ( UInt32 i=0; i<THIS->_slotCount; i++ ) {
+        THIS->_freeSlots[i] = THIS->_slotCount - 1 - i;
+    }
+    THIS->_activeVoiceCount = 0;
+    THIS->_fadingVoiceCount = 0;
+    THIS->_pendingCount = 0;
+
+    int32_t availableBytes;
+    TPCircularBufferTail(&THIS->_triggerQueue, &availableBytes);
+    TPCircularBufferConsume(&THIS->_triggerQueue, availableBytes);
+}
+
+BOOL AEPolyphonicSamplePlayerTrigger(__unsafe_unretained AEPolyphonicSamplePlayer *THIS,
+                                     UInt32 sampleIndex,
+                                     const AudioTimeStamp *time,
+                                     float gain,
+                                     float pan,
+                                     double rate) {
+    int32_t availableBytes;
+    trigger_t *trigger = TPCircularBufferHead(&THIS->_triggerQueue, &availableBytes);
+    if ( !trigger || availableBytes < (int32_t)sizeof(trigger_t) ) {
+        OSAtomicIncrement32(&THIS->_droppedTriggerCount);
+        return NO;
+    }
+
+    trigger->sample = sampleIndex;
+    trigger->gain = gain;
+    trigger->pan = MAX(-1.0f, MIN(1.0f, pan));
+    trigger->increment = MAX(1, AESamplePositionFromFrames(rate));
+    if ( time ) {
+        trigger->time = *time;
+    } else {
+        memset(&trigger->time, 0, sizeof(AudioTimeStamp));
+    }
+
+    TPCircularBufferProduce(&THIS->_triggerQueue, sizeof(trigger_t));
+    return YES;
+}
+
+UInt32 AEPolyphonicSamplePlayerGetActiveVoiceCount(__unsafe_unretained AEPolyphonicSamplePlayer *THIS) {
+    return THIS->_activeVoiceCount;
+}
+
+#pragma mark - Rendering
+
+static double triggerOffset(const trigger_t *trigger, const AudioTimeStamp *time, double sampleRate) {
+    // Frames from the start of this buffer to the trigger's start time
+    if ( (trigger->time.mFlags & kAudioTimeStampSampleTimeValid) && (time->mFlags & kAudioTimeStampSampleTimeValid) ) {
+        return trigger->time.mSampleTime - time->mSampleTime;
+    }
+    if ( (trigger->time.mFlags & kAudioTimeStampHostTimeValid) && (time->mFlags & kAudioTimeStampHostTimeValid) ) {
+        return trigger->time.mHostTime >= time->mHostTime
+            ?  AESecondsFromHostTicks(trigger->time.mHostTime - time->mHostTime) * sampleRate
+            : -AESecondsFromHostTicks(time->mHostTime - trigger->time.mHostTime) * sampleRate;
+    }
+    return 0.0;
+}
+
+static voice_t * voiceToSteal(__unsafe_unretained AEPolyphonicSamplePlayer *THIS) {
+    voice_t *candidate = NULL;
+    for ( UInt32 i=0; i<THIS->_activeSlotCount; i++ ) {
+        voice_t *voice = &THIS->_voices[THIS->_activeSlots[i]];
+        if ( voice->fading ) continue;
+        if ( !candidate
+                || (THIS->_stealingPolicy == AEPolyphonicSamplePlayerStealQuietest && voice->gain < candidate->gain)
+                || ((THIS->_stealingPolicy != AEPolyphonicSamplePlayerStealQuietest || voice->gain == candidate->gain) && voice->serial < candidate->serial) ) {
+            candidate = voice;
+        }
+    }
+    return candidate;
+}
+
+static voice_t * takeFreeSlot(__unsafe_unretained AEPolyphonicSamplePlayer *THIS) {
+    if ( THIS->_freeSlotCount == 0 ) return NULL;
+    UInt32 slot = THIS->_freeSlots[--THIS->_freeSlotCount];
+    THIS->_activeSlots[THIS->_activeSlotCount++] = slot;
+    return &THIS->_voices[slot];
+}
+
+static void startVoice(__unsafe_unretained AEPolyphonicSamplePlayer *THIS, const trigger_t *trigger, double offset) {
+    if ( trigger->sample >= THIS->_sampleCount || THIS->_samples[trigger->sample].lengthInFrames == 0 ) {
+        OSAtomicIncrement32(&THIS->_droppedTriggerCount);
+        return;
+    }
+
+    UInt32 delay = (UInt32)ceil(offset);
+    voice_t *voice;
+
+    if ( THIS->_activeVoiceCount < THIS->_voiceCount ) {
+        voice = takeFreeSlot(THIS);
+    } else {
+        if ( THIS->_stealingPolicy == AEPolyphonicSamplePlayerStealNone || !(voice = voiceToSteal(THIS)) ) {
+            OSAtomicIncrement32(&THIS->_droppedTriggerCount);
+            return;
+        }
+
+        // A voice already playing is still sounding when the new one starts; one started earlier in this
+        // buffer only if it starts first. Otherwise, there's nothing yet to fade.
+        BOOL sounding = !voice->startedThisBuffer || voice->delay < delay;
+        if ( sounding && THIS->_fadingVoiceCount < kFadeSlotCount ) {
+            // Hand what's left of the stolen voice to a spare slot, to fade out from the new voice's start
+            voice_t *fade = takeFreeSlot(THIS);
+            *fade = *voice;
+            fade->fading = YES;
+            fade->fadeStart = delay;
+            fade->fadeRemaining = kStealFadeFrames;
+            THIS->_fadingVoiceCount++;
+        }
+        THIS->_activeVoiceCount--;
+    }
+
+    // A start time between two frames begins the first frame part-way in
+    *voice = (voice_t) {
+        .sample = trigger->sample,
+        .position = (AESamplePosition)((delay - offset) * (double)trigger->increment),
+        .increment = trigger->increment,
+        .gain = trigger->gain,
+        .pan = trigger->pan,
+        .delay = delay,
+        .startedThisBuffer = YES,
+        .serial = ++THIS->_serial,
+    };
+    THIS->_activeVoiceCount++;
+}
+
+static BOOL renderVoice(__unsafe_unretained AEPolyphonicSamplePlayer *THIS, voice_t *voice, float **outputs, UInt32 outputStride, UInt32 frames) {
+    const sample_t *sample = &THIS->_samples[voice->sample];
+    UInt32 outputChannels = THIS->_audioDescription.mChannelsPerFrame;
+    UInt32 sourceStride = sample->interleaved ? sample->channels : 1;
+    UInt32 sourceChannels = MIN(sample->channels, outputChannels);
+    AESamplePosition end = (AESamplePosition)sample->lengthInFrames << 32;
+
+    float gains[outputChannels];
+    for ( int i=0; i<outputChannels; i++ ) gains[i] = voice->gain;
+    if ( outputChannels == 2 ) {
+        gains[0] *= voice->pan > 0.0f ? 1.0f - voice->pan : 1.0f;
+        gains[1] *= voice->pan < 0.0f ? 1.0f + voice->pan : 1.0f;
+    }
+
+    UInt32 frame = voice->delay;
+    voice->delay = 0;
+    voice->startedThisBuffer = NO;
+
+    while ( frame < frames && voice->position < end ) {
+        UInt32 count = (UInt32)MIN((AESamplePosition)MIN(frames - frame, kScratchFrames), (end - voice->position + voice->increment - 1) / voice->increment);
+
+        float level = 1.0f, step = 0.0f;
+        if ( voice->fading ) {
+            if ( frame < voice->fadeStart ) {
+                count = MIN(count, voice->fadeStart - frame);
+            } else {
+                count = MIN(count, voice->fadeRemaining);
+                level = (float)voice->fadeRemaining / kStealFadeFrames;
+                step = -1.0f / kStealFadeFrames;
+            }
+        }
+
+        // Read straight from the sample when playing whole frames at the original rate, else interpolate
+        BOOL direct = voice->increment == AESamplePositionOneFrame && (uint32_t)voice->position == 0;
+        if ( !direct ) {
+            for ( int i=0; i<sourceChannels; i++ ) {
+                const float *source = sample->interleaved ? (const float*)sample->audio->mBuffers[0].mData + i : (const float*)sample->audio->mBuffers[i].mData;
+                AESampleInterpolationRender(THIS->_interpolation, source, sourceStride, sample->lengthInFrames, false,
+                                            voice->position, voice->increment, THIS->_scratch + i*kScratchFrames, 1, count);
+            }
+        }
+
+        for ( int i=0; i<outputChannels; i++ ) {
+            int sourceChannel = i % sourceChannels;
+            const float *source;
+            vDSP_Stride stride;
+            if ( direct ) {
+                source = (sample->interleaved ? (const float*)sample->audio->mBuffers[0].mData + sourceChannel : (const float*)sample->audio->mBuffers[sourceChannel].mData)
+                            + (size_t)(voice->position >> 32) * sourceStride;
+                stride = sourceStride;
+            } else {
+                source = THIS->_scratch + sourceChannel*kScratchFrames;
+                stride = 1;
+            }
+
+            float *target = outputs[i] + (size_t)frame * outputStride;
+            float gain = gains[i] * level;
+            if ( step != 0.0f ) {
+                float gainStep = gains[i] * step;
+                vDSP_vrampmuladd(source, stride, &gain, &gainStep, target, outputStride, count);
+            } else {
+                vDSP_vsma(source, stride, &gain, target, outputStride, target, outputStride, count);
+            }
+        }
+
+        voice->position += count * voice->increment;
+        frame += count;
+
+        if ( step != 0.0f ) {
+            voice->fadeRemaining -= count;
+            if ( voice->fadeRemaining == 0 ) return NO;
+        }
+    }
+
+    voice->fadeStart = 0;
+    return voice->position < end;
+}
+
+static OSStatus renderCallback(__unsafe_unretained AEPolyphonicSamplePlayer *THIS, __unsafe_unretained AEAudioController *audioController, const AudioTimeStamp *time, UInt32 frames, AudioBufferList *audio) {
+    if ( !THIS->_channelIsPlaying ) return noErr;
+
+    // Voices are mixed into the output
+    for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+        memset(audio->mBuffers[i].mData, 0, audio->mBuffers[i].mDataByteSize);
+    }
+
+    // Take newly posted triggers
+    int32_t availableBytes;
+    trigger_t *triggers = TPCircularBufferTail(&THIS->_triggerQueue, &availableBytes);
+    UInt32 count = MIN(availableBytes / sizeof(trigger_t), kMaxPendingTriggers - THIS->_pendingCount);
+    if ( count > 0 ) {
+        memcpy(&THIS->_pending[THIS->_pendingCount], triggers, count * sizeof(trigger_t));
+        THIS->_pendingCount += count;
+        TPCircularBufferConsume(&THIS->_triggerQueue, count * sizeof(trigger_t));
+    }
+
+    // Start the triggers due within this buffer, and keep the rest for later
+    UInt32 remaining = 0;
+    for ( UInt32 i=0; i<THIS->_pendingCount; i++ ) {
+        double offset = triggerOffset(&THIS->_pending[i], time, THIS->_audioDescription.mSampleRate);
+        if ( offset >= frames ) {
+            THIS->_pending[remaining++] = THIS->_pending[i];
+        } else {
+            startVoice(THIS, &THIS->_pending[i], MAX(0.0, offset));
+        }
+    }
+    THIS->_pendingCount = remaining;
+
+    // Output layout
+    UInt32 outputChannels = THIS->_audioDescription.mChannelsPerFrame;
+    BOOL interleaved = audio->mNumberBuffers != outputChannels;
+    float *outputs[outputChannels];
+    for ( int i=0; i<outputChannels; i++ ) {
+        outputs[i] = interleaved ? (float*)audio->mBuffers[0].mData + i : (float*)audio->mBuffers[i].mData;
+    }
+
+    // Render each active voice, releasing those that finish
+    UInt32 active = 0;
+    for ( UInt32 i=0; i<THIS->_activeSlotCount; i++ ) {
+        UInt32 slot = THIS->_activeSlots[i];
+        voice_t *voice = &THIS->_voices[slot];
+        if ( renderVoice(THIS, voice, outputs, interleaved ? outputChannels : 1, frames) ) {
+            THIS->_activeSlots[active++] = slot;
+        } else {
+            THIS->_freeSlots[THIS->_freeSlotCount++] = slot;
+            if ( voice->fading ) {
+                THIS->_fadingVoiceCount--;
+            } else {
+                THIS->_activeVoiceCount--;
+            }
+        }
+    }
+    THIS->_activeSlotCount = active;
+
+    return noErr;
+}
+
+-(AEAudioRenderCallback)renderCallback {
+    return renderCallback;
+}
+
+@end
@@ -0,0 +1,531 @@
+//
+//  AERealtimeWatchdog-linux.c
+//  TheAmazingAudioEngine
+//
+//  Created by Michael Tyson on 12/06/2016.
+//  Idea by Taylor Holliday
+//  Copyright © 2016 A Tasty Pixel. All rights reserved.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+//
+//  Linux interposition library version of the realtime watchdog, loaded via LD_PRELOAD.
+//
+//  Build:
+//
+//      cc -shared -fPIC -O2 -o libAERealtimeWatchdog.so AERealtimeWatchdog-linux.c -ldl -lpthread
+//
+//  Use:
+//
+//      LD_PRELOAD=./libAERealtimeWatchdog.so ./my-offline-render
+//
+//  Threads mark themselves as realtime with AERealtimeWatchdogRegisterCurrentThread (see
+//  AERealtimeWatchdog.h). Unsafe activity on a registered thread is counted per thread and per
+//  function, and the first few infractions of each function have their backtraces sampled.
+//  A report is written to stderr at exit (or to the file named by AE_RT_WATCHDOG_REPORT).
+//  If AE_RT_WATCHDOG_EXIT_STATUS is set and any infractions occurred, the process exits with
+//  that status, so test runs can be gated on zero realtime violations.
+//
+
+#ifdef __linux__
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define AE_WATCHDOG_EXPORT __attribute__((visibility("default")))
+#define AE_WATCHDOG_TLS __thread __attribute__((tls_model("initial-exec")))
+
+enum {
+    kMaxRealtimeThreads     = 64,
+    kMaxThreadNameLength    = 32,
+    kMaxBacktraceSamples    = 32,
+    kMaxBacktraceFrames     = 24,
+    kSamplesPerFunction     = 4,
+    kBootstrapHeapSize      = 16384,
+    kBootstrapHeaderSize    = 16        // Each bootstrap allocation's size, padded to keep alignment
+};
+
+#pragma mark - Infraction types
+
+typedef enum {
+    kCategoryAllocation,
+    kCategoryLock,
+    kCategoryFileIO,
+    kCategorySocketIO,
+    kCategorySleep,
+    kCategoryCount
+} AERealtimeWatchdogCategory;
+
+static const char * kCategoryNames[kCategoryCount] = {
+    "memory allocation", "lock", "file I/O", "socket I/O", "sleep"
+};
+
+typedef enum {
+    kFunctionMalloc, kFunctionCalloc, kFunctionRealloc, kFunctionFree, kFunctionPosixMemalign,
+    kFunctionPthreadMutexLock, kFunctionPthreadRwlockRdlock, kFunctionPthreadRwlockWrlock,
+    kFunctionPthreadCondWait, kFunctionSemWait,
+    kFunctionOpen, kFunctionFopen, kFunctionFread, kFunctionFwrite, kFunctionFgets,
+    kFunctionRead, kFunctionPread, kFunctionWrite, kFunctionPwrite,
+    kFunctionSend, kFunctionSendto, kFunctionRecv, kFunctionRecvfrom,
+    kFunctionUsleep, kFunctionNanosleep,
+    kFunctionCount
+} AERealtimeWatchdogFunction;
+
+static const struct { const char *name; AERealtimeWatchdogCategory category; } kFunctions[kFunctionCount] = {
+    [kFunctionMalloc]               = { "malloc",               kCategoryAllocation },
+    [kFunctionCalloc]               = { "calloc",               kCategoryAllocation },
+    [kFunctionRealloc]              = { "realloc",              kCategoryAllocation },
+    [kFunctionFree]                 = { "free",                 kCategoryAllocation },
+    [kFunctionPosixMemalign]        = { "posix_memalign",       kCategoryAllocation },
+    [kFunctionPthreadMutexLock]     = { "pthread_mutex_lock",   kCategoryLock },
+    [kFunctionPthreadRwlockRdlock]  = { "pthread_rwlock_rdlock",kCategoryLock },
+    [kFunctionPthreadRwlockWrlock]  = { "pthread_rwlock_wrlock",kCategoryLock },
+    [kFunctionPthreadCondWait]      = { "pthread_cond_wait",    kCategoryLock },
+    [kFunctionSemWait]              = { "sem_wait",             kCategoryLock },
+    [kFunctionOpen]                 = { "open",                 kCategoryFileIO },
+    [kFunctionFopen]                = { "fopen",                kCategoryFileIO },
+    [kFunctionFread]                = { "fread",                kCategoryFileIO },
+    [kFunctionFwrite]               = { "fwrite",               kCategoryFileIO },
+    [kFunctionFgets]                = { "fgets",                kCategoryFileIO },
+    [kFunctionRead]                 = { "read",                 kCategoryFileIO },
+    [kFunctionPread]                = { "pread",                kCategoryFileIO },
+    [kFunctionWrite]                = { "write",                kCategoryFileIO },
+    [kFunctionPwrite]               = { "pwrite",               kCategoryFileIO },
+    [kFunctionSend]                 = { "send",                 kCategorySocketIO },
+    [kFunctionSendto]               = { "sendto",               kCategorySocketIO },
+    [kFunctionRecv]                 = { "recv",                 kCategorySocketIO },
+    [kFunctionRecvfrom]             = { "recvfrom",             kCategorySocketIO },
+    [kFunctionUsleep]               = { "usleep",               kCategorySleep },
+    [kFunctionNanosleep]            = { "nanosleep",            kCategorySleep },
+};
+
+#pragma mark - State
+
+typedef struct {
+    atomic_int      inUse;
+    char            name[kMaxThreadNameLength];
+    atomic_ulong    counts[kFunctionCount];
+} realtime_thread_t;
+
+typedef struct {
+    int             thread;
+    AERealtimeWatchdogFunction function;
+    int             frameCount;
+    void           *frames[kMaxBacktraceFrames];
+} backtrace_sample_t;
+
+static realtime_thread_t __threads[kMaxRealtimeThreads];
+static atomic_ulong __totalCount;
+static atomic_ulong __functionCounts[kFunctionCount];
+static backtrace_sample_t __samples[kMaxBacktraceSamples];
+static atomic_int __sampleCount;
+
+// Per-thread state: a plain TLS read is all it costs to decide whether a call needs checking
+static AE_WATCHDOG_TLS realtime_thread_t *__currentThread = NULL;
+static AE_WATCHDOG_TLS int __inWatchdog = 0;
+
+// dlsym may itself allocate, before we know where the real allocator is
+static char __bootstrapHeap[kBootstrapHeapSize];
+static size_t __bootstrapHeapUsed = 0;
+static int __resolving = 0;
+
+#pragma mark - Real function pointers
+
+static void * (*__malloc)(size_t);
+static void * (*__calloc)(size_t, size_t);
+static void * (*__realloc)(void *, size_t);
+static void (*__free)(void *);
+static int (*__posix_memalign)(void **, size_t, size_t);
+static int (*__pthread_mutex_lock)(pthread_mutex_t *);
+static int (*__pthread_rwlock_rdlock)(pthread_rwlock_t *);
+static int (*__pthread_rwlock_wrlock)(pthread_rwlock_t *);
+static int (*__pthread_cond_wait)(pthread_cond_t *, pthread_mutex_t *);
+static int (*__sem_wait)(sem_t *);
+static int (*__open)(const char *, int, ...);
+static FILE * (*__fopen)(const char *, const char *);
+static size_t (*__fread)(void *, size_t, size_t, FILE *);
+static size_t (*__fwrite)(const void *, size_t, size_t, FILE *);
+static char * (*__fgets)(char *, int, FILE *);
+static ssize_t (*__read)(int, void *, size_t);
+static ssize_t (*__pread)(int, void *, size_t, off_t);
+static ssize_t (*__write)(int, const void *, size_t);
+static ssize_t (*__pwrite)(int, const void *, size_t, off_t);
+static ssize_t (*__send)(int, const void *, size_t, int);
+static ssize_t (*__sendto)(int, const void *, size_t, int, const struct sockaddr *, socklen_t);
+static ssize_t (*__recv)(int, void *, size_t, int);
+static ssize_t (*__recvfrom)(int, void *, size_t, int, struct sockaddr *, socklen_t *);
+static int (*__usleep)(useconds_t);
+static int (*__nanosleep)(const struct timespec *, struct timespec *);
+
+static void AERealtimeWatchdogResolve(void) {
+    if ( __resolving ) return;
+    __resolving = 1;
+    __malloc = dlsym(RTLD_NEXT, "malloc");
+    __calloc = dlsym(RTLD_NEXT, "calloc");
+    __realloc = dlsym(RTLD_NEXT, "realloc");
+    __free = dlsym(RTLD_NEXT, "free");
+    __posix_memalign = dlsym(RTLD_NEXT, "posix_memalign");
+    __pthread_mutex_lock = dlsym(RTLD_NEXT, "pthread_mutex_lock");
+    __pthread_rwlock_rdlock = dlsym(RTLD_NEXT, "pthread_rwlock_rdlock");
+    __pthread_rwlock_wrlock = dlsym(RTLD_NEXT, "pthread_rwlock_wrlock");
+    __pthread_cond_wait = dlvsym(RTLD_NEXT, "pthread_cond_wait", "GLIBC_2.3.2");
+    if ( !__pthread_cond_wait ) __pthread_cond_wait = dlsym(RTLD_NEXT, "pthread_cond_wait");
+    __sem_wait = dlsym(RTLD_NEXT, "sem_wait");
+    __open = dlsym(RTLD_NEXT, "open");
+    __fopen = dlsym(RTLD_NEXT, "fopen");
+    __fread = dlsym(RTLD_NEXT, "fread");
+    __fwrite = dlsym(RTLD_NEXT, "fwrite");
+    __fgets = dlsym(RTLD_NEXT, "fgets");
+    __read = dlsym(RTLD_NEXT, "read");
+    __pread = dlsym(RTLD_NEXT, "pread");
+    __write = dlsym(RTLD_NEXT, "write");
+    __pwrite = dlsym(RTLD_NEXT, "pwrite");
+    __send = dlsym(RTLD_NEXT, "send");
+    __sendto = dlsym(RTLD_NEXT, "sendto");
+    __recv = dlsym(RTLD_NEXT, "recv");
+    __recvfrom = dlsym(RTLD_NEXT, "recvfrom");
+    __usleep = dlsym(RTLD_NEXT, "usleep");
+    __nanosleep = dlsym(RTLD_NEXT, "nanosleep");
+    __resolving = 0;
+}
+
+static void * AERealtimeWatchdogBootstrapAlloc(size_t size) {
+    size_t blockSize = kBootstrapHeaderSize + ((size + 15) & ~(size_t)15);
+    if ( blockSize < size || __bootstrapHeapUsed + blockSize > kBootstrapHeapSize ) return NULL;
+    char *block = __bootstrapHeap + __bootstrapHeapUsed;
+    __bootstrapHeapUsed += blockSize;
+    *(size_t*)block = size;
+    return block + kBootstrapHeaderSize;
+}
+
+static inline size_t AERealtimeWatchdogBootstrapAllocSize(void *ptr) {
+    return *(size_t*)((char*)ptr - kBootstrapHeaderSize);
+}
+
+static inline int AERealtimeWatchdogIsBootstrapPointer(void *ptr) {
+    return (char*)ptr >= __bootstrapHeap && (char*)ptr < __bootstrapHeap + kBootstrapHeapSize;
+}
+
+#pragma mark - Infraction accounting
+
+static void AERealtimeWatchdogUnsafeActivity(AERealtimeWatchdogFunction function) {
+    // Guard against re-entry, as backtrace() may itself call some of the functions we interpose
+    if ( __inWatchdog ) return;
+    __inWatchdog = 1;
+
+    realtime_thread_t *thread = __currentThread;
+    unsigned long threadCount = atomic_fetch_add_explicit(&thread->counts[function], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&__functionCounts[function], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&__totalCount, 1, memory_order_relaxed);
+
+    if ( threadCount < kSamplesPerFunction ) {
+        // Sample the first few backtraces of each function on each thread
+        int index = atomic_fetch_add_explicit(&__sampleCount, 1, memory_order_relaxed);
+        if ( index < kMaxBacktraceSamples ) {
+            backtrace_sample_t *sample = &__samples[index];
+            sample->thread = (int)(thread - __threads);
+            sample->function = function;
+            sample->frameCount = backtrace(sample->frames, kMaxBacktraceFrames);
+        }
+    }
+
+    __inWatchdog = 0;
+}
+
+#define AERealtimeWatchdogCheck(function) \
+    if ( __currentThread && !__inWatchdog ) AERealtimeWatchdogUnsafeActivity(function)
+
+#pragma mark - Registration
+
+AE_WATCHDOG_EXPORT void AERealtimeWatchdogRegisterCurrentThread(const char *name) {
+    if ( __currentThread ) return;
+
+    for ( int i=0; i<kMaxRealtimeThreads; i++ ) {
+        int expected = 0;
+        if ( atomic_compare_exchange_strong(&__threads[i].inUse, &expected, 1) ) {
+            if ( name ) {
+                strncpy(__threads[i].name, name, kMaxThreadNameLength-1);
+            } else {
+                snprintf(__threads[i].name, kMaxThreadNameLength, "thread %d", i);
+            }
+            __currentThread = &__threads[i];
+            return;
+        }
+    }
+
+    // Out of slots: share the last one
+    __currentThread = &__threads[kMaxRealtimeThreads-1];
+}
+
+AE_WATCHDOG_EXPORT void AERealtimeWatchdogUnregisterCurrentThread(void) {
+    // The slot stays claimed, so its counters make it into the report
+    __currentThread = NULL;
+}
+
+AE_WATCHDOG_EXPORT unsigned long AERealtimeWatchdogGetInfractionCount(void) {
+    return atomic_load_explicit(&__totalCount, memory_order_relaxed);
+}
+
+#pragma mark - Report
+
+static void AERealtimeWatchdogWriteReport(FILE *file) {
+    unsigned long total = atomic_load(&__totalCount);
+    fprintf(file, "AERealtimeWatchdog: %lu infraction%s on realtime threads\n", total, total == 1 ? "" : "s");
+    if ( total == 0 ) return;
+
+    unsigned long categoryCounts[kCategoryCount] = {0};
+    for ( int i=0; i<kFunctionCount; i++ ) {
+        categoryCounts[kFunctions[i].category] += atomic_load(&__functionCounts[i]);
+    }
+    for ( int i=0; i<kCategoryCount; i++ ) {
+        if ( categoryCounts[i] ) fprintf(file, "  %-20s %lu\n", kCategoryNames[i], categoryCounts[i]);
+    }
+
+    for ( int t=0; t<kMaxRealtimeThreads; t++ ) {
+        if ( !atomic_load(&__threads[t].inUse) ) continue;
+        for ( int i=0; i<kFunctionCount; i++ ) {
+            unsigned long count = atomic_load(&__threads[t].counts[i]);
+            if ( count ) fprintf(file, "  [%s] %s: %lu\n", __threads[t].name, kFunctions[i].name, count);
+        }
+    }
+
+    int sampleCount = atomic_load(&__sampleCount);
+    if ( sampleCount > kMaxBacktraceSamples ) sampleCount = kMaxBacktraceSamples;
+    for ( int i=0; i<sampleCount; i++ ) {
+        backtrace_sample_t *sample = &__samples[i];
+        fprintf(file, "\n  Sample %d: %s on [%s]\n", i+1, kFunctions[sample->function].name, __threads[sample->thread].name);
+        fflush(file);
+        // Skip our own frames (AERealtimeWatchdogUnsafeActivity and the interposer)
+        int skip = sample->frameCount > 2 ? 2 : 0;
+        backtrace_symbols_fd(sample->frames + skip, sample->frameCount - skip, fileno(file));
+    }
+}
+
+__attribute__((constructor)) static void AERealtimeWatchdogInit(void) {
+    AERealtimeWatchdogResolve();
+
+    // Load the unwinder now, rather than on the first infraction
+    void *frames[2];
+    backtrace(frames, 2);
+}
+
+__attribute__((destructor)) static void AERealtimeWatchdogFinish(void) {
+    __currentThread = NULL;
+
+    const char *path = getenv("AE_RT_WATCHDOG_REPORT");
+    FILE *file = path ? fopen(path, "w") : NULL;
+    AERealtimeWatchdogWriteReport(file ? file : stderr);
+    if ( file ) fclose(file);
+
+    const char *exitStatus = getenv("AE_RT_WATCHDOG_EXIT_STATUS");
+    if ( exitStatus && atomic_load(&__totalCount) > 0 ) {
+        fflush(NULL);
+        _exit(atoi(exitStatus));
+    }
+}
+
+#pragma mark - Overrides
+
+AE_WATCHDOG_EXPORT void * malloc(size_t size) {
+    if ( !__malloc ) {
+        if ( __resolving ) return AERealtimeWatchdogBootstrapAlloc(size);
+        AERealtimeWatchdogResolve();
+    }
+    AERealtimeWatchdogCheck(kFunctionMalloc);
+    return __malloc(size);
+}
+
+AE_WATCHDOG_EXPORT void * calloc(size_t count, size_t size) {
+    if ( !__calloc ) {
+        // Bootstrap heap is zeroed static storage
+        if ( __resolving ) return AERealtimeWatchdogBootstrapAlloc(count * size);
+        AERealtimeWatchdogResolve();
+    }
+    AERealtimeWatchdogCheck(kFunctionCalloc);
+    return __calloc(count, size);
+}
+
+AE_WATCHDOG_EXPORT void * realloc(void *ptr, size_t size) {
+    if ( !__realloc ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionRealloc);
+    if ( AERealtimeWatchdogIsBootstrapPointer(ptr) ) {
+        // Move it to the real heap, copying no more than the original allocation held
+        size_t oldSize = AERealtimeWatchdogBootstrapAllocSize(ptr);
+        void *newPtr = __malloc(size);
+        if ( newPtr ) memcpy(newPtr, ptr, size < oldSize ? size : oldSize);
+        return newPtr;
+    }
+    return __realloc(ptr, size);
+}
+
+AE_WATCHDOG_EXPORT void free(void *ptr) {
+    if ( !ptr || AERealtimeWatchdogIsBootstrapPointer(ptr) ) return;
+    if ( !__free ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionFree);
+    __free(ptr);
+}
+
+AE_WATCHDOG_EXPORT int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    if ( !__posix_memalign ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionPosixMemalign);
+    return __posix_memalign(ptr, alignment, size);
+}
+
+AE_WATCHDOG_EXPORT int pthread_mutex_lock(pthread_mutex_t *mutex) {
+    if ( !__pthread_mutex_lock ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionPthreadMutexLock);
+    return __pthread_mutex_lock(mutex);
+}
+
+AE_WATCHDOG_EXPORT int pthread_rwlock_rdlock(pthread_rwlock_t *lock) {
+    if ( !__pthread_rwlock_rdlock ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionPthreadRwlockRdlock);
+    return __pthread_rwlock_rdlock(lock);
+}
+
+AE_WATCHDOG_EXPORT int pthread_rwlock_wrlock(pthread_rwlock_t *lock) {
+    if ( !__pthread_rwlock_wrlock ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionPthreadRwlockWrlock);
+    return __pthread_rwlock_wrlock(lock);
+}
+
+AE_WATCHDOG_EXPORT int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) {
+    if ( !__pthread_cond_wait ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionPthreadCondWait);
+    return __pthread_cond_wait(cond, mutex);
+}
+
+AE_WATCHDOG_EXPORT int sem_wait(sem_t *sem) {
+    if ( !__sem_wait ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionSemWait);
+    return __sem_wait(sem);
+}
+
+AE_WATCHDOG_EXPORT int open(const char *path, int flags, ...) {
+    if ( !__open ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionOpen);
+    mode_t mode = 0;
+    if ( flags & (O_CREAT | O_TMPFILE) ) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    return __open(path, flags, mode);
+}
+
+AE_WATCHDOG_EXPORT FILE * fopen(const char *filename, const char *mode) {
+    if ( !__fopen ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionFopen);
+    return __fopen(filename, mode);
+}
+
+AE_WATCHDOG_EXPORT size_t fread(void *ptr, size_t size, size_t nitems, FILE *stream) {
+    if ( !__fread ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionFread);
+    return __fread(ptr, size, nitems, stream);
+}
+
+AE_WATCHDOG_EXPORT size_t fwrite(const void *ptr, size_t size, size_t nitems, FILE *stream) {
+    if ( !__fwrite ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionFwrite);
+    return __fwrite(ptr, size, nitems, stream);
+}
+
+AE_WATCHDOG_EXPORT char * fgets(char *str, int size, FILE *stream) {
+    if ( !__fgets ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionFgets);
+    return __fgets(str, size, stream);
+}
+
+AE_WATCHDOG_EXPORT ssize_t read(int fildes, void *buf, size_t nbyte) {
+    if ( !__read ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionRead);
+    return __read(fildes, buf, nbyte);
+}
+
+AE_WATCHDOG_EXPORT ssize_t pread(int fildes, void *buf, size_t nbyte, off_t offset) {
+    if ( !__pread ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionPread);
+    return __pread(fildes, buf, nbyte, offset);
+}
+
+AE_WATCHDOG_EXPORT ssize_t write(int fildes, const void *buf, size_t nbyte) {
+    if ( !__write ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionWrite);
+    return __write(fildes, buf, nbyte);
+}
+
+AE_WATCHDOG_EXPORT ssize_t pwrite(int fildes, const void *buf, size_t nbyte, off_t offset) {
+    if ( !__pwrite ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionPwrite);
+    return __pwrite(fildes, buf, nbyte, offset);
+}
+
+AE_WATCHDOG_EXPORT ssize_t send(int socket, const void *buffer, size_t length, int flags) {
+    if ( !__send ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionSend);
+    return __send(socket, buffer, length, flags);
+}
+
+AE_WATCHDOG_EXPORT ssize_t sendto(int socket, const void *buffer, size_t length, int flags,
+                                  const struct sockaddr *dest_addr, socklen_t dest_len) {
+    if ( !__sendto ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionSendto);
+    return __sendto(socket, buffer, length, flags, dest_addr, dest_len);
+}
+
+AE_WATCHDOG_EXPORT ssize_t recv(int socket, void *buffer, size_t length, int flags) {
+    if ( !__recv ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionRecv);
+    return __recv(socket, buffer, length, flags);
+}
+
+AE_WATCHDOG_EXPORT ssize_t recvfrom(int socket, void *buffer, size_t length, int flags,
+                                    struct sockaddr *address, socklen_t *address_len) {
+    if ( !__recvfrom ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionRecvfrom);
+    return __recvfrom(socket, buffer, length, flags, address, address_len);
+}
+
+AE_WATCHDOG_EXPORT int usleep(useconds_t usec) {
+    if ( !__usleep ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionUsleep);
+    return __usleep(usec);
+}
+
+AE_WATCHDOG_EXPORT int nanosleep(const struct timespec *req, struct timespec *rem) {
+    if ( !__nanosleep ) AERealtimeWatchdogResolve();
+    AERealtimeWatchdogCheck(kFunctionNanosleep);
+    return __nanosleep(req, rem);
+}
+
+#endif
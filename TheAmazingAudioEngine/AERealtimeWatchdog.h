@@ -31,3 +31,18 @@
 // #define REALTIME_WATCHDOG_ENABLED 1
 
 #endif
+
+#ifdef __linux__
+
+/*
+ * Realtime thread registration, for the LD_PRELOAD build of the watchdog (AERealtimeWatchdog-linux.c)
+ *
+ *  These are declared weak, so they resolve to NULL when the watchdog library isn't loaded:
+ *
+ *      if ( AERealtimeWatchdogRegisterCurrentThread ) AERealtimeWatchdogRegisterCurrentThread("render");
+ */
+void AERealtimeWatchdogRegisterCurrentThread(const char *name) __attribute__((weak));
+void AERealtimeWatchdogUnregisterCurrentThread(void) __attribute__((weak));
+unsigned long AERealtimeWatchdogGetInfractionCount(void) __attribute__((weak));
+
+#endif
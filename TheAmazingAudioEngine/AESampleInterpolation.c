@@ -0,0 +1,156 @@
+//
+//  AESampleInterpolation.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AESampleInterpolation.h"
+#include <math.h>
+#include <pthread.h>
+
+#define kSincTaps       (2 * AESampleInterpolationReach) // Taps per output sample
+#define kSincPhaseBits  9
+#define kSincPhases     (1 << kSincPhaseBits)    // Table rows per frame
+
+static const float kFractionScale = 1.0f / 4294967296.0f;
+
+// One row of kSincTaps coefficients per phase, plus one for interpolating past the last phase.
+// Rows are contiguous and aligned, so the inner loop vectorizes.
+static float __sincTable[(kSincPhases + 1) * kSincTaps] __attribute__((aligned(16)));
+static pthread_once_t __sincTableOnce = PTHREAD_ONCE_INIT;
+
+static void buildSincTable(void) {
+    const int halfTaps = kSincTaps / 2;
+    for ( int phase=0; phase<=kSincPhases; phase++ ) {
+        double fraction = (double)phase / kSincPhases;
+        float *row = __sincTable + phase * kSincTaps;
+        double sum = 0.0;
+        for ( int tap=0; tap<kSincTaps; tap++ ) {
+            // Tap n reads the frame at (index - halfTaps + 1 + n)
+            double x = (tap - (halfTaps - 1)) - fraction;
+            double sinc = fabs(x) < 1.0e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double window = fabs(x) >= halfTaps ? 0.0
+                : 0.42 + 0.5 * cos(M_PI * x / halfTaps) + 0.08 * cos(2.0 * M_PI * x / halfTaps);
+            row[tap] = (float)(sinc * window);
+            sum += row[tap];
+        }
+        // Normalize for unity gain at DC
+        for ( int tap=0; tap<kSincTaps; tap++ ) {
+            row[tap] = (float)(row[tap] / sum);
+        }
+    }
+}
+
+void AESampleInterpolationPrepare(void) {
+    pthread_once(&__sincTableOnce, buildSincTable);
+}
+
+static inline float fetch(const float *source, uint32_t stride, int64_t index, uint32_t length, bool wrap) {
+    if ( index >= 0 && index < length ) return source[index * stride];
+    if ( !wrap || length == 0 ) return 0.0f;
+    index %= (int64_t)length;
+    if ( index < 0 ) index += length;
+    return source[index * stride];
+}
+
+AESamplePosition AESampleInterpolationRender(AESampleInterpolation interpolation,
+                                             const float *source, uint32_t sourceStride, uint32_t sourceLength, bool wrap,
+                                             AESamplePosition position, AESamplePosition increment,
+                                             float *target, uint32_t targetStride, uint32_t frames) {
+
+    // Each interpolator has a fast path for frames whose neighbours all lie within the source,
+    // and a slower one near the ends which reads each neighbour through fetch()
+    switch ( interpolation ) {
+        case AESampleInterpolationLinear: {
+            for ( uint32_t frame=0; frame<frames; frame++, position += increment ) {
+                uint32_t index = (uint32_t)(position >> 32);
+                float fraction = (float)(uint32_t)position * kFractionScale;
+                float x0, x1;
+                if ( index + 1 < sourceLength ) {
+                    const float *s = source + (size_t)index * sourceStride;
+                    x0 = s[0];
+                    x1 = s[sourceStride];
+                } else {
+                    x0 = fetch(source, sourceStride, index, sourceLength, wrap);
+                    x1 = fetch(source, sourceStride, (int64_t)index + 1, sourceLength, wrap);
+                }
+                target[(size_t)frame * targetStride] = x0 + fraction * (x1 - x0);
+            }
+            break;
+        }
+        case AESampleInterpolationCubicHermite: {
+            for ( uint32_t frame=0; frame<frames; frame++, position += increment ) {
+                uint32_t index = (uint32_t)(position >> 32);
+                float fraction = (float)(uint32_t)position * kFractionScale;
+                float xm1, x0, x1, x2;
+                if ( index >= 1 && index + 2 < sourceLength ) {
+                    const float *s = source + (size_t)(index - 1) * sourceStride;
+                    xm1 = s[0];
+                    x0  = s[sourceStride];
+                    x1  = s[2 * sourceStride];
+                    x2  = s[3 * sourceStride];
+                } else {
+                    xm1 = fetch(source, sourceStride, (int64_t)index - 1, sourceLength, wrap);
+                    x0  = fetch(source, sourceStride, index, sourceLength, wrap);
+                    x1  = fetch(source, sourceStride, (int64_t)index + 1, sourceLength, wrap);
+                    x2  = fetch(source, sourceStride, (int64_t)index + 2, sourceLength, wrap);
+                }
+                float c1 = 0.5f * (x1 - xm1);
+                float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+                float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+                target[(size_t)frame * targetStride] = ((c3 * fraction + c2) * fraction + c1) * fraction + x0;
+            }
+            break;
+        }
+        case AESampleInterpolationWindowedSinc: {
+            const int64_t before = kSincTaps/2 - 1;
+            const int64_t after = kSincTaps/2;
+            for ( uint32_t frame=0; frame<frames; frame++, position += increment ) {
+                uint32_t index = (uint32_t)(position >> 32);
+                uint32_t fraction = (uint32_t)position;
+
+                // Interpolate between the two nearest table phases
+                uint32_t phase = fraction >> (32 - kSincPhaseBits);
+                float phaseFraction = (float)(fraction & ((1u << (32 - kSincPhaseBits)) - 1)) * (1.0f / (1u << (32 - kSincPhaseBits)));
+                const float * restrict row0 = __sincTable + phase * kSincTaps;
+                const float * restrict row1 = row0 + kSincTaps;
+
+                float taps[kSincTaps];
+                if ( index >= before && (int64_t)index + after < sourceLength ) {
+                    const float *s = source + (size_t)(index - before) * sourceStride;
+                    for ( int tap=0; tap<kSincTaps; tap++ ) taps[tap] = s[tap * sourceStride];
+                } else {
+                    for ( int tap=0; tap<kSincTaps; tap++ ) taps[tap] = fetch(source, sourceStride, (int64_t)index - before + tap, sourceLength, wrap);
+                }
+
+                float sum = 0.0f;
+                for ( int tap=0; tap<kSincTaps; tap++ ) {
+                    sum += taps[tap] * (row0[tap] + phaseFraction * (row1[tap] - row0[tap]));
+                }
+                target[(size_t)frame * targetStride] = sum;
+            }
+            break;
+        }
+    }
+
+    return position;
+}
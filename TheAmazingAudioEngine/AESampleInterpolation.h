@@ -0,0 +1,137 @@
+//
+//  AESampleInterpolation.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * @enum AESampleInterpolation
+ *  Interpolation used to read audio between sample frames
+ *
+ * @var AESampleInterpolationLinear
+ *  Straight line between neighbouring frames. Cheapest; dulls high frequencies slightly.
+ *
+ * @var AESampleInterpolationCubicHermite
+ *  4-point cubic Hermite spline. A good compromise for most sample playback.
+ *
+ * @var AESampleInterpolationWindowedSinc
+ *  16-point Blackman-windowed sinc, band-limited to the source's Nyquist frequency.
+ *  Highest quality, at several times the cost. When playing faster than the source
+ *  rate, content above the output's Nyquist frequency is not filtered out.
+ */
+typedef enum {
+    AESampleInterpolationLinear,
+    AESampleInterpolationCubicHermite,
+    AESampleInterpolationWindowedSinc
+} AESampleInterpolation;
+
+/*!
+ * The furthest any interpolator reads from a position, in frames
+ *
+ *  AESampleInterpolationWindowedSinc reads up to this many frames after a position, and
+ *  one fewer before it. Renderers that stream through a window of audio keep this much
+ *  history and lookahead around the playhead.
+ */
+#define AESampleInterpolationReach 8
+
+/*!
+ * A position within a sample, in frames, as 32.32 fixed point
+ *
+ *  The upper 32 bits hold the frame index, the lower 32 bits the fraction of a frame.
+ *  Fixed point keeps the playhead exact over long playback, where a floating-point
+ *  playhead would gradually lose sub-sample precision.
+ */
+typedef uint64_t AESamplePosition;
+
+/*!
+ * One frame, as an AESamplePosition
+ */
+#define AESamplePositionOneFrame ((AESamplePosition)1 << 32)
+
+/*!
+ * Convert from frames to an AESamplePosition
+ *
+ *  Also used to convert a playback rate into a per-frame position increment.
+ */
+static inline AESamplePosition AESamplePositionFromFrames(double frames) {
+    return frames <= 0.0 ? 0 : (AESamplePosition)(frames * 4294967296.0 + 0.5);
+}
+
+/*!
+ * Convert from an AESamplePosition to frames
+ */
+static inline double AESamplePositionToFrames(AESamplePosition position) {
+    return (double)position * (1.0 / 4294967296.0);
+}
+
+/*!
+ * Prepare the interpolation tables
+ *
+ *  Builds the windowed-sinc coefficient tables, once per process. This must be called
+ *  before rendering with AESampleInterpolationWindowedSinc, from outside the audio
+ *  thread; the players in this library do so when they're created.
+ */
+void AESampleInterpolationPrepare(void);
+
+/*!
+ * Render one channel of audio at a fractional position and rate
+ *
+ *  Reads from the source starting at the given position, advancing by the given
+ *  increment for each output frame, and interpolating between source frames.
+ *  Every output frame must lie within the source: limit frames so that the position
+ *  of the last frame rendered is less than the source length.
+ *
+ *  Interpolation reads a few frames either side of the position. Near the ends of
+ *  the source, those frames are read from the other end if wrap is set, so that loops
+ *  are seamless, and are silent otherwise.
+ *
+ *  This function is safe to use on the realtime audio thread.
+ *
+ * @param interpolation  The interpolation to use
+ * @param source         The channel's first source sample
+ * @param sourceStride   The distance between consecutive source frames, in samples: 1 for
+ *                       non-interleaved audio, or the channel count for interleaved audio
+ * @param sourceLength   The length of the source, in frames
+ * @param wrap           Whether to read from the other end of the source beyond its ends
+ * @param position       The source position of the first output frame
+ * @param increment      The distance to advance per output frame; the playback rate,
+ *                       converted with @link AESamplePositionFromFrames @endlink
+ * @param target         The channel's first output sample
+ * @param targetStride   The distance between consecutive output frames, in samples
+ * @param frames         The number of frames to render
+ * @return The source position following the last frame rendered
+ */
+AESamplePosition AESampleInterpolationRender(AESampleInterpolation interpolation,
+                                             const float *source, uint32_t sourceStride, uint32_t sourceLength, bool wrap,
+                                             AESamplePosition position, AESamplePosition increment,
+                                             float *target, uint32_t targetStride, uint32_t frames);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,351 @@
+//
+//  AEStreamingFileBuffer.c
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AEStreamingFileBuffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t kChunkFrames = 4096;   // Frames read from the source at a time
+
+typedef struct {
+    int64_t             position;           // Frame of the source at the start of the chunk
+    uint32_t            frames;
+    int32_t             generation;         // Generation the chunk was decoded for
+} chunk_t;
+
+struct AEStreamingFileBuffer {
+    AEStreamingFileSource source;
+    int64_t             length;
+    uint32_t            bufferCount;
+    uint32_t            bytesPerFrame;
+
+    // Ring of chunks. The head is advanced by the I/O thread; the tail by the render
+    // thread, or by the I/O thread while it holds the consumer lock
+    chunk_t            *chunks;
+    char               *chunkData;          // Per slot, per buffer, kChunkFrames frames
+    uint32_t            slotCount;          // A power of two
+    volatile uint32_t   head;
+    volatile uint32_t   tail;
+    uint32_t            readOffset;         // Frames already read from the chunk at the tail
+    volatile int32_t    consumerLock;
+
+    // Control, written by the control thread
+    volatile int64_t    regionStart;
+    volatile int64_t    regionEnd;
+    volatile bool       loop;
+    volatile int64_t    seekPosition;
+    volatile int32_t    generation;
+
+    // I/O thread state
+    int32_t             ioGeneration;
+    int64_t             decodePosition;
+    int64_t             sourcePosition;     // Read position of the source, or -1 if unknown
+    void              **pointers;
+    char               *loopHead;           // Per buffer, loopHeadCapacity frames
+    uint32_t            loopHeadCapacity;
+    uint32_t            loopHeadFrames;
+    int64_t             loopHeadStart;
+    volatile int32_t    endGeneration;      // Generation whose region has been decoded to the end
+
+    // Render thread state
+    volatile int64_t    playhead;
+    volatile uint64_t   underrunCount;
+    volatile uint64_t   underrunFrameCount;
+};
+
+static void service(AEStreamingFileBuffer *buffer);
+
+AEStreamingFileBuffer *AEStreamingFileBufferNew(AEStreamingFileSource source, int64_t length, uint32_t bufferCount,
+                                                uint32_t bytesPerFrame, uint32_t bufferFrames, uint32_t loopHeadFrames) {
+    if ( bufferCount == 0 || bytesPerFrame == 0 || length < 0 ) return NULL;
+
+    AEStreamingFileBuffer *buffer = (AEStreamingFileBuffer*)calloc(1, sizeof(AEStreamingFileBuffer));
+    if ( !buffer ) return NULL;
+    buffer->source = source;
+    buffer->length = length;
+    buffer->bufferCount = bufferCount;
+    buffer->bytesPerFrame = bytesPerFrame;
+
+    // Enough chunks for the buffer duration, plus the one being read
+    uint32_t required = bufferFrames / kChunkFrames + 2;
+    buffer->slotCount = 2;
+    while ( buffer->slotCount < required ) buffer->slotCount <<= 1;
+
+    buffer->loopHeadCapacity = loopHeadFrames > kChunkFrames ? loopHeadFrames : kChunkFrames;
+
+    buffer->chunks = (chunk_t*)calloc(buffer->slotCount, sizeof(chunk_t));
+    buffer->chunkData = (char*)malloc((size_t)buffer->slotCount * bufferCount * kChunkFrames * bytesPerFrame);
+    buffer->pointers = (void**)calloc(bufferCount, sizeof(void*));
+    buffer->loopHead = (char*)malloc((size_t)bufferCount * buffer->loopHeadCapacity * bytesPerFrame);
+    if ( !buffer->chunks || !buffer->chunkData || !buffer->pointers || !buffer->loopHead ) {
+        AEStreamingFileBufferFree(buffer);
+        return NULL;
+    }
+
+    buffer->regionEnd = length;
+    buffer->sourcePosition = -1;
+    buffer->loopHeadStart = -1;
+    buffer->generation = 1;
+
+    return buffer;
+}
+
+void AEStreamingFileBufferFree(AEStreamingFileBuffer *buffer) {
+    if ( !buffer ) return;
+    free(buffer->chunks);
+    free(buffer->chunkData);
+    free(buffer->pointers);
+    free(buffer->loopHead);
+    free(buffer);
+}
+
+void AEStreamingFileBufferSetRegion(AEStreamingFileBuffer *buffer, int64_t start, int64_t end, bool loop) {
+    if ( start < 0 ) start = 0;
+    if ( start > buffer->length ) start = buffer->length;
+    if ( end < start ) end = start;
+    if ( end > buffer->length ) end = buffer->length;
+    buffer->regionStart = start;
+    buffer->regionEnd = end;
+    buffer->loop = loop;
+
+    // Rebuffer from the current position, so the buffered audio reflects the new region
+    int64_t playhead = buffer->playhead;
+    AEStreamingFileBufferSeek(buffer, playhead < start || playhead >= end ? start : playhead);
+}
+
+void AEStreamingFileBufferSeek(AEStreamingFileBuffer *buffer, int64_t frame) {
+    buffer->seekPosition = frame;
+    buffer->playhead = frame;
+    __sync_add_and_fetch(&buffer->generation, 1);
+}
+
+void AEStreamingFileBufferService(AEStreamingFileBuffer *buffer) {
+    int32_t generation = buffer->generation;
+    __sync_synchronize();
+
+    if ( generation != buffer->ioGeneration ) {
+        // Seek requested
+        buffer->ioGeneration = generation;
+        buffer->decodePosition = buffer->seekPosition;
+
+        // Drop the stale audio now if the render thread isn't reading; otherwise it's dropped as it's reached
+        if ( __sync_bool_compare_and_swap(&buffer->consumerLock, 0, 1) ) {
+            buffer->readOffset = 0;
+            buffer->tail = buffer->head;
+            __sync_bool_compare_and_swap(&buffer->consumerLock, 1, 0);
+        }
+    }
+
+    if ( buffer->endGeneration == generation ) return;
+
+    service(buffer);
+}
+
+static bool seekSource(AEStreamingFileBuffer *buffer, int64_t position) {
+    if ( buffer->sourcePosition == position ) return true;
+    if ( buffer->source.seek(buffer->source.context, position) != 0 ) {
+        buffer->sourcePosition = -1;
+        return false;
+    }
+    buffer->sourcePosition = position;
+    return true;
+}
+
+static uint32_t readSource(AEStreamingFileBuffer *buffer, char *data, uint32_t stride, uint32_t frames) {
+    for ( uint32_t i=0; i<buffer->bufferCount; i++ ) {
+        buffer->pointers[i] = data + (size_t)i * stride;
+    }
+    uint32_t framesRead = 0;
+    if ( buffer->source.read(buffer->source.context, buffer->pointers, frames, &framesRead) != 0 ) {
+        buffer->sourcePosition = -1;
+        return 0;
+    }
+    buffer->sourcePosition += framesRead;
+    return framesRead;
+}
+
+static void decodeLoopHead(AEStreamingFileBuffer *buffer, int64_t regionStart, int64_t regionEnd) {
+    uint32_t frames = regionEnd - regionStart < buffer->loopHeadCapacity ? (uint32_t)(regionEnd - regionStart) : buffer->loopHeadCapacity;
+    uint32_t stride = buffer->loopHeadCapacity * buffer->bytesPerFrame;
+    uint32_t framesRead = 0;
+
+    if ( seekSource(buffer, regionStart) ) {
+        while ( framesRead < frames ) {
+            uint32_t count = frames - framesRead < kChunkFrames ? frames - framesRead : kChunkFrames;
+            uint32_t chunk = readSource(buffer, buffer->loopHead + framesRead * buffer->bytesPerFrame, stride, count);
+            if ( chunk == 0 ) break;
+            framesRead += chunk;
+        }
+    }
+
+    buffer->loopHeadFrames = framesRead;
+    buffer->loopHeadStart = regionStart;
+}
+
+static void service(AEStreamingFileBuffer *buffer) {
+    int32_t generation = buffer->ioGeneration;
+    int64_t regionStart = buffer->regionStart;
+    int64_t regionEnd = buffer->regionEnd;
+    bool loop = buffer->loop && regionEnd > regionStart;
+
+    if ( loop && buffer->loopHeadStart != regionStart ) {
+        decodeLoopHead(buffer, regionStart, regionEnd);
+    }
+
+    const uint32_t bytesPerFrame = buffer->bytesPerFrame;
+    const uint32_t chunkStride = kChunkFrames * bytesPerFrame;
+    while ( buffer->generation == generation ) {
+        if ( buffer->decodePosition >= regionEnd ) {
+            if ( loop ) {
+                buffer->decodePosition = regionStart;
+            } else {
+                // Mark the end of the stream, for the render thread
+                __sync_synchronize();
+                buffer->endGeneration = generation;
+                break;
+            }
+        }
+
+        if ( buffer->head - buffer->tail >= buffer->slotCount ) {
+            // Ring is full
+            break;
+        }
+
+        uint32_t slot = buffer->head & (buffer->slotCount - 1);
+        char *data = buffer->chunkData + (size_t)slot * buffer->bufferCount * chunkStride;
+
+        // Serve the beginning of the loop from memory, and everything else from the source
+        int64_t loopHeadEnd = regionStart + buffer->loopHeadFrames;
+        bool fromLoopHead = loop && buffer->loopHeadStart == regionStart
+                                 && buffer->decodePosition >= regionStart && buffer->decodePosition < loopHeadEnd;
+
+        int64_t available = (fromLoopHead ? loopHeadEnd : regionEnd) - buffer->decodePosition;
+        uint32_t frames = available < kChunkFrames ? (uint32_t)available : kChunkFrames;
+
+        if ( fromLoopHead ) {
+            size_t offset = (size_t)(buffer->decodePosition - regionStart) * bytesPerFrame;
+            for ( uint32_t i=0; i<buffer->bufferCount; i++ ) {
+                memcpy(data + (size_t)i * chunkStride,
+                       buffer->loopHead + (size_t)i * buffer->loopHeadCapacity * bytesPerFrame + offset,
+                       frames * bytesPerFrame);
+            }
+        } else {
+            if ( !seekSource(buffer, buffer->decodePosition) || (frames = readSource(buffer, data, chunkStride, frames)) == 0 ) {
+                // Nothing more can be read: finish here
+                __sync_synchronize();
+                buffer->endGeneration = generation;
+                break;
+            }
+        }
+
+        chunk_t *chunk = &buffer->chunks[slot];
+        chunk->position = buffer->decodePosition;
+        chunk->frames = frames;
+        chunk->generation = generation;
+
+        // Publish the chunk
+        __sync_synchronize();
+        buffer->head++;
+        buffer->decodePosition += frames;
+    }
+}
+
+uint32_t AEStreamingFileBufferRead(AEStreamingFileBuffer *buffer, void * const *buffers, uint32_t frames, bool *outFinished) {
+    if ( outFinished ) *outFinished = false;
+
+    if ( !__sync_bool_compare_and_swap(&buffer->consumerLock, 0, 1) ) {
+        // The I/O thread is dropping stale audio after a seek
+        __sync_add_and_fetch(&buffer->underrunCount, 1);
+        __sync_add_and_fetch(&buffer->underrunFrameCount, frames);
+        return 0;
+    }
+
+    int32_t generation = buffer->generation;
+    __sync_synchronize();
+
+    const uint32_t bytesPerFrame = buffer->bytesPerFrame;
+    const uint32_t chunkStride = kChunkFrames * bytesPerFrame;
+    uint32_t offset = 0;
+    while ( offset < frames ) {
+        uint32_t tail = buffer->tail;
+        if ( tail == buffer->head ) {
+            if ( buffer->endGeneration == generation ) {
+                // Reached the end of the region
+                if ( outFinished ) *outFinished = true;
+            } else {
+                // The I/O thread hasn't kept up
+                __sync_add_and_fetch(&buffer->underrunCount, 1);
+                __sync_add_and_fetch(&buffer->underrunFrameCount, frames - offset);
+            }
+            break;
+        }
+        __sync_synchronize();
+
+        uint32_t slot = tail & (buffer->slotCount - 1);
+        chunk_t *chunk = &buffer->chunks[slot];
+        if ( chunk->generation != generation ) {
+            // Audio from before a seek
+            buffer->readOffset = 0;
+            buffer->tail = tail + 1;
+            continue;
+        }
+
+        uint32_t count = chunk->frames - buffer->readOffset;
+        if ( count > frames - offset ) count = frames - offset;
+        const char *data = buffer->chunkData + (size_t)slot * buffer->bufferCount * chunkStride + (size_t)buffer->readOffset * bytesPerFrame;
+        for ( uint32_t i=0; i<buffer->bufferCount; i++ ) {
+            memcpy((char*)buffers[i] + (size_t)offset * bytesPerFrame, data + (size_t)i * chunkStride, count * bytesPerFrame);
+        }
+        offset += count;
+        buffer->readOffset += count;
+
+        if ( buffer->generation == generation ) {
+            buffer->playhead = chunk->position + buffer->readOffset;
+        }
+
+        if ( buffer->readOffset == chunk->frames ) {
+            // Done with this chunk: hand it back to the I/O thread
+            buffer->readOffset = 0;
+            __sync_synchronize();
+            buffer->tail = tail + 1;
+        }
+    }
+
+    __sync_bool_compare_and_swap(&buffer->consumerLock, 1, 0);
+
+    return offset;
+}
+
+int64_t AEStreamingFileBufferGetPlayhead(AEStreamingFileBuffer *buffer) {
+    return buffer->playhead;
+}
+
+uint64_t AEStreamingFileBufferGetUnderrunCount(AEStreamingFileBuffer *buffer) {
+    return buffer->underrunCount;
+}
+
+uint64_t AEStreamingFileBufferGetUnderrunFrameCount(AEStreamingFileBuffer *buffer) {
+    return buffer->underrunFrameCount;
+}
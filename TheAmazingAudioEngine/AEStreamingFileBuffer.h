@@ -0,0 +1,165 @@
+//
+//  AEStreamingFileBuffer.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * Source of audio for a streaming file buffer
+ *
+ *  Both functions are called on the I/O thread only, and return 0 on success or an error code.
+ */
+typedef struct {
+    /*!
+     * Move the read position
+     *
+     * @param context   The context
+     * @param frame     The frame to read from next
+     */
+    int (*seek)(void *context, int64_t frame);
+
+    /*!
+     * Read audio
+     *
+     * @param context   The context
+     * @param buffers   Destination buffers, one per buffer of the stream's format
+     * @param frames    Number of frames to read
+     * @param outFrames On output, the number of frames read; fewer than requested at the end of the file
+     */
+    int (*read)(void *context, void * const *buffers, uint32_t frames, uint32_t *outFrames);
+
+    void *context;
+} AEStreamingFileSource;
+
+/*!
+ * Streaming file buffer
+ *
+ *  The portable core of @link AEStreamingFilePlayer @endlink: a ring of decoded audio
+ *  refilled from a source on an I/O thread, and read on the render thread.
+ *
+ *  Audio is handled as opaque frames of bytes, in one or more buffers (one per channel
+ *  for non-interleaved audio). Seeks and region changes are lock-free: each bumps a
+ *  generation count, and audio decoded for an earlier generation is dropped as the
+ *  render thread reaches it. When looping, the start of the loop region is kept decoded
+ *  in memory, so the loop point never waits on the source.
+ *
+ *  Three threads are involved: a control thread (such as the main thread), which sets
+ *  the region and seeks; the I/O thread, which calls @link AEStreamingFileBufferService @endlink;
+ *  and the render thread, which calls @link AEStreamingFileBufferRead @endlink.
+ */
+typedef struct AEStreamingFileBuffer AEStreamingFileBuffer;
+
+/*!
+ * Create a streaming file buffer
+ *
+ *  Nothing is read until the first call to @link AEStreamingFileBufferService @endlink.
+ *
+ * @param source            The source of audio
+ * @param length            Length of the source, in frames
+ * @param bufferCount       Number of buffers of audio per frame (the channel count, for non-interleaved audio)
+ * @param bytesPerFrame     Bytes per frame, in each buffer
+ * @param bufferFrames      Frames of audio to keep buffered ahead of the playhead
+ * @param loopHeadFrames    Frames of the loop region's start to keep decoded while looping
+ * @return The buffer, or NULL on allocation failure
+ */
+AEStreamingFileBuffer *AEStreamingFileBufferNew(AEStreamingFileSource source, int64_t length, uint32_t bufferCount,
+                                                uint32_t bytesPerFrame, uint32_t bufferFrames, uint32_t loopHeadFrames);
+
+/*!
+ * Free a streaming file buffer
+ *
+ *  Make sure neither the I/O thread nor the render thread is using it.
+ */
+void AEStreamingFileBufferFree(AEStreamingFileBuffer *buffer);
+
+/*!
+ * Set the playback region
+ *
+ *  Use on the control thread. Buffering restarts from the playhead, or from the start
+ *  of the region if the playhead lies outside it.
+ *
+ * @param buffer    The buffer
+ * @param start     First frame of the region
+ * @param end       Frame after the last frame of the region
+ * @param loop      Whether to loop the region
+ */
+void AEStreamingFileBufferSetRegion(AEStreamingFileBuffer *buffer, int64_t start, int64_t end, bool loop);
+
+/*!
+ * Seek
+ *
+ *  Use on the control thread.
+ *
+ * @param buffer    The buffer
+ * @param frame     The frame to play from
+ */
+void AEStreamingFileBufferSeek(AEStreamingFileBuffer *buffer, int64_t frame);
+
+/*!
+ * Refill the buffer
+ *
+ *  Use on the I/O thread. Reads from the source until the buffer is full, or the end
+ *  of the region is reached.
+ *
+ * @param buffer    The buffer
+ */
+void AEStreamingFileBufferService(AEStreamingFileBuffer *buffer);
+
+/*!
+ * Read audio
+ *
+ *  Use on the render thread. If too little audio is buffered, the shortfall counts as an
+ *  underrun, and the remainder of the output is left untouched.
+ *
+ * @param buffer        The buffer
+ * @param buffers       Destination buffers, one per buffer of the stream's format
+ * @param frames        Number of frames to read
+ * @param outFinished   On output, whether the end of a non-looping region has been reached
+ * @return The number of frames read
+ */
+uint32_t AEStreamingFileBufferRead(AEStreamingFileBuffer *buffer, void * const *buffers, uint32_t frames, bool *outFinished);
+
+/*!
+ * Get the playhead, in frames
+ */
+int64_t AEStreamingFileBufferGetPlayhead(AEStreamingFileBuffer *buffer);
+
+/*!
+ * Get the number of render cycles which ran out of buffered audio
+ */
+uint64_t AEStreamingFileBufferGetUnderrunCount(AEStreamingFileBuffer *buffer);
+
+/*!
+ * Get the number of frames of silence emitted due to underruns
+ */
+uint64_t AEStreamingFileBufferGetUnderrunFrameCount(AEStreamingFileBuffer *buffer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,123 @@
+//
+//  AEStreamingFilePlayer.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#import <Foundation/Foundation.h>
+#import "AEAudioController.h"
+
+/*!
+ * Streaming file player
+ *
+ *  This class plays audio files straight from disk, keeping only a small ring of decoded
+ *  audio in memory. The ring is refilled by a background I/O thread shared by all streaming
+ *  players, so you can play many long files with a fixed memory budget. It will play any
+ *  audio file format supported by ExtAudioFile.
+ *
+ *  When looping, the beginning of the loop region is kept decoded in memory, so that the
+ *  loop point never waits on a disk seek.
+ *
+ *  If the I/O thread falls behind, the player emits silence and counts the shortfall in
+ *  @link underrunCount @endlink and @link underrunFrameCount @endlink.
+ *
+ *  Buffering begins on the I/O thread as soon as the player is created, so creating one
+ *  doesn't block on disk. The buffering itself is done by the portable
+ *  @link AEStreamingFileBuffer @endlink, which can be used with other sources of audio.
+ *
+ *  To use, create an instance, then add it to the audio controller.
+ */
+@interface AEStreamingFilePlayer : NSObject <AEAudioPlayable>
+
+/*!
+ * Create a new player instance
+ *
+ * @param url               URL to the file to play
+ * @param audioDescription  The audio format to play in (usually the same as AEAudioController's)
+ * @param error             If not NULL, the error on output
+ * @return The player, ready to be @link AEAudioController::addChannels: added @endlink to the audio controller.
+ */
++ (instancetype)streamingFilePlayerWithURL:(NSURL*)url
+                          audioDescription:(AudioStreamBasicDescription)audioDescription
+                                     error:(NSError**)error;
+
+/*!
+ * Initialise
+ *
+ * @param url               URL to the file to play
+ * @param audioDescription  The audio format to play in (usually the same as AEAudioController's)
+ * @param bufferDuration    Duration of decoded audio to keep buffered ahead of the playhead, in seconds
+ * @param error             If not NULL, the error on output
+ */
+- (instancetype)initWithURL:(NSURL*)url
+           audioDescription:(AudioStreamBasicDescription)audioDescription
+             bufferDuration:(NSTimeInterval)bufferDuration
+                      error:(NSError**)error;
+
+/*!
+ * Schedule playback for a particular time
+ *
+ *  This causes the player to emit silence up until the given timestamp
+ *  is reached. Use this method to synchronize playback with other audio
+ *  generators.
+ *
+ *  Note: When you call this method, the property channelIsPlaying will be
+ *  set to YES, to enable playback when the start time is reached.
+ *
+ * @param time The time, in host ticks, at which to begin playback
+ */
+- (void)playAtTime:(uint64_t)time;
+
+/*!
+ * Get playhead position, in frames
+ *
+ *  For use on the realtime thread.
+ *
+ * @param player The player
+ */
+SInt64 AEStreamingFilePlayerGetPlayhead(__unsafe_unretained AEStreamingFilePlayer * player);
+
+@property (nonatomic, strong, readonly) NSURL *url;            //!< Original media URL
+@property (nonatomic, readonly) NSTimeInterval duration;       //!< Length of audio file, in seconds
+@property (nonatomic, readonly) NSTimeInterval bufferDuration; //!< Duration of audio buffered ahead of the playhead, in seconds
+@property (nonatomic, assign) NSTimeInterval regionStartTime;  //!< Time offset within file to begin playback, and loop from
+@property (nonatomic, assign) NSTimeInterval regionDuration;   //!< Duration of playback within the file
+@property (nonatomic, assign) NSTimeInterval currentTime;      //!< Current playback position relative to the beginning of the file, in seconds
+@property (nonatomic, readonly) AudioStreamBasicDescription audioDescription; //!< The client audio format
+@property (nonatomic, readwrite) BOOL loop;                    //!< Whether to loop the playback region
+@property (nonatomic, readwrite) float volume;                 //!< Track volume
+@property (nonatomic, readwrite) float pan;                    //!< Track pan
+@property (nonatomic, readwrite) BOOL channelIsPlaying;        //!< Whether the track is playing
+@property (nonatomic, readwrite) BOOL channelIsMuted;          //!< Whether the track is muted
+@property (nonatomic, readwrite) BOOL removeUponFinish;        //!< Whether the track automatically removes itself from the audio controller after playback completes
+@property (nonatomic, copy) void(^completionBlock)(void);      //!< A block to be called when playback finishes
+@property (nonatomic, readonly) NSUInteger underrunCount;      //!< Number of render cycles which ran out of buffered audio
+@property (nonatomic, readonly) UInt64 underrunFrameCount;     //!< Number of frames of silence emitted due to underruns
+@end
+
+#ifdef __cplusplus
+}
+#endif
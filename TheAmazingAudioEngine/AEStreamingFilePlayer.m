@@ -0,0 +1,359 @@
+//
+//  AEStreamingFilePlayer.m
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#import "AEStreamingFilePlayer.h"
+#import "AEStreamingFileBuffer.h"
+#import "AEUtilities.h"
+#import "AETraceRecorder.h"
+#import <pthread.h>
+
+static const NSTimeInterval kDefaultBufferDuration = 1.0;
+static const NSTimeInterval kIOPollInterval        = 0.01;
+
+@interface AEStreamingFilePlayerIOThread : NSThread
++ (AEStreamingFilePlayerIOThread*)sharedThread;
+- (void)addPlayer:(AEStreamingFilePlayer*)player;
+- (void)removePlayer:(AEStreamingFilePlayer*)player;
+- (void)wake;
+@end
+
+@interface AEStreamingFilePlayer () {
+    // Accessed only by the I/O thread, after initialisation
+    ExtAudioFileRef     _audioFile;
+    double              _fileToClientSampleRateRatio;
+
+    // Shared between threads
+    AEStreamingFileBuffer *_stream;
+    SInt64              _lengthInFrames;
+    SInt64              _regionStartFrame;
+    SInt64              _regionEndFrame;
+    uint64_t            _startTime;
+}
+@property (nonatomic, strong, readwrite) NSURL *url;
+@end
+
+static int sourceSeek(void *context, int64_t frame);
+static int sourceRead(void *context, void * const *buffers, uint32_t frames, uint32_t *outFrames);
+
+@implementation AEStreamingFilePlayer
+@dynamic duration, currentTime, regionStartTime, regionDuration, underrunCount, underrunFrameCount;
+
++ (instancetype)streamingFilePlayerWithURL:(NSURL *)url audioDescription:(AudioStreamBasicDescription)audioDescription error:(NSError **)error {
+    return [[self alloc] initWithURL:url audioDescription:audioDescription bufferDuration:kDefaultBufferDuration error:error];
+}
+
+- (instancetype)initWithURL:(NSURL *)url audioDescription:(AudioStreamBasicDescription)audioDescription bufferDuration:(NSTimeInterval)bufferDuration error:(NSError **)error {
+    if ( !(self = [super init]) ) return nil;
+
+    OSStatus status = ExtAudioFileOpenURL((__bridge CFURLRef)url, &_audioFile);
+    if ( !AECheckOSStatus(status, "ExtAudioFileOpenURL") ) {
+        if ( error ) *error = [NSError errorWithDomain:NSOSStatusErrorDomain code:status
+                                              userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"Couldn't open the audio file", @"")}];
+        return nil;
+    }
+
+    AudioStreamBasicDescription fileAudioDescription;
+    UInt32 size = sizeof(fileAudioDescription);
+    status = ExtAudioFileGetProperty(_audioFile, kExtAudioFileProperty_FileDataFormat, &size, &fileAudioDescription);
+    if ( !AECheckOSStatus(status, "ExtAudioFileGetProperty(kExtAudioFileProperty_FileDataFormat)") ) {
+        ExtAudioFileDispose(_audioFile);
+        _audioFile = NULL;
+        if ( error ) *error = [NSError errorWithDomain:NSOSStatusErrorDomain code:status
+                                              userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"Couldn't read the audio file", @"")}];
+        return nil;
+    }
+
+    status = ExtAudioFileSetProperty(_audioFile, kExtAudioFileProperty_ClientDataFormat, sizeof(audioDescription), &audioDescription);
+    if ( !AECheckOSStatus(status, "ExtAudioFileSetProperty(kExtAudioFileProperty_ClientDataFormat)") ) {
+        ExtAudioFileDispose(_audioFile);
+        _audioFile = NULL;
+        int fourCC = CFSwapInt32HostToBig(status);
+        if ( error ) *error = [NSError errorWithDomain:NSOSStatusErrorDomain code:status
+                                              userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:NSLocalizedString(@"Couldn't convert the audio file (error %d/%4.4s)", @""), status, (char*)&fourCC]}];
+        return nil;
+    }
+
+    SInt64 fileLengthInFrames;
+    size = sizeof(fileLengthInFrames);
+    status = ExtAudioFileGetProperty(_audioFile, kExtAudioFileProperty_FileLengthFrames, &size, &fileLengthInFrames);
+    if ( !AECheckOSStatus(status, "ExtAudioFileGetProperty(kExtAudioFileProperty_FileLengthFrames)") ) {
+        ExtAudioFileDispose(_audioFile);
+        _audioFile = NULL;
+        if ( error ) *error = [NSError errorWithDomain:NSOSStatusErrorDomain code:status
+                                              userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"Couldn't read the audio file", @"")}];
+        return nil;
+    }
+
+    _url = url;
+    _audioDescription = audioDescription;
+    _bufferDuration = bufferDuration;
+    _fileToClientSampleRateRatio = audioDescription.mSampleRate / fileAudioDescription.mSampleRate;
+    _lengthInFrames = (SInt64)ceil(fileLengthInFrames * _fileToClientSampleRateRatio);
+    _regionStartFrame = 0;
+    _regionEndFrame = _lengthInFrames;
+    _volume = 1.0;
+    _channelIsPlaying = YES;
+
+    // Buffer the given duration, and keep up to half as much of the loop head decoded
+    UInt32 bufferFrames = (UInt32)ceil(bufferDuration * audioDescription.mSampleRate);
+    int bufferCount = (audioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? audioDescription.mChannelsPerFrame : 1;
+    AEStreamingFileSource source = { .seek = sourceSeek, .read = sourceRead, .context = (__bridge void*)self };
+    _stream = AEStreamingFileBufferNew(source, _lengthInFrames, bufferCount, audioDescription.mBytesPerFrame, bufferFrames, bufferFrames / 2);
+    if ( !_stream ) {
+        if ( error ) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM
+                                              userInfo:@{NSLocalizedDescriptionKey: NSLocalizedString(@"Couldn't allocate the stream buffer", @"")}];
+        return nil;
+    }
+
+    // The I/O thread fills the buffer from the beginning straight away
+    [[AEStreamingFilePlayerIOThread sharedThread] addPlayer:self];
+
+    return self;
+}
+
+- (void)dealloc {
+    [[AEStreamingFilePlayerIOThread sharedThread] removePlayer:self];
+    if ( _stream ) AEStreamingFileBufferFree(_stream);
+    if ( _audioFile ) ExtAudioFileDispose(_audioFile);
+}
+
+- (void)playAtTime:(uint64_t)time {
+    _startTime = time;
+    if ( !self.channelIsPlaying ) {
+        self.channelIsPlaying = YES;
+    }
+}
+
+-(NSTimeInterval)duration {
+    return (double)_lengthInFrames / _audioDescription.mSampleRate;
+}
+
+-(NSTimeInterval)currentTime {
+    return (double)AEStreamingFileBufferGetPlayhead(_stream) / _audioDescription.mSampleRate;
+}
+
+-(void)setCurrentTime:(NSTimeInterval)currentTime {
+    if ( _lengthInFrames == 0 ) return;
+    SInt64 frame = (SInt64)(currentTime * _audioDescription.mSampleRate);
+    [self seekToFrame:MAX(_regionStartFrame, MIN(_regionEndFrame, frame))];
+}
+
+-(NSTimeInterval)regionStartTime {
+    return (double)_regionStartFrame / _audioDescription.mSampleRate;
+}
+
+-(void)setRegionStartTime:(NSTimeInterval)regionStartTime {
+    SInt64 duration = _regionEndFrame - _regionStartFrame;
+    _regionStartFrame = MAX(0, MIN(_lengthInFrames, (SInt64)(regionStartTime * _audioDescription.mSampleRate)));
+    _regionEndFrame = MIN(_lengthInFrames, _regionStartFrame + duration);
+    [self regionDidChange];
+}
+
+-(NSTimeInterval)regionDuration {
+    return (double)(_regionEndFrame - _regionStartFrame) / _audioDescription.mSampleRate;
+}
+
+-(void)setRegionDuration:(NSTimeInterval)regionDuration {
+    _regionEndFrame = MAX(_regionStartFrame, MIN(_lengthInFrames, _regionStartFrame + (SInt64)(regionDuration * _audioDescription.mSampleRate)));
+    [self regionDidChange];
+}
+
+-(void)setLoop:(BOOL)loop {
+    _loop = loop;
+    [self regionDidChange];
+}
+
+-(NSUInteger)underrunCount {
+    return (NSUInteger)AEStreamingFileBufferGetUnderrunCount(_stream);
+}
+
+-(UInt64)underrunFrameCount {
+    return AEStreamingFileBufferGetUnderrunFrameCount(_stream);
+}
+
+SInt64 AEStreamingFilePlayerGetPlayhead(__unsafe_unretained AEStreamingFilePlayer * THIS) {
+    return AEStreamingFileBufferGetPlayhead(THIS->_stream);
+}
+
+- (void)regionDidChange {
+    AEStreamingFileBufferSetRegion(_stream, _regionStartFrame, _regionEndFrame, _loop);
+    [[AEStreamingFilePlayerIOThread sharedThread] wake];
+}
+
+- (void)seekToFrame:(SInt64)frame {
+    AEStreamingFileBufferSeek(_stream, frame);
+    [[AEStreamingFilePlayerIOThread sharedThread] wake];
+}
+
+#pragma mark - I/O thread
+
+static int sourceSeek(void *context, int64_t frame) {
+    __unsafe_unretained AEStreamingFilePlayer *THIS = (__bridge AEStreamingFilePlayer*)context;
+    OSStatus status = ExtAudioFileSeek(THIS->_audioFile, (SInt64)round(frame / THIS->_fileToClientSampleRateRatio));
+    return AECheckOSStatus(status, "ExtAudioFileSeek") ? 0 : (int)status;
+}
+
+static int sourceRead(void *context, void * const *buffers, uint32_t frames, uint32_t *outFrames) {
+    __unsafe_unretained AEStreamingFilePlayer *THIS = (__bridge AEStreamingFilePlayer*)context;
+    AEAudioBufferListCreateOnStack(bufferList, THIS->_audioDescription);
+    int channelsPerBuffer = (THIS->_audioDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? 1 : THIS->_audioDescription.mChannelsPerFrame;
+    for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
+        bufferList->mBuffers[i].mData = buffers[i];
+        bufferList->mBuffers[i].mNumberChannels = channelsPerBuffer;
+        bufferList->mBuffers[i].mDataByteSize = frames * THIS->_audioDescription.mBytesPerFrame;
+    }
+
+    AETraceBegin("ExtAudioFileRead");
+    OSStatus status = ExtAudioFileRead(THIS->_audioFile, &frames, bufferList);
+    AETraceEnd("ExtAudioFileRead");
+    if ( !AECheckOSStatus(status, "ExtAudioFileRead") ) {
+        return (int)status;
+    }
+
+    *outFrames = frames;
+    return 0;
+}
+
+static void serviceStream(__unsafe_unretained AEStreamingFilePlayer *THIS) {
+    AETraceBegin("AEStreamingFilePlayer refill");
+    AEStreamingFileBufferService(THIS->_stream);
+    AETraceEnd("AEStreamingFilePlayer refill");
+}
+
+#pragma mark - Rendering
+
+struct notifyPlaybackStopped_arg { __unsafe_unretained AEStreamingFilePlayer * THIS; __unsafe_unretained AEAudioController * audioController; };
+static void notifyPlaybackStopped(void *userInfo, int length) {
+    struct notifyPlaybackStopped_arg * arg = (struct notifyPlaybackStopped_arg*)userInfo;
+    AEStreamingFilePlayer *THIS = arg->THIS;
+    THIS.channelIsPlaying = NO;
+
+    if ( THIS->_removeUponFinish ) {
+        [arg->audioController removeChannels:@[THIS] completionBlock:nil];
+    }
+
+    if ( THIS.completionBlock ) THIS.completionBlock();
+
+    // Rewind, ready to play again
+    [THIS seekToFrame:THIS->_regionStartFrame];
+}
+
+static OSStatus renderCallback(__unsafe_unretained AEStreamingFilePlayer *THIS, __unsafe_unretained AEAudioController *audioController, const AudioTimeStamp *time, UInt32 frames, AudioBufferList *audio) {
+    if ( !THIS->_channelIsPlaying ) return noErr;
+
+    uint64_t hostTimeAtBufferEnd = time->mHostTime + AEHostTicksFromSeconds((double)frames / THIS->_audioDescription.mSampleRate);
+    if ( THIS->_startTime && THIS->_startTime > hostTimeAtBufferEnd ) {
+        // Start time not yet reached: emit silence
+        return noErr;
+    }
+
+    uint32_t silentFrames = THIS->_startTime && THIS->_startTime > time->mHostTime
+        ? AESecondsFromHostTicks(THIS->_startTime - time->mHostTime) * THIS->_audioDescription.mSampleRate : 0;
+    THIS->_startTime = 0;
+
+    // Read into the buffers past any silence before the start time
+    int bytesPerFrame = THIS->_audioDescription.mBytesPerFrame;
+    void *buffers[audio->mNumberBuffers];
+    for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+        buffers[i] = (char*)audio->mBuffers[i].mData + silentFrames * bytesPerFrame;
+    }
+
+    bool finished;
+    AEStreamingFileBufferRead(THIS->_stream, buffers, frames - silentFrames, &finished);
+    if ( finished ) {
+        // Reached the end of the region
+        THIS->_channelIsPlaying = NO;
+        AEAudioControllerSendAsynchronousMessageToMainThread(audioController, notifyPlaybackStopped, &(struct notifyPlaybackStopped_arg) { .THIS = THIS, .audioController = audioController }, sizeof(struct notifyPlaybackStopped_arg));
+    }
+
+    return noErr;
+}
+
+-(AEAudioRenderCallback)renderCallback {
+    return renderCallback;
+}
+
+@end
+
+@implementation AEStreamingFilePlayerIOThread {
+    NSHashTable *_players;
+    dispatch_semaphore_t _wakeSemaphore;
+}
+
++ (AEStreamingFilePlayerIOThread*)sharedThread {
+    static AEStreamingFilePlayerIOThread *__sharedThread = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        __sharedThread = [[AEStreamingFilePlayerIOThread alloc] init];
+        [__sharedThread start];
+    });
+    return __sharedThread;
+}
+
+- (instancetype)init {
+    if ( !(self = [super init]) ) return nil;
+    _players = [NSHashTable weakObjectsHashTable];
+    _wakeSemaphore = dispatch_semaphore_create(0);
+    self.threadPriority = 0.9;
+    return self;
+}
+
+- (void)addPlayer:(AEStreamingFilePlayer *)player {
+    @synchronized ( _players ) {
+        [_players addObject:player];
+    }
+    [self wake];
+}
+
+- (void)removePlayer:(AEStreamingFilePlayer *)player {
+    @synchronized ( _players ) {
+        [_players removeObject:player];
+    }
+}
+
+- (void)wake {
+    dispatch_semaphore_signal(_wakeSemaphore);
+}
+
+- (void)main {
+    @autoreleasepool {
+        pthread_setname_np("com.theamazingaudioengine.AEStreamingFilePlayerIOThread");
+        while ( !self.isCancelled ) {
+            @autoreleasepool {
+                NSArray *players;
+                @synchronized ( _players ) {
+                    players = _players.allObjects;
+                }
+                for ( AEStreamingFilePlayer *player in players ) {
+                    serviceStream(player);
+                }
+                players = nil;
+                dispatch_semaphore_wait(_wakeSemaphore, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kIOPollInterval * NSEC_PER_SEC)));
+            }
+        }
+    }
+}
+
+@end
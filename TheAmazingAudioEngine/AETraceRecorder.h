@@ -0,0 +1,143 @@
+//
+//  AETraceRecorder.h
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * Maximum number of threads that can record trace events at once
+ */
+#define AETraceRecorderMaximumThreads 16
+
+/*!
+ * Number of events each thread can have pending export
+ *
+ *  Events recorded while a thread's buffer is full are dropped, and counted in
+ *  @link AETraceRecorder::droppedEventCount droppedEventCount @endlink.
+ */
+#define AETraceRecorderEventsPerThread 8192
+
+/*!
+ * Mark the beginning of a traced interval on the current thread
+ *
+ *  This C function is safe to use on the Core Audio realtime thread: it does not
+ *  allocate memory, lock, or make Objective-C calls. It does nothing unless a trace
+ *  recorder is recording.
+ *
+ *  Intervals must be properly nested within each thread.
+ *
+ * @param name The interval name. This must be a string literal or otherwise remain valid
+ *             for the lifetime of the app, as only the pointer is recorded.
+ */
+void AETraceBegin(const char *name);
+
+/*!
+ * Mark the end of a traced interval on the current thread
+ *
+ * @param name The interval name, as passed to @link AETraceBegin @endlink
+ */
+void AETraceEnd(const char *name);
+
+/*!
+ * Record an instantaneous event on the current thread
+ *
+ * @param name The event name; must remain valid for the lifetime of the app
+ */
+void AETraceInstant(const char *name);
+
+/*!
+ * Set the name under which the current thread appears in traces
+ *
+ *  Threads are otherwise named with their pthread name, if they have one. The name is copied.
+ *
+ * @param name The thread name
+ */
+void AETraceSetCurrentThreadName(const char *name);
+
+/*!
+ * Trace recorder
+ *
+ *  This class records timelines of render cycles, message processing and other engine
+ *  activity, for viewing in a standard trace viewer such as chrome://tracing or the
+ *  Perfetto UI (ui.perfetto.dev).
+ *
+ *  Events are written by each thread into its own preallocated lock-free ring of
+ *  fixed-size binary records. A background thread drains the rings and writes them
+ *  to a file in the Chrome trace event JSON format.
+ *
+ *  The audio controller, message queue and file loading operations are already
+ *  instrumented; add your own intervals with @link AETraceBegin @endlink and
+ *  @link AETraceEnd @endlink.
+ *
+ *  Only one recorder may record at a time.
+ */
+@interface AETraceRecorder : NSObject
+
+/*!
+ * Begin recording
+ *
+ * @param path Path of the trace file to create
+ * @param error On output, if not NULL, the error if one occurred
+ * @return YES on success; NO if the file couldn't be created, or another recorder is recording
+ */
+- (BOOL)beginRecordingToFileAtPath:(NSString*)path error:(NSError**)error;
+
+/*!
+ * Finish recording
+ *
+ *  Writes out any pending events, and closes the trace file.
+ */
+- (void)finishRecording;
+
+/*!
+ * Whether the recorder is currently recording
+ */
+@property (nonatomic, readonly) BOOL recording;
+
+/*!
+ * The path to the trace file being written
+ */
+@property (nonatomic, strong, readonly) NSString *path;
+
+/*!
+ * Number of events dropped because a thread's buffer was full, since recording began
+ */
+@property (nonatomic, readonly) NSUInteger droppedEventCount;
+
+/*!
+ * Interval between writes of pending events to the file, in seconds
+ *
+ *  Default is 0.1 seconds.
+ */
+@property (nonatomic, assign) NSTimeInterval exportInterval;
+
+@end
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,346 @@
+//
+//  AETraceRecorder.m
+//  The Amazing Audio Engine
+//
+//  Created by Michael Tyson on 19/10/2026.
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#import "AETraceRecorder.h"
+#import "AEUtilities.h"
+#import "TPCircularBuffer.h"
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
+
+static const NSTimeInterval kDefaultExportInterval = 0.1;
+static const int kThreadNameLength                 = 64;
+
+/*!
+ * Trace event
+ */
+typedef struct {
+    uint64_t    timestamp;
+    const char *name;
+    char        phase;
+} trace_event_t;
+
+/*!
+ * Per-thread event ring
+ *
+ *  Claimed by a thread on its first event, and released when the thread exits. The
+ *  owning thread is the only producer; the export thread is the only consumer.
+ */
+typedef struct {
+    void * volatile     owner;
+    uint64_t            threadID;
+    char                name[kThreadNameLength];
+    volatile BOOL       nameChanged;
+    volatile int32_t    dropped;
+    TPCircularBuffer    buffer;
+    uint64_t            exportedThreadID;
+} trace_thread_t;
+
+// Thread rings are allocated once, and never freed, so that a thread preempted mid-write
+// can never write into freed memory
+static trace_thread_t __threads[AETraceRecorderMaximumThreads];
+static pthread_key_t __threadKey;
+static volatile BOOL __recording = NO;
+static void * volatile __activeRecorder = NULL;
+
+static void AETraceInitialize(void);
+static void releaseThread(void *value);
+static void exportPendingEvents(__unsafe_unretained AETraceRecorder *THIS);
+
+@interface AETraceRecorderExportThread : NSThread
+- (id)initWithTraceRecorder:(AETraceRecorder*)recorder;
+@property (nonatomic, assign) NSTimeInterval exportInterval;
+@end
+
+@interface AETraceRecorder () {
+    FILE               *_file;
+    uint64_t            _startTime;
+    BOOL                _firstEvent;
+    AETraceRecorderExportThread *_exportThread;
+}
+@property (nonatomic, strong, readwrite) NSString *path;
+@end
+
+@implementation AETraceRecorder
+
+- (instancetype)init {
+    if ( !(self = [super init]) ) return nil;
+    _exportInterval = kDefaultExportInterval;
+    return self;
+}
+
+- (void)dealloc {
+    [self finishRecording];
+}
+
+- (BOOL)beginRecordingToFileAtPath:(NSString *)path error:(NSError **)error {
+    if ( !OSAtomicCompareAndSwapPtrBarrier(NULL, (__bridge void*)self, &__activeRecorder) ) {
+        if ( error ) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EBUSY
+                                              userInfo:@{ NSLocalizedDescriptionKey: NSLocalizedString(@"Another trace recorder is already recording", @"") }];
+        return NO;
+    }
+
+    AETraceInitialize();
+
+    _file = fopen([path fileSystemRepresentation], "w");
+    if ( !_file ) {
+        if ( error ) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno
+                                              userInfo:@{ NSLocalizedDescriptionKey: NSLocalizedString(@"Couldn't open the trace file for writing", @"") }];
+        __activeRecorder = NULL;
+        return NO;
+    }
+
+    self.path = path;
+
+    // Discard anything left over from a previous recording
+    for ( int i=0; i<AETraceRecorderMaximumThreads; i++ ) {
+        TPCircularBufferClear(&__threads[i].buffer);
+        __threads[i].dropped = 0;
+        __threads[i].exportedThreadID = 0;
+    }
+
+    _startTime = AECurrentTimeInHostTicks();
+    _firstEvent = YES;
+    fprintf(_file, "{\"traceEvents\":[\n");
+
+    OSMemoryBarrier();
+    __recording = YES;
+
+    _exportThread = [[AETraceRecorderExportThread alloc] initWithTraceRecorder:self];
+    _exportThread.exportInterval = _exportInterval;
+    [_exportThread start];
+
+    return YES;
+}
+
+- (void)finishRecording {
+    if ( !_file ) return;
+
+    __recording = NO;
+    OSMemoryBarrier();
+
+    [_exportThread cancel];
+    while ( [_exportThread isExecuting] ) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    _exportThread = nil;
+
+    exportPendingEvents(self);
+
+    fprintf(_file, "\n]}\n");
+    fclose(_file);
+    _file = NULL;
+
+    OSMemoryBarrier();
+    __activeRecorder = NULL;
+}
+
+-(BOOL)recording {
+    return _file != NULL;
+}
+
+-(NSUInteger)droppedEventCount {
+    NSUInteger count = 0;
+    for ( int i=0; i<AETraceRecorderMaximumThreads; i++ ) {
+        count += __threads[i].dropped;
+    }
+    return count;
+}
+
+-(void)setExportInterval:(NSTimeInterval)exportInterval {
+    _exportInterval = exportInterval;
+    _exportThread.exportInterval = exportInterval;
+}
+
+#pragma mark - Export
+
+static void writeJSONString(FILE *file, const char *string) {
+    fputc('"', file);
+    for ( const char *c = string; *c; c++ ) {
+        if ( *c == '"' || *c == '\\' ) {
+            fputc('\\', file);
+            fputc(*c, file);
+        } else if ( (unsigned char)*c < 0x20 ) {
+            fprintf(file, "\\u%04x", (unsigned char)*c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+static void beginEventRecord(__unsafe_unretained AETraceRecorder *THIS) {
+    if ( !THIS->_firstEvent ) fprintf(THIS->_file, ",\n");
+    THIS->_firstEvent = NO;
+}
+
+static void exportPendingEvents(__unsafe_unretained AETraceRecorder *THIS) {
+    int pid = getpid();
+
+    for ( int i=0; i<AETraceRecorderMaximumThreads; i++ ) {
+        trace_thread_t *thread = &__threads[i];
+
+        int32_t availableBytes;
+        trace_event_t *event = TPCircularBufferTail(&thread->buffer, &availableBytes);
+        if ( !event ) continue;
+
+        if ( thread->exportedThreadID != thread->threadID || thread->nameChanged ) {
+            // Describe the thread, the first time we see it
+            thread->nameChanged = NO;
+            thread->exportedThreadID = thread->threadID;
+            beginEventRecord(THIS);
+            fprintf(THIS->_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%llu,\"args\":{\"name\":", pid, thread->threadID);
+            writeJSONString(THIS->_file, thread->name[0] ? thread->name : "Unnamed thread");
+            fprintf(THIS->_file, "}}");
+        }
+
+        trace_event_t *end = (trace_event_t*)((char*)event + availableBytes);
+        for ( ; event < end; event++ ) {
+            double timestamp = event->timestamp >= THIS->_startTime
+                ? AESecondsFromHostTicks(event->timestamp - THIS->_startTime) * 1.0e6
+                : -AESecondsFromHostTicks(THIS->_startTime - event->timestamp) * 1.0e6;
+
+            beginEventRecord(THIS);
+            fprintf(THIS->_file, "{\"name\":");
+            writeJSONString(THIS->_file, event->name);
+            fprintf(THIS->_file, ",\"ph\":\"%c\",\"ts\":%.3lf,\"pid\":%d,\"tid\":%llu%s}",
+                    event->phase, timestamp, pid, thread->threadID, event->phase == 'i' ? ",\"s\":\"t\"" : "");
+        }
+
+        TPCircularBufferConsume(&thread->buffer, availableBytes);
+    }
+
+    fflush(THIS->_file);
+}
+
+#pragma mark - Event recording
+
+static void AETraceInitialize(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&__threadKey, releaseThread);
+        for ( int i=0; i<AETraceRecorderMaximumThreads; i++ ) {
+            TPCircularBufferInit(&__threads[i].buffer, AETraceRecorderEventsPerThread * sizeof(trace_event_t));
+        }
+        OSMemoryBarrier();
+    });
+}
+
+static trace_thread_t *currentThread(void) {
+    trace_thread_t *thread = pthread_getspecific(__threadKey);
+    if ( thread ) return thread;
+
+    // Claim a free ring for this thread
+    pthread_t self = pthread_self();
+    for ( int i=0; i<AETraceRecorderMaximumThreads; i++ ) {
+        if ( OSAtomicCompareAndSwapPtrBarrier(NULL, self, &__threads[i].owner) ) {
+            thread = &__threads[i];
+            pthread_threadid_np(NULL, &thread->threadID);
+            pthread_getname_np(self, thread->name, sizeof(thread->name));
+            pthread_setspecific(__threadKey, thread);
+            return thread;
+        }
+    }
+
+    return NULL;
+}
+
+static void releaseThread(void *value) {
+    trace_thread_t *thread = (trace_thread_t*)value;
+
+    // Give the export thread a chance to write out this thread's events before the ring is reused
+    for ( int i=0; i<10 && __recording; i++ ) {
+        int32_t availableBytes;
+        if ( !TPCircularBufferTail(&thread->buffer, &availableBytes) ) break;
+        usleep(kDefaultExportInterval * 1.0e6);
+    }
+
+    memset(thread->name, 0, sizeof(thread->name));
+    OSMemoryBarrier();
+    thread->owner = NULL;
+}
+
+static inline void recordEvent(const char *name, char phase) {
+    if ( !__recording ) return;
+
+    trace_thread_t *thread = currentThread();
+    if ( !thread ) return;
+
+    int32_t availableBytes;
+    trace_event_t *event = TPCircularBufferHead(&thread->buffer, &availableBytes);
+    if ( !event || availableBytes < sizeof(trace_event_t) ) {
+        OSAtomicIncrement32(&thread->dropped);
+        return;
+    }
+
+    event->timestamp = AECurrentTimeInHostTicks();
+    event->name = name;
+    event->phase = phase;
+    TPCircularBufferProduce(&thread->buffer, sizeof(trace_event_t));
+}
+
+void AETraceBegin(const char *name) {
+    recordEvent(name, 'B');
+}
+
+void AETraceEnd(const char *name) {
+    recordEvent(name, 'E');
+}
+
+void AETraceInstant(const char *name) {
+    recordEvent(name, 'i');
+}
+
+void AETraceSetCurrentThreadName(const char *name) {
+    AETraceInitialize();
+    trace_thread_t *thread = currentThread();
+    if ( !thread ) return;
+    strlcpy(thread->name, name, sizeof(thread->name));
+    OSMemoryBarrier();
+    thread->nameChanged = YES;
+}
+
+@end
+
+@implementation AETraceRecorderExportThread {
+    __unsafe_unretained AETraceRecorder *_recorder;
+}
+- (id)initWithTraceRecorder:(AETraceRecorder *)recorder {
+    if ( !(self = [super init]) ) return nil;
+    _recorder = recorder;
+    return self;
+}
+- (void)main {
+    @autoreleasepool {
+        pthread_setname_np("com.theamazingaudioengine.AETraceRecorderExportThread");
+        while ( !self.isCancelled ) {
+            @autoreleasepool {
+                // The recorder stops this thread before it goes away
+                exportPendingEvents(_recorder);
+                usleep(_exportInterval*1.0e6);
+            }
+        }
+    }
+}
+@end
@@ -35,6 +35,11 @@ extern "C" {
 #import "AEAudioFilePlayer.h"
 #import "AEAudioFileWriter.h"
 #import "AEMemoryBufferPlayer.h"
+#import "AEPolyphonicSamplePlayer.h"
+#import "AEPCMFile.h"
+#import "AESampleInterpolation.h"
+#import "AEStreamingFilePlayer.h"
+#import "AEAudioSampleCache.h"
 #import "AEBlockChannel.h"
 #import "AEBlockFilter.h"
 #import "AEBlockAudioReceiver.h"
@@ -45,6 +50,7 @@ extern "C" {
 #import "AEUtilities.h"
 #import "AEMessageQueue.h"
 #import "AEAudioBufferManager.h"
+#import "AETraceRecorder.h"
 
 /*!
 @mainpage
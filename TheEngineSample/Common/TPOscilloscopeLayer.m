@@ -8,48 +8,21 @@
 
 #import "TPOscilloscopeLayer.h"
 #import "TheAmazingAudioEngine.h"
-#import <Accelerate/Accelerate.h>
-#include <libkern/OSAtomic.h>
-
-#define kBufferLength 2048 // In frames; higher values mean oscilloscope spans more time
-#define kMaxConversionSize 4096
-#define kSkipFrames 16     // Frames to skip - higher value means faster render time, but rougher display
-
-#if CGFLOAT_IS_DOUBLE
-#define SAMPLETYPE double
-#define VRAMP vDSP_vrampD
-#define VSMUL vDSP_vsmulD
-static void VRAMPMUL(const SAMPLETYPE *__vDSP_I, vDSP_Stride __vDSP_IS, SAMPLETYPE *__vDSP_Start, const SAMPLETYPE *__vDSP_Step, SAMPLETYPE *__vDSP_O, vDSP_Stride __vDSP_OS, vDSP_Length __vDSP_N) {
-    // No double version of vDSP_vrampmul, so do it sample by sample
-    int idx=0;
-    SAMPLETYPE *iptr = (SAMPLETYPE*)__vDSP_I;
-    SAMPLETYPE *optr = (SAMPLETYPE*)__vDSP_O;
-    for ( ; idx<__vDSP_N; iptr+=__vDSP_IS, optr+=__vDSP_OS, idx++ ) {
-        *optr = *iptr * (*__vDSP_Start += *__vDSP_Step);
-    }
-}
-#define VSADD vDSP_vsaddD
-#else
-#define SAMPLETYPE float
-#define VRAMP vDSP_vramp
-#define VSMUL vDSP_vsmul
-#define VRAMPMUL vDSP_vrampmul
-#define VSADD vDSP_vsadd
-#endif
+#import "AEScopeTap.h"
 
-@interface TPOscilloscopeLayer () {
+#define kColumns 256            // Columns drawn across the layer
+#define kFramesPerColumn 8      // Frames per column; kColumns * kFramesPerColumn frames span the layer
 
-    SAMPLETYPE  *_buffer;
-    CGPoint     *_scratchBuffer;
-    int          _buffer_head;
-    AudioBufferList *_conversionBuffer;
+@interface TPOscilloscopeLayer () {
+    AEAudioReceiverCallback _tapCallback;
+    CGPoint     *_points;
 #if TARGET_OS_IPHONE
     id           _timer;
 #else
     CVDisplayLinkRef _displayLink;
 #endif
 }
-@property (nonatomic, strong) AEFloatConverter *floatConverter;
+@property (nonatomic, strong) AEScopeTap *tap;
 @end
 
 @implementation TPOscilloscopeLayer
@@ -57,10 +30,11 @@ static void VRAMPMUL(const SAMPLETYPE *__vDSP_I, vDSP_Stride __vDSP_IS, SAMPLETY
 - (id)initWithAudioDescription:(AudioStreamBasicDescription)audioDescription {
     if ( !(self = [super init]) ) return nil;
 
-    self.floatConverter = [[AEFloatConverter alloc] initWithSourceFormat:audioDescription];
-    _conversionBuffer = AEAllocateAndInitAudioBufferList(_floatConverter.floatingPointAudioDescription, kMaxConversionSize);
-    _buffer = (SAMPLETYPE*)calloc(kBufferLength, sizeof(SAMPLETYPE));
-    _scratchBuffer = (CGPoint*)malloc(kBufferLength * sizeof(CGPoint));
+    // The tap summarises the audio on the render thread, and hands over snapshots to draw
+    self.tap = [[AEScopeTap alloc] initWithAudioDescription:audioDescription columns:kColumns framesPerColumn:kFramesPerColumn];
+    if ( !_tap ) return nil;
+    _tapCallback = _tap.receiverCallback;
+    _points = (CGPoint*)malloc(kColumns * 2 * sizeof(CGPoint));
     
 #if TARGET_OS_IPHONE
     self.contentsScale = [[UIScreen mainScreen] scale];
@@ -137,67 +111,58 @@ static CVReturn displayLinkRenderCallback(CVDisplayLinkRef displayLink,
 
 -(void)dealloc {
     [self stop];
-    if ( _buffer ) {
-        free(_buffer);
-    }
-    if ( _scratchBuffer ) {
-        free(_scratchBuffer);
-    }
-    if ( _conversionBuffer ) {
-        AEFreeAudioBufferList(_conversionBuffer);
+    if ( _points ) {
+        free(_points);
     }
 }
 
 #pragma mark - Rendering
 
 -(void)drawInContext:(CGContextRef)ctx {
+    const AEScopeSnapshot *snapshot;
+    AEScopeTapGetSnapshot(_tap, &snapshot);
+    if ( !snapshot || snapshot->columns == 0 ) return;
+    
     CGContextSetShouldAntialias(ctx, false);
     
-    // Render ring buffer as path
+    // Render columns as a path, from the lowest to the highest value in each and on to the next,
+    // with the newest at the right
     CGContextSetLineWidth(ctx, 2);
     CGContextSetStrokeColorWithColor(ctx, [_lineColor CGColor]);
     
-    int frames = kBufferLength-1;
-    int tail = (_buffer_head+1) % kBufferLength;
-    SAMPLETYPE x = 0;
-    SAMPLETYPE xIncrement = (self.bounds.size.width / (float)(frames-1)) * (float)(kSkipFrames+1);
-    SAMPLETYPE multiplier = self.bounds.size.height / 2.0;
+    CGFloat xIncrement = self.bounds.size.width / (CGFloat)(kColumns-1);
+    CGFloat midpoint = self.bounds.size.height / 2.0;
+    CGFloat multiplier = self.bounds.size.height / 2.0;
+    int envelopeLength = kColumns / 2;
+    int columns = (int)snapshot->columns;
+    int firstColumn = kColumns - columns;
+    const float *minimum = snapshot->minimum[0];
+    const float *maximum = snapshot->maximum[0];
     
-    // Generate samples
-    SAMPLETYPE *scratchPtr = (SAMPLETYPE*)_scratchBuffer;
-    while ( frames > 0 ) {
-        int framesToRender = MIN(frames, kBufferLength - tail);
-        int samplesToRender = framesToRender / kSkipFrames;
+    int pointCount = 0;
+    for ( int i=0; i<columns; i++ ) {
+        int column = firstColumn + i;
         
-        VRAMP(&x, &xIncrement, (SAMPLETYPE*)scratchPtr, 2, samplesToRender);
-        VSMUL(&_buffer[tail], kSkipFrames, &multiplier, ((SAMPLETYPE*)scratchPtr)+1, 2, samplesToRender);
+        // Apply an envelope
+        CGFloat envelope = column < envelopeLength
+            ? (CGFloat)column / envelopeLength
+            : (CGFloat)(kColumns - 1 - column) / envelopeLength;
         
-        scratchPtr += 2 * samplesToRender;
-        x += (samplesToRender-1)*xIncrement;
-        tail += framesToRender;
-        if ( tail == kBufferLength ) tail = 0;
-        frames -= framesToRender;
+        CGFloat x = column * xIncrement;
+        CGFloat low = midpoint + minimum[i] * multiplier * envelope;
+        CGFloat high = midpoint + maximum[i] * multiplier * envelope;
+        if ( i % 2 == 0 ) {
+            _points[pointCount++] = CGPointMake(x, low);
+            _points[pointCount++] = CGPointMake(x, high);
+        } else {
+            _points[pointCount++] = CGPointMake(x, high);
+            _points[pointCount++] = CGPointMake(x, low);
+        }
     }
     
-    int sampleCount = (kBufferLength-1) / kSkipFrames;
-    
-    // Apply an envelope
-    SAMPLETYPE start = 0.0;
-    int envelopeLength = sampleCount / 2;
-    SAMPLETYPE step = 1.0 / (float)envelopeLength;
-    VRAMPMUL((SAMPLETYPE*)_scratchBuffer + 1, 2, &start, &step, (SAMPLETYPE*)_scratchBuffer + 1, 2, envelopeLength);
-    
-    start = 1.0;
-    step = -step;
-    VRAMPMUL((SAMPLETYPE*)_scratchBuffer + 1 + (envelopeLength*2), 2, &start, &step, (SAMPLETYPE*)_scratchBuffer + 1 + (envelopeLength*2), 2, envelopeLength);
-    
-    // Assign midpoint
-    SAMPLETYPE midpoint = self.bounds.size.height / 2.0;
-    VSADD((SAMPLETYPE*)_scratchBuffer+1, 2, &midpoint, (SAMPLETYPE*)_scratchBuffer+1, 2, sampleCount);
-    
     // Render lines
     CGContextBeginPath(ctx);
-    CGContextAddLines(ctx, (CGPoint*)_scratchBuffer, sampleCount);
+    CGContextAddLines(ctx, _points, pointCount);
     CGContextStrokePath(ctx);
 }
 
@@ -209,30 +174,7 @@ static void audioCallback(__unsafe_unretained TPOscilloscopeLayer *THIS,
                           const AudioTimeStamp *time,
                           UInt32 frames,
                           AudioBufferList *audio) {
-    // Convert audio
-    AEFloatConverterToFloatBufferList(THIS->_floatConverter, audio, THIS->_conversionBuffer, frames);
-    
-    // Get a pointer to the audio buffer that we can advance
-    float *audioPtr = THIS->_conversionBuffer->mBuffers[0].mData;
-    
-    // Copy in contiguous segments, wrapping around if necessary
-    int remainingFrames = frames;
-    while ( remainingFrames > 0 ) {
-        int framesToCopy = MIN(remainingFrames, kBufferLength - THIS->_buffer_head);
-        
-#if CGFLOAT_IS_DOUBLE
-        vDSP_vspdp(audioPtr, 1, THIS->_buffer + THIS->_buffer_head, 1, framesToCopy);
-#else
-        memcpy(THIS->_buffer + THIS->_buffer_head, audioPtr, framesToCopy * sizeof(float));
-#endif
-        audioPtr += framesToCopy;
-        
-        int buffer_head = THIS->_buffer_head + framesToCopy;
-        if ( buffer_head == kBufferLength ) buffer_head = 0;
-        OSMemoryBarrier();
-        THIS->_buffer_head = buffer_head;
-        remainingFrames -= framesToCopy;
-    }
+    THIS->_tapCallback(THIS->_tap, audioController, source, time, frames, audio);
 }
 
 @end